@@ -0,0 +1,160 @@
+#ifndef XP2GDL90_BANDWIDTH_ACCOUNTING_H
+#define XP2GDL90_BANDWIDTH_ACCOUNTING_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "xp2gdl90/broadcast_clock.h"
+#include "xp2gdl90/settings.h"
+#include "xp2gdl90/udp_broadcaster.h"
+
+/**
+ * Where the stream's bandwidth goes: rolling frame and byte rates per
+ * message class and per destination, and a planner that predicts them from
+ * settings before they are applied. Both count what goes on the link, so a
+ * frame sent to three destinations counts three times.
+ */
+
+namespace xp2gdl90 {
+
+// One per bit of MESSAGE_ALL, lowest bit first.
+constexpr size_t MESSAGE_CLASS_COUNT = 5;
+const char *MessageClassName(size_t index);
+// The index of the lowest class bit set in `message_class`, or
+// MESSAGE_CLASS_COUNT if none is.
+size_t MessageClassIndex(uint32_t message_class);
+
+// Rates are averaged over the last few once-a-second samples.
+constexpr size_t BANDWIDTH_WINDOW_SAMPLES = 5;
+constexpr double BANDWIDTH_SAMPLE_INTERVAL_S = 1.0;
+// IPv4 and UDP headers, carried by every datagram.
+constexpr size_t UDP_IPV4_HEADER_BYTES = 28;
+
+struct BandwidthRate {
+  double frames_per_s = 0.0;
+  double bytes_per_s = 0.0;
+};
+
+struct BandwidthTotals {
+  uint64_t frames = 0;
+  uint64_t bytes = 0;
+};
+
+// Running totals of one stream and their rate over the sampled window.
+class BandwidthMeter {
+public:
+  void add(uint64_t frames, uint64_t bytes) {
+    totals_.frames += frames;
+    totals_.bytes += bytes;
+  }
+  // Keeps the totals at `now` as the newest sample. A clock that went
+  // backwards starts the window over.
+  void sample(double now);
+  // Zero until two samples are kept.
+  BandwidthRate rate() const;
+  const BandwidthTotals &totals() const { return totals_; }
+  void reset();
+
+private:
+  struct Sample {
+    double time = 0.0;
+    BandwidthTotals totals;
+  };
+
+  std::array<Sample, BANDWIDTH_WINDOW_SAMPLES + 1> samples_{};
+  size_t head_ = 0;
+  size_t size_ = 0;
+  BandwidthTotals totals_;
+};
+
+/**
+ * Meters for each message class and each broadcaster destination. Fixed
+ * arrays throughout, so recording allocates nothing and a copy is cheap
+ * enough to publish to a UI thread.
+ */
+class BandwidthAccount {
+public:
+  // Counts `frames` frames of `bytes` in total for each of the first
+  // `destination_count` destinations in `route`. A class outside
+  // MESSAGE_ALL counts only per destination.
+  void record(uint32_t message_class, uint32_t route,
+              size_t destination_count, uint64_t frames, uint64_t bytes);
+  // Samples every meter once BANDWIDTH_SAMPLE_INTERVAL_S has passed since
+  // the last sample; `now` is monotonic seconds. Returns true when it did.
+  bool update(double now);
+  void reset();
+
+  const BandwidthMeter &messageClass(size_t index) const {
+    return classes_[index];
+  }
+  const BandwidthMeter &destination(size_t index) const {
+    return destinations_[index];
+  }
+  // Everything on the link: the sum over destinations.
+  BandwidthRate total() const;
+
+private:
+  std::array<BandwidthMeter, MESSAGE_CLASS_COUNT> classes_{};
+  std::array<BandwidthMeter, udp::MAX_DESTINATIONS> destinations_{};
+  bool sampled_ = false;
+  double last_sample_ = 0.0;
+};
+
+// Framed size of a message with `payload_size` bytes when its payload and
+// CRC bytes need escaping as often as random data does: 2 in 256.
+constexpr double ExpectedFrameBytes(size_t payload_size) {
+  return 2.0 + static_cast<double>(payload_size + 2) * (1.0 + 2.0 / 256.0);
+}
+
+// What the settings alone do not say.
+struct BandwidthPlanInputs {
+  // Targets the traffic source tracks; the plan caps them at
+  // traffic_max_targets.
+  size_t traffic_targets = 0;
+  // ForeFlight devices found by discovery. The first takes the primary
+  // target's place and each other one is a destination of its own.
+  size_t foreflight_devices = 0;
+};
+
+struct BandwidthPlanClass {
+  // To a destination that takes every message of the class.
+  double frames_per_s = 0.0;
+  double frame_bytes = 0.0;
+  // Over every destination.
+  BandwidthRate load;
+};
+
+struct BandwidthPlanDestination {
+  BandwidthRate load;
+  double datagrams_per_s = 0.0;
+  bool over_limit = false;
+};
+
+struct BandwidthPlan {
+  std::array<BandwidthPlanClass, SEND_CLASS_COUNT> classes{};
+  std::array<BandwidthPlanDestination, udp::MAX_DESTINATIONS> destinations{};
+  size_t destination_count = 0;
+  // Destinations past udp::MAX_DESTINATIONS, which the broadcaster refuses.
+  size_t destinations_refused = 0;
+  // Frames, as the account measures them.
+  BandwidthRate total;
+  // With the IPv4 and UDP headers of each datagram.
+  double wire_bytes_per_s = 0.0;
+  size_t destinations_over_limit = 0;
+};
+
+/**
+ * Predicts the link load of `cfg`: each class's rate times the frames per
+ * send times its expected framed size, for every destination subscribed
+ * to it at its rate divisor. An upper bound for traffic, since range and
+ * altitude limits are not applied; adaptive rates count every target at
+ * the near rate within the frame budget. Link probe marks follow the tick
+ * rate and are left out.
+ */
+BandwidthPlan PlanBandwidth(const Settings &cfg,
+                            const BandwidthPlanInputs &inputs);
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_BANDWIDTH_ACCOUNTING_H
@@ -0,0 +1,65 @@
+#ifndef XP2GDL90_BANDWIDTH_LIMITER_H
+#define XP2GDL90_BANDWIDTH_LIMITER_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace udp {
+
+// How a message is treated when bandwidth runs short.
+enum class BandwidthTier : uint8_t {
+  ESSENTIAL = 0, // Always sent; may run the bucket into debt.
+  NORMAL = 1,    // Sent while the bucket holds enough tokens.
+  SHEDDABLE = 2, // Sent only while a reserve is left for the others.
+};
+
+struct BandwidthLimiterStats {
+  uint64_t admitted_bytes = 0;
+  uint64_t shed_messages = 0;
+  uint64_t shed_bytes = 0;
+  uint64_t backoffs = 0;
+  double rate_bytes_per_s = 0.0; // Rate allowed after back-off.
+};
+
+/**
+ * Token bucket for one destination. The bucket refills at the ceiling
+ * scaled by a back-off factor and holds a quarter second of the ceiling.
+ * Send errors halve the factor, at most once per hold period. After a
+ * second without errors it climbs back by a tenth of the ceiling per
+ * second.
+ */
+class BandwidthLimiter {
+public:
+  // A ceiling of zero or less turns the limiter off.
+  void setCeiling(double bytes_per_s);
+  bool enabled() const { return ceiling_ > 0.0; }
+  double ceiling() const { return ceiling_; }
+
+  // Refills for the time since the last update, on a monotonic clock in
+  // seconds, after applying `new_errors` send errors.
+  void update(double now, uint64_t new_errors);
+  // Takes `bytes` from the bucket if the tier allows; counts a shed message
+  // otherwise. Always true while disabled.
+  bool admit(size_t bytes, BandwidthTier tier);
+
+  double tokens() const { return tokens_; }
+  double capacity() const { return capacity_; }
+  double backoffFactor() const { return factor_; }
+  const BandwidthLimiterStats &stats() const { return stats_; }
+  void reset();
+
+private:
+  double ceiling_ = 0.0;
+  double capacity_ = 0.0;
+  double tokens_ = 0.0;
+  double factor_ = 1.0;
+  double last_update_ = 0.0;
+  double last_backoff_ = 0.0;
+  double last_error_ = 0.0;
+  bool updated_ = false;
+  BandwidthLimiterStats stats_;
+};
+
+} // namespace udp
+
+#endif // XP2GDL90_BANDWIDTH_LIMITER_H
@@ -1,25 +1,128 @@
 #ifndef XP2GDL90_BROADCAST_CLOCK_H
 #define XP2GDL90_BROADCAST_CLOCK_H
 
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
 namespace xp2gdl90 {
 
 struct BroadcastClockState {
   bool initialized = false;
   bool replay_active = false;
-  float last_time = 0.0f;
+  // The last result came from simulator time rather than monotonic time.
+  bool simulator_domain = false;
+  double last_time = 0.0;
+  double last_simulator_time = 0.0;
+  double last_monotonic_time = 0.0;
 };
 
 struct BroadcastClockResult {
-  float time = 0.0f;
+  double time = 0.0;
   bool replay_active = false;
   bool schedule_reset_required = false;
 };
 
-BroadcastClockResult UpdateBroadcastClock(float simulator_time,
-                                          float elapsed_time,
+// Seconds on a steady clock since the first call in this process.
+double MonotonicSeconds();
+
+/**
+ * Time source for core code that reads a clock itself instead of being
+ * handed `now`. SystemClock() is the real one; tests and the bench step a
+ * VirtualClock (virtual_clock.h), so hours of scheduling run in
+ * milliseconds and come out the same every run.
+ */
+class Clock {
+public:
+  virtual ~Clock() = default;
+  // As MonotonicSeconds().
+  virtual double monotonicSeconds() = 0;
+  // Wall clock, microseconds since the Unix epoch.
+  virtual int64_t wallMicroseconds() = 0;
+};
+
+// MonotonicSeconds() and the system clock.
+Clock &SystemClock();
+
+/**
+ * Resolves the broadcast time: simulator time in normal flight, monotonic
+ * time during replay or when simulator time is invalid. Simulator time is
+ * typically a float dataref that only resolves ~8 ms after 100k s, so
+ * while it runs normally the result advances by the monotonic delta, held
+ * within one float step of simulator time. A replay change or a simulator
+ * time reversal requires a schedule reset, as before.
+ */
+BroadcastClockResult UpdateBroadcastClock(double simulator_time,
+                                          double monotonic_time,
+                                          bool replay_active,
+                                          BroadcastClockState *state);
+// The same with the monotonic time read from `clock`.
+BroadcastClockResult UpdateBroadcastClock(double simulator_time, Clock &clock,
                                           bool replay_active,
                                           BroadcastClockState *state);
 
+/**
+ * Seconds from `now` until the earliest of `deadlines`, for a loop that only
+ * needs to wake when something is due. NaN deadlines are ignored. The result
+ * is clamped to [min_interval_s, max_interval_s]; with no deadline at all it
+ * is max_interval_s.
+ */
+double NextWakeInterval(double now, const double *deadlines, size_t count,
+                        double min_interval_s, double max_interval_s);
+
+// Message classes that keep their own send schedule.
+enum class SendClass : uint8_t {
+  HEARTBEAT = 0,
+  OWNSHIP = 1,
+  GEO_ALTITUDE = 2,
+  AHRS = 3,
+  DEVICE_INFO = 4,
+  TRAFFIC = 5,
+};
+constexpr size_t SEND_CLASS_COUNT = 6;
+const char *SendClassName(SendClass send_class);
+
+// Send interval deviation buckets, by interval minus the nominal period.
+constexpr size_t SEND_INTERVAL_BUCKETS = 9;
+
+/**
+ * Histogram of the real interval between sends of one message class,
+ * bucketed by how early or late each send was against its period.
+ */
+class SendIntervalHistogram {
+public:
+  // Records a send at `now`; the first send after restart() only sets the
+  // reference point.
+  void recordSend(double now, double period_s);
+  // Forgets the previous send, e.g. after a schedule reset. Counts stay.
+  void restart() { last_send_ = NAN; }
+  void reset();
+
+  // Bucket upper edges in milliseconds of deviation; the last is open.
+  static const char *bucketLabel(size_t bucket);
+  const std::array<uint64_t, SEND_INTERVAL_BUCKETS> &buckets() const {
+    return buckets_;
+  }
+  uint64_t count() const { return count_; }
+  double minIntervalS() const { return count_ > 0 ? min_s_ : 0.0; }
+  double maxIntervalS() const { return max_s_; }
+  double meanIntervalS() const {
+    return count_ > 0 ? sum_s_ / static_cast<double>(count_) : 0.0;
+  }
+
+private:
+  std::array<uint64_t, SEND_INTERVAL_BUCKETS> buckets_{};
+  uint64_t count_ = 0;
+  double min_s_ = 0.0;
+  double max_s_ = 0.0;
+  double sum_s_ = 0.0;
+  double last_send_ = NAN;
+};
+
+using SendIntervalTable =
+    std::array<SendIntervalHistogram, SEND_CLASS_COUNT>;
+
 } // namespace xp2gdl90
 
 #endif // XP2GDL90_BROADCAST_CLOCK_H
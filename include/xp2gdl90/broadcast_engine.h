@@ -0,0 +1,183 @@
+#ifndef XP2GDL90_BROADCAST_ENGINE_H
+#define XP2GDL90_BROADCAST_ENGINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xp2gdl90/bandwidth_accounting.h"
+#include "xp2gdl90/broadcast_clock.h"
+#include "xp2gdl90/datagram_packer.h"
+#include "xp2gdl90/frame_buffer.h"
+#include "xp2gdl90/frame_pool.h"
+#include "xp2gdl90/link_probe.h"
+#include "xp2gdl90/network_sender.h"
+#include "xp2gdl90/settings.h"
+#include "xp2gdl90/shared_output.h"
+#include "xp2gdl90/traffic_pacer.h"
+#include "xp2gdl90/udp_broadcaster.h"
+
+namespace xp2gdl90 {
+
+// How a BroadcastEngine puts frames on the wire.
+struct BroadcastOptions {
+  bool datagram_packing = false;
+  size_t datagram_max_bytes = udp::DATAGRAM_DEFAULT_MAX_BYTES;
+  bool sender_thread = false;
+  udp::OverflowPolicy overflow_policy =
+      udp::OverflowPolicy::DROP_OLDEST_TRAFFIC;
+  ThreadTuning sender_tuning;
+  // Ends each tick that sent anything with a link probe mark.
+  bool link_probe = false;
+};
+
+BroadcastOptions MakeBroadcastOptions(const Settings &cfg);
+
+struct BroadcastStats {
+  uint64_t packets_sent = 0; // Every frame, traffic included.
+  uint64_t traffic_packets_sent = 0;
+  uint64_t bytes_sent = 0;
+  uint64_t send_errors = 0;
+  uint64_t probe_marks_sent = 0;
+};
+
+/**
+ * The send half shared by the X-Plane plugin and the MSFS bridge. The front
+ * ends encode frames and decide when each message class is due; the engine
+ * routes them over the broadcaster's destinations, packs them into
+ * datagrams or hands them to the sender thread, paces each traffic sweep
+ * over its window and keeps the send counters and bandwidth account.
+ *
+ * Not thread-safe: every call comes from the simulator thread. The sender
+ * thread, when running, is the engine's own.
+ */
+class BroadcastEngine {
+public:
+  BroadcastEngine() = default;
+  ~BroadcastEngine();
+
+  BroadcastEngine(const BroadcastEngine &) = delete;
+  BroadcastEngine &operator=(const BroadcastEngine &) = delete;
+
+  // Sends through `broadcaster` from now on, stopping the sender thread of
+  // the previous one. Null detaches; sends then fail.
+  void attach(udp::UDPBroadcaster *broadcaster);
+  udp::UDPBroadcaster *broadcaster() const { return broadcaster_; }
+
+  // Applies `options`, starting or stopping the sender thread. Returns
+  // false if the thread failed to start; frames are then sent inline.
+  bool configure(const BroadcastOptions &options, std::string *out_error);
+  const BroadcastOptions &options() const { return options_; }
+  bool senderRunning() const { return sender_ != nullptr; }
+  const udp::NetworkSender *sender() const { return sender_.get(); }
+
+  // Every frame is also published to `output`, and each flush() writes its
+  // snapshot; nullptr stops publishing. The output must outlive its use
+  // here.
+  void setSharedOutput(SharedOutput *output) { shared_output_ = output; }
+
+  // Stamps link probe marks from `clock`; nullptr is SystemClock(). The
+  // clock must outlive its use here.
+  void setClock(Clock *clock) { clock_ = clock ? clock : &SystemClock(); }
+
+  // Gives `fn` the broadcaster, locked against the sender thread if one
+  // runs. Does nothing while detached.
+  template <typename Fn> void withBroadcaster(Fn &&fn) {
+    if (sender_) {
+      sender_->withBroadcaster(fn);
+    } else if (broadcaster_) {
+      fn(*broadcaster_);
+    }
+  }
+
+  // Sends one framed message to the destinations in `route`. A `leading`
+  // frame starts a new datagram when packing. Returns the bytes sent or
+  // queued, or -1.
+  int sendFrame(const uint8_t *data, size_t size, uint32_t route,
+                bool leading = false);
+  // The same, routed by message class.
+  int sendMessage(const uint8_t *data, size_t size, uint32_t message_class,
+                  bool leading = false);
+  int sendMessage(const gdl90::FrameBuffer &frame, uint32_t message_class,
+                  bool leading = false) {
+    return sendMessage(frame.data(), frame.size(), message_class, leading);
+  }
+
+  // A block to encode a frame into for the overloads below. The pool holds
+  // twice what the sender thread can queue, so a caller holding one frame
+  // at a time always gets one.
+  gdl90::FrameRef acquireFrame() { return frame_pool_.acquire(); }
+  const gdl90::FramePool &framePool() const { return frame_pool_; }
+  // As above, for a pooled frame: the sender thread is handed a reference
+  // instead of a copy. Shared output and capture still copy what they keep.
+  // An empty `frame` counts as a failed send.
+  int sendFrame(const gdl90::FrameRef &frame, uint32_t route,
+                bool leading = false);
+  int sendMessage(const gdl90::FrameRef &frame, uint32_t message_class,
+                  bool leading = false);
+
+  // Paces the frames of a new traffic sweep over `window_s` from `now`.
+  // `frames` must stay put until the next sweep or resetTraffic().
+  void startTraffic(const gdl90::FrameArena &frames, double now,
+                    double window_s);
+  // Sends the traffic frames the pacer has released by `now`. Runs on every
+  // tick, not only on sweep ticks. Returns the bytes sent by this call.
+  size_t sendPacedTraffic(double now);
+  void resetTraffic();
+  const udp::TrafficPacer &trafficPacer() const { return pacer_; }
+
+  // Ends the tick: adds the link probe mark if one is due, sends the
+  // pending datagram, or wakes the sender thread and counts the errors it
+  // reported since the last tick.
+  void flush();
+
+  // Time a frame spends between the tick and the wire, as measured by the
+  // sender thread. Frames sent inline leave within the tick.
+  double senderLeadSeconds() const;
+
+  const BroadcastStats &stats() const { return stats_; }
+  // Frames and bytes sent or queued per message class and destination.
+  // Frames sent with sendFrame() count only per destination.
+  const BandwidthAccount &accounting() const { return accounting_; }
+  // Samples the account's rates; `now` is monotonic seconds.
+  void updateAccounting(double now) { accounting_.update(now); }
+  const udp::DatagramPackerStats &packerStats() const {
+    return packer_.stats();
+  }
+  // Why the last send failed; cleared by the next send that succeeds.
+  const std::string &lastError() const { return last_error_; }
+
+private:
+  // `frame`, when set, holds the same bytes as `data`. A `message_class`
+  // of 0 is accounted only per destination.
+  int send(const uint8_t *data, size_t size, uint32_t route,
+           uint32_t message_class, bool leading, const gdl90::FrameRef *frame);
+  void recordError(const std::string &error);
+  void stopSender();
+  void sendLinkProbe();
+
+  udp::UDPBroadcaster *broadcaster_ = nullptr;
+  SharedOutput *shared_output_ = nullptr;
+  Clock *clock_ = &SystemClock();
+  BroadcastOptions options_;
+  // Declared before sender_, whose queue may hold its blocks.
+  gdl90::FramePool frame_pool_{2 * udp::SENDER_PRIORITY_CAPACITY};
+  std::unique_ptr<udp::NetworkSender> sender_;
+  uint64_t sender_errors_seen_ = 0;
+  udp::DatagramPacker packer_;
+  udp::TrafficPacer pacer_;
+  const gdl90::FrameArena *traffic_frames_ = nullptr;
+  std::vector<udp::SendBuffer> send_buffers_;
+  // Something went out since the last flush().
+  bool sent_this_tick_ = false;
+  uint32_t probe_sequence_ = 0;
+  BroadcastStats stats_;
+  BandwidthAccount accounting_;
+  std::string last_error_;
+};
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_BROADCAST_ENGINE_H
@@ -0,0 +1,47 @@
+#ifndef XP2GDL90_CACHED_FRAME_H
+#define XP2GDL90_CACHED_FRAME_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "xp2gdl90/frame_buffer.h"
+
+namespace gdl90 {
+
+/**
+ * Pre-framed copy of one message that rarely changes, plus the payload it
+ * was framed from. A payload equal to the held one reuses the frame and
+ * skips the CRC and byte stuffing. invalidate() forces the next update to
+ * rebuild, e.g. after the settings behind the message change.
+ */
+class CachedFrame {
+public:
+  bool valid() const { return valid_; }
+  void invalidate() { valid_ = false; }
+  const FrameBuffer &frame() const { return frame_; }
+
+  // Re-frames `payload` unless it matches the held one. Returns the framed
+  // size.
+  size_t update(const uint8_t *payload, size_t size);
+  // Overwrites `size` payload bytes at `offset` and re-frames only if any
+  // changed. Requires valid().
+  size_t patch(size_t offset, const uint8_t *bytes, size_t size);
+
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+private:
+  size_t reframe();
+
+  std::array<uint8_t, FRAME_PAYLOAD_CAPACITY> payload_{};
+  size_t payload_size_ = 0;
+  FrameBuffer frame_;
+  bool valid_ = false;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
+} // namespace gdl90
+
+#endif // XP2GDL90_CACHED_FRAME_H
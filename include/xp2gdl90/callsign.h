@@ -0,0 +1,91 @@
+#ifndef XP2GDL90_CALLSIGN_H
+#define XP2GDL90_CALLSIGN_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace gdl90 {
+
+// Width of the GDL90 callsign field.
+constexpr size_t CALLSIGN_SIZE = 8;
+
+/**
+ * Up to eight callsign characters held inline with their length. Longer
+ * text is truncated. Records holding one stay trivially copyable, so they
+ * can be memcpy'd into column buffers and rings without heap traffic;
+ * std::string conversions are for the settings and UI edge.
+ */
+class Callsign {
+public:
+  constexpr Callsign() = default;
+  Callsign(std::string_view text) { assign(text); }
+  Callsign(const char *text)
+      : Callsign(text ? std::string_view(text) : std::string_view()) {}
+  Callsign(const std::string &text) : Callsign(std::string_view(text)) {}
+
+  // Reads at most `size` bytes, stopping at the first NUL.
+  static Callsign fromBytes(const char *bytes, size_t size) {
+    Callsign callsign;
+    for (size_t i = 0; bytes && i < size && bytes[i] != '\0'; ++i) {
+      callsign.push_back(bytes[i]);
+    }
+    return callsign;
+  }
+
+  void assign(std::string_view text) {
+    clear();
+    for (const char ch : text) {
+      push_back(ch);
+    }
+  }
+  // Ignored once the callsign is full.
+  void push_back(char ch) {
+    if (size_ < CALLSIGN_SIZE) {
+      chars_[size_++] = ch;
+    }
+  }
+  void pop_back() {
+    if (size_ > 0) {
+      chars_[--size_] = '\0';
+    }
+  }
+  void clear() {
+    chars_ = {};
+    size_ = 0;
+  }
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+  bool full() const { return size_ == CALLSIGN_SIZE; }
+  const char *data() const { return chars_.data(); }
+  char operator[](size_t index) const { return chars_[index]; }
+  char back() const { return size_ > 0 ? chars_[size_ - 1] : '\0'; }
+  const char *begin() const { return chars_.data(); }
+  const char *end() const { return chars_.data() + size_; }
+
+  std::string_view view() const { return std::string_view(data(), size_); }
+  std::string str() const { return std::string(data(), size_); }
+
+  friend bool operator==(const Callsign &a, const Callsign &b) {
+    return a.view() == b.view();
+  }
+  friend bool operator!=(const Callsign &a, const Callsign &b) {
+    return !(a == b);
+  }
+
+private:
+  // NUL-padded past size_.
+  std::array<char, CALLSIGN_SIZE> chars_{};
+  uint8_t size_ = 0;
+};
+
+static_assert(std::is_trivially_copyable<Callsign>::value,
+              "Callsign must stay trivially copyable");
+
+} // namespace gdl90
+
+#endif // XP2GDL90_CALLSIGN_H
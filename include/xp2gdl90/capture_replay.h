@@ -0,0 +1,95 @@
+#ifndef XP2GDL90_CAPTURE_REPLAY_H
+#define XP2GDL90_CAPTURE_REPLAY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "xp2gdl90/datagram_packer.h"
+#include "xp2gdl90/gdl90_decoder.h"
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/udp_broadcaster.h"
+
+/**
+ * Plays a StreamCapture ring back through a UDPBroadcaster, at the
+ * recorded timing, scaled, or as fast as the socket takes it. Traffic can
+ * be multiplied into synthetic targets to load-test receivers without a
+ * simulator.
+ */
+
+namespace udp {
+
+// One datagram as it was sent: the records the capture cut it into,
+// joined back together.
+struct CaptureDatagram {
+  int64_t timestamp_ns = 0;
+  uint32_t sequence = 0;
+  uint8_t destination = 0;
+  std::vector<uint8_t> data;
+};
+
+// Reads a capture file into datagrams, oldest first. Empty slots are
+// skipped, so a ring that never wrapped reads the same as one that did.
+// A compact capture (compact_capture.h) is recognised and read as well.
+bool ReadCapture(const std::string &path, std::vector<CaptureDatagram> *out,
+                 std::string *out_error);
+
+// Replays only records sent to this capture destination; the broadcaster
+// fans them out to its own destinations.
+constexpr int REPLAY_ALL_DESTINATIONS = -1;
+constexpr uint32_t REPLAY_DEFAULT_ADDRESS_STEP = 0x001000;
+constexpr uint32_t REPLAY_MAX_TRAFFIC_COPIES = 256;
+
+struct ReplayOptions {
+  // Multiple of the recorded rate; 0 or less sends flat out.
+  double speed = 1.0;
+  // Each traffic report is sent this many times, copy k with its address
+  // moved by k * address_step. 1 sends the capture as recorded.
+  uint32_t traffic_copies = 1;
+  uint32_t address_step = REPLAY_DEFAULT_ADDRESS_STEP;
+  int source_destination = 0;
+  // Datagram size when multiplied traffic is repacked.
+  size_t max_datagram_bytes = DATAGRAM_DEFAULT_MAX_BYTES;
+};
+
+struct ReplayStats {
+  uint64_t datagrams = 0;
+  uint64_t bytes = 0;
+  uint64_t send_errors = 0;
+  uint64_t synthetic_reports = 0;
+  // Datagrams sent more than a millisecond after their scheduled time.
+  uint64_t late = 0;
+  double elapsed_seconds = 0.0;
+};
+
+class CaptureReplay {
+public:
+  CaptureReplay(UDPBroadcaster &broadcaster, const ReplayOptions &options);
+
+  // Sends `datagrams` once, returning early if `stop` becomes true. Stats
+  // accumulate across runs.
+  void run(const std::vector<CaptureDatagram> &datagrams,
+           const std::atomic<bool> *stop = nullptr);
+
+  const ReplayStats &stats() const { return stats_; }
+
+private:
+  void sendDatagram(const CaptureDatagram &datagram);
+  void sendMultiplied(const CaptureDatagram &datagram);
+  void appendFrame(const uint8_t *payload, size_t size, bool leading);
+
+  UDPBroadcaster &broadcaster_;
+  ReplayOptions options_;
+  ReplayStats stats_;
+  gdl90::GDL90Encoder encoder_;
+  gdl90::Decoder decoder_;
+  DatagramPacker packer_;
+  gdl90::FrameBuffer frame_;
+  std::vector<uint8_t> scratch_;
+};
+
+} // namespace udp
+
+#endif // XP2GDL90_CAPTURE_REPLAY_H
@@ -0,0 +1,219 @@
+#ifndef XP2GDL90_COMPACT_CAPTURE_H
+#define XP2GDL90_COMPACT_CAPTURE_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "xp2gdl90/capture_replay.h"
+#include "xp2gdl90/spsc_ring.h"
+#include "xp2gdl90/stream_capture.h"
+
+/**
+ * A capture format for sessions too long for the pcap ring. Position
+ * reports are stored as their wire fields, each a varint residual against
+ * a linear prediction from the same track's previous reports; other frames
+ * are stored as their payloads. Framing and CRC are rebuilt on reading, so
+ * every datagram comes back byte for byte. The file is a run of blocks,
+ * each starting with no track history, so a reader can seek to any block.
+ */
+
+namespace udp {
+
+constexpr uint32_t COMPACT_CAPTURE_VERSION = 1;
+// A new block starts once this much capture time has passed. Each block
+// spells out every track's first report in full, so shorter blocks seek
+// faster and compress worse.
+constexpr double COMPACT_CAPTURE_KEYFRAME_S = 30.0;
+// Datagrams queued for the writer thread, and the largest one queued whole.
+constexpr size_t COMPACT_CAPTURE_QUEUE_SLOTS = 2048;
+constexpr size_t COMPACT_CAPTURE_MAX_DATAGRAM = 1500;
+
+// Where a block sits in the file and what it starts with.
+struct CompactCaptureBlock {
+  uint64_t offset = 0;
+  int64_t first_timestamp_ns = 0;
+  uint32_t first_sequence = 0;
+  uint32_t datagrams = 0;
+  uint32_t size = 0;
+};
+
+// Writes the datagrams of one block into its body.
+class CompactCaptureEncoder {
+public:
+  // Forgets every track and starts timing from `timestamp_ns`.
+  void reset(int64_t timestamp_ns);
+  void encode(int64_t timestamp_ns, uint8_t destination, const uint8_t *data,
+              size_t size, std::vector<uint8_t> *out);
+
+  // Position reports written as residuals and as plain payloads.
+  uint64_t predicted() const { return predicted_; }
+  uint64_t literal() const { return literal_; }
+
+private:
+  struct Track {
+    uint32_t index = 0;
+    uint32_t samples = 0;
+    std::array<uint32_t, 13> last{};
+    std::array<uint32_t, 13> before{};
+    std::array<uint8_t, 8> callsign{};
+  };
+
+  // Splits `data` into payloads_ and payload_ends_. False unless
+  // reframing them gives back `data` exactly.
+  bool splitFrames(const uint8_t *data, size_t size);
+  void encodePayload(const uint8_t *payload, size_t size,
+                     std::vector<uint8_t> *out);
+
+  int64_t last_timestamp_ns_ = 0;
+  std::unordered_map<uint32_t, Track> tracks_;
+  std::array<std::vector<uint8_t>, 256> last_payload_;
+  gdl90::Decoder decoder_;
+  std::vector<uint8_t> payloads_;
+  std::vector<size_t> payload_ends_;
+  std::vector<uint8_t> reframed_;
+  uint64_t predicted_ = 0;
+  uint64_t literal_ = 0;
+};
+
+// Reads back what CompactCaptureEncoder wrote, one block at a time.
+class CompactCaptureDecoder {
+public:
+  void reset(int64_t timestamp_ns);
+  // Decodes the datagram at `*offset` in a block body and advances past
+  // it. False if the body is damaged there.
+  bool decode(const uint8_t *body, size_t size, size_t *offset,
+              CaptureDatagram *out);
+
+private:
+  struct Track {
+    uint32_t key = 0;
+    uint32_t samples = 0;
+    std::array<uint32_t, 13> last{};
+    std::array<uint32_t, 13> before{};
+    std::array<uint8_t, 8> callsign{};
+  };
+
+  int64_t last_timestamp_ns_ = 0;
+  std::vector<Track> tracks_;
+  std::array<std::vector<uint8_t>, 256> last_payload_;
+  std::vector<uint8_t> payload_;
+};
+
+/**
+ * Appends datagrams to a compact capture file. record() copies each one
+ * into a preallocated queue; a background thread encodes and writes whole
+ * blocks, so the sending thread never touches the disk.
+ */
+class CompactCaptureWriter final : public CaptureSink {
+public:
+  CompactCaptureWriter();
+  ~CompactCaptureWriter() override;
+
+  CompactCaptureWriter(const CompactCaptureWriter &) = delete;
+  CompactCaptureWriter &operator=(const CompactCaptureWriter &) = delete;
+
+  // Creates or overwrites `path` and starts the writer thread.
+  bool open(const std::string &path, std::string *out_error);
+  // Writes everything queued and the last block, then closes the file.
+  void close();
+  bool isOpen() const { return file_.is_open(); }
+  const std::string &path() const override { return path_; }
+
+  void record(const uint8_t *data, size_t size,
+              uint32_t destination) override;
+  // As record(), with the timestamp given, e.g. when converting a capture.
+  void recordAt(int64_t timestamp_ns, const uint8_t *data, size_t size,
+                uint32_t destination);
+
+  // records and bytes count what was queued; flushes counts blocks
+  // written; dropped counts datagrams the full queue turned away.
+  StreamCaptureStats stats() const override;
+
+private:
+  struct QueuedDatagram {
+    int64_t timestamp_ns = 0;
+    uint8_t destination = 0;
+    uint16_t size = 0;
+    std::array<uint8_t, COMPACT_CAPTURE_MAX_DATAGRAM> data{};
+  };
+
+  void run();
+  // Encodes what is queued; on the writer thread, or after it stopped.
+  void drain();
+  void writeBlock();
+
+  std::string path_;
+  std::ofstream file_;
+  SpscRing<QueuedDatagram> queue_;
+  CompactCaptureEncoder encoder_;
+  std::vector<uint8_t> block_;
+  CompactCaptureBlock current_;
+  bool block_open_ = false;
+  uint32_t sequence_ = 0;
+  int64_t wall_base_ns_ = 0;
+  std::chrono::steady_clock::time_point steady_base_;
+
+  std::atomic<uint64_t> records_{0};
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> blocks_{0};
+  std::atomic<uint64_t> file_bytes_{0};
+
+  std::thread thread_;
+  bool stop_requested_ = false;
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+};
+
+/**
+ * Reads a compact capture. open() walks the block headers only; seek()
+ * then loads the one block that holds the requested time.
+ */
+class CompactCaptureReader {
+public:
+  // False if `path` is missing or not a compact capture. A block cut short
+  // by a crash ends the file.
+  bool open(const std::string &path, std::string *out_error);
+
+  const std::vector<CompactCaptureBlock> &blocks() const { return blocks_; }
+  // Positions before the first datagram sent at or after `timestamp_ns`.
+  void seek(int64_t timestamp_ns);
+  // False at the end of the file or at a damaged block.
+  bool next(CaptureDatagram *out);
+
+private:
+  bool loadBlock(size_t block);
+
+  std::ifstream file_;
+  std::vector<CompactCaptureBlock> blocks_;
+  size_t next_block_ = 0;
+  std::vector<uint8_t> body_;
+  size_t body_offset_ = 0;
+  uint32_t remaining_ = 0;
+  uint32_t next_sequence_ = 0;
+  CompactCaptureDecoder decoder_;
+  // The datagram seek() stopped at, returned by the next next().
+  CaptureDatagram pending_;
+  bool has_pending_ = false;
+};
+
+// True if `path` starts with the compact capture magic.
+bool IsCompactCapture(const std::string &path);
+// Reads every datagram, oldest first.
+bool ReadCompactCapture(const std::string &path,
+                        std::vector<CaptureDatagram> *out,
+                        std::string *out_error);
+
+} // namespace udp
+
+#endif // XP2GDL90_COMPACT_CAPTURE_H
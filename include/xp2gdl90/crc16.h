@@ -0,0 +1,37 @@
+#ifndef XP2GDL90_CRC16_H
+#define XP2GDL90_CRC16_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * CRC-CCITT (polynomial 0x1021) as specified by the GDL90 interface
+ * document. Each byte is shifted into the low end of the register, so the
+ * result matches the spec's reference routine rather than CRC-16/XMODEM.
+ */
+
+namespace gdl90 {
+
+namespace detail {
+
+// kCrc16Tables[k][v] is v * x^(8 * (k + 2)) mod P; table 0 is the spec table.
+extern const std::array<std::array<uint16_t, 256>, 8> kCrc16Tables;
+
+} // namespace detail
+
+inline uint16_t Crc16Update(uint16_t crc, uint8_t byte) {
+  return detail::kCrc16Tables[0][crc >> 8] ^ static_cast<uint16_t>(crc << 8) ^
+         byte;
+}
+
+// Slicing-by-8 kernel; `crc` lets callers continue a running checksum.
+uint16_t Crc16(const uint8_t *data, size_t size, uint16_t crc = 0);
+
+// Checksums `count` independent buffers, interleaving four at a time.
+void Crc16Batch(const uint8_t *const *buffers, const size_t *sizes,
+                size_t count, uint16_t *out_crcs);
+
+} // namespace gdl90
+
+#endif // XP2GDL90_CRC16_H
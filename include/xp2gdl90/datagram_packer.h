@@ -0,0 +1,72 @@
+#ifndef XP2GDL90_DATAGRAM_PACKER_H
+#define XP2GDL90_DATAGRAM_PACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "xp2gdl90/udp_broadcaster.h"
+
+/**
+ * Packs self-delimiting GDL90 frames into UDP datagrams of up to a
+ * configured payload size, so a busy tick costs a few sends instead of one
+ * per frame.
+ */
+
+namespace udp {
+
+constexpr size_t DATAGRAM_DEFAULT_MAX_BYTES = 1400;
+constexpr size_t DATAGRAM_MIN_MAX_BYTES = 128;
+constexpr size_t DATAGRAM_MAX_MAX_BYTES = 65507;
+
+struct DatagramPackerStats {
+  uint64_t datagrams_sent = 0;
+  uint64_t frames_sent = 0;
+  uint64_t bytes_sent = 0;
+  uint64_t send_errors = 0;
+  double last_fill_ratio = 0.0;
+  double min_fill_ratio = 0.0;
+  double fill_ratio_sum = 0.0;
+
+  double averageFillRatio() const {
+    return datagrams_sent > 0
+               ? fill_ratio_sum / static_cast<double>(datagrams_sent)
+               : 0.0;
+  }
+};
+
+class DatagramPacker {
+public:
+  explicit DatagramPacker(
+      size_t max_datagram_bytes = DATAGRAM_DEFAULT_MAX_BYTES);
+
+  void setMaxDatagramBytes(size_t max_datagram_bytes);
+  size_t maxDatagramBytes() const { return max_datagram_bytes_; }
+
+  // Queues one frame, sending the pending datagram first when the frame
+  // would not fit. A `leading` frame (the heartbeat) always starts a new
+  // datagram, as does a change of destination set. Returns false if a send
+  // triggered by this call failed.
+  bool append(const uint8_t *frame, size_t size, bool leading,
+              UDPBroadcaster &broadcaster,
+              uint32_t destinations = ALL_DESTINATIONS);
+
+  // Sends whatever is pending. Returns bytes sent, 0 if idle, -1 on error.
+  int flush(UDPBroadcaster &broadcaster);
+
+  size_t pendingBytes() const { return pending_.size(); }
+  size_t pendingFrames() const { return pending_frames_; }
+  const DatagramPackerStats &stats() const { return stats_; }
+  void resetStats() { stats_ = DatagramPackerStats{}; }
+
+private:
+  std::vector<uint8_t> pending_;
+  size_t pending_frames_ = 0;
+  uint32_t pending_destinations_ = ALL_DESTINATIONS;
+  size_t max_datagram_bytes_ = DATAGRAM_DEFAULT_MAX_BYTES;
+  DatagramPackerStats stats_;
+};
+
+} // namespace udp
+
+#endif // XP2GDL90_DATAGRAM_PACKER_H
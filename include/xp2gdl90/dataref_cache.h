@@ -0,0 +1,39 @@
+#ifndef XP2GDL90_DATAREF_CACHE_H
+#define XP2GDL90_DATAREF_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace xp2gdl90 {
+
+/**
+ * Remembers simulator dataref lookups by name, so refs resolved at one
+ * enable are not looked up again at the next. Handles are opaque; the
+ * finder is XPLMFindDataRef in the plugin and a fake in tests. Misses are
+ * not remembered, since a plugin loaded later may still publish the name.
+ */
+class DataRefCache {
+public:
+  using Handle = void *;
+  using Finder = Handle (*)(const char *name);
+
+  explicit DataRefCache(Finder finder) : finder_(finder) {}
+
+  Handle find(const char *name);
+  void clear() { refs_.clear(); }
+
+  size_t size() const { return refs_.size(); }
+  // Calls that reached the finder, hits or misses.
+  uint64_t lookups() const { return lookups_; }
+
+private:
+  Finder finder_;
+  std::unordered_map<std::string, Handle> refs_;
+  uint64_t lookups_ = 0;
+};
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_DATAREF_CACHE_H
@@ -0,0 +1,136 @@
+#ifndef XP2GDL90_FOREFLIGHT_DISCOVERY_H
+#define XP2GDL90_FOREFLIGHT_DISCOVERY_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "xp2gdl90/spsc_ring.h"
+#include "xp2gdl90/udp_broadcaster.h"
+#include "xp2gdl90/udp_receiver.h"
+
+/**
+ * Listens for ForeFlight discovery broadcasts on a background thread that
+ * sleeps in the OS until the socket is readable. The latest discovery is
+ * published as an atomic snapshot for the simulator thread to pick up.
+ */
+
+namespace xp2gdl90::foreflight {
+
+// Upper bound on how long stop() waits for the listener thread to notice.
+constexpr int DISCOVERY_WAIT_TIMEOUT_MS = 100;
+// Broadcasts queued for takeSightings(); further ones until the next take
+// only update the snapshot.
+constexpr size_t DISCOVERY_SIGHTING_CAPACITY = 32;
+// ForeFlight clients streamed to at once.
+constexpr size_t DISCOVERY_MAX_DEVICES = 8;
+
+struct DiscoverySnapshot {
+  // Source IP of the broadcast and the GDL90 port it advertised.
+  udp::SourceAddress target;
+  // Bumped for every valid broadcast; 0 until the first one arrives.
+  uint64_t sequence = 0;
+};
+
+class DiscoveryListener {
+public:
+  explicit DiscoveryListener(std::unique_ptr<udp::UDPReceiver> receiver,
+                             int wait_timeout_ms = DISCOVERY_WAIT_TIMEOUT_MS);
+  ~DiscoveryListener();
+
+  DiscoveryListener(const DiscoveryListener &) = delete;
+  DiscoveryListener &operator=(const DiscoveryListener &) = delete;
+
+  bool start();
+  void stop();
+  bool isRunning() const { return thread_.joinable(); }
+  uint16_t getListenPort() const { return listen_port_; }
+
+  // Waits up to `timeout_ms` for a datagram and publishes any discoveries.
+  // The listener thread calls this; without a running thread it may be
+  // called directly. Returns the number of valid broadcasts, or -1 on error.
+  int pollOnce(int timeout_ms);
+
+  // Moves up to `capacity` queued broadcast sources, oldest first, into
+  // `out` and returns how many. Call from one thread only.
+  size_t takeSightings(udp::SourceAddress *out, size_t capacity);
+
+  // Safe to call from any thread.
+  DiscoverySnapshot snapshot() const;
+  uint64_t errorCount() const {
+    return error_count_.load(std::memory_order_relaxed);
+  }
+  std::string lastError() const;
+
+private:
+  void run();
+
+  std::unique_ptr<udp::UDPReceiver> receiver_;
+  uint16_t listen_port_;
+  int wait_timeout_ms_;
+  udp::ReceiveBatch batch_;
+
+  // ipv4 << 16 | port, so the target is always read whole.
+  std::atomic<uint64_t> packed_target_{0};
+  std::atomic<uint64_t> sequence_{0};
+  udp::SpscRing<uint64_t> sightings_{DISCOVERY_SIGHTING_CAPACITY};
+  std::atomic<uint64_t> error_count_{0};
+  mutable std::mutex error_mutex_;
+  std::string last_error_;
+
+  std::thread thread_;
+  std::atomic<bool> stop_requested_{false};
+};
+
+struct DiscoveredDevice {
+  udp::SourceAddress address;
+  double last_seen = 0.0;
+};
+
+/**
+ * The ForeFlight clients heard from recently, in the order they first
+ * appeared, so the first live one stays the primary target while others
+ * come and go. Lookups compare packed addresses over a fixed array; nothing
+ * allocates. When the table is full a new device replaces the one heard
+ * from longest ago.
+ */
+class DeviceTable {
+public:
+  // Records a broadcast from `address` at `now`; true if it is new.
+  bool see(const udp::SourceAddress &address, double now);
+  // Forgets devices silent for more than `timeout` seconds, keeping the
+  // others in order, and returns how many were dropped.
+  size_t expire(double now, double timeout);
+  void clear();
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const DiscoveredDevice &operator[](size_t index) const {
+    return devices_[index];
+  }
+  // Changes whenever a device joins or leaves, not on every broadcast.
+  uint64_t generation() const { return generation_; }
+
+private:
+  std::array<DiscoveredDevice, DISCOVERY_MAX_DEVICES> devices_{};
+  size_t size_ = 0;
+  uint64_t generation_ = 0;
+};
+
+// Makes the broadcaster's discovered destinations the devices after the
+// first, which is the primary target, in order. Devices keep their order,
+// so those that still match keep their rate and bandwidth state and only
+// the ones from the first change on are re-added. Returns how many were
+// refused, with the last reason in `out_error`.
+size_t ApplyDeviceDestinations(const DeviceTable &devices,
+                               udp::UDPBroadcaster &broadcaster,
+                               std::string *out_error = nullptr);
+
+} // namespace xp2gdl90::foreflight
+
+#endif // XP2GDL90_FOREFLIGHT_DISCOVERY_H
@@ -6,6 +6,15 @@
 #include <string>
 #include <vector>
 
+#include "xp2gdl90/frame_buffer.h"
+
+namespace gdl90 {
+class CachedFrame;
+namespace internal {
+class PayloadBuffer;
+} // namespace internal
+} // namespace gdl90
+
 namespace gdl90::foreflight {
 
 constexpr uint8_t MSG_ID_FORE_FLIGHT = 0x65;
@@ -38,7 +47,16 @@ public:
   std::vector<uint8_t> createIdMessage(const DeviceInfo &data) const;
   std::vector<uint8_t> createAhrsMessage(const AhrsData &data) const;
 
+  // Allocation-free variants: overwrite `out` and return the framed size.
+  size_t encodeIdMessageInto(const DeviceInfo &data, FrameBuffer &out) const;
+  size_t encodeAhrsMessageInto(const AhrsData &data, FrameBuffer &out) const;
+  // The ID message only changes with settings; callers keep `cache` until
+  // then and skip encoding while it is valid.
+  size_t encodeIdMessageInto(const DeviceInfo &data, CachedFrame &cache) const;
+
 private:
+  void encodeIdPayload(const DeviceInfo &data,
+                       internal::PayloadBuffer &payload) const;
   int16_t encodeAhrsAttitude(double degrees) const;
   uint16_t encodeAhrsHeading(double degrees, bool magnetic_heading) const;
 };
@@ -1,6 +1,7 @@
 #ifndef XP2GDL90_FOREFLIGHT_PROTOCOL_H
 #define XP2GDL90_FOREFLIGHT_PROTOCOL_H
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -8,6 +9,8 @@ namespace xp2gdl90::foreflight {
 
 bool ParseDiscoveryBroadcast(const std::vector<uint8_t> &packet,
                              uint16_t *out_port);
+bool ParseDiscoveryBroadcast(const uint8_t *data, size_t size,
+                             uint16_t *out_port);
 
 } // namespace xp2gdl90::foreflight
 
@@ -0,0 +1,102 @@
+#ifndef XP2GDL90_FRAME_BUFFER_H
+#define XP2GDL90_FRAME_BUFFER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gdl90 {
+
+// Worst-case framed size: every payload and CRC byte escaped, plus two flags.
+constexpr size_t MaxFrameSize(size_t payload_size) {
+  return 2 * (payload_size + 2) + 2;
+}
+
+// Largest unframed payload any encoder produces (ForeFlight ID is 39 bytes).
+constexpr size_t FRAME_PAYLOAD_CAPACITY = 64;
+constexpr size_t FRAME_BUFFER_CAPACITY = MaxFrameSize(FRAME_PAYLOAD_CAPACITY);
+
+/**
+ * Fixed-capacity, caller-owned storage for one framed GDL90 message.
+ * Reusing a FrameBuffer across calls keeps encoding allocation-free.
+ */
+class FrameBuffer {
+public:
+  const uint8_t *data() const { return bytes_.data(); }
+  uint8_t *data() { return bytes_.data(); }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  static constexpr size_t capacity() { return FRAME_BUFFER_CAPACITY; }
+
+  const uint8_t *begin() const { return bytes_.data(); }
+  const uint8_t *end() const { return bytes_.data() + size_; }
+
+  void clear() { size_ = 0; }
+  void resize(size_t size) {
+    size_ = size < FRAME_BUFFER_CAPACITY ? size : FRAME_BUFFER_CAPACITY;
+  }
+
+  std::vector<uint8_t> toVector() const {
+    return std::vector<uint8_t>(begin(), end());
+  }
+
+private:
+  std::array<uint8_t, FRAME_BUFFER_CAPACITY> bytes_{};
+  size_t size_ = 0;
+};
+
+struct FrameSlice {
+  size_t offset = 0;
+  size_t size = 0;
+};
+
+/**
+ * Reusable contiguous storage for a batch of framed messages written back to
+ * back, with an offset/length table. Capacity is retained across clear(), so
+ * a steady-state batch does not touch the heap.
+ */
+class FrameArena {
+public:
+  void clear() {
+    used_ = 0;
+    frames_.clear();
+  }
+  void reserve(size_t frame_count) {
+    frames_.reserve(frame_count);
+    if (bytes_.size() < frame_count * FRAME_BUFFER_CAPACITY) {
+      bytes_.resize(frame_count * FRAME_BUFFER_CAPACITY);
+    }
+  }
+
+  // Returns room for one worst-case frame; finish it with commitFrame().
+  uint8_t *beginFrame() {
+    if (bytes_.size() < used_ + FRAME_BUFFER_CAPACITY) {
+      bytes_.resize(used_ + FRAME_BUFFER_CAPACITY);
+    }
+    return bytes_.data() + used_;
+  }
+  void commitFrame(size_t size) {
+    frames_.push_back(FrameSlice{used_, size});
+    used_ += size;
+  }
+
+  const uint8_t *data() const { return bytes_.data(); }
+  size_t size() const { return used_; }
+  bool empty() const { return frames_.empty(); }
+  size_t frameCount() const { return frames_.size(); }
+  const std::vector<FrameSlice> &frames() const { return frames_; }
+  const uint8_t *frameData(size_t index) const {
+    return bytes_.data() + frames_[index].offset;
+  }
+  size_t frameSize(size_t index) const { return frames_[index].size; }
+
+private:
+  std::vector<uint8_t> bytes_;
+  std::vector<FrameSlice> frames_;
+  size_t used_ = 0;
+};
+
+} // namespace gdl90
+
+#endif // XP2GDL90_FRAME_BUFFER_H
@@ -0,0 +1,108 @@
+#ifndef XP2GDL90_FRAME_POOL_H
+#define XP2GDL90_FRAME_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "xp2gdl90/frame_buffer.h"
+
+namespace gdl90 {
+
+// Blocks start on their own cache line, so a block the sender thread
+// releases never shares a line with one the simulator thread is encoding.
+constexpr size_t FRAME_POOL_BLOCK_ALIGN = 64;
+constexpr size_t FRAME_POOL_DEFAULT_BLOCKS = 128;
+
+class FramePool;
+
+struct alignas(FRAME_POOL_BLOCK_ALIGN) FramePoolBlock {
+  FrameBuffer frame;
+  std::atomic<uint32_t> refs{0};
+  // The next free block while this one is free.
+  std::atomic<uint32_t> next{0};
+  uint32_t index = 0;
+};
+
+/**
+ * A counted reference to one pooled frame. Copies share the block, from
+ * any thread; the last reference to go returns it to its pool.
+ */
+class FrameRef {
+public:
+  FrameRef() = default;
+  FrameRef(const FrameRef &other);
+  FrameRef(FrameRef &&other) noexcept;
+  FrameRef &operator=(const FrameRef &other);
+  FrameRef &operator=(FrameRef &&other) noexcept;
+  ~FrameRef() { reset(); }
+
+  explicit operator bool() const { return block_ != nullptr; }
+  const uint8_t *data() const { return block_->frame.data(); }
+  size_t size() const { return block_->frame.size(); }
+  // For an encoder to write into, while this is the only reference.
+  FrameBuffer *buffer() { return block_ ? &block_->frame : nullptr; }
+  uint32_t useCount() const {
+    return block_ ? block_->refs.load(std::memory_order_relaxed) : 0;
+  }
+
+  void reset();
+
+private:
+  friend class FramePool;
+  FrameRef(FramePool *pool, FramePoolBlock *block)
+      : pool_(pool), block_(block) {}
+
+  FramePool *pool_ = nullptr;
+  FramePoolBlock *block_ = nullptr;
+};
+
+struct FramePoolStats {
+  size_t capacity = 0;
+  size_t available = 0;
+  uint64_t acquired = 0;
+  // acquire() calls that found every block in use.
+  uint64_t exhausted = 0;
+};
+
+/**
+ * A fixed set of frame blocks handed out as FrameRefs and recycled through
+ * a lock-free free list, so a frame encoded into one reaches the sender
+ * thread, and each destination it goes to, without a copy or an
+ * allocation. Any thread may acquire and release. Every reference must be
+ * gone before the pool is destroyed.
+ */
+class FramePool {
+public:
+  explicit FramePool(size_t blocks = FRAME_POOL_DEFAULT_BLOCKS);
+
+  FramePool(const FramePool &) = delete;
+  FramePool &operator=(const FramePool &) = delete;
+
+  // A cleared block, or an empty reference when every block is in use.
+  FrameRef acquire();
+
+  size_t capacity() const { return capacity_; }
+  size_t available() const {
+    return available_.load(std::memory_order_relaxed);
+  }
+  FramePoolStats stats() const;
+
+private:
+  friend class FrameRef;
+  void release(FramePoolBlock *block);
+
+  std::unique_ptr<FramePoolBlock[]> blocks_;
+  size_t capacity_ = 0;
+  // The free list's first block in the low half, and a count of pops in
+  // the high half so a block popped and pushed back in between is seen.
+  std::atomic<uint64_t> head_{0};
+  std::atomic<size_t> available_{0};
+  std::atomic<uint64_t> acquired_{0};
+  std::atomic<uint64_t> exhausted_{0};
+};
+
+} // namespace gdl90
+
+#endif // XP2GDL90_FRAME_POOL_H
@@ -0,0 +1,81 @@
+#ifndef XP2GDL90_GDL90_DECODER_H
+#define XP2GDL90_GDL90_DECODER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "xp2gdl90/foreflight_encoder.h"
+#include "xp2gdl90/gdl90_encoder.h"
+
+/**
+ * Walks a buffer of concatenated GDL90 frames, e.g. a capture or a packed
+ * datagram, and decodes the messages this project emits. Frames without
+ * escapes are returned in place; only stuffed frames are copied, into a
+ * scratch buffer owned by the decoder.
+ */
+
+namespace gdl90 {
+
+// Largest unstuffed frame, payload plus CRC, the decoder accepts. Covers
+// every message in the interface document, uplink data included.
+constexpr size_t DECODER_MAX_FRAME = 512;
+
+// A checked payload without flags, escapes or CRC. It points into the
+// input or the decoder's scratch, and is valid until the next call to
+// Decoder::next() or reset().
+struct FrameSpan {
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+
+  uint8_t messageId() const { return size > 0 ? data[0] : 0; }
+};
+
+struct HeartbeatData {
+  bool gps_valid = false;
+  bool utc_ok = false;
+  // Seconds since UTC midnight.
+  uint32_t timestamp = 0;
+};
+
+class Decoder {
+public:
+  Decoder() = default;
+  Decoder(const uint8_t *data, size_t size) { reset(data, size); }
+
+  // Starts over on `data`, which must outlive the frames returned from it.
+  void reset(const uint8_t *data, size_t size);
+  // Advances to the next frame whose CRC checks. False once the input is
+  // exhausted; a trailing frame without its closing flag is left unread.
+  bool next(FrameSpan *out);
+
+  // Counts accumulate across reset().
+  uint64_t frames() const { return frames_; }
+  uint64_t crcErrors() const { return crc_errors_; }
+  // Frames with a dangling escape, or too short or long to hold a message.
+  uint64_t malformed() const { return malformed_; }
+
+private:
+  // Removes the escapes from `size` frame bytes into scratch_.
+  bool unstuff(const uint8_t *bytes, size_t size, size_t *out_size);
+
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  size_t position_ = 0;
+  std::array<uint8_t, DECODER_MAX_FRAME> scratch_{};
+  uint64_t frames_ = 0;
+  uint64_t crc_errors_ = 0;
+  uint64_t malformed_ = 0;
+};
+
+// Each returns false when the span holds a different or truncated message.
+// Values come back at wire resolution, with the encoder's invalid markers.
+bool DecodeHeartbeat(const FrameSpan &frame, HeartbeatData *out);
+// Ownship (0x0A) and traffic (0x14) reports.
+bool DecodePositionReport(const FrameSpan &frame, PositionData *out);
+bool DecodeGeoAltitude(const FrameSpan &frame, GeoAltitudeData *out);
+bool DecodeAhrs(const FrameSpan &frame, foreflight::AhrsData *out);
+
+} // namespace gdl90
+
+#endif // XP2GDL90_GDL90_DECODER_H
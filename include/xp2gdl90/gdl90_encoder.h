@@ -4,9 +4,13 @@
 #include <cstdint>
 #include <functional>
 #include <limits>
-#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "xp2gdl90/callsign.h"
+#include "xp2gdl90/frame_buffer.h"
+
 /**
  * GDL90 Data Interface Encoder
  * Implements the Garmin GDL90 protocol for ADS-B data transmission.
@@ -15,6 +19,16 @@
 
 namespace gdl90 {
 
+namespace internal {
+class PayloadBuffer;
+} // namespace internal
+namespace layout {
+struct PositionReportFields;
+} // namespace layout
+
+class CachedFrame;
+class TrafficFrameCache;
+
 using UtcTimeProvider = std::function<uint32_t()>;
 using CheckedUtcTimeProvider = std::function<bool(uint32_t *)>;
 
@@ -23,6 +37,9 @@ constexpr uint8_t MSG_ID_OWNSHIP_REPORT = 0x0A;
 constexpr uint8_t MSG_ID_OWNSHIP_GEO_ALTITUDE = 0x0B;
 constexpr uint8_t MSG_ID_TRAFFIC_REPORT = 0x14;
 
+// Unframed traffic report: message ID and 27 bytes of fields.
+constexpr size_t TRAFFIC_PAYLOAD_SIZE = 28;
+
 constexpr uint16_t ALTITUDE_INVALID = 0xFFF;
 constexpr uint16_t VELOCITY_INVALID = 0xFFF;
 constexpr uint16_t VVELOCITY_INVALID = 0x800;
@@ -74,13 +91,16 @@ struct PositionData {
   uint8_t nic = 0;
   uint8_t nacp = 0;
   uint32_t icao_address = 0;
-  std::string callsign;
+  Callsign callsign;
   EmitterCategory emitter_category = EmitterCategory::NO_INFO;
   AddressType address_type = AddressType::ADSB_ICAO;
   uint8_t alert_status = 0;
   uint8_t emergency_code = 0;
 };
 
+static_assert(std::is_trivially_copyable<PositionData>::value,
+              "reports are copied into column buffers and rings");
+
 struct GeoAltitudeData {
   int32_t altitude_feet = 0;
   bool vertical_warning = false;
@@ -101,22 +121,116 @@ public:
   createOwnshipGeometricAltitude(const GeoAltitudeData &data) const;
   std::vector<uint8_t> createTrafficReport(const PositionData &data) const;
 
+  // Allocation-free variants: overwrite `out` and return the framed size.
+  size_t encodeHeartbeatInto(bool gps_valid, bool utc_ok,
+                             FrameBuffer &out) const;
+  size_t encodeOwnshipReportInto(const PositionData &data,
+                                 FrameBuffer &out) const;
+  size_t encodeOwnshipGeometricAltitudeInto(const GeoAltitudeData &data,
+                                            FrameBuffer &out) const;
+  size_t encodeTrafficReportInto(const PositionData &data,
+                                 FrameBuffer &out) const;
+
+  // Cached variants: the heartbeat patches only its status and timestamp
+  // bytes into `cache`; geo-altitude reuses the frame while unchanged.
+  size_t encodeHeartbeatInto(bool gps_valid, bool utc_ok,
+                             CachedFrame &cache) const;
+  // The ownship report keeps the address, emitter category, callsign and
+  // emergency code held in `cache` and patches only latitude through track.
+  // Invalidate the cache when any of those held fields change.
+  size_t encodeOwnshipReportInto(const PositionData &data,
+                                 CachedFrame &cache) const;
+  size_t encodeOwnshipGeometricAltitudeInto(const GeoAltitudeData &data,
+                                            CachedFrame &cache) const;
+
+  // Heartbeats for a time the caller already has: `utc_time` is seconds
+  // since UTC midnight, or null when there is none.
+  size_t encodeHeartbeatAt(bool gps_valid, bool utc_ok,
+                           const uint32_t *utc_time, FrameBuffer &out) const;
+  size_t encodeHeartbeatAt(bool gps_valid, bool utc_ok,
+                           const uint32_t *utc_time, CachedFrame &cache) const;
+
+  // Encodes `count` traffic reports back to back into `arena` (cleared
+  // first) and returns the number of frames written.
+  size_t encodeTrafficBatch(const PositionData *reports, size_t count,
+                            FrameArena &arena) const;
+  // As above, reusing the previous frame of any target in `cache` whose
+  // report is unchanged at wire resolution.
+  size_t encodeTrafficBatch(const PositionData *reports, size_t count,
+                            FrameArena &arena,
+                            TrafficFrameCache *cache) const;
+  // The two halves of encodeTrafficBatch, for callers that pack on several
+  // threads. Packing writes TRAFFIC_PAYLOAD_SIZE bytes per report to `out`
+  // and may run concurrently; framing the packed payloads gives the same
+  // arena as encodeTrafficBatch.
+  void packTrafficPayloads(const PositionData *reports, size_t count,
+                           uint8_t *out) const;
+  size_t frameTrafficPayloads(const PositionData *reports,
+                              const uint8_t *payloads, size_t count,
+                              FrameArena &arena,
+                              TrafficFrameCache *cache) const;
+
 private:
   CheckedUtcTimeProvider utc_time_provider_;
 
-  uint32_t encodeLatitude(double latitude) const;
-  uint32_t encodeLongitude(double longitude) const;
-  uint16_t encodeAltitude(int32_t altitude) const;
-  uint16_t encodeVerticalVelocity(int16_t vv_fpm) const;
-  uint8_t encodeTrack(uint16_t track) const;
   int16_t encodeGeoAltitude(int32_t altitude_feet) const;
-  uint16_t encodeGeoVerticalMetrics(bool vertical_warning,
-                                    uint16_t vfom_meters) const;
-  std::vector<uint8_t> createPositionReport(uint8_t msg_id,
-                                            const PositionData &data) const;
+  uint16_t encodeGeoVfom(uint16_t vfom_meters) const;
+  void encodeHeartbeatStatus(bool gps_valid, bool utc_ok,
+                             const uint32_t *utc_time, uint8_t *out) const;
+  void encodeGeoAltitudePayload(const GeoAltitudeData &data,
+                                internal::PayloadBuffer &payload) const;
+  // Every position field except those the field kernels convert.
+  void fillPositionFields(uint8_t msg_id, const PositionData &data,
+                          layout::PositionReportFields &fields) const;
+  // Packs one chunk of reports at a time through the field kernels.
+  void packTrafficChunk(const PositionData *reports, size_t count,
+                        uint8_t *out) const;
+  void encodePositionPayload(uint8_t msg_id, const PositionData &data,
+                             internal::PayloadBuffer &payload) const;
+  size_t encodePositionReportInto(uint8_t msg_id, const PositionData &data,
+                                  FrameBuffer &out) const;
   bool getUTCTime(uint32_t *out_time) const;
 };
 
+/**
+ * An encoder whose heartbeat time source is a type rather than a
+ * CheckedUtcTimeProvider, so the call inlines. TimeSource is callable as
+ * bool(uint32_t *) and is called once per heartbeat; see SteadyUtcClock.
+ * Everything else is GDL90Encoder's.
+ */
+template <typename TimeSource> class TimedGDL90Encoder : public GDL90Encoder {
+public:
+  explicit TimedGDL90Encoder(TimeSource time_source = TimeSource())
+      : time_source_(std::move(time_source)) {}
+
+  std::vector<uint8_t> createHeartbeat(bool gps_valid = true,
+                                       bool utc_ok = true) const {
+    FrameBuffer frame;
+    encodeHeartbeatInto(gps_valid, utc_ok, frame);
+    return frame.toVector();
+  }
+  size_t encodeHeartbeatInto(bool gps_valid, bool utc_ok,
+                             FrameBuffer &out) const {
+    uint32_t utc_time = 0;
+    return encodeHeartbeatAt(gps_valid, utc_ok,
+                             time_source_(&utc_time) ? &utc_time : nullptr,
+                             out);
+  }
+  size_t encodeHeartbeatInto(bool gps_valid, bool utc_ok,
+                             CachedFrame &cache) const {
+    uint32_t utc_time = 0;
+    return encodeHeartbeatAt(gps_valid, utc_ok,
+                             time_source_(&utc_time) ? &utc_time : nullptr,
+                             cache);
+  }
+
+  TimeSource &timeSource() { return time_source_; }
+
+private:
+  // Heartbeats are const; a caching source updates itself on each call.
+  mutable TimeSource time_source_;
+};
+
 } // namespace gdl90
 
 #endif // GDL90_ENCODER_H
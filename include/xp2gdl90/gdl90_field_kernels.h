@@ -0,0 +1,44 @@
+#ifndef XP2GDL90_GDL90_FIELD_KERNELS_H
+#define XP2GDL90_GDL90_FIELD_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Fixed-point conversions of position report fields to their wire values.
+ * The single-value forms define the encoding; the batch forms convert
+ * whole columns and match them bit for bit. The batches use SSE2 on x86_64
+ * and NEON on arm64; the scalar variants are kept as references and for
+ * other targets.
+ */
+
+namespace gdl90 {
+
+// 24-bit two's complement semicircles, clamped to +/-90 and +/-180 degrees.
+uint32_t EncodeLatitude(double degrees);
+uint32_t EncodeLongitude(double degrees);
+// 12-bit, 25 ft steps offset by -1000 ft; INT32_MIN encodes as invalid.
+uint16_t EncodeAltitude(int32_t feet);
+// 12-bit two's complement, 64 fpm steps; INT16_MIN encodes as invalid.
+uint16_t EncodeVerticalVelocity(int16_t fpm);
+// 8-bit, 360/256 degree steps.
+uint8_t EncodeTrack(uint16_t degrees);
+
+// Each converts `count` values from `in` into `out`.
+void EncodeLatitudes(const double *in, size_t count, uint32_t *out);
+void EncodeLongitudes(const double *in, size_t count, uint32_t *out);
+void EncodeAltitudes(const int32_t *in, size_t count, uint16_t *out);
+void EncodeVerticalVelocities(const int16_t *in, size_t count,
+                              uint16_t *out);
+void EncodeTracks(const uint16_t *in, size_t count, uint8_t *out);
+
+void EncodeLatitudesScalar(const double *in, size_t count, uint32_t *out);
+void EncodeLongitudesScalar(const double *in, size_t count, uint32_t *out);
+void EncodeAltitudesScalar(const int32_t *in, size_t count, uint16_t *out);
+void EncodeVerticalVelocitiesScalar(const int16_t *in, size_t count,
+                                    uint16_t *out);
+void EncodeTracksScalar(const uint16_t *in, size_t count, uint8_t *out);
+
+} // namespace gdl90
+
+#endif // XP2GDL90_GDL90_FIELD_KERNELS_H
@@ -0,0 +1,31 @@
+#ifndef XP2GDL90_GDL90_FRAMING_H
+#define XP2GDL90_GDL90_FRAMING_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "xp2gdl90/frame_buffer.h"
+
+/**
+ * GDL90 frame assembly: CRC, 0x7D byte stuffing and 0x7E flags.
+ * The vectorized scan uses SSE2 on x86_64 and NEON on arm64; the scalar
+ * variants are kept as references and for other targets.
+ */
+
+namespace gdl90 {
+
+constexpr uint8_t FRAME_FLAG = 0x7E;
+constexpr uint8_t FRAME_ESCAPE = 0x7D;
+
+// Returns the index of the first 0x7D/0x7E byte, or `size` if none.
+size_t FindEscapeByte(const uint8_t *data, size_t size);
+size_t FindEscapeByteScalar(const uint8_t *data, size_t size);
+
+// Writes the framed message into `out`, which must hold
+// MaxFrameSize(size) bytes. Returns the framed length.
+size_t FrameMessage(const uint8_t *payload, size_t size, uint8_t *out);
+size_t FrameMessageScalar(const uint8_t *payload, size_t size, uint8_t *out);
+
+} // namespace gdl90
+
+#endif // XP2GDL90_GDL90_FRAMING_H
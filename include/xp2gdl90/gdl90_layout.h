@@ -0,0 +1,215 @@
+#ifndef XP2GDL90_GDL90_LAYOUT_H
+#define XP2GDL90_GDL90_LAYOUT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Compile-time bit layouts of GDL90 message payloads. Each field is a
+ * big-endian run of bits counted from the most significant bit of the
+ * message ID byte, as drawn in the ICD tables. put() and get() have
+ * constant bounds, so the compiler emits the same shifts and masks that
+ * were previously written by hand.
+ */
+
+namespace gdl90::layout {
+
+template <size_t Offset, size_t Width> struct Field {
+  static_assert(Width >= 1 && Width <= 32, "fields are 1 to 32 bits");
+
+  static constexpr size_t OFFSET = Offset;
+  static constexpr size_t WIDTH = Width;
+  static constexpr size_t END = Offset + Width;
+  static constexpr size_t FIRST_BYTE = Offset / 8;
+  static constexpr size_t LAST_BYTE = (END - 1) / 8;
+  static constexpr uint32_t MASK =
+      Width == 32 ? 0xFFFFFFFFu : ((uint32_t{1} << Width) - 1u);
+
+  // ORs the low WIDTH bits of `value` into `bytes`, which must be zero
+  // over the field.
+  static constexpr void put(uint8_t *bytes, uint32_t value) {
+    const uint64_t bits = value & MASK;
+    for (size_t byte = FIRST_BYTE; byte <= LAST_BYTE; ++byte) {
+      // Bits of `value` that land in this byte, aligned to its LSB.
+      const size_t byte_end = (byte + 1) * 8;
+      const uint64_t part = byte_end >= END ? bits << (byte_end - END)
+                                            : bits >> (END - byte_end);
+      bytes[byte] |= static_cast<uint8_t>(part);
+    }
+  }
+
+  static constexpr uint32_t get(const uint8_t *bytes) {
+    uint64_t bits = 0;
+    for (size_t byte = FIRST_BYTE; byte <= LAST_BYTE; ++byte) {
+      bits = (bits << 8) | bytes[byte];
+    }
+    return static_cast<uint32_t>((bits >> ((LAST_BYTE + 1) * 8 - END)) & MASK);
+  }
+
+  // get() read as a WIDTH-bit two's complement value.
+  static constexpr int32_t getSigned(const uint8_t *bytes) {
+    const uint32_t value = get(bytes);
+    const uint32_t sign = uint32_t{1} << (Width - 1);
+    return static_cast<int32_t>(static_cast<int64_t>(value ^ sign) -
+                                static_cast<int64_t>(sign));
+  }
+};
+
+// A run of whole bytes copied as is, e.g. the callsign.
+template <size_t ByteOffset, size_t Count> struct Bytes {
+  static constexpr size_t BYTE = ByteOffset;
+  static constexpr size_t COUNT = Count;
+  static constexpr size_t OFFSET = ByteOffset * 8;
+  static constexpr size_t END = (ByteOffset + Count) * 8;
+};
+
+// True when the fields, in order, cover [0, bits) with no gap or overlap.
+template <typename... Fields> constexpr bool Tiles(size_t bits) {
+  constexpr size_t offsets[] = {Fields::OFFSET...};
+  constexpr size_t ends[] = {Fields::END...};
+  size_t next = 0;
+  for (size_t i = 0; i < sizeof...(Fields); ++i) {
+    if (offsets[i] != next) {
+      return false;
+    }
+    next = ends[i];
+  }
+  return next == bits;
+}
+
+// Traffic and Ownship Report (ICD 3.5.1), message IDs 0x14 and 0x0A.
+struct PositionReport {
+  static constexpr size_t SIZE = 28;
+
+  using MessageId = Field<0, 8>;
+  using AlertStatus = Field<8, 4>;
+  using AddressType = Field<12, 4>;
+  using Address = Field<16, 24>;
+  using Latitude = Field<40, 24>;
+  using Longitude = Field<64, 24>;
+  using Altitude = Field<88, 12>;
+  using Misc = Field<100, 4>;
+  using Nic = Field<104, 4>;
+  using Nacp = Field<108, 4>;
+  using HorizontalVelocity = Field<112, 12>;
+  using VerticalVelocity = Field<124, 12>;
+  using Track = Field<136, 8>;
+  using EmitterCategory = Field<144, 8>;
+  using Callsign = Bytes<19, 8>;
+  using EmergencyCode = Field<216, 4>;
+  using Spare = Field<220, 4>;
+
+  // Latitude through track: the bytes that change from one ownship report
+  // to the next.
+  using Motion = Bytes<5, 13>;
+};
+
+static_assert(PositionReport::Motion::OFFSET ==
+                      PositionReport::Latitude::OFFSET &&
+                  PositionReport::Motion::END == PositionReport::Track::END,
+              "motion bytes must run from latitude through track");
+
+static_assert(Tiles<PositionReport::MessageId, PositionReport::AlertStatus,
+                    PositionReport::AddressType, PositionReport::Address,
+                    PositionReport::Latitude, PositionReport::Longitude,
+                    PositionReport::Altitude, PositionReport::Misc,
+                    PositionReport::Nic, PositionReport::Nacp,
+                    PositionReport::HorizontalVelocity,
+                    PositionReport::VerticalVelocity, PositionReport::Track,
+                    PositionReport::EmitterCategory, PositionReport::Callsign,
+                    PositionReport::EmergencyCode, PositionReport::Spare>(
+                  PositionReport::SIZE * 8),
+              "position report fields must tile the payload");
+
+// Ownship Geometric Altitude (ICD 3.8), message ID 0x0B.
+struct GeoAltitude {
+  static constexpr size_t SIZE = 5;
+
+  using MessageId = Field<0, 8>;
+  using Altitude = Field<8, 16>; // Signed, 5 ft resolution.
+  using VerticalWarning = Field<24, 1>;
+  using Vfom = Field<25, 15>; // Metres.
+};
+
+static_assert(Tiles<GeoAltitude::MessageId, GeoAltitude::Altitude,
+                    GeoAltitude::VerticalWarning, GeoAltitude::Vfom>(
+                  GeoAltitude::SIZE * 8),
+              "geo-altitude fields must tile the payload");
+
+// Raw wire values of a position report, before any unit conversion.
+struct PositionReportFields {
+  uint8_t message_id = 0;
+  uint8_t alert_status = 0;
+  uint8_t address_type = 0;
+  uint32_t address = 0;
+  uint32_t latitude = 0;
+  uint32_t longitude = 0;
+  uint16_t altitude = 0;
+  uint8_t misc = 0;
+  uint8_t nic = 0;
+  uint8_t nacp = 0;
+  uint16_t h_velocity = 0;
+  uint16_t v_velocity = 0;
+  uint8_t track = 0;
+  uint8_t emitter_category = 0;
+  std::array<uint8_t, PositionReport::Callsign::COUNT> callsign{};
+  uint8_t emergency_code = 0;
+};
+
+// Writes PositionReport::SIZE bytes to `out`, which must be zeroed.
+inline void PackPositionReport(const PositionReportFields &fields,
+                               uint8_t *out) {
+  using L = PositionReport;
+  L::MessageId::put(out, fields.message_id);
+  L::AlertStatus::put(out, fields.alert_status);
+  L::AddressType::put(out, fields.address_type);
+  L::Address::put(out, fields.address);
+  L::Latitude::put(out, fields.latitude);
+  L::Longitude::put(out, fields.longitude);
+  L::Altitude::put(out, fields.altitude);
+  L::Misc::put(out, fields.misc);
+  L::Nic::put(out, fields.nic);
+  L::Nacp::put(out, fields.nacp);
+  L::HorizontalVelocity::put(out, fields.h_velocity);
+  L::VerticalVelocity::put(out, fields.v_velocity);
+  L::Track::put(out, fields.track);
+  L::EmitterCategory::put(out, fields.emitter_category);
+  for (size_t i = 0; i < L::Callsign::COUNT; ++i) {
+    out[L::Callsign::BYTE + i] = fields.callsign[i];
+  }
+  L::EmergencyCode::put(out, fields.emergency_code);
+}
+
+// Reads a position report payload. False if it is too short.
+inline bool UnpackPositionReport(const uint8_t *payload, size_t size,
+                                 PositionReportFields *out) {
+  using L = PositionReport;
+  if (!payload || !out || size < L::SIZE) {
+    return false;
+  }
+  out->message_id = static_cast<uint8_t>(L::MessageId::get(payload));
+  out->alert_status = static_cast<uint8_t>(L::AlertStatus::get(payload));
+  out->address_type = static_cast<uint8_t>(L::AddressType::get(payload));
+  out->address = L::Address::get(payload);
+  out->latitude = L::Latitude::get(payload);
+  out->longitude = L::Longitude::get(payload);
+  out->altitude = static_cast<uint16_t>(L::Altitude::get(payload));
+  out->misc = static_cast<uint8_t>(L::Misc::get(payload));
+  out->nic = static_cast<uint8_t>(L::Nic::get(payload));
+  out->nacp = static_cast<uint8_t>(L::Nacp::get(payload));
+  out->h_velocity = static_cast<uint16_t>(L::HorizontalVelocity::get(payload));
+  out->v_velocity = static_cast<uint16_t>(L::VerticalVelocity::get(payload));
+  out->track = static_cast<uint8_t>(L::Track::get(payload));
+  out->emitter_category =
+      static_cast<uint8_t>(L::EmitterCategory::get(payload));
+  for (size_t i = 0; i < L::Callsign::COUNT; ++i) {
+    out->callsign[i] = payload[L::Callsign::BYTE + i];
+  }
+  out->emergency_code = static_cast<uint8_t>(L::EmergencyCode::get(payload));
+  return true;
+}
+
+} // namespace gdl90::layout
+
+#endif // XP2GDL90_GDL90_LAYOUT_H
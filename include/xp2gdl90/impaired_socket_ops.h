@@ -0,0 +1,122 @@
+#ifndef XP2GDL90_IMPAIRED_SOCKET_OPS_H
+#define XP2GDL90_IMPAIRED_SOCKET_OPS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "xp2gdl90/broadcast_clock.h"
+#include "xp2gdl90/udp_broadcaster.h"
+
+/**
+ * A SocketOps decorator that makes the link in front of another one, real
+ * or fake, behave like bad Wi-Fi: added latency and jitter, loss, a capped
+ * link rate with a bounded send buffer, and sends failing outright with a
+ * full buffer. A seeded generator and an injectable clock make a run with
+ * a VirtualClock repeat exactly.
+ */
+
+namespace udp {
+
+struct ImpairmentOptions {
+  // One-way delay added to every datagram.
+  double latency_s = 0.0;
+  // Each delay varies uniformly by up to this much either way, so
+  // datagrams can arrive out of order.
+  double jitter_s = 0.0;
+  // Share of datagrams dropped after the send reported success, 0 to 1.
+  double loss = 0.0;
+  // Share of sends that fail at once with a full send buffer, 0 to 1.
+  double buffer_full = 0.0;
+  // Link rate; 0 or less is unlimited.
+  double bandwidth_bytes_per_s = 0.0;
+  // Bytes waiting for a capped link before sends fail with a full buffer;
+  // 0 is unlimited.
+  size_t send_buffer_bytes = 0;
+  uint32_t seed = 1;
+};
+
+struct ImpairmentStats {
+  uint64_t offered = 0;
+  // Handed on to the inner ops, which may still fail them.
+  uint64_t delivered = 0;
+  uint64_t lost = 0;
+  // Refused with BufferFullError(), injected or from a full send buffer.
+  uint64_t buffer_full = 0;
+  // Delivered ahead of a datagram sent before them.
+  uint64_t reordered = 0;
+  // Delayed datagrams the inner ops failed.
+  uint64_t inner_errors = 0;
+  size_t max_queued_bytes = 0;
+};
+
+// What LastError() reports for a full send buffer: WSAEWOULDBLOCK on
+// Windows, ENOBUFS elsewhere.
+int BufferFullError();
+
+class ImpairedSocketOps final : public detail::SocketOps {
+public:
+  // `inner` and `clock` must outlive this; a null clock is the system
+  // clock.
+  explicit ImpairedSocketOps(detail::SocketOps *inner,
+                             xp2gdl90::Clock *clock = nullptr);
+
+  // Restarts the generator from the options' seed. Queued datagrams keep
+  // their delivery times.
+  void setOptions(const ImpairmentOptions &options);
+  const ImpairmentOptions &options() const { return options_; }
+  // Hands the inner ops every datagram whose delay has passed and returns
+  // how many. Each send does this first; call it while idle too.
+  size_t pump();
+  size_t queued() const { return queue_.size(); }
+  size_t queuedBytes() const { return queued_bytes_; }
+  const ImpairmentStats &stats() const { return stats_; }
+
+  int Startup() override;
+  void Cleanup() override;
+  uintptr_t CreateSocket(int domain, int type, int protocol) override;
+  int SetSockOpt(uintptr_t socket, int level, int optname, const void *optval,
+                 size_t optlen) override;
+  int InetPton(int af, const char *src, void *dst) override;
+  int Bind(uintptr_t socket, const void *addr, size_t addrlen) override;
+  intptr_t SendTo(uintptr_t socket, const void *buf, size_t len, int flags,
+                  const void *dest_addr, size_t addrlen) override;
+  // Drops the socket's queued datagrams, which could no longer leave.
+  int CloseSocket(uintptr_t socket) override;
+  int LastError() override;
+
+private:
+  struct Pending {
+    double due = 0.0;
+    uint64_t sequence = 0;
+    uintptr_t socket = 0;
+    int flags = 0;
+    std::vector<uint8_t> data;
+    std::array<uint8_t, 32> addr{};
+    size_t addrlen = 0;
+  };
+
+  // Orders the queue as a min-heap on (due, sequence).
+  static bool dueLater(const Pending &a, const Pending &b);
+  double nextUnit();
+  void deliver(const Pending &pending);
+
+  detail::SocketOps *inner_;
+  xp2gdl90::Clock *clock_;
+  ImpairmentOptions options_;
+  ImpairmentStats stats_;
+  std::vector<Pending> queue_;
+  size_t queued_bytes_ = 0;
+  uint64_t next_sequence_ = 0;
+  uint64_t last_delivered_ = 0;
+  bool has_delivered_ = false;
+  // When the capped link finishes the bytes already handed to it.
+  double link_free_at_ = 0.0;
+  uint32_t random_state_ = 1;
+  int injected_error_ = 0;
+};
+
+} // namespace udp
+
+#endif // XP2GDL90_IMPAIRED_SOCKET_OPS_H
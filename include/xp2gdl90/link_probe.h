@@ -0,0 +1,129 @@
+#ifndef XP2GDL90_LINK_PROBE_H
+#define XP2GDL90_LINK_PROBE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "xp2gdl90/frame_buffer.h"
+#include "xp2gdl90/gdl90_decoder.h"
+#include "xp2gdl90/stage_timing.h"
+
+/**
+ * Measures what of the stream reaches a receiver. With link_probe on, the
+ * sender closes every tick that sent anything with a vendor-specific mark
+ * carrying a sequence number and the send time; xp2gdl90_probe listens
+ * where the EFB would and reports arrival rates, inter-arrival jitter,
+ * missed heartbeats, traffic update age, lost marks and queueing delay.
+ */
+
+namespace xp2gdl90 {
+
+// Unassigned in the GDL90 and ForeFlight documents, so EFBs skip it.
+constexpr uint8_t MSG_ID_LINK_PROBE = 0x58;
+constexpr uint8_t LINK_PROBE_VERSION = 1;
+
+struct LinkProbeMark {
+  uint32_t sequence = 0;
+  // Wall clock, microseconds since the epoch.
+  int64_t send_time_us = 0;
+};
+
+// Frames `mark` into `out`. Returns the framed length.
+size_t EncodeLinkProbe(const LinkProbeMark &mark, gdl90::FrameBuffer &out);
+bool DecodeLinkProbe(const gdl90::FrameSpan &frame, LinkProbeMark *out);
+
+enum class ProbeClass : uint8_t {
+  HEARTBEAT = 0,
+  OWNSHIP = 1,
+  GEO_ALTITUDE = 2,
+  TRAFFIC = 3,
+  FOREFLIGHT_ID = 4,
+  AHRS = 5,
+  LINK_PROBE = 6,
+  OTHER = 7,
+};
+constexpr size_t PROBE_CLASS_COUNT = 8;
+const char *ProbeClassName(ProbeClass probe_class);
+ProbeClass ClassifyFrame(const gdl90::FrameSpan &frame);
+
+struct ProbeClassStats {
+  uint64_t frames = 0;
+  // Time between arrivals of the class.
+  LatencyHistogram interval;
+  double interval_sum_s = 0.0;
+  double interval_sum_sq_s = 0.0;
+
+  double meanIntervalS() const;
+  // Standard deviation of the interval.
+  double jitterS() const;
+};
+
+struct LinkProbeStats {
+  uint64_t datagrams = 0;
+  uint64_t bytes = 0;
+  uint64_t bad_frames = 0;
+  std::array<ProbeClassStats, PROBE_CLASS_COUNT> classes{};
+  // Heartbeat periods that passed without one.
+  uint64_t missed_heartbeats = 0;
+  // Time since the previous report of the same address.
+  LatencyHistogram traffic_age;
+  size_t traffic_targets = 0;
+  uint64_t marks = 0;
+  // Sequence numbers skipped, less those that arrived late.
+  uint64_t marks_lost = 0;
+  uint64_t marks_late = 0;
+  // One-way delay above the lowest seen so far, which leaves out the
+  // offset between the two clocks.
+  LatencyHistogram delay;
+  int64_t min_delay_us = 0;
+  double elapsed_s = 0.0;
+
+  const ProbeClassStats &of(ProbeClass probe_class) const {
+    return classes[static_cast<size_t>(probe_class)];
+  }
+};
+
+struct LinkProbeOptions {
+  double heartbeat_period_s = 1.0;
+};
+
+class LinkProbe {
+public:
+  explicit LinkProbe(const LinkProbeOptions &options = LinkProbeOptions())
+      : options_(options) {}
+
+  // Decodes one datagram. `arrival_ns` is a monotonic clock for intervals;
+  // `arrival_wall_us` is the wall clock the marks' send times compare to.
+  void receiveDatagram(const uint8_t *data, size_t size, int64_t arrival_ns,
+                       int64_t arrival_wall_us);
+  void reset();
+
+  const LinkProbeStats &stats() const { return stats_; }
+
+private:
+  void receiveFrame(const gdl90::FrameSpan &frame, int64_t arrival_ns,
+                    int64_t arrival_wall_us);
+  void receiveMark(const LinkProbeMark &mark, int64_t arrival_wall_us);
+
+  LinkProbeOptions options_;
+  LinkProbeStats stats_;
+  gdl90::Decoder decoder_;
+  std::array<int64_t, PROBE_CLASS_COUNT> last_arrival_ns_{};
+  std::array<bool, PROBE_CLASS_COUNT> seen_{};
+  std::unordered_map<uint32_t, int64_t> last_traffic_ns_;
+  int64_t first_arrival_ns_ = 0;
+  bool has_mark_ = false;
+  uint32_t next_sequence_ = 0;
+};
+
+// A plain-text summary: one line per class with its rate and interval
+// percentiles, then heartbeat, traffic and mark lines. With `buckets`, the
+// non-empty histogram buckets follow each percentile line.
+std::string FormatLinkProbeReport(const LinkProbeStats &stats, bool buckets);
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_LINK_PROBE_H
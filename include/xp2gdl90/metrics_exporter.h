@@ -0,0 +1,102 @@
+#ifndef XP2GDL90_METRICS_EXPORTER_H
+#define XP2GDL90_METRICS_EXPORTER_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xp2gdl90/broadcast_clock.h"
+#include "xp2gdl90/simple_json.h"
+#include "xp2gdl90/stage_timing.h"
+#include "xp2gdl90/udp_broadcaster.h"
+
+/**
+ * Periodic link health report for a fleet monitoring collector. Every
+ * interval the front end fills one MetricsReport and the exporter sends it as
+ * a single JSON datagram on its own UDP socket, so an absent or slow
+ * collector never reaches the GDL90 destinations.
+ */
+
+namespace xp2gdl90 {
+
+constexpr uint32_t METRICS_REPORT_VERSION = 1;
+
+// Builds one report:
+//   {"type":"xp2gdl90.metrics","version":1,"source":...,"seq":N,
+//    "interval_s":S,"metrics":{"name":value,...}}
+// Counters are {"total":T,"rate":R} with R per second since the previous
+// report; histograms are {"count","p50_us","p90_us","p99_us","max_us",
+// "buckets":[[upper_ns,count],...]} over their non-empty buckets.
+class MetricsReport {
+public:
+  // Starts a report at `now` (monotonic seconds).
+  void begin(const std::string &source, double now);
+  // Counters must be added in the same order in every report, since rates
+  // pair each one with its predecessor by position.
+  void counter(const char *name, uint64_t total);
+  void gauge(const char *name, double value);
+  void histogram(const char *name, const LatencyHistogram &histogram);
+  const std::string &finish();
+
+  const std::string &text() const { return writer_.text(); }
+  uint64_t sequence() const { return sequence_; }
+
+private:
+  // Reused from report to report, so steady-state reports do not allocate.
+  json::Writer writer_;
+  std::vector<uint64_t> previous_counters_;
+  size_t counter_index_ = 0;
+  double previous_time_ = NAN;
+  double interval_s_ = 0.0;
+  uint64_t sequence_ = 0;
+};
+
+// Adds a "sends.<class>" counter per message class. These count send
+// intervals, which differ from sends only by one per schedule restart.
+void AddSendIntervalMetrics(const SendIntervalTable &intervals,
+                            MetricsReport *report);
+// Adds a "tick.<stage>" histogram per flight loop stage.
+void AddStageTimingMetrics(const StageTimings &timings, MetricsReport *report);
+
+class MetricsExporter {
+public:
+  explicit MetricsExporter(udp::detail::SocketOps *socket_ops = nullptr)
+      : socket_ops_(socket_ops) {}
+
+  // Opens the socket to the collector; reports go out every `interval_s`.
+  bool open(const std::string &ip, uint16_t port, double interval_s,
+            std::string *out_error);
+  void close();
+  bool isOpen() const { return broadcaster_ != nullptr; }
+  const std::string &ip() const { return ip_; }
+  uint16_t port() const { return port_; }
+  double intervalS() const { return interval_s_; }
+
+  // True once `now` reaches the next report time.
+  bool due(double now) const { return isOpen() && now >= next_report_; }
+  // Starts the report for `now` and schedules the next one.
+  MetricsReport &begin(const std::string &source, double now);
+  // Finishes and sends the report. Failures are counted, not retried.
+  bool send(std::string *out_error);
+
+  uint64_t reportsSent() const { return reports_sent_; }
+  uint64_t sendErrors() const { return send_errors_; }
+
+private:
+  udp::detail::SocketOps *socket_ops_;
+  std::unique_ptr<udp::UDPBroadcaster> broadcaster_;
+  MetricsReport report_;
+  std::string ip_;
+  uint16_t port_ = 0;
+  double interval_s_ = 0.0;
+  double next_report_ = 0.0;
+  uint64_t reports_sent_ = 0;
+  uint64_t send_errors_ = 0;
+};
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_METRICS_EXPORTER_H
@@ -0,0 +1,98 @@
+#ifndef XP2GDL90_MPSC_RING_H
+#define XP2GDL90_MPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace xp2gdl90 {
+
+/**
+ * Bounded lock-free ring for any number of producer threads and one
+ * consumer thread. Each slot carries a sequence number that says whether it
+ * is free for the producer that claimed its position or holds a value for
+ * the consumer, so producers never wait on each other or on the consumer. A
+ * full ring drops the new value and counts it.
+ */
+template <typename T> class MpscRing {
+public:
+  explicit MpscRing(size_t capacity)
+      : capacity_(RoundUpPowerOfTwo(capacity)), mask_(capacity_ - 1),
+        slots_(std::make_unique<Slot[]>(capacity_)) {
+    for (size_t i = 0; i < capacity_; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpscRing(const MpscRing &) = delete;
+  MpscRing &operator=(const MpscRing &) = delete;
+
+  size_t capacity() const { return capacity_; }
+
+  // Any thread. Returns false, dropping `value`, when the ring is full.
+  bool push(const T &value) {
+    size_t position = head_.load(std::memory_order_relaxed);
+    Slot *slot = nullptr;
+    for (;;) {
+      slot = &slots_[position & mask_];
+      const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const auto lag = static_cast<std::ptrdiff_t>(sequence - position);
+      if (lag == 0) {
+        if (head_.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (lag < 0) {
+        // The consumer has not released this slot from the previous lap.
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else {
+        position = head_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->value = value;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer thread only. Values from one producer come out in push order.
+  bool pop(T *out) {
+    Slot &slot = slots_[tail_ & mask_];
+    if (slot.sequence.load(std::memory_order_acquire) != tail_ + 1) {
+      return false;
+    }
+    *out = slot.value;
+    slot.sequence.store(tail_ + capacity_, std::memory_order_release);
+    ++tail_;
+    return true;
+  }
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  struct Slot {
+    std::atomic<size_t> sequence{0};
+    T value{};
+  };
+
+  static size_t RoundUpPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  size_t capacity_;
+  size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  // Separate cache lines so producers do not false-share with the consumer.
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) size_t tail_ = 0;
+  std::atomic<uint64_t> dropped_{0};
+};
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_MPSC_RING_H
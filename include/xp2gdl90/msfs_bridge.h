@@ -1,11 +1,19 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <type_traits>
+#include <vector>
 
+#include "xp2gdl90/callsign.h"
 #include "xp2gdl90/foreflight_encoder.h"
 #include "xp2gdl90/gdl90_encoder.h"
 #include "xp2gdl90/settings.h"
+#include "xp2gdl90/track_table.h"
+#include "xp2gdl90/traffic_build.h"
+#include "xp2gdl90/traffic_selection.h"
+#include "xp2gdl90/traffic_snapshot.h"
 
 // Portable computation helpers for the MSFS SimConnect bridge.
 // This header is intentionally free of Windows/SimConnect dependencies so the
@@ -26,7 +34,7 @@ struct OwnshipData {
   double indicated_airspeed_kt = 0.0;
   double true_airspeed_kt = 0.0;
   bool sim_on_ground = false;
-  std::string callsign;
+  gdl90::Callsign callsign;
 };
 
 struct TrafficData {
@@ -40,12 +48,44 @@ struct TrafficData {
   double velocity_world_z_fps = 0.0;
   double true_heading_deg = 0.0;
   bool sim_on_ground = false;
-  std::string callsign;
+  gdl90::Callsign callsign;
   // Non-zero when the simulator exposes a real ICAO address (e.g. MSFS 2024
   // via AI TRAFFIC ICAO ADDRESS).  Zero triggers synthetic address generation.
   uint32_t icao_address = 0;
 };
 
+static_assert(std::is_trivially_copyable<TrafficData>::value,
+              "traffic samples are copied between SimConnect buffers");
+
+// The traffic data definition exactly as SimConnect lays it out in the
+// dispatch buffer, so it can be read in place.
+#pragma pack(push, 1)
+struct TrafficSimData {
+  double latitude_deg = 0.0;       // PLANE LATITUDE, degrees, FLOAT64
+  double longitude_deg = 0.0;      // PLANE LONGITUDE, degrees, FLOAT64
+  double altitude_ft = 0.0;        // PLANE ALTITUDE, feet, FLOAT64
+  double ground_velocity_kt = 0.0; // GROUND VELOCITY, knots, FLOAT64
+  double velocity_world_x_fps =
+      0.0; // VELOCITY WORLD X, feet per second, FLOAT64
+  double velocity_world_y_fps =
+      0.0; // VELOCITY WORLD Y, feet per second, FLOAT64
+  double velocity_world_z_fps =
+      0.0;                       // VELOCITY WORLD Z, feet per second, FLOAT64
+  double true_heading_deg = 0.0; // PLANE HEADING DEGREES TRUE, degrees, FLOAT64
+  int32_t sim_on_ground = 0;     // SIM ON GROUND, Bool, INT32
+  char atc_id[32] = {};          // ATC ID, NULL, STRING32
+};
+#pragma pack(pop)
+
+static_assert(sizeof(TrafficSimData) == 8 * 8 + 4 + 32,
+              "TrafficSimData must match the SimConnect data definition");
+
+// One object's sample, pointing into the buffer it arrived in.
+struct TrafficSimView {
+  uint32_t object_id = 0;
+  const TrafficSimData *data = nullptr;
+};
+
 // Pure math helpers exposed for testing.
 double NormalizeDegrees360(double degrees);
 uint16_t NormalizeDegreesToUint16(double degrees);
@@ -53,6 +93,9 @@ uint16_t ClampKnotsToUint16OrInvalid(double knots);
 int16_t ClampFpmToInt16OrInvalid(double fpm);
 std::string TrimString(const std::string &value);
 uint32_t SyntheticTrafficAddress(uint32_t object_id);
+// Sanitizes a fixed-size SimConnect string, which need not be terminated,
+// into a callsign.
+gdl90::Callsign SimConnectCallsign(const char *value, size_t size);
 
 // GDL90 / ForeFlight data builders.
 gdl90::PositionData BuildOwnshipPosition(const OwnshipData &sim,
@@ -68,4 +111,33 @@ bool BuildTrafficPosition(const TrafficData &traffic,
                           const xp2gdl90::Settings &cfg,
                           gdl90::PositionData *out_data);
 
+// Marks the object seen in `tracks` at `now` and writes `traffic` into its
+// snapshot row. Snapshot rows follow the track table's dense order, so
+// evict with tracks->evictStale(..., snapshot). Returns the row index.
+size_t UpsertTrafficTarget(xp2gdl90::traffic::TrackTable *tracks,
+                           xp2gdl90::traffic::TrafficSnapshot *snapshot,
+                           const TrafficData &traffic, double now);
+// Batch form of UpsertTrafficTarget() that reads each sample in place, with
+// no TrafficData copy in between. Returns how many of the `count` samples
+// have a valid position.
+size_t UpsertTrafficTargets(xp2gdl90::traffic::TrackTable *tracks,
+                            xp2gdl90::traffic::TrafficSnapshot *snapshot,
+                            const TrafficSimView *views, size_t count,
+                            double now);
+// Ownship position and velocity in the traffic selection frame.
+xp2gdl90::traffic::TrafficReference
+OwnshipTrafficReference(const OwnshipData &sim);
+// Appends a report to *out_reports for every row with a valid position that
+// survives the nearest-target selection around `ownship`, and returns the
+// number appended. `candidate_rows`, typically from TrackTable::queryNear(),
+// limits the selection to those rows. Without ownship only the first
+// traffic_max_targets valid rows are kept. With `parallel`, large snapshots
+// are split across its pool.
+size_t BuildTrafficPositions(
+    xp2gdl90::traffic::TrafficSnapshot *snapshot,
+    const xp2gdl90::Settings &cfg, const OwnshipData *ownship,
+    const std::vector<uint32_t> *candidate_rows,
+    std::vector<gdl90::PositionData> *out_reports,
+    xp2gdl90::traffic::ParallelTrafficBuild *parallel = nullptr);
+
 } // namespace msfs_bridge
@@ -0,0 +1,190 @@
+#ifndef XP2GDL90_NETWORK_SENDER_H
+#define XP2GDL90_NETWORK_SENDER_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xp2gdl90/datagram_packer.h"
+#include "xp2gdl90/frame_buffer.h"
+#include "xp2gdl90/frame_pool.h"
+#include "xp2gdl90/spsc_ring.h"
+#include "xp2gdl90/thread_tuning.h"
+#include "xp2gdl90/udp_broadcaster.h"
+
+/**
+ * Moves UDP sends off the simulator thread. The flight loop enqueues
+ * pre-encoded frames into lock-free rings and a dedicated thread puts them
+ * on the wire.
+ */
+
+namespace udp {
+
+// What to do when a traffic tick does not fit in the traffic ring.
+// Priority frames (heartbeat, ownship, ForeFlight) are never dropped by
+// policy.
+enum class OverflowPolicy : uint8_t {
+  DROP_OLDEST_TRAFFIC = 0,
+  DROP_NEWEST_TRAFFIC = 1,
+};
+
+constexpr size_t SENDER_PRIORITY_CAPACITY = 64;
+constexpr size_t SENDER_TRAFFIC_CAPACITY = 256;
+
+struct NetworkSenderStats {
+  uint64_t frames_sent = 0;
+  uint64_t send_errors = 0;
+  uint64_t traffic_dropped_oldest = 0;
+  uint64_t traffic_dropped_newest = 0;
+  uint64_t priority_overflows = 0;
+  // Frames waiting in each ring, as seen from the producer thread.
+  size_t priority_queued = 0;
+  size_t traffic_queued = 0;
+  // Enqueue-to-wire latency in microseconds.
+  uint64_t latency_samples = 0;
+  uint64_t latency_sum_us = 0;
+  uint64_t latency_max_us = 0;
+  uint64_t latency_last_us = 0;
+  // Notify-to-running latency of the sender thread.
+  xp2gdl90::WakeLatencyStats wake_latency;
+
+  double averageLatencyUs() const {
+    return latency_samples > 0 ? static_cast<double>(latency_sum_us) /
+                                     static_cast<double>(latency_samples)
+                               : 0.0;
+  }
+};
+
+class NetworkSender {
+public:
+  explicit NetworkSender(
+      UDPBroadcaster &broadcaster,
+      OverflowPolicy policy = OverflowPolicy::DROP_OLDEST_TRAFFIC,
+      size_t priority_capacity = SENDER_PRIORITY_CAPACITY,
+      size_t traffic_capacity = SENDER_TRAFFIC_CAPACITY);
+  ~NetworkSender();
+
+  NetworkSender(const NetworkSender &) = delete;
+  NetworkSender &operator=(const NetworkSender &) = delete;
+
+  bool start();
+  // Sends whatever is still queued, then joins the thread.
+  void stop();
+  bool isRunning() const { return thread_.joinable(); }
+
+  // Producer side, called from the simulator thread only.
+  void setOverflowPolicy(OverflowPolicy policy) { policy_.store(policy); }
+  void setPacking(bool enabled, size_t max_datagram_bytes);
+  // Queues one priority frame. Returns false if the priority ring is full.
+  bool enqueue(const uint8_t *frame, size_t size, uint32_t route,
+               bool leading = false);
+  // The same without the copy: the slot holds a reference to `frame`
+  // until the sender thread has sent it.
+  bool enqueue(gdl90::FrameRef frame, uint32_t route, bool leading = false);
+  // Queues one tick of traffic, applying the overflow policy; never waits
+  // on the sender thread. Returns the number of frames accepted, counting
+  // those of an overflowing tick that wait for the stale ones to go.
+  size_t enqueueTraffic(const gdl90::FrameArena &frames, uint32_t route);
+  // Queues frames [first, first + count) as their own tick, for paced
+  // traffic.
+  size_t enqueueTraffic(const gdl90::FrameArena &frames, size_t first,
+                        size_t count, uint32_t route);
+  // Queues traffic still waiting and wakes the sender thread; call once per
+  // tick after enqueueing.
+  void notify();
+  // Applied by the sender thread at its next wake; any thread may call it.
+  void setThreadTuning(const xp2gdl90::ThreadTuning &tuning) {
+    tuning_.set(tuning);
+  }
+  std::string threadTuningError() const { return tuning_.lastError(); }
+
+  // Consumer side. The sender thread calls this; without a running thread
+  // it may be called directly. Returns the number of frames sent.
+  size_t drain();
+
+  NetworkSenderStats stats() const;
+  std::string lastError() const;
+
+  // Runs `fn` with exclusive access to the broadcaster, for reconfiguring
+  // targets while the sender thread may be sending.
+  template <typename Fn> void withBroadcaster(Fn &&fn) {
+    std::lock_guard<std::mutex> lock(broadcaster_mutex_);
+    fn(broadcaster_);
+  }
+
+private:
+  struct Slot {
+    std::array<uint8_t, gdl90::FRAME_BUFFER_CAPACITY> bytes{};
+    // Sent in place of `bytes` when set.
+    gdl90::FrameRef frame;
+    size_t size = 0;
+    uint32_t route = 0;
+    bool leading = false;
+    uint64_t generation = 0;
+    int64_t enqueued_ns = 0;
+  };
+
+  static void FillSlot(Slot *slot, const uint8_t *frame, size_t size,
+                       uint32_t route, bool leading, uint64_t generation,
+                       int64_t enqueued_ns);
+  // Producer side: queues what the ring has room for from the backlog, or
+  // counts what is left of it as dropped.
+  void flushTrafficBacklog();
+  void dropTrafficBacklog();
+  void run();
+  bool sendSlot(Slot &slot);
+  size_t sendTrafficBatch();
+  void recordLatency(int64_t enqueued_ns);
+
+  UDPBroadcaster &broadcaster_;
+  mutable std::mutex broadcaster_mutex_;
+  DatagramPacker packer_;
+  std::string last_error_;
+  std::vector<SendBuffer> batch_;
+  uint32_t batch_route_ = 0;
+  int64_t batch_enqueued_ns_ = 0;
+
+  SpscRing<Slot> priority_;
+  SpscRing<Slot> traffic_;
+  std::atomic<OverflowPolicy> policy_;
+  std::atomic<bool> packing_enabled_{false};
+  std::atomic<size_t> packing_max_bytes_{DATAGRAM_DEFAULT_MAX_BYTES};
+  uint64_t traffic_generation_ = 0;
+  // Traffic from generations below this is stale and released unsent by
+  // drain(), so the producer never waits on the sender thread.
+  std::atomic<uint64_t> stale_before_{0};
+  // Producer-only: the part of an overflowing tick that waits for the stale
+  // frames to be released.
+  gdl90::FrameArena backlog_;
+  size_t backlog_next_ = 0;
+  uint32_t backlog_route_ = 0;
+  uint64_t backlog_generation_ = 0;
+  int64_t backlog_enqueued_ns_ = 0;
+
+  std::atomic<uint64_t> frames_sent_{0};
+  std::atomic<uint64_t> send_errors_{0};
+  std::atomic<uint64_t> traffic_dropped_oldest_{0};
+  std::atomic<uint64_t> traffic_dropped_newest_{0};
+  std::atomic<uint64_t> priority_overflows_{0};
+  std::atomic<uint64_t> latency_samples_{0};
+  std::atomic<uint64_t> latency_sum_us_{0};
+  std::atomic<uint64_t> latency_max_us_{0};
+  std::atomic<uint64_t> latency_last_us_{0};
+  xp2gdl90::WakeLatencyMeter wake_latency_;
+  xp2gdl90::ThreadTuningSlot tuning_;
+
+  std::thread thread_;
+  std::atomic<bool> stop_requested_{false};
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+};
+
+} // namespace udp
+
+#endif // XP2GDL90_NETWORK_SENDER_H
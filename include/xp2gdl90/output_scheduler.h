@@ -0,0 +1,131 @@
+#ifndef XP2GDL90_OUTPUT_SCHEDULER_H
+#define XP2GDL90_OUTPUT_SCHEDULER_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "xp2gdl90/broadcast_clock.h"
+
+namespace xp2gdl90 {
+
+// Lower is more important: heartbeat, ownship (position and geometric
+// altitude), AHRS, traffic, device info.
+uint8_t SendClassPriority(SendClass send_class);
+
+// Classes with this period or shorter are high-rate: they go out on the
+// tick nearest each release instead of the first tick after it.
+constexpr double OUTPUT_HIGH_RATE_PERIOD_S = 0.2;
+
+// Period for a rate in Hz; zero, which disables a class, for rates of 0.
+inline double PeriodForRate(double rate_hz) {
+  return std::isfinite(rate_hz) && rate_hz > 0.0 ? 1.0 / rate_hz : 0.0;
+}
+
+// Work one tick may do; zero leaves a limit off.
+struct OutputBudget {
+  double max_tick_s = 0.0;
+  size_t max_tick_bytes = 0;
+};
+
+struct OutputClassStats {
+  uint64_t sent = 0;
+  uint64_t deferred = 0;        // Due but left for a later tick.
+  uint64_t dropped = 0;         // Skipped because the deadline passed.
+  uint64_t deadline_misses = 0; // Sent after the deadline, or dropped.
+  double max_lateness_s = 0.0;  // Worst send time past the release.
+};
+
+/**
+ * Earliest-deadline-first scheduler over the message classes. Each class is
+ * released once per period and must go out by its deadline. A tick admits
+ * the due classes by priority while their estimated cost fits the budget,
+ * then sends the admitted ones in deadline order; the rest are deferred. A
+ * release whose deadline passes unsent is dropped and the next one takes
+ * its place. The heartbeat and the first class of a tick are always
+ * admitted so the link stays up and every tick makes progress.
+ *
+ * Ticks only happen so often (once per simulator frame in X-Plane), so a
+ * class sent on the first tick after its release comes out up to a tick
+ * late. High-rate classes may instead go out up to half a tick early,
+ * which centres their send times on the period grid: each send is then at
+ * most half a tick off its release, where the error would be a whole tick.
+ */
+class OutputScheduler {
+public:
+  // A period of zero or less disables the class; enabling it makes it due
+  // at once. A deadline of zero or less, relative to the release, defaults
+  // to the period.
+  void configure(SendClass send_class, double period_s,
+                 double deadline_s = 0.0);
+  void setBudget(const OutputBudget &budget) { budget_ = budget; }
+  // Expected time between ticks; 0, the default, for a caller that wakes
+  // exactly at nextRelease().
+  void setTickInterval(double tick_interval_s);
+  double tickInterval() const { return tick_interval_; }
+  const OutputBudget &budget() const { return budget_; }
+
+  // Makes every class due at `now`, e.g. after a schedule reset.
+  void restart(double now);
+
+  // Starts a tick at broadcast time `now`; `monotonic_now` times the budget.
+  void beginTick(double now, double monotonic_now);
+  // Next class to send this tick. Returns false when none is left or the
+  // time budget ran out; anything left over is deferred.
+  bool next(double monotonic_now, SendClass *out_class);
+  // Records the send of the class last returned by next().
+  void complete(SendClass send_class, size_t bytes, double monotonic_now);
+
+  bool due(SendClass send_class) const;
+  // Earliest time a class may go out, or NaN when none is enabled. That is
+  // a little before the release for high-rate classes.
+  double nextRelease() const;
+  double release(SendClass send_class) const {
+    return classes_[static_cast<size_t>(send_class)].release;
+  }
+
+  const OutputClassStats &stats(SendClass send_class) const {
+    return classes_[static_cast<size_t>(send_class)].stats;
+  }
+  uint64_t ticks() const { return ticks_; }
+  uint64_t overBudgetTicks() const { return over_budget_ticks_; }
+  void resetStats();
+
+private:
+  struct ClassState {
+    double period = 0.0;
+    double deadline = 0.0;
+    double release = NAN;
+    double cost_s = 0.0;
+    double cost_bytes = 0.0;
+    // Left over by the last tick; its release is dropped once the
+    // deadline passes.
+    bool deferred = false;
+    OutputClassStats stats;
+  };
+
+  double absoluteDeadline(SendClass send_class) const;
+  // How far before its release the class may be sent.
+  double releaseLead(const ClassState &state) const;
+  void defer(ClassState *state);
+
+  std::array<ClassState, SEND_CLASS_COUNT> classes_{};
+  std::array<SendClass, SEND_CLASS_COUNT> order_{};
+  size_t order_count_ = 0;
+  size_t order_next_ = 0;
+  OutputBudget budget_;
+  double tick_interval_ = 0.0;
+  double now_ = 0.0;
+  double tick_start_ = 0.0;
+  double send_start_ = 0.0;
+  size_t tick_bytes_ = 0;
+  size_t tick_sent_ = 0;
+  bool tick_over_budget_ = false;
+  uint64_t ticks_ = 0;
+  uint64_t over_budget_ticks_ = 0;
+};
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_OUTPUT_SCHEDULER_H
@@ -6,10 +6,16 @@
 #include <string_view>
 #include <vector>
 
+#include "xp2gdl90/callsign.h"
+
 namespace xp2gdl90::protocol {
 
 std::string SanitizeCallsign(std::string_view input);
+// As SanitizeCallsign, without allocating.
+gdl90::Callsign MakeCallsign(std::string_view input);
 bool IsValidIpv4Address(std::string_view input);
+// A valid IPv4 address in the multicast range, 224.0.0.0/4.
+bool IsMulticastIpv4Address(std::string_view input);
 
 bool IsValidNic(uint8_t value);
 bool IsValidNacp(uint8_t value);
@@ -1,16 +1,58 @@
 #ifndef XP2GDL90_SETTINGS_H
 #define XP2GDL90_SETTINGS_H
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace xp2gdl90 {
 
+// Message classes a destination can subscribe to.
+constexpr uint32_t MESSAGE_HEARTBEAT = 1u << 0;
+constexpr uint32_t MESSAGE_OWNSHIP = 1u << 1;
+constexpr uint32_t MESSAGE_TRAFFIC = 1u << 2;
+constexpr uint32_t MESSAGE_FOREFLIGHT_ID = 1u << 3;
+constexpr uint32_t MESSAGE_AHRS = 1u << 4;
+constexpr uint32_t MESSAGE_ALL = 0x1Fu;
+
+// Extra destinations beyond target_ip/target_port.
+constexpr size_t MAX_EXTRA_DESTINATIONS = 7;
+
+struct Destination {
+  std::string ip;
+  uint16_t port = 4000;
+  uint32_t message_mask = MESSAGE_ALL;
+  uint8_t rate_divisor = 1;
+};
+
 struct Settings {
   std::string target_ip = "192.168.1.100";
   uint16_t target_port = 4000;
   bool foreflight_auto_discovery = true;
   uint16_t foreflight_broadcast_port = 63093;
+  std::vector<Destination> extra_destinations;
+  // Used when target_ip or a destination is a multicast group (224.0.0.0/4).
+  // An empty interface lets the routing table pick the outgoing one.
+  uint8_t multicast_ttl = 1;
+  std::string multicast_interface;
+  bool multicast_loopback = false;
+  // Sending socket tuning: a DSCP mark for every datagram (46 and 48 reach
+  // the Wi-Fi voice queue), a send buffer size and a local address to send
+  // from. Zero and empty keep the system defaults.
+  uint8_t socket_dscp = 0;
+  uint32_t socket_send_buffer_bytes = 0;
+  std::string socket_bind_ip;
+  bool datagram_packing = false;
+  uint16_t datagram_max_bytes = 1400;
+  bool sender_thread = false;
+  // 0 drops the oldest queued traffic on overflow, 1 drops the newest.
+  uint8_t sender_overflow_policy = 0;
+  // Scheduling of the sender, traffic and relay worker threads: priority 0
+  // is normal, 1 high and 2 time-critical; bit n of the mask allows logical
+  // CPU n, and 0 lets them run anywhere.
+  uint8_t worker_thread_priority = 0;
+  uint32_t worker_cpu_mask = 0;
   uint32_t icao_address = 0xABCDEF;
   std::string callsign = "N12345";
   uint8_t emitter_category = 1;
@@ -22,14 +64,93 @@ struct Settings {
 
   float heartbeat_rate = 1.0f;
   float position_rate = 2.0f;
+  // X-Plane only: samples ownship right after the flight model step and
+  // sends it from there, evenly spaced at a position_rate of up to 10 Hz.
+  bool ownship_high_rate = false;
   float traffic_rate = 1.0f;
+  // Rates of the AHRS, ownship geometric altitude and ForeFlight ID
+  // messages; 0 turns a message off. AHRS at 10-20 Hz smooths synthetic
+  // vision.
+  float ahrs_rate = 5.0f;
+  float geo_altitude_rate = 1.0f;
+  float device_info_rate = 1.0f;
   uint8_t traffic_max_targets = 63;
+  // 0 converts every target exactly, 1 projects targets within
+  // traffic_projection_radius_nm of ownship from one exact conversion.
+  uint8_t traffic_position_mode = 0;
+  float traffic_projection_radius_nm = 10.0f;
+  // Only the traffic_max_targets nearest targets are sent. Zero disables the
+  // range and altitude limits; a lookahead ranks closing targets as if the
+  // given seconds had passed.
+  float traffic_range_nm = 0.0f;
+  float traffic_altitude_band_ft = 0.0f;
+  float traffic_closure_lookahead_s = 0.0f;
+  // MSFS only: range queries use a spatial grid with traffic_range_nm cells
+  // instead of scanning every tracked target. Needs traffic_range_nm > 0.
+  bool traffic_spatial_index = false;
+  // MSFS only: radius and period of the SimConnect traffic scans that find
+  // aircraft to subscribe to and refresh parked ones.
+  float traffic_scan_radius_nm = 10.8f;
+  float traffic_scan_interval_s = 5.0f;
+  // MSFS only: extra threads that share each traffic sweep's build and
+  // encoding once there are hundreds of targets. 0 builds on one thread.
+  uint8_t traffic_build_threads = 0;
+  // Reports each target at 2 Hz when near or closing down to 0.2 Hz when far,
+  // within traffic_max_frames_per_second (0 is unlimited).
+  bool traffic_adaptive_rate = false;
+  float traffic_max_frames_per_second = 0.0f;
+  // Spreads each traffic sweep's frames over the sweep interval instead of
+  // sending them back to back.
+  bool traffic_pacing = false;
+  // X-Plane only: sweeps traffic on a worker thread after the array reads.
+  bool traffic_thread = false;
+  // X-Plane only: derives each target's ground speed, track and vertical
+  // rate from its last few positions instead of the TCAS velocities.
+  bool traffic_smoothing = false;
+  // Merges the traffic reports of an external GDL90 feed arriving on
+  // traffic_relay_port into each sweep. A target both report goes out as
+  // the simulator has it, or with traffic_relay_priority 1 as the feed has it.
+  bool traffic_relay = false;
+  uint16_t traffic_relay_port = 4001;
+  uint8_t traffic_relay_priority = 0;
+  // Dead-reckons ownship and traffic from sample time to send time, up to
+  // this many seconds. 0 disables extrapolation.
+  float extrapolation_horizon_s = 0.0f;
+  // Work one flight loop tick may spend on output before lower-priority
+  // messages wait for the next tick. 0 leaves the limit off.
+  float output_budget_ms = 0.0f;
+  uint32_t output_budget_bytes = 0;
+  // Per-destination send ceiling. Backs off on send errors and sheds traffic
+  // before ownship and heartbeat. 0 disables the limit.
+  uint32_t bandwidth_limit_bytes_per_s = 0;
 
   uint8_t nic = 11;
   uint8_t nacp = 11;
 
   bool debug_logging = false;
   bool log_messages = false;
+  // Records every datagram sent into a stream_capture_mb ring file next to
+  // the settings file, as a pcap.
+  bool stream_capture = false;
+  uint32_t stream_capture_mb = 16;
+  // Writes the capture as a compact, delta-encoded log that grows with the
+  // session instead; stream_capture_mb does not apply.
+  bool stream_capture_compact = false;
+  // Publishes every frame sent, and a decoded ownship and traffic snapshot,
+  // to same-machine readers through a shared-memory mapping.
+  bool shared_output = false;
+  // Ends every tick that sent anything with a sequence-numbered, timestamped
+  // mark for xp2gdl90_probe. EFBs ignore it.
+  bool link_probe = false;
+  // Records the ownship and TCAS inputs of each traffic sweep for the
+  // offline profiler.
+  bool sim_recording = false;
+  // Sends a JSON link health report to metrics_ip:metrics_port every
+  // metrics_interval_s seconds.
+  bool metrics_enabled = false;
+  std::string metrics_ip = "127.0.0.1";
+  uint16_t metrics_port = 4100;
+  float metrics_interval_s = 5.0f;
 };
 
 bool LoadSettingsFromJsonFile(const std::string &path, Settings *out_settings,
@@ -0,0 +1,51 @@
+#ifndef XP2GDL90_SETTINGS_SNAPSHOT_H
+#define XP2GDL90_SETTINGS_SNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "xp2gdl90/settings.h"
+
+namespace xp2gdl90 {
+
+using SettingsSnapshot = std::shared_ptr<const Settings>;
+
+/**
+ * The current settings as an immutable snapshot. A change publishes a whole
+ * new Settings instead of editing the old one, so readers on any thread
+ * never see half an update. Readers take the pointer once per tick or loop
+ * iteration and keep it for the whole pass; a snapshot stays alive for as
+ * long as someone holds it.
+ */
+class SettingsPublisher {
+public:
+  SettingsPublisher() : current_(std::make_shared<const Settings>()) {}
+
+  SettingsPublisher(const SettingsPublisher &) = delete;
+  SettingsPublisher &operator=(const SettingsPublisher &) = delete;
+
+  // Any thread.
+  SettingsSnapshot load() const {
+    return std::atomic_load_explicit(&current_, std::memory_order_acquire);
+  }
+  // Counts publishes, so a reader can tell its snapshot is stale without
+  // taking a new one.
+  uint64_t version() const { return version_.load(std::memory_order_acquire); }
+
+  void publish(Settings settings) {
+    std::atomic_store_explicit(
+        &current_, std::make_shared<const Settings>(std::move(settings)),
+        std::memory_order_release);
+    version_.fetch_add(1, std::memory_order_release);
+  }
+
+private:
+  SettingsSnapshot current_;
+  std::atomic<uint64_t> version_{0};
+};
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_SETTINGS_SNAPSHOT_H
@@ -1,17 +1,30 @@
 #ifndef XP2GDL90_SETTINGS_UI_H
 #define XP2GDL90_SETTINGS_UI_H
 
+#include <cstdint>
 #include <string>
 
 #include "xp2gdl90/settings.h"
 
 namespace xp2gdl90 {
 
+// How often an idle settings window rebuilds to refresh its statistics.
+constexpr double SETTINGS_UI_IDLE_REDRAW_INTERVAL_S = 0.25;
+// How long the window keeps rebuilding every draw after input, so hover
+// highlights and held buttons follow the mouse.
+constexpr double SETTINGS_UI_ACTIVE_HOLD_S = 0.5;
+
 struct SettingsUiState {
   char target_ip[64] = {};
   int target_port = 0;
   bool foreflight_auto_discovery = false;
   int foreflight_broadcast_port = 0;
+  bool datagram_packing = false;
+  int datagram_max_bytes = 0;
+  bool sender_thread = false;
+  int sender_overflow_policy = 0;
+  int worker_thread_priority = 0;
+  char worker_cpu_mask[16] = {};
   char icao_address[16] = {};
   char callsign[16] = {};
   int emitter_category = 0;
@@ -22,12 +35,47 @@ struct SettingsUiState {
   bool traffic_enabled = true;
   float heartbeat_rate = 0.0f;
   float position_rate = 0.0f;
+  bool ownship_high_rate = false;
   float traffic_rate = 0.0f;
+  float ahrs_rate = 0.0f;
+  float geo_altitude_rate = 0.0f;
+  float device_info_rate = 0.0f;
   int traffic_max_targets = 0;
+  int traffic_position_mode = 0;
+  float traffic_projection_radius_nm = 0.0f;
+  float traffic_range_nm = 0.0f;
+  float traffic_altitude_band_ft = 0.0f;
+  float traffic_closure_lookahead_s = 0.0f;
+  bool traffic_spatial_index = false;
+  float traffic_scan_radius_nm = 0.0f;
+  float traffic_scan_interval_s = 0.0f;
+  int traffic_build_threads = 0;
+  bool traffic_adaptive_rate = false;
+  float traffic_max_frames_per_second = 0.0f;
+  bool traffic_pacing = false;
+  bool traffic_thread = false;
+  bool traffic_smoothing = false;
+  bool traffic_relay = false;
+  int traffic_relay_port = 0;
+  int traffic_relay_priority = 0;
+  float extrapolation_horizon_s = 0.0f;
+  float output_budget_ms = 0.0f;
+  int output_budget_bytes = 0;
+  int bandwidth_limit_bytes_per_s = 0;
   int nic = 0;
   int nacp = 0;
   bool debug_logging = false;
   bool log_messages = false;
+  bool stream_capture = false;
+  int stream_capture_mb = 16;
+  bool stream_capture_compact = false;
+  bool shared_output = false;
+  bool link_probe = false;
+  bool sim_recording = false;
+  bool metrics_enabled = false;
+  char metrics_ip[64] = {};
+  int metrics_port = 0;
+  float metrics_interval_s = 0.0f;
 };
 
 void SyncSettingsUiFromConfig(SettingsUiState *ui_state,
@@ -37,6 +85,39 @@ bool BuildConfigFromSettingsUi(const SettingsUiState &ui_state,
                                const Settings &base_settings,
                                Settings *out_settings, std::string *out_error);
 
+/**
+ * Decides when the settings window rebuilds its ImGui frame. Between
+ * rebuilds the window draws the last frame's draw data again, which is a
+ * handful of GL calls instead of a layout pass over every widget and
+ * statistic. Input and invalidation rebuild at the next draw; an idle
+ * window rebuilds at most every idle interval.
+ */
+class SettingsRedrawPolicy {
+public:
+  explicit SettingsRedrawPolicy(
+      double idle_interval_s = SETTINGS_UI_IDLE_REDRAW_INTERVAL_S,
+      double active_hold_s = SETTINGS_UI_ACTIVE_HOLD_S)
+      : idle_interval_s_(idle_interval_s), active_hold_s_(active_hold_s) {}
+
+  // Something shown changed, such as the settings or the window geometry.
+  void invalidate() { dirty_ = true; }
+  void noteInput(double now);
+  // `busy` while a widget is held or a text field has focus, which ImGui
+  // animates from frame to frame.
+  bool shouldRebuild(double now, bool busy) const;
+  void noteRebuilt(double now);
+
+  uint64_t rebuilds() const { return rebuilds_; }
+
+private:
+  double idle_interval_s_;
+  double active_hold_s_;
+  bool dirty_ = true;
+  double active_until_ = 0.0;
+  double last_rebuild_ = 0.0;
+  uint64_t rebuilds_ = 0;
+};
+
 } // namespace xp2gdl90
 
 #endif // XP2GDL90_SETTINGS_UI_H
@@ -0,0 +1,104 @@
+#ifndef XP2GDL90_SETTINGS_WATCHER_H
+#define XP2GDL90_SETTINGS_WATCHER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "xp2gdl90/settings.h"
+
+namespace xp2gdl90 {
+
+// How often the watcher thread checks the settings file by default.
+constexpr double SETTINGS_POLL_INTERVAL_S = 1.0;
+
+// One read of the settings file, published as an immutable snapshot.
+struct SettingsLoad {
+  uint64_t generation = 0;
+  // False when there was no file to read; settings then holds the base.
+  bool found = false;
+  bool ok = false;
+  Settings settings;
+  std::string error;
+};
+
+/**
+ * Reads the settings file on a thread of its own: once at start, then again
+ * whenever its modification time or size changes and settles, or a reload
+ * is requested.
+ * The simulator thread takes finished loads without touching the disk, so
+ * a slow home directory or an edit mid-session never stalls a frame.
+ *
+ * The file is polled with stat() rather than a change notification API;
+ * notifications are unreliable on the network shares that make loading slow
+ * in the first place, and one stat() a second costs nothing.
+ */
+class SettingsWatcher {
+public:
+  SettingsWatcher() = default;
+  ~SettingsWatcher();
+
+  SettingsWatcher(const SettingsWatcher &) = delete;
+  SettingsWatcher &operator=(const SettingsWatcher &) = delete;
+
+  // Starts the thread. Keys missing from the file keep their value in
+  // `base`, which then follows each successful load.
+  bool start(const std::string &path, const Settings &base,
+             double poll_interval_s, std::string *out_error);
+  void stop();
+  bool isRunning() const { return thread_.joinable(); }
+
+  // Any thread. The newest load not taken yet, or null. Loads that were
+  // superseded before anyone took them are dropped.
+  std::shared_ptr<const SettingsLoad> take();
+  // Reads the file on the next wakeup even if it looks unchanged.
+  void requestReload();
+  // Writes `settings` to the file without it coming back as an edit. Any
+  // load not taken yet, or still being read, is older than the save and is
+  // dropped. The file is replaced by a rename, so a save never waits on a
+  // read and a read never sees a half-written file.
+  bool save(const Settings &settings, std::string *out_error);
+
+private:
+  struct FileStamp {
+    bool exists = false;
+    std::filesystem::file_time_type modified{};
+    uintmax_t size = 0;
+
+    bool operator==(const FileStamp &other) const {
+      return exists == other.exists && modified == other.modified &&
+             size == other.size;
+    }
+    bool operator!=(const FileStamp &other) const { return !(*this == other); }
+  };
+
+  static FileStamp Stat(const std::string &path);
+  void run();
+  // Reads the file if it changed or a reload was asked for.
+  void poll();
+
+  std::string path_;
+  double poll_interval_s_ = SETTINGS_POLL_INTERVAL_S;
+  std::thread thread_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stop_requested_ = false;
+  bool reload_requested_ = false;
+  Settings base_;
+  // The file as last read, and as last polled.
+  FileStamp stamp_;
+  FileStamp seen_;
+  uint64_t generation_ = 0;
+  // Bumped by each save; a read that overlapped one is not published.
+  uint64_t saves_ = 0;
+  std::shared_ptr<const SettingsLoad> pending_;
+};
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_SETTINGS_WATCHER_H
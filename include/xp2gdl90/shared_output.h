@@ -0,0 +1,213 @@
+#ifndef XP2GDL90_SHARED_OUTPUT_H
+#define XP2GDL90_SHARED_OUTPUT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "xp2gdl90/frame_buffer.h"
+#include "xp2gdl90/gdl90_decoder.h"
+#include "xp2gdl90/gdl90_encoder.h"
+
+/**
+ * Publishes the output to consumers on the same machine through a named
+ * shared-memory mapping (`/<name>` via shm_open on POSIX, `Local\<name>` on
+ * Windows), so moving maps and loggers need not take the stream over UDP
+ * loopback. The mapping holds a SharedOutputHeader, a SharedSnapshot of the
+ * decoded ownship and traffic, and a byte ring of every frame sent, each as
+ * a 4-byte length and the frame padded to 4 bytes.
+ *
+ * Both halves use sequence locks, so readers never block the simulator and
+ * never make a system call: a reader checks after using a frame, or after
+ * copying the snapshot, that the writer did not overwrite it meanwhile.
+ */
+
+namespace xp2gdl90 {
+
+constexpr uint32_t SHARED_OUTPUT_MAGIC = 0x4F533258u; // "X2SO"
+constexpr uint16_t SHARED_OUTPUT_VERSION = 1;
+// A power of two.
+constexpr size_t SHARED_OUTPUT_RING_BYTES = 256 * 1024;
+constexpr size_t SHARED_OUTPUT_MAX_TARGETS = 64;
+// Record length that sends the reader back to the start of the ring.
+constexpr uint32_t SHARED_OUTPUT_WRAP = 0xFFFFFFFFu;
+
+// One report at wire resolution, with gdl90::PositionData's units and
+// invalid markers. Fixed layout for readers in other languages.
+struct SharedTarget {
+  double latitude = 0.0;
+  double longitude = 0.0;
+  int32_t altitude = 0;
+  uint32_t icao_address = 0;
+  uint16_t h_velocity = 0;
+  int16_t v_velocity = 0;
+  uint16_t track = 0;
+  uint8_t track_type = 0;
+  uint8_t airborne = 0;
+  uint8_t nic = 0;
+  uint8_t nacp = 0;
+  uint8_t emitter_category = 0;
+  uint8_t address_type = 0;
+  uint8_t alert_status = 0;
+  uint8_t emergency_code = 0;
+  // Space padded, not NUL terminated.
+  char callsign[8] = {};
+  uint8_t reserved[2] = {};
+};
+
+static_assert(sizeof(SharedTarget) == 48, "shared target is 48 bytes");
+
+struct SharedSnapshot {
+  // Snapshots published since the writer opened; 0 before the first.
+  uint64_t tick = 0;
+  // Wall clock at publication, in nanoseconds since the epoch.
+  int64_t timestamp_ns = 0;
+  uint32_t ownship_valid = 0;
+  uint32_t traffic_count = 0;
+  SharedTarget ownship;
+  // The latest traffic sweep.
+  SharedTarget traffic[SHARED_OUTPUT_MAX_TARGETS];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "shared counters must not need a lock");
+
+struct SharedOutputHeader {
+  uint32_t magic = 0;
+  uint16_t version = 0;
+  uint16_t header_bytes = 0;
+  uint32_t snapshot_offset = 0;
+  uint32_t ring_offset = 0;
+  uint32_t ring_bytes = 0;
+  uint32_t max_targets = 0;
+  // Ring bytes ever written; the end of the newest whole record.
+  std::atomic<uint64_t> write_pos{0};
+  // The end of the record being written. Ring bytes before
+  // write_end - ring_bytes are stale.
+  std::atomic<uint64_t> write_end{0};
+  // Odd while the snapshot is being written.
+  std::atomic<uint64_t> snapshot_sequence{0};
+  uint64_t reserved[2] = {};
+};
+
+static_assert(sizeof(SharedOutputHeader) == 64, "shared header is 64 bytes");
+
+struct SharedOutputStats {
+  uint64_t frames = 0;
+  uint64_t bytes = 0;
+  // Times the ring lapped and started overwriting its oldest records.
+  uint64_t wraps = 0;
+  uint64_t snapshots = 0;
+};
+
+// A frame in the mapping, valid until the writer laps it.
+struct SharedFrame {
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+};
+
+// The writer. Every call but stats() comes from the thread that sends, as
+// with the BroadcastEngine that drives it.
+class SharedOutput {
+public:
+  SharedOutput() = default;
+  ~SharedOutput();
+
+  SharedOutput(const SharedOutput &) = delete;
+  SharedOutput &operator=(const SharedOutput &) = delete;
+
+  // Creates the mapping `name`, or takes over and resets an existing one.
+  bool open(const std::string &name, std::string *out_error);
+  // Unmaps and removes the name. Mapped readers keep the last contents.
+  void close();
+  bool isOpen() const { return base_ != nullptr; }
+  const std::string &name() const { return name_; }
+
+  // Copies one frame into the ring. An ownship report is also decoded for
+  // the next snapshot.
+  void publishFrame(const uint8_t *data, size_t size);
+  // Decodes a sweep's traffic reports for the next snapshot.
+  void setTraffic(const gdl90::FrameArena &frames);
+  void clearTraffic();
+  // Writes the snapshot if a report changed since the last one.
+  void publishSnapshot();
+
+  SharedOutputStats stats() const;
+
+private:
+  bool decodeTarget(const uint8_t *data, size_t size, SharedTarget *out);
+  bool mapShared(size_t bytes, std::string *out_error);
+  void unmapShared();
+
+  std::string name_;
+  uint8_t *base_ = nullptr;
+  size_t mapped_bytes_ = 0;
+  SharedOutputHeader *header_ = nullptr;
+  SharedSnapshot *snapshot_ = nullptr;
+  uint8_t *ring_ = nullptr;
+  uint64_t write_pos_ = 0;
+  SharedSnapshot staging_;
+  bool snapshot_dirty_ = false;
+  gdl90::Decoder decoder_;
+  int64_t wall_base_ns_ = 0;
+  std::chrono::steady_clock::time_point steady_base_;
+#ifdef _WIN32
+  void *mapping_ = nullptr;
+#endif
+
+  std::atomic<uint64_t> frames_{0};
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<uint64_t> wraps_{0};
+  std::atomic<uint64_t> snapshots_{0};
+};
+
+// A reader in another process, or a test. Maps read-only and never blocks
+// the writer.
+class SharedOutputReader {
+public:
+  SharedOutputReader() = default;
+  ~SharedOutputReader();
+
+  SharedOutputReader(const SharedOutputReader &) = delete;
+  SharedOutputReader &operator=(const SharedOutputReader &) = delete;
+
+  // Maps the writer's `name`. Reading starts at the newest frame.
+  bool open(const std::string &name, std::string *out_error);
+  void close();
+  bool isOpen() const { return base_ != nullptr; }
+
+  // Points `out` at up to `capacity` frames published since the last call,
+  // oldest first, and returns how many. Check framesIntact() after using
+  // them. A reader the writer lapped skips to the newest frame and counts
+  // an overrun.
+  size_t readFrames(SharedFrame *out, size_t capacity);
+  // Whether the frames of the last readFrames() are still unwritten.
+  bool framesIntact() const;
+  uint64_t overruns() const { return overruns_; }
+
+  // Copies the newest snapshot, retrying up to `attempts` times while the
+  // writer is mid-update. False if none was published or every attempt
+  // raced the writer.
+  bool readSnapshot(SharedSnapshot *out, int attempts = 64) const;
+
+private:
+  void resync();
+
+  const uint8_t *base_ = nullptr;
+  size_t mapped_bytes_ = 0;
+  const SharedOutputHeader *header_ = nullptr;
+  const uint8_t *ring_ = nullptr;
+  uint64_t ring_bytes_ = 0;
+  uint64_t cursor_ = 0;
+  uint64_t batch_start_ = 0;
+  uint64_t overruns_ = 0;
+#ifdef _WIN32
+  void *mapping_ = nullptr;
+#endif
+};
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_SHARED_OUTPUT_H
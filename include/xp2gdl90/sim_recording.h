@@ -0,0 +1,104 @@
+#ifndef XP2GDL90_SIM_RECORDING_H
+#define XP2GDL90_SIM_RECORDING_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "xp2gdl90/callsign.h"
+#include "xp2gdl90/traffic_projection.h"
+#include "xp2gdl90/traffic_snapshot.h"
+
+/**
+ * Records the simulator inputs of each traffic sweep, the ownship datarefs
+ * and the TCAS arrays, to a compact binary file, and reads them back so the
+ * collection and encoding pipeline can be profiled without X-Plane.
+ */
+
+namespace xp2gdl90 {
+
+constexpr uint32_t SIM_RECORDING_VERSION = 1;
+
+// Ownship dataref values, as the flight loop reads them. Optional values
+// are NaN when their dataref is missing.
+struct OwnshipSample {
+  double broadcast_time = 0.0;
+  double latitude = 0.0;
+  double longitude = 0.0;
+  double geometric_altitude_m = 0.0;
+  double pressure_altitude_ft = NAN;
+  float ground_speed_mps = 0.0f;
+  float vertical_speed_fpm = 0.0f;
+  float track_deg = 0.0f;
+  float roll_deg = NAN;
+  float pitch_deg = NAN;
+  float heading_deg = NAN;
+  float indicated_airspeed_kt = NAN;
+  float true_airspeed_kt = NAN;
+  bool gps_valid = false;
+  bool on_ground = false;
+  gdl90::Callsign tail_number;
+};
+
+// One sweep. Only the source columns of `traffic` are recorded, with row 0
+// as ownship; the anchor is the exact position X-Plane gave for row 0.
+struct SimTick {
+  OwnshipSample ownship;
+  bool has_anchor = false;
+  traffic::ProjectionAnchor anchor;
+  // False when the plugin had no ssr_mode dataref.
+  bool has_ssr_mode = true;
+  traffic::TrafficSnapshot traffic;
+};
+
+class SimRecorder {
+public:
+  SimRecorder() = default;
+  ~SimRecorder() { close(); }
+
+  SimRecorder(const SimRecorder &) = delete;
+  SimRecorder &operator=(const SimRecorder &) = delete;
+
+  // Creates or overwrites `path`.
+  bool open(const std::string &path, std::string *out_error);
+  void close();
+  bool isOpen() const { return file_.is_open(); }
+  const std::string &path() const { return path_; }
+
+  // Appends one sweep; `anchor` may be null. False once a write has failed.
+  bool append(const OwnshipSample &ownship,
+              const traffic::ProjectionAnchor *anchor, bool has_ssr_mode,
+              const traffic::TrafficSnapshot &traffic);
+
+  uint64_t ticks() const { return ticks_; }
+  uint64_t bytes() const { return bytes_; }
+
+private:
+  std::string path_;
+  std::ofstream file_;
+  std::vector<uint8_t> buffer_;
+  uint64_t ticks_ = 0;
+  uint64_t bytes_ = 0;
+};
+
+class SimPlayback {
+public:
+  bool open(const std::string &path, std::string *out_error);
+  // Reads the next tick into `out`; false at the end of the file or at a
+  // damaged tick.
+  bool next(SimTick *out);
+
+  uint64_t ticks() const { return ticks_; }
+
+private:
+  std::ifstream file_;
+  std::vector<uint8_t> buffer_;
+  uint64_t ticks_ = 0;
+};
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_SIM_RECORDING_H
@@ -1,14 +1,17 @@
 #ifndef XP2GDL90_SIMPLE_JSON_H
 #define XP2GDL90_SIMPLE_JSON_H
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <string_view>
-#include <utility>
 #include <vector>
 
 namespace xp2gdl90::json {
 
-enum class Type {
+enum class Type : uint8_t {
   Null,
   Bool,
   Number,
@@ -17,25 +20,199 @@ enum class Type {
   Array,
 };
 
-struct Value {
-  Type type = Type::Null;
-  bool bool_value = false;
-  double number_value = 0.0;
-  std::string string_value;
-  std::vector<std::pair<std::string, Value>> object_values;
-  std::vector<Value> array_values;
+// Contiguous run of nodes owned by a Document.
+template <typename T> class Span {
+public:
+  Span() = default;
+  Span(const T *data, size_t size) : data_(data), size_(size) {}
 
-  bool IsNull() const { return type == Type::Null; }
-  bool IsBool() const { return type == Type::Bool; }
-  bool IsNumber() const { return type == Type::Number; }
-  bool IsString() const { return type == Type::String; }
-  bool IsObject() const { return type == Type::Object; }
-  bool IsArray() const { return type == Type::Array; }
+  const T *begin() const { return data_; }
+  const T *end() const { return data_ + size_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const T &operator[](size_t index) const { return data_[index]; }
 
+private:
+  const T *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+struct Member;
+struct ObjectNode;
+
+/**
+ * One parsed JSON node: a 16-byte tagged union whose strings, elements and
+ * members live in the owning Document's arena. Nodes are only valid while
+ * that Document is.
+ */
+class Value {
+public:
+  bool IsNull() const { return type_ == Type::Null; }
+  bool IsBool() const { return type_ == Type::Bool; }
+  bool IsNumber() const { return type_ == Type::Number; }
+  bool IsString() const { return type_ == Type::String; }
+  bool IsObject() const { return type_ == Type::Object; }
+  bool IsArray() const { return type_ == Type::Array; }
+  Type type() const { return type_; }
+
+  // Each returns false, 0, or empty for nodes of another type.
+  bool AsBool() const { return type_ == Type::Bool && bool_; }
+  double AsNumber() const { return type_ == Type::Number ? number_ : 0.0; }
+  std::string_view AsString() const;
+  Span<Value> Elements() const;
+  Span<Member> Members() const;
+  // Elements of an array or members of an object.
+  size_t size() const { return IsArray() || IsObject() ? size_ : 0; }
+
+  // First member named `key`. Large objects look it up through a hash
+  // index, small ones by scanning.
   const Value *Find(std::string_view key) const;
+
+private:
+  friend class Parser;
+  friend class EventParser;
+
+  Type type_ = Type::Null;
+  bool bool_ = false;
+  uint32_t size_ = 0;
+  union {
+    double number_ = 0.0;
+    const char *chars_;
+    const Value *elements_;
+    const ObjectNode *object_;
+  };
+};
+
+static_assert(sizeof(Value) == 16, "JSON nodes are meant to stay compact");
+
+struct Member {
+  std::string_view key;
+  Value value;
+};
+
+// Bump allocator behind a Document. Memory is released all at once.
+class Arena {
+public:
+  void *allocate(size_t size, size_t alignment);
+  template <typename T> T *allocateArray(size_t count) {
+    return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+  }
+
+  // Makes the next block at least `bytes` long.
+  void reserve(size_t bytes);
+
+  // Bytes handed out, and bytes reserved from the heap for them.
+  size_t bytesUsed() const { return bytes_used_; }
+  size_t bytesReserved() const { return bytes_reserved_; }
+
+private:
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  char *cursor_ = nullptr;
+  char *end_ = nullptr;
+  size_t next_block_size_ = 1024;
+  size_t bytes_used_ = 0;
+  size_t bytes_reserved_ = 0;
+};
+
+/**
+ * A parsed JSON text. The document keeps its own copy of the text, so
+ * strings without escapes are views into that copy rather than separate
+ * allocations.
+ */
+class Document {
+public:
+  const Value &root() const { return root_; }
+  const Arena &arena() const { return arena_; }
+
+private:
+  friend bool Parse(std::string_view, Document *, std::string *);
+
+  Arena arena_;
+  Value root_;
+};
+
+// On failure *out_document is left unchanged.
+bool Parse(std::string_view text, Document *out_document,
+           std::string *out_error);
+
+// Receives the events of a streaming read. Each returns false to stop the
+// read. Strings and keys are only valid during the call.
+class Handler {
+public:
+  virtual ~Handler() = default;
+
+  virtual bool beginObject() { return true; }
+  virtual bool key(std::string_view /*name*/) { return true; }
+  virtual bool endObject() { return true; }
+  virtual bool beginArray() { return true; }
+  virtual bool endArray() { return true; }
+  // A null, bool, number or string.
+  virtual bool scalar(const Value & /*value*/) { return true; }
+};
+
+/**
+ * Streams a JSON text to a Handler without building a document, so memory
+ * does not grow with the input. Escaped strings are decoded into a buffer
+ * the reader keeps between reads.
+ */
+class Reader {
+public:
+  bool read(std::string_view text, Handler *handler, std::string *out_error);
+
+private:
+  std::string scratch_;
+};
+
+/**
+ * Appends JSON to a buffer that clear() empties without releasing, so
+ * writing a document of a familiar size does not allocate. Members
+ * and values are separated as the writer goes. Pretty writers put ", " and
+ * ": " between items and can break containers over lines; compact writers
+ * write no whitespace at all.
+ */
+class Writer {
+public:
+  explicit Writer(bool pretty = false) : pretty_(pretty) {}
+
+  void clear();
+  const std::string &text() const { return text_; }
+
+  // Multiline containers put each item on its own indented line.
+  void beginObject(bool multiline = false);
+  void endObject();
+  void beginArray(bool multiline = false);
+  void endArray();
+  void key(std::string_view name);
+
+  void stringValue(std::string_view value);
+  // Six significant digits; NaN and infinity, which JSON lacks, as null.
+  void numberValue(double value);
+  void unsignedValue(uint64_t value);
+  void boolValue(bool value);
+  void nullValue();
+
+private:
+  static constexpr size_t kMaxDepth = 16;
+
+  struct Frame {
+    bool multiline = false;
+    bool empty = true;
+  };
+
+  void beforeValue();
+  void begin(char bracket, bool multiline);
+  void end(char bracket);
+  void newline(size_t depth);
+
+  std::string text_;
+  std::array<Frame, kMaxDepth> frames_{};
+  size_t depth_ = 0;
+  bool after_key_ = false;
+  bool pretty_;
 };
 
-bool Parse(std::string_view text, Value *out_value, std::string *out_error);
+// Appends `input` to *out with JSON string escaping, without the quotes.
+void AppendEscaped(std::string *out, std::string_view input);
 std::string EscapeString(std::string_view input);
 
 } // namespace xp2gdl90::json
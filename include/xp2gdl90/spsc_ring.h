@@ -0,0 +1,76 @@
+#ifndef XP2GDL90_SPSC_RING_H
+#define XP2GDL90_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace udp {
+
+/**
+ * Bounded lock-free ring for exactly one producer thread and one consumer
+ * thread. Slots are preallocated; the producer fills one in place and
+ * publishes it, the consumer reads in place and releases it.
+ */
+template <typename T> class SpscRing {
+public:
+  explicit SpscRing(size_t capacity)
+      : slots_(RoundUpPowerOfTwo(capacity)), mask_(slots_.size() - 1) {}
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  size_t capacity() const { return slots_.size(); }
+
+  // Producer side.
+  size_t freeSlots() const {
+    return capacity() - (head_.load(std::memory_order_relaxed) -
+                         tail_.load(std::memory_order_acquire));
+  }
+  // Returns the next slot to fill, or nullptr when the ring is full.
+  T *producerSlot() {
+    return freeSlots() > 0
+               ? &slots_[head_.load(std::memory_order_relaxed) & mask_]
+               : nullptr;
+  }
+  void publish() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+
+  // Consumer side.
+  size_t readable() const {
+    return head_.load(std::memory_order_acquire) -
+           tail_.load(std::memory_order_relaxed);
+  }
+  const T &peek(size_t index) const {
+    return slots_[(tail_.load(std::memory_order_relaxed) + index) & mask_];
+  }
+  // For consumers that work in the slot before releasing it.
+  T &peek(size_t index) {
+    return slots_[(tail_.load(std::memory_order_relaxed) + index) & mask_];
+  }
+  void release(size_t count) {
+    tail_.store(tail_.load(std::memory_order_relaxed) + count,
+                std::memory_order_release);
+  }
+
+private:
+  static size_t RoundUpPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  std::vector<T> slots_;
+  size_t mask_;
+  // Separate cache lines so the two threads do not false-share the indices.
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+};
+
+} // namespace udp
+
+#endif // XP2GDL90_SPSC_RING_H
@@ -0,0 +1,145 @@
+#ifndef XP2GDL90_STAGE_TIMING_H
+#define XP2GDL90_STAGE_TIMING_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Per-tick timing of the flight loop stages. A scoped timer adds its
+ * exclusive time (time spent in nested timers is left to those) to the
+ * current tick, and endTick() records every stage that ran into a log
+ * histogram. Building with XP2GDL90_STAGE_TIMING=0 compiles the
+ * XP2GDL90_STAGE_TIMER macro out.
+ */
+
+#ifndef XP2GDL90_STAGE_TIMING
+#define XP2GDL90_STAGE_TIMING 1
+#endif
+
+namespace xp2gdl90 {
+
+enum class Stage : uint8_t {
+  CLOCK = 0,
+  DISCOVERY = 1,
+  SIM_READ = 2,
+  TRAFFIC = 3,
+  ENCODE = 4,
+  SEND = 5,
+};
+constexpr size_t STAGE_COUNT = 6;
+const char *StageName(Stage stage);
+// Lower snake case name for datarefs and metrics, e.g. "sim_read".
+const char *StageKey(Stage stage);
+
+// Four buckets per power of two of nanoseconds, up to 2^36 ns (about 69 s),
+// so a bucket spans at most a quarter of its lower edge.
+constexpr size_t LATENCY_HISTOGRAM_BUCKETS = 144;
+
+class LatencyHistogram {
+public:
+  void record(uint64_t ns);
+  void reset() { *this = LatencyHistogram{}; }
+
+  uint64_t count() const { return count_; }
+  uint64_t maxNs() const { return max_ns_; }
+  // Upper edge of the bucket holding the `fraction` quantile, capped at the
+  // maximum; 0 when empty.
+  uint64_t percentileNs(double fraction) const;
+  uint64_t bucketCount(size_t bucket) const { return buckets_[bucket]; }
+
+  static size_t bucketIndex(uint64_t ns);
+  static uint64_t bucketUpperNs(size_t bucket);
+
+private:
+  std::array<uint64_t, LATENCY_HISTOGRAM_BUCKETS> buckets_{};
+  uint64_t count_ = 0;
+  uint64_t max_ns_ = 0;
+};
+
+class ScopedStageTimer;
+
+class StageTimings {
+public:
+  // Adds `ns` to `stage` in the current tick.
+  void add(Stage stage, uint64_t ns) {
+    const size_t index = static_cast<size_t>(stage);
+    tick_ns_[index] += ns;
+    ran_mask_ |= static_cast<uint8_t>(1u << index);
+  }
+  // Records each stage that ran since the last call and starts a new tick.
+  void endTick();
+  void reset();
+
+  const LatencyHistogram &histogram(Stage stage) const {
+    return histograms_[static_cast<size_t>(stage)];
+  }
+  uint64_t ticks() const { return ticks_; }
+  // Sum of the stages of the tick the last endTick() closed.
+  uint64_t lastTickNs() const { return last_tick_ns_; }
+
+private:
+  friend class ScopedStageTimer;
+
+  std::array<uint64_t, STAGE_COUNT> tick_ns_{};
+  std::array<LatencyHistogram, STAGE_COUNT> histograms_{};
+  ScopedStageTimer *active_ = nullptr;
+  uint64_t ticks_ = 0;
+  uint64_t last_tick_ns_ = 0;
+  uint8_t ran_mask_ = 0;
+};
+
+// Times its scope into `timings` (which may be null) on one thread.
+class ScopedStageTimer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  ScopedStageTimer(StageTimings *timings, Stage stage)
+      : timings_(timings), stage_(stage) {
+    if (timings_) {
+      parent_ = timings_->active_;
+      timings_->active_ = this;
+      start_ = Clock::now();
+    }
+  }
+
+  ~ScopedStageTimer() {
+    if (!timings_) {
+      return;
+    }
+    const uint64_t elapsed = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                             start_)
+            .count());
+    timings_->add(stage_, elapsed > nested_ns_ ? elapsed - nested_ns_ : 0);
+    if (parent_) {
+      parent_->nested_ns_ += elapsed;
+    }
+    timings_->active_ = parent_;
+  }
+
+  ScopedStageTimer(const ScopedStageTimer &) = delete;
+  ScopedStageTimer &operator=(const ScopedStageTimer &) = delete;
+
+private:
+  StageTimings *timings_;
+  Stage stage_;
+  ScopedStageTimer *parent_ = nullptr;
+  Clock::time_point start_;
+  uint64_t nested_ns_ = 0;
+};
+
+} // namespace xp2gdl90
+
+#define XP2GDL90_STAGE_CONCAT_INTERNAL(a, b) a##b
+#define XP2GDL90_STAGE_CONCAT(a, b) XP2GDL90_STAGE_CONCAT_INTERNAL(a, b)
+#if XP2GDL90_STAGE_TIMING
+#define XP2GDL90_STAGE_TIMER(timings, stage)                                   \
+  ::xp2gdl90::ScopedStageTimer XP2GDL90_STAGE_CONCAT(stage_timer_, __LINE__)( \
+      timings, stage)
+#else
+#define XP2GDL90_STAGE_TIMER(timings, stage) ((void)0)
+#endif
+
+#endif // XP2GDL90_STAGE_TIMING_H
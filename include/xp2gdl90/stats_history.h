@@ -0,0 +1,78 @@
+#ifndef XP2GDL90_STATS_HISTORY_H
+#define XP2GDL90_STATS_HISTORY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "xp2gdl90/stage_timing.h"
+
+/**
+ * A few minutes of once-a-second samples of the stream for the stats
+ * windows' sparklines. Every ring is a fixed array, so recording allocates
+ * nothing and a copy is a plain memcpy.
+ */
+
+namespace xp2gdl90 {
+
+// Five minutes at one sample a second.
+constexpr size_t STATS_HISTORY_SAMPLES = 300;
+constexpr double STATS_HISTORY_INTERVAL_S = 1.0;
+
+enum class StatsSeries : uint8_t {
+  FRAMES_PER_S = 0,
+  BYTES_PER_S = 1,
+  TARGETS = 2,
+  TICK_P99_US = 3,
+  SEND_ERRORS = 4,
+};
+constexpr size_t STATS_SERIES_COUNT = 5;
+const char *StatsSeriesName(StatsSeries series);
+
+// What a front end reads each tick. Frames, bytes and errors are running
+// totals; targets is the current count.
+struct StatsCounters {
+  uint64_t frames = 0;
+  uint64_t bytes = 0;
+  uint64_t send_errors = 0;
+  uint32_t targets = 0;
+};
+
+class StatsHistory {
+public:
+  // Adds one tick's duration to the current sample.
+  void recordTick(uint64_t tick_ns) { tick_ns_.record(tick_ns); }
+  // Takes a sample once STATS_HISTORY_INTERVAL_S has passed since the last
+  // one, turning the totals' growth into per-second rates. The first call,
+  // a clock going backwards or totals that shrank only set a new baseline.
+  // Returns true when a sample was taken.
+  bool update(double now, const StatsCounters &counters);
+  void reset();
+
+  // Samples held, up to STATS_HISTORY_SAMPLES.
+  size_t size() const { return size_; }
+  // The ring of `series` and the index of its oldest sample, in the form
+  // ImGui::PlotLines takes.
+  const float *data(StatsSeries series) const {
+    return values_[static_cast<size_t>(series)].data();
+  }
+  size_t offset() const { return size_ < STATS_HISTORY_SAMPLES ? 0 : head_; }
+  // Sample `i` of `series`, oldest first.
+  float value(StatsSeries series, size_t i) const;
+  float latest(StatsSeries series) const;
+  float peak(StatsSeries series) const;
+
+private:
+  std::array<std::array<float, STATS_HISTORY_SAMPLES>, STATS_SERIES_COUNT>
+      values_{};
+  size_t head_ = 0;
+  size_t size_ = 0;
+  bool has_baseline_ = false;
+  double last_time_ = 0.0;
+  StatsCounters last_;
+  LatencyHistogram tick_ns_;
+};
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_STATS_HISTORY_H
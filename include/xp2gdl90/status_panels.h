@@ -0,0 +1,22 @@
+#ifndef XP2GDL90_STATUS_PANELS_H
+#define XP2GDL90_STATUS_PANELS_H
+
+#include "xp2gdl90/stage_timing.h"
+#include "xp2gdl90/stats_history.h"
+
+/**
+ * ImGui panels both status windows draw the same way. Built into each front
+ * end next to its ImGui backend rather than into the core library, which
+ * does not link ImGui.
+ */
+
+namespace xp2gdl90 {
+
+// Per-tick stage times from the flight loop timers.
+void DrawStageTimings(const StageTimings &timings);
+// Sparklines of the last few minutes of the stream.
+void DrawStatsHistory(const StatsHistory &history);
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_STATUS_PANELS_H
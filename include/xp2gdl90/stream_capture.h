@@ -0,0 +1,131 @@
+#ifndef XP2GDL90_STREAM_CAPTURE_H
+#define XP2GDL90_STREAM_CAPTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "xp2gdl90/frame_buffer.h"
+
+/**
+ * Records every datagram the broadcaster puts on the wire into a fixed-size
+ * memory-mapped ring file. The file is a nanosecond pcap (LINKTYPE_USER0)
+ * of equal-sized records, so it opens in Wireshark and tcpdump at any
+ * point, wrapped or not. Recording is a memcpy into the mapping; a
+ * background thread flushes it to disk.
+ */
+
+namespace udp {
+
+// Each record's data: a CaptureRecordHeader, then up to CAPTURE_FRAME_BYTES
+// of frames, zero padded. Packed datagrams are split at frame boundaries.
+constexpr size_t CAPTURE_FRAME_BYTES = gdl90::FRAME_BUFFER_CAPACITY + 2;
+constexpr uint32_t CAPTURE_LINKTYPE = 147; // LINKTYPE_USER0
+constexpr size_t CAPTURE_MIN_BYTES = 64 * 1024;
+
+struct CaptureRecordHeader {
+  // Starts at 1; 0 marks a slot never written.
+  uint32_t sequence = 0;
+  uint8_t destination = 0;
+  // CAPTURE_FLAG_* bits.
+  uint8_t flags = 0;
+  uint16_t size = 0;
+};
+
+static_assert(sizeof(CaptureRecordHeader) == 8, "record header is 8 bytes");
+
+// The data stops mid-frame and continues in the next record.
+constexpr uint8_t CAPTURE_FLAG_SPLIT = 0x01;
+constexpr size_t CAPTURE_RECORD_DATA =
+    sizeof(CaptureRecordHeader) + CAPTURE_FRAME_BYTES;
+
+struct StreamCaptureStats {
+  uint64_t records = 0;
+  uint64_t bytes = 0;
+  // Times the ring lapped and started overwriting its oldest records.
+  uint64_t wraps = 0;
+  uint64_t split = 0;
+  uint64_t flushes = 0;
+  size_t slots = 0;
+  // Datagrams a full queue turned away, and what is on disk; compact
+  // captures only.
+  uint64_t dropped = 0;
+  uint64_t file_bytes = 0;
+};
+
+// Where the broadcaster records what it sends.
+class CaptureSink {
+public:
+  virtual ~CaptureSink() = default;
+  // Copies one datagram sent to `destination`. Call from one thread at a
+  // time, as with the broadcaster's sends.
+  virtual void record(const uint8_t *data, size_t size,
+                      uint32_t destination) = 0;
+  virtual StreamCaptureStats stats() const = 0;
+  virtual const std::string &path() const = 0;
+};
+
+class StreamCapture final : public CaptureSink {
+public:
+  StreamCapture() = default;
+  ~StreamCapture() override;
+
+  StreamCapture(const StreamCapture &) = delete;
+  StreamCapture &operator=(const StreamCapture &) = delete;
+
+  // Creates or overwrites `path` with a ring of at most `bytes` (at least
+  // CAPTURE_MIN_BYTES) and starts the flush thread.
+  bool open(const std::string &path, size_t bytes, std::string *out_error);
+  // Flushes synchronously, stops the thread and unmaps the file.
+  void close();
+  bool isOpen() const { return base_ != nullptr; }
+  const std::string &path() const override { return path_; }
+
+  void record(const uint8_t *data, size_t size,
+              uint32_t destination) override;
+
+  StreamCaptureStats stats() const override;
+
+private:
+  void writeSlot(const uint8_t *data, size_t size, uint32_t destination,
+                 uint8_t flags, int64_t timestamp_ns);
+  void run();
+  bool mapFile(const std::string &path, size_t bytes, std::string *out_error);
+  void unmapFile();
+  void flush(bool synchronous);
+
+  std::string path_;
+  uint8_t *base_ = nullptr;
+  size_t mapped_bytes_ = 0;
+  size_t slot_count_ = 0;
+  size_t next_slot_ = 0;
+  uint32_t sequence_ = 0;
+  // Wall-clock time at open plus the monotonic time since, so timestamps
+  // read as dates but never step.
+  int64_t wall_base_ns_ = 0;
+  std::chrono::steady_clock::time_point steady_base_;
+#ifdef _WIN32
+  void *file_ = nullptr;
+  void *mapping_ = nullptr;
+#endif
+
+  std::atomic<uint64_t> records_{0};
+  std::atomic<uint64_t> bytes_{0};
+  std::atomic<uint64_t> wraps_{0};
+  std::atomic<uint64_t> split_{0};
+  std::atomic<uint64_t> flushes_{0};
+
+  std::thread thread_;
+  bool stop_requested_ = false;
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+};
+
+} // namespace udp
+
+#endif // XP2GDL90_STREAM_CAPTURE_H
@@ -0,0 +1,143 @@
+#ifndef XP2GDL90_TASK_POOL_H
+#define XP2GDL90_TASK_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace xp2gdl90 {
+
+/**
+ * A few helper threads for splitting a loop into chunks. Every participant,
+ * the calling thread included, starts on an even share of the chunks and
+ * takes them from the front one at a time; one that runs dry steals the back
+ * half of the fullest share left. Uneven chunks (rows that need an exact
+ * conversion, targets that miss the frame cache) therefore balance out
+ * without a shared queue.
+ *
+ * Without helper threads every chunk runs on the caller. Callers on
+ * different threads take turns.
+ */
+class TaskPool {
+public:
+  TaskPool() = default;
+  ~TaskPool();
+
+  TaskPool(const TaskPool &) = delete;
+  TaskPool &operator=(const TaskPool &) = delete;
+
+  // Starts `threads` helpers, replacing any running ones.
+  bool start(size_t threads, std::string *out_error);
+  void stop();
+  size_t threads() const { return threads_.size(); }
+
+  // Calls fn(begin, end) once for each chunk of [0, count). Chunks are
+  // `grain` items long except the last and start at multiples of it, so
+  // begin / grain numbers them. Returns after every chunk is done; fn must
+  // not throw.
+  template <typename Fn> void parallelFor(size_t count, size_t grain, Fn &&fn) {
+    using Body = std::remove_reference_t<Fn>;
+    run(
+        count, grain,
+        [](void *body, size_t begin, size_t end) {
+          (*static_cast<Body *>(body))(begin, end);
+        },
+        &fn);
+  }
+
+  // Chunk ranges taken from another participant, since start.
+  uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+  using ChunkFn = void (*)(void *body, size_t begin, size_t end);
+
+  // The participant's remaining chunks, begin in the high half.
+  struct alignas(64) Lane {
+    std::atomic<uint64_t> chunks{0};
+  };
+
+  void run(size_t count, size_t grain, ChunkFn fn, void *body);
+  void threadMain(size_t lane);
+  // Runs chunks from `lane`, then stolen ones, until none are left.
+  void work(size_t lane);
+  void runChunk(size_t chunk);
+
+  std::vector<std::thread> threads_;
+  // One per helper, then the caller's.
+  std::unique_ptr<Lane[]> lanes_;
+  std::atomic<uint64_t> steals_{0};
+
+  // Held for a whole parallelFor.
+  std::mutex run_mutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  bool stop_requested_ = false;
+  // Helpers join a job only while it is open.
+  bool job_open_ = false;
+  uint64_t generation_ = 0;
+  size_t active_ = 0;
+
+  // The open job; written before it opens.
+  ChunkFn fn_ = nullptr;
+  void *body_ = nullptr;
+  size_t count_ = 0;
+  size_t grain_ = 1;
+};
+
+/**
+ * Per-chunk outputs of a parallelFor, appended to in place and merged in
+ * chunk order, so the result does not depend on which thread ran which
+ * chunk. The chunk vectors keep their capacity between uses.
+ */
+template <typename T> class ChunkBuffers {
+public:
+  // Empties the first `chunks` buffers for a new loop.
+  void reset(size_t chunks) {
+    if (chunks_.size() < chunks) {
+      chunks_.resize(chunks);
+    }
+    used_ = chunks;
+    for (size_t i = 0; i < used_; ++i) {
+      chunks_[i].clear();
+    }
+  }
+  std::vector<T> &operator[](size_t chunk) { return chunks_[chunk]; }
+  size_t size() const { return used_; }
+
+  // Appends the items to *out in chunk order, stopping after `limit`, and
+  // returns how many were appended.
+  size_t appendTo(std::vector<T> *out,
+                  size_t limit = std::numeric_limits<size_t>::max()) const {
+    size_t total = 0;
+    for (size_t i = 0; i < used_; ++i) {
+      total += chunks_[i].size();
+    }
+    total = (std::min)(total, limit);
+    out->reserve(out->size() + total);
+    size_t left = total;
+    for (size_t i = 0; i < used_ && left > 0; ++i) {
+      const size_t take = (std::min)(left, chunks_[i].size());
+      out->insert(out->end(), chunks_[i].begin(), chunks_[i].begin() + take);
+      left -= take;
+    }
+    return total;
+  }
+
+private:
+  std::vector<std::vector<T>> chunks_;
+  size_t used_ = 0;
+};
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_TASK_POOL_H
@@ -0,0 +1,98 @@
+#ifndef XP2GDL90_TCAS_TRAFFIC_H
+#define XP2GDL90_TCAS_TRAFFIC_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/traffic_projection.h"
+#include "xp2gdl90/traffic_selection.h"
+#include "xp2gdl90/traffic_snapshot.h"
+
+/**
+ * X-Plane TCAS traffic from a snapshot of the sim/cockpit2/tcas arrays to
+ * GDL90 traffic reports. Nothing here touches the SDK, so the plugin and
+ * offline tools run the same code over live or recorded arrays.
+ */
+
+namespace xp2gdl90::traffic {
+
+// Values of sim/cockpit2/tcas/targets/ssr_mode.
+enum class TcasSsrMode : int {
+  Off = 0,
+  Standby = 1,
+  ModeA = 2,
+  ModeC = 3,
+  Test = 4,
+  Ground = 5,
+  TaOnly = 6,
+  TaRa = 7,
+};
+
+bool TcasSsrModeHasAltitude(int ssr_mode);
+bool TcasSsrModeIndicatesGround(int ssr_mode);
+// Bit 31 of mode_s_id marks a real ICAO address.
+gdl90::AddressType ResolveTcasAddressType(int raw_address);
+// 7500, 7600 and 7700 map to their GDL90 emergency codes; others to 0.
+uint8_t EmergencyCodeFromSquawk(int squawk);
+gdl90::EmitterCategory WakeCategoryToEmitterCategory(int wake_category);
+// "V" and the address in hex, for targets without an identity.
+gdl90::Callsign FallbackTrafficCallsign(uint32_t address);
+// True track from the local-frame velocity while moving, else the heading,
+// else invalid.
+void ResolveTrafficTrack(float vx, float vz, float heading_deg,
+                         uint16_t *out_track, gdl90::TrackType *out_type);
+
+// Exact conversion for rows the projection left in local coordinates; the
+// plugin passes one built on XPLMLocalToWorld.
+using LocalToWorldFn = bool (*)(double x, double y, double z,
+                                double *out_latitude, double *out_longitude,
+                                int32_t *out_altitude_feet);
+
+struct TcasReportContext {
+  uint8_t nic = 0;
+  uint8_t nacp = 0;
+  uint32_t ownship_address = 0;
+  // Without the ssr_mode dataref every target reports its altitude.
+  bool has_ssr_mode = true;
+  // Traffic altitudes are corrected by ownship's pressure/geometric offset;
+  // a NaN pressure altitude leaves them geometric.
+  double ownship_geometric_ft = NAN;
+  double ownship_pressure_ft = NAN;
+  LocalToWorldFn local_to_world = nullptr;
+};
+
+// Builds the report for one row after the address, selection, velocity and
+// projection passes have run. Returns false for rows that are not valid or
+// have no position.
+bool BuildTcasTrafficReport(const TcasReportContext &context,
+                            const TrafficSnapshot &snapshot, size_t slot,
+                            gdl90::PositionData *out_report);
+
+// Converts the populated target rows a projection of `max_radius_m` around
+// `anchor` would leave in local coordinates with `local_to_world`, setting
+// TRAFFIC_FLAG_EXACT on each. For the simulator thread, before a sweep
+// goes to a worker that cannot call the simulator. Returns the number of
+// rows converted.
+size_t ConvertDistantTcasTraffic(const ProjectionAnchor &anchor,
+                                 double max_radius_m,
+                                 LocalToWorldFn local_to_world,
+                                 TrafficSnapshot *snapshot);
+
+// Runs the batch passes over a freshly read snapshot (row 0 is ownship),
+// projects the nearby rows from `projection` when one is given, and
+// replaces `out_reports` with one report per selected target. Returns the
+// number of reports.
+size_t CollectTcasTraffic(const TrafficSelection &selection,
+                          const TcasReportContext &context,
+                          const LocalProjection *projection,
+                          double projection_radius_m,
+                          TrafficSnapshot *snapshot,
+                          std::vector<TrafficCandidate> *candidates,
+                          std::vector<gdl90::PositionData> *out_reports);
+
+} // namespace xp2gdl90::traffic
+
+#endif // XP2GDL90_TCAS_TRAFFIC_H
@@ -0,0 +1,117 @@
+#ifndef XP2GDL90_THREAD_TUNING_H
+#define XP2GDL90_THREAD_TUNING_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "xp2gdl90/settings.h"
+
+/**
+ * Scheduling of the pipeline's worker threads. A worker applies its tuning
+ * to itself, so the simulator thread only ever posts one; each worker also
+ * measures how long it takes to wake once handed work, which is the part
+ * of send jitter the scheduler adds.
+ */
+
+namespace xp2gdl90 {
+
+// HIGH is the MMCSS "Pro Audio" task on Windows, the user-interactive QoS
+// class on macOS and nice -10 on Linux. TIME_CRITICAL is
+// THREAD_PRIORITY_TIME_CRITICAL on Windows and SCHED_FIFO on Linux; macOS
+// has no stronger class for apps and treats it as HIGH. Raising a priority
+// on Linux needs CAP_SYS_NICE or a matching RLIMIT_NICE/RLIMIT_RTPRIO.
+enum class ThreadPriority : uint8_t {
+  NORMAL = 0,
+  HIGH = 1,
+  TIME_CRITICAL = 2,
+};
+
+struct ThreadTuning {
+  ThreadPriority priority = ThreadPriority::NORMAL;
+  // Bit n allows logical CPU n. 0 lets the thread run anywhere. Not
+  // supported on macOS.
+  uint32_t cpu_mask = 0;
+
+  bool operator==(const ThreadTuning &other) const {
+    return priority == other.priority && cpu_mask == other.cpu_mask;
+  }
+  bool operator!=(const ThreadTuning &other) const {
+    return !(*this == other);
+  }
+};
+
+const char *ThreadPriorityName(ThreadPriority priority);
+// The tuning every worker thread takes from the settings.
+ThreadTuning MakeWorkerThreadTuning(const Settings &cfg);
+
+// Applies `tuning` to the calling thread. Returns false with the reason if
+// any part failed; the parts that succeeded stay applied.
+bool ApplyThreadTuning(const ThreadTuning &tuning, std::string *out_error);
+
+/**
+ * A tuning posted from any thread for a worker to apply to itself at its
+ * next wake.
+ */
+class ThreadTuningSlot {
+public:
+  void set(const ThreadTuning &tuning);
+  // Worker side: applies a tuning posted since the last call. Returns false
+  // if applying it failed.
+  bool applyPending();
+
+  // False once a tuning failed to apply, until one applies cleanly.
+  bool ok() const;
+  std::string lastError() const;
+
+private:
+  mutable std::mutex mutex_;
+  ThreadTuning pending_;
+  ThreadTuning applied_;
+  std::atomic<bool> changed_{false};
+  std::string last_error_;
+};
+
+struct WakeLatencyStats {
+  uint64_t samples = 0;
+  uint64_t sum_us = 0;
+  uint64_t max_us = 0;
+  uint64_t last_us = 0;
+
+  double averageUs() const {
+    return samples > 0 ? static_cast<double>(sum_us) /
+                             static_cast<double>(samples)
+                       : 0.0;
+  }
+};
+
+/**
+ * How long a worker takes to run once work is handed to it. The producer
+ * marks the handoff; the worker records the time since the mark when its
+ * wait ends for that work.
+ */
+class WakeLatencyMeter {
+public:
+  // Producer side. Keeps an earlier mark the worker has not woken for.
+  void notified(int64_t now_ns);
+  // Worker side, after each wait. A wait that timed out with nothing to do
+  // drops the mark, so a handoff the worker already drained is not counted.
+  void woke(int64_t now_ns, bool for_work);
+  // Records a latency measured some other way, such as how late a timed
+  // wait returned.
+  void record(int64_t latency_ns);
+
+  WakeLatencyStats stats() const;
+
+private:
+  std::atomic<int64_t> marked_ns_{0};
+  std::atomic<uint64_t> samples_{0};
+  std::atomic<uint64_t> sum_us_{0};
+  std::atomic<uint64_t> max_us_{0};
+  std::atomic<uint64_t> last_us_{0};
+};
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_THREAD_TUNING_H
@@ -0,0 +1,50 @@
+#ifndef XP2GDL90_TRACK_HISTORY_H
+#define XP2GDL90_TRACK_HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace xp2gdl90::traffic {
+
+constexpr size_t TRACK_HISTORY_SAMPLES = 8;
+
+/**
+ * The last TRACK_HISTORY_SAMPLES time-stamped positions of one target, the
+ * oldest overwritten first. Fixed size, so a table of them only allocates
+ * when a track is added. Columns let the fit load two slots at a time.
+ */
+struct TrackHistory {
+  double time[TRACK_HISTORY_SAMPLES] = {};
+  double latitude_deg[TRACK_HISTORY_SAMPLES] = {};
+  double longitude_deg[TRACK_HISTORY_SAMPLES] = {};
+  // NaN for a sample without an altitude.
+  double altitude_ft[TRACK_HISTORY_SAMPLES] = {};
+  uint8_t count = 0;
+  uint8_t next = 0;
+
+  void push(double sample_time, double latitude, double longitude,
+            double altitude);
+  void clear() { count = next = 0; }
+};
+
+struct TrackTrend {
+  bool has_velocity = false;
+  double ground_speed_mps = 0.0;
+  double track_deg = 0.0; // True, 0-360.
+  bool has_vertical_rate = false;
+  double vertical_rate_fpm = 0.0;
+};
+
+// Least-squares velocity through the history's samples, in an east-north
+// frame around the newest one. Horizontal and vertical parts each need
+// three samples spanning at least `min_span_s`. Returns false if neither
+// does. The sums use SSE2 on x86_64 and NEON on arm64, two samples at a
+// time; the scalar variant is the reference and matches to rounding.
+bool FitTrackTrend(const TrackHistory &history, double min_span_s,
+                   TrackTrend *out_trend);
+bool FitTrackTrendScalar(const TrackHistory &history, double min_span_s,
+                         TrackTrend *out_trend);
+
+} // namespace xp2gdl90::traffic
+
+#endif // XP2GDL90_TRACK_HISTORY_H
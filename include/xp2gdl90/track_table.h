@@ -0,0 +1,105 @@
+#ifndef XP2GDL90_TRACK_TABLE_H
+#define XP2GDL90_TRACK_TABLE_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "xp2gdl90/track_history.h"
+#include "xp2gdl90/traffic_grid.h"
+#include "xp2gdl90/traffic_snapshot.h"
+
+namespace xp2gdl90::traffic {
+
+struct TrackInfo {
+  uint32_t key = 0; // ICAO address or simulator object ID.
+  double first_seen = 0.0;
+  double last_seen = 0.0;
+  // Number of updates since the track was created.
+  uint32_t generation = 0;
+  // Last position given to setPosition(), NaN until then.
+  double latitude_deg = NAN;
+  double longitude_deg = NAN;
+  // Per-target send schedule, NaN until the scheduler first sees the track.
+  double next_send = NAN;
+  double send_interval = 0.0;
+};
+
+/**
+ * Persistent per-target state, stored densely (index 0..size()-1) with a
+ * flat open-addressing index keyed by TrackInfo::key. Lookups and inserts
+ * are O(1); removal swaps the last track into the freed index, so callers
+ * that keep rows aligned with the dense order pass them to evictStale().
+ * An optional TrafficGrid follows the tracks' positions for range queries,
+ * and an optional TrackHistory per track keeps its recent positions.
+ */
+class TrackTable {
+public:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  // Returns the dense index of `key`, or npos.
+  size_t find(uint32_t key) const;
+  // Creates the track if needed, marks it seen at `now` and returns its
+  // dense index. New tracks always get index size() - 1.
+  size_t upsert(uint32_t key, double now);
+  // Removes tracks not seen for more than `max_age` seconds and, when
+  // `rows` is given, the matching snapshot rows. Returns the count removed.
+  size_t evictStale(double now, double max_age, TrafficSnapshot *rows);
+  // Removes the track for `key` and, when `rows` is given, its snapshot
+  // row. Returns false if there is no such track.
+  bool remove(uint32_t key, TrafficSnapshot *rows);
+  void clear();
+
+  // Enables the spatial grid with cells of about `cell_size_m` and indexes
+  // every positioned track; zero or less disables it.
+  void setGridCellSize(double cell_size_m);
+  bool hasGrid() const { return grid_.enabled(); }
+  void setPosition(size_t index, double latitude_deg, double longitude_deg);
+  void setSchedule(size_t index, double next_send, double send_interval);
+
+  // Keeps a TrackHistory per track from now on, empty for the tracks that
+  // exist; false drops them.
+  void setHistoryEnabled(bool enabled);
+  bool hasHistory() const { return history_enabled_; }
+  // Adds a sample to the track's history, if histories are kept.
+  void pushSample(size_t index, double sample_time, double latitude_deg,
+                  double longitude_deg, double altitude_ft);
+  // Only while hasHistory().
+  const TrackHistory &history(size_t index) const {
+    return histories_[index];
+  }
+  // Appends candidate indices within `radius_m` of the position: grid
+  // neighbours when the grid is enabled, otherwise every track. Returns the
+  // number appended.
+  size_t queryNear(double latitude_deg, double longitude_deg, double radius_m,
+                   std::vector<uint32_t> *out_indices,
+                   GridQueryStats *out_stats) const;
+
+  size_t size() const { return tracks_.size(); }
+  bool empty() const { return tracks_.empty(); }
+  const TrackInfo &track(size_t index) const { return tracks_[index]; }
+  // Bumped whenever tracks are added or removed, i.e. whenever dense
+  // indices may have changed.
+  uint64_t generation() const { return generation_; }
+
+private:
+  size_t home(uint32_t key) const;
+  size_t findSlot(uint32_t key) const;
+  void grow();
+  void removeAt(size_t index);
+
+  std::vector<TrackInfo> tracks_;
+  // Aligned with tracks_ while history_enabled_.
+  std::vector<TrackHistory> histories_;
+  bool history_enabled_ = false;
+  // Dense index + 1 per slot; 0 marks an empty slot.
+  std::vector<uint32_t> slots_;
+  uint32_t shift_ = 32;
+  uint64_t generation_ = 0;
+  TrafficGrid grid_;
+};
+
+} // namespace xp2gdl90::traffic
+
+#endif // XP2GDL90_TRACK_TABLE_H
@@ -0,0 +1,67 @@
+#ifndef XP2GDL90_TRAFFIC_BUILD_H
+#define XP2GDL90_TRAFFIC_BUILD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/task_pool.h"
+#include "xp2gdl90/traffic_selection.h"
+
+namespace gdl90 {
+class TrafficFrameCache;
+} // namespace gdl90
+
+namespace xp2gdl90::traffic {
+
+// Snapshot rows per chunk when a traffic build fans out.
+constexpr size_t TRAFFIC_BUILD_GRAIN = 128;
+// Smaller snapshots are built on the calling thread alone; waking the pool
+// costs more than it saves.
+constexpr size_t TRAFFIC_BUILD_MIN_ROWS = 256;
+// The same for packing reports, which are cheaper per item than rows.
+constexpr size_t TRAFFIC_ENCODE_GRAIN = 32;
+constexpr size_t TRAFFIC_ENCODE_MIN_REPORTS = 128;
+
+/**
+ * A TaskPool and the scratch for fanning one traffic build out over it:
+ * position validity, range measurement, velocity conversion and report
+ * building run per chunk of rows, and reports are packed per chunk. Each
+ * chunk writes only its own rows and buffers, and the buffers are merged in
+ * row order, so the result is the same as a serial build's. Selection stays
+ * on the calling thread; it needs every candidate at once.
+ *
+ * A build keeps one of these between sweeps so that a sweep of a familiar
+ * size does not allocate. Without a pool, or with a small snapshot,
+ * everything runs on the calling thread.
+ */
+struct ParallelTrafficBuild {
+  TaskPool *pool = nullptr;
+  size_t grain = TRAFFIC_BUILD_GRAIN;
+  size_t min_rows = TRAFFIC_BUILD_MIN_ROWS;
+  size_t encode_grain = TRAFFIC_ENCODE_GRAIN;
+  size_t min_reports = TRAFFIC_ENCODE_MIN_REPORTS;
+  ChunkBuffers<TrafficCandidate> candidates;
+  ChunkBuffers<gdl90::PositionData> reports;
+  std::vector<uint8_t> payloads;
+
+  // True when a pass over `rows` rows should be split.
+  bool fansOut(size_t rows) const {
+    return pool && pool->threads() > 0 && rows >= min_rows;
+  }
+  size_t chunks(size_t rows) const { return (rows + grain - 1) / grain; }
+};
+
+// encodeTrafficBatch, with the reports packed across `build`'s pool when
+// there are enough of them. The frames go through `cache` in report order
+// on the calling thread either way.
+size_t EncodeTrafficReports(const gdl90::GDL90Encoder &encoder,
+                            const gdl90::PositionData *reports, size_t count,
+                            gdl90::FrameArena &arena,
+                            gdl90::TrafficFrameCache *cache,
+                            ParallelTrafficBuild *build);
+
+} // namespace xp2gdl90::traffic
+
+#endif // XP2GDL90_TRAFFIC_BUILD_H
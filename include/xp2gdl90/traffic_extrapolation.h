@@ -0,0 +1,28 @@
+#ifndef XP2GDL90_TRAFFIC_EXTRAPOLATION_H
+#define XP2GDL90_TRAFFIC_EXTRAPOLATION_H
+
+#include <vector>
+
+#include "xp2gdl90/gdl90_encoder.h"
+
+namespace xp2gdl90::traffic {
+
+/**
+ * Dead-reckons a report `dt_s` seconds along its track, ground speed and
+ * vertical rate, with `dt_s` clamped to [0, max_horizon_s]. Components
+ * without a valid velocity, and an invalid altitude, stay where they are.
+ * Returns the seconds applied.
+ */
+double ExtrapolateReport(double dt_s, double max_horizon_s,
+                         gdl90::PositionData *report);
+
+// Extrapolates report i by lead_s + i * spacing_s, its send time once the
+// pacer spreads the sweep with that spacing. Returns the largest lead
+// applied.
+double ExtrapolateTrafficReports(double lead_s, double spacing_s,
+                                 double max_horizon_s,
+                                 std::vector<gdl90::PositionData> *reports);
+
+} // namespace xp2gdl90::traffic
+
+#endif // XP2GDL90_TRAFFIC_EXTRAPOLATION_H
@@ -0,0 +1,54 @@
+#ifndef XP2GDL90_TRAFFIC_FRAME_CACHE_H
+#define XP2GDL90_TRAFFIC_FRAME_CACHE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include "xp2gdl90/frame_buffer.h"
+
+namespace gdl90 {
+
+/**
+ * Last framed traffic report per target address. The unframed payload holds
+ * every field already quantized to wire resolution (24-bit lat/lon, 25 ft
+ * altitude, 1 kt / 64 fpm velocity, 8-bit track), so a target whose
+ * payload matches its previous one reuses the cached frame and skips the
+ * CRC and byte stuffing. Traffic reports carry no timestamp, so a match is
+ * always byte-identical.
+ * Targets missing from a whole batch are dropped at endBatch().
+ */
+class TrafficFrameCache {
+public:
+  void beginBatch() { ++batch_; }
+  void endBatch();
+
+  // Writes the framed message for `payload` into `out`, which must hold
+  // MaxFrameSize(size) bytes, and returns the framed length.
+  size_t frame(uint32_t address, const uint8_t *payload, size_t size,
+               uint8_t *out);
+
+  void clear();
+  size_t size() const { return entries_.size(); }
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+private:
+  struct Entry {
+    std::array<uint8_t, FRAME_PAYLOAD_CAPACITY> payload{};
+    std::array<uint8_t, FRAME_BUFFER_CAPACITY> frame{};
+    uint8_t payload_size = 0;
+    uint8_t frame_size = 0;
+    uint64_t batch = 0;
+  };
+
+  std::unordered_map<uint32_t, Entry> entries_;
+  uint64_t batch_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
+} // namespace gdl90
+
+#endif // XP2GDL90_TRAFFIC_FRAME_CACHE_H
@@ -0,0 +1,63 @@
+#ifndef XP2GDL90_TRAFFIC_GRID_H
+#define XP2GDL90_TRAFFIC_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace xp2gdl90::traffic {
+
+// What one range query touched.
+struct GridQueryStats {
+  size_t cells = 0;   // Cells looked up.
+  size_t entries = 0; // Indices returned.
+};
+
+/**
+ * Uniform latitude/longitude grid over dense track indices. Cells are
+ * square in latitude degrees; longitude columns wrap at the antimeridian.
+ * Each index remembers its cell and its slot in that cell, so moves and
+ * removals are O(1).
+ */
+class TrafficGrid {
+public:
+  // Drops every entry. A cell size of zero or less disables the grid.
+  void configure(double cell_size_m);
+  bool enabled() const { return cell_deg_ > 0.0; }
+  void clear();
+
+  // Puts `index` in the cell holding the position, moving it if needed.
+  void place(uint32_t index, double latitude_deg, double longitude_deg);
+  void remove(uint32_t index);
+  // Re-keys `from` as `to`, as after a swap-remove. `to` must not be placed.
+  void renumber(uint32_t from, uint32_t to);
+
+  // Appends every index in the cells overlapping the square around the
+  // position that contains a circle of `radius_m`. Results still need an
+  // exact range check. Returns the number appended.
+  size_t query(double latitude_deg, double longitude_deg, double radius_m,
+               std::vector<uint32_t> *out_indices,
+               GridQueryStats *out_stats) const;
+
+  size_t occupiedCells() const { return cells_.size(); }
+
+private:
+  struct Placement {
+    uint64_t cell = 0;
+    uint32_t slot = 0;
+    bool placed = false;
+  };
+
+  uint64_t cellKey(int64_t row, int64_t column) const;
+
+  double cell_deg_ = 0.0;
+  int64_t rows_ = 0;
+  int64_t columns_ = 0;
+  std::unordered_map<uint64_t, std::vector<uint32_t>> cells_;
+  std::vector<Placement> placements_;
+};
+
+} // namespace xp2gdl90::traffic
+
+#endif // XP2GDL90_TRAFFIC_GRID_H
@@ -0,0 +1,66 @@
+#ifndef XP2GDL90_TRAFFIC_PACER_H
+#define XP2GDL90_TRAFFIC_PACER_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace udp {
+
+// Share of the sweep interval a paced sweep is spread over, leaving headroom
+// so the last slice goes out before the next sweep replaces it.
+constexpr double TRAFFIC_PACING_WINDOW_FRACTION = 0.9;
+
+struct TrafficPacerStats {
+  uint64_t slices = 0; // Releases that sent at least one frame.
+  uint64_t frames = 0;
+  // Frames a new sweep replaced before they were released.
+  uint64_t superseded = 0;
+  size_t last_burst = 0; // Frames in the last slice.
+  size_t max_burst = 0;
+  // Time between consecutive slices; frames within a slice go back to back.
+  double last_gap_s = 0.0;
+  double max_gap_s = 0.0;
+  double gap_sum_s = 0.0;
+  uint64_t gap_samples = 0;
+
+  double averageGapS() const {
+    return gap_samples > 0 ? gap_sum_s / static_cast<double>(gap_samples)
+                           : 0.0;
+  }
+};
+
+/**
+ * Releases one sweep of traffic frames evenly over a time window. The pacer
+ * only tracks indices; the frames stay in the caller's arena until the next
+ * sweep is encoded. Frame i becomes due at start + i * window / count, so the
+ * first frame goes out on the sweep's own tick.
+ */
+class TrafficPacer {
+public:
+  // Begins a sweep of `frame_count` frames. A window of zero or less
+  // releases the whole sweep at once.
+  void start(size_t frame_count, double now, double window_s);
+  // Frames due by `now` that have not been released yet, as the range
+  // [*out_first, *out_first + return value).
+  size_t release(double now, size_t *out_first);
+
+  size_t pending() const { return count_ - next_; }
+  // When the next frame becomes due, or NaN with nothing pending.
+  double nextDue() const;
+  // Drops the current sweep and the statistics.
+  void reset();
+  const TrafficPacerStats &stats() const { return stats_; }
+
+private:
+  size_t count_ = 0;
+  size_t next_ = 0;
+  double start_ = 0.0;
+  double window_ = 0.0;
+  double last_slice_ = NAN;
+  TrafficPacerStats stats_;
+};
+
+} // namespace udp
+
+#endif // XP2GDL90_TRAFFIC_PACER_H
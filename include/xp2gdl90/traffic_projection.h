@@ -0,0 +1,60 @@
+#ifndef XP2GDL90_TRAFFIC_PROJECTION_H
+#define XP2GDL90_TRAFFIC_PROJECTION_H
+
+#include <cstddef>
+
+#include "xp2gdl90/traffic_snapshot.h"
+
+namespace xp2gdl90::traffic {
+
+constexpr double METERS_PER_NAUTICAL_MILE = 1852.0;
+
+// A point in X-Plane local coordinates with its exact geodetic position,
+// normally the ownship converted once per tick. The local frame is a
+// tangent plane at its origin, whose latitude/longitude orient the axes.
+struct ProjectionAnchor {
+  double x = 0.0;
+  double y = 0.0;
+  double z = 0.0;
+  double latitude_deg = 0.0;
+  double longitude_deg = 0.0;
+  double altitude_m = 0.0;
+  double origin_latitude_deg = 0.0;
+  double origin_longitude_deg = 0.0;
+};
+
+/**
+ * Second-order tangent-plane approximation of local-to-geodetic conversion
+ * around an anchor. Below 70 degrees latitude and against an exact
+ * ellipsoidal conversion, the horizontal error stays under 0.5 m within
+ * 10 nm and under 3 m within 20 nm of the anchor, vertical under 0.5 m. It
+ * grows with the cube of the distance, and faster toward the poles.
+ */
+class LocalProjection {
+public:
+  explicit LocalProjection(const ProjectionAnchor &anchor);
+
+  const ProjectionAnchor &anchor() const { return anchor_; }
+  void project(double x, double y, double z, double *out_latitude_deg,
+               double *out_longitude_deg, double *out_altitude_m) const;
+
+private:
+  ProjectionAnchor anchor_;
+  double meridional_radius_ = 0.0;
+  double normal_radius_ = 0.0;
+  double cos_latitude_ = 1.0;
+  double tan_latitude_ = 0.0;
+  // Local x/y/z offsets to east/north/up at the anchor.
+  double rotation_[3][3] = {};
+};
+
+// Projects every TRAFFIC_FLAG_VALID row within `max_radius_m` (horizontal)
+// of the anchor into the latitude/longitude/altitude_ft columns and sets
+// TRAFFIC_FLAG_GEODETIC on it. Rows left without the flag need an exact
+// conversion. Returns the number of rows projected.
+size_t ProjectTrafficSnapshot(const LocalProjection &projection,
+                              double max_radius_m, TrafficSnapshot *snapshot);
+
+} // namespace xp2gdl90::traffic
+
+#endif // XP2GDL90_TRAFFIC_PROJECTION_H
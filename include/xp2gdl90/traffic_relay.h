@@ -0,0 +1,167 @@
+#ifndef XP2GDL90_TRAFFIC_RELAY_H
+#define XP2GDL90_TRAFFIC_RELAY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xp2gdl90/gdl90_decoder.h"
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/spsc_ring.h"
+#include "xp2gdl90/thread_tuning.h"
+#include "xp2gdl90/track_table.h"
+#include "xp2gdl90/traffic_selection.h"
+#include "xp2gdl90/udp_receiver.h"
+
+/**
+ * Relays traffic from an external GDL90 feed, such as a Stratux-style
+ * receiver or another simulator instance, into the traffic this project
+ * sends. A listener thread decodes the feed's traffic reports; the
+ * simulator thread keeps the latest report per ICAO address and merges
+ * them into each sweep so that every address goes out once.
+ */
+
+namespace xp2gdl90::traffic {
+
+// Upper bound on how long stop() waits for the listener thread to notice.
+constexpr int TRAFFIC_RELAY_WAIT_TIMEOUT_MS = 100;
+// Decoded reports queued for takeReports(); further ones until the next
+// take are dropped and counted.
+constexpr size_t TRAFFIC_RELAY_QUEUE_CAPACITY = 1024;
+// Relayed targets not heard from for this long are dropped.
+constexpr double TRAFFIC_RELAY_MAX_AGE_S = 10.0;
+
+// Which copy goes out for a target both the simulator and the feed report.
+enum class RelayPriority : uint8_t {
+  SIMULATOR = 0,
+  RELAY = 1,
+};
+
+struct TrafficRelayStats {
+  uint64_t datagrams = 0;
+  uint64_t reports = 0;    // Traffic reports decoded.
+  uint64_t dropped = 0;    // Decoded while the queue was full.
+  uint64_t bad_frames = 0; // CRC errors and malformed frames.
+};
+
+class TrafficRelayListener {
+public:
+  explicit TrafficRelayListener(
+      std::unique_ptr<udp::UDPReceiver> receiver,
+      int wait_timeout_ms = TRAFFIC_RELAY_WAIT_TIMEOUT_MS);
+  ~TrafficRelayListener();
+
+  TrafficRelayListener(const TrafficRelayListener &) = delete;
+  TrafficRelayListener &operator=(const TrafficRelayListener &) = delete;
+
+  bool start();
+  void stop();
+  bool isRunning() const { return thread_.joinable(); }
+  uint16_t getListenPort() const { return listen_port_; }
+
+  // Waits up to `timeout_ms` for datagrams and queues the traffic reports
+  // in them. The listener thread calls this; without a running thread it
+  // may be called directly. Returns the reports queued, or -1 on error.
+  int pollOnce(int timeout_ms);
+
+  // Moves up to `capacity` queued reports, oldest first, into `out` and
+  // returns how many. Call from one thread only.
+  size_t takeReports(gdl90::PositionData *out, size_t capacity);
+
+  // Safe to call from any thread.
+  TrafficRelayStats stats() const;
+  uint64_t errorCount() const {
+    return error_count_.load(std::memory_order_relaxed);
+  }
+  std::string lastError() const;
+
+  // Applied by the listener thread at its next wake; any thread may call
+  // it.
+  void setThreadTuning(const ThreadTuning &tuning) { tuning_.set(tuning); }
+  std::string threadTuningError() const { return tuning_.lastError(); }
+
+private:
+  void run();
+
+  std::unique_ptr<udp::UDPReceiver> receiver_;
+  uint16_t listen_port_;
+  int wait_timeout_ms_;
+  udp::ReceiveBatch batch_;
+  gdl90::Decoder decoder_;
+
+  udp::SpscRing<gdl90::PositionData> reports_{TRAFFIC_RELAY_QUEUE_CAPACITY};
+  std::atomic<uint64_t> datagrams_{0};
+  std::atomic<uint64_t> decoded_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> bad_frames_{0};
+  std::atomic<uint64_t> error_count_{0};
+  mutable std::mutex error_mutex_;
+  std::string last_error_;
+  ThreadTuningSlot tuning_;
+
+  std::thread thread_;
+  std::atomic<bool> stop_requested_{false};
+};
+
+/**
+ * The latest relayed report per ICAO address, in a TrackTable's dense
+ * order. Simulator thread only.
+ */
+class RelayedTraffic {
+public:
+  // Takes every report the listener has queued. Returns how many.
+  size_t ingest(TrafficRelayListener *listener, double now);
+  void update(const gdl90::PositionData &report, double now);
+  // Drops targets not heard from for more than `max_age` seconds. Returns
+  // the count removed.
+  size_t evictStale(double now, double max_age);
+  void clear();
+
+  size_t size() const { return reports_.size(); }
+  const gdl90::PositionData *data() const { return reports_.data(); }
+  const std::vector<gdl90::PositionData> &reports() const {
+    return reports_;
+  }
+
+private:
+  TrackTable tracks_;
+  std::vector<gdl90::PositionData> reports_;
+};
+
+struct RelayMergeStats {
+  size_t added = 0;    // Relayed targets the simulator did not report.
+  size_t replaced = 0; // Simulator reports the relayed copy replaced.
+};
+
+/**
+ * Merges relayed targets into a sweep's selected reports. A target in both
+ * keeps the copy `priority` names. The rest of the relayed targets are
+ * measured from ownship, held to the selection's range and altitude
+ * limits, and the nearest fill what the simulator left of max_targets.
+ * Keeps its scratch between sweeps.
+ */
+class RelayMerger {
+public:
+  // `ownship` may be null, which keeps the first targets that fit instead.
+  // Reports with `ownship_address` are skipped, so the feed's view of
+  // ownship does not come back as traffic.
+  RelayMergeStats merge(const TrafficSelection &selection,
+                        const TrafficReference *ownship,
+                        RelayPriority priority, uint32_t ownship_address,
+                        const gdl90::PositionData *relayed, size_t count,
+                        std::vector<gdl90::PositionData> *reports);
+
+private:
+  // address << 32 | report index, sorted.
+  std::vector<uint64_t> addresses_;
+  std::vector<TrafficCandidate> candidates_;
+};
+
+} // namespace xp2gdl90::traffic
+
+#endif // XP2GDL90_TRAFFIC_RELAY_H
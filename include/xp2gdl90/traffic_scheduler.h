@@ -0,0 +1,54 @@
+#ifndef XP2GDL90_TRAFFIC_SCHEDULER_H
+#define XP2GDL90_TRAFFIC_SCHEDULER_H
+
+#include <cstddef>
+#include <vector>
+
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/settings.h"
+#include "xp2gdl90/track_table.h"
+#include "xp2gdl90/traffic_projection.h"
+#include "xp2gdl90/traffic_selection.h"
+
+namespace xp2gdl90::traffic {
+
+// How often each target is reported. Intervals grow linearly from the near
+// to the far range; closing targets are rated at their range
+// closure_horizon_s ahead, diverging ones at their range now.
+struct TrafficRatePolicy {
+  double near_range_m = 5.0 * METERS_PER_NAUTICAL_MILE;
+  double far_range_m = 25.0 * METERS_PER_NAUTICAL_MILE;
+  double near_interval_s = 0.5;
+  double far_interval_s = 5.0;
+  double closure_horizon_s = 60.0;
+  // Frames per second across all targets; zero is unlimited.
+  double max_frames_per_second = 0.0;
+};
+
+struct TrafficScheduleStats {
+  size_t due = 0;
+  size_t sent = 0;
+  size_t deferred = 0; // Due but over the frame budget.
+};
+
+TrafficRatePolicy MakeTrafficRatePolicy(const Settings &cfg);
+double TrafficUpdateInterval(const TrafficRatePolicy &policy, double range_m,
+                             double closure_mps);
+
+/**
+ * Upserts a track per report (keyed by icao_address) and keeps only the
+ * reports whose track is due this sweep, in their original order. New
+ * tracks start at a per-address phase within their interval so targets that
+ * appear together do not send together. When more are due than the frame
+ * budget allows, the most overdue relative to their interval go first and
+ * the rest stay due. Returns the number kept.
+ */
+size_t ScheduleTrafficReports(const TrafficRatePolicy &policy,
+                              const TrafficReference &ownship, double now,
+                              double sweep_interval_s, TrackTable *tracks,
+                              std::vector<gdl90::PositionData> *reports,
+                              TrafficScheduleStats *out_stats);
+
+} // namespace xp2gdl90::traffic
+
+#endif // XP2GDL90_TRAFFIC_SCHEDULER_H
@@ -0,0 +1,90 @@
+#ifndef XP2GDL90_TRAFFIC_SELECTION_H
+#define XP2GDL90_TRAFFIC_SELECTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "xp2gdl90/settings.h"
+#include "xp2gdl90/traffic_snapshot.h"
+
+namespace xp2gdl90::traffic {
+
+// Ownship position and velocity in the snapshot's frames. Velocity is metres
+// per second in the X-Plane local frame (+x east, +y up, +z south); NaN
+// components leave every closure at zero.
+struct TrafficReference {
+  double x = 0.0;
+  double y = 0.0;
+  double z = 0.0;
+  double latitude_deg = 0.0;
+  double longitude_deg = 0.0;
+  double altitude_ft = 0.0;
+  double vx = 0.0;
+  double vy = 0.0;
+  double vz = 0.0;
+};
+
+// One target's geometry relative to ownship.
+struct TrafficCandidate {
+  uint32_t row = 0;
+  float range_m = 0.0f;     // Horizontal.
+  float closure_mps = 0.0f; // Positive while the range is shrinking.
+  float altitude_delta_ft = 0.0f;
+  float score = 0.0f;       // Written by SelectNearestTraffic.
+};
+
+// Zero disables a limit.
+struct TrafficSelection {
+  size_t max_targets = 0;
+  double max_range_m = 0.0;
+  double max_altitude_delta_ft = 0.0;
+  // Ranks targets by their range this many seconds ahead at the current
+  // closure rate instead of by their range now.
+  double closure_lookahead_s = 0.0;
+};
+
+// Limits from traffic_max_targets, traffic_range_nm,
+// traffic_altitude_band_ft and traffic_closure_lookahead_s.
+TrafficSelection MakeTrafficSelection(const Settings &cfg);
+
+// Builds a candidate from a target's offset from ownship and its horizontal
+// velocity relative to ownship, both in the local frame. Returns false when
+// the offset is not finite.
+bool MakeTrafficCandidate(uint32_t row, double dx, double dy, double dz,
+                          double dvx, double dvz,
+                          TrafficCandidate *out_candidate);
+// Same, from a target's geodetic position and local-frame velocity.
+bool MeasureGeodeticTarget(uint32_t row, const TrafficReference &ownship,
+                           double latitude_deg, double longitude_deg,
+                           double altitude_ft, double vx, double vz,
+                           TrafficCandidate *out_candidate);
+// Appends a candidate for every TRAFFIC_FLAG_VALID row, measured from the
+// local x/y/z columns (X-Plane) or from latitude/longitude/altitude_ft.
+void MeasureLocalTraffic(const TrafficSnapshot &snapshot,
+                         const TrafficReference &ownship,
+                         std::vector<TrafficCandidate> *out_candidates);
+void MeasureGeodeticTraffic(const TrafficSnapshot &snapshot,
+                            const TrafficReference &ownship,
+                            std::vector<TrafficCandidate> *out_candidates);
+// The same over rows [begin, end) only.
+void MeasureGeodeticTraffic(const TrafficSnapshot &snapshot,
+                            const TrafficReference &ownship, size_t begin,
+                            size_t end,
+                            std::vector<TrafficCandidate> *out_candidates);
+
+// Drops candidates outside the range and altitude limits, then keeps the
+// max_targets with the lowest score using a partial sort, so the pass is
+// linear in the candidate count. The survivors are in no particular order.
+// Returns how many remain.
+size_t SelectNearestTraffic(const TrafficSelection &selection,
+                            std::vector<TrafficCandidate> *candidates);
+// Runs SelectNearestTraffic and clears TRAFFIC_FLAG_VALID on every snapshot
+// row that was not selected, so later passes skip them.
+size_t SelectNearestTraffic(const TrafficSelection &selection,
+                            std::vector<TrafficCandidate> *candidates,
+                            TrafficSnapshot *snapshot);
+
+} // namespace xp2gdl90::traffic
+
+#endif // XP2GDL90_TRAFFIC_SELECTION_H
@@ -0,0 +1,27 @@
+#ifndef XP2GDL90_TRAFFIC_SMOOTHING_H
+#define XP2GDL90_TRAFFIC_SMOOTHING_H
+
+#include <cstddef>
+#include <vector>
+
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/track_table.h"
+
+namespace xp2gdl90::traffic {
+
+// Shortest stretch of history a trend is taken from.
+constexpr double TRAFFIC_SMOOTHING_MIN_SPAN_S = 1.0;
+
+/**
+ * Adds each report's position at `now` to its track's history, creating
+ * the track if needed, then replaces the report's ground speed, true track
+ * and vertical rate with the history's trend where there is one. Below
+ * walking pace the reported track or heading is kept. `tracks` must keep
+ * histories. Returns the number of reports changed.
+ */
+size_t SmoothTrafficReports(double now, double min_span_s, TrackTable *tracks,
+                            std::vector<gdl90::PositionData> *reports);
+
+} // namespace xp2gdl90::traffic
+
+#endif // XP2GDL90_TRAFFIC_SMOOTHING_H
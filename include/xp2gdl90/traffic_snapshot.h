@@ -0,0 +1,84 @@
+#ifndef XP2GDL90_TRAFFIC_SNAPSHOT_H
+#define XP2GDL90_TRAFFIC_SNAPSHOT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "xp2gdl90/callsign.h"
+
+namespace xp2gdl90::traffic {
+
+constexpr size_t TRAFFIC_CALLSIGN_SIZE = gdl90::CALLSIGN_SIZE;
+// NUL-padded, not NUL-terminated.
+using TrafficCallsign = std::array<char, TRAFFIC_CALLSIGN_SIZE>;
+static_assert(sizeof(TrafficCallsign) == TRAFFIC_CALLSIGN_SIZE,
+              "callsign column must be contiguous bytes");
+
+// Bits in TrafficSnapshot::flags.
+constexpr uint8_t TRAFFIC_FLAG_VALID = 1u << 0;
+constexpr uint8_t TRAFFIC_FLAG_ON_GROUND = 1u << 1;
+constexpr uint8_t TRAFFIC_FLAG_SYNTHETIC_ADDRESS = 1u << 2;
+// latitude/longitude/altitude_ft already hold this tick's position.
+constexpr uint8_t TRAFFIC_FLAG_GEODETIC = 1u << 3;
+// The same, from an exact conversion made before the projection pass.
+constexpr uint8_t TRAFFIC_FLAG_EXACT = 1u << 4;
+
+/**
+ * One tick of traffic in structure-of-arrays layout. Front ends fill the
+ * source columns (X-Plane straight from the TCAS dataref arrays, MSFS from
+ * SimConnect dispatch); the batch helpers in traffic_support.h then run
+ * over whole columns.
+ * All columns always have size() elements.
+ */
+struct TrafficSnapshot {
+  void clear() { resize(0); }
+  void resize(size_t count);
+  // Appends a row with default values and returns its index.
+  size_t append();
+  // Moves the last row into `row` and drops the last row.
+  void removeRow(size_t row);
+  size_t size() const { return source_id.size(); }
+  bool empty() const { return source_id.empty(); }
+
+  // Source columns.
+  std::vector<uint32_t> source_id; // TCAS slot or simulator object ID.
+  std::vector<int> raw_address;    // As reported by the simulator.
+  std::vector<float> x;            // Local metres (X-Plane only).
+  std::vector<float> y;
+  std::vector<float> z;
+  // Degrees and feet; X-Plane fills these after local-to-world conversion.
+  std::vector<double> latitude;
+  std::vector<double> longitude;
+  std::vector<double> altitude_ft;
+  // Metres per second in the X-Plane local frame: +x east, +y up, +z south.
+  std::vector<float> vx;
+  std::vector<float> vy;
+  std::vector<float> vz;
+  std::vector<float> ground_speed_kt;    // NaN: derive from vx/vz.
+  std::vector<float> vertical_speed_fpm; // NaN: derive from vy.
+  std::vector<float> heading_deg;
+  std::vector<int> ssr_mode;         // -1 when unknown.
+  std::vector<int> weight_on_wheels; // -1 when unknown.
+  std::vector<int> squawk;
+  std::vector<int> wake_category; // -1 when unknown.
+  std::vector<TrafficCallsign> callsign;
+  std::vector<uint8_t> flags;
+  // Precomputed SyntheticTrafficAddress() for the row; 0 hashes on demand.
+  std::vector<uint32_t> synthetic_address;
+
+  // Derived columns, written by the batch helpers.
+  std::vector<uint32_t> address;
+  std::vector<uint16_t> h_velocity_kt;
+  std::vector<int16_t> v_velocity_fpm;
+};
+
+TrafficCallsign MakeTrafficCallsign(const gdl90::Callsign &callsign);
+gdl90::Callsign ToCallsign(const TrafficCallsign &callsign);
+std::string TrafficCallsignToString(const TrafficCallsign &callsign);
+
+} // namespace xp2gdl90::traffic
+
+#endif // XP2GDL90_TRAFFIC_SNAPSHOT_H
@@ -3,7 +3,10 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <string>
+#include <vector>
+
+#include "xp2gdl90/callsign.h"
+#include "xp2gdl90/traffic_snapshot.h"
 
 namespace xp2gdl90::traffic {
 
@@ -11,7 +14,7 @@ struct TcasPresenceSample {
   size_t slot = 0;
   int raw_address = 0;
   int ssr_mode = 0;
-  std::string callsign;
+  gdl90::Callsign callsign;
   double local_x = 0.0;
   double local_y = 0.0;
   double local_z = 0.0;
@@ -21,12 +24,85 @@ struct TcasPresenceSample {
 };
 
 bool IsPopulatedTcasTarget(const TcasPresenceSample &sample);
-uint32_t SyntheticTrafficAddress(size_t slot, const std::string &callsign,
+uint32_t SyntheticTrafficAddress(size_t slot, const gdl90::Callsign &callsign,
                                  uint32_t ownship_address);
 int32_t CorrectGeometricToPressureAltitude(int32_t geometric_altitude_feet,
                                            double ownship_geometric_feet,
                                            double ownship_pressure_feet);
 
+// Batch helpers over a TrafficSnapshot.
+// Sets TRAFFIC_FLAG_VALID on rows that hold a populated TCAS target (same
+// rules as IsPopulatedTcasTarget, with source_id as the slot). Returns the
+// number of valid rows.
+size_t MarkPopulatedTcasTargets(TrafficSnapshot *snapshot);
+// Sets TRAFFIC_FLAG_VALID on rows with an in-range latitude and longitude.
+size_t MarkValidGeodeticTargets(TrafficSnapshot *snapshot);
+// Fills `address` from the low 24 bits of raw_address, synthesizing one from
+// callsign or slot when that is zero. Rows whose address collides with
+// ownship lose TRAFFIC_FLAG_VALID.
+void AssignTcasAddresses(TrafficSnapshot *snapshot, uint32_t ownship_address);
+// Fills h_velocity_kt and v_velocity_fpm from the velocity columns.
+void ConvertTrafficVelocities(TrafficSnapshot *snapshot);
+
+// The same passes over rows [begin, end) only, for splitting one snapshot
+// across threads.
+size_t MarkValidGeodeticTargets(TrafficSnapshot *snapshot, size_t begin,
+                                size_t end);
+void ConvertTrafficVelocities(TrafficSnapshot *snapshot, size_t begin,
+                              size_t end);
+
+// How often a slot whose mode-S address has not changed resolves its
+// identity again, for injectors that rename a target in place.
+constexpr double TRAFFIC_IDENTITY_REFRESH_S = 2.0;
+
+struct TrafficIdentity {
+  // Flight ID or tail number, trimmed; empty when the slot has neither.
+  TrafficCallsign callsign{};
+  // SyntheticTrafficAddress() of the slot and callsign.
+  uint32_t synthetic_address = 0;
+};
+
+/**
+ * Resolved identity per traffic slot. A target keeps its identity while it
+ * holds a slot, so the flight ID read, trim, tail number fallback and
+ * address hash run only when the slot's mode-S address or the ownship
+ * address changes, or once every refresh_s.
+ */
+class TrafficIdentityCache {
+public:
+  explicit TrafficIdentityCache(double refresh_s = TRAFFIC_IDENTITY_REFRESH_S)
+      : refresh_s_(refresh_s) {}
+
+  // Whether `slot` has to be resolved before get() is used this tick. A
+  // clock that went backwards counts as due.
+  bool needsRefresh(size_t slot, int raw_address, uint32_t ownship_address,
+                    double now_s) const;
+  // Stores what `slot` resolved to and returns the cached entry.
+  const TrafficIdentity &store(size_t slot, int raw_address,
+                               const gdl90::Callsign &callsign,
+                               uint32_t ownship_address, double now_s);
+  // The last stored identity; `slot` must have been stored.
+  const TrafficIdentity &get(size_t slot) const {
+    return entries_[slot].identity;
+  }
+
+  void clear() { entries_.clear(); }
+  uint64_t refreshes() const { return refreshes_; }
+
+private:
+  struct Entry {
+    TrafficIdentity identity;
+    int raw_address = 0;
+    uint32_t ownship_address = 0;
+    double refreshed_s = 0.0;
+    bool stored = false;
+  };
+
+  double refresh_s_;
+  std::vector<Entry> entries_;
+  uint64_t refreshes_ = 0;
+};
+
 } // namespace xp2gdl90::traffic
 
 #endif // XP2GDL90_TRAFFIC_SUPPORT_H
@@ -0,0 +1,185 @@
+#ifndef XP2GDL90_TRAFFIC_WORKER_H
+#define XP2GDL90_TRAFFIC_WORKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xp2gdl90/frame_buffer.h"
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/spsc_ring.h"
+#include "xp2gdl90/tcas_traffic.h"
+#include "xp2gdl90/thread_tuning.h"
+#include "xp2gdl90/track_table.h"
+#include "xp2gdl90/traffic_frame_cache.h"
+#include "xp2gdl90/traffic_projection.h"
+#include "xp2gdl90/traffic_relay.h"
+#include "xp2gdl90/traffic_scheduler.h"
+#include "xp2gdl90/traffic_selection.h"
+#include "xp2gdl90/traffic_smoothing.h"
+#include "xp2gdl90/traffic_snapshot.h"
+
+namespace xp2gdl90::traffic {
+
+// Sweeps each side of the worker can have in flight.
+constexpr size_t TRAFFIC_WORKER_CAPACITY = 2;
+
+// Everything a sweep needs besides the simulator arrays, taken from the
+// settings and the frame on the simulator thread.
+struct TrafficSweepParams {
+  double broadcast_time = 0.0;
+  TrafficSelection selection;
+  TcasReportContext context;
+  // Rows within projection_radius_m of the anchor are projected; the rest
+  // need context.local_to_world, or on the worker an exact conversion from
+  // ConvertDistantTcasTraffic() before the job is submitted.
+  bool anchored = false;
+  ProjectionAnchor anchor;
+  double projection_radius_m = 0.0;
+  // Takes ground speed, track and vertical rate from each target's recent
+  // positions instead of the simulator's velocities.
+  bool smoothing = false;
+  // Without adaptive_rate every report goes out each sweep.
+  bool adaptive_rate = false;
+  TrafficRatePolicy rate_policy;
+  TrafficReference ownship;
+  double sweep_interval_s = 0.0;
+  // Tracks not seen for this long are dropped.
+  double stale_after_s = 0.0;
+  // Report i is extrapolated to its send time, lead_s plus its share of
+  // the pacing window.
+  double lead_s = 0.0;
+  double pacing_window_s = 0.0;
+  double extrapolation_horizon_s = 0.0;
+  // Drops every track first, as after a broadcast clock reset.
+  bool reset_tracks = false;
+  // Targets from the traffic relay, merged into the selected reports.
+  RelayPriority relay_priority = RelayPriority::SIMULATOR;
+  const gdl90::PositionData *relayed = nullptr;
+  size_t relayed_count = 0;
+};
+
+struct TrafficSweepJob {
+  TrafficSweepParams params;
+  // The TCAS arrays with ownship in row 0.
+  TrafficSnapshot snapshot;
+  // The relayed targets; params.relayed points here.
+  std::vector<gdl90::PositionData> relayed;
+};
+
+// One encoded sweep, ready for the pacer.
+struct TrafficSweepResult {
+  double broadcast_time = 0.0;
+  double pacing_window_s = 0.0;
+  // Targets selected, before the scheduler held any back.
+  size_t target_count = 0;
+  // Of those, relayed targets the simulator did not report.
+  size_t relayed_count = 0;
+  // Largest extrapolation applied.
+  double extrapolation_s = 0.0;
+  TrafficScheduleStats schedule;
+  size_t tracked = 0;
+  uint64_t cache_hits = 0;
+  uint64_t cache_misses = 0;
+  gdl90::FrameArena frames;
+};
+
+/**
+ * The part of a traffic sweep after the simulator read: validity, address
+ * synthesis, selection, smoothing, scheduling, extrapolation and encoding. It keeps
+ * the per-target tracks and frames between sweeps, so each thread that
+ * sweeps needs its own.
+ */
+class TrafficSweeper {
+public:
+  // Sweeps the TCAS arrays in `snapshot`, which the batch passes rewrite.
+  void sweep(const TrafficSweepParams &params, TrafficSnapshot *snapshot,
+             TrafficSweepResult *out_result);
+  // Finishes a sweep whose reports are already selected, as from the
+  // legacy multiplayer datarefs. `reports` is rewritten.
+  void finish(const TrafficSweepParams &params,
+              std::vector<gdl90::PositionData> *reports,
+              TrafficSweepResult *out_result);
+  void reset() { tracks_.clear(); }
+
+private:
+  gdl90::GDL90Encoder encoder_;
+  gdl90::TrafficFrameCache frame_cache_;
+  TrackTable tracks_;
+  std::vector<TrafficCandidate> candidates_;
+  std::vector<gdl90::PositionData> reports_;
+  RelayMerger merger_;
+};
+
+/**
+ * Runs a TrafficSweeper on a thread of its own. The simulator thread reads
+ * the TCAS arrays straight into a job slot and submits it; the worker sweeps
+ * it into a result slot that a later flight loop picks up. Both handoffs
+ * are SpscRing slots, so neither thread waits on the other and a sweep of a
+ * familiar size does not allocate.
+ *
+ * The worker cannot call the SDK, so jobs must be anchored and every row is
+ * projected from the anchor rather than converted exactly.
+ */
+class TrafficWorker {
+public:
+  explicit TrafficWorker(size_t capacity = TRAFFIC_WORKER_CAPACITY);
+  ~TrafficWorker();
+
+  TrafficWorker(const TrafficWorker &) = delete;
+  TrafficWorker &operator=(const TrafficWorker &) = delete;
+
+  bool start(std::string *out_error);
+  // Finishes the job in progress, then joins the thread.
+  void stop();
+  bool isRunning() const { return thread_.joinable(); }
+
+  // Producer side, called from the simulator thread only. Returns the next
+  // job to fill, or null while the worker is behind; that sweep is then
+  // skipped.
+  TrafficSweepJob *jobSlot();
+  void submit();
+  // Copies the newest finished sweep to *out_result and drops any older
+  // ones. Returns false if none finished since the last call.
+  bool takeResult(TrafficSweepResult *out_result);
+  // True while a submitted sweep has not been taken.
+  bool busy() const { return submitted_ != taken_; }
+  uint64_t sweepsSkipped() const { return skipped_; }
+
+  // Applied by the worker thread at its next wake; any thread may call it.
+  void setThreadTuning(const ThreadTuning &tuning) { tuning_.set(tuning); }
+  std::string threadTuningError() const { return tuning_.lastError(); }
+  // Submit-to-running latency of the worker thread.
+  WakeLatencyStats wakeLatency() const { return wake_latency_.stats(); }
+
+  // Consumer side. The worker thread calls this; without a running thread
+  // it may be called directly. Returns the number of sweeps done.
+  size_t drain();
+
+private:
+  void run();
+
+  TrafficSweeper sweeper_;
+  udp::SpscRing<TrafficSweepJob> jobs_;
+  udp::SpscRing<TrafficSweepResult> results_;
+  // Simulator thread only.
+  uint64_t submitted_ = 0;
+  uint64_t taken_ = 0;
+  uint64_t skipped_ = 0;
+  WakeLatencyMeter wake_latency_;
+  ThreadTuningSlot tuning_;
+
+  std::thread thread_;
+  std::atomic<bool> stop_requested_{false};
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+};
+
+} // namespace xp2gdl90::traffic
+
+#endif // XP2GDL90_TRAFFIC_WORKER_H
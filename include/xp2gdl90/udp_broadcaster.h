@@ -3,9 +3,13 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <array>
+#include <atomic>
 #include <string>
 #include <vector>
 
+#include "xp2gdl90/bandwidth_limiter.h"
+
 /**
  * UDP Broadcaster for GDL90 messages.
  * Cross-platform UDP socket implementation.
@@ -13,6 +17,43 @@
 
 namespace udp {
 
+class CaptureSink;
+
+// Destination 0 is the primary target; additional ones come from
+// addDestination(). A destination set is a bitmask over these indices.
+constexpr size_t MAX_DESTINATIONS = 8;
+constexpr uint32_t ALL_DESTINATIONS = 0xFFFFFFFFu;
+constexpr uint32_t ALL_MESSAGE_CLASSES = 0xFFFFFFFFu;
+
+// Socket options for destinations with a multicast group address
+// (224.0.0.0/4). One send reaches every receiver that joined the group.
+struct MulticastOptions {
+  // Router hops the datagrams may cross; 1 keeps them on the local subnet.
+  uint8_t ttl = 1;
+  // Address of the outgoing interface; empty lets the routing table choose.
+  std::string interface_ip;
+  // Whether receivers on this host get the datagrams too.
+  bool loopback = false;
+};
+
+// Tuning for the sending socket, applied each time it opens.
+struct SocketOptions {
+  // DiffServ code point for every datagram. Wi-Fi puts EF (46) and CS6 (48)
+  // in the WMM voice queue. 0 leaves the packets unmarked.
+  uint8_t dscp = 0;
+  // SO_SNDBUF in bytes, to ride out traffic bursts; 0 keeps the default.
+  uint32_t send_buffer_bytes = 0;
+  // Local address to send from, for PCs with several interfaces; empty lets
+  // the routing table choose.
+  std::string bind_ip;
+};
+
+// One datagram in a batch send; mirrors struct iovec.
+struct SendBuffer {
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+};
+
 namespace detail {
 
 struct SocketOps {
@@ -25,8 +66,14 @@ struct SocketOps {
   virtual int SetSockOpt(uintptr_t socket, int level, int optname,
                          const void *optval, size_t optlen) = 0;
   virtual int InetPton(int af, const char *src, void *dst) = 0;
+  virtual int Bind(uintptr_t socket, const void *addr, size_t addrlen) = 0;
   virtual intptr_t SendTo(uintptr_t socket, const void *buf, size_t len,
                           int flags, const void *dest_addr, size_t addrlen) = 0;
+  // Sends each buffer as its own datagram and returns how many were sent, or
+  // -1 if none were. The fallback issues one SendTo per buffer.
+  virtual intptr_t SendBatch(uintptr_t socket, const SendBuffer *buffers,
+                             size_t count, int flags, const void *dest_addr,
+                             size_t addrlen);
   virtual int CloseSocket(uintptr_t socket) = 0;
   virtual int LastError() = 0;
 };
@@ -44,23 +91,116 @@ public:
   ~UDPBroadcaster();
 
   bool initialize();
-  int send(const uint8_t *data, size_t size);
+  // Sends to every destination in `destinations`. Returns `size`, 0 if the
+  // set is empty, or -1 if any destination failed.
+  int send(const uint8_t *data, size_t size,
+           uint32_t destinations = ALL_DESTINATIONS);
   int send(const std::vector<uint8_t> &data);
-  void setTarget(const std::string &target_ip, uint16_t target_port);
+  // Returns the number of leading buffers every selected destination
+  // received, or -1 if one of them received none.
+  int sendBatch(const SendBuffer *buffers, size_t count,
+                uint32_t destinations = ALL_DESTINATIONS);
+  // Resolves the address once; on failure the previous target is kept.
+  bool setTarget(const std::string &target_ip, uint16_t target_port);
+
+  // `message_mask` selects the message classes (single bits) the destination
+  // receives; it gets one in every `rate_divisor` messages of each class.
+  bool addDestination(const std::string &ip, uint16_t port,
+                      uint32_t message_mask = ALL_MESSAGE_CLASSES,
+                      uint32_t rate_divisor = 1);
+  void clearDestinations();
+  // Drops the destinations from `count` on, leaving the rest and their rate
+  // divisor and bandwidth state as they are. The primary target stays.
+  void truncateDestinations(size_t count);
+  // Destinations found at run time, such as ForeFlight devices, take every
+  // message class and follow the configured ones; add those first.
+  bool addDiscoveredDestination(const std::string &ip, uint16_t port);
+  // The index of the first discovered destination, or destinationCount().
+  size_t firstDiscoveredDestination() const;
+  size_t destinationCount() const { return destinations_.size(); }
+  const std::string &destinationIp(size_t destination) const {
+    return destinations_[destination].ip;
+  }
+  uint16_t destinationPort(size_t destination) const {
+    return destinations_[destination].port;
+  }
+  // Returns the destination set for the next message of `message_class`,
+  // advancing each destination's rate divisor.
+  uint32_t routeMessage(uint32_t message_class);
+  // As above, and also takes `bytes` from each destination's bandwidth
+  // bucket, leaving out destinations that cannot take it.
+  uint32_t routeMessage(uint32_t message_class, size_t bytes);
+
+  // Reopens an open socket when they change, since a bound address cannot
+  // change in place. On failure the previous options stay in effect.
+  bool setSocketOptions(const SocketOptions &options);
+  const SocketOptions &socketOptions() const { return socket_options_; }
+
+  // Applies to every multicast destination, now if the socket is open and
+  // again by each initialize(). On failure the previous options are kept.
+  bool setMulticastOptions(const MulticastOptions &options);
+  const MulticastOptions &multicastOptions() const { return multicast_; }
+  bool isMulticast(size_t destination) const {
+    return destinations_[destination].multicast;
+  }
+
+  // Caps every destination at `bytes_per_s`; zero or less removes the cap.
+  // Classes in `essential_classes` are never shed and those in
+  // `sheddable_classes` go first.
+  void setBandwidthLimit(double bytes_per_s, uint32_t essential_classes,
+                         uint32_t sheddable_classes);
+  // Refills the buckets and backs off on sendto errors seen since the last
+  // call. `now` is monotonic seconds. Call from the routing thread.
+  void updateBandwidth(double now);
+  const BandwidthLimiterStats &bandwidthStats(size_t destination) const {
+    return destinations_[destination].bandwidth.stats();
+  }
+
+  // Every datagram that leaves the socket is also recorded in `capture`;
+  // nullptr stops recording. The capture must outlive its use here.
+  void setCapture(CaptureSink *capture) { capture_ = capture; }
 
   bool isInitialized() const { return initialized_; }
   std::string getLastError() const { return last_error_; }
-  std::string getTargetIp() const { return target_ip_; }
-  uint16_t getTargetPort() const { return target_port_; }
+  std::string getTargetIp() const { return destinations_[0].ip; }
+  uint16_t getTargetPort() const { return destinations_[0].port; }
 
   void close();
 
 private:
-  std::string target_ip_;
-  uint16_t target_port_;
+  struct Destination {
+    std::string ip;
+    uint16_t port = 0;
+    // Cached sockaddr_in, resolved once when the destination changes.
+    alignas(8) std::array<uint8_t, 16> addr{};
+    bool resolved = false;
+    // A group address; the socket's multicast options apply.
+    bool multicast = false;
+    uint32_t message_mask = ALL_MESSAGE_CLASSES;
+    uint32_t rate_divisor = 1;
+    bool discovered = false;
+    std::array<uint32_t, 32> class_counts{};
+    BandwidthLimiter bandwidth;
+  };
+
+  bool resolveDestination(const std::string &ip, uint16_t port,
+                          Destination *out_destination);
+  bool applySocketOptions();
+  bool applyMulticastOptions(const MulticastOptions &options);
+
+  std::vector<Destination> destinations_;
+  SocketOptions socket_options_;
+  MulticastOptions multicast_;
+  double bandwidth_limit_ = 0.0;
+  uint32_t essential_classes_ = 0;
+  uint32_t sheddable_classes_ = 0;
+  // Bumped by whichever thread sends; read by updateBandwidth().
+  std::array<std::atomic<uint64_t>, MAX_DESTINATIONS> send_errors_{};
+  std::array<uint64_t, MAX_DESTINATIONS> send_errors_seen_{};
   bool initialized_;
   std::string last_error_;
   detail::SocketOps *socket_ops_;
+  CaptureSink *capture_ = nullptr;
 
   uintptr_t socket_;
 #ifdef _WIN32
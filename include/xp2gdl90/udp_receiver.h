@@ -8,6 +8,52 @@
 
 namespace udp {
 
+constexpr size_t RECEIVE_DATAGRAM_CAPACITY = 2048;
+constexpr size_t RECEIVE_BATCH_DEFAULT = 16;
+
+// Binary IPv4 source of a datagram; compare these instead of formatted text.
+struct SourceAddress {
+  uint32_t ipv4 = 0; // Network byte order.
+  uint16_t port = 0; // Host byte order.
+
+  bool operator==(const SourceAddress &other) const {
+    return ipv4 == other.ipv4 && port == other.port;
+  }
+  bool operator!=(const SourceAddress &other) const {
+    return !(*this == other);
+  }
+};
+
+// Dotted-quad text for `address.ipv4`; only needed for display/logging.
+std::string FormatSourceIp(const SourceAddress &address);
+
+/**
+ * Reusable storage for the datagrams returned by one UDPReceiver::drain()
+ * call. Slots are preallocated, so steady-state draining does not allocate.
+ */
+class ReceiveBatch {
+public:
+  explicit ReceiveBatch(size_t max_datagrams = RECEIVE_BATCH_DEFAULT)
+      : bytes_(max_datagrams * RECEIVE_DATAGRAM_CAPACITY),
+        sizes_(max_datagrams), sources_(max_datagrams) {}
+
+  size_t maxDatagrams() const { return sizes_.size(); }
+  size_t count() const { return count_; }
+  const uint8_t *data(size_t index) const {
+    return bytes_.data() + index * RECEIVE_DATAGRAM_CAPACITY;
+  }
+  size_t size(size_t index) const { return sizes_[index]; }
+  const SourceAddress &source(size_t index) const { return sources_[index]; }
+
+private:
+  friend class UDPReceiver;
+
+  std::vector<uint8_t> bytes_;
+  std::vector<size_t> sizes_;
+  std::vector<SourceAddress> sources_;
+  size_t count_ = 0;
+};
+
 class UDPReceiver {
 public:
   static constexpr uintptr_t kInvalidSocket = static_cast<uintptr_t>(-1);
@@ -19,6 +65,16 @@ public:
   int receive(std::vector<uint8_t> *out_data,
               std::string *out_source_ip = nullptr,
               uint16_t *out_source_port = nullptr);
+  // Receives one datagram directly into `buffer`. Returns the byte count,
+  // 0 when nothing is pending, or -1 on error.
+  int receiveInto(uint8_t *buffer, size_t capacity,
+                  SourceAddress *out_source = nullptr);
+  // Fills `batch` with as many pending datagrams as fit, using recvmmsg
+  // where available. Returns the datagram count, 0 when idle, or -1 on error.
+  int drain(ReceiveBatch *batch);
+  // Blocks up to `timeout_ms` (-1 waits forever) until a datagram is
+  // pending. Returns 1 when readable, 0 on timeout, or -1 on error.
+  int waitReadable(int timeout_ms);
 
   void close();
 
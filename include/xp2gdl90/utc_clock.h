@@ -0,0 +1,67 @@
+#ifndef XP2GDL90_UTC_CLOCK_H
+#define XP2GDL90_UTC_CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace gdl90 {
+
+constexpr int64_t UTC_SECONDS_PER_DAY = 86400;
+// How often SteadyUtcClock reads the wall clock again.
+constexpr int64_t UTC_CLOCK_RESYNC_S = 60;
+
+/**
+ * Heartbeat time source: seconds since UTC midnight counted on the steady
+ * clock from a wall-clock reading taken once every UTC_CLOCK_RESYNC_S.
+ * Between resyncs a reading is one steady clock call and a division, with
+ * no calendar conversion; a wall clock stepped by NTP shows at the next
+ * resync. Not thread-safe; each heartbeat producer owns one.
+ */
+class SteadyUtcClock {
+public:
+  bool operator()(uint32_t *out_time) {
+    if (!out_time) {
+      return false;
+    }
+    const int64_t steady_ns = Nanoseconds(std::chrono::steady_clock::now());
+    if (!synced_ ||
+        steady_ns - sync_steady_ns_ >= UTC_CLOCK_RESYNC_S * kNsPerSecond) {
+      sync(steady_ns, Nanoseconds(std::chrono::system_clock::now()));
+    }
+    *out_time = at(steady_ns);
+    return true;
+  }
+
+  // Anchors the count: `wall_ns` is Unix time at `steady_ns`.
+  void sync(int64_t steady_ns, int64_t wall_ns) {
+    const int64_t day_ns = UTC_SECONDS_PER_DAY * kNsPerSecond;
+    sync_steady_ns_ = steady_ns;
+    sync_day_ns_ = ((wall_ns % day_ns) + day_ns) % day_ns;
+    synced_ = true;
+  }
+  // Seconds since UTC midnight at `steady_ns`, which must not be before the
+  // last sync().
+  uint32_t at(int64_t steady_ns) const {
+    const int64_t seconds =
+        (sync_day_ns_ + (steady_ns - sync_steady_ns_)) / kNsPerSecond;
+    return static_cast<uint32_t>(seconds % UTC_SECONDS_PER_DAY);
+  }
+  bool synced() const { return synced_; }
+
+private:
+  static constexpr int64_t kNsPerSecond = 1000000000;
+
+  template <typename TimePoint> static int64_t Nanoseconds(TimePoint time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               time.time_since_epoch())
+        .count();
+  }
+
+  int64_t sync_steady_ns_ = 0;
+  int64_t sync_day_ns_ = 0;
+  bool synced_ = false;
+};
+
+} // namespace gdl90
+
+#endif // XP2GDL90_UTC_CLOCK_H
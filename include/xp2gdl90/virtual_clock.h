@@ -0,0 +1,53 @@
+#ifndef XP2GDL90_VIRTUAL_CLOCK_H
+#define XP2GDL90_VIRTUAL_CLOCK_H
+
+#include <cstdint>
+
+#include "xp2gdl90/broadcast_clock.h"
+
+namespace xp2gdl90 {
+
+// A Clock that only moves when told to. Wall time is `wall_epoch_us` plus
+// the monotonic time.
+class VirtualClock final : public Clock {
+public:
+  explicit VirtualClock(double start_s = 0.0, int64_t wall_epoch_us = 0)
+      : now_s_(start_s), wall_epoch_us_(wall_epoch_us) {}
+
+  double monotonicSeconds() override { return now_s_; }
+  int64_t wallMicroseconds() override;
+
+  double now() const { return now_s_; }
+  // Negative steps are ignored; monotonic time never goes back.
+  void advance(double seconds);
+
+private:
+  double now_s_;
+  int64_t wall_epoch_us_;
+};
+
+/**
+ * Steps a VirtualClock the way a simulator's frame loop would: one frame
+ * every interval_s, each off by up to jitter_s either way. The jitter comes
+ * from a seeded generator, so a run repeats exactly.
+ */
+class FrameTicker {
+public:
+  FrameTicker(VirtualClock *clock, double interval_s, double jitter_s = 0.0,
+              uint32_t seed = 1);
+
+  // Advances the clock by one frame and returns the new time.
+  double next();
+  uint64_t frames() const { return frames_; }
+
+private:
+  VirtualClock *clock_;
+  double interval_s_;
+  double jitter_s_;
+  uint32_t state_;
+  uint64_t frames_ = 0;
+};
+
+} // namespace xp2gdl90
+
+#endif // XP2GDL90_VIRTUAL_CLOCK_H
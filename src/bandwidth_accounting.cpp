@@ -0,0 +1,286 @@
+#include "xp2gdl90/bandwidth_accounting.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "xp2gdl90/gdl90_layout.h"
+#include "xp2gdl90/traffic_scheduler.h"
+
+namespace xp2gdl90 {
+
+namespace {
+
+// Unframed payload sizes of the messages without a layout.
+constexpr size_t kHeartbeatPayloadBytes = 7;
+constexpr size_t kAhrsPayloadBytes = 12;
+constexpr size_t kForeFlightIdPayloadBytes = 39;
+
+double Rate(float rate_hz) {
+  return std::isfinite(rate_hz) && rate_hz > 0.0f
+             ? static_cast<double>(rate_hz)
+             : 0.0;
+}
+
+uint32_t SendClassMessage(SendClass send_class) {
+  switch (send_class) {
+  case SendClass::HEARTBEAT:
+    return MESSAGE_HEARTBEAT;
+  case SendClass::OWNSHIP:
+  case SendClass::GEO_ALTITUDE:
+    return MESSAGE_OWNSHIP;
+  case SendClass::AHRS:
+    return MESSAGE_AHRS;
+  case SendClass::DEVICE_INFO:
+    return MESSAGE_FOREFLIGHT_ID;
+  case SendClass::TRAFFIC:
+    return MESSAGE_TRAFFIC;
+  }
+  return 0;
+}
+
+// Frames a destination taking every message of the class gets per second.
+double PlannedFramesPerSecond(SendClass send_class, const Settings &cfg,
+                              const BandwidthPlanInputs &inputs) {
+  switch (send_class) {
+  case SendClass::HEARTBEAT:
+    return Rate(cfg.heartbeat_rate);
+  case SendClass::OWNSHIP:
+    return Rate(cfg.position_rate);
+  case SendClass::GEO_ALTITUDE:
+    return Rate(cfg.geo_altitude_rate);
+  case SendClass::AHRS:
+    return Rate(cfg.ahrs_rate);
+  case SendClass::DEVICE_INFO:
+    return Rate(cfg.device_info_rate);
+  case SendClass::TRAFFIC: {
+    if (!cfg.traffic_enabled) {
+      return 0.0;
+    }
+    const double targets = static_cast<double>(
+        (std::min)(inputs.traffic_targets,
+                   static_cast<size_t>(cfg.traffic_max_targets)));
+    if (!cfg.traffic_adaptive_rate) {
+      return Rate(cfg.traffic_rate) * targets;
+    }
+    const traffic::TrafficRatePolicy policy =
+        traffic::MakeTrafficRatePolicy(cfg);
+    const double frames = targets / policy.near_interval_s;
+    return policy.max_frames_per_second > 0.0
+               ? (std::min)(frames, policy.max_frames_per_second)
+               : frames;
+  }
+  }
+  return 0.0;
+}
+
+size_t PayloadBytes(SendClass send_class) {
+  switch (send_class) {
+  case SendClass::HEARTBEAT:
+    return kHeartbeatPayloadBytes;
+  case SendClass::OWNSHIP:
+  case SendClass::TRAFFIC:
+    return gdl90::layout::PositionReport::SIZE;
+  case SendClass::GEO_ALTITUDE:
+    return gdl90::layout::GeoAltitude::SIZE;
+  case SendClass::AHRS:
+    return kAhrsPayloadBytes;
+  case SendClass::DEVICE_INFO:
+    return kForeFlightIdPayloadBytes;
+  }
+  return 0;
+}
+
+} // namespace
+
+const char *MessageClassName(size_t index) {
+  switch (index) {
+  case 0:
+    return "Heartbeat";
+  case 1:
+    return "Ownship";
+  case 2:
+    return "Traffic";
+  case 3:
+    return "ForeFlight ID";
+  case 4:
+    return "AHRS";
+  default:
+    return "Unknown";
+  }
+}
+
+size_t MessageClassIndex(uint32_t message_class) {
+  for (size_t i = 0; i < MESSAGE_CLASS_COUNT; ++i) {
+    if ((message_class & (1u << i)) != 0) {
+      return i;
+    }
+  }
+  return MESSAGE_CLASS_COUNT;
+}
+
+void BandwidthMeter::sample(double now) {
+  const size_t newest = (head_ + samples_.size() - 1) % samples_.size();
+  if (size_ > 0 && now < samples_[newest].time) {
+    size_ = 0;
+  }
+  samples_[head_].time = now;
+  samples_[head_].totals = totals_;
+  head_ = (head_ + 1) % samples_.size();
+  size_ = (std::min)(size_ + 1, samples_.size());
+}
+
+BandwidthRate BandwidthMeter::rate() const {
+  BandwidthRate rate;
+  if (size_ < 2) {
+    return rate;
+  }
+  const Sample &newest = samples_[(head_ + samples_.size() - 1) %
+                                  samples_.size()];
+  const Sample &oldest =
+      samples_[(head_ + samples_.size() - size_) % samples_.size()];
+  const double elapsed = newest.time - oldest.time;
+  if (elapsed <= 0.0) {
+    return rate;
+  }
+  rate.frames_per_s =
+      static_cast<double>(newest.totals.frames - oldest.totals.frames) /
+      elapsed;
+  rate.bytes_per_s =
+      static_cast<double>(newest.totals.bytes - oldest.totals.bytes) /
+      elapsed;
+  return rate;
+}
+
+void BandwidthMeter::reset() { *this = BandwidthMeter{}; }
+
+void BandwidthAccount::record(uint32_t message_class, uint32_t route,
+                              size_t destination_count, uint64_t frames,
+                              uint64_t bytes) {
+  const size_t count = (std::min)(destination_count, destinations_.size());
+  uint64_t copies = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if ((route & (1u << i)) != 0) {
+      destinations_[i].add(frames, bytes);
+      ++copies;
+    }
+  }
+  const size_t index = MessageClassIndex(message_class);
+  if (copies > 0 && index < MESSAGE_CLASS_COUNT) {
+    classes_[index].add(frames * copies, bytes * copies);
+  }
+}
+
+bool BandwidthAccount::update(double now) {
+  if (sampled_ && now >= last_sample_ &&
+      now - last_sample_ < BANDWIDTH_SAMPLE_INTERVAL_S) {
+    return false;
+  }
+  for (BandwidthMeter &meter : classes_) {
+    meter.sample(now);
+  }
+  for (BandwidthMeter &meter : destinations_) {
+    meter.sample(now);
+  }
+  sampled_ = true;
+  last_sample_ = now;
+  return true;
+}
+
+void BandwidthAccount::reset() { *this = BandwidthAccount{}; }
+
+BandwidthRate BandwidthAccount::total() const {
+  BandwidthRate total;
+  for (const BandwidthMeter &meter : destinations_) {
+    const BandwidthRate rate = meter.rate();
+    total.frames_per_s += rate.frames_per_s;
+    total.bytes_per_s += rate.bytes_per_s;
+  }
+  return total;
+}
+
+BandwidthPlan PlanBandwidth(const Settings &cfg,
+                            const BandwidthPlanInputs &inputs) {
+  BandwidthPlan plan;
+  for (size_t i = 0; i < SEND_CLASS_COUNT; ++i) {
+    const auto send_class = static_cast<SendClass>(i);
+    plan.classes[i].frames_per_s =
+        PlannedFramesPerSecond(send_class, cfg, inputs);
+    plan.classes[i].frame_bytes = ExpectedFrameBytes(PayloadBytes(send_class));
+  }
+
+  // In the order the front ends add them: the primary target, the extra
+  // destinations, then ForeFlight devices after the first.
+  struct Route {
+    uint32_t message_mask;
+    uint32_t rate_divisor;
+  };
+  std::array<Route, udp::MAX_DESTINATIONS> routes{};
+  size_t wanted = 0;
+  const auto add = [&](uint32_t message_mask, uint32_t rate_divisor) {
+    if (wanted < routes.size()) {
+      routes[wanted] = Route{message_mask, (std::max)(rate_divisor, 1u)};
+    }
+    ++wanted;
+  };
+  add(udp::ALL_MESSAGE_CLASSES, 1);
+  for (const Destination &destination : cfg.extra_destinations) {
+    add(destination.message_mask, destination.rate_divisor);
+  }
+  if (cfg.foreflight_auto_discovery) {
+    for (size_t i = 1; i < inputs.foreflight_devices; ++i) {
+      add(udp::ALL_MESSAGE_CLASSES, 1);
+    }
+  }
+  plan.destination_count = (std::min)(wanted, routes.size());
+  plan.destinations_refused = wanted - plan.destination_count;
+
+  const double limit = static_cast<double>(cfg.bandwidth_limit_bytes_per_s);
+  for (size_t d = 0; d < plan.destination_count; ++d) {
+    BandwidthPlanDestination &destination = plan.destinations[d];
+    double fastest_rate = 0.0;
+    for (size_t i = 0; i < SEND_CLASS_COUNT; ++i) {
+      const auto send_class = static_cast<SendClass>(i);
+      BandwidthPlanClass &planned = plan.classes[i];
+      if ((routes[d].message_mask & SendClassMessage(send_class)) == 0 ||
+          planned.frames_per_s <= 0.0) {
+        continue;
+      }
+      const double frames =
+          planned.frames_per_s / static_cast<double>(routes[d].rate_divisor);
+      const double bytes = frames * planned.frame_bytes;
+      destination.load.frames_per_s += frames;
+      destination.load.bytes_per_s += bytes;
+      planned.load.frames_per_s += frames;
+      planned.load.bytes_per_s += bytes;
+      // Traffic arrives a sweep at a time, not spread over its frames.
+      const double sends =
+          send_class == SendClass::TRAFFIC
+              ? Rate(cfg.traffic_rate) /
+                    static_cast<double>(routes[d].rate_divisor)
+              : frames;
+      fastest_rate = (std::max)(fastest_rate, sends);
+    }
+    // A packed datagram carries every frame of a tick up to the size limit,
+    // so there are no fewer than the fastest class sends.
+    destination.datagrams_per_s =
+        cfg.datagram_packing && cfg.datagram_max_bytes > 0
+            ? (std::max)(fastest_rate,
+                         destination.load.bytes_per_s /
+                             static_cast<double>(cfg.datagram_max_bytes))
+            : destination.load.frames_per_s;
+    destination.over_limit =
+        limit > 0.0 && destination.load.bytes_per_s > limit;
+    if (destination.over_limit) {
+      ++plan.destinations_over_limit;
+    }
+    plan.total.frames_per_s += destination.load.frames_per_s;
+    plan.total.bytes_per_s += destination.load.bytes_per_s;
+    plan.wire_bytes_per_s +=
+        destination.load.bytes_per_s +
+        destination.datagrams_per_s *
+            static_cast<double>(UDP_IPV4_HEADER_BYTES);
+  }
+  return plan;
+}
+
+} // namespace xp2gdl90
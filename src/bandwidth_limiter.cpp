@@ -0,0 +1,96 @@
+#include "xp2gdl90/bandwidth_limiter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace udp {
+namespace {
+
+constexpr double kBurstSeconds = 0.25;
+// Never smaller than one full-size datagram.
+constexpr double kMinBurstBytes = 1472.0;
+// Share of the bucket sheddable messages must leave behind.
+constexpr double kSheddableReserve = 0.25;
+constexpr double kBackoffFactor = 0.5;
+constexpr double kMinFactor = 1.0 / 16.0;
+constexpr double kBackoffHoldSeconds = 0.25;
+constexpr double kRecoveryDelaySeconds = 1.0;
+constexpr double kRecoveryPerSecond = 0.1;
+// Longest refill credited at once, e.g. after a pause.
+constexpr double kMaxUpdateGapSeconds = 1.0;
+
+} // namespace
+
+void BandwidthLimiter::setCeiling(double bytes_per_s) {
+  const double ceiling =
+      std::isfinite(bytes_per_s) && bytes_per_s > 0.0 ? bytes_per_s : 0.0;
+  if (ceiling == ceiling_) {
+    return;
+  }
+  ceiling_ = ceiling;
+  capacity_ =
+      ceiling > 0.0 ? (std::max)(kMinBurstBytes, ceiling * kBurstSeconds) : 0.0;
+  tokens_ = capacity_;
+  factor_ = 1.0;
+  stats_.rate_bytes_per_s = ceiling_;
+}
+
+void BandwidthLimiter::update(double now, uint64_t new_errors) {
+  if (!enabled()) {
+    return;
+  }
+  if (!updated_) {
+    updated_ = true;
+    last_update_ = now;
+    last_backoff_ = now - kBackoffHoldSeconds;
+    last_error_ = now - kRecoveryDelaySeconds;
+  }
+  const double dt =
+      std::clamp(now - last_update_, 0.0, kMaxUpdateGapSeconds);
+  last_update_ = now;
+
+  if (new_errors > 0) {
+    last_error_ = now;
+    if (now - last_backoff_ >= kBackoffHoldSeconds) {
+      last_backoff_ = now;
+      factor_ = (std::max)(kMinFactor, factor_ * kBackoffFactor);
+      // Whatever burst was saved up is what overran the link.
+      tokens_ = (std::min)(tokens_, 0.0);
+      ++stats_.backoffs;
+    }
+  } else if (now - last_error_ >= kRecoveryDelaySeconds) {
+    factor_ = (std::min)(1.0, factor_ + kRecoveryPerSecond * dt);
+  }
+
+  const double rate = ceiling_ * factor_;
+  stats_.rate_bytes_per_s = rate;
+  tokens_ = (std::min)(capacity_, tokens_ + rate * dt);
+}
+
+bool BandwidthLimiter::admit(size_t bytes, BandwidthTier tier) {
+  const double cost = static_cast<double>(bytes);
+  if (enabled()) {
+    double floor = 0.0;
+    if (tier == BandwidthTier::ESSENTIAL) {
+      floor = -capacity_;
+    } else if (tier == BandwidthTier::SHEDDABLE) {
+      floor = capacity_ * kSheddableReserve;
+    }
+    if (tier != BandwidthTier::ESSENTIAL && tokens_ - cost < floor) {
+      ++stats_.shed_messages;
+      stats_.shed_bytes += bytes;
+      return false;
+    }
+    tokens_ = (std::max)(floor, tokens_ - cost);
+  }
+  stats_.admitted_bytes += bytes;
+  return true;
+}
+
+void BandwidthLimiter::reset() {
+  const double ceiling = ceiling_;
+  *this = BandwidthLimiter{};
+  setCeiling(ceiling);
+}
+
+} // namespace udp
@@ -0,0 +1,948 @@
+// xp2gdl90_bench: micro-benchmarks for the encoding hot path. Reports time,
+// heap allocations and allocated bytes per operation. --pipeline instead
+// drives the MSFS traffic pipeline with synthetic targets and a counting
+// socket and reports throughput per target count and traffic build thread
+// count.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "xp2gdl90/crc16.h"
+#include "xp2gdl90/datagram_packer.h"
+#include "xp2gdl90/foreflight_encoder.h"
+#include "xp2gdl90/frame_buffer.h"
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/gdl90_framing.h"
+#include "xp2gdl90/impaired_socket_ops.h"
+#include "xp2gdl90/msfs_bridge.h"
+#include "xp2gdl90/output_scheduler.h"
+#include "xp2gdl90/simple_json.h"
+#include "xp2gdl90/task_pool.h"
+#include "xp2gdl90/track_table.h"
+#include "xp2gdl90/traffic_build.h"
+#include "xp2gdl90/traffic_frame_cache.h"
+#include "xp2gdl90/traffic_support.h"
+#include "xp2gdl90/udp_broadcaster.h"
+#include "xp2gdl90/utc_clock.h"
+#include "xp2gdl90/virtual_clock.h"
+
+namespace {
+
+// Counted by the replacement operator new below. Atomic because --pipeline
+// allocates on pool threads too.
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocated_bytes{0};
+
+// Keeps results observable so the optimizer cannot drop the work.
+volatile uint64_t g_sink = 0;
+
+void Sink(uint64_t value) { g_sink = g_sink + value; }
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+  std::string name;
+  uint64_t iterations = 0;
+  double ns_per_op = 0.0;
+  double allocations_per_op = 0.0;
+  double bytes_per_op = 0.0;
+};
+
+struct Benchmark {
+  const char *name;
+  void (*run)(uint64_t iterations);
+};
+
+gdl90::PositionData MakeTrafficReport() {
+  gdl90::PositionData data;
+  data.latitude = 47.4502;
+  data.longitude = -122.3088;
+  data.altitude = 4500;
+  data.h_velocity = 142;
+  data.v_velocity = -640;
+  data.track = 187;
+  data.airborne = true;
+  data.icao_address = 0xA1B2C3;
+  data.callsign = gdl90::Callsign("ASA123");
+  data.emitter_category = gdl90::EmitterCategory::LARGE;
+  data.nic = 8;
+  data.nacp = 9;
+  return data;
+}
+
+gdl90::foreflight::AhrsData MakeAhrs() {
+  gdl90::foreflight::AhrsData data;
+  data.roll_deg = -12.5;
+  data.pitch_deg = 3.2;
+  data.heading_deg = 271.0;
+  return data;
+}
+
+// A traffic payload with two bytes that need escaping.
+std::vector<uint8_t> MakePayload(size_t size) {
+  std::vector<uint8_t> payload(size);
+  for (size_t i = 0; i < size; ++i) {
+    payload[i] = static_cast<uint8_t>(i * 37u + 11u);
+  }
+  payload[0] = 0x14;
+  if (size > 10) {
+    payload[5] = gdl90::FRAME_FLAG;
+    payload[10] = gdl90::FRAME_ESCAPE;
+  }
+  return payload;
+}
+
+const char kSettingsJson[] = R"({
+  "target_ip": "192.168.1.100",
+  "target_port": 4000,
+  "extra_targets": ["192.168.1.101:4000", "10.0.0.5:43211"],
+  "foreflight_discovery": true,
+  "icao_address": "ABCDEF",
+  "callsign": "N12345",
+  "emitter_category": 1,
+  "nic": 11,
+  "nacp": 10,
+  "heartbeat_rate": 1.0,
+  "position_rate": 5.0,
+  "traffic_rate": 2.0,
+  "traffic_max_targets": 63,
+  "traffic_range_nm": 40.0,
+  "traffic_altitude_band_ft": 5000,
+  "datagram_packing": true,
+  "datagram_max_bytes": 1400
+})";
+
+void BenchCreateHeartbeat(uint64_t iterations) {
+  const gdl90::GDL90Encoder encoder;
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(encoder.createHeartbeat(true, true).size());
+  }
+}
+
+void BenchEncodeHeartbeatInto(uint64_t iterations) {
+  const gdl90::GDL90Encoder encoder;
+  gdl90::FrameBuffer frame;
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(encoder.encodeHeartbeatInto(true, true, frame));
+  }
+}
+
+void BenchEncodeHeartbeatSteadyClock(uint64_t iterations) {
+  const gdl90::TimedGDL90Encoder<gdl90::SteadyUtcClock> encoder;
+  gdl90::FrameBuffer frame;
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(encoder.encodeHeartbeatInto(true, true, frame));
+  }
+}
+
+// One simulator frame of the EDF scheduler on a jittered 30 Hz virtual
+// clock; an hour of flight is 108000 of these.
+void BenchVirtualSchedulerTick(uint64_t iterations) {
+  xp2gdl90::VirtualClock clock;
+  xp2gdl90::FrameTicker ticker(&clock, 1.0 / 30.0, 0.008, 42);
+  xp2gdl90::OutputScheduler scheduler;
+  const double rates[xp2gdl90::SEND_CLASS_COUNT] = {1.0, 5.0, 1.0,
+                                                    10.0, 0.2, 2.0};
+  for (size_t i = 0; i < xp2gdl90::SEND_CLASS_COUNT; ++i) {
+    scheduler.configure(static_cast<xp2gdl90::SendClass>(i),
+                        xp2gdl90::PeriodForRate(rates[i]));
+  }
+  scheduler.setTickInterval(1.0 / 30.0);
+  scheduler.restart(0.0);
+  for (uint64_t i = 0; i < iterations; ++i) {
+    const double now = ticker.next();
+    scheduler.beginTick(now, now);
+    xp2gdl90::SendClass send_class = xp2gdl90::SendClass::HEARTBEAT;
+    while (scheduler.next(now, &send_class)) {
+      scheduler.complete(send_class, 40, now);
+    }
+  }
+  Sink(scheduler.stats(xp2gdl90::SendClass::AHRS).sent);
+}
+
+void BenchCreateTrafficReport(uint64_t iterations) {
+  const gdl90::GDL90Encoder encoder;
+  const gdl90::PositionData report = MakeTrafficReport();
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(encoder.createTrafficReport(report).size());
+  }
+}
+
+void BenchEncodeTrafficReportInto(uint64_t iterations) {
+  const gdl90::GDL90Encoder encoder;
+  const gdl90::PositionData report = MakeTrafficReport();
+  gdl90::FrameBuffer frame;
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(encoder.encodeTrafficReportInto(report, frame));
+  }
+}
+
+void BenchCreateAhrsMessage(uint64_t iterations) {
+  const gdl90::foreflight::ForeFlightEncoder encoder;
+  const gdl90::foreflight::AhrsData ahrs = MakeAhrs();
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(encoder.createAhrsMessage(ahrs).size());
+  }
+}
+
+void BenchFrameMessage(uint64_t iterations) {
+  const std::vector<uint8_t> payload = MakePayload(28);
+  uint8_t out[gdl90::MaxFrameSize(28)];
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(gdl90::FrameMessage(payload.data(), payload.size(), out));
+  }
+}
+
+void BenchFrameMessageScalar(uint64_t iterations) {
+  const std::vector<uint8_t> payload = MakePayload(28);
+  uint8_t out[gdl90::MaxFrameSize(28)];
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(gdl90::FrameMessageScalar(payload.data(), payload.size(), out));
+  }
+}
+
+void BenchCrc16Report(uint64_t iterations) {
+  const std::vector<uint8_t> payload = MakePayload(28);
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(gdl90::Crc16(payload.data(), payload.size()));
+  }
+}
+
+void BenchCrc16Datagram(uint64_t iterations) {
+  const std::vector<uint8_t> payload = MakePayload(1400);
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(gdl90::Crc16(payload.data(), payload.size()));
+  }
+}
+
+void BenchFindEscapeByte(uint64_t iterations) {
+  const std::vector<uint8_t> clean(1400, 0x41);
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(gdl90::FindEscapeByte(clean.data(), clean.size()));
+  }
+}
+
+void BenchJsonEscapeString(uint64_t iterations) {
+  const std::string_view text = "C:\\X-Plane 12\\Output\\\"prefs\"\n";
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(xp2gdl90::json::EscapeString(text).size());
+  }
+}
+
+void BenchBuildTrafficPosition(uint64_t iterations) {
+  const xp2gdl90::Settings cfg;
+  msfs_bridge::TrafficData traffic;
+  traffic.object_id = 4711;
+  traffic.latitude_deg = 47.45;
+  traffic.longitude_deg = -122.31;
+  traffic.altitude_ft = 4500.0;
+  traffic.ground_velocity_kt = 142.0;
+  traffic.velocity_world_x_fps = 12.0;
+  traffic.velocity_world_y_fps = -10.0;
+  traffic.velocity_world_z_fps = -230.0;
+  traffic.true_heading_deg = 187.0;
+  traffic.callsign = gdl90::Callsign("ASA123");
+  gdl90::PositionData report;
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(msfs_bridge::BuildTrafficPosition(traffic, cfg, &report) ? 1u : 0u);
+  }
+}
+
+constexpr size_t kDispatchBatch = 250;
+
+// SimConnect samples as they sit in the dispatch buffer.
+std::vector<msfs_bridge::TrafficSimData> MakeTrafficSimData() {
+  std::vector<msfs_bridge::TrafficSimData> sims(kDispatchBatch);
+  for (size_t i = 0; i < sims.size(); ++i) {
+    sims[i].latitude_deg = 47.0 + 0.001 * static_cast<double>(i);
+    sims[i].longitude_deg = 8.0;
+    sims[i].altitude_ft = 4500.0;
+    sims[i].ground_velocity_kt = 142.0;
+    sims[i].velocity_world_z_fps = 230.0;
+    sims[i].true_heading_deg = 187.0;
+    std::snprintf(sims[i].atc_id, sizeof(sims[i].atc_id), "SYN%04u",
+                  static_cast<unsigned>(i));
+  }
+  return sims;
+}
+
+// The per-target path: copy each sample into a TrafficData first.
+void BenchUpsertTrafficTarget(uint64_t iterations) {
+  const std::vector<msfs_bridge::TrafficSimData> sims = MakeTrafficSimData();
+  xp2gdl90::traffic::TrackTable tracks;
+  xp2gdl90::traffic::TrafficSnapshot snapshot;
+  for (uint64_t i = 0; i < iterations; ++i) {
+    for (size_t j = 0; j < sims.size(); ++j) {
+      const msfs_bridge::TrafficSimData &sim = sims[j];
+      msfs_bridge::TrafficData traffic;
+      traffic.object_id = static_cast<uint32_t>(j + 1);
+      traffic.latitude_deg = sim.latitude_deg;
+      traffic.longitude_deg = sim.longitude_deg;
+      traffic.altitude_ft = sim.altitude_ft;
+      traffic.ground_velocity_kt = sim.ground_velocity_kt;
+      traffic.velocity_world_x_fps = sim.velocity_world_x_fps;
+      traffic.velocity_world_y_fps = sim.velocity_world_y_fps;
+      traffic.velocity_world_z_fps = sim.velocity_world_z_fps;
+      traffic.true_heading_deg = sim.true_heading_deg;
+      traffic.sim_on_ground = sim.sim_on_ground != 0;
+      traffic.callsign =
+          msfs_bridge::SimConnectCallsign(sim.atc_id, sizeof(sim.atc_id));
+      msfs_bridge::UpsertTrafficTarget(&tracks, &snapshot, traffic,
+                                       static_cast<double>(i));
+    }
+    Sink(snapshot.size());
+  }
+}
+
+void BenchUpsertTrafficTargets(uint64_t iterations) {
+  const std::vector<msfs_bridge::TrafficSimData> sims = MakeTrafficSimData();
+  std::vector<msfs_bridge::TrafficSimView> views(sims.size());
+  for (size_t j = 0; j < sims.size(); ++j) {
+    views[j] = {static_cast<uint32_t>(j + 1), &sims[j]};
+  }
+  xp2gdl90::traffic::TrackTable tracks;
+  xp2gdl90::traffic::TrafficSnapshot snapshot;
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(msfs_bridge::UpsertTrafficTargets(&tracks, &snapshot, views.data(),
+                                           views.size(),
+                                           static_cast<double>(i)));
+  }
+}
+
+void BenchSyntheticTrafficAddress(uint64_t iterations) {
+  const gdl90::Callsign callsign("DLH4AB");
+  for (uint64_t i = 0; i < iterations; ++i) {
+    Sink(xp2gdl90::traffic::SyntheticTrafficAddress(i & 63u, callsign,
+                                                    0xABCDEF));
+  }
+}
+
+void BenchJsonParse(uint64_t iterations) {
+  for (uint64_t i = 0; i < iterations; ++i) {
+    xp2gdl90::json::Document document;
+    std::string error;
+    Sink(xp2gdl90::json::Parse(kSettingsJson, &document, &error) ? 1u : 0u);
+  }
+}
+
+// Settings with a full destination list, as large as a settings file gets.
+std::string MakeDestinationsJson() {
+  std::string text = "{\"target_ip\": \"192.168.1.100\", "
+                     "\"extra_destinations\": [";
+  for (int i = 0; i < 64; ++i) {
+    text += i == 0 ? "" : ", ";
+    text += "{\"ip\": \"10.0.0." + std::to_string(i + 1) +
+            "\", \"port\": 4000, \"messages\": [\"ownship\", "
+            "\"traffic\"], \"rate_divisor\": 2}";
+  }
+  return text + "]}";
+}
+
+void BenchJsonParseDestinations(uint64_t iterations) {
+  const std::string text = MakeDestinationsJson();
+  for (uint64_t i = 0; i < iterations; ++i) {
+    xp2gdl90::json::Document document;
+    std::string error;
+    Sink(xp2gdl90::json::Parse(text, &document, &error) ? 1u : 0u);
+  }
+}
+
+// The lookups LoadSettingsFromJsonFile() does, present or not.
+void BenchJsonFind(uint64_t iterations) {
+  static const char *const kKeys[] = {
+      "target_ip",          "target_port",
+      "extra_targets",      "icao_address",
+      "callsign",           "emitter_category",
+      "nic",                "nacp",
+      "heartbeat_rate",     "position_rate",
+      "traffic_rate",       "traffic_max_targets",
+      "traffic_range_nm",   "traffic_altitude_band_ft",
+      "datagram_packing",   "datagram_max_bytes",
+      "device_name",        "debug_logging",
+      "metrics_ip",         "sim_recording"};
+  xp2gdl90::json::Document document;
+  std::string error;
+  xp2gdl90::json::Parse(kSettingsJson, &document, &error);
+  const xp2gdl90::json::Value &root = document.root();
+  for (uint64_t i = 0; i < iterations; ++i) {
+    size_t found = 0;
+    for (const char *key : kKeys) {
+      found += root.Find(key) != nullptr ? 1u : 0u;
+    }
+    Sink(found);
+  }
+}
+
+// Counts events so the reader has something to call.
+class CountingHandler : public xp2gdl90::json::Handler {
+public:
+  bool key(std::string_view /*name*/) override {
+    ++events;
+    return true;
+  }
+  bool scalar(const xp2gdl90::json::Value & /*value*/) override {
+    ++events;
+    return true;
+  }
+  uint64_t events = 0;
+};
+
+void BenchJsonReader(uint64_t iterations) {
+  xp2gdl90::json::Reader reader;
+  CountingHandler handler;
+  for (uint64_t i = 0; i < iterations; ++i) {
+    std::string error;
+    Sink(reader.read(kSettingsJson, &handler, &error) ? 1u : 0u);
+  }
+  Sink(handler.events);
+}
+
+// A stats datagram's worth of counters, gauges and a histogram.
+void BenchJsonWriter(uint64_t iterations) {
+  static const char *const kNames[] = {
+      "packets.heartbeat", "packets.ownship", "packets.traffic",
+      "packets.ahrs",      "bytes.sent",      "send.errors"};
+  xp2gdl90::json::Writer writer;
+  for (uint64_t i = 0; i < iterations; ++i) {
+    writer.clear();
+    writer.beginObject();
+    writer.key("type");
+    writer.stringValue("xp2gdl90.metrics");
+    writer.key("seq");
+    writer.unsignedValue(i);
+    writer.key("metrics");
+    writer.beginObject();
+    for (const char *name : kNames) {
+      writer.key(name);
+      writer.beginObject();
+      writer.key("total");
+      writer.unsignedValue(i * 3);
+      writer.key("rate");
+      writer.numberValue(12.5);
+      writer.endObject();
+    }
+    writer.key("tick.send");
+    writer.beginArray();
+    for (int bucket = 0; bucket < 8; ++bucket) {
+      writer.numberValue(1000.0 * bucket);
+    }
+    writer.endArray();
+    writer.endObject();
+    writer.endObject();
+    Sink(writer.text().size());
+  }
+}
+
+const Benchmark kBenchmarks[] = {
+    {"gdl90/createHeartbeat", BenchCreateHeartbeat},
+    {"gdl90/encodeHeartbeatInto", BenchEncodeHeartbeatInto},
+    {"gdl90/encodeHeartbeatSteadyClock", BenchEncodeHeartbeatSteadyClock},
+    {"gdl90/createTrafficReport", BenchCreateTrafficReport},
+    {"gdl90/encodeTrafficReportInto", BenchEncodeTrafficReportInto},
+    {"foreflight/createAhrsMessage", BenchCreateAhrsMessage},
+    {"framing/FrameMessage/28", BenchFrameMessage},
+    {"framing/FrameMessageScalar/28", BenchFrameMessageScalar},
+    {"framing/FindEscapeByte/1400", BenchFindEscapeByte},
+    {"crc/Crc16/28", BenchCrc16Report},
+    {"crc/Crc16/1400", BenchCrc16Datagram},
+    {"json/EscapeString", BenchJsonEscapeString},
+    {"json/Parse/settings", BenchJsonParse},
+    {"json/Parse/destinations", BenchJsonParseDestinations},
+    {"json/Find/settings", BenchJsonFind},
+    {"json/Reader/settings", BenchJsonReader},
+    {"json/Writer/metrics", BenchJsonWriter},
+    {"msfs/BuildTrafficPosition", BenchBuildTrafficPosition},
+    {"msfs/UpsertTrafficTarget/250", BenchUpsertTrafficTarget},
+    {"msfs/UpsertTrafficTargets/250", BenchUpsertTrafficTargets},
+    {"traffic/SyntheticTrafficAddress", BenchSyntheticTrafficAddress},
+    {"sched/VirtualSchedulerTick", BenchVirtualSchedulerTick},
+};
+
+// Doubles the iteration count until one batch takes at least `min_seconds`,
+// then reports that batch.
+Result Measure(const Benchmark &benchmark, double min_seconds) {
+  Result result;
+  result.name = benchmark.name;
+  uint64_t iterations = 1;
+  for (;;) {
+    const uint64_t allocations = g_allocations;
+    const uint64_t bytes = g_allocated_bytes;
+    const Clock::time_point start = Clock::now();
+    benchmark.run(iterations);
+    const double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    if (seconds >= min_seconds || iterations >= (uint64_t{1} << 40)) {
+      const double count = static_cast<double>(iterations);
+      result.iterations = iterations;
+      result.ns_per_op = seconds * 1e9 / count;
+      result.allocations_per_op =
+          static_cast<double>(g_allocations - allocations) / count;
+      result.bytes_per_op =
+          static_cast<double>(g_allocated_bytes - bytes) / count;
+      return result;
+    }
+    iterations *= 2;
+  }
+}
+
+void PrintJson(const std::vector<Result> &results) {
+  std::printf("{\n  \"benchmarks\": [");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result &result = results[i];
+    std::printf("%s\n    {\"name\": \"%s\", \"iterations\": %llu, "
+                "\"ns_per_op\": %.3f, \"allocs_per_op\": %.3f, "
+                "\"bytes_per_op\": %.1f}",
+                i == 0 ? "" : ",",
+                xp2gdl90::json::EscapeString(result.name).c_str(),
+                static_cast<unsigned long long>(result.iterations),
+                result.ns_per_op, result.allocations_per_op,
+                result.bytes_per_op);
+  }
+  std::printf("\n  ]\n}\n");
+}
+
+void PrintTable(const std::vector<Result> &results) {
+  std::printf("%-34s %12s %10s %10s\n", "benchmark", "ns/op", "allocs/op",
+              "bytes/op");
+  for (const Result &result : results) {
+    std::printf("%-34s %12.2f %10.2f %10.1f\n", result.name.c_str(),
+                result.ns_per_op, result.allocations_per_op,
+                result.bytes_per_op);
+  }
+}
+
+// Counts socket calls; a batch counts as one call, as sendmmsg does.
+struct CountingSocketOps final : udp::detail::SocketOps {
+  uint64_t calls = 0;
+  uint64_t datagrams = 0;
+
+  uintptr_t CreateSocket(int, int, int) override { return 1; }
+  int SetSockOpt(uintptr_t, int, int, const void *, size_t) override {
+    return 0;
+  }
+  int InetPton(int, const char *, void *dst) override {
+    std::memset(dst, 0, 4);
+    return 1;
+  }
+  int Bind(uintptr_t, const void *, size_t) override { return 0; }
+  intptr_t SendTo(uintptr_t, const void *, size_t len, int, const void *,
+                  size_t) override {
+    ++calls;
+    ++datagrams;
+    return static_cast<intptr_t>(len);
+  }
+  intptr_t SendBatch(uintptr_t, const udp::SendBuffer *, size_t count, int,
+                     const void *, size_t) override {
+    ++calls;
+    datagrams += count;
+    return static_cast<intptr_t>(count);
+  }
+  int CloseSocket(uintptr_t) override { return 0; }
+  int LastError() override { return 0; }
+};
+
+struct PipelineOptions {
+  std::vector<size_t> target_counts = {10, 50, 100, 250, 500, 1000, 2000};
+  // Traffic build threads besides the sweeping one; 0 builds serially.
+  std::vector<size_t> thread_counts = {0};
+  int ticks = 200;
+  bool packing = false;
+  bool grid = false;
+  uint8_t max_targets = 255;
+  // Sends go through an ImpairedSocketOps, one virtual second per tick.
+  bool impaired = false;
+  udp::ImpairmentOptions impairment;
+};
+
+struct PipelineResult {
+  size_t targets = 0;
+  size_t threads = 0;
+  double ticks_per_s = 0.0;
+  double frames_per_s = 0.0;
+  double frames_per_tick = 0.0;
+  double syscalls_per_tick = 0.0;
+  double p50_us = 0.0;
+  double p99_us = 0.0;
+  // Share of datagrams the impaired link delivered.
+  double delivered_pct = 100.0;
+};
+
+// Aircraft on random tracks between 1 and 40 nm of ownship, at 100 to 450
+// kt. A fixed seed keeps runs comparable.
+class SyntheticTraffic {
+public:
+  SyntheticTraffic(size_t count, double latitude, double longitude)
+      : targets_(count) {
+    for (size_t i = 0; i < count; ++i) {
+      msfs_bridge::TrafficData &target = targets_[i];
+      const double bearing = Uniform(0.0, 2.0 * kPi);
+      const double range_m = Uniform(1.0, 40.0) * 1852.0;
+      target.object_id = static_cast<uint32_t>(i + 1);
+      target.latitude_deg =
+          latitude + range_m * std::cos(bearing) / kMetersPerDegree;
+      target.longitude_deg =
+          longitude + range_m * std::sin(bearing) /
+                          (kMetersPerDegree * std::cos(latitude / kDegrees));
+      target.altitude_ft = Uniform(1000.0, 39000.0);
+      target.true_heading_deg = Uniform(0.0, 360.0);
+      target.ground_velocity_kt = Uniform(100.0, 450.0);
+      target.velocity_world_y_fps = Uniform(-20.0, 20.0);
+      char callsign[gdl90::CALLSIGN_SIZE + 1];
+      std::snprintf(callsign, sizeof(callsign), "SYN%04u",
+                    static_cast<unsigned>(i % 10000));
+      target.callsign = gdl90::Callsign(callsign);
+    }
+  }
+
+  void step(double dt_s) {
+    for (msfs_bridge::TrafficData &target : targets_) {
+      const double heading = target.true_heading_deg / kDegrees;
+      const double speed_fps = target.ground_velocity_kt * 1.68781;
+      target.velocity_world_x_fps = speed_fps * std::sin(heading);
+      target.velocity_world_z_fps = speed_fps * std::cos(heading);
+      const double north_m = target.velocity_world_z_fps * 0.3048 * dt_s;
+      const double east_m = target.velocity_world_x_fps * 0.3048 * dt_s;
+      target.latitude_deg += north_m / kMetersPerDegree;
+      const double cos_latitude = std::cos(target.latitude_deg / kDegrees);
+      target.longitude_deg += east_m / (kMetersPerDegree * cos_latitude);
+      target.altitude_ft += target.velocity_world_y_fps * dt_s;
+      target.true_heading_deg =
+          std::fmod(target.true_heading_deg + 1.0 * dt_s, 360.0);
+    }
+  }
+
+  const std::vector<msfs_bridge::TrafficData> &targets() const {
+    return targets_;
+  }
+
+private:
+  static constexpr double kPi = 3.14159265358979323846;
+  static constexpr double kDegrees = 180.0 / kPi;
+  static constexpr double kMetersPerDegree = 111320.0;
+
+  double Uniform(double lo, double hi) {
+    seed_ = seed_ * 6364136223846793005ull + 1442695040888963407ull;
+    const double unit = static_cast<double>(seed_ >> 11) * 0x1.0p-53;
+    return lo + (hi - lo) * unit;
+  }
+
+  std::vector<msfs_bridge::TrafficData> targets_;
+  uint64_t seed_ = 0x9E3779B97F4A7C15ull;
+};
+
+// One sweep per tick, as msfs_main runs it: dispatch every target into the
+// track table, select and build reports, encode, and send. With `threads`
+// the build and encode fan out over a pool.
+PipelineResult RunPipeline(size_t count, size_t threads,
+                           const PipelineOptions &options) {
+  xp2gdl90::Settings cfg;
+  cfg.traffic_max_targets = options.max_targets;
+  cfg.traffic_range_nm = 60.0f;
+  cfg.traffic_spatial_index = options.grid;
+  cfg.datagram_packing = options.packing;
+
+  msfs_bridge::OwnshipData own;
+  own.latitude_deg = 47.0;
+  own.longitude_deg = 8.0;
+  own.altitude_ft = 8000.0;
+  own.ground_velocity_kt = 120.0;
+
+  CountingSocketOps socket_ops;
+  xp2gdl90::VirtualClock link_clock;
+  udp::ImpairedSocketOps impaired(&socket_ops, &link_clock);
+  impaired.setOptions(options.impairment);
+  udp::UDPBroadcaster broadcaster(
+      cfg.target_ip, cfg.target_port,
+      options.impaired ? static_cast<udp::detail::SocketOps *>(&impaired)
+                       : &socket_ops);
+  broadcaster.initialize();
+  udp::DatagramPacker packer(cfg.datagram_max_bytes);
+  const gdl90::GDL90Encoder encoder;
+  xp2gdl90::traffic::TrackTable tracks;
+  tracks.setGridCellSize(
+      options.grid ? cfg.traffic_range_nm * 1852.0 : 0.0);
+  xp2gdl90::traffic::TrafficSnapshot snapshot;
+  std::vector<uint32_t> query_rows;
+  xp2gdl90::traffic::GridQueryStats query_stats;
+  std::vector<gdl90::PositionData> reports;
+  gdl90::FrameArena frames;
+  gdl90::TrafficFrameCache frame_cache;
+  std::vector<udp::SendBuffer> buffers;
+  SyntheticTraffic traffic(count, own.latitude_deg, own.longitude_deg);
+  xp2gdl90::TaskPool pool;
+  std::string error;
+  if (threads > 0 && !pool.start(threads, &error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+  }
+  xp2gdl90::traffic::ParallelTrafficBuild parallel;
+  parallel.pool = &pool;
+
+  std::vector<double> latencies_us;
+  latencies_us.reserve(static_cast<size_t>(options.ticks));
+  uint64_t frames_sent = 0;
+  const uint64_t calls_before = socket_ops.calls;
+  double busy_s = 0.0;
+  for (int tick = 0; tick < options.ticks; ++tick) {
+    const double now = static_cast<double>(tick);
+    traffic.step(1.0);
+    link_clock.advance(now - link_clock.now());
+    const Clock::time_point start = Clock::now();
+    for (const msfs_bridge::TrafficData &target : traffic.targets()) {
+      msfs_bridge::UpsertTrafficTarget(&tracks, &snapshot, target, now);
+    }
+    tracks.evictStale(now, 5.0, &snapshot);
+    reports.clear();
+    query_rows.clear();
+    tracks.queryNear(own.latitude_deg, own.longitude_deg,
+                     cfg.traffic_range_nm * 1852.0, &query_rows,
+                     &query_stats);
+    msfs_bridge::BuildTrafficPositions(&snapshot, cfg, &own,
+                                       tracks.hasGrid() ? &query_rows
+                                                        : nullptr,
+                                       &reports, &parallel);
+    xp2gdl90::traffic::EncodeTrafficReports(encoder, reports.data(),
+                                            reports.size(), frames,
+                                            &frame_cache, &parallel);
+    if (cfg.datagram_packing) {
+      for (size_t i = 0; i < frames.frameCount(); ++i) {
+        packer.append(frames.frameData(i), frames.frameSize(i), false,
+                      broadcaster);
+      }
+      packer.flush(broadcaster);
+    } else {
+      buffers.clear();
+      for (size_t i = 0; i < frames.frameCount(); ++i) {
+        buffers.push_back(
+            udp::SendBuffer{frames.frameData(i), frames.frameSize(i)});
+      }
+      broadcaster.sendBatch(buffers.data(), buffers.size());
+    }
+    const double elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    busy_s += elapsed;
+    latencies_us.push_back(elapsed * 1e6);
+    frames_sent += frames.frameCount();
+  }
+
+  std::sort(latencies_us.begin(), latencies_us.end());
+  const double ticks = static_cast<double>(options.ticks);
+  PipelineResult result;
+  result.targets = count;
+  result.threads = pool.threads();
+  result.ticks_per_s = busy_s > 0.0 ? ticks / busy_s : 0.0;
+  result.frames_per_s =
+      busy_s > 0.0 ? static_cast<double>(frames_sent) / busy_s : 0.0;
+  result.frames_per_tick = static_cast<double>(frames_sent) / ticks;
+  result.syscalls_per_tick =
+      static_cast<double>(socket_ops.calls - calls_before) / ticks;
+  result.p50_us = latencies_us[latencies_us.size() / 2];
+  result.p99_us = latencies_us[std::min(latencies_us.size() - 1,
+                                        latencies_us.size() * 99 / 100)];
+  if (options.impaired) {
+    // Let the link drain what the last sweep left queued.
+    link_clock.advance(60.0);
+    impaired.pump();
+    const udp::ImpairmentStats &link = impaired.stats();
+    result.delivered_pct =
+        link.offered > 0 ? 100.0 * static_cast<double>(link.delivered) /
+                               static_cast<double>(link.offered)
+                         : 100.0;
+  }
+  return result;
+}
+
+// Throughput against the first run at the same target count, which is the
+// first entry of --threads.
+double Speedup(const std::vector<PipelineResult> &results,
+               const PipelineResult &result) {
+  for (const PipelineResult &base : results) {
+    if (base.targets == result.targets) {
+      return base.ticks_per_s > 0.0 ? result.ticks_per_s / base.ticks_per_s
+                                    : 0.0;
+    }
+  }
+  return 0.0;
+}
+
+void PrintPipeline(const std::vector<PipelineResult> &results, bool json) {
+  if (json) {
+    std::printf("{\n  \"pipeline\": [");
+    for (size_t i = 0; i < results.size(); ++i) {
+      const PipelineResult &r = results[i];
+      std::printf("%s\n    {\"targets\": %zu, \"threads\": %zu, "
+                  "\"ticks_per_s\": %.1f, \"frames_per_s\": %.1f, "
+                  "\"frames_per_tick\": %.1f, \"syscalls_per_tick\": %.2f, "
+                  "\"p50_us\": %.2f, \"p99_us\": %.2f, "
+                  "\"speedup\": %.2f, \"delivered_pct\": %.2f}",
+                  i == 0 ? "" : ",", r.targets, r.threads, r.ticks_per_s,
+                  r.frames_per_s, r.frames_per_tick, r.syscalls_per_tick,
+                  r.p50_us, r.p99_us, Speedup(results, r), r.delivered_pct);
+    }
+    std::printf("\n  ]\n}\n");
+    return;
+  }
+  std::printf("%8s %8s %12s %12s %10s %10s %10s %10s %8s %10s\n",
+              "targets", "threads", "ticks/s", "frames/s", "frames",
+              "syscalls", "p50 us", "p99 us", "speedup", "delivered");
+  for (const PipelineResult &r : results) {
+    std::printf("%8zu %8zu %12.1f %12.1f %10.1f %10.2f %10.2f %10.2f %8.2f "
+                "%9.2f%%\n",
+                r.targets, r.threads, r.ticks_per_s, r.frames_per_s,
+                r.frames_per_tick, r.syscalls_per_tick, r.p50_us, r.p99_us,
+                Speedup(results, r), r.delivered_pct);
+  }
+}
+
+bool ParseCounts(const char *text, bool allow_zero, std::vector<size_t> *out) {
+  out->clear();
+  const char *cursor = text;
+  while (*cursor) {
+    char *end = nullptr;
+    const unsigned long value = std::strtoul(cursor, &end, 10);
+    if (end == cursor || (value == 0 && !allow_zero)) {
+      return false;
+    }
+    out->push_back(static_cast<size_t>(value));
+    cursor = *end == ',' ? end + 1 : end;
+    if (*end && *end != ',') {
+      return false;
+    }
+  }
+  return !out->empty();
+}
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "usage: xp2gdl90_bench [--json] [--filter TEXT] "
+               "[--min-time SECONDS] [--list]\n"
+               "       xp2gdl90_bench --pipeline [--json] [--targets N,N,...] "
+               "[--ticks N] [--max-targets N] [--packing] [--grid]\n"
+               "                      [--threads N,N,...] [--loss P] "
+               "[--latency-ms MS] [--jitter-ms MS]\n"
+               "                      [--link-kbps K] [--send-buffer-kb K] "
+               "[--refuse P]\n");
+}
+
+} // namespace
+
+void *operator new(std::size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, char **argv) {
+  bool json = false;
+  bool list = false;
+  std::string filter;
+  double min_seconds = 0.2;
+  bool pipeline = false;
+  PipelineOptions pipeline_options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--json") {
+      json = true;
+    } else if (arg == "--pipeline") {
+      pipeline = true;
+    } else if (arg == "--packing") {
+      pipeline_options.packing = true;
+    } else if (arg == "--grid") {
+      pipeline_options.grid = true;
+    } else if (arg == "--targets" && i + 1 < argc) {
+      if (!ParseCounts(argv[++i], false, &pipeline_options.target_counts)) {
+        PrintUsage();
+        return 2;
+      }
+    } else if (arg == "--threads" && i + 1 < argc) {
+      if (!ParseCounts(argv[++i], true, &pipeline_options.thread_counts)) {
+        PrintUsage();
+        return 2;
+      }
+    } else if (arg == "--ticks" && i + 1 < argc) {
+      pipeline_options.ticks = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--max-targets" && i + 1 < argc) {
+      pipeline_options.max_targets = static_cast<uint8_t>(
+          std::min(255, std::max(1, std::atoi(argv[++i]))));
+    } else if ((arg == "--loss" || arg == "--refuse" ||
+                arg == "--latency-ms" || arg == "--jitter-ms" ||
+                arg == "--link-kbps" || arg == "--send-buffer-kb") &&
+               i + 1 < argc) {
+      const double value = std::max(0.0, std::strtod(argv[++i], nullptr));
+      udp::ImpairmentOptions &impairment = pipeline_options.impairment;
+      if (arg == "--loss") {
+        impairment.loss = value;
+      } else if (arg == "--refuse") {
+        impairment.buffer_full = value;
+      } else if (arg == "--latency-ms") {
+        impairment.latency_s = value / 1000.0;
+      } else if (arg == "--jitter-ms") {
+        impairment.jitter_s = value / 1000.0;
+      } else if (arg == "--link-kbps") {
+        impairment.bandwidth_bytes_per_s = value * 1000.0 / 8.0;
+      } else {
+        impairment.send_buffer_bytes = static_cast<size_t>(value * 1024.0);
+      }
+      pipeline_options.impaired = true;
+    } else if (arg == "--list") {
+      list = true;
+    } else if (arg == "--filter" && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (arg == "--min-time" && i + 1 < argc) {
+      min_seconds = std::strtod(argv[++i], nullptr);
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  if (pipeline) {
+    std::vector<PipelineResult> results;
+    for (size_t count : pipeline_options.target_counts) {
+      for (size_t threads : pipeline_options.thread_counts) {
+        results.push_back(RunPipeline(count, threads, pipeline_options));
+      }
+    }
+    PrintPipeline(results, json);
+    return 0;
+  }
+
+  std::vector<Result> results;
+  for (const Benchmark &benchmark : kBenchmarks) {
+    if (!filter.empty() &&
+        std::string_view(benchmark.name).find(filter) == std::string::npos) {
+      continue;
+    }
+    if (list) {
+      std::printf("%s\n", benchmark.name);
+      continue;
+    }
+    results.push_back(Measure(benchmark, min_seconds));
+  }
+  if (!list) {
+    if (json) {
+      PrintJson(results);
+    } else {
+      PrintTable(results);
+    }
+  }
+  return 0;
+}
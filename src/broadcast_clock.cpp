@@ -1,26 +1,85 @@
 #include "xp2gdl90/broadcast_clock.h"
 
-#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <limits>
 
 namespace xp2gdl90 {
+namespace {
 
-BroadcastClockResult UpdateBroadcastClock(float simulator_time,
-                                          float elapsed_time,
+// Bucket upper edges in milliseconds of deviation from the period.
+constexpr std::array<double, SEND_INTERVAL_BUCKETS - 1> kBucketEdgesMs = {
+    -100.0, -20.0, -5.0, -1.0, 1.0, 5.0, 20.0, 100.0};
+
+// Spacing of float values around `value`, the resolution of a float
+// simulator time source.
+double FloatStep(double value) {
+  const float as_float = static_cast<float>(value);
+  return static_cast<double>(
+             std::nextafter(as_float, std::numeric_limits<float>::infinity())) -
+         static_cast<double>(as_float);
+}
+
+} // namespace
+
+double MonotonicSeconds() {
+  using Clock = std::chrono::steady_clock;
+  static const Clock::time_point start = Clock::now();
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+namespace {
+
+class SystemClockImpl final : public Clock {
+public:
+  double monotonicSeconds() override { return MonotonicSeconds(); }
+  int64_t wallMicroseconds() override {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+  }
+};
+
+} // namespace
+
+Clock &SystemClock() {
+  static SystemClockImpl clock;
+  return clock;
+}
+
+BroadcastClockResult UpdateBroadcastClock(double simulator_time,
+                                          double monotonic_time,
                                           bool replay_active,
                                           BroadcastClockState *state) {
   const bool simulator_time_valid =
-      std::isfinite(static_cast<double>(simulator_time)) &&
-      simulator_time >= 0.0f;
-  const bool elapsed_time_valid =
-      std::isfinite(static_cast<double>(elapsed_time)) && elapsed_time >= 0.0f;
-
-  float resolved_time = 0.0f;
-  if ((replay_active || !simulator_time_valid) && elapsed_time_valid) {
-    resolved_time = elapsed_time;
+      std::isfinite(simulator_time) && simulator_time >= 0.0;
+  const bool monotonic_time_valid =
+      std::isfinite(monotonic_time) && monotonic_time >= 0.0;
+
+  double resolved_time = 0.0;
+  bool simulator_domain = false;
+  if ((replay_active || !simulator_time_valid) && monotonic_time_valid) {
+    resolved_time = monotonic_time;
   } else if (simulator_time_valid) {
     resolved_time = simulator_time;
-  } else if (elapsed_time_valid) {
-    resolved_time = elapsed_time;
+    simulator_domain = true;
+  } else if (monotonic_time_valid) {
+    resolved_time = monotonic_time;
+  }
+
+  // Refine simulator time with the monotonic delta while both move forward.
+  // A paused simulator holds the result within one step of its time; time
+  // acceleration pins it to the lower edge until the two agree again.
+  if (state && state->initialized && simulator_domain &&
+      state->simulator_domain &&
+      simulator_time >= state->last_simulator_time &&
+      monotonic_time >= state->last_monotonic_time) {
+    const double step = FloatStep(simulator_time);
+    const double advanced =
+        state->last_time + (monotonic_time - state->last_monotonic_time);
+    resolved_time =
+        (std::max)(state->last_time, std::clamp(advanced, simulator_time - step,
+                                                simulator_time + step));
   }
 
   BroadcastClockResult result;
@@ -35,8 +94,77 @@ BroadcastClockResult UpdateBroadcastClock(float simulator_time,
                              resolved_time < state->last_time);
   state->initialized = true;
   state->replay_active = replay_active;
+  state->simulator_domain = simulator_domain;
   state->last_time = resolved_time;
+  state->last_simulator_time = simulator_time;
+  state->last_monotonic_time = monotonic_time;
   return result;
 }
 
+BroadcastClockResult UpdateBroadcastClock(double simulator_time, Clock &clock,
+                                          bool replay_active,
+                                          BroadcastClockState *state) {
+  return UpdateBroadcastClock(simulator_time, clock.monotonicSeconds(),
+                              replay_active, state);
+}
+
+double NextWakeInterval(double now, const double *deadlines, size_t count,
+                        double min_interval_s, double max_interval_s) {
+  double interval = max_interval_s;
+  for (size_t i = 0; deadlines && i < count; ++i) {
+    if (!std::isnan(deadlines[i])) {
+      interval = (std::min)(interval, deadlines[i] - now);
+    }
+  }
+  return (std::max)(min_interval_s, interval);
+}
+
+const char *SendClassName(SendClass send_class) {
+  switch (send_class) {
+  case SendClass::HEARTBEAT:
+    return "Heartbeat";
+  case SendClass::OWNSHIP:
+    return "Ownship";
+  case SendClass::GEO_ALTITUDE:
+    return "Geo altitude";
+  case SendClass::AHRS:
+    return "AHRS";
+  case SendClass::DEVICE_INFO:
+    return "ForeFlight ID";
+  case SendClass::TRAFFIC:
+    return "Traffic";
+  }
+  return "Unknown";
+}
+
+void SendIntervalHistogram::recordSend(double now, double period_s) {
+  const double previous = last_send_;
+  last_send_ = now;
+  if (std::isnan(previous) || !(now >= previous)) {
+    return;
+  }
+
+  const double interval = now - previous;
+  const double deviation_ms = (interval - period_s) * 1000.0;
+  size_t bucket = 0;
+  while (bucket < kBucketEdgesMs.size() &&
+         deviation_ms >= kBucketEdgesMs[bucket]) {
+    ++bucket;
+  }
+  ++buckets_[bucket];
+  min_s_ = count_ > 0 ? (std::min)(min_s_, interval) : interval;
+  max_s_ = (std::max)(max_s_, interval);
+  sum_s_ += interval;
+  ++count_;
+}
+
+void SendIntervalHistogram::reset() { *this = SendIntervalHistogram{}; }
+
+const char *SendIntervalHistogram::bucketLabel(size_t bucket) {
+  static const char *const kLabels[SEND_INTERVAL_BUCKETS] = {
+      "< -100 ms", "-100..-20", "-20..-5", "-5..-1", "+-1 ms",
+      "1..5",      "5..20",     "20..100", "> 100 ms"};
+  return bucket < SEND_INTERVAL_BUCKETS ? kLabels[bucket] : "";
+}
+
 } // namespace xp2gdl90
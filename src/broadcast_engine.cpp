@@ -0,0 +1,294 @@
+#include "xp2gdl90/broadcast_engine.h"
+
+namespace xp2gdl90 {
+
+BroadcastOptions MakeBroadcastOptions(const Settings &cfg) {
+  BroadcastOptions options;
+  options.datagram_packing = cfg.datagram_packing;
+  options.datagram_max_bytes = cfg.datagram_max_bytes;
+  options.sender_thread = cfg.sender_thread;
+  options.overflow_policy =
+      static_cast<udp::OverflowPolicy>(cfg.sender_overflow_policy);
+  options.sender_tuning = MakeWorkerThreadTuning(cfg);
+  options.link_probe = cfg.link_probe;
+  return options;
+}
+
+BroadcastEngine::~BroadcastEngine() { stopSender(); }
+
+void BroadcastEngine::attach(udp::UDPBroadcaster *broadcaster) {
+  if (broadcaster == broadcaster_) {
+    return;
+  }
+  stopSender();
+  if (broadcaster_) {
+    packer_.flush(*broadcaster_);
+  }
+  broadcaster_ = broadcaster;
+}
+
+bool BroadcastEngine::configure(const BroadcastOptions &options,
+                                std::string *out_error) {
+  if (packer_.maxDatagramBytes() != options.datagram_max_bytes) {
+    if (broadcaster_) {
+      packer_.flush(*broadcaster_);
+    }
+    packer_.setMaxDatagramBytes(options.datagram_max_bytes);
+  }
+  options_ = options;
+  if (!options.sender_thread || !broadcaster_) {
+    stopSender();
+    if (out_error) {
+      out_error->clear();
+    }
+    return true;
+  }
+
+  if (!sender_) {
+    packer_.flush(*broadcaster_);
+    sender_ = std::make_unique<udp::NetworkSender>(*broadcaster_);
+    // Posted first, so the thread starts out tuned.
+    sender_->setThreadTuning(options.sender_tuning);
+    if (!sender_->start()) {
+      if (out_error) {
+        *out_error = sender_->lastError();
+      }
+      sender_.reset();
+      options_.sender_thread = false;
+      return false;
+    }
+    sender_errors_seen_ = 0;
+  }
+  sender_->setOverflowPolicy(options.overflow_policy);
+  sender_->setThreadTuning(options.sender_tuning);
+  sender_->setPacking(options.datagram_packing, options.datagram_max_bytes);
+  if (out_error) {
+    out_error->clear();
+  }
+  return true;
+}
+
+int BroadcastEngine::sendFrame(const uint8_t *data, size_t size,
+                               uint32_t route, bool leading) {
+  return send(data, size, route, 0, leading, nullptr);
+}
+
+int BroadcastEngine::sendFrame(const gdl90::FrameRef &frame, uint32_t route,
+                               bool leading) {
+  if (!frame) {
+    recordError("Frame pool exhausted");
+    return -1;
+  }
+  return send(frame.data(), frame.size(), route, 0, leading, &frame);
+}
+
+int BroadcastEngine::send(const uint8_t *data, size_t size, uint32_t route,
+                          uint32_t message_class, bool leading,
+                          const gdl90::FrameRef *frame) {
+  if (shared_output_) {
+    shared_output_->publishFrame(data, size);
+  }
+  if (!broadcaster_) {
+    recordError("Broadcaster not attached");
+    return -1;
+  }
+  int sent = static_cast<int>(size);
+  if (sender_) {
+    const bool queued = frame ? sender_->enqueue(*frame, route, leading)
+                              : sender_->enqueue(data, size, route, leading);
+    if (!queued) {
+      recordError("Send queue full");
+      return -1;
+    }
+  } else if (!options_.datagram_packing) {
+    sent = broadcaster_->send(data, size, route);
+  } else if (!packer_.append(data, size, leading, *broadcaster_, route)) {
+    sent = -1;
+  }
+  if (sent < 0) {
+    recordError(broadcaster_->getLastError());
+    return -1;
+  }
+  ++stats_.packets_sent;
+  stats_.bytes_sent += static_cast<uint64_t>(sent);
+  accounting_.record(message_class, route, broadcaster_->destinationCount(),
+                     1, static_cast<uint64_t>(sent));
+  sent_this_tick_ = true;
+  last_error_.clear();
+  return sent;
+}
+
+int BroadcastEngine::sendMessage(const uint8_t *data, size_t size,
+                                 uint32_t message_class, bool leading) {
+  if (!broadcaster_) {
+    // Still published, and counted as an error.
+    return sendFrame(data, size, udp::ALL_DESTINATIONS, leading);
+  }
+  return send(data, size, broadcaster_->routeMessage(message_class, size),
+              message_class, leading, nullptr);
+}
+
+int BroadcastEngine::sendMessage(const gdl90::FrameRef &frame,
+                                 uint32_t message_class, bool leading) {
+  if (!broadcaster_ || !frame) {
+    return sendFrame(frame, udp::ALL_DESTINATIONS, leading);
+  }
+  return send(frame.data(), frame.size(),
+              broadcaster_->routeMessage(message_class, frame.size()),
+              message_class, leading, &frame);
+}
+
+void BroadcastEngine::startTraffic(const gdl90::FrameArena &frames,
+                                   double now, double window_s) {
+  traffic_frames_ = &frames;
+  pacer_.start(frames.frameCount(), now, window_s);
+  if (shared_output_) {
+    shared_output_->setTraffic(frames);
+  }
+}
+
+size_t BroadcastEngine::sendPacedTraffic(double now) {
+  size_t first = 0;
+  const size_t count = pacer_.release(now, &first);
+  if (count == 0 || !traffic_frames_) {
+    return 0;
+  }
+  const gdl90::FrameArena &frames = *traffic_frames_;
+  if (shared_output_) {
+    for (size_t i = first; i < first + count; ++i) {
+      shared_output_->publishFrame(frames.frameData(i), frames.frameSize(i));
+    }
+  }
+  if (!broadcaster_) {
+    return 0;
+  }
+  // Bytes of the first `sent` frames of the slice.
+  const auto prefix_bytes = [&frames, first](size_t sent) {
+    size_t bytes = 0;
+    for (size_t i = first; i < first + sent; ++i) {
+      bytes += frames.frameSize(i);
+    }
+    return bytes;
+  };
+  const uint32_t route =
+      broadcaster_->routeMessage(MESSAGE_TRAFFIC, prefix_bytes(count));
+
+  size_t sent_count = 0;
+  size_t sent_bytes = 0;
+  bool saw_error = false;
+  if (sender_) {
+    sent_count = sender_->enqueueTraffic(frames, first, count, route);
+    sent_bytes = prefix_bytes(sent_count);
+    if (sent_count < count) {
+      saw_error = true;
+      recordError("Traffic queue full");
+    }
+  } else if (options_.datagram_packing) {
+    for (size_t i = first; i < first + count; ++i) {
+      if (packer_.append(frames.frameData(i), frames.frameSize(i), false,
+                         *broadcaster_, route)) {
+        ++sent_count;
+        sent_bytes += frames.frameSize(i);
+      } else {
+        saw_error = true;
+        recordError(broadcaster_->getLastError());
+      }
+    }
+  } else {
+    // One vectored send per slice instead of a sendto per target.
+    send_buffers_.clear();
+    for (size_t i = first; i < first + count; ++i) {
+      send_buffers_.push_back(
+          udp::SendBuffer{frames.frameData(i), frames.frameSize(i)});
+    }
+    const int sent_frames =
+        broadcaster_->sendBatch(send_buffers_.data(), send_buffers_.size(),
+                                route);
+    sent_count = sent_frames > 0 ? static_cast<size_t>(sent_frames) : 0;
+    sent_bytes = prefix_bytes(sent_count);
+    if (sent_count < count) {
+      saw_error = true;
+      recordError(broadcaster_->getLastError());
+    }
+  }
+  stats_.packets_sent += sent_count;
+  stats_.traffic_packets_sent += sent_count;
+  stats_.bytes_sent += sent_bytes;
+  accounting_.record(MESSAGE_TRAFFIC, route, broadcaster_->destinationCount(),
+                     sent_count, sent_bytes);
+  sent_this_tick_ = sent_this_tick_ || sent_count > 0;
+  if (!saw_error) {
+    last_error_.clear();
+  }
+  return sent_bytes;
+}
+
+void BroadcastEngine::resetTraffic() {
+  pacer_.reset();
+  traffic_frames_ = nullptr;
+  if (shared_output_) {
+    shared_output_->clearTraffic();
+  }
+}
+
+void BroadcastEngine::flush() {
+  if (options_.link_probe && sent_this_tick_ && broadcaster_) {
+    sendLinkProbe();
+  }
+  sent_this_tick_ = false;
+  if (shared_output_) {
+    shared_output_->publishSnapshot();
+  }
+  if (sender_) {
+    sender_->notify();
+    const uint64_t errors = sender_->stats().send_errors;
+    if (errors != sender_errors_seen_) {
+      stats_.send_errors += errors - sender_errors_seen_;
+      sender_errors_seen_ = errors;
+      last_error_ = sender_->lastError();
+    }
+    return;
+  }
+  if (broadcaster_ && packer_.flush(*broadcaster_) < 0) {
+    recordError(broadcaster_->getLastError());
+  }
+}
+
+double BroadcastEngine::senderLeadSeconds() const {
+  return sender_ ? sender_->stats().averageLatencyUs() / 1e6 : 0.0;
+}
+
+void BroadcastEngine::recordError(const std::string &error) {
+  ++stats_.send_errors;
+  last_error_ = error;
+}
+
+void BroadcastEngine::stopSender() {
+  sender_.reset();
+  sender_errors_seen_ = 0;
+}
+
+// Stamped as it is handed on, so the probe's delay includes the sender
+// thread's queue but not the tick's own encoding.
+void BroadcastEngine::sendLinkProbe() {
+  LinkProbeMark mark;
+  mark.sequence = ++probe_sequence_;
+  mark.send_time_us = clock_->wallMicroseconds();
+  // Goes wherever heartbeats go, and is accounted with them. With the pool
+  // dry the mark is encoded locally and copied instead.
+  gdl90::FrameRef frame = frame_pool_.acquire();
+  int sent = -1;
+  if (frame) {
+    EncodeLinkProbe(mark, *frame.buffer());
+    sent = sendMessage(frame, MESSAGE_HEARTBEAT);
+  } else {
+    gdl90::FrameBuffer local;
+    EncodeLinkProbe(mark, local);
+    sent = sendMessage(local, MESSAGE_HEARTBEAT);
+  }
+  if (sent >= 0) {
+    ++stats_.probe_marks_sent;
+  }
+}
+
+} // namespace xp2gdl90
@@ -0,0 +1,42 @@
+#include "xp2gdl90/cached_frame.h"
+
+#include <cstring>
+
+#include "xp2gdl90/gdl90_framing.h"
+
+namespace gdl90 {
+
+size_t CachedFrame::update(const uint8_t *payload, size_t size) {
+  if (size > payload_.size()) {
+    size = payload_.size();
+  }
+  if (valid_ && size == payload_size_ &&
+      std::memcmp(payload_.data(), payload, size) == 0) {
+    ++hits_;
+    return frame_.size();
+  }
+  std::memcpy(payload_.data(), payload, size);
+  payload_size_ = size;
+  return reframe();
+}
+
+size_t CachedFrame::patch(size_t offset, const uint8_t *bytes, size_t size) {
+  if (!valid_ || offset > payload_size_ || size > payload_size_ - offset) {
+    return 0;
+  }
+  if (std::memcmp(payload_.data() + offset, bytes, size) == 0) {
+    ++hits_;
+    return frame_.size();
+  }
+  std::memcpy(payload_.data() + offset, bytes, size);
+  return reframe();
+}
+
+size_t CachedFrame::reframe() {
+  ++misses_;
+  frame_.resize(FrameMessage(payload_.data(), payload_size_, frame_.data()));
+  valid_ = true;
+  return frame_.size();
+}
+
+} // namespace gdl90
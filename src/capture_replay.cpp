@@ -0,0 +1,214 @@
+#include "xp2gdl90/capture_replay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#include "xp2gdl90/compact_capture.h"
+#include "xp2gdl90/gdl90_framing.h"
+#include "xp2gdl90/stream_capture.h"
+
+namespace udp {
+
+namespace {
+
+constexpr uint32_t kPcapMagic = 0xA1B23C4Du;
+constexpr size_t kPcapFileHeaderSize = 24;
+constexpr size_t kPcapRecordHeaderSize = 16;
+constexpr uint32_t kAddressMask = 0xFFFFFFu;
+constexpr auto kLateThreshold = std::chrono::milliseconds(1);
+
+uint32_t Get32(const uint8_t *bytes) {
+  uint32_t value = 0;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+struct RawRecord {
+  int64_t timestamp_ns = 0;
+  CaptureRecordHeader header;
+  const uint8_t *data = nullptr;
+};
+
+} // namespace
+
+bool ReadCapture(const std::string &path, std::vector<CaptureDatagram> *out,
+                 std::string *out_error) {
+  if (!out) {
+    return false;
+  }
+  if (IsCompactCapture(path)) {
+    return ReadCompactCapture(path, out, out_error);
+  }
+  out->clear();
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    if (out_error) {
+      *out_error = "Cannot open capture file: " + path;
+    }
+    return false;
+  }
+  const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                                   std::istreambuf_iterator<char>());
+  if (bytes.size() < kPcapFileHeaderSize || Get32(bytes.data()) != kPcapMagic ||
+      Get32(bytes.data() + 20) != CAPTURE_LINKTYPE) {
+    if (out_error) {
+      *out_error = "Not an xp2gdl90 stream capture: " + path;
+    }
+    return false;
+  }
+
+  std::vector<RawRecord> records;
+  size_t offset = kPcapFileHeaderSize;
+  while (offset + kPcapRecordHeaderSize <= bytes.size()) {
+    const uint8_t *pcap = bytes.data() + offset;
+    const size_t length = Get32(pcap + 8);
+    offset += kPcapRecordHeaderSize;
+    if (length > bytes.size() - offset) {
+      break; // Cut short while the ring was being written.
+    }
+    RawRecord record;
+    if (length >= sizeof(CaptureRecordHeader)) {
+      std::memcpy(&record.header, bytes.data() + offset,
+                  sizeof(record.header));
+    }
+    if (record.header.sequence != 0 &&
+        record.header.size <= length - sizeof(CaptureRecordHeader)) {
+      record.timestamp_ns = static_cast<int64_t>(Get32(pcap)) * 1000000000 +
+                            Get32(pcap + 4);
+      record.data = bytes.data() + offset + sizeof(CaptureRecordHeader);
+      records.push_back(record);
+    }
+    offset += length;
+  }
+  std::sort(records.begin(), records.end(),
+            [](const RawRecord &a, const RawRecord &b) {
+              return a.header.sequence < b.header.sequence;
+            });
+
+  // One datagram's records are consecutive and share its timestamp and
+  // destination.
+  const RawRecord *previous = nullptr;
+  for (const RawRecord &record : records) {
+    const bool continues =
+        previous && record.header.sequence == previous->header.sequence + 1 &&
+        record.timestamp_ns == previous->timestamp_ns &&
+        record.header.destination == previous->header.destination;
+    if (!continues) {
+      CaptureDatagram datagram;
+      datagram.timestamp_ns = record.timestamp_ns;
+      datagram.sequence = record.header.sequence;
+      datagram.destination = record.header.destination;
+      out->push_back(std::move(datagram));
+    }
+    std::vector<uint8_t> &data = out->back().data;
+    data.insert(data.end(), record.data, record.data + record.header.size);
+    previous = &record;
+  }
+  return true;
+}
+
+CaptureReplay::CaptureReplay(UDPBroadcaster &broadcaster,
+                             const ReplayOptions &options)
+    : broadcaster_(broadcaster), options_(options),
+      packer_(options.max_datagram_bytes) {
+  if (options_.traffic_copies < 1) {
+    options_.traffic_copies = 1;
+  } else if (options_.traffic_copies > REPLAY_MAX_TRAFFIC_COPIES) {
+    options_.traffic_copies = REPLAY_MAX_TRAFFIC_COPIES;
+  }
+}
+
+void CaptureReplay::run(const std::vector<CaptureDatagram> &datagrams,
+                        const std::atomic<bool> *stop) {
+  using Clock = std::chrono::steady_clock;
+  const Clock::time_point start = Clock::now();
+  const bool paced = options_.speed > 0.0;
+  bool started = false;
+  int64_t first_ns = 0;
+
+  for (const CaptureDatagram &datagram : datagrams) {
+    if (stop && stop->load(std::memory_order_relaxed)) {
+      break;
+    }
+    if (options_.source_destination != REPLAY_ALL_DESTINATIONS &&
+        datagram.destination != options_.source_destination) {
+      continue;
+    }
+    if (!started) {
+      first_ns = datagram.timestamp_ns;
+      started = true;
+    }
+    if (paced) {
+      const auto offset = std::chrono::nanoseconds(static_cast<int64_t>(
+          static_cast<double>(datagram.timestamp_ns - first_ns) /
+          options_.speed));
+      const Clock::time_point due =
+          start + std::chrono::duration_cast<Clock::duration>(offset);
+      const Clock::time_point now = Clock::now();
+      if (now < due) {
+        std::this_thread::sleep_until(due);
+      } else if (now - due > kLateThreshold) {
+        ++stats_.late;
+      }
+    }
+    sendDatagram(datagram);
+  }
+  stats_.elapsed_seconds +=
+      std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void CaptureReplay::sendDatagram(const CaptureDatagram &datagram) {
+  if (options_.traffic_copies > 1) {
+    sendMultiplied(datagram);
+    return;
+  }
+  if (broadcaster_.send(datagram.data.data(), datagram.data.size()) < 0) {
+    ++stats_.send_errors;
+    return;
+  }
+  ++stats_.datagrams;
+  stats_.bytes += datagram.data.size();
+}
+
+void CaptureReplay::sendMultiplied(const CaptureDatagram &datagram) {
+  decoder_.reset(datagram.data.data(), datagram.data.size());
+  gdl90::FrameSpan frame;
+  while (decoder_.next(&frame)) {
+    appendFrame(frame.data, frame.size,
+                frame.messageId() == gdl90::MSG_ID_HEARTBEAT);
+    gdl90::PositionData report;
+    if (frame.messageId() != gdl90::MSG_ID_TRAFFIC_REPORT ||
+        !gdl90::DecodePositionReport(frame, &report)) {
+      continue;
+    }
+    const uint32_t address = report.icao_address;
+    for (uint32_t copy = 1; copy < options_.traffic_copies; ++copy) {
+      report.icao_address = (address + copy * options_.address_step) &
+                            kAddressMask;
+      const size_t size = encoder_.encodeTrafficReportInto(report, frame_);
+      packer_.append(frame_.data(), size, false, broadcaster_);
+      ++stats_.synthetic_reports;
+    }
+  }
+  packer_.flush(broadcaster_);
+
+  const DatagramPackerStats &sent = packer_.stats();
+  stats_.datagrams += sent.datagrams_sent;
+  stats_.bytes += sent.bytes_sent;
+  stats_.send_errors += sent.send_errors;
+  packer_.resetStats();
+}
+
+// Passes a decoded frame through, re-framed from its payload.
+void CaptureReplay::appendFrame(const uint8_t *payload, size_t size,
+                                bool leading) {
+  scratch_.resize(gdl90::MaxFrameSize(size));
+  const size_t framed = gdl90::FrameMessage(payload, size, scratch_.data());
+  packer_.append(scratch_.data(), framed, leading, broadcaster_);
+}
+
+} // namespace udp
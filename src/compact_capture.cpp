@@ -0,0 +1,706 @@
+#include "xp2gdl90/compact_capture.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "xp2gdl90/gdl90_framing.h"
+#include "xp2gdl90/gdl90_layout.h"
+
+namespace udp {
+
+namespace {
+
+constexpr char kMagic[8] = {'X', 'P', 'G', 'D', 'L', 'C', 'A', 'P'};
+constexpr size_t kFileHeaderSize = sizeof(kMagic) + sizeof(uint32_t);
+constexpr uint32_t kBlockMagic = 0x4B4C4258u; // "XBLK"
+constexpr size_t kBlockHeaderSize = 24;
+// A block this large starts a new one early, so seeking stays cheap.
+constexpr size_t kMaxBlockBytes = 1 << 20;
+constexpr auto kWriterInterval = std::chrono::milliseconds(100);
+
+// The low two bits of each frame's first varint.
+constexpr uint64_t kKindLiteral = 0;
+constexpr uint64_t kKindRepeat = 1;
+constexpr uint64_t kKindPosition = 2;
+
+using Report = gdl90::layout::PositionReport;
+
+struct FieldSpec {
+  size_t offset;
+  size_t width;
+};
+
+// Every position report field outside the track key and the callsign.
+// The first kLinearFields are predicted from the track's last two reports
+// (a steady turn is a steady change of track); the rest repeat the last.
+constexpr FieldSpec kFields[] = {
+    {Report::Latitude::OFFSET, Report::Latitude::WIDTH},
+    {Report::Longitude::OFFSET, Report::Longitude::WIDTH},
+    {Report::Track::OFFSET, Report::Track::WIDTH},
+    {Report::Altitude::OFFSET, Report::Altitude::WIDTH},
+    {Report::HorizontalVelocity::OFFSET, Report::HorizontalVelocity::WIDTH},
+    {Report::VerticalVelocity::OFFSET, Report::VerticalVelocity::WIDTH},
+    {Report::AlertStatus::OFFSET, Report::AlertStatus::WIDTH},
+    {Report::Misc::OFFSET, Report::Misc::WIDTH},
+    {Report::Nic::OFFSET, Report::Nic::WIDTH},
+    {Report::Nacp::OFFSET, Report::Nacp::WIDTH},
+    {Report::EmitterCategory::OFFSET, Report::EmitterCategory::WIDTH},
+    {Report::EmergencyCode::OFFSET, Report::EmergencyCode::WIDTH},
+    {Report::Spare::OFFSET, Report::Spare::WIDTH},
+};
+constexpr size_t kFieldCount = sizeof(kFields) / sizeof(kFields[0]);
+constexpr size_t kLinearFields = 4;
+static_assert(kFieldCount == 13, "track state holds 13 fields");
+
+// A report's change mask. Linear fields take two bits each: 0 as
+// predicted, 1 and 2 one step above and below, 3 when the residual
+// follows; quantising a steady track leaves most within a step. Every
+// other field takes one bit, set when its residual follows.
+constexpr size_t MaskShift(size_t field) {
+  return field < kLinearFields ? 2 * field : kLinearFields + field;
+}
+constexpr uint32_t kCallsignBit = 1u << MaskShift(kFieldCount);
+
+uint32_t GetBits(const uint8_t *bytes, size_t offset, size_t width) {
+  uint32_t value = 0;
+  for (size_t bit = offset; bit < offset + width; ++bit) {
+    value = (value << 1) | ((bytes[bit / 8] >> (7 - bit % 8)) & 1u);
+  }
+  return value;
+}
+
+// `bytes` must be zero over the field.
+void PutBits(uint8_t *bytes, size_t offset, size_t width, uint32_t value) {
+  for (size_t i = 0; i < width; ++i) {
+    const size_t bit = offset + i;
+    if ((value >> (width - 1 - i)) & 1u) {
+      bytes[bit / 8] |= static_cast<uint8_t>(0x80u >> (bit % 8));
+    }
+  }
+}
+
+uint32_t FieldMask(size_t width) {
+  return width >= 32 ? 0xFFFFFFFFu : (uint32_t{1} << width) - 1u;
+}
+
+// `value` modulo 2^width, read as two's complement.
+int32_t SignExtend(uint32_t value, size_t width) {
+  value &= FieldMask(width);
+  const uint32_t sign = uint32_t{1} << (width - 1);
+  return static_cast<int32_t>(static_cast<int64_t>(value ^ sign) -
+                              static_cast<int64_t>(sign));
+}
+
+bool IsPositionReport(const uint8_t *payload, size_t size) {
+  return size == Report::SIZE &&
+         (payload[0] == gdl90::MSG_ID_TRAFFIC_REPORT ||
+          payload[0] == gdl90::MSG_ID_OWNSHIP_REPORT);
+}
+
+// Message type, address type and address in 29 bits.
+uint32_t TrackKey(const uint8_t *payload) {
+  const uint32_t traffic = payload[0] == gdl90::MSG_ID_TRAFFIC_REPORT;
+  return (traffic << 28) | (Report::AddressType::get(payload) << 24) |
+         Report::Address::get(payload);
+}
+
+uint32_t Predict(size_t field, uint32_t samples, uint32_t last,
+                 uint32_t before) {
+  if (samples == 0) {
+    return 0;
+  }
+  if (field >= kLinearFields || samples < 2) {
+    return last;
+  }
+  const size_t width = kFields[field].width;
+  return (last + static_cast<uint32_t>(SignExtend(last - before, width))) &
+         FieldMask(width);
+}
+
+// The mask bits for `residual` of `field`; sets `*follows` if the residual
+// must be written after the mask.
+uint32_t ResidualCode(size_t field, int32_t residual, bool *follows) {
+  uint32_t code = 0;
+  if (field >= kLinearFields) {
+    code = residual != 0 ? 1u : 0u;
+  } else if (residual == 1) {
+    code = 1;
+  } else if (residual == -1) {
+    code = 2;
+  } else if (residual != 0) {
+    code = 3;
+  }
+  *follows = code == (field >= kLinearFields ? 1u : 3u);
+  return code << MaskShift(field);
+}
+
+void PutVarint(std::vector<uint8_t> *out, uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+void PutSigned(std::vector<uint8_t> *out, int64_t value) {
+  PutVarint(out, (static_cast<uint64_t>(value) << 1) ^
+                     static_cast<uint64_t>(value >> 63));
+}
+
+bool GetVarint(const uint8_t *data, size_t size, size_t *offset,
+               uint64_t *out) {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64 && *offset < size; shift += 7) {
+    const uint8_t byte = data[(*offset)++];
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      *out = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool GetSigned(const uint8_t *data, size_t size, size_t *offset,
+               int64_t *out) {
+  uint64_t value = 0;
+  if (!GetVarint(data, size, offset, &value)) {
+    return false;
+  }
+  *out = static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+  return true;
+}
+
+void AppendFrame(const uint8_t *payload, size_t size,
+                 std::vector<uint8_t> *out) {
+  const size_t start = out->size();
+  out->resize(start + gdl90::MaxFrameSize(size));
+  out->resize(start + gdl90::FrameMessage(payload, size, out->data() + start));
+}
+
+template <typename T> void Put(uint8_t *out, const T &value) {
+  std::memcpy(out, &value, sizeof(value));
+}
+
+template <typename T> T Get(const uint8_t *bytes) {
+  T value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+} // namespace
+
+void CompactCaptureEncoder::reset(int64_t timestamp_ns) {
+  last_timestamp_ns_ = timestamp_ns;
+  tracks_.clear();
+  for (std::vector<uint8_t> &payload : last_payload_) {
+    payload.clear();
+  }
+}
+
+void CompactCaptureEncoder::encode(int64_t timestamp_ns, uint8_t destination,
+                                   const uint8_t *data, size_t size,
+                                   std::vector<uint8_t> *out) {
+  PutSigned(out, timestamp_ns - last_timestamp_ns_);
+  last_timestamp_ns_ = timestamp_ns;
+  out->push_back(destination);
+  if (!splitFrames(data, size)) {
+    // Not a clean run of frames: kept as sent.
+    PutVarint(out, 0);
+    PutVarint(out, size);
+    out->insert(out->end(), data, data + size);
+    return;
+  }
+  PutVarint(out, payload_ends_.size());
+  size_t start = 0;
+  for (const size_t end : payload_ends_) {
+    encodePayload(payloads_.data() + start, end - start, out);
+    start = end;
+  }
+}
+
+bool CompactCaptureEncoder::splitFrames(const uint8_t *data, size_t size) {
+  payloads_.clear();
+  payload_ends_.clear();
+  reframed_.clear();
+  decoder_.reset(data, size);
+  gdl90::FrameSpan frame;
+  while (decoder_.next(&frame)) {
+    payloads_.insert(payloads_.end(), frame.data, frame.data + frame.size);
+    payload_ends_.push_back(payloads_.size());
+    AppendFrame(frame.data, frame.size, &reframed_);
+  }
+  return !payload_ends_.empty() && reframed_.size() == size &&
+         std::memcmp(reframed_.data(), data, size) == 0;
+}
+
+void CompactCaptureEncoder::encodePayload(const uint8_t *payload, size_t size,
+                                          std::vector<uint8_t> *out) {
+  if (!IsPositionReport(payload, size)) {
+    std::vector<uint8_t> &last = last_payload_[payload[0]];
+    if (last.size() == size && std::memcmp(last.data(), payload, size) == 0) {
+      PutVarint(out, (uint64_t{payload[0]} << 2) | kKindRepeat);
+      return;
+    }
+    last.assign(payload, payload + size);
+    PutVarint(out, (uint64_t{size} << 2) | kKindLiteral);
+    out->insert(out->end(), payload, payload + size);
+    ++literal_;
+    return;
+  }
+
+  const uint32_t key = TrackKey(payload);
+  auto found = tracks_.find(key);
+  const bool new_track = found == tracks_.end();
+  if (new_track) {
+    Track track;
+    track.index = static_cast<uint32_t>(tracks_.size());
+    found = tracks_.emplace(key, track).first;
+  }
+  Track &track = found->second;
+  PutVarint(out, (uint64_t{track.index} << 2) | kKindPosition);
+  if (new_track) {
+    PutVarint(out, key);
+  }
+
+  std::array<int32_t, kFieldCount> residuals{};
+  std::array<bool, kFieldCount> follows{};
+  uint32_t mask = 0;
+  for (size_t i = 0; i < kFieldCount; ++i) {
+    const FieldSpec &field = kFields[i];
+    const uint32_t value = GetBits(payload, field.offset, field.width);
+    const uint32_t predicted =
+        Predict(i, track.samples, track.last[i], track.before[i]);
+    residuals[i] = SignExtend(value - predicted, field.width);
+    bool residual_follows = false;
+    mask |= ResidualCode(i, residuals[i], &residual_follows);
+    follows[i] = residual_follows;
+    track.before[i] = track.last[i];
+    track.last[i] = value;
+  }
+  const uint8_t *callsign = payload + Report::Callsign::BYTE;
+  if (std::memcmp(callsign, track.callsign.data(), track.callsign.size()) !=
+      0) {
+    mask |= kCallsignBit;
+    std::memcpy(track.callsign.data(), callsign, track.callsign.size());
+  }
+  ++track.samples;
+
+  PutVarint(out, mask);
+  for (size_t i = 0; i < kFieldCount; ++i) {
+    if (follows[i]) {
+      PutSigned(out, residuals[i]);
+    }
+  }
+  if (mask & kCallsignBit) {
+    out->insert(out->end(), callsign, callsign + track.callsign.size());
+  }
+  ++predicted_;
+}
+
+void CompactCaptureDecoder::reset(int64_t timestamp_ns) {
+  last_timestamp_ns_ = timestamp_ns;
+  tracks_.clear();
+  for (std::vector<uint8_t> &payload : last_payload_) {
+    payload.clear();
+  }
+}
+
+bool CompactCaptureDecoder::decode(const uint8_t *body, size_t size,
+                                   size_t *offset, CaptureDatagram *out) {
+  int64_t delta = 0;
+  uint64_t frames = 0;
+  if (!GetSigned(body, size, offset, &delta) || *offset >= size) {
+    return false;
+  }
+  last_timestamp_ns_ += delta;
+  out->timestamp_ns = last_timestamp_ns_;
+  out->destination = body[(*offset)++];
+  out->data.clear();
+  if (!GetVarint(body, size, offset, &frames) || frames > size) {
+    return false;
+  }
+  if (frames == 0) {
+    uint64_t length = 0;
+    if (!GetVarint(body, size, offset, &length) || length > size - *offset) {
+      return false;
+    }
+    out->data.assign(body + *offset, body + *offset + length);
+    *offset += length;
+    return true;
+  }
+
+  for (uint64_t frame = 0; frame < frames; ++frame) {
+    uint64_t head = 0;
+    if (!GetVarint(body, size, offset, &head)) {
+      return false;
+    }
+    const uint64_t kind = head & 3u;
+    const uint64_t value = head >> 2;
+    if (kind == kKindLiteral) {
+      if (value == 0 || value > gdl90::DECODER_MAX_FRAME ||
+          value > size - *offset) {
+        return false;
+      }
+      const uint8_t *payload = body + *offset;
+      last_payload_[payload[0]].assign(payload, payload + value);
+      AppendFrame(payload, value, &out->data);
+      *offset += value;
+      continue;
+    }
+    if (kind == kKindRepeat) {
+      if (value > 0xFF || last_payload_[value].empty()) {
+        return false;
+      }
+      const std::vector<uint8_t> &payload = last_payload_[value];
+      AppendFrame(payload.data(), payload.size(), &out->data);
+      continue;
+    }
+    if (kind != kKindPosition || value > tracks_.size()) {
+      return false;
+    }
+    if (value == tracks_.size()) {
+      uint64_t key = 0;
+      if (!GetVarint(body, size, offset, &key) || key >= (1u << 29)) {
+        return false;
+      }
+      Track track;
+      track.key = static_cast<uint32_t>(key);
+      tracks_.push_back(track);
+    }
+    Track &track = tracks_[value];
+    uint64_t mask = 0;
+    if (!GetVarint(body, size, offset, &mask) ||
+        mask >= (uint64_t{kCallsignBit} << 1)) {
+      return false;
+    }
+
+    payload_.assign(Report::SIZE, 0);
+    uint8_t *payload = payload_.data();
+    payload[0] = (track.key >> 28) ? gdl90::MSG_ID_TRAFFIC_REPORT
+                                   : gdl90::MSG_ID_OWNSHIP_REPORT;
+    Report::AddressType::put(payload, (track.key >> 24) & 0x0Fu);
+    Report::Address::put(payload, track.key & 0xFFFFFFu);
+    for (size_t i = 0; i < kFieldCount; ++i) {
+      const FieldSpec &field = kFields[i];
+      const uint64_t code =
+          (mask >> MaskShift(i)) & (i < kLinearFields ? 3u : 1u);
+      int64_t residual = code == 1 ? 1 : code == 2 ? -1 : 0;
+      if (code == (i < kLinearFields ? 3u : 1u) &&
+          !GetSigned(body, size, offset, &residual)) {
+        return false;
+      }
+      const uint32_t value =
+          (Predict(i, track.samples, track.last[i], track.before[i]) +
+           static_cast<uint32_t>(residual)) &
+          FieldMask(field.width);
+      PutBits(payload, field.offset, field.width, value);
+      track.before[i] = track.last[i];
+      track.last[i] = value;
+    }
+    if (mask & kCallsignBit) {
+      if (track.callsign.size() > size - *offset) {
+        return false;
+      }
+      std::memcpy(track.callsign.data(), body + *offset,
+                  track.callsign.size());
+      *offset += track.callsign.size();
+    }
+    std::memcpy(payload + Report::Callsign::BYTE, track.callsign.data(),
+                track.callsign.size());
+    ++track.samples;
+    AppendFrame(payload, Report::SIZE, &out->data);
+  }
+  return true;
+}
+
+CompactCaptureWriter::CompactCaptureWriter()
+    : queue_(COMPACT_CAPTURE_QUEUE_SLOTS) {}
+
+CompactCaptureWriter::~CompactCaptureWriter() { close(); }
+
+bool CompactCaptureWriter::open(const std::string &path,
+                                std::string *out_error) {
+  close();
+  file_.open(path, std::ios::binary | std::ios::trunc);
+  if (!file_) {
+    if (out_error) {
+      *out_error = "Cannot create capture file: " + path;
+    }
+    return false;
+  }
+  file_.write(kMagic, sizeof(kMagic));
+  const uint32_t version = COMPACT_CAPTURE_VERSION;
+  file_.write(reinterpret_cast<const char *>(&version), sizeof(version));
+  path_ = path;
+  block_open_ = false;
+  sequence_ = 0;
+  records_.store(0);
+  bytes_.store(0);
+  dropped_.store(0);
+  blocks_.store(0);
+  file_bytes_.store(kFileHeaderSize);
+  wall_base_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+  steady_base_ = std::chrono::steady_clock::now();
+
+  stop_requested_ = false;
+  try {
+    thread_ = std::thread(&CompactCaptureWriter::run, this);
+  } catch (const std::system_error &error) {
+    if (out_error) {
+      *out_error =
+          std::string("Capture writer thread failed to start: ") + error.what();
+    }
+    file_.close();
+    return false;
+  }
+  return true;
+}
+
+void CompactCaptureWriter::close() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+      stop_requested_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+  if (file_.is_open()) {
+    drain();
+    if (block_open_) {
+      writeBlock();
+    }
+    file_.close();
+  }
+}
+
+void CompactCaptureWriter::record(const uint8_t *data, size_t size,
+                                  uint32_t destination) {
+  const int64_t timestamp_ns =
+      wall_base_ns_ + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - steady_base_)
+                          .count();
+  recordAt(timestamp_ns, data, size, destination);
+}
+
+void CompactCaptureWriter::recordAt(int64_t timestamp_ns, const uint8_t *data,
+                                    size_t size, uint32_t destination) {
+  if (!file_.is_open() || !data || size == 0) {
+    return;
+  }
+  QueuedDatagram *slot =
+      size <= COMPACT_CAPTURE_MAX_DATAGRAM ? queue_.producerSlot() : nullptr;
+  if (!slot) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  slot->timestamp_ns = timestamp_ns;
+  slot->destination = static_cast<uint8_t>(destination);
+  slot->size = static_cast<uint16_t>(size);
+  std::memcpy(slot->data.data(), data, size);
+  queue_.publish();
+  records_.fetch_add(1, std::memory_order_relaxed);
+  bytes_.fetch_add(size, std::memory_order_relaxed);
+}
+
+void CompactCaptureWriter::run() {
+  std::unique_lock<std::mutex> lock(wake_mutex_);
+  while (!stop_requested_) {
+    wake_.wait_for(lock, kWriterInterval, [this] { return stop_requested_; });
+    drain();
+  }
+}
+
+void CompactCaptureWriter::drain() {
+  for (size_t ready = queue_.readable(); ready > 0; --ready) {
+    const QueuedDatagram &datagram = queue_.peek(0);
+    const double block_age_s =
+        static_cast<double>(datagram.timestamp_ns -
+                            current_.first_timestamp_ns) /
+        1e9;
+    if (block_open_ && (block_age_s >= COMPACT_CAPTURE_KEYFRAME_S ||
+                        block_age_s < 0.0 || block_.size() >= kMaxBlockBytes)) {
+      writeBlock();
+    }
+    if (!block_open_) {
+      current_ = CompactCaptureBlock{};
+      current_.first_timestamp_ns = datagram.timestamp_ns;
+      current_.first_sequence = sequence_ + 1;
+      encoder_.reset(datagram.timestamp_ns);
+      block_.clear();
+      block_open_ = true;
+    }
+    encoder_.encode(datagram.timestamp_ns, datagram.destination,
+                    datagram.data.data(), datagram.size, &block_);
+    ++current_.datagrams;
+    ++sequence_;
+    queue_.release(1);
+  }
+}
+
+void CompactCaptureWriter::writeBlock() {
+  uint8_t header[kBlockHeaderSize];
+  Put(header, kBlockMagic);
+  Put(header + 4, static_cast<uint32_t>(block_.size()));
+  Put(header + 8, current_.datagrams);
+  Put(header + 12, current_.first_sequence);
+  Put(header + 16, current_.first_timestamp_ns);
+  file_.write(reinterpret_cast<const char *>(header), sizeof(header));
+  file_.write(reinterpret_cast<const char *>(block_.data()),
+              static_cast<std::streamsize>(block_.size()));
+  file_.flush();
+  block_open_ = false;
+  blocks_.fetch_add(1, std::memory_order_relaxed);
+  file_bytes_.fetch_add(sizeof(header) + block_.size(),
+                        std::memory_order_relaxed);
+}
+
+StreamCaptureStats CompactCaptureWriter::stats() const {
+  StreamCaptureStats stats;
+  stats.records = records_.load(std::memory_order_relaxed);
+  stats.bytes = bytes_.load(std::memory_order_relaxed);
+  stats.flushes = blocks_.load(std::memory_order_relaxed);
+  stats.dropped = dropped_.load(std::memory_order_relaxed);
+  stats.file_bytes = file_bytes_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+bool CompactCaptureReader::open(const std::string &path,
+                                std::string *out_error) {
+  blocks_.clear();
+  next_block_ = 0;
+  remaining_ = 0;
+  has_pending_ = false;
+  file_.close();
+  file_.clear();
+  file_.open(path, std::ios::binary);
+  if (!file_) {
+    if (out_error) {
+      *out_error = "Cannot open capture file: " + path;
+    }
+    return false;
+  }
+  char magic[sizeof(kMagic)] = {};
+  uint32_t version = 0;
+  file_.read(magic, sizeof(magic));
+  file_.read(reinterpret_cast<char *>(&version), sizeof(version));
+  if (!file_ || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      version != COMPACT_CAPTURE_VERSION) {
+    if (out_error) {
+      *out_error = "Not an xp2gdl90 compact capture: " + path;
+    }
+    return false;
+  }
+
+  file_.seekg(0, std::ios::end);
+  const uint64_t file_size = static_cast<uint64_t>(file_.tellg());
+  uint64_t offset = kFileHeaderSize;
+  while (offset + kBlockHeaderSize <= file_size) {
+    uint8_t header[kBlockHeaderSize];
+    file_.seekg(static_cast<std::streamoff>(offset));
+    if (!file_.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+        Get<uint32_t>(header) != kBlockMagic) {
+      break;
+    }
+    CompactCaptureBlock block;
+    block.offset = offset;
+    block.size = Get<uint32_t>(header + 4);
+    block.datagrams = Get<uint32_t>(header + 8);
+    block.first_sequence = Get<uint32_t>(header + 12);
+    block.first_timestamp_ns = Get<int64_t>(header + 16);
+    if (block.size > file_size - offset - kBlockHeaderSize) {
+      break; // Cut short while the block was being written.
+    }
+    blocks_.push_back(block);
+    offset += kBlockHeaderSize + block.size;
+  }
+  file_.clear();
+  return true;
+}
+
+void CompactCaptureReader::seek(int64_t timestamp_ns) {
+  has_pending_ = false;
+  const auto after = std::upper_bound(
+      blocks_.begin(), blocks_.end(), timestamp_ns,
+      [](int64_t time, const CompactCaptureBlock &block) {
+        return time < block.first_timestamp_ns;
+      });
+  const size_t block = after == blocks_.begin()
+                           ? 0
+                           : static_cast<size_t>(after - blocks_.begin()) - 1;
+  next_block_ = block;
+  remaining_ = 0;
+  while (next(&pending_)) {
+    if (pending_.timestamp_ns >= timestamp_ns) {
+      has_pending_ = true;
+      return;
+    }
+  }
+}
+
+bool CompactCaptureReader::next(CaptureDatagram *out) {
+  if (has_pending_) {
+    has_pending_ = false;
+    *out = std::move(pending_);
+    return true;
+  }
+  while (remaining_ == 0) {
+    if (next_block_ >= blocks_.size() || !loadBlock(next_block_++)) {
+      return false;
+    }
+  }
+  if (!decoder_.decode(body_.data(), body_.size(), &body_offset_, out)) {
+    remaining_ = 0;
+    next_block_ = blocks_.size();
+    return false;
+  }
+  --remaining_;
+  out->sequence = next_sequence_++;
+  return true;
+}
+
+bool CompactCaptureReader::loadBlock(size_t block) {
+  const CompactCaptureBlock &info = blocks_[block];
+  body_.resize(info.size);
+  file_.clear();
+  file_.seekg(static_cast<std::streamoff>(info.offset + kBlockHeaderSize));
+  if (!file_.read(reinterpret_cast<char *>(body_.data()),
+                  static_cast<std::streamsize>(body_.size()))) {
+    return false;
+  }
+  body_offset_ = 0;
+  remaining_ = info.datagrams;
+  next_sequence_ = info.first_sequence;
+  decoder_.reset(info.first_timestamp_ns);
+  return true;
+}
+
+bool IsCompactCapture(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  char magic[sizeof(kMagic)] = {};
+  return file.read(magic, sizeof(magic)) &&
+         std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool ReadCompactCapture(const std::string &path,
+                        std::vector<CaptureDatagram> *out,
+                        std::string *out_error) {
+  if (!out) {
+    return false;
+  }
+  out->clear();
+  CompactCaptureReader reader;
+  if (!reader.open(path, out_error)) {
+    return false;
+  }
+  CaptureDatagram datagram;
+  while (reader.next(&datagram)) {
+    out->push_back(std::move(datagram));
+  }
+  return true;
+}
+
+} // namespace udp
@@ -0,0 +1,95 @@
+#include "xp2gdl90/crc16.h"
+
+namespace gdl90 {
+namespace {
+
+constexpr uint32_t kPolynomial = 0x11021;
+constexpr size_t kLanes = 4;
+
+using Crc16Tables = std::array<std::array<uint16_t, 256>, 8>;
+
+constexpr uint16_t MultiplyByX8(uint16_t value, size_t times) {
+  uint32_t reg = value;
+  for (size_t i = 0; i < times * 8; ++i) {
+    reg <<= 1;
+    if (reg & 0x10000) {
+      reg ^= kPolynomial;
+    }
+  }
+  return static_cast<uint16_t>(reg);
+}
+
+constexpr Crc16Tables BuildTables() {
+  Crc16Tables tables{};
+  for (size_t k = 0; k < tables.size(); ++k) {
+    for (size_t v = 0; v < 256; ++v) {
+      tables[k][v] = MultiplyByX8(static_cast<uint16_t>(v), k + 2);
+    }
+  }
+  return tables;
+}
+
+// Folds eight bytes: crc * x^64 plus each byte weighted by its position.
+inline uint16_t Crc16Block(uint16_t crc, const uint8_t *p) {
+  const auto &t = detail::kCrc16Tables;
+  return static_cast<uint16_t>(
+      t[7][crc >> 8] ^ t[6][crc & 0xFF] ^ t[5][p[0]] ^ t[4][p[1]] ^
+      t[3][p[2]] ^ t[2][p[3]] ^ t[1][p[4]] ^ t[0][p[5]] ^
+      static_cast<uint16_t>((p[6] << 8) | p[7]));
+}
+
+} // namespace
+
+namespace detail {
+
+constexpr Crc16Tables kCrc16Tables = BuildTables();
+
+} // namespace detail
+
+uint16_t Crc16(const uint8_t *data, size_t size, uint16_t crc) {
+  while (size >= 8) {
+    crc = Crc16Block(crc, data);
+    data += 8;
+    size -= 8;
+  }
+  while (size > 0) {
+    crc = Crc16Update(crc, *data++);
+    --size;
+  }
+  return crc;
+}
+
+void Crc16Batch(const uint8_t *const *buffers, const size_t *sizes,
+                size_t count, uint16_t *out_crcs) {
+  size_t index = 0;
+  for (; index + kLanes <= count; index += kLanes) {
+    const uint8_t *data[kLanes];
+    size_t remaining[kLanes];
+    uint16_t crc[kLanes] = {0, 0, 0, 0};
+    size_t common = sizes[index];
+    for (size_t lane = 0; lane < kLanes; ++lane) {
+      data[lane] = buffers[index + lane];
+      remaining[lane] = sizes[index + lane];
+      if (remaining[lane] < common) {
+        common = remaining[lane];
+      }
+    }
+
+    // Independent lanes keep several table lookups in flight per cycle.
+    for (size_t block = 0; block < common / 8; ++block) {
+      for (size_t lane = 0; lane < kLanes; ++lane) {
+        crc[lane] = Crc16Block(crc[lane], data[lane]);
+        data[lane] += 8;
+        remaining[lane] -= 8;
+      }
+    }
+    for (size_t lane = 0; lane < kLanes; ++lane) {
+      out_crcs[index + lane] = Crc16(data[lane], remaining[lane], crc[lane]);
+    }
+  }
+  for (; index < count; ++index) {
+    out_crcs[index] = Crc16(buffers[index], sizes[index]);
+  }
+}
+
+} // namespace gdl90
@@ -0,0 +1,68 @@
+#include "xp2gdl90/datagram_packer.h"
+
+#include <algorithm>
+
+namespace udp {
+
+DatagramPacker::DatagramPacker(size_t max_datagram_bytes) {
+  setMaxDatagramBytes(max_datagram_bytes);
+}
+
+void DatagramPacker::setMaxDatagramBytes(size_t max_datagram_bytes) {
+  max_datagram_bytes_ =
+      std::max(DATAGRAM_MIN_MAX_BYTES,
+               std::min(DATAGRAM_MAX_MAX_BYTES, max_datagram_bytes));
+  pending_.reserve(max_datagram_bytes_);
+}
+
+bool DatagramPacker::append(const uint8_t *frame, size_t size, bool leading,
+                            UDPBroadcaster &broadcaster,
+                            uint32_t destinations) {
+  bool ok = true;
+  if (!pending_.empty() &&
+      (leading || destinations != pending_destinations_ ||
+       pending_.size() + size > max_datagram_bytes_)) {
+    ok = flush(broadcaster) >= 0;
+  }
+  pending_destinations_ = destinations;
+
+  pending_.insert(pending_.end(), frame, frame + size);
+  ++pending_frames_;
+
+  // A frame larger than the limit on its own is sent unpacked.
+  if (pending_.size() >= max_datagram_bytes_) {
+    ok = flush(broadcaster) >= 0 && ok;
+  }
+  return ok;
+}
+
+int DatagramPacker::flush(UDPBroadcaster &broadcaster) {
+  if (pending_.empty()) {
+    return 0;
+  }
+
+  const size_t bytes = pending_.size();
+  const size_t frames = pending_frames_;
+  const int sent = broadcaster.send(pending_.data(), bytes, pending_destinations_);
+  pending_.clear();
+  pending_frames_ = 0;
+  if (sent < 0) {
+    ++stats_.send_errors;
+    return -1;
+  }
+
+  const double fill_ratio =
+      std::min(1.0, static_cast<double>(bytes) /
+                        static_cast<double>(max_datagram_bytes_));
+  stats_.min_fill_ratio = stats_.datagrams_sent == 0
+                              ? fill_ratio
+                              : std::min(stats_.min_fill_ratio, fill_ratio);
+  ++stats_.datagrams_sent;
+  stats_.frames_sent += frames;
+  stats_.bytes_sent += bytes;
+  stats_.last_fill_ratio = fill_ratio;
+  stats_.fill_ratio_sum += fill_ratio;
+  return sent;
+}
+
+} // namespace udp
@@ -0,0 +1,21 @@
+#include "xp2gdl90/dataref_cache.h"
+
+namespace xp2gdl90 {
+
+DataRefCache::Handle DataRefCache::find(const char *name) {
+  if (!name) {
+    return nullptr;
+  }
+  const auto it = refs_.find(name);
+  if (it != refs_.end()) {
+    return it->second;
+  }
+  ++lookups_;
+  Handle handle = finder_ ? finder_(name) : nullptr;
+  if (handle) {
+    refs_.emplace(name, handle);
+  }
+  return handle;
+}
+
+} // namespace xp2gdl90
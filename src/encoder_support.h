@@ -1,21 +1,48 @@
 #ifndef XP2GDL90_ENCODER_SUPPORT_H
 #define XP2GDL90_ENCODER_SUPPORT_H
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 #include <string>
-#include <vector>
+
+#include "xp2gdl90/frame_buffer.h"
 
 namespace gdl90::internal {
 
-std::vector<uint8_t> PrepareMessage(const std::vector<uint8_t>& payload);
-void AppendBigEndian16(std::vector<uint8_t>& buffer, uint16_t value);
-void AppendBigEndian32(std::vector<uint8_t>& buffer, uint32_t value);
-void AppendBigEndian64(std::vector<uint8_t>& buffer, uint64_t value);
-void AppendFixedText(std::vector<uint8_t>& buffer,
+// Stack-resident staging area for an unframed message payload.
+class PayloadBuffer {
+ public:
+  void push_back(uint8_t byte) {
+    if (size_ < bytes_.size()) {
+      bytes_[size_++] = byte;
+    }
+  }
+  // Appends `count` zero bytes and returns them for in-place packing, or
+  // nullptr when they do not fit.
+  uint8_t* grow(size_t count) {
+    if (count > bytes_.size() - size_) {
+      return nullptr;
+    }
+    uint8_t* start = bytes_.data() + size_;
+    size_ += count;
+    return start;
+  }
+  const uint8_t* data() const { return bytes_.data(); }
+  size_t size() const { return size_; }
+
+ private:
+  std::array<uint8_t, FRAME_PAYLOAD_CAPACITY> bytes_{};
+  size_t size_ = 0;
+};
+
+size_t PrepareMessage(const PayloadBuffer& payload, FrameBuffer& out);
+void AppendBigEndian16(PayloadBuffer& buffer, uint16_t value);
+void AppendBigEndian32(PayloadBuffer& buffer, uint32_t value);
+void AppendBigEndian64(PayloadBuffer& buffer, uint64_t value);
+void AppendFixedText(PayloadBuffer& buffer,
                      const std::string& value,
                      size_t width);
-void Pack24Bit(std::vector<uint8_t>& buffer, uint32_t value);
 
 }  // namespace gdl90::internal
 
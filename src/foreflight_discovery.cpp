@@ -0,0 +1,198 @@
+#include "xp2gdl90/foreflight_discovery.h"
+
+#include <algorithm>
+#include <chrono>
+#include <system_error>
+#include <utility>
+
+#include "xp2gdl90/foreflight_protocol.h"
+
+namespace xp2gdl90::foreflight {
+
+DiscoveryListener::DiscoveryListener(
+    std::unique_ptr<udp::UDPReceiver> receiver, int wait_timeout_ms)
+    : receiver_(std::move(receiver)),
+      listen_port_(receiver_ ? receiver_->getListenPort() : 0),
+      wait_timeout_ms_(wait_timeout_ms) {}
+
+DiscoveryListener::~DiscoveryListener() { stop(); }
+
+bool DiscoveryListener::start() {
+  if (thread_.joinable()) {
+    return true;
+  }
+
+  stop_requested_.store(false);
+  try {
+    thread_ = std::thread(&DiscoveryListener::run, this);
+  } catch (const std::system_error &error) {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    last_error_ =
+        std::string("Discovery thread failed to start: ") + error.what();
+    return false;
+  }
+  return true;
+}
+
+void DiscoveryListener::stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  stop_requested_.store(true);
+  thread_.join();
+}
+
+int DiscoveryListener::pollOnce(int timeout_ms) {
+  if (!receiver_) {
+    return -1;
+  }
+
+  const int ready = receiver_->waitReadable(timeout_ms);
+  int received = ready > 0 ? receiver_->drain(&batch_) : ready;
+  if (received < 0) {
+    error_count_.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    last_error_ = receiver_->getLastError();
+    return -1;
+  }
+
+  int discovered = 0;
+  while (received > 0) {
+    for (size_t i = 0; i < batch_.count(); ++i) {
+      uint16_t port = 0;
+      if (!ParseDiscoveryBroadcast(batch_.data(i), batch_.size(i), &port)) {
+        continue;
+      }
+      const uint64_t packed =
+          (static_cast<uint64_t>(batch_.source(i).ipv4) << 16) | port;
+      packed_target_.store(packed, std::memory_order_relaxed);
+      sequence_.fetch_add(1, std::memory_order_release);
+      if (uint64_t *slot = sightings_.producerSlot()) {
+        *slot = packed;
+        sightings_.publish();
+      }
+      ++discovered;
+    }
+    // A full batch means more datagrams may be queued behind it.
+    received = batch_.count() == batch_.maxDatagrams()
+                   ? receiver_->drain(&batch_)
+                   : 0;
+  }
+  return discovered;
+}
+
+size_t DiscoveryListener::takeSightings(udp::SourceAddress *out,
+                                        size_t capacity) {
+  const size_t count = std::min(sightings_.readable(), capacity);
+  for (size_t i = 0; i < count; ++i) {
+    const uint64_t packed = sightings_.peek(i);
+    out[i].ipv4 = static_cast<uint32_t>(packed >> 16);
+    out[i].port = static_cast<uint16_t>(packed & 0xFFFFu);
+  }
+  sightings_.release(count);
+  return count;
+}
+
+DiscoverySnapshot DiscoveryListener::snapshot() const {
+  DiscoverySnapshot snapshot;
+  snapshot.sequence = sequence_.load(std::memory_order_acquire);
+  const uint64_t packed = packed_target_.load(std::memory_order_relaxed);
+  snapshot.target.ipv4 = static_cast<uint32_t>(packed >> 16);
+  snapshot.target.port = static_cast<uint16_t>(packed & 0xFFFFu);
+  return snapshot;
+}
+
+std::string DiscoveryListener::lastError() const {
+  std::lock_guard<std::mutex> lock(error_mutex_);
+  return last_error_;
+}
+
+void DiscoveryListener::run() {
+  while (!stop_requested_.load()) {
+    if (pollOnce(wait_timeout_ms_) < 0) {
+      // Avoid spinning on a persistent socket error.
+      std::this_thread::sleep_for(
+          std::chrono::milliseconds(wait_timeout_ms_));
+    }
+  }
+}
+
+bool DeviceTable::see(const udp::SourceAddress &address, double now) {
+  for (size_t i = 0; i < size_; ++i) {
+    if (devices_[i].address == address) {
+      devices_[i].last_seen = now;
+      return false;
+    }
+  }
+
+  if (size_ == devices_.size()) {
+    size_t oldest = 0;
+    for (size_t i = 1; i < size_; ++i) {
+      if (devices_[i].last_seen < devices_[oldest].last_seen) {
+        oldest = i;
+      }
+    }
+    std::move(devices_.begin() + oldest + 1, devices_.begin() + size_,
+              devices_.begin() + oldest);
+    --size_;
+  }
+  devices_[size_].address = address;
+  devices_[size_].last_seen = now;
+  ++size_;
+  ++generation_;
+  return true;
+}
+
+size_t DeviceTable::expire(double now, double timeout) {
+  size_t kept = 0;
+  for (size_t i = 0; i < size_; ++i) {
+    // A sighting from the future (clock reset) counts as fresh.
+    if (now - devices_[i].last_seen <= timeout) {
+      devices_[kept++] = devices_[i];
+    }
+  }
+  const size_t dropped = size_ - kept;
+  if (dropped > 0) {
+    size_ = kept;
+    ++generation_;
+  }
+  return dropped;
+}
+
+void DeviceTable::clear() {
+  if (size_ > 0) {
+    size_ = 0;
+    ++generation_;
+  }
+}
+
+size_t ApplyDeviceDestinations(const DeviceTable &devices,
+                               udp::UDPBroadcaster &broadcaster,
+                               std::string *out_error) {
+  size_t index = broadcaster.firstDiscoveredDestination();
+  size_t device = 1;
+  for (; device < devices.size() && index < broadcaster.destinationCount();
+       ++device, ++index) {
+    if (broadcaster.destinationIp(index) !=
+            udp::FormatSourceIp(devices[device].address) ||
+        broadcaster.destinationPort(index) != devices[device].address.port) {
+      break;
+    }
+  }
+  broadcaster.truncateDestinations(index);
+
+  size_t refused = 0;
+  for (; device < devices.size(); ++device) {
+    if (!broadcaster.addDiscoveredDestination(
+            udp::FormatSourceIp(devices[device].address),
+            devices[device].address.port)) {
+      ++refused;
+      if (out_error) {
+        *out_error = broadcaster.getLastError();
+      }
+    }
+  }
+  return refused;
+}
+
+} // namespace xp2gdl90::foreflight
@@ -1,6 +1,7 @@
 #include "xp2gdl90/foreflight_encoder.h"
 
 #include "encoder_support.h"
+#include "xp2gdl90/cached_frame.h"
 
 #include <cmath>
 
@@ -44,9 +45,13 @@ uint16_t ForeFlightEncoder::encodeAhrsHeading(double degrees,
 
 std::vector<uint8_t>
 ForeFlightEncoder::createIdMessage(const DeviceInfo &data) const {
-  std::vector<uint8_t> payload;
-  payload.reserve(39);
+  FrameBuffer frame;
+  encodeIdMessageInto(data, frame);
+  return frame.toVector();
+}
 
+void ForeFlightEncoder::encodeIdPayload(
+    const DeviceInfo &data, internal::PayloadBuffer &payload) const {
   payload.push_back(MSG_ID_FORE_FLIGHT);
   payload.push_back(SUB_ID_DEVICE_INFO);
   payload.push_back(0x01);
@@ -54,14 +59,32 @@ ForeFlightEncoder::createIdMessage(const DeviceInfo &data) const {
   internal::AppendFixedText(payload, data.device_name, 8);
   internal::AppendFixedText(payload, data.device_long_name, 16);
   internal::AppendBigEndian32(payload, data.capabilities_mask);
+}
+
+size_t ForeFlightEncoder::encodeIdMessageInto(const DeviceInfo &data,
+                                              FrameBuffer &out) const {
+  internal::PayloadBuffer payload;
+  encodeIdPayload(data, payload);
+  return internal::PrepareMessage(payload, out);
+}
 
-  return internal::PrepareMessage(payload);
+size_t ForeFlightEncoder::encodeIdMessageInto(const DeviceInfo &data,
+                                              CachedFrame &cache) const {
+  internal::PayloadBuffer payload;
+  encodeIdPayload(data, payload);
+  return cache.update(payload.data(), payload.size());
 }
 
 std::vector<uint8_t>
 ForeFlightEncoder::createAhrsMessage(const AhrsData &data) const {
-  std::vector<uint8_t> payload;
-  payload.reserve(12);
+  FrameBuffer frame;
+  encodeAhrsMessageInto(data, frame);
+  return frame.toVector();
+}
+
+size_t ForeFlightEncoder::encodeAhrsMessageInto(const AhrsData &data,
+                                                FrameBuffer &out) const {
+  internal::PayloadBuffer payload;
 
   payload.push_back(MSG_ID_FORE_FLIGHT);
   payload.push_back(SUB_ID_AHRS);
@@ -74,7 +97,7 @@ ForeFlightEncoder::createAhrsMessage(const AhrsData &data) const {
   internal::AppendBigEndian16(payload, data.indicated_airspeed);
   internal::AppendBigEndian16(payload, data.true_airspeed);
 
-  return internal::PrepareMessage(payload);
+  return internal::PrepareMessage(payload, out);
 }
 
 } // namespace gdl90::foreflight
@@ -1,7 +1,7 @@
 #include "xp2gdl90/foreflight_protocol.h"
 
 #include <cmath>
-#include <string>
+#include <string_view>
 
 #include "xp2gdl90/simple_json.h"
 
@@ -9,19 +9,27 @@ namespace xp2gdl90::foreflight {
 
 bool ParseDiscoveryBroadcast(const std::vector<uint8_t> &packet,
                              uint16_t *out_port) {
-  if (!out_port || packet.empty()) {
+  return ParseDiscoveryBroadcast(packet.data(), packet.size(), out_port);
+}
+
+bool ParseDiscoveryBroadcast(const uint8_t *data, size_t size,
+                             uint16_t *out_port) {
+  if (!out_port || !data || size == 0) {
     return false;
   }
 
-  json::Value root;
-  if (!json::Parse(std::string(packet.begin(), packet.end()), &root, nullptr) ||
-      !root.IsObject()) {
+  json::Document document;
+  if (!json::Parse(
+          std::string_view(reinterpret_cast<const char *>(data), size),
+          &document, nullptr) ||
+      !document.root().IsObject()) {
     return false;
   }
+  const json::Value &root = document.root();
 
   const json::Value *app_value = root.Find("App");
   if (!app_value || !app_value->IsString() ||
-      app_value->string_value != "ForeFlight") {
+      app_value->AsString() != "ForeFlight") {
     return false;
   }
 
@@ -32,13 +40,13 @@ bool ParseDiscoveryBroadcast(const std::vector<uint8_t> &packet,
 
   const json::Value *port_value = gdl90_value->Find("port");
   if (!port_value || !port_value->IsNumber() ||
-      !std::isfinite(port_value->number_value) ||
-      port_value->number_value < 1.0 || port_value->number_value > 65535.0) {
+      !std::isfinite(port_value->AsNumber()) ||
+      port_value->AsNumber() < 1.0 || port_value->AsNumber() > 65535.0) {
     return false;
   }
 
   *out_port = static_cast<uint16_t>(
-      static_cast<unsigned int>(port_value->number_value));
+      static_cast<unsigned int>(port_value->AsNumber()));
   return true;
 }
 
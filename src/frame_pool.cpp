@@ -0,0 +1,120 @@
+#include "xp2gdl90/frame_pool.h"
+
+namespace gdl90 {
+
+namespace {
+
+// Ends the free list.
+constexpr uint32_t kNoBlock = 0xFFFFFFFFu;
+
+uint64_t PackHead(uint32_t index, uint32_t tag) {
+  return (static_cast<uint64_t>(tag) << 32) | index;
+}
+
+uint32_t HeadIndex(uint64_t head) { return static_cast<uint32_t>(head); }
+
+uint32_t HeadTag(uint64_t head) { return static_cast<uint32_t>(head >> 32); }
+
+} // namespace
+
+FrameRef::FrameRef(const FrameRef &other)
+    : pool_(other.pool_), block_(other.block_) {
+  if (block_) {
+    block_->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+FrameRef::FrameRef(FrameRef &&other) noexcept
+    : pool_(other.pool_), block_(other.block_) {
+  other.pool_ = nullptr;
+  other.block_ = nullptr;
+}
+
+FrameRef &FrameRef::operator=(const FrameRef &other) {
+  if (block_ != other.block_) {
+    FrameRef copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+FrameRef &FrameRef::operator=(FrameRef &&other) noexcept {
+  if (this != &other) {
+    reset();
+    pool_ = other.pool_;
+    block_ = other.block_;
+    other.pool_ = nullptr;
+    other.block_ = nullptr;
+  }
+  return *this;
+}
+
+void FrameRef::reset() {
+  if (!block_) {
+    return;
+  }
+  // The release pairs with the acquire below, so the last holder sees
+  // every write made through the other references.
+  if (block_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    pool_->release(block_);
+  }
+  pool_ = nullptr;
+  block_ = nullptr;
+}
+
+FramePool::FramePool(size_t blocks)
+    : blocks_(new FramePoolBlock[blocks > 0 ? blocks : 1]),
+      capacity_(blocks > 0 ? blocks : 1) {
+  for (size_t i = 0; i < capacity_; ++i) {
+    blocks_[i].index = static_cast<uint32_t>(i);
+    blocks_[i].next.store(
+        i + 1 < capacity_ ? static_cast<uint32_t>(i + 1) : kNoBlock,
+        std::memory_order_relaxed);
+  }
+  head_.store(PackHead(0, 0), std::memory_order_relaxed);
+  available_.store(capacity_, std::memory_order_relaxed);
+}
+
+FrameRef FramePool::acquire() {
+  uint64_t head = head_.load(std::memory_order_acquire);
+  for (;;) {
+    const uint32_t index = HeadIndex(head);
+    if (index == kNoBlock) {
+      exhausted_.fetch_add(1, std::memory_order_relaxed);
+      return FrameRef();
+    }
+    const uint32_t next = blocks_[index].next.load(std::memory_order_relaxed);
+    if (head_.compare_exchange_weak(head, PackHead(next, HeadTag(head) + 1),
+                                    std::memory_order_acquire,
+                                    std::memory_order_acquire)) {
+      break;
+    }
+  }
+  FramePoolBlock *block = &blocks_[HeadIndex(head)];
+  block->refs.store(1, std::memory_order_relaxed);
+  block->frame.clear();
+  available_.fetch_sub(1, std::memory_order_relaxed);
+  acquired_.fetch_add(1, std::memory_order_relaxed);
+  return FrameRef(this, block);
+}
+
+void FramePool::release(FramePoolBlock *block) {
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  do {
+    block->next.store(HeadIndex(head), std::memory_order_relaxed);
+  } while (!head_.compare_exchange_weak(
+      head, PackHead(block->index, HeadTag(head)), std::memory_order_release,
+      std::memory_order_relaxed));
+  available_.fetch_add(1, std::memory_order_relaxed);
+}
+
+FramePoolStats FramePool::stats() const {
+  FramePoolStats stats;
+  stats.capacity = capacity_;
+  stats.available = available();
+  stats.acquired = acquired_.load(std::memory_order_relaxed);
+  stats.exhausted = exhausted_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+} // namespace gdl90
@@ -0,0 +1,214 @@
+#include "xp2gdl90/gdl90_decoder.h"
+
+#include "xp2gdl90/crc16.h"
+#include "xp2gdl90/gdl90_framing.h"
+#include "xp2gdl90/gdl90_layout.h"
+
+#include <cstring>
+#include <limits>
+
+namespace gdl90 {
+namespace {
+
+constexpr size_t kCrcSize = 2;
+constexpr size_t kHeartbeatSize = 7;
+constexpr size_t kAhrsSize = 12;
+constexpr double kDegreesPerSemicircle = 180.0 / 0x800000;
+
+// Sign-extends the low `bits` of `value`.
+int32_t SignExtend(uint32_t value, unsigned bits) {
+  const uint32_t sign = uint32_t{1} << (bits - 1);
+  return static_cast<int32_t>(static_cast<int64_t>(value ^ sign) -
+                              static_cast<int64_t>(sign));
+}
+
+uint16_t ReadBigEndian16(const uint8_t *bytes) {
+  return static_cast<uint16_t>((bytes[0] << 8) | bytes[1]);
+}
+
+double DecodeAhrsAttitude(uint16_t value) {
+  const int16_t tenths = static_cast<int16_t>(value);
+  return tenths == foreflight::AHRS_ATTITUDE_INVALID
+             ? std::numeric_limits<double>::quiet_NaN()
+             : tenths / 10.0;
+}
+
+} // namespace
+
+void Decoder::reset(const uint8_t *data, size_t size) {
+  data_ = data;
+  size_ = data ? size : 0;
+  position_ = 0;
+}
+
+bool Decoder::unstuff(const uint8_t *bytes, size_t size, size_t *out_size) {
+  size_t used = 0;
+  size_t i = 0;
+  // Clean runs are copied in bulk, as FrameMessage() writes them.
+  while (i < size) {
+    const size_t run = FindEscapeByte(bytes + i, size - i);
+    if (run > scratch_.size() - used) {
+      return false;
+    }
+    std::memcpy(scratch_.data() + used, bytes + i, run);
+    used += run;
+    i += run;
+    if (i < size) {
+      if (i + 1 == size || used == scratch_.size()) {
+        return false;
+      }
+      scratch_[used++] = static_cast<uint8_t>(bytes[i + 1] ^ 0x20);
+      i += 2;
+    }
+  }
+  *out_size = used;
+  return true;
+}
+
+bool Decoder::next(FrameSpan *out) {
+  if (!out) {
+    return false;
+  }
+  while (position_ < size_) {
+    const void *open =
+        std::memchr(data_ + position_, FRAME_FLAG, size_ - position_);
+    if (!open) {
+      position_ = size_;
+      return false;
+    }
+    const size_t body =
+        static_cast<size_t>(static_cast<const uint8_t *>(open) - data_) + 1;
+    const void *close =
+        body < size_ ? std::memchr(data_ + body, FRAME_FLAG, size_ - body)
+                     : nullptr;
+    if (!close) {
+      position_ = body - 1;
+      return false;
+    }
+    const size_t end =
+        static_cast<size_t>(static_cast<const uint8_t *>(close) - data_);
+    // The closing flag may also open the next frame.
+    position_ = end;
+    if (end == body) {
+      continue;
+    }
+
+    const uint8_t *frame = data_ + body;
+    size_t frame_size = end - body;
+    if (FindEscapeByte(frame, frame_size) < frame_size) {
+      if (!unstuff(frame, frame_size, &frame_size)) {
+        ++malformed_;
+        continue;
+      }
+      frame = scratch_.data();
+    }
+    if (frame_size <= kCrcSize || frame_size > DECODER_MAX_FRAME) {
+      ++malformed_;
+      continue;
+    }
+
+    const size_t payload_size = frame_size - kCrcSize;
+    const uint16_t crc = static_cast<uint16_t>(
+        frame[payload_size] | (frame[payload_size + 1] << 8));
+    if (Crc16(frame, payload_size) != crc) {
+      ++crc_errors_;
+      continue;
+    }
+    ++frames_;
+    out->data = frame;
+    out->size = payload_size;
+    return true;
+  }
+  return false;
+}
+
+bool DecodeHeartbeat(const FrameSpan &frame, HeartbeatData *out) {
+  if (!out || frame.size < kHeartbeatSize ||
+      frame.messageId() != MSG_ID_HEARTBEAT) {
+    return false;
+  }
+  const uint8_t status1 = frame.data[1];
+  const uint8_t status2 = frame.data[2];
+  out->gps_valid = (status1 & 0x80) != 0;
+  out->utc_ok = (status2 & 0x01) != 0;
+  out->timestamp = (static_cast<uint32_t>(status2 & 0x80) << 9) |
+                   (static_cast<uint32_t>(frame.data[4]) << 8) |
+                   frame.data[3];
+  return true;
+}
+
+bool DecodePositionReport(const FrameSpan &frame, PositionData *out) {
+  layout::PositionReportFields fields;
+  if (!out || (frame.messageId() != MSG_ID_OWNSHIP_REPORT &&
+               frame.messageId() != MSG_ID_TRAFFIC_REPORT) ||
+      !layout::UnpackPositionReport(frame.data, frame.size, &fields)) {
+    return false;
+  }
+
+  PositionData data;
+  data.alert_status = fields.alert_status;
+  data.address_type = static_cast<AddressType>(fields.address_type);
+  data.icao_address = fields.address;
+  data.latitude = SignExtend(fields.latitude, 24) * kDegreesPerSemicircle;
+  data.longitude = SignExtend(fields.longitude, 24) * kDegreesPerSemicircle;
+  data.altitude = fields.altitude == ALTITUDE_INVALID
+                      ? std::numeric_limits<int32_t>::min()
+                      : static_cast<int32_t>(fields.altitude) * 25 - 1000;
+  data.airborne = (fields.misc & 0x08) != 0;
+  data.track_type = static_cast<TrackType>(fields.misc & 0x03);
+  data.nic = fields.nic;
+  data.nacp = fields.nacp;
+  data.h_velocity = fields.h_velocity;
+  data.v_velocity =
+      fields.v_velocity == VVELOCITY_INVALID
+          ? std::numeric_limits<int16_t>::min()
+          : static_cast<int16_t>(SignExtend(fields.v_velocity, 12) * 64);
+  // Rounded up so that encoding the result gives the same wire value.
+  data.track = static_cast<uint16_t>((fields.track * 360 + 255) / 256);
+  data.emitter_category =
+      static_cast<EmitterCategory>(fields.emitter_category);
+  data.callsign = Callsign::fromBytes(
+      reinterpret_cast<const char *>(fields.callsign.data()),
+      fields.callsign.size());
+  while (data.callsign.back() == ' ') {
+    data.callsign.pop_back();
+  }
+  data.emergency_code = fields.emergency_code;
+  *out = data;
+  return true;
+}
+
+bool DecodeGeoAltitude(const FrameSpan &frame, GeoAltitudeData *out) {
+  using L = layout::GeoAltitude;
+  if (!out || frame.size < L::SIZE ||
+      frame.messageId() != MSG_ID_OWNSHIP_GEO_ALTITUDE) {
+    return false;
+  }
+  out->altitude_feet = L::Altitude::getSigned(frame.data) * 5;
+  out->vertical_warning = L::VerticalWarning::get(frame.data) != 0;
+  out->vfom_meters = static_cast<uint16_t>(L::Vfom::get(frame.data));
+  return true;
+}
+
+bool DecodeAhrs(const FrameSpan &frame, foreflight::AhrsData *out) {
+  if (!out || frame.size < kAhrsSize ||
+      frame.messageId() != foreflight::MSG_ID_FORE_FLIGHT ||
+      frame.data[1] != foreflight::SUB_ID_AHRS) {
+    return false;
+  }
+  out->roll_deg = DecodeAhrsAttitude(ReadBigEndian16(frame.data + 2));
+  out->pitch_deg = DecodeAhrsAttitude(ReadBigEndian16(frame.data + 4));
+  const uint16_t heading = ReadBigEndian16(frame.data + 6);
+  if (heading == foreflight::AHRS_HEADING_INVALID) {
+    out->heading_deg = std::numeric_limits<double>::quiet_NaN();
+    out->magnetic_heading = false;
+  } else {
+    out->heading_deg = (heading & 0x7FFF) / 10.0;
+    out->magnetic_heading = (heading & 0x8000) != 0;
+  }
+  out->indicated_airspeed = ReadBigEndian16(frame.data + 8);
+  out->true_airspeed = ReadBigEndian16(frame.data + 10);
+  return true;
+}
+
+} // namespace gdl90
@@ -1,6 +1,11 @@
 #include "xp2gdl90/gdl90_encoder.h"
 
 #include "encoder_support.h"
+#include "xp2gdl90/cached_frame.h"
+#include "xp2gdl90/gdl90_field_kernels.h"
+#include "xp2gdl90/gdl90_framing.h"
+#include "xp2gdl90/gdl90_layout.h"
+#include "xp2gdl90/traffic_frame_cache.h"
 
 #include <algorithm>
 #include <cmath>
@@ -12,6 +17,26 @@
 #endif
 
 namespace gdl90 {
+namespace {
+
+// Targets converted per pass of the field kernels in encodeTrafficBatch.
+constexpr size_t kTrafficBatchChunk = 32;
+
+static_assert(TRAFFIC_PAYLOAD_SIZE == layout::PositionReport::SIZE,
+              "traffic payload size must match the report layout");
+
+uint8_t EncodeMisc(const PositionData &data) {
+  return static_cast<uint8_t>((static_cast<uint8_t>(data.airborne) << 3) |
+                              (static_cast<uint8_t>(data.track_type) & 0x03));
+}
+
+uint16_t EncodeHorizontalVelocity(uint16_t knots) {
+  return knots == VELOCITY_INVALID
+             ? VELOCITY_INVALID
+             : std::min(knots, static_cast<uint16_t>(0xFFE));
+}
+
+} // namespace
 
 GDL90Encoder::GDL90Encoder() = default;
 
@@ -28,69 +53,6 @@ GDL90Encoder::GDL90Encoder(UtcTimeProvider utc_time_provider)
 GDL90Encoder::GDL90Encoder(CheckedUtcTimeProvider utc_time_provider)
     : utc_time_provider_(std::move(utc_time_provider)) {}
 
-uint32_t GDL90Encoder::encodeLatitude(double latitude) const {
-  latitude = std::max(-90.0, std::min(90.0, latitude));
-
-  int32_t value = static_cast<int32_t>(latitude * (0x800000 / 180.0));
-  if (value < 0) {
-    value = (0x1000000 + value) & 0xFFFFFF;
-  }
-
-  return static_cast<uint32_t>(value);
-}
-
-uint32_t GDL90Encoder::encodeLongitude(double longitude) const {
-  longitude = std::max(-180.0, std::min(180.0, longitude));
-
-  int32_t value = static_cast<int32_t>(longitude * (0x800000 / 180.0));
-  if (value < 0) {
-    value = (0x1000000 + value) & 0xFFFFFF;
-  }
-
-  return static_cast<uint32_t>(value);
-}
-
-uint16_t GDL90Encoder::encodeAltitude(int32_t altitude) const {
-  if (altitude == std::numeric_limits<int32_t>::min()) {
-    return ALTITUDE_INVALID;
-  }
-
-  int64_t encoded = (static_cast<int64_t>(altitude) + 1000) / 25;
-
-  if (encoded < 0) {
-    encoded = 0;
-  }
-  if (encoded > 0xFFE) {
-    encoded = 0xFFE;
-  }
-
-  return static_cast<uint16_t>(encoded);
-}
-
-uint16_t GDL90Encoder::encodeVerticalVelocity(int16_t vv_fpm) const {
-  if (vv_fpm == INT16_MIN) {
-    return VVELOCITY_INVALID;
-  }
-
-  if (vv_fpm > 32576) {
-    return 0x1FE;
-  }
-  if (vv_fpm < -32576) {
-    return 0xE02;
-  }
-
-  int16_t value = static_cast<int16_t>(vv_fpm / 64);
-  if (value < 0) {
-    value = (0x1000 + value) & 0xFFF;
-  }
-
-  return static_cast<uint16_t>(value);
-}
-
-uint8_t GDL90Encoder::encodeTrack(uint16_t track) const {
-  return static_cast<uint8_t>((track % 360) * 256 / 360);
-}
-
 int16_t GDL90Encoder::encodeGeoAltitude(int32_t altitude_feet) const {
   int64_t value = std::llround(static_cast<double>(altitude_feet) / 5.0);
   if (value < std::numeric_limits<int16_t>::min()) {
@@ -102,20 +64,13 @@ int16_t GDL90Encoder::encodeGeoAltitude(int32_t altitude_feet) const {
   return static_cast<int16_t>(value);
 }
 
-uint16_t GDL90Encoder::encodeGeoVerticalMetrics(bool vertical_warning,
-                                                uint16_t vfom_meters) const {
-  uint16_t encoded_vfom = vfom_meters;
-  if (encoded_vfom != GEO_ALTITUDE_VFOM_INVALID &&
-      encoded_vfom != GEO_ALTITUDE_VFOM_EXCESSIVE &&
-      encoded_vfom >= GEO_ALTITUDE_VFOM_INVALID) {
-    encoded_vfom = GEO_ALTITUDE_VFOM_EXCESSIVE;
-  }
-
-  encoded_vfom &= 0x7FFFu;
-  if (vertical_warning) {
-    encoded_vfom |= 0x8000u;
+uint16_t GDL90Encoder::encodeGeoVfom(uint16_t vfom_meters) const {
+  if (vfom_meters != GEO_ALTITUDE_VFOM_INVALID &&
+      vfom_meters != GEO_ALTITUDE_VFOM_EXCESSIVE &&
+      vfom_meters >= GEO_ALTITUDE_VFOM_INVALID) {
+    return GEO_ALTITUDE_VFOM_EXCESSIVE;
   }
-  return encoded_vfom;
+  return vfom_meters;
 }
 
 bool GDL90Encoder::getUTCTime(uint32_t *out_time) const {
@@ -146,113 +101,326 @@ bool GDL90Encoder::getUTCTime(uint32_t *out_time) const {
 
 std::vector<uint8_t> GDL90Encoder::createHeartbeat(bool gps_valid,
                                                    bool utc_ok) const {
-  std::vector<uint8_t> payload;
-  payload.reserve(7);
-
-  payload.push_back(MSG_ID_HEARTBEAT);
+  FrameBuffer frame;
+  encodeHeartbeatInto(gps_valid, utc_ok, frame);
+  return frame.toVector();
+}
 
+// Status 1, status 2 and the little-endian timestamp: heartbeat bytes 1-4.
+void GDL90Encoder::encodeHeartbeatStatus(bool gps_valid, bool utc_ok,
+                                         const uint32_t *utc_time,
+                                         uint8_t *out) const {
   uint8_t status1 = 0x01;
   if (gps_valid) {
     status1 |= 0x80;
   }
-  payload.push_back(status1);
 
-  uint32_t timestamp = 0;
-  const bool have_utc_time = getUTCTime(&timestamp);
+  const uint32_t timestamp = utc_time ? *utc_time : 0;
   uint8_t status2 = 0x00;
-  if (utc_ok && have_utc_time) {
+  if (utc_ok && utc_time) {
     status2 |= 0x01;
   }
   if (timestamp & 0x10000) {
     status2 |= 0x80;
   }
-  payload.push_back(status2);
 
-  payload.push_back(static_cast<uint8_t>(timestamp & 0xFF));
-  payload.push_back(static_cast<uint8_t>((timestamp >> 8) & 0xFF));
+  out[0] = status1;
+  out[1] = status2;
+  out[2] = static_cast<uint8_t>(timestamp & 0xFF);
+  out[3] = static_cast<uint8_t>((timestamp >> 8) & 0xFF);
+}
+
+size_t GDL90Encoder::encodeHeartbeatInto(bool gps_valid, bool utc_ok,
+                                         FrameBuffer &out) const {
+  uint32_t utc_time = 0;
+  return encodeHeartbeatAt(gps_valid, utc_ok,
+                           getUTCTime(&utc_time) ? &utc_time : nullptr, out);
+}
+
+size_t GDL90Encoder::encodeHeartbeatAt(bool gps_valid, bool utc_ok,
+                                       const uint32_t *utc_time,
+                                       FrameBuffer &out) const {
+  internal::PayloadBuffer payload;
+
+  payload.push_back(MSG_ID_HEARTBEAT);
+
+  uint8_t status[4];
+  encodeHeartbeatStatus(gps_valid, utc_ok, utc_time, status);
+  for (const uint8_t byte : status) {
+    payload.push_back(byte);
+  }
 
   payload.push_back(0x00);
   payload.push_back(0x00);
 
-  return internal::PrepareMessage(payload);
+  return internal::PrepareMessage(payload, out);
 }
 
-std::vector<uint8_t>
-GDL90Encoder::createPositionReport(uint8_t msg_id,
-                                   const PositionData &data) const {
-  std::vector<uint8_t> payload;
-  payload.reserve(28);
-
-  payload.push_back(msg_id);
-
-  const uint8_t st =
-      static_cast<uint8_t>(((data.alert_status & 0x0F) << 4) |
-                           (static_cast<uint8_t>(data.address_type) & 0x0F));
-  payload.push_back(st);
-
-  internal::Pack24Bit(payload, data.icao_address);
-  internal::Pack24Bit(payload, encodeLatitude(data.latitude));
-  internal::Pack24Bit(payload, encodeLongitude(data.longitude));
-
-  const uint16_t altitude = encodeAltitude(data.altitude);
-  const uint8_t misc = static_cast<uint8_t>(
-      (static_cast<uint8_t>(data.airborne) << 3) | (0 << 2) |
-      (static_cast<uint8_t>(data.track_type) & 0x03));
-
-  payload.push_back(static_cast<uint8_t>((altitude >> 4) & 0xFF));
-  payload.push_back(static_cast<uint8_t>(((altitude & 0x0F) << 4) | misc));
-
-  payload.push_back(
-      static_cast<uint8_t>(((data.nic & 0x0F) << 4) | (data.nacp & 0x0F)));
-
-  const uint16_t h_vel =
-      (data.h_velocity == VELOCITY_INVALID)
-          ? VELOCITY_INVALID
-          : std::min(data.h_velocity, static_cast<uint16_t>(0xFFE));
-  const uint16_t v_vel = encodeVerticalVelocity(data.v_velocity);
-
-  payload.push_back(static_cast<uint8_t>((h_vel >> 4) & 0xFF));
-  payload.push_back(
-      static_cast<uint8_t>(((h_vel & 0x0F) << 4) | ((v_vel >> 8) & 0x0F)));
-  payload.push_back(static_cast<uint8_t>(v_vel & 0xFF));
-
-  payload.push_back(encodeTrack(data.track));
-  payload.push_back(static_cast<uint8_t>(data.emitter_category));
-
-  std::string callsign = data.callsign.substr(0, 8);
-  callsign.resize(8, ' ');
-  for (const char ch : callsign) {
-    payload.push_back(static_cast<uint8_t>(ch));
+size_t GDL90Encoder::encodeHeartbeatInto(bool gps_valid, bool utc_ok,
+                                         CachedFrame &cache) const {
+  uint32_t utc_time = 0;
+  return encodeHeartbeatAt(gps_valid, utc_ok,
+                           getUTCTime(&utc_time) ? &utc_time : nullptr, cache);
+}
+
+size_t GDL90Encoder::encodeHeartbeatAt(bool gps_valid, bool utc_ok,
+                                       const uint32_t *utc_time,
+                                       CachedFrame &cache) const {
+  uint8_t status[4];
+  encodeHeartbeatStatus(gps_valid, utc_ok, utc_time, status);
+  if (cache.valid()) {
+    return cache.patch(1, status, sizeof(status));
+  }
+
+  const uint8_t payload[] = {MSG_ID_HEARTBEAT, status[0], status[1],
+                             status[2],        status[3], 0x00,
+                             0x00};
+  return cache.update(payload, sizeof(payload));
+}
+
+void GDL90Encoder::fillPositionFields(
+    uint8_t msg_id, const PositionData &data,
+    layout::PositionReportFields &fields) const {
+  fields.message_id = msg_id;
+  fields.alert_status = data.alert_status;
+  fields.address_type = static_cast<uint8_t>(data.address_type);
+  fields.address = data.icao_address;
+  fields.misc = EncodeMisc(data);
+  fields.nic = data.nic;
+  fields.nacp = data.nacp;
+  fields.h_velocity = EncodeHorizontalVelocity(data.h_velocity);
+  fields.emitter_category = static_cast<uint8_t>(data.emitter_category);
+  for (size_t i = 0; i < fields.callsign.size(); ++i) {
+    fields.callsign[i] = i < data.callsign.size()
+                             ? static_cast<uint8_t>(data.callsign[i])
+                             : static_cast<uint8_t>(' ');
+  }
+  fields.emergency_code = data.emergency_code;
+}
+
+void GDL90Encoder::encodePositionPayload(
+    uint8_t msg_id, const PositionData &data,
+    internal::PayloadBuffer &payload) const {
+  uint8_t *out = payload.grow(layout::PositionReport::SIZE);
+  if (!out) {
+    return;
   }
 
-  payload.push_back(static_cast<uint8_t>((data.emergency_code & 0x0F) << 4));
+  layout::PositionReportFields fields;
+  fillPositionFields(msg_id, data, fields);
+  fields.latitude = EncodeLatitude(data.latitude);
+  fields.longitude = EncodeLongitude(data.longitude);
+  fields.altitude = EncodeAltitude(data.altitude);
+  fields.v_velocity = EncodeVerticalVelocity(data.v_velocity);
+  fields.track = EncodeTrack(data.track);
+  layout::PackPositionReport(fields, out);
+}
 
-  return internal::PrepareMessage(payload);
+size_t GDL90Encoder::encodePositionReportInto(uint8_t msg_id,
+                                              const PositionData &data,
+                                              FrameBuffer &out) const {
+  internal::PayloadBuffer payload;
+  encodePositionPayload(msg_id, data, payload);
+  return internal::PrepareMessage(payload, out);
 }
 
 std::vector<uint8_t>
 GDL90Encoder::createOwnshipReport(const PositionData &data) const {
-  return createPositionReport(MSG_ID_OWNSHIP_REPORT, data);
+  FrameBuffer frame;
+  encodeOwnshipReportInto(data, frame);
+  return frame.toVector();
+}
+
+size_t GDL90Encoder::encodeOwnshipReportInto(const PositionData &data,
+                                             FrameBuffer &out) const {
+  return encodePositionReportInto(MSG_ID_OWNSHIP_REPORT, data, out);
+}
+
+size_t GDL90Encoder::encodeOwnshipReportInto(const PositionData &data,
+                                             CachedFrame &cache) const {
+  if (!cache.valid()) {
+    internal::PayloadBuffer payload;
+    encodePositionPayload(MSG_ID_OWNSHIP_REPORT, data, payload);
+    return cache.update(payload.data(), payload.size());
+  }
+
+  using L = layout::PositionReport;
+  uint8_t out[L::SIZE] = {};
+  L::Latitude::put(out, EncodeLatitude(data.latitude));
+  L::Longitude::put(out, EncodeLongitude(data.longitude));
+  L::Altitude::put(out, EncodeAltitude(data.altitude));
+  L::Misc::put(out, EncodeMisc(data));
+  L::Nic::put(out, data.nic);
+  L::Nacp::put(out, data.nacp);
+  L::HorizontalVelocity::put(out, EncodeHorizontalVelocity(data.h_velocity));
+  L::VerticalVelocity::put(out, EncodeVerticalVelocity(data.v_velocity));
+  L::Track::put(out, EncodeTrack(data.track));
+  return cache.patch(L::Motion::BYTE, out + L::Motion::BYTE,
+                     L::Motion::COUNT);
 }
 
 std::vector<uint8_t> GDL90Encoder::createOwnshipGeometricAltitude(
     const GeoAltitudeData &data) const {
-  std::vector<uint8_t> payload;
-  payload.reserve(5);
+  FrameBuffer frame;
+  encodeOwnshipGeometricAltitudeInto(data, frame);
+  return frame.toVector();
+}
 
-  payload.push_back(MSG_ID_OWNSHIP_GEO_ALTITUDE);
-  internal::AppendBigEndian16(
-      payload, static_cast<uint16_t>(encodeGeoAltitude(data.altitude_feet)));
-  internal::AppendBigEndian16(
-      payload,
-      encodeGeoVerticalMetrics(data.vertical_warning, data.vfom_meters));
+void GDL90Encoder::encodeGeoAltitudePayload(
+    const GeoAltitudeData &data, internal::PayloadBuffer &payload) const {
+  uint8_t *out = payload.grow(layout::GeoAltitude::SIZE);
+  if (!out) {
+    return;
+  }
+  layout::GeoAltitude::MessageId::put(out, MSG_ID_OWNSHIP_GEO_ALTITUDE);
+  layout::GeoAltitude::Altitude::put(
+      out, static_cast<uint16_t>(encodeGeoAltitude(data.altitude_feet)));
+  layout::GeoAltitude::VerticalWarning::put(out, data.vertical_warning);
+  layout::GeoAltitude::Vfom::put(out, encodeGeoVfom(data.vfom_meters));
+}
+
+size_t
+GDL90Encoder::encodeOwnshipGeometricAltitudeInto(const GeoAltitudeData &data,
+                                                 FrameBuffer &out) const {
+  internal::PayloadBuffer payload;
+  encodeGeoAltitudePayload(data, payload);
+  return internal::PrepareMessage(payload, out);
+}
 
-  return internal::PrepareMessage(payload);
+size_t
+GDL90Encoder::encodeOwnshipGeometricAltitudeInto(const GeoAltitudeData &data,
+                                                 CachedFrame &cache) const {
+  internal::PayloadBuffer payload;
+  encodeGeoAltitudePayload(data, payload);
+  return cache.update(payload.data(), payload.size());
 }
 
 std::vector<uint8_t>
 GDL90Encoder::createTrafficReport(const PositionData &data) const {
-  return createPositionReport(MSG_ID_TRAFFIC_REPORT, data);
+  FrameBuffer frame;
+  encodeTrafficReportInto(data, frame);
+  return frame.toVector();
+}
+
+size_t GDL90Encoder::encodeTrafficReportInto(const PositionData &data,
+                                             FrameBuffer &out) const {
+  return encodePositionReportInto(MSG_ID_TRAFFIC_REPORT, data, out);
+}
+
+size_t GDL90Encoder::encodeTrafficBatch(const PositionData *reports,
+                                        size_t count,
+                                        FrameArena &arena) const {
+  return encodeTrafficBatch(reports, count, arena, nullptr);
+}
+
+size_t GDL90Encoder::encodeTrafficBatch(const PositionData *reports,
+                                        size_t count, FrameArena &arena,
+                                        TrafficFrameCache *cache) const {
+  arena.clear();
+  if (!reports) {
+    return 0;
+  }
+
+  arena.reserve(count);
+  if (cache) {
+    cache->beginBatch();
+  }
+  uint8_t payloads[kTrafficBatchChunk * TRAFFIC_PAYLOAD_SIZE];
+  for (size_t base = 0; base < count; base += kTrafficBatchChunk) {
+    const size_t chunk = std::min(kTrafficBatchChunk, count - base);
+    packTrafficChunk(reports + base, chunk, payloads);
+    for (size_t i = 0; i < chunk; ++i) {
+      const uint8_t *payload = payloads + i * TRAFFIC_PAYLOAD_SIZE;
+      uint8_t *out = arena.beginFrame();
+      arena.commitFrame(
+          cache ? cache->frame(reports[base + i].icao_address, payload,
+                               TRAFFIC_PAYLOAD_SIZE, out)
+                : FrameMessage(payload, TRAFFIC_PAYLOAD_SIZE, out));
+    }
+  }
+  if (cache) {
+    cache->endBatch();
+  }
+  return arena.frameCount();
+}
+
+void GDL90Encoder::packTrafficPayloads(const PositionData *reports,
+                                       size_t count, uint8_t *out) const {
+  if (!reports || !out) {
+    return;
+  }
+  for (size_t base = 0; base < count; base += kTrafficBatchChunk) {
+    packTrafficChunk(reports + base, std::min(kTrafficBatchChunk, count - base),
+                     out + base * TRAFFIC_PAYLOAD_SIZE);
+  }
+}
+
+size_t GDL90Encoder::frameTrafficPayloads(const PositionData *reports,
+                                          const uint8_t *payloads,
+                                          size_t count, FrameArena &arena,
+                                          TrafficFrameCache *cache) const {
+  arena.clear();
+  if (!reports || !payloads) {
+    return 0;
+  }
+
+  arena.reserve(count);
+  if (cache) {
+    cache->beginBatch();
+  }
+  for (size_t i = 0; i < count; ++i) {
+    const uint8_t *payload = payloads + i * TRAFFIC_PAYLOAD_SIZE;
+    uint8_t *out = arena.beginFrame();
+    arena.commitFrame(cache ? cache->frame(reports[i].icao_address, payload,
+                                           TRAFFIC_PAYLOAD_SIZE, out)
+                            : FrameMessage(payload, TRAFFIC_PAYLOAD_SIZE, out));
+  }
+  if (cache) {
+    cache->endBatch();
+  }
+  return arena.frameCount();
+}
+
+void GDL90Encoder::packTrafficChunk(const PositionData *reports, size_t count,
+                                    uint8_t *out) const {
+  // The fixed-point fields are converted a chunk of targets at a time by
+  // the column kernels; the rest are copied per report. The inputs are
+  // zeroed only to keep -Wmaybe-uninitialized quiet across the calls.
+  double latitudes[kTrafficBatchChunk] = {};
+  double longitudes[kTrafficBatchChunk] = {};
+  int32_t altitudes[kTrafficBatchChunk] = {};
+  int16_t v_velocities[kTrafficBatchChunk] = {};
+  uint16_t tracks[kTrafficBatchChunk] = {};
+  uint32_t wire_latitudes[kTrafficBatchChunk];
+  uint32_t wire_longitudes[kTrafficBatchChunk];
+  uint16_t wire_altitudes[kTrafficBatchChunk];
+  uint16_t wire_v_velocities[kTrafficBatchChunk];
+  uint8_t wire_tracks[kTrafficBatchChunk];
+  for (size_t i = 0; i < count; ++i) {
+    const PositionData &report = reports[i];
+    latitudes[i] = report.latitude;
+    longitudes[i] = report.longitude;
+    altitudes[i] = report.altitude;
+    v_velocities[i] = report.v_velocity;
+    tracks[i] = report.track;
+  }
+  EncodeLatitudes(latitudes, count, wire_latitudes);
+  EncodeLongitudes(longitudes, count, wire_longitudes);
+  EncodeAltitudes(altitudes, count, wire_altitudes);
+  EncodeVerticalVelocities(v_velocities, count, wire_v_velocities);
+  EncodeTracks(tracks, count, wire_tracks);
+
+  std::fill(out, out + count * TRAFFIC_PAYLOAD_SIZE, uint8_t{0});
+  for (size_t i = 0; i < count; ++i) {
+    layout::PositionReportFields fields;
+    fillPositionFields(MSG_ID_TRAFFIC_REPORT, reports[i], fields);
+    fields.latitude = wire_latitudes[i];
+    fields.longitude = wire_longitudes[i];
+    fields.altitude = wire_altitudes[i];
+    fields.v_velocity = wire_v_velocities[i];
+    fields.track = wire_tracks[i];
+    layout::PackPositionReport(fields, out + i * TRAFFIC_PAYLOAD_SIZE);
+  }
 }
 
 } // namespace gdl90
@@ -0,0 +1,331 @@
+#include "xp2gdl90/gdl90_field_kernels.h"
+
+#include "xp2gdl90/gdl90_encoder.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XP2GDL90_FIELDS_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define XP2GDL90_FIELDS_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace gdl90 {
+namespace {
+
+constexpr double kSemicircleScale = 0x800000 / 180.0;
+constexpr uint32_t kSemicircleMask = 0xFFFFFF;
+constexpr uint16_t kAltitudeMax = 0xFFE;
+constexpr int16_t kVerticalVelocityLimit = 32576;
+constexpr uint16_t kVerticalVelocityMax = 0x1FE;
+constexpr uint16_t kVerticalVelocityMin = 0xE02;
+// x / 360 == (x * kDiv360Magic) >> 24 and x / 45 == (x * kDiv360Magic) >>
+// 21 for every 16-bit x, so both divisions become a high multiply.
+constexpr uint16_t kDiv360Magic = 46604;
+
+uint32_t EncodeSemicircles(double degrees, double limit) {
+  degrees = std::max(-limit, std::min(limit, degrees));
+
+  int32_t value = static_cast<int32_t>(degrees * kSemicircleScale);
+  if (value < 0) {
+    value = (0x1000000 + value) & kSemicircleMask;
+  }
+
+  return static_cast<uint32_t>(value);
+}
+
+void EncodeSemicirclesScalar(const double *in, size_t count, double limit,
+                             uint32_t *out) {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = EncodeSemicircles(in[i], limit);
+  }
+}
+
+#if defined(XP2GDL90_FIELDS_SSE2)
+inline __m128i Select(__m128i mask, __m128i when_set, __m128i otherwise) {
+  return _mm_or_si128(_mm_and_si128(mask, when_set),
+                      _mm_andnot_si128(mask, otherwise));
+}
+#elif defined(XP2GDL90_FIELDS_NEON)
+// (v * magic) >> shift per lane, for shifts of 16 or more.
+inline uint16x8_t MulShift(uint16x8_t v, uint16_t magic, int shift) {
+  const uint16x4_t m = vdup_n_u16(magic);
+  const int32x4_t s = vdupq_n_s32(-shift);
+  const uint32x4_t lo = vshlq_u32(vmull_u16(vget_low_u16(v), m), s);
+  const uint32x4_t hi = vshlq_u32(vmull_u16(vget_high_u16(v), m), s);
+  return vcombine_u16(vmovn_u32(lo), vmovn_u32(hi));
+}
+#endif
+
+void EncodeSemicirclesBatch(const double *in, size_t count, double limit,
+                            uint32_t *out) {
+  size_t i = 0;
+#if defined(XP2GDL90_FIELDS_SSE2)
+  const __m128d hi = _mm_set1_pd(limit);
+  const __m128d lo = _mm_set1_pd(-limit);
+  const __m128d scale = _mm_set1_pd(kSemicircleScale);
+  const __m128i mask = _mm_set1_epi32(static_cast<int>(kSemicircleMask));
+  for (; i + 4 <= count; i += 4) {
+    // Same operand order as std::min/std::max, so NaN clamps to +limit.
+    const __m128d a = _mm_max_pd(_mm_min_pd(_mm_loadu_pd(in + i), hi), lo);
+    const __m128d b =
+        _mm_max_pd(_mm_min_pd(_mm_loadu_pd(in + i + 2), hi), lo);
+    const __m128i values =
+        _mm_unpacklo_epi64(_mm_cvttpd_epi32(_mm_mul_pd(a, scale)),
+                           _mm_cvttpd_epi32(_mm_mul_pd(b, scale)));
+    // Masking a two's complement int32 to 24 bits matches the scalar wrap.
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                     _mm_and_si128(values, mask));
+  }
+#elif defined(XP2GDL90_FIELDS_NEON)
+  const float64x2_t hi = vdupq_n_f64(limit);
+  const float64x2_t lo = vdupq_n_f64(-limit);
+  const float64x2_t scale = vdupq_n_f64(kSemicircleScale);
+  const uint32x4_t mask = vdupq_n_u32(kSemicircleMask);
+  for (; i + 4 <= count; i += 4) {
+    // Selects rather than vminq/vmaxq, which would propagate NaN.
+    float64x2_t a = vld1q_f64(in + i);
+    float64x2_t b = vld1q_f64(in + i + 2);
+    a = vbslq_f64(vcltq_f64(a, hi), a, hi);
+    b = vbslq_f64(vcltq_f64(b, hi), b, hi);
+    a = vbslq_f64(vcgtq_f64(a, lo), a, lo);
+    b = vbslq_f64(vcgtq_f64(b, lo), b, lo);
+    const int32x4_t values =
+        vcombine_s32(vmovn_s64(vcvtq_s64_f64(vmulq_f64(a, scale))),
+                     vmovn_s64(vcvtq_s64_f64(vmulq_f64(b, scale))));
+    vst1q_u32(out + i, vandq_u32(vreinterpretq_u32_s32(values), mask));
+  }
+#endif
+  EncodeSemicirclesScalar(in + i, count - i, limit, out + i);
+}
+
+} // namespace
+
+uint32_t EncodeLatitude(double degrees) {
+  return EncodeSemicircles(degrees, 90.0);
+}
+
+uint32_t EncodeLongitude(double degrees) {
+  return EncodeSemicircles(degrees, 180.0);
+}
+
+uint16_t EncodeAltitude(int32_t feet) {
+  if (feet == std::numeric_limits<int32_t>::min()) {
+    return ALTITUDE_INVALID;
+  }
+
+  int64_t encoded = (static_cast<int64_t>(feet) + 1000) / 25;
+
+  if (encoded < 0) {
+    encoded = 0;
+  }
+  if (encoded > kAltitudeMax) {
+    encoded = kAltitudeMax;
+  }
+
+  return static_cast<uint16_t>(encoded);
+}
+
+uint16_t EncodeVerticalVelocity(int16_t fpm) {
+  if (fpm == std::numeric_limits<int16_t>::min()) {
+    return VVELOCITY_INVALID;
+  }
+
+  if (fpm > kVerticalVelocityLimit) {
+    return kVerticalVelocityMax;
+  }
+  if (fpm < -kVerticalVelocityLimit) {
+    return kVerticalVelocityMin;
+  }
+
+  int16_t value = static_cast<int16_t>(fpm / 64);
+  if (value < 0) {
+    value = (0x1000 + value) & 0xFFF;
+  }
+
+  return static_cast<uint16_t>(value);
+}
+
+uint8_t EncodeTrack(uint16_t degrees) {
+  return static_cast<uint8_t>((degrees % 360) * 256 / 360);
+}
+
+void EncodeLatitudesScalar(const double *in, size_t count, uint32_t *out) {
+  EncodeSemicirclesScalar(in, count, 90.0, out);
+}
+
+void EncodeLongitudesScalar(const double *in, size_t count, uint32_t *out) {
+  EncodeSemicirclesScalar(in, count, 180.0, out);
+}
+
+void EncodeAltitudesScalar(const int32_t *in, size_t count, uint16_t *out) {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = EncodeAltitude(in[i]);
+  }
+}
+
+void EncodeVerticalVelocitiesScalar(const int16_t *in, size_t count,
+                                    uint16_t *out) {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = EncodeVerticalVelocity(in[i]);
+  }
+}
+
+void EncodeTracksScalar(const uint16_t *in, size_t count, uint8_t *out) {
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = EncodeTrack(in[i]);
+  }
+}
+
+void EncodeLatitudes(const double *in, size_t count, uint32_t *out) {
+  EncodeSemicirclesBatch(in, count, 90.0, out);
+}
+
+void EncodeLongitudes(const double *in, size_t count, uint32_t *out) {
+  EncodeSemicirclesBatch(in, count, 180.0, out);
+}
+
+void EncodeAltitudes(const int32_t *in, size_t count, uint16_t *out) {
+  size_t i = 0;
+  // The quotient is formed in double: (n + 1000) / 25 is never within
+  // rounding error of the next integer, so truncating it matches the
+  // integer division.
+#if defined(XP2GDL90_FIELDS_SSE2)
+  const __m128d offset = _mm_set1_pd(1000.0);
+  const __m128d step = _mm_set1_pd(25.0);
+  const __m128d lowest = _mm_setzero_pd();
+  const __m128d highest = _mm_set1_pd(kAltitudeMax);
+  const __m128i invalid_value = _mm_set1_epi32(ALTITUDE_INVALID);
+  const __m128i invalid_input =
+      _mm_set1_epi32(std::numeric_limits<int32_t>::min());
+  for (; i + 4 <= count; i += 4) {
+    const __m128i feet =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+    __m128d a = _mm_cvtepi32_pd(feet);
+    __m128d b = _mm_cvtepi32_pd(_mm_srli_si128(feet, 8));
+    a = _mm_div_pd(_mm_add_pd(a, offset), step);
+    b = _mm_div_pd(_mm_add_pd(b, offset), step);
+    a = _mm_min_pd(_mm_max_pd(a, lowest), highest);
+    b = _mm_min_pd(_mm_max_pd(b, lowest), highest);
+    __m128i values =
+        _mm_unpacklo_epi64(_mm_cvttpd_epi32(a), _mm_cvttpd_epi32(b));
+    values = Select(_mm_cmpeq_epi32(feet, invalid_input), invalid_value,
+                    values);
+    // Values are at most 0xFFF, so signed saturation leaves them intact.
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i),
+                     _mm_packs_epi32(values, values));
+  }
+#elif defined(XP2GDL90_FIELDS_NEON)
+  const float64x2_t offset = vdupq_n_f64(1000.0);
+  const float64x2_t step = vdupq_n_f64(25.0);
+  const float64x2_t lowest = vdupq_n_f64(0.0);
+  const float64x2_t highest = vdupq_n_f64(kAltitudeMax);
+  const int32x4_t invalid_value = vdupq_n_s32(ALTITUDE_INVALID);
+  const int32x4_t invalid_input =
+      vdupq_n_s32(std::numeric_limits<int32_t>::min());
+  for (; i + 4 <= count; i += 4) {
+    const int32x4_t feet = vld1q_s32(in + i);
+    float64x2_t a = vcvtq_f64_s64(vmovl_s32(vget_low_s32(feet)));
+    float64x2_t b = vcvtq_f64_s64(vmovl_s32(vget_high_s32(feet)));
+    a = vdivq_f64(vaddq_f64(a, offset), step);
+    b = vdivq_f64(vaddq_f64(b, offset), step);
+    a = vminq_f64(vmaxq_f64(a, lowest), highest);
+    b = vminq_f64(vmaxq_f64(b, lowest), highest);
+    int32x4_t values = vcombine_s32(vmovn_s64(vcvtq_s64_f64(a)),
+                                    vmovn_s64(vcvtq_s64_f64(b)));
+    values = vbslq_s32(vceqq_s32(feet, invalid_input), invalid_value, values);
+    vst1_u16(out + i, vmovn_u32(vreinterpretq_u32_s32(values)));
+  }
+#endif
+  EncodeAltitudesScalar(in + i, count - i, out + i);
+}
+
+void EncodeVerticalVelocities(const int16_t *in, size_t count,
+                              uint16_t *out) {
+  size_t i = 0;
+  // Negative values are biased by 63 before the shift so that it rounds
+  // toward zero like the division.
+#if defined(XP2GDL90_FIELDS_SSE2)
+  const __m128i bias_mask = _mm_set1_epi16(63);
+  const __m128i wire_mask = _mm_set1_epi16(0xFFF);
+  const __m128i limit = _mm_set1_epi16(kVerticalVelocityLimit);
+  const __m128i neg_limit = _mm_set1_epi16(-kVerticalVelocityLimit);
+  const __m128i max_value = _mm_set1_epi16(kVerticalVelocityMax);
+  const __m128i min_value =
+      _mm_set1_epi16(static_cast<int16_t>(kVerticalVelocityMin));
+  const __m128i invalid_input =
+      _mm_set1_epi16(std::numeric_limits<int16_t>::min());
+  const __m128i invalid_value =
+      _mm_set1_epi16(static_cast<int16_t>(VVELOCITY_INVALID));
+  for (; i + 8 <= count; i += 8) {
+    const __m128i fpm =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+    const __m128i bias = _mm_and_si128(_mm_srai_epi16(fpm, 15), bias_mask);
+    __m128i values = _mm_and_si128(
+        _mm_srai_epi16(_mm_add_epi16(fpm, bias), 6), wire_mask);
+    values = Select(_mm_cmpgt_epi16(fpm, limit), max_value, values);
+    values = Select(_mm_cmplt_epi16(fpm, neg_limit), min_value, values);
+    values = Select(_mm_cmpeq_epi16(fpm, invalid_input), invalid_value,
+                    values);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), values);
+  }
+#elif defined(XP2GDL90_FIELDS_NEON)
+  const int16x8_t bias_mask = vdupq_n_s16(63);
+  const uint16x8_t wire_mask = vdupq_n_u16(0xFFF);
+  const int16x8_t limit = vdupq_n_s16(kVerticalVelocityLimit);
+  const int16x8_t neg_limit = vdupq_n_s16(-kVerticalVelocityLimit);
+  const uint16x8_t max_value = vdupq_n_u16(kVerticalVelocityMax);
+  const uint16x8_t min_value = vdupq_n_u16(kVerticalVelocityMin);
+  const int16x8_t invalid_input =
+      vdupq_n_s16(std::numeric_limits<int16_t>::min());
+  const uint16x8_t invalid_value = vdupq_n_u16(VVELOCITY_INVALID);
+  for (; i + 8 <= count; i += 8) {
+    const int16x8_t fpm = vld1q_s16(in + i);
+    const int16x8_t bias = vandq_s16(vshrq_n_s16(fpm, 15), bias_mask);
+    uint16x8_t values = vandq_u16(
+        vreinterpretq_u16_s16(vshrq_n_s16(vaddq_s16(fpm, bias), 6)),
+        wire_mask);
+    values = vbslq_u16(vcgtq_s16(fpm, limit), max_value, values);
+    values = vbslq_u16(vcltq_s16(fpm, neg_limit), min_value, values);
+    values = vbslq_u16(vceqq_s16(fpm, invalid_input), invalid_value, values);
+    vst1q_u16(out + i, values);
+  }
+#endif
+  EncodeVerticalVelocitiesScalar(in + i, count - i, out + i);
+}
+
+void EncodeTracks(const uint16_t *in, size_t count, uint8_t *out) {
+  size_t i = 0;
+  // (degrees % 360) * 256 / 360 == r * 32 / 45 with r = degrees % 360.
+#if defined(XP2GDL90_FIELDS_SSE2)
+  const __m128i magic = _mm_set1_epi16(static_cast<int16_t>(kDiv360Magic));
+  const __m128i full_circle = _mm_set1_epi16(360);
+  for (; i + 8 <= count; i += 8) {
+    const __m128i degrees =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+    const __m128i turns = _mm_srli_epi16(_mm_mulhi_epu16(degrees, magic), 8);
+    const __m128i rest =
+        _mm_sub_epi16(degrees, _mm_mullo_epi16(turns, full_circle));
+    const __m128i values =
+        _mm_srli_epi16(_mm_mulhi_epu16(_mm_slli_epi16(rest, 5), magic), 5);
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i),
+                     _mm_packus_epi16(values, values));
+  }
+#elif defined(XP2GDL90_FIELDS_NEON)
+  for (; i + 8 <= count; i += 8) {
+    const uint16x8_t degrees = vld1q_u16(in + i);
+    const uint16x8_t turns = MulShift(degrees, kDiv360Magic, 24);
+    const uint16x8_t rest = vsubq_u16(degrees, vmulq_n_u16(turns, 360));
+    const uint16x8_t values =
+        MulShift(vshlq_n_u16(rest, 5), kDiv360Magic, 21);
+    vst1_u8(out + i, vmovn_u16(values));
+  }
+#endif
+  EncodeTracksScalar(in + i, count - i, out + i);
+}
+
+} // namespace gdl90
@@ -0,0 +1,140 @@
+#include "xp2gdl90/gdl90_framing.h"
+
+#include "xp2gdl90/crc16.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XP2GDL90_FRAMING_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define XP2GDL90_FRAMING_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace gdl90 {
+namespace {
+
+inline bool NeedsEscape(uint8_t byte) {
+  return byte == FRAME_ESCAPE || byte == FRAME_FLAG;
+}
+
+inline uint8_t *AppendEscaped(uint8_t *out, uint8_t byte) {
+  if (NeedsEscape(byte)) {
+    *out++ = FRAME_ESCAPE;
+    *out++ = static_cast<uint8_t>(byte ^ 0x20);
+  } else {
+    *out++ = byte;
+  }
+  return out;
+}
+
+#if defined(XP2GDL90_FRAMING_SSE2) || defined(XP2GDL90_FRAMING_NEON)
+inline unsigned CountTrailingZeros(uint64_t value) {
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanForward64(&index, value);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+}
+#endif
+
+} // namespace
+
+size_t FindEscapeByteScalar(const uint8_t *data, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    if (NeedsEscape(data[i])) {
+      return i;
+    }
+  }
+  return size;
+}
+
+size_t FindEscapeByte(const uint8_t *data, size_t size) {
+  size_t i = 0;
+#if defined(XP2GDL90_FRAMING_SSE2)
+  const __m128i flag = _mm_set1_epi8(static_cast<char>(FRAME_FLAG));
+  const __m128i escape = _mm_set1_epi8(static_cast<char>(FRAME_ESCAPE));
+  for (; i + 16 <= size; i += 16) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    const __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, flag),
+                                      _mm_cmpeq_epi8(chunk, escape));
+    const int mask = _mm_movemask_epi8(hits);
+    if (mask != 0) {
+      return i + CountTrailingZeros(static_cast<uint32_t>(mask));
+    }
+  }
+#elif defined(XP2GDL90_FRAMING_NEON)
+  const uint8x16_t flag = vdupq_n_u8(FRAME_FLAG);
+  const uint8x16_t escape = vdupq_n_u8(FRAME_ESCAPE);
+  for (; i + 16 <= size; i += 16) {
+    const uint8x16_t chunk = vld1q_u8(data + i);
+    const uint8x16_t hits =
+        vorrq_u8(vceqq_u8(chunk, flag), vceqq_u8(chunk, escape));
+    // Narrow each byte lane to a nibble so the result fits in 64 bits.
+    const uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+    if (mask != 0) {
+      return i + CountTrailingZeros(mask) / 4;
+    }
+  }
+#endif
+  return i + FindEscapeByteScalar(data + i, size - i);
+}
+
+size_t FrameMessageScalar(const uint8_t *payload, size_t size, uint8_t *out) {
+  uint8_t *cursor = out;
+  uint16_t crc = 0;
+
+  // CRC, byte stuffing and flag framing happen in a single pass.
+  *cursor++ = FRAME_FLAG;
+  for (size_t i = 0; i < size; ++i) {
+    crc = Crc16Update(crc, payload[i]);
+    cursor = AppendEscaped(cursor, payload[i]);
+  }
+  cursor = AppendEscaped(cursor, static_cast<uint8_t>(crc & 0xFF));
+  cursor = AppendEscaped(cursor, static_cast<uint8_t>((crc >> 8) & 0xFF));
+  *cursor++ = FRAME_FLAG;
+
+  return static_cast<size_t>(cursor - out);
+}
+
+size_t FrameMessage(const uint8_t *payload, size_t size, uint8_t *out) {
+  uint8_t *cursor = out;
+  uint16_t crc = 0;
+
+  // Clean runs are checksummed and copied in bulk; only the bytes that
+  // need stuffing take the per-byte path.
+  *cursor++ = FRAME_FLAG;
+  size_t i = 0;
+  while (i < size) {
+    const size_t run = FindEscapeByte(payload + i, size - i);
+    if (run > 0) {
+      crc = Crc16(payload + i, run, crc);
+      std::memcpy(cursor, payload + i, run);
+      cursor += run;
+      i += run;
+    }
+    if (i < size) {
+      crc = Crc16Update(crc, payload[i]);
+      *cursor++ = FRAME_ESCAPE;
+      *cursor++ = static_cast<uint8_t>(payload[i] ^ 0x20);
+      ++i;
+    }
+  }
+  cursor = AppendEscaped(cursor, static_cast<uint8_t>(crc & 0xFF));
+  cursor = AppendEscaped(cursor, static_cast<uint8_t>((crc >> 8) & 0xFF));
+  *cursor++ = FRAME_FLAG;
+
+  return static_cast<size_t>(cursor - out);
+}
+
+} // namespace gdl90
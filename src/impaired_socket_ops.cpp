@@ -0,0 +1,182 @@
+#include "xp2gdl90/impaired_socket_ops.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <errno.h>
+#endif
+
+namespace udp {
+
+int BufferFullError() {
+#ifdef _WIN32
+  return WSAEWOULDBLOCK;
+#else
+  return ENOBUFS;
+#endif
+}
+
+ImpairedSocketOps::ImpairedSocketOps(detail::SocketOps *inner,
+                                     xp2gdl90::Clock *clock)
+    : inner_(inner), clock_(clock ? clock : &xp2gdl90::SystemClock()) {
+  setOptions(ImpairmentOptions{});
+}
+
+void ImpairedSocketOps::setOptions(const ImpairmentOptions &options) {
+  options_ = options;
+  options_.jitter_s = (std::max)(0.0, options_.jitter_s);
+  random_state_ = options_.seed != 0 ? options_.seed : 1;
+}
+
+bool ImpairedSocketOps::dueLater(const Pending &a, const Pending &b) {
+  return a.due > b.due || (a.due == b.due && a.sequence > b.sequence);
+}
+
+double ImpairedSocketOps::nextUnit() {
+  // xorshift32, as FrameTicker uses: the same sequence on every platform.
+  random_state_ ^= random_state_ << 13;
+  random_state_ ^= random_state_ >> 17;
+  random_state_ ^= random_state_ << 5;
+  return static_cast<double>(random_state_) / 4294967296.0;
+}
+
+size_t ImpairedSocketOps::pump() {
+  const double now = clock_->monotonicSeconds();
+  size_t delivered = 0;
+  while (!queue_.empty() && queue_.front().due <= now) {
+    std::pop_heap(queue_.begin(), queue_.end(), dueLater);
+    deliver(queue_.back());
+    queued_bytes_ -= queue_.back().data.size();
+    queue_.pop_back();
+    ++delivered;
+  }
+  return delivered;
+}
+
+void ImpairedSocketOps::deliver(const Pending &pending) {
+  if (has_delivered_ && pending.sequence < last_delivered_) {
+    ++stats_.reordered;
+  } else {
+    last_delivered_ = pending.sequence;
+    has_delivered_ = true;
+  }
+  ++stats_.delivered;
+  if (inner_->SendTo(pending.socket, pending.data.data(), pending.data.size(),
+                     pending.flags, pending.addr.data(), pending.addrlen) < 0) {
+    ++stats_.inner_errors;
+  }
+}
+
+int ImpairedSocketOps::Startup() { return inner_->Startup(); }
+
+void ImpairedSocketOps::Cleanup() { inner_->Cleanup(); }
+
+uintptr_t ImpairedSocketOps::CreateSocket(int domain, int type,
+                                          int protocol) {
+  injected_error_ = 0;
+  return inner_->CreateSocket(domain, type, protocol);
+}
+
+int ImpairedSocketOps::SetSockOpt(uintptr_t socket, int level, int optname,
+                                  const void *optval, size_t optlen) {
+  injected_error_ = 0;
+  return inner_->SetSockOpt(socket, level, optname, optval, optlen);
+}
+
+int ImpairedSocketOps::InetPton(int af, const char *src, void *dst) {
+  return inner_->InetPton(af, src, dst);
+}
+
+int ImpairedSocketOps::Bind(uintptr_t socket, const void *addr,
+                            size_t addrlen) {
+  injected_error_ = 0;
+  return inner_->Bind(socket, addr, addrlen);
+}
+
+intptr_t ImpairedSocketOps::SendTo(uintptr_t socket, const void *buf,
+                                   size_t len, int flags,
+                                   const void *dest_addr, size_t addrlen) {
+  pump();
+  injected_error_ = 0;
+  ++stats_.offered;
+  const double now = clock_->monotonicSeconds();
+  const bool capped = options_.bandwidth_bytes_per_s > 0.0;
+  const double backlog_bytes =
+      capped ? (std::max)(0.0, link_free_at_ - now) *
+                   options_.bandwidth_bytes_per_s
+             : 0.0;
+  const bool buffer_full =
+      (options_.buffer_full > 0.0 && nextUnit() < options_.buffer_full) ||
+      (capped && options_.send_buffer_bytes > 0 &&
+       backlog_bytes + static_cast<double>(len) >
+           static_cast<double>(options_.send_buffer_bytes));
+  if (buffer_full) {
+    ++stats_.buffer_full;
+    injected_error_ = BufferFullError();
+    return -1;
+  }
+
+  // A lost datagram still took its airtime.
+  double sent_at = now;
+  if (capped) {
+    link_free_at_ = (std::max)(link_free_at_, now) +
+                    static_cast<double>(len) / options_.bandwidth_bytes_per_s;
+    sent_at = link_free_at_;
+  }
+  if (options_.loss > 0.0 && nextUnit() < options_.loss) {
+    ++stats_.lost;
+    return static_cast<intptr_t>(len);
+  }
+  double delay = options_.latency_s;
+  if (options_.jitter_s > 0.0) {
+    delay += options_.jitter_s * (2.0 * nextUnit() - 1.0);
+  }
+  const double due = (std::max)(now, sent_at + delay);
+  const uint64_t sequence = next_sequence_++;
+  if (due <= now) {
+    last_delivered_ = sequence;
+    has_delivered_ = true;
+    ++stats_.delivered;
+    return inner_->SendTo(socket, buf, len, flags, dest_addr, addrlen);
+  }
+
+  Pending pending;
+  pending.due = due;
+  pending.sequence = sequence;
+  pending.socket = socket;
+  pending.flags = flags;
+  const uint8_t *bytes = static_cast<const uint8_t *>(buf);
+  pending.data.assign(bytes, bytes + len);
+  pending.addrlen = (std::min)(addrlen, pending.addr.size());
+  if (dest_addr) {
+    std::memcpy(pending.addr.data(), dest_addr, pending.addrlen);
+  }
+  queue_.push_back(std::move(pending));
+  std::push_heap(queue_.begin(), queue_.end(), dueLater);
+  queued_bytes_ += len;
+  stats_.max_queued_bytes = (std::max)(stats_.max_queued_bytes, queued_bytes_);
+  return static_cast<intptr_t>(len);
+}
+
+int ImpairedSocketOps::CloseSocket(uintptr_t socket) {
+  injected_error_ = 0;
+  const auto closed = std::remove_if(
+      queue_.begin(), queue_.end(),
+      [socket](const Pending &pending) { return pending.socket == socket; });
+  for (auto it = closed; it != queue_.end(); ++it) {
+    queued_bytes_ -= it->data.size();
+  }
+  queue_.erase(closed, queue_.end());
+  std::make_heap(queue_.begin(), queue_.end(), dueLater);
+  return inner_->CloseSocket(socket);
+}
+
+int ImpairedSocketOps::LastError() {
+  return injected_error_ != 0 ? injected_error_ : inner_->LastError();
+}
+
+} // namespace udp
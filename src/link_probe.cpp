@@ -0,0 +1,295 @@
+#include "xp2gdl90/link_probe.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+
+#include "encoder_support.h"
+#include "xp2gdl90/foreflight_encoder.h"
+#include "xp2gdl90/gdl90_encoder.h"
+
+namespace xp2gdl90 {
+namespace {
+
+// ID, version, sequence, send time.
+constexpr size_t kMarkPayloadSize = 1 + 1 + 4 + 8;
+
+uint64_t ReadBigEndian(const uint8_t *data, size_t size) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < size; ++i) {
+    value = (value << 8) | data[i];
+  }
+  return value;
+}
+
+double Milliseconds(uint64_t ns) { return static_cast<double>(ns) / 1e6; }
+
+void AppendFormat(std::string *out, const char *format, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+void AppendFormat(std::string *out, const char *format, ...) {
+  char line[256];
+  va_list args;
+  va_start(args, format);
+  const int written = std::vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  if (written > 0) {
+    out->append(line, (std::min)(static_cast<size_t>(written),
+                                 sizeof(line) - 1));
+  }
+}
+
+void AppendPercentiles(std::string *out, const char *label,
+                       const LatencyHistogram &histogram, bool buckets) {
+  AppendFormat(out, "%s p50 %.2f p90 %.2f p99 %.2f max %.2f ms", label,
+               Milliseconds(histogram.percentileNs(0.5)),
+               Milliseconds(histogram.percentileNs(0.9)),
+               Milliseconds(histogram.percentileNs(0.99)),
+               Milliseconds(histogram.maxNs()));
+  if (!buckets) {
+    return;
+  }
+  out->append("\n   ");
+  for (size_t bucket = 0; bucket < LATENCY_HISTOGRAM_BUCKETS; ++bucket) {
+    const uint64_t count = histogram.bucketCount(bucket);
+    if (count > 0) {
+      AppendFormat(out, " <=%.2f:%llu",
+                   Milliseconds(LatencyHistogram::bucketUpperNs(bucket)),
+                   static_cast<unsigned long long>(count));
+    }
+  }
+}
+
+} // namespace
+
+size_t EncodeLinkProbe(const LinkProbeMark &mark, gdl90::FrameBuffer &out) {
+  gdl90::internal::PayloadBuffer payload;
+  payload.push_back(MSG_ID_LINK_PROBE);
+  payload.push_back(LINK_PROBE_VERSION);
+  gdl90::internal::AppendBigEndian32(payload, mark.sequence);
+  gdl90::internal::AppendBigEndian64(
+      payload, static_cast<uint64_t>(mark.send_time_us));
+  return gdl90::internal::PrepareMessage(payload, out);
+}
+
+bool DecodeLinkProbe(const gdl90::FrameSpan &frame, LinkProbeMark *out) {
+  if (frame.size < kMarkPayloadSize ||
+      frame.messageId() != MSG_ID_LINK_PROBE ||
+      frame.data[1] != LINK_PROBE_VERSION) {
+    return false;
+  }
+  out->sequence = static_cast<uint32_t>(ReadBigEndian(frame.data + 2, 4));
+  out->send_time_us = static_cast<int64_t>(ReadBigEndian(frame.data + 6, 8));
+  return true;
+}
+
+const char *ProbeClassName(ProbeClass probe_class) {
+  switch (probe_class) {
+  case ProbeClass::HEARTBEAT:
+    return "Heartbeat";
+  case ProbeClass::OWNSHIP:
+    return "Ownship";
+  case ProbeClass::GEO_ALTITUDE:
+    return "Geo altitude";
+  case ProbeClass::TRAFFIC:
+    return "Traffic";
+  case ProbeClass::FOREFLIGHT_ID:
+    return "ForeFlight ID";
+  case ProbeClass::AHRS:
+    return "AHRS";
+  case ProbeClass::LINK_PROBE:
+    return "Link probe";
+  case ProbeClass::OTHER:
+    return "Other";
+  }
+  return "Unknown";
+}
+
+ProbeClass ClassifyFrame(const gdl90::FrameSpan &frame) {
+  switch (frame.messageId()) {
+  case gdl90::MSG_ID_HEARTBEAT:
+    return ProbeClass::HEARTBEAT;
+  case gdl90::MSG_ID_OWNSHIP_REPORT:
+    return ProbeClass::OWNSHIP;
+  case gdl90::MSG_ID_OWNSHIP_GEO_ALTITUDE:
+    return ProbeClass::GEO_ALTITUDE;
+  case gdl90::MSG_ID_TRAFFIC_REPORT:
+    return ProbeClass::TRAFFIC;
+  case MSG_ID_LINK_PROBE:
+    return ProbeClass::LINK_PROBE;
+  case gdl90::foreflight::MSG_ID_FORE_FLIGHT:
+    if (frame.size > 1 &&
+        frame.data[1] == gdl90::foreflight::SUB_ID_DEVICE_INFO) {
+      return ProbeClass::FOREFLIGHT_ID;
+    }
+    if (frame.size > 1 && frame.data[1] == gdl90::foreflight::SUB_ID_AHRS) {
+      return ProbeClass::AHRS;
+    }
+    return ProbeClass::OTHER;
+  default:
+    return ProbeClass::OTHER;
+  }
+}
+
+double ProbeClassStats::meanIntervalS() const {
+  const uint64_t intervals = interval.count();
+  return intervals > 0 ? interval_sum_s / static_cast<double>(intervals)
+                       : 0.0;
+}
+
+double ProbeClassStats::jitterS() const {
+  const uint64_t intervals = interval.count();
+  if (intervals < 2) {
+    return 0.0;
+  }
+  const double mean = meanIntervalS();
+  const double variance =
+      interval_sum_sq_s / static_cast<double>(intervals) - mean * mean;
+  return variance > 0.0 ? std::sqrt(variance) : 0.0;
+}
+
+void LinkProbe::receiveDatagram(const uint8_t *data, size_t size,
+                                int64_t arrival_ns, int64_t arrival_wall_us) {
+  if (stats_.datagrams == 0) {
+    first_arrival_ns_ = arrival_ns;
+  }
+  ++stats_.datagrams;
+  stats_.bytes += size;
+  stats_.elapsed_s = static_cast<double>(arrival_ns - first_arrival_ns_) / 1e9;
+
+  const uint64_t bad_before = decoder_.crcErrors() + decoder_.malformed();
+  decoder_.reset(data, size);
+  gdl90::FrameSpan frame;
+  while (decoder_.next(&frame)) {
+    receiveFrame(frame, arrival_ns, arrival_wall_us);
+  }
+  stats_.bad_frames += decoder_.crcErrors() + decoder_.malformed() - bad_before;
+}
+
+void LinkProbe::reset() { *this = LinkProbe(options_); }
+
+void LinkProbe::receiveFrame(const gdl90::FrameSpan &frame,
+                             int64_t arrival_ns, int64_t arrival_wall_us) {
+  const ProbeClass probe_class = ClassifyFrame(frame);
+  const size_t index = static_cast<size_t>(probe_class);
+  ProbeClassStats &stats = stats_.classes[index];
+  ++stats.frames;
+  // Frames sharing a datagram arrive together; only the first of a class
+  // starts an interval.
+  if (seen_[index] && arrival_ns > last_arrival_ns_[index]) {
+    const int64_t interval_ns = arrival_ns - last_arrival_ns_[index];
+    const double interval_s = static_cast<double>(interval_ns) / 1e9;
+    stats.interval.record(static_cast<uint64_t>(interval_ns));
+    stats.interval_sum_s += interval_s;
+    stats.interval_sum_sq_s += interval_s * interval_s;
+    if (probe_class == ProbeClass::HEARTBEAT &&
+        options_.heartbeat_period_s > 0.0) {
+      const double periods =
+          std::round(interval_s / options_.heartbeat_period_s);
+      if (periods > 1.0) {
+        stats_.missed_heartbeats += static_cast<uint64_t>(periods) - 1;
+      }
+    }
+  }
+  seen_[index] = true;
+  last_arrival_ns_[index] = arrival_ns;
+
+  if (probe_class == ProbeClass::TRAFFIC) {
+    gdl90::PositionData report;
+    if (gdl90::DecodePositionReport(frame, &report)) {
+      const auto inserted =
+          last_traffic_ns_.emplace(report.icao_address, arrival_ns);
+      if (!inserted.second) {
+        const int64_t age = arrival_ns - inserted.first->second;
+        stats_.traffic_age.record(age > 0 ? static_cast<uint64_t>(age) : 0);
+        inserted.first->second = arrival_ns;
+      }
+      stats_.traffic_targets = last_traffic_ns_.size();
+    }
+  } else if (probe_class == ProbeClass::LINK_PROBE) {
+    LinkProbeMark mark;
+    if (DecodeLinkProbe(frame, &mark)) {
+      receiveMark(mark, arrival_wall_us);
+    }
+  }
+}
+
+void LinkProbe::receiveMark(const LinkProbeMark &mark,
+                            int64_t arrival_wall_us) {
+  ++stats_.marks;
+  const int64_t delay_us = arrival_wall_us - mark.send_time_us;
+  if (!has_mark_ || delay_us < stats_.min_delay_us) {
+    stats_.min_delay_us = delay_us;
+  }
+  stats_.delay.record(
+      static_cast<uint64_t>(delay_us - stats_.min_delay_us) * 1000);
+
+  // Differences wrap with the sequence.
+  const int32_t ahead = static_cast<int32_t>(mark.sequence - next_sequence_);
+  if (!has_mark_ || ahead >= 0) {
+    if (has_mark_) {
+      stats_.marks_lost += static_cast<uint64_t>(ahead);
+    }
+    next_sequence_ = mark.sequence + 1;
+  } else {
+    ++stats_.marks_late;
+    if (stats_.marks_lost > 0) {
+      --stats_.marks_lost;
+    }
+  }
+  has_mark_ = true;
+}
+
+std::string FormatLinkProbeReport(const LinkProbeStats &stats, bool buckets) {
+  std::string out;
+  const double elapsed = stats.elapsed_s > 0.0 ? stats.elapsed_s : 1.0;
+  AppendFormat(&out,
+               "Elapsed %.1f s, %llu datagrams, %llu bytes, %llu bad "
+               "frames\n",
+               stats.elapsed_s, static_cast<unsigned long long>(stats.datagrams),
+               static_cast<unsigned long long>(stats.bytes),
+               static_cast<unsigned long long>(stats.bad_frames));
+  for (size_t i = 0; i < PROBE_CLASS_COUNT; ++i) {
+    const ProbeClassStats &entry = stats.classes[i];
+    if (entry.frames == 0) {
+      continue;
+    }
+    AppendFormat(&out, "%-13s %8llu frames %8.2f/s  jitter %.2f ms ",
+                 ProbeClassName(static_cast<ProbeClass>(i)),
+                 static_cast<unsigned long long>(entry.frames),
+                 static_cast<double>(entry.frames) / elapsed,
+                 entry.jitterS() * 1e3);
+    AppendPercentiles(&out, "interval", entry.interval, buckets);
+    out.push_back('\n');
+  }
+  AppendFormat(&out, "Heartbeats missed: %llu\n",
+               static_cast<unsigned long long>(stats.missed_heartbeats));
+  if (stats.traffic_targets > 0) {
+    AppendFormat(&out, "Traffic: %zu targets, ", stats.traffic_targets);
+    AppendPercentiles(&out, "update age", stats.traffic_age, buckets);
+    out.push_back('\n');
+  }
+  if (stats.marks > 0) {
+    const double sent =
+        static_cast<double>(stats.marks + stats.marks_lost);
+    AppendFormat(&out,
+                 "Marks: %llu received, %llu lost (%.2f%%), %llu late, "
+                 "min one-way %.3f ms\n",
+                 static_cast<unsigned long long>(stats.marks),
+                 static_cast<unsigned long long>(stats.marks_lost),
+                 100.0 * static_cast<double>(stats.marks_lost) / sent,
+                 static_cast<unsigned long long>(stats.marks_late),
+                 static_cast<double>(stats.min_delay_us) / 1e3);
+    AppendPercentiles(&out, "  delay above min", stats.delay, buckets);
+    out.push_back('\n');
+  } else {
+    out.append("Marks: none; turn on link_probe in the sender's settings\n");
+  }
+  return out;
+}
+
+} // namespace xp2gdl90
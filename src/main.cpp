@@ -24,26 +24,56 @@
 #include <cmath>
 #include <cstdio>
 #include <cstring>
+#include <functional>
 #include <iomanip>
 #include <limits>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "backends/imgui_impl_opengl2.h"
 #include "imgui.h"
 
+#include "xp2gdl90/bandwidth_accounting.h"
 #include "xp2gdl90/broadcast_clock.h"
+#include "xp2gdl90/broadcast_engine.h"
+#include "xp2gdl90/cached_frame.h"
+#include "xp2gdl90/compact_capture.h"
+#include "xp2gdl90/datagram_packer.h"
+#include "xp2gdl90/dataref_cache.h"
+#include "xp2gdl90/network_sender.h"
+#include "xp2gdl90/output_scheduler.h"
+#include "xp2gdl90/foreflight_discovery.h"
 #include "xp2gdl90/foreflight_encoder.h"
-#include "xp2gdl90/foreflight_protocol.h"
 #include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/metrics_exporter.h"
 #include "xp2gdl90/protocol_utils.h"
 #include "xp2gdl90/settings.h"
+#include "xp2gdl90/settings_snapshot.h"
 #include "xp2gdl90/settings_ui.h"
+#include "xp2gdl90/settings_watcher.h"
+#include "xp2gdl90/shared_output.h"
+#include "xp2gdl90/sim_recording.h"
+#include "xp2gdl90/stage_timing.h"
+#include "xp2gdl90/stats_history.h"
+#include "xp2gdl90/status_panels.h"
+#include "xp2gdl90/stream_capture.h"
+#include "xp2gdl90/tcas_traffic.h"
+#include "xp2gdl90/thread_tuning.h"
+#include "xp2gdl90/track_table.h"
+#include "xp2gdl90/traffic_extrapolation.h"
+#include "xp2gdl90/traffic_pacer.h"
+#include "xp2gdl90/traffic_projection.h"
+#include "xp2gdl90/traffic_relay.h"
+#include "xp2gdl90/traffic_scheduler.h"
+#include "xp2gdl90/traffic_selection.h"
 #include "xp2gdl90/traffic_support.h"
+#include "xp2gdl90/traffic_worker.h"
 #include "xp2gdl90/udp_broadcaster.h"
 #include "xp2gdl90/udp_receiver.h"
+#include "xp2gdl90/utc_clock.h"
 
 #ifdef _WIN32
 // X-Plane SDK headers may include Windows headers that define min/max macros.
@@ -64,29 +94,31 @@ namespace {
 constexpr double kMetersToFeet = 3.28084;
 constexpr float kMetersPerSecondToKnots = 1.94384f;
 constexpr float kMetersPerSecondToFeetPerMinute = 196.8504f;
-constexpr float kForeFlightDeviceInfoRate = 1.0f;
-constexpr float kForeFlightAhrsRate = 5.0f;
-constexpr float kOwnshipGeoAltitudeRate = 1.0f;
 constexpr float kForeFlightDiscoveryTimeout = 15.0f;
+// Longest the flight loop sleeps with nothing due, so discovery polling,
+// sender errors and settings changes are still picked up promptly.
+constexpr double kMaxFlightLoopInterval = 0.25;
+// Fastest ownship_high_rate sends, and how often its flight loop checks for
+// the setting while it is off.
+constexpr double kOwnshipHighRateMinPeriod = 0.1;
+constexpr float kOwnshipSamplerIdleInterval = 1.0f;
 constexpr int kTrafficFlightIdSize = 8;
+// Longest output waits at plugin start for the settings thread's first
+// read before going out with the current settings.
+constexpr double kSettingsLoadWaitS = 2.0;
+// Targets absent from this many traffic sweeps leave the track table.
+constexpr float kTrafficStaleSweeps = 3.0f;
 constexpr int kTrafficTailnumSize = 10;
-constexpr float kMinTrackSpeedMps = 0.5f;
+// Mapped as /xp2gdl90 on POSIX, Local\xp2gdl90 on Windows.
+constexpr const char *kSharedOutputName = "xp2gdl90";
 constexpr double kRadiansToDegrees = 57.29577951308232;
+constexpr double kDegreesToRadians = 1.0 / kRadiansToDegrees;
 
+using xp2gdl90::Destination;
 using xp2gdl90::Settings;
+using xp2gdl90::SettingsSnapshot;
 using xp2gdl90::SettingsUiState;
 
-enum class TcasSsrMode : int {
-  Off = 0,
-  Standby = 1,
-  ModeA = 2,
-  ModeC = 3,
-  Test = 4,
-  Ground = 5,
-  TaOnly = 6,
-  TaRa = 7,
-};
-
 struct TrafficTcasRefs {
   XPLMDataRef mode_s_ref = nullptr;
   XPLMDataRef mode_c_code_ref = nullptr;
@@ -127,13 +159,86 @@ struct TrafficTextRefs {
   XPLMDataRef tailnum_ref = nullptr;
 };
 
+// Ownship state read once per flight loop tick, so every message built in
+// the tick uses the same sample. Optional values are NaN when their dataref
+// is missing.
+struct FrameContext {
+  double broadcast_time = 0.0;
+  double latitude = 0.0;
+  double longitude = 0.0;
+  bool gps_valid = false;
+  double geometric_altitude_m = 0.0;
+  double pressure_altitude_ft = NAN;
+  float ground_speed_mps = 0.0f;
+  float vertical_speed_fpm = 0.0f;
+  float track_deg = 0.0f;
+  bool on_ground = false;
+  float roll_deg = NAN;
+  float pitch_deg = NAN;
+  float heading_deg = NAN;
+  float indicated_airspeed_kt = NAN;
+  float true_airspeed_kt = NAN;
+  std::string tail_number;
+};
+
+// A read-only xp2gdl90/stats/* dataref; see RegisterStatsDataRefs().
+struct StatsDataRef {
+  std::string name;
+  std::function<double()> read;
+  XPLMDataRef ref = nullptr;
+};
+
 struct PluginState {
-  std::unique_ptr<gdl90::GDL90Encoder> encoder;
+  std::unique_ptr<gdl90::TimedGDL90Encoder<gdl90::SteadyUtcClock>> encoder;
   std::unique_ptr<gdl90::foreflight::ForeFlightEncoder> foreflight_encoder;
   std::unique_ptr<udp::UDPBroadcaster> broadcaster;
-  std::unique_ptr<udp::UDPReceiver> foreflight_receiver;
-  Settings settings;
-
+  // Routes, packs, paces and counts every send; attached to broadcaster
+  // and owns the sender thread while sender_thread is on.
+  xp2gdl90::BroadcastEngine engine;
+  // Records what the broadcaster sends while stream_capture is on.
+  std::unique_ptr<udp::CaptureSink> stream_capture;
+  size_t stream_capture_bytes = 0;
+  bool stream_capture_compact = false;
+  // Publishes what the engine sends while shared_output is on.
+  std::unique_ptr<xp2gdl90::SharedOutput> shared_output;
+  // Records each traffic sweep's simulator inputs while sim_recording is on.
+  std::unique_ptr<xp2gdl90::SimRecorder> sim_recorder;
+  // Sends link health reports while metrics_enabled is on.
+  xp2gdl90::MetricsExporter metrics_exporter;
+  std::string metrics_last_error;
+  std::unique_ptr<xp2gdl90::foreflight::DiscoveryListener> foreflight_listener;
+  uint64_t foreflight_errors_seen = 0;
+  // Decodes the external feed while traffic_relay is on; relayed_traffic
+  // keeps the latest report per address for the sweeps.
+  std::unique_ptr<xp2gdl90::traffic::TrafficRelayListener> traffic_relay;
+  xp2gdl90::traffic::RelayedTraffic relayed_traffic;
+  uint64_t traffic_relay_errors_seen = 0;
+  // Pre-framed messages that rarely change; see InvalidateStaticFrames().
+  gdl90::CachedFrame heartbeat_frame;
+  gdl90::CachedFrame geo_altitude_frame;
+  gdl90::CachedFrame device_info_frame;
+  // Patched per report; a new callsign rebuilds it.
+  gdl90::CachedFrame ownship_frame;
+  gdl90::Callsign ownship_frame_callsign;
+  std::vector<gdl90::PositionData> traffic_reports;
+  // The sweep being paced out, swept here or taken from traffic_worker.
+  xp2gdl90::traffic::TrafficSweepResult traffic_sweep;
+  xp2gdl90::traffic::TrafficSweeper traffic_sweeper;
+  // Sweeps the TCAS arrays off the simulator thread while traffic_thread
+  // is on.
+  std::unique_ptr<xp2gdl90::traffic::TrafficWorker> traffic_worker;
+  // A clock reset the worker's next job still has to carry.
+  bool traffic_worker_reset = false;
+  // Broadcast seconds from a worker job's read to its pickup.
+  double traffic_worker_lag_s = 0.0;
+  // Published whole by ApplyConfigToRuntime(); see CurrentSettings().
+  xp2gdl90::SettingsPublisher settings;
+
+  // Datarefs are looked up on first enable rather than at start; see
+  // ResolveOwnshipDataRefs() and EnsureTrafficDataRefs().
+  xp2gdl90::DataRefCache dataref_cache{XPLMFindDataRef};
+  bool ownship_refs_resolved = false;
+  bool traffic_refs_resolved = false;
   XPLMDataRef lat_ref = nullptr;
   XPLMDataRef lon_ref = nullptr;
   XPLMDataRef alt_ref = nullptr;
@@ -151,20 +256,41 @@ struct PluginState {
   XPLMDataRef replay_ref = nullptr;
   XPLMDataRef tailnum_ref = nullptr;
   TrafficTcasRefs traffic_tcas_refs;
+  // TCAS table for the current tick, indexed by slot (0 is the user).
+  xp2gdl90::traffic::TrafficSnapshot traffic_snapshot;
+  std::vector<xp2gdl90::traffic::TrafficCandidate> traffic_candidates;
+  std::vector<gdl90::PositionData> legacy_traffic_reports;
   std::vector<LegacyTrafficRefs> legacy_traffic_refs;
   std::vector<TrafficTextRefs> traffic_text_refs;
-
-  float last_heartbeat = 0.0f;
-  float last_position = 0.0f;
-  float last_traffic = 0.0f;
-  float last_device_info = 0.0f;
-  float last_ahrs = 0.0f;
-  float last_geo_altitude = 0.0f;
-  float last_foreflight_discovery = -1.0f;
+  // Per-slot callsign and synthetic address, for whichever of the TCAS
+  // and legacy tables is in use.
+  xp2gdl90::traffic::TrafficIdentityCache traffic_identities;
+
+  double last_heartbeat = 0.0;
+  double last_position = 0.0;
+  double last_traffic = 0.0;
+  double last_device_info = 0.0;
+  double last_ahrs = 0.0;
+  double last_geo_altitude = 0.0;
+  double last_foreflight_discovery = -1.0;
   xp2gdl90::BroadcastClockState broadcast_clock_state;
-  float broadcast_clock_time = 0.0f;
+  xp2gdl90::SendIntervalTable send_intervals;
+  xp2gdl90::StageTimings stage_timings;
+  xp2gdl90::StatsHistory stats_history;
+  xp2gdl90::OutputScheduler output_scheduler;
+  // Schedules ownship alone in the after-flight-model loop while
+  // ownship_high_rate is on; see OwnshipSamplerCallback().
+  xp2gdl90::OutputScheduler ownship_scheduler;
+  XPLMFlightLoopID ownship_sampler = nullptr;
+  uint64_t flight_loop_calls = 0;
+  double last_flight_loop_interval = 0.0;
+  double broadcast_clock_time = 0.0;
   bool broadcast_clock_replay = false;
 
+  // Live ForeFlight clients. The first is the primary target and the rest
+  // are destinations after extra_destinations; the text is device 0's.
+  xp2gdl90::foreflight::DeviceTable foreflight_devices;
+  uint64_t foreflight_devices_applied = 0;
   std::string discovered_target_ip;
   uint16_t discovered_target_port = 0;
   bool using_discovered_target = false;
@@ -176,6 +302,15 @@ struct PluginState {
   int menu_item_enable = 0;
   int menu_item_settings = 0;
   std::string settings_path;
+  // Reads and watches settings_path off the simulator thread.
+  xp2gdl90::SettingsWatcher settings_watcher;
+  // False until the first settings read is applied or has been waited for
+  // until settings_wait_deadline.
+  bool settings_ready = false;
+  double settings_wait_deadline = 0.0;
+  std::string capture_path;
+  std::string compact_capture_path;
+  std::string sim_recording_path;
 
   XPLMWindowID settings_window = nullptr;
   bool imgui_initialized = false;
@@ -184,18 +319,24 @@ struct PluginState {
   bool imgui_mouse_changed[3] = {false, false, false};
   float imgui_mouse_wheel = 0.0f;
   float imgui_mouse_wheel_h = 0.0f;
+  // Between rebuilds the window draws the last frame's draw data again.
+  xp2gdl90::SettingsRedrawPolicy imgui_redraw;
+  bool imgui_frame_built = false;
+  int imgui_mouse_x = 0;
+  int imgui_mouse_y = 0;
+  std::array<int, 8> imgui_geometry{};
 
   bool settings_dirty = false;
   std::string settings_last_error;
   SettingsUiState settings_ui;
+  // Traffic targets the budget planner assumes; -1 takes the tracked count.
+  int plan_traffic_targets = -1;
 
   uint64_t heartbeat_packets_sent = 0;
   uint64_t position_packets_sent = 0;
-  uint64_t traffic_packets_sent = 0;
   uint64_t device_info_packets_sent = 0;
   uint64_t ahrs_packets_sent = 0;
   uint64_t geo_altitude_packets_sent = 0;
-  uint64_t bytes_sent = 0;
   int last_heartbeat_send_bytes = 0;
   int last_position_send_bytes = 0;
   int last_traffic_send_bytes = 0;
@@ -203,16 +344,25 @@ struct PluginState {
   int last_ahrs_send_bytes = 0;
   int last_geo_altitude_send_bytes = 0;
   int last_traffic_target_count = 0;
-  std::string last_send_error;
   std::string last_receiver_error;
+  // Registered once in XPluginStart; entries must not move afterwards.
+  std::vector<StatsDataRef> stats_datarefs;
 };
 
 PluginState g_state;
 
+// Take once per tick or draw and hold it for the whole pass.
+SettingsSnapshot CurrentSettings() { return g_state.settings.load(); }
+
 float FlightLoopCallback(float in_elapsed_since_last_call,
                          float in_elapsed_time_since_last_flight_loop,
                          int in_counter, void *in_refcon);
+float OwnshipSamplerCallback(float in_elapsed_since_last_call,
+                             float in_elapsed_time_since_last_flight_loop,
+                             int in_counter, void *in_refcon);
 void MenuHandlerCallback(void *in_menu_ref, void *in_item_ref);
+void StartOwnshipSampler();
+void StopOwnshipSampler();
 
 bool SaveSettingsToDisk(std::string *out_error);
 bool LoadSettingsFromDisk(Settings *out_settings, std::string *out_error);
@@ -220,15 +370,24 @@ void ShowSettingsWindow(bool show);
 void CreateSettingsWindow();
 void DestroySettingsWindow();
 bool ReloadSettingsFromDisk();
+void ApplyPendingSettingsLoad();
 void SyncSettingsUiFromConfig();
 void InitializeTrafficDataRefs();
-int32_t CorrectTrafficAltitudeToPressure(int32_t geometric_altitude_feet);
-size_t CollectTrafficData(const Settings &cfg,
-                          std::vector<gdl90::PositionData> *out_reports);
-void SendTrafficReports(float sim_time, const Settings &cfg);
+int32_t CorrectTrafficAltitudeToPressure(const FrameContext &frame,
+                                         int32_t geometric_altitude_feet);
+size_t SendTrafficReports(const FrameContext &frame, const Settings &cfg);
+void SendPacedTraffic(double now);
 bool ReconfigureRuntimeReceivers(const Settings &cfg, std::string *out_error);
-void RefreshBroadcastTarget(float sim_time, const Settings &cfg);
-void PollForeFlightDiscovery(float sim_time, const Settings &cfg);
+void RefreshBroadcastTarget(double sim_time, const Settings &cfg);
+void ApplyExtraDestinations(const Settings &cfg);
+void ApplyDeviceDestinations(udp::UDPBroadcaster &broadcaster);
+void ConfigureNetworkSender(const Settings &cfg);
+void ConfigureTrafficWorker(const Settings &cfg);
+void ConfigureStreamCapture(const Settings &cfg);
+void ConfigureSharedOutput(const Settings &cfg);
+void ConfigureSimRecording(const Settings &cfg);
+void ConfigureMetricsExporter(const Settings &cfg);
+void PollForeFlightDiscovery(double sim_time, const Settings &cfg);
 
 void LogMessage(const std::string &message) {
   XPLMDebugString(("[XP2GDL90] " + message + "\n").c_str());
@@ -299,91 +458,6 @@ double NormalizeDegrees360(double degrees) {
   return normalized;
 }
 
-uint32_t NormalizeTcasAddress(int raw_address) {
-  return static_cast<uint32_t>(raw_address) & 0xFFFFFFu;
-}
-
-bool TcasAddressUsesRealIcao(int raw_address) {
-  return (static_cast<uint32_t>(raw_address) & 0x80000000u) != 0u;
-}
-
-gdl90::AddressType ResolveTcasAddressType(int raw_address) {
-  return TcasAddressUsesRealIcao(raw_address)
-             ? gdl90::AddressType::ADSB_ICAO
-             : gdl90::AddressType::ADSB_SELF_ASSIGNED;
-}
-
-bool TcasSsrModeHasAltitude(int ssr_mode) {
-  switch (static_cast<TcasSsrMode>(ssr_mode)) {
-  case TcasSsrMode::ModeC:
-  case TcasSsrMode::Ground:
-  case TcasSsrMode::TaOnly:
-  case TcasSsrMode::TaRa:
-    return true;
-  default:
-    return false;
-  }
-}
-
-bool TcasSsrModeIndicatesGround(int ssr_mode) {
-  return static_cast<TcasSsrMode>(ssr_mode) == TcasSsrMode::Ground;
-}
-
-uint8_t ResolveTrafficEmergencyCodeFromSquawk(int squawk) {
-  switch (squawk) {
-  case 7500:
-    return 5;
-  case 7600:
-    return 4;
-  case 7700:
-    return 1;
-  default:
-    return 0;
-  }
-}
-
-bool TryResolveTrackFromVelocity(float vx, float vz, uint16_t *out_track) {
-  if (!out_track || !std::isfinite(static_cast<double>(vx)) ||
-      !std::isfinite(static_cast<double>(vz))) {
-    return false;
-  }
-
-  const double speed =
-      std::hypot(static_cast<double>(vx), static_cast<double>(vz));
-  if (speed < kMinTrackSpeedMps) {
-    return false;
-  }
-
-  const double degrees =
-      std::atan2(static_cast<double>(vx), -static_cast<double>(vz)) *
-      kRadiansToDegrees;
-  *out_track = ClampFloatToInt<uint16_t>(NormalizeDegrees360(degrees));
-  return true;
-}
-
-void ResolveTrafficTrack(float vx, float vz, float heading, uint16_t *out_track,
-                         gdl90::TrackType *out_track_type) {
-  if (!out_track || !out_track_type) {
-    return;
-  }
-
-  uint16_t velocity_track = 0;
-  if (TryResolveTrackFromVelocity(vx, vz, &velocity_track)) {
-    *out_track = velocity_track;
-    *out_track_type = gdl90::TrackType::TRUE_TRACK;
-    return;
-  }
-
-  if (std::isfinite(static_cast<double>(heading))) {
-    *out_track = NormalizeDegreesToUint16(heading);
-    *out_track_type = gdl90::TrackType::TRUE_HEADING;
-    return;
-  }
-
-  *out_track = 0;
-  *out_track_type = gdl90::TrackType::INVALID;
-}
-
 uint16_t ClampKnotsToUint16OrInvalid(float knots) {
   if (!std::isfinite(static_cast<double>(knots)) || knots < 0.0f) {
     return gdl90::foreflight::AHRS_AIRSPEED_INVALID;
@@ -394,11 +468,6 @@ uint16_t ClampKnotsToUint16OrInvalid(float knots) {
   return static_cast<uint16_t>(clamped);
 }
 
-bool ParseForeFlightBroadcastPacket(const std::vector<uint8_t> &packet,
-                                    uint16_t *out_port) {
-  return xp2gdl90::foreflight::ParseDiscoveryBroadcast(packet, out_port);
-}
-
 std::string ReadTailNumber() {
   if (!g_state.tailnum_ref) {
     return "";
@@ -434,24 +503,28 @@ std::string ReadDataRefText(XPLMDataRef ref, int max_bytes) {
   return Trim(buffer);
 }
 
-float ReadFloatArrayValue(XPLMDataRef ref, int index, float fallback) {
-  if (!ref || index < 0) {
-    return fallback;
-  }
-
-  float value = fallback;
-  const int values_read = XPLMGetDatavf(ref, &value, index, 1);
-  return values_read == 1 ? value : fallback;
+// Reads elements [0, count) of an array dataref in one call. Elements the
+// dataref does not provide are set to `fallback`.
+void ReadFloatArray(XPLMDataRef ref, size_t count, float fallback,
+                    std::vector<float> *out_values) {
+  out_values->resize(count);
+  const int values_read =
+      ref ? XPLMGetDatavf(ref, out_values->data(), 0,
+                          ClampFloatToInt<int>(count))
+          : 0;
+  std::fill(out_values->begin() + (std::max)(values_read, 0),
+            out_values->end(), fallback);
 }
 
-int ReadIntArrayValue(XPLMDataRef ref, int index, int fallback) {
-  if (!ref || index < 0) {
-    return fallback;
-  }
-
-  int value = fallback;
-  const int values_read = XPLMGetDatavi(ref, &value, index, 1);
-  return values_read == 1 ? value : fallback;
+void ReadIntArray(XPLMDataRef ref, size_t count, int fallback,
+                  std::vector<int> *out_values) {
+  out_values->resize(count);
+  const int values_read =
+      ref ? XPLMGetDatavi(ref, out_values->data(), 0,
+                          ClampFloatToInt<int>(count))
+          : 0;
+  std::fill(out_values->begin() + (std::max)(values_read, 0),
+            out_values->end(), fallback);
 }
 
 bool LocalPositionToWorld(double x, double y, double z, double *out_latitude,
@@ -478,57 +551,118 @@ bool LocalPositionToWorld(double x, double y, double z, double *out_latitude,
   return true;
 }
 
-gdl90::EmitterCategory WakeCategoryToEmitterCategory(int wake_category) {
-  switch (wake_category) {
-  case 0:
-    return gdl90::EmitterCategory::LIGHT;
-  case 1:
-    return gdl90::EmitterCategory::LARGE;
-  case 2:
-    return gdl90::EmitterCategory::HEAVY;
-  case 3:
-    return gdl90::EmitterCategory::HIGH_VORTEX_LARGE;
-  default:
-    return gdl90::EmitterCategory::NO_INFO;
+std::string_view TrimView(std::string_view input) {
+  const size_t start = input.find_first_not_of(" \t\r\n");
+  if (start == std::string_view::npos) {
+    return {};
   }
+  const size_t end = input.find_last_not_of(" \t\r\n");
+  return input.substr(start, end - start + 1);
 }
 
-std::string FormatTrafficFallbackCallsign(uint32_t address) {
-  char buffer[9] = {};
-  std::snprintf(buffer, sizeof(buffer), "V%06X",
-                static_cast<unsigned int>(address & 0xFFFFFFu));
-  return buffer;
-}
-
-std::string ReadTrafficFlightId(size_t slot) {
+gdl90::Callsign ReadTrafficFlightId(size_t slot) {
   if (!g_state.traffic_tcas_refs.flight_id_ref) {
-    return "";
+    return {};
   }
 
-  char buffer[kTrafficFlightIdSize + 1] = {};
+  char buffer[kTrafficFlightIdSize] = {};
   const int offset =
       ClampFloatToInt<int>(slot * static_cast<size_t>(kTrafficFlightIdSize));
   const int bytes_read = XPLMGetDatab(g_state.traffic_tcas_refs.flight_id_ref,
                                       buffer, offset, kTrafficFlightIdSize);
   if (bytes_read <= 0) {
-    return "";
-  }
-  buffer[(std::min)(bytes_read, kTrafficFlightIdSize)] = '\0';
-  return Trim(std::string(buffer));
-}
-
-std::string ReadTrafficIdentity(size_t slot) {
-  std::string callsign =
-      xp2gdl90::protocol::SanitizeCallsign(ReadTrafficFlightId(slot));
-  if (callsign.empty() && slot >= 1 &&
-      slot <= g_state.traffic_text_refs.size()) {
-    callsign = xp2gdl90::protocol::SanitizeCallsign(ReadDataRefText(
-        g_state.traffic_text_refs[slot - 1].tailnum_ref, kTrafficTailnumSize));
-  }
-  if (!callsign.empty()) {
-    return callsign;
+    return {};
+  }
+  const size_t size =
+      static_cast<size_t>((std::min)(bytes_read, kTrafficFlightIdSize));
+  return xp2gdl90::protocol::MakeCallsign(TrimView(
+      std::string_view(buffer, strnlen(buffer, size))));
+}
+
+gdl90::Callsign ResolveTrafficIdentity(size_t slot,
+                                       const gdl90::Callsign &flight_id) {
+  if (!flight_id.empty() || slot < 1 ||
+      slot > g_state.traffic_text_refs.size()) {
+    return flight_id;
+  }
+  return xp2gdl90::protocol::MakeCallsign(ReadDataRefText(
+      g_state.traffic_text_refs[slot - 1].tailnum_ref, kTrafficTailnumSize));
+}
+
+gdl90::Callsign ReadTrafficIdentity(size_t slot) {
+  return ResolveTrafficIdentity(slot, ReadTrafficFlightId(slot));
+}
+
+// Reads TCAS slots [0, slots) straight into *out_snapshot with one dataref
+// call per array, then fills each slot's callsign and synthetic address
+// from g_state.traffic_identities, resolving the slots that are due.
+void ReadTcasTrafficSnapshot(size_t slots, uint32_t ownship_address,
+                             double now,
+                             xp2gdl90::traffic::TrafficSnapshot *out_snapshot) {
+  const TrafficTcasRefs &refs = g_state.traffic_tcas_refs;
+  xp2gdl90::traffic::TrafficSnapshot &snapshot = *out_snapshot;
+  snapshot.resize(slots);
+  ReadIntArray(refs.mode_s_ref, slots, 0, &snapshot.raw_address);
+  ReadFloatArray(refs.x_ref, slots, NAN, &snapshot.x);
+  ReadFloatArray(refs.y_ref, slots, NAN, &snapshot.y);
+  ReadFloatArray(refs.z_ref, slots, NAN, &snapshot.z);
+  ReadFloatArray(refs.vx_ref, slots, NAN, &snapshot.vx);
+  ReadFloatArray(refs.vy_ref, slots, NAN, &snapshot.vy);
+  ReadFloatArray(refs.vz_ref, slots, NAN, &snapshot.vz);
+  ReadFloatArray(refs.vertical_speed_ref, slots, NAN,
+                 &snapshot.vertical_speed_fpm);
+  ReadFloatArray(refs.heading_ref, slots, NAN, &snapshot.heading_deg);
+  ReadIntArray(refs.weight_on_wheels_ref, slots, -1,
+               &snapshot.weight_on_wheels);
+  ReadIntArray(refs.ssr_mode_ref, slots, -1, &snapshot.ssr_mode);
+  ReadIntArray(refs.mode_c_code_ref, slots, 0, &snapshot.squawk);
+  ReadIntArray(refs.wake_cat_ref, slots, -1, &snapshot.wake_category);
+
+  xp2gdl90::traffic::TrafficIdentityCache &identities =
+      g_state.traffic_identities;
+  bool refresh = false;
+  for (size_t slot = 0; slot < slots && !refresh; ++slot) {
+    refresh = identities.needsRefresh(slot, snapshot.raw_address[slot],
+                                      ownship_address, now);
+  }
+
+  // flight_id is kTrafficFlightIdSize bytes per slot, matching the callsign
+  // column layout.
+  static_assert(static_cast<size_t>(kTrafficFlightIdSize) ==
+                    xp2gdl90::traffic::TRAFFIC_CALLSIGN_SIZE,
+                "flight_id slots must match the callsign column");
+  // Only read when some slot is due.
+  if (refresh) {
+    char *id_bytes = snapshot.callsign.data()->data();
+    const size_t id_size = slots * static_cast<size_t>(kTrafficFlightIdSize);
+    const int bytes_read =
+        refs.flight_id_ref ? XPLMGetDatab(refs.flight_id_ref, id_bytes, 0,
+                                          ClampFloatToInt<int>(id_size))
+                           : 0;
+    std::fill(id_bytes + (std::max)(bytes_read, 0), id_bytes + id_size,
+              '\0');
+  }
+
+  for (size_t slot = 0; slot < slots; ++slot) {
+    snapshot.source_id[slot] = static_cast<uint32_t>(slot);
+    snapshot.flags[slot] = 0;
+    snapshot.ground_speed_kt[slot] = NAN;
+    const int raw_address = snapshot.raw_address[slot];
+    const xp2gdl90::traffic::TrafficIdentity *identity = nullptr;
+    if (refresh &&
+        identities.needsRefresh(slot, raw_address, ownship_address, now)) {
+      const char *id = snapshot.callsign[slot].data();
+      const gdl90::Callsign flight_id = xp2gdl90::protocol::MakeCallsign(
+          TrimView(std::string_view(id, strnlen(id, kTrafficFlightIdSize))));
+      identity = &identities.store(slot, raw_address,
+                                   ResolveTrafficIdentity(slot, flight_id),
+                                   ownship_address, now);
+    } else {
+      identity = &identities.get(slot);
+    }
+    snapshot.callsign[slot] = identity->callsign;
+    snapshot.synthetic_address[slot] = identity->synthetic_address;
   }
-  return "";
 }
 
 uint16_t CalculateHorizontalSpeedKnots(float vx, float vz) {
@@ -547,104 +681,41 @@ int16_t CalculateVerticalSpeedFpm(float vy_mps) {
   return ClampFpmToInt16OrInvalid(vy_mps * kMetersPerSecondToFeetPerMinute);
 }
 
-bool BuildTrafficReportFromTcasSlot(const Settings &cfg, size_t slot,
-                                    gdl90::PositionData *out_report) {
-  if (!out_report || !g_state.traffic_tcas_refs.IsUsable()) {
+// Anchors a local projection on ownship (TCAS slot 0) with two exact
+// conversions.
+bool MakeTcasProjectionAnchor(
+    const xp2gdl90::traffic::TrafficSnapshot &snapshot,
+    xp2gdl90::traffic::ProjectionAnchor *out_anchor) {
+  if (snapshot.empty()) {
     return false;
   }
 
-  const int slot_index = ClampFloatToInt<int>(slot);
-  const int raw_address =
-      ReadIntArrayValue(g_state.traffic_tcas_refs.mode_s_ref, slot_index, 0);
-  const float local_x =
-      ReadFloatArrayValue(g_state.traffic_tcas_refs.x_ref, slot_index, NAN);
-  const float local_y =
-      ReadFloatArrayValue(g_state.traffic_tcas_refs.y_ref, slot_index, NAN);
-  const float local_z =
-      ReadFloatArrayValue(g_state.traffic_tcas_refs.z_ref, slot_index, NAN);
-
-  const float vx =
-      ReadFloatArrayValue(g_state.traffic_tcas_refs.vx_ref, slot_index, NAN);
-  const float vy =
-      ReadFloatArrayValue(g_state.traffic_tcas_refs.vy_ref, slot_index, NAN);
-  const float vz =
-      ReadFloatArrayValue(g_state.traffic_tcas_refs.vz_ref, slot_index, NAN);
-  const float vertical_speed = ReadFloatArrayValue(
-      g_state.traffic_tcas_refs.vertical_speed_ref, slot_index, NAN);
-  const float heading = ReadFloatArrayValue(
-      g_state.traffic_tcas_refs.heading_ref, slot_index, NAN);
-  const int weight_on_wheels = ReadIntArrayValue(
-      g_state.traffic_tcas_refs.weight_on_wheels_ref, slot_index, -1);
-  const int ssr_mode =
-      ReadIntArrayValue(g_state.traffic_tcas_refs.ssr_mode_ref, slot_index, -1);
-  const int squawk = ReadIntArrayValue(
-      g_state.traffic_tcas_refs.mode_c_code_ref, slot_index, 0);
-  const int wake_category =
-      ReadIntArrayValue(g_state.traffic_tcas_refs.wake_cat_ref, slot_index, -1);
-  const std::string identity = ReadTrafficIdentity(slot);
-
-  xp2gdl90::traffic::TcasPresenceSample presence;
-  presence.slot = slot;
-  presence.raw_address = raw_address;
-  presence.ssr_mode = ssr_mode;
-  presence.callsign = identity;
-  presence.local_x = local_x;
-  presence.local_y = local_y;
-  presence.local_z = local_z;
-  presence.velocity_x = vx;
-  presence.velocity_y = vy;
-  presence.velocity_z = vz;
-  if (!xp2gdl90::traffic::IsPopulatedTcasTarget(presence)) {
+  xp2gdl90::traffic::ProjectionAnchor anchor;
+  anchor.x = snapshot.x[0];
+  anchor.y = snapshot.y[0];
+  anchor.z = snapshot.z[0];
+  if (!std::isfinite(anchor.x) || !std::isfinite(anchor.y) ||
+      !std::isfinite(anchor.z)) {
     return false;
   }
-
-  uint32_t address = NormalizeTcasAddress(raw_address);
-  const bool synthetic_address = address == 0u;
-  if (synthetic_address) {
-    address = xp2gdl90::traffic::SyntheticTrafficAddress(slot, identity,
-                                                         cfg.icao_address);
-  }
-  if (address == (cfg.icao_address & 0xFFFFFFu)) {
+  XPLMLocalToWorld(anchor.x, anchor.y, anchor.z, &anchor.latitude_deg,
+                   &anchor.longitude_deg, &anchor.altitude_m);
+  double origin_altitude_m = 0.0;
+  XPLMLocalToWorld(0.0, 0.0, 0.0, &anchor.origin_latitude_deg,
+                   &anchor.origin_longitude_deg, &origin_altitude_m);
+  if (!std::isfinite(anchor.latitude_deg) ||
+      !std::isfinite(anchor.longitude_deg) ||
+      !std::isfinite(anchor.altitude_m) ||
+      !std::isfinite(anchor.origin_latitude_deg) ||
+      !std::isfinite(anchor.origin_longitude_deg)) {
     return false;
   }
-
-  gdl90::PositionData report{};
-  if (!LocalPositionToWorld(local_x, local_y, local_z, &report.latitude,
-                            &report.longitude, &report.altitude)) {
-    return false;
-  }
-  report.altitude = CorrectTrafficAltitudeToPressure(report.altitude);
-
-  const bool airborne = (weight_on_wheels >= 0)
-                            ? (weight_on_wheels == 0)
-                            : !TcasSsrModeIndicatesGround(ssr_mode);
-  if (g_state.traffic_tcas_refs.ssr_mode_ref &&
-      !TcasSsrModeHasAltitude(ssr_mode)) {
-    report.altitude = std::numeric_limits<int32_t>::min();
-  }
-
-  report.h_velocity = CalculateHorizontalSpeedKnots(vx, vz);
-  report.v_velocity = std::isfinite(static_cast<double>(vertical_speed))
-                          ? ClampFpmToInt16OrInvalid(vertical_speed)
-                          : CalculateVerticalSpeedFpm(vy);
-  ResolveTrafficTrack(vx, vz, heading, &report.track, &report.track_type);
-  report.airborne = airborne;
-  report.nic = cfg.nic;
-  report.nacp = cfg.nacp;
-  report.icao_address = address;
-  report.callsign =
-      identity.empty() ? FormatTrafficFallbackCallsign(address) : identity;
-  report.emitter_category = WakeCategoryToEmitterCategory(wake_category);
-  report.address_type = synthetic_address ? gdl90::AddressType::TISB_TRACK_FILE
-                                          : ResolveTcasAddressType(raw_address);
-  report.alert_status = 0;
-  report.emergency_code = ResolveTrafficEmergencyCodeFromSquawk(squawk);
-
-  *out_report = report;
+  *out_anchor = anchor;
   return true;
 }
 
-bool BuildTrafficReportFromLegacySlot(const Settings &cfg, size_t slot,
+bool BuildTrafficReportFromLegacySlot(const Settings &cfg,
+                                      const FrameContext &frame, size_t slot,
                                       gdl90::PositionData *out_report) {
   if (!out_report || slot < 1 || slot > g_state.legacy_traffic_refs.size()) {
     return false;
@@ -663,12 +734,17 @@ bool BuildTrafficReportFromLegacySlot(const Settings &cfg, size_t slot,
   const float vz = XPLMGetDataf(refs.vz_ref);
   const float heading = XPLMGetDataf(refs.heading_ref);
 
-  const std::string identity = ReadTrafficIdentity(slot);
-  const uint32_t synthetic_address = xp2gdl90::traffic::SyntheticTrafficAddress(
-      slot, identity, cfg.icao_address);
-  const std::string callsign =
-      identity.empty() ? FormatTrafficFallbackCallsign(synthetic_address)
-                       : identity;
+  // The legacy table has no mode-S addresses, so only the refresh interval
+  // picks up a renamed target.
+  xp2gdl90::traffic::TrafficIdentityCache &identities =
+      g_state.traffic_identities;
+  const xp2gdl90::traffic::TrafficIdentity &identity =
+      identities.needsRefresh(slot, 0, cfg.icao_address,
+                              frame.broadcast_time)
+          ? identities.store(slot, 0, ReadTrafficIdentity(slot),
+                             cfg.icao_address, frame.broadcast_time)
+          : identities.get(slot);
+  const bool has_identity = identity.callsign[0] != '\0';
 
   if (!std::isfinite(static_cast<double>(local_x)) ||
       !std::isfinite(static_cast<double>(local_y)) ||
@@ -676,7 +752,7 @@ bool BuildTrafficReportFromLegacySlot(const Settings &cfg, size_t slot,
     return false;
   }
   if (local_x == 0.0f && local_y == 0.0f && local_z == 0.0f &&
-      callsign == FormatTrafficFallbackCallsign(synthetic_address)) {
+      !has_identity) {
     return false;
   }
 
@@ -685,17 +761,22 @@ bool BuildTrafficReportFromLegacySlot(const Settings &cfg, size_t slot,
                             &report.longitude, &report.altitude)) {
     return false;
   }
-  report.altitude = CorrectTrafficAltitudeToPressure(report.altitude);
+  report.altitude = CorrectTrafficAltitudeToPressure(frame, report.altitude);
 
   report.h_velocity = CalculateHorizontalSpeedKnots(vx, vz);
   report.v_velocity = CalculateVerticalSpeedFpm(vy);
   report.airborne =
       report.h_velocity >= 35 || std::abs(static_cast<double>(vy)) >= 0.5;
-  ResolveTrafficTrack(vx, vz, heading, &report.track, &report.track_type);
+  xp2gdl90::traffic::ResolveTrafficTrack(vx, vz, heading, &report.track,
+                                          &report.track_type);
   report.nic = cfg.nic;
   report.nacp = cfg.nacp;
-  report.icao_address = synthetic_address;
-  report.callsign = callsign;
+  report.icao_address = identity.synthetic_address;
+  report.callsign =
+      has_identity
+          ? xp2gdl90::traffic::ToCallsign(identity.callsign)
+          : xp2gdl90::traffic::FallbackTrafficCallsign(
+                identity.synthetic_address);
   report.emitter_category = gdl90::EmitterCategory::NO_INFO;
   report.address_type = gdl90::AddressType::ADSB_SELF_ASSIGNED;
   report.alert_status = 0;
@@ -734,28 +815,52 @@ bool IsReplayActive() {
   return g_state.replay_ref && XPLMGetDatai(g_state.replay_ref) != 0;
 }
 
-void ResetBroadcastSchedule(float broadcast_time) {
-  constexpr float kImmediateOffset = 3600.0f;
-  const float ready_time = broadcast_time - kImmediateOffset;
+// Adaptive mode sweeps often enough for the fastest per-target interval;
+// the scheduler decides which targets each sweep sends.
+float TrafficSweepRate(const Settings &cfg) {
+  if (!cfg.traffic_adaptive_rate) {
+    return cfg.traffic_rate;
+  }
+  const double fastest =
+      1.0 / xp2gdl90::traffic::MakeTrafficRatePolicy(cfg).near_interval_s;
+  return (std::max)(cfg.traffic_rate, static_cast<float>(fastest));
+}
+
+void RecordSend(xp2gdl90::SendClass send_class, double now, double period_s) {
+  g_state.send_intervals[static_cast<size_t>(send_class)].recordSend(now,
+                                                                     period_s);
+}
+
+void ResetBroadcastSchedule(double broadcast_time) {
+  constexpr double kImmediateOffset = 3600.0;
+  const double ready_time = broadcast_time - kImmediateOffset;
   g_state.last_heartbeat = ready_time;
   g_state.last_position = ready_time;
   g_state.last_traffic = ready_time;
   g_state.last_device_info = ready_time;
   g_state.last_ahrs = ready_time;
   g_state.last_geo_altitude = ready_time;
+  for (xp2gdl90::SendIntervalHistogram &intervals : g_state.send_intervals) {
+    intervals.restart();
+  }
+  g_state.output_scheduler.restart(broadcast_time);
+  g_state.ownship_scheduler.restart(broadcast_time);
 
   // A discovery timestamp cannot be compared across clock domains. Fall back
   // to the configured target until another valid broadcast is received.
-  g_state.last_foreflight_discovery = -1.0f;
-  g_state.using_discovered_target = false;
+  g_state.last_foreflight_discovery = -1.0;
+  g_state.foreflight_devices.clear();
+  g_state.traffic_sweeper.reset();
+  g_state.traffic_worker_reset = true;
+  g_state.relayed_traffic.clear();
+  g_state.engine.resetTraffic();
 }
 
 xp2gdl90::BroadcastClockResult UpdateCurrentBroadcastClock() {
-  const float simulator_time =
+  const double simulator_time =
       g_state.sim_time_ref ? XPLMGetDataf(g_state.sim_time_ref) : NAN;
-  const float elapsed_time = XPLMGetElapsedTime();
   const auto result = xp2gdl90::UpdateBroadcastClock(
-      simulator_time, elapsed_time, IsReplayActive(),
+      simulator_time, xp2gdl90::MonotonicSeconds(), IsReplayActive(),
       &g_state.broadcast_clock_state);
   g_state.broadcast_clock_time = result.time;
   g_state.broadcast_clock_replay = result.replay_active;
@@ -767,21 +872,20 @@ xp2gdl90::BroadcastClockResult UpdateCurrentBroadcastClock() {
   return result;
 }
 
-int32_t CorrectTrafficAltitudeToPressure(int32_t geometric_altitude_feet) {
-  if (!g_state.alt_ref || !g_state.pressure_alt_ref) {
+int32_t CorrectTrafficAltitudeToPressure(const FrameContext &frame,
+                                         int32_t geometric_altitude_feet) {
+  if (!std::isfinite(frame.pressure_altitude_ft)) {
     return geometric_altitude_feet;
   }
-  const double ownship_geometric_feet =
-      XPLMGetDatad(g_state.alt_ref) * kMetersToFeet;
-  const double ownship_pressure_feet = XPLMGetDatad(g_state.pressure_alt_ref);
   return xp2gdl90::traffic::CorrectGeometricToPressureAltitude(
-      geometric_altitude_feet, ownship_geometric_feet, ownship_pressure_feet);
+      geometric_altitude_feet, frame.geometric_altitude_m * kMetersToFeet,
+      frame.pressure_altitude_ft);
 }
 
 bool ReconfigureRuntimeReceivers(const Settings &cfg, std::string *out_error) {
   if (cfg.foreflight_auto_discovery) {
-    if (!g_state.foreflight_receiver ||
-        g_state.foreflight_receiver->getListenPort() !=
+    if (!g_state.foreflight_listener ||
+        g_state.foreflight_listener->getListenPort() !=
             cfg.foreflight_broadcast_port) {
       auto receiver =
           std::make_unique<udp::UDPReceiver>(cfg.foreflight_broadcast_port);
@@ -792,16 +896,54 @@ bool ReconfigureRuntimeReceivers(const Settings &cfg, std::string *out_error) {
         }
         return false;
       }
-      g_state.foreflight_receiver = std::move(receiver);
+      g_state.foreflight_listener =
+          std::make_unique<xp2gdl90::foreflight::DiscoveryListener>(
+              std::move(receiver));
+      g_state.foreflight_errors_seen = 0;
+      if (!g_state.foreflight_listener->start()) {
+        // Still usable: PollForeFlightDiscovery polls it on the sim thread.
+        LogMessage("WARNING: " + g_state.foreflight_listener->lastError());
+      }
       LogMessage("ForeFlight discovery listener active on UDP port " +
                  std::to_string(cfg.foreflight_broadcast_port));
     }
   } else {
-    g_state.foreflight_receiver.reset();
-    g_state.discovered_target_ip.clear();
-    g_state.discovered_target_port = 0;
-    g_state.last_foreflight_discovery = -1.0f;
-    g_state.using_discovered_target = false;
+    g_state.foreflight_listener.reset();
+    g_state.foreflight_devices.clear();
+    g_state.last_foreflight_discovery = -1.0;
+  }
+
+  if (cfg.traffic_relay) {
+    if (!g_state.traffic_relay ||
+        g_state.traffic_relay->getListenPort() != cfg.traffic_relay_port) {
+      auto receiver =
+          std::make_unique<udp::UDPReceiver>(cfg.traffic_relay_port);
+      if (!receiver->initialize()) {
+        if (out_error) {
+          *out_error = "Failed to initialize traffic relay listener: " +
+                       receiver->getLastError();
+        }
+        return false;
+      }
+      g_state.traffic_relay =
+          std::make_unique<xp2gdl90::traffic::TrafficRelayListener>(
+              std::move(receiver));
+      g_state.traffic_relay_errors_seen = 0;
+      g_state.relayed_traffic.clear();
+      if (!g_state.traffic_relay->start()) {
+        // Still usable: CollectRelayedTraffic polls it on the sim thread.
+        LogMessage("WARNING: " + g_state.traffic_relay->lastError());
+      }
+      LogMessage("Traffic relay listener active on UDP port " +
+                 std::to_string(cfg.traffic_relay_port));
+    }
+  } else {
+    g_state.traffic_relay.reset();
+    g_state.relayed_traffic.clear();
+  }
+  if (g_state.traffic_relay) {
+    g_state.traffic_relay->setThreadTuning(
+        xp2gdl90::MakeWorkerThreadTuning(cfg));
   }
 
   if (out_error) {
@@ -810,17 +952,34 @@ bool ReconfigureRuntimeReceivers(const Settings &cfg, std::string *out_error) {
   return true;
 }
 
-void RefreshBroadcastTarget(float sim_time, const Settings &cfg) {
+// Gives `fn` the broadcaster, locked against the sender thread if one runs.
+template <typename Fn> void WithBroadcaster(Fn &&fn) {
+  g_state.engine.withBroadcaster(fn);
+}
+
+void RefreshBroadcastTarget(double sim_time, const Settings &cfg) {
   if (!g_state.broadcaster) {
     return;
   }
 
-  const bool discovery_valid = cfg.foreflight_auto_discovery &&
-                               !g_state.discovered_target_ip.empty() &&
-                               g_state.discovered_target_port > 0 &&
-                               g_state.last_foreflight_discovery >= 0.0f &&
-                               (sim_time - g_state.last_foreflight_discovery) <=
-                                   kForeFlightDiscoveryTimeout;
+  xp2gdl90::foreflight::DeviceTable &devices = g_state.foreflight_devices;
+  if (!cfg.foreflight_auto_discovery) {
+    devices.clear();
+  }
+  devices.expire(sim_time, kForeFlightDiscoveryTimeout);
+  if (devices.generation() != g_state.foreflight_devices_applied) {
+    // Text is only formatted when a device joins or leaves.
+    g_state.foreflight_devices_applied = devices.generation();
+    g_state.discovered_target_ip.clear();
+    g_state.discovered_target_port = 0;
+    if (!devices.empty()) {
+      g_state.discovered_target_ip = udp::FormatSourceIp(devices[0].address);
+      g_state.discovered_target_port = devices[0].address.port;
+    }
+    WithBroadcaster(ApplyDeviceDestinations);
+  }
+
+  const bool discovery_valid = !devices.empty();
 
   const std::string resolved_ip =
       discovery_valid ? g_state.discovered_target_ip : cfg.target_ip;
@@ -829,7 +988,16 @@ void RefreshBroadcastTarget(float sim_time, const Settings &cfg) {
 
   if (g_state.broadcaster->getTargetIp() != resolved_ip ||
       g_state.broadcaster->getTargetPort() != resolved_port) {
-    g_state.broadcaster->setTarget(resolved_ip, resolved_port);
+    bool updated = false;
+    std::string error;
+    WithBroadcaster([&](udp::UDPBroadcaster &broadcaster) {
+      updated = broadcaster.setTarget(resolved_ip, resolved_port);
+      error = broadcaster.getLastError();
+    });
+    if (!updated) {
+      LogMessage("Broadcast target rejected: " + error);
+      return;
+    }
     LogMessage(std::string("Broadcast target updated: ") + resolved_ip + ":" +
                std::to_string(resolved_port) +
                (discovery_valid ? " (ForeFlight discovery)" : " (manual)"));
@@ -838,6 +1006,293 @@ void RefreshBroadcastTarget(float sim_time, const Settings &cfg) {
   g_state.using_discovered_target = discovery_valid;
 }
 
+void ApplyExtraDestinations(const Settings &cfg) {
+  WithBroadcaster([&cfg](udp::UDPBroadcaster &broadcaster) {
+    broadcaster.clearDestinations();
+    broadcaster.setBandwidthLimit(
+        cfg.bandwidth_limit_bytes_per_s,
+        xp2gdl90::MESSAGE_HEARTBEAT | xp2gdl90::MESSAGE_OWNSHIP,
+        xp2gdl90::MESSAGE_TRAFFIC);
+    udp::SocketOptions socket_options;
+    socket_options.dscp = cfg.socket_dscp;
+    socket_options.send_buffer_bytes = cfg.socket_send_buffer_bytes;
+    socket_options.bind_ip = cfg.socket_bind_ip;
+    if (!broadcaster.setSocketOptions(socket_options)) {
+      LogMessage("Socket options rejected: " + broadcaster.getLastError());
+    }
+    udp::MulticastOptions multicast;
+    multicast.ttl = cfg.multicast_ttl;
+    multicast.interface_ip = cfg.multicast_interface;
+    multicast.loopback = cfg.multicast_loopback;
+    if (!broadcaster.setMulticastOptions(multicast)) {
+      LogMessage("Multicast options rejected: " + broadcaster.getLastError());
+    }
+    for (const Destination &destination : cfg.extra_destinations) {
+      if (!broadcaster.addDestination(destination.ip, destination.port,
+                                      destination.message_mask,
+                                      destination.rate_divisor)) {
+        LogMessage("Destination " + destination.ip + ":" +
+                   std::to_string(destination.port) +
+                   " rejected: " + broadcaster.getLastError());
+      }
+    }
+    ApplyDeviceDestinations(broadcaster);
+  });
+}
+
+void ApplyDeviceDestinations(udp::UDPBroadcaster &broadcaster) {
+  std::string error;
+  if (xp2gdl90::foreflight::ApplyDeviceDestinations(
+          g_state.foreflight_devices, broadcaster, &error) > 0) {
+    LogMessage("ForeFlight device not added: " + error);
+  }
+}
+
+void ConfigureNetworkSender(const Settings &cfg) {
+  const bool was_running = g_state.engine.senderRunning();
+  std::string error;
+  if (!g_state.engine.configure(xp2gdl90::MakeBroadcastOptions(cfg),
+                                &error)) {
+    LogMessage("ERROR: " + error);
+    return;
+  }
+  if (g_state.engine.senderRunning() != was_running) {
+    LogMessage(was_running ? "Network sender thread stopped"
+                           : "Network sender thread started");
+  }
+}
+
+void ConfigureTrafficWorker(const Settings &cfg) {
+  if (!cfg.traffic_thread) {
+    if (g_state.traffic_worker) {
+      g_state.traffic_worker.reset();
+      LogMessage("Traffic sweep thread stopped");
+    }
+    return;
+  }
+  const xp2gdl90::ThreadTuning tuning = xp2gdl90::MakeWorkerThreadTuning(cfg);
+  if (g_state.traffic_worker) {
+    g_state.traffic_worker->setThreadTuning(tuning);
+    return;
+  }
+
+  auto worker = std::make_unique<xp2gdl90::traffic::TrafficWorker>();
+  worker->setThreadTuning(tuning);
+  std::string error;
+  if (!worker->start(&error)) {
+    LogMessage("ERROR: " + error);
+    return;
+  }
+  g_state.traffic_worker = std::move(worker);
+  g_state.traffic_worker_reset = false;
+  g_state.traffic_worker_lag_s = 0.0;
+  LogMessage("Traffic sweep thread started");
+}
+
+// Opens, resizes or closes the capture to match `cfg`. The broadcaster is
+// detached first so no send records into a capture being closed.
+void ConfigureStreamCapture(const Settings &cfg) {
+  const size_t bytes = static_cast<size_t>(cfg.stream_capture_mb) << 20;
+  if (g_state.stream_capture && cfg.stream_capture &&
+      g_state.stream_capture_compact == cfg.stream_capture_compact &&
+      (cfg.stream_capture_compact || g_state.stream_capture_bytes == bytes)) {
+    return;
+  }
+  if (g_state.stream_capture) {
+    WithBroadcaster([](udp::UDPBroadcaster &broadcaster) {
+      broadcaster.setCapture(nullptr);
+    });
+    LogMessage("Stream capture stopped: " + g_state.stream_capture->path());
+    g_state.stream_capture.reset();
+  }
+  if (!cfg.stream_capture) {
+    return;
+  }
+
+  std::string error;
+  std::string detail;
+  if (cfg.stream_capture_compact) {
+    auto capture = std::make_unique<udp::CompactCaptureWriter>();
+    if (!capture->open(g_state.compact_capture_path, &error)) {
+      LogMessage("ERROR: " + error);
+      return;
+    }
+    g_state.stream_capture = std::move(capture);
+    detail = "compact";
+  } else {
+    auto capture = std::make_unique<udp::StreamCapture>();
+    if (!capture->open(g_state.capture_path, bytes, &error)) {
+      LogMessage("ERROR: " + error);
+      return;
+    }
+    g_state.stream_capture = std::move(capture);
+    detail = std::to_string(cfg.stream_capture_mb) + " MB";
+  }
+  g_state.stream_capture_bytes = bytes;
+  g_state.stream_capture_compact = cfg.stream_capture_compact;
+  udp::CaptureSink *recorder = g_state.stream_capture.get();
+  WithBroadcaster([recorder](udp::UDPBroadcaster &broadcaster) {
+    broadcaster.setCapture(recorder);
+  });
+  LogMessage("Stream capture started: " + recorder->path() + " (" + detail +
+             ")");
+}
+
+// Opens or closes the shared-memory output to match `cfg`.
+void ConfigureSharedOutput(const Settings &cfg) {
+  if (static_cast<bool>(g_state.shared_output) == cfg.shared_output) {
+    return;
+  }
+  if (g_state.shared_output) {
+    g_state.engine.setSharedOutput(nullptr);
+    LogMessage("Shared output closed: " + g_state.shared_output->name());
+    g_state.shared_output.reset();
+    return;
+  }
+
+  auto output = std::make_unique<xp2gdl90::SharedOutput>();
+  std::string error;
+  if (!output->open(kSharedOutputName, &error)) {
+    LogMessage("ERROR: " + error);
+    return;
+  }
+  g_state.shared_output = std::move(output);
+  g_state.engine.setSharedOutput(g_state.shared_output.get());
+  LogMessage("Shared output open: " + g_state.shared_output->name());
+}
+
+void ConfigureSimRecording(const Settings &cfg) {
+  if (static_cast<bool>(g_state.sim_recorder) == cfg.sim_recording) {
+    return;
+  }
+  if (g_state.sim_recorder) {
+    LogMessage("Sim recording stopped: " + g_state.sim_recording_path + " (" +
+               std::to_string(g_state.sim_recorder->ticks()) + " sweeps)");
+    g_state.sim_recorder.reset();
+    return;
+  }
+
+  auto recorder = std::make_unique<xp2gdl90::SimRecorder>();
+  std::string error;
+  if (!recorder->open(g_state.sim_recording_path, &error)) {
+    LogMessage("ERROR: " + error);
+    return;
+  }
+  g_state.sim_recorder = std::move(recorder);
+  LogMessage("Sim recording started: " + g_state.sim_recording_path);
+}
+
+// Opens, retargets or closes the metrics socket to match `cfg`.
+void ConfigureMetricsExporter(const Settings &cfg) {
+  xp2gdl90::MetricsExporter &exporter = g_state.metrics_exporter;
+  const double interval_s = static_cast<double>(cfg.metrics_interval_s);
+  if (!cfg.metrics_enabled) {
+    if (exporter.isOpen()) {
+      exporter.close();
+      LogMessage("Metrics exporter stopped");
+    }
+    return;
+  }
+  if (exporter.isOpen() && exporter.ip() == cfg.metrics_ip &&
+      exporter.port() == cfg.metrics_port &&
+      exporter.intervalS() == interval_s) {
+    return;
+  }
+  std::string error;
+  if (!exporter.open(cfg.metrics_ip, cfg.metrics_port, interval_s, &error)) {
+    g_state.metrics_last_error = error;
+    LogMessage("ERROR: " + error);
+    return;
+  }
+  g_state.metrics_last_error.clear();
+  LogMessage("Metrics exporter sending to " + cfg.metrics_ip + ":" +
+             std::to_string(cfg.metrics_port));
+}
+
+// Adds the tick to the Status tab's sparklines and bandwidth rates.
+void UpdateStatsHistory() {
+  const double now = xp2gdl90::MonotonicSeconds();
+  g_state.engine.updateAccounting(now);
+  g_state.stats_history.recordTick(g_state.stage_timings.lastTickNs());
+  const xp2gdl90::BroadcastStats &stats = g_state.engine.stats();
+  xp2gdl90::StatsCounters counters;
+  counters.frames = stats.packets_sent;
+  counters.bytes = stats.bytes_sent;
+  counters.send_errors = stats.send_errors;
+  counters.targets =
+      static_cast<uint32_t>((std::max)(0, g_state.last_traffic_target_count));
+  g_state.stats_history.update(now, counters);
+}
+
+// Sends the link health report when one is due. Runs after the tick's
+// output is out, so building the report never delays a GDL90 frame.
+void SendMetricsReport(double now, const Settings &cfg) {
+  xp2gdl90::MetricsExporter &exporter = g_state.metrics_exporter;
+  if (!exporter.due(now)) {
+    return;
+  }
+  xp2gdl90::MetricsReport &report = exporter.begin(cfg.device_name, now);
+  const xp2gdl90::BroadcastStats &engine_stats = g_state.engine.stats();
+  report.counter("packets.heartbeat", g_state.heartbeat_packets_sent);
+  report.counter("packets.ownship", g_state.position_packets_sent);
+  report.counter("packets.traffic", engine_stats.traffic_packets_sent);
+  report.counter("packets.device_info", g_state.device_info_packets_sent);
+  report.counter("packets.ahrs", g_state.ahrs_packets_sent);
+  report.counter("packets.geo_altitude", g_state.geo_altitude_packets_sent);
+  report.counter("bytes_sent", engine_stats.bytes_sent);
+  report.counter("send_errors", engine_stats.send_errors);
+  report.counter("flight_loop_calls", g_state.flight_loop_calls);
+  xp2gdl90::AddSendIntervalMetrics(g_state.send_intervals, &report);
+
+  // Without the sender thread the queues stay empty and nothing drops.
+  const udp::NetworkSenderStats sender = g_state.engine.sender()
+                                             ? g_state.engine.sender()->stats()
+                                             : udp::NetworkSenderStats{};
+  report.counter("drops.traffic_oldest", sender.traffic_dropped_oldest);
+  report.counter("drops.traffic_newest", sender.traffic_dropped_newest);
+  report.counter("drops.priority", sender.priority_overflows);
+  report.gauge("queue.priority", static_cast<double>(sender.priority_queued));
+  report.gauge("queue.traffic", static_cast<double>(sender.traffic_queued));
+  report.gauge("queue.paced_traffic",
+               static_cast<double>(g_state.engine.trafficPacer().pending()));
+  report.gauge("sender.latency_avg_us", sender.averageLatencyUs());
+  report.gauge("sender.wake_avg_us", sender.wake_latency.averageUs());
+  report.gauge("sender.wake_max_us",
+               static_cast<double>(sender.wake_latency.max_us));
+  if (g_state.traffic_worker) {
+    const xp2gdl90::WakeLatencyStats wake =
+        g_state.traffic_worker->wakeLatency();
+    report.gauge("traffic_thread.wake_avg_us", wake.averageUs());
+    report.gauge("traffic_thread.wake_max_us",
+                 static_cast<double>(wake.max_us));
+  }
+
+  report.gauge("traffic.targets",
+               static_cast<double>(g_state.last_traffic_target_count));
+  report.gauge("traffic.tracked",
+               static_cast<double>(g_state.traffic_sweep.tracked));
+#if XP2GDL90_STAGE_TIMING
+  xp2gdl90::AddStageTimingMetrics(g_state.stage_timings, &report);
+#endif
+
+  std::string error;
+  if (exporter.send(&error)) {
+    g_state.metrics_last_error.clear();
+  } else {
+    g_state.metrics_last_error = error;
+  }
+}
+
+// The ForeFlight ID frame and the identity held in the ownship frame are
+// built from settings; the heartbeat and geo-altitude caches rebuild
+// themselves when their bytes change.
+void InvalidateStaticFrames() {
+  g_state.heartbeat_frame.invalidate();
+  g_state.geo_altitude_frame.invalidate();
+  g_state.device_info_frame.invalidate();
+  g_state.ownship_frame.invalidate();
+}
+
 bool ApplyConfigToRuntime(const Settings &new_cfg, std::string *out_error) {
   if (!g_state.broadcaster) {
     if (out_error) {
@@ -856,52 +1311,89 @@ bool ApplyConfigToRuntime(const Settings &new_cfg, std::string *out_error) {
     return false;
   }
 
-  g_state.settings = new_cfg;
-  RefreshBroadcastTarget(g_state.broadcast_clock_time, g_state.settings);
+  g_state.settings.publish(new_cfg);
+  const SettingsSnapshot settings = CurrentSettings();
+  InvalidateStaticFrames();
+  ConfigureNetworkSender(*settings);
+  ConfigureTrafficWorker(*settings);
+  ConfigureStreamCapture(*settings);
+  ConfigureSharedOutput(*settings);
+  ConfigureSimRecording(*settings);
+  ConfigureMetricsExporter(*settings);
+  ApplyExtraDestinations(*settings);
+  RefreshBroadcastTarget(g_state.broadcast_clock_time, *settings);
   return true;
 }
 
-gdl90::PositionData GetOwnshipData(const Settings &cfg) {
+FrameContext ReadFrameContext(double broadcast_time) {
+  XP2GDL90_STAGE_TIMER(&g_state.stage_timings, xp2gdl90::Stage::SIM_READ);
+  FrameContext frame;
+  frame.broadcast_time = broadcast_time;
+  frame.latitude = XPLMGetDatad(g_state.lat_ref);
+  frame.longitude = XPLMGetDatad(g_state.lon_ref);
+  frame.gps_valid = xp2gdl90::protocol::HasValidOwnshipPosition(
+      frame.latitude, frame.longitude);
+  frame.geometric_altitude_m = XPLMGetDatad(g_state.alt_ref);
+  if (g_state.pressure_alt_ref) {
+    frame.pressure_altitude_ft = XPLMGetDatad(g_state.pressure_alt_ref);
+  }
+  frame.ground_speed_mps = XPLMGetDataf(g_state.speed_ref);
+  frame.vertical_speed_fpm = XPLMGetDataf(g_state.vs_ref);
+  frame.track_deg = XPLMGetDataf(g_state.track_ref);
+  frame.on_ground = XPLMGetDatai(g_state.airborne_ref) != 0;
+  if (g_state.roll_ref) {
+    frame.roll_deg = XPLMGetDataf(g_state.roll_ref);
+  }
+  if (g_state.pitch_ref) {
+    frame.pitch_deg = XPLMGetDataf(g_state.pitch_ref);
+  }
+  if (g_state.heading_ref) {
+    frame.heading_deg = XPLMGetDataf(g_state.heading_ref);
+  }
+  if (g_state.indicated_airspeed_ref) {
+    frame.indicated_airspeed_kt = XPLMGetDataf(g_state.indicated_airspeed_ref);
+  }
+  if (g_state.true_airspeed_ref) {
+    frame.true_airspeed_kt = XPLMGetDataf(g_state.true_airspeed_ref);
+  }
+  frame.tail_number = ReadTailNumber();
+  return frame;
+}
+
+gdl90::PositionData GetOwnshipData(const Settings &cfg,
+                                   const FrameContext &frame) {
   gdl90::PositionData data;
 
-  const double latitude = XPLMGetDatad(g_state.lat_ref);
-  const double longitude = XPLMGetDatad(g_state.lon_ref);
-  const bool gps_valid =
-      xp2gdl90::protocol::HasValidOwnshipPosition(latitude, longitude);
-  data.latitude = gps_valid ? latitude : 0.0;
-  data.longitude = gps_valid ? longitude : 0.0;
+  data.latitude = frame.gps_valid ? frame.latitude : 0.0;
+  data.longitude = frame.gps_valid ? frame.longitude : 0.0;
 
-  if (g_state.pressure_alt_ref) {
-    data.altitude =
-        ClampFloatToInt<int32_t>(XPLMGetDatad(g_state.pressure_alt_ref));
+  if (std::isfinite(frame.pressure_altitude_ft)) {
+    data.altitude = ClampFloatToInt<int32_t>(frame.pressure_altitude_ft);
   } else {
     data.altitude = std::numeric_limits<int32_t>::min();
   }
 
-  const float speed_ms = XPLMGetDataf(g_state.speed_ref);
-  data.h_velocity =
-      ClampFloatToInt<uint16_t>(speed_ms * kMetersPerSecondToKnots);
+  data.h_velocity = ClampFloatToInt<uint16_t>(frame.ground_speed_mps *
+                                              kMetersPerSecondToKnots);
 
-  data.v_velocity = ClampFpmToInt16OrInvalid(XPLMGetDataf(g_state.vs_ref));
+  data.v_velocity = ClampFpmToInt16OrInvalid(frame.vertical_speed_fpm);
 
-  data.track = NormalizeDegreesToUint16(XPLMGetDataf(g_state.track_ref));
+  data.track = NormalizeDegreesToUint16(frame.track_deg);
   data.track_type = gdl90::TrackType::TRUE_TRACK;
 
-  const int on_ground = XPLMGetDatai(g_state.airborne_ref);
-  data.airborne = (on_ground == 0);
+  data.airborne = !frame.on_ground;
 
   data.icao_address = cfg.icao_address;
 
-  const std::string tail_number =
-      xp2gdl90::protocol::SanitizeCallsign(ReadTailNumber());
-  const std::string fallback_callsign =
-      xp2gdl90::protocol::SanitizeCallsign(cfg.callsign);
-  data.callsign = tail_number.empty() ? fallback_callsign : tail_number;
+  data.callsign = xp2gdl90::protocol::MakeCallsign(frame.tail_number);
+  if (data.callsign.empty()) {
+    data.callsign = xp2gdl90::protocol::MakeCallsign(cfg.callsign);
+  }
 
   data.emitter_category =
       static_cast<gdl90::EmitterCategory>(cfg.emitter_category);
   data.address_type = gdl90::AddressType::ADSB_ICAO;
-  data.nic = gps_valid ? cfg.nic : 0;
+  data.nic = frame.gps_valid ? cfg.nic : 0;
   data.nacp = cfg.nacp;
   data.alert_status = 0;
   data.emergency_code = 0;
@@ -909,25 +1401,26 @@ gdl90::PositionData GetOwnshipData(const Settings &cfg) {
   return data;
 }
 
-gdl90::foreflight::DeviceInfo GetForeFlightDeviceInfo() {
+gdl90::foreflight::DeviceInfo GetForeFlightDeviceInfo(const Settings &cfg) {
   gdl90::foreflight::DeviceInfo data;
   data.serial_number = gdl90::foreflight::DEVICE_SERIAL_INVALID;
-  data.device_name = g_state.settings.device_name;
-  data.device_long_name = g_state.settings.device_long_name;
+  data.device_name = cfg.device_name;
+  data.device_long_name = cfg.device_long_name;
   data.capabilities_mask =
       0x01u |
-      (static_cast<uint32_t>(g_state.settings.internet_policy & 0x03u) << 1);
+      (static_cast<uint32_t>(cfg.internet_policy & 0x03u) << 1);
   return data;
 }
 
-gdl90::foreflight::AhrsData GetOwnshipAhrsData() {
+gdl90::foreflight::AhrsData GetOwnshipAhrsData(const FrameContext &frame,
+                                               const Settings &cfg) {
   gdl90::foreflight::AhrsData data;
-  data.roll_deg = g_state.roll_ref ? XPLMGetDataf(g_state.roll_ref) : NAN;
-  data.pitch_deg = g_state.pitch_ref ? XPLMGetDataf(g_state.pitch_ref) : NAN;
-  if (g_state.heading_ref) {
-    double heading_deg = NormalizeDegrees360(
-        static_cast<double>(XPLMGetDataf(g_state.heading_ref)));
-    if (g_state.settings.ahrs_use_magnetic_heading &&
+  data.roll_deg = frame.roll_deg;
+  data.pitch_deg = frame.pitch_deg;
+  if (std::isfinite(frame.heading_deg)) {
+    double heading_deg =
+        NormalizeDegrees360(static_cast<double>(frame.heading_deg));
+    if (cfg.ahrs_use_magnetic_heading &&
         std::isfinite(heading_deg)) {
       heading_deg = NormalizeDegrees360(static_cast<double>(
           XPLMDegTrueToDegMagnetic(static_cast<float>(heading_deg))));
@@ -936,35 +1429,97 @@ gdl90::foreflight::AhrsData GetOwnshipAhrsData() {
   } else {
     data.heading_deg = std::numeric_limits<double>::quiet_NaN();
   }
-  data.magnetic_heading = g_state.settings.ahrs_use_magnetic_heading;
-  data.indicated_airspeed = g_state.indicated_airspeed_ref
-                                ? ClampKnotsToUint16OrInvalid(XPLMGetDataf(
-                                      g_state.indicated_airspeed_ref))
-                                : gdl90::foreflight::AHRS_AIRSPEED_INVALID;
-  data.true_airspeed =
-      g_state.true_airspeed_ref
-          ? ClampKnotsToUint16OrInvalid(XPLMGetDataf(g_state.true_airspeed_ref))
-          : gdl90::foreflight::AHRS_AIRSPEED_INVALID;
+  data.magnetic_heading = cfg.ahrs_use_magnetic_heading;
+  data.indicated_airspeed =
+      ClampKnotsToUint16OrInvalid(frame.indicated_airspeed_kt);
+  data.true_airspeed = ClampKnotsToUint16OrInvalid(frame.true_airspeed_kt);
   return data;
 }
 
-gdl90::GeoAltitudeData GetOwnshipGeoAltitudeData() {
+gdl90::GeoAltitudeData
+GetOwnshipGeoAltitudeData(const FrameContext &frame) {
   gdl90::GeoAltitudeData data;
-  const double altitude_meters = XPLMGetDatad(g_state.alt_ref);
   data.altitude_feet =
-      ClampFloatToInt<int32_t>(altitude_meters * kMetersToFeet);
+      ClampFloatToInt<int32_t>(frame.geometric_altitude_m * kMetersToFeet);
   data.vertical_warning = false;
   data.vfom_meters = gdl90::GEO_ALTITUDE_VFOM_INVALID;
   return data;
 }
 
+XPLMDataRef FindDataRef(const char *name) {
+  return g_state.dataref_cache.find(name);
+}
+
+// Looks up the ownship refs, which every tick needs. Returns false if a
+// required one is missing.
+bool ResolveOwnshipDataRefs() {
+  g_state.lat_ref = FindDataRef("sim/flightmodel/position/latitude");
+  g_state.lon_ref = FindDataRef("sim/flightmodel/position/longitude");
+  g_state.alt_ref = FindDataRef("sim/flightmodel/position/elevation");
+  g_state.pressure_alt_ref =
+      FindDataRef("sim/flightmodel2/position/pressure_altitude");
+  g_state.speed_ref = FindDataRef("sim/flightmodel/position/groundspeed");
+  g_state.track_ref = FindDataRef("sim/flightmodel/position/true_psi");
+  g_state.pitch_ref = FindDataRef("sim/flightmodel/position/theta");
+  g_state.roll_ref = FindDataRef("sim/flightmodel/position/phi");
+  g_state.heading_ref = FindDataRef("sim/flightmodel/position/psi");
+  g_state.indicated_airspeed_ref =
+      FindDataRef("sim/flightmodel/position/indicated_airspeed");
+  g_state.true_airspeed_ref =
+      FindDataRef("sim/flightmodel/position/true_airspeed");
+  g_state.vs_ref = FindDataRef("sim/flightmodel/position/vh_ind_fpm");
+  g_state.airborne_ref = FindDataRef("sim/flightmodel/failures/onground_any");
+  g_state.sim_time_ref = FindDataRef("sim/time/total_flight_time_sec");
+  g_state.replay_ref = FindDataRef("sim/time/is_in_replay");
+  g_state.tailnum_ref = FindDataRef("sim/aircraft/view/acf_tailnum");
+
+  bool datarefs_ok = true;
+  datarefs_ok &=
+      VerifyDataRef(g_state.lat_ref, "sim/flightmodel/position/latitude");
+  datarefs_ok &=
+      VerifyDataRef(g_state.lon_ref, "sim/flightmodel/position/longitude");
+  datarefs_ok &=
+      VerifyDataRef(g_state.alt_ref, "sim/flightmodel/position/elevation");
+  datarefs_ok &=
+      VerifyDataRef(g_state.speed_ref, "sim/flightmodel/position/groundspeed");
+  datarefs_ok &=
+      VerifyDataRef(g_state.track_ref, "sim/flightmodel/position/true_psi");
+  datarefs_ok &=
+      VerifyDataRef(g_state.pitch_ref, "sim/flightmodel/position/theta");
+  datarefs_ok &=
+      VerifyDataRef(g_state.roll_ref, "sim/flightmodel/position/phi");
+  datarefs_ok &=
+      VerifyDataRef(g_state.heading_ref, "sim/flightmodel/position/psi");
+  datarefs_ok &=
+      VerifyDataRef(g_state.vs_ref, "sim/flightmodel/position/vh_ind_fpm");
+  datarefs_ok &= VerifyDataRef(g_state.airborne_ref,
+                               "sim/flightmodel/failures/onground_any");
+  datarefs_ok &=
+      VerifyDataRef(g_state.sim_time_ref, "sim/time/total_flight_time_sec");
+
+  if (!datarefs_ok) {
+    LogMessage("ERROR: Failed to find required datarefs");
+    return false;
+  }
+
+  if (g_state.pressure_alt_ref) {
+    LogMessage("Using pressure altitude dataref for Ownship Report altitude");
+  } else {
+    LogMessage("Pressure altitude dataref unavailable; Ownship Report altitude "
+               "will be sent invalid");
+  }
+
+  return true;
+}
+
 void InitializeTrafficDataRefs() {
   g_state.traffic_tcas_refs = {};
   g_state.legacy_traffic_refs.clear();
   g_state.traffic_text_refs.clear();
+  g_state.traffic_identities.clear();
 
   g_state.traffic_tcas_refs.mode_s_ref =
-      XPLMFindDataRef("sim/cockpit2/tcas/targets/modeS_id");
+      FindDataRef("sim/cockpit2/tcas/targets/modeS_id");
   if (g_state.traffic_tcas_refs.mode_s_ref) {
     const int array_size =
         XPLMGetDatavi(g_state.traffic_tcas_refs.mode_s_ref, nullptr, 0, 0);
@@ -976,67 +1531,71 @@ void InitializeTrafficDataRefs() {
 
   if (g_state.traffic_tcas_refs.slot_count > 0) {
     g_state.traffic_tcas_refs.mode_c_code_ref =
-        XPLMFindDataRef("sim/cockpit2/tcas/targets/modeC_code");
+        FindDataRef("sim/cockpit2/tcas/targets/modeC_code");
     g_state.traffic_tcas_refs.ssr_mode_ref =
-        XPLMFindDataRef("sim/cockpit2/tcas/targets/ssr_mode");
+        FindDataRef("sim/cockpit2/tcas/targets/ssr_mode");
     g_state.traffic_tcas_refs.flight_id_ref =
-        XPLMFindDataRef("sim/cockpit2/tcas/targets/flight_id");
+        FindDataRef("sim/cockpit2/tcas/targets/flight_id");
     g_state.traffic_tcas_refs.x_ref =
-        XPLMFindDataRef("sim/cockpit2/tcas/targets/position/x");
+        FindDataRef("sim/cockpit2/tcas/targets/position/x");
     g_state.traffic_tcas_refs.y_ref =
-        XPLMFindDataRef("sim/cockpit2/tcas/targets/position/y");
+        FindDataRef("sim/cockpit2/tcas/targets/position/y");
     g_state.traffic_tcas_refs.z_ref =
-        XPLMFindDataRef("sim/cockpit2/tcas/targets/position/z");
+        FindDataRef("sim/cockpit2/tcas/targets/position/z");
     g_state.traffic_tcas_refs.vx_ref =
-        XPLMFindDataRef("sim/cockpit2/tcas/targets/position/vx");
+        FindDataRef("sim/cockpit2/tcas/targets/position/vx");
     g_state.traffic_tcas_refs.vy_ref =
-        XPLMFindDataRef("sim/cockpit2/tcas/targets/position/vy");
+        FindDataRef("sim/cockpit2/tcas/targets/position/vy");
     g_state.traffic_tcas_refs.vz_ref =
-        XPLMFindDataRef("sim/cockpit2/tcas/targets/position/vz");
+        FindDataRef("sim/cockpit2/tcas/targets/position/vz");
     g_state.traffic_tcas_refs.vertical_speed_ref =
-        XPLMFindDataRef("sim/cockpit2/tcas/targets/position/vertical_speed");
+        FindDataRef("sim/cockpit2/tcas/targets/position/vertical_speed");
     g_state.traffic_tcas_refs.heading_ref =
-        XPLMFindDataRef("sim/cockpit2/tcas/targets/position/psi");
+        FindDataRef("sim/cockpit2/tcas/targets/position/psi");
     g_state.traffic_tcas_refs.weight_on_wheels_ref =
-        XPLMFindDataRef("sim/cockpit2/tcas/targets/position/weight_on_wheels");
+        FindDataRef("sim/cockpit2/tcas/targets/position/weight_on_wheels");
     g_state.traffic_tcas_refs.wake_cat_ref =
-        XPLMFindDataRef("sim/cockpit2/tcas/targets/wake/wake_cat");
+        FindDataRef("sim/cockpit2/tcas/targets/wake/wake_cat");
   }
 
-  for (size_t slot = 1;; ++slot) {
-    char buffer[128] = {};
-    LegacyTrafficRefs refs;
-
-    std::snprintf(buffer, sizeof(buffer), "sim/multiplayer/position/plane%zu_x",
-                  slot);
-    refs.x_ref = XPLMFindDataRef(buffer);
-    if (!refs.x_ref) {
-      break;
-    }
+  // X-Plane mirrors the multiplayer planes into the TCAS arrays, so the
+  // seven per-slot legacy lookups are only worth making without them.
+  if (!g_state.traffic_tcas_refs.IsUsable()) {
+    for (size_t slot = 1;; ++slot) {
+      char buffer[128] = {};
+      LegacyTrafficRefs refs;
 
-    std::snprintf(buffer, sizeof(buffer), "sim/multiplayer/position/plane%zu_y",
-                  slot);
-    refs.y_ref = XPLMFindDataRef(buffer);
-    std::snprintf(buffer, sizeof(buffer), "sim/multiplayer/position/plane%zu_z",
-                  slot);
-    refs.z_ref = XPLMFindDataRef(buffer);
-    std::snprintf(buffer, sizeof(buffer),
-                  "sim/multiplayer/position/plane%zu_v_x", slot);
-    refs.vx_ref = XPLMFindDataRef(buffer);
-    std::snprintf(buffer, sizeof(buffer),
-                  "sim/multiplayer/position/plane%zu_v_y", slot);
-    refs.vy_ref = XPLMFindDataRef(buffer);
-    std::snprintf(buffer, sizeof(buffer),
-                  "sim/multiplayer/position/plane%zu_v_z", slot);
-    refs.vz_ref = XPLMFindDataRef(buffer);
-    std::snprintf(buffer, sizeof(buffer),
-                  "sim/multiplayer/position/plane%zu_psi", slot);
-    refs.heading_ref = XPLMFindDataRef(buffer);
+      std::snprintf(buffer, sizeof(buffer),
+                    "sim/multiplayer/position/plane%zu_x", slot);
+      refs.x_ref = FindDataRef(buffer);
+      if (!refs.x_ref) {
+        break;
+      }
 
-    if (!refs.IsUsable()) {
-      break;
+      std::snprintf(buffer, sizeof(buffer),
+                    "sim/multiplayer/position/plane%zu_y", slot);
+      refs.y_ref = FindDataRef(buffer);
+      std::snprintf(buffer, sizeof(buffer),
+                    "sim/multiplayer/position/plane%zu_z", slot);
+      refs.z_ref = FindDataRef(buffer);
+      std::snprintf(buffer, sizeof(buffer),
+                    "sim/multiplayer/position/plane%zu_v_x", slot);
+      refs.vx_ref = FindDataRef(buffer);
+      std::snprintf(buffer, sizeof(buffer),
+                    "sim/multiplayer/position/plane%zu_v_y", slot);
+      refs.vy_ref = FindDataRef(buffer);
+      std::snprintf(buffer, sizeof(buffer),
+                    "sim/multiplayer/position/plane%zu_v_z", slot);
+      refs.vz_ref = FindDataRef(buffer);
+      std::snprintf(buffer, sizeof(buffer),
+                    "sim/multiplayer/position/plane%zu_psi", slot);
+      refs.heading_ref = FindDataRef(buffer);
+
+      if (!refs.IsUsable()) {
+        break;
+      }
+      g_state.legacy_traffic_refs.push_back(refs);
     }
-    g_state.legacy_traffic_refs.push_back(refs);
   }
 
   const size_t text_slots = (std::max)(g_state.traffic_tcas_refs.slot_count,
@@ -1046,7 +1605,7 @@ void InitializeTrafficDataRefs() {
     char buffer[128] = {};
     std::snprintf(buffer, sizeof(buffer),
                   "sim/multiplayer/position/plane%zu_tailnum", slot);
-    g_state.traffic_text_refs[slot - 1].tailnum_ref = XPLMFindDataRef(buffer);
+    g_state.traffic_text_refs[slot - 1].tailnum_ref = FindDataRef(buffer);
   }
 
   std::ostringstream message;
@@ -1056,111 +1615,389 @@ void InitializeTrafficDataRefs() {
   LogMessage(message.str());
 }
 
-size_t CollectTrafficData(const Settings &cfg,
-                          std::vector<gdl90::PositionData> *out_reports) {
-  if (!out_reports || !cfg.traffic_enabled || cfg.traffic_max_targets == 0) {
-    return 0;
+// Sessions without traffic never pay for the TCAS and multiplayer lookups.
+void EnsureTrafficDataRefs() {
+  if (!g_state.traffic_refs_resolved) {
+    InitializeTrafficDataRefs();
+    g_state.traffic_refs_resolved = true;
   }
+}
 
+// Appends this sweep's ownship sample and TCAS arrays to the sim recording.
+// A failed write stops the recording.
+void RecordSimTick(const FrameContext &frame,
+                   const xp2gdl90::traffic::ProjectionAnchor *anchor,
+                   const xp2gdl90::traffic::TrafficSnapshot &snapshot) {
+  if (!g_state.sim_recorder) {
+    return;
+  }
+  xp2gdl90::OwnshipSample ownship;
+  ownship.broadcast_time = frame.broadcast_time;
+  ownship.latitude = frame.latitude;
+  ownship.longitude = frame.longitude;
+  ownship.geometric_altitude_m = frame.geometric_altitude_m;
+  ownship.pressure_altitude_ft = frame.pressure_altitude_ft;
+  ownship.ground_speed_mps = frame.ground_speed_mps;
+  ownship.vertical_speed_fpm = frame.vertical_speed_fpm;
+  ownship.track_deg = frame.track_deg;
+  ownship.roll_deg = frame.roll_deg;
+  ownship.pitch_deg = frame.pitch_deg;
+  ownship.heading_deg = frame.heading_deg;
+  ownship.indicated_airspeed_kt = frame.indicated_airspeed_kt;
+  ownship.true_airspeed_kt = frame.true_airspeed_kt;
+  ownship.gps_valid = frame.gps_valid;
+  ownship.on_ground = frame.on_ground;
+  ownship.tail_number = xp2gdl90::protocol::MakeCallsign(frame.tail_number);
+  if (!g_state.sim_recorder->append(
+          ownship, anchor, g_state.traffic_tcas_refs.ssr_mode_ref != nullptr,
+          snapshot)) {
+    LogMessage("ERROR: Sim recording write failed: " +
+               g_state.sim_recording_path);
+    g_state.sim_recorder.reset();
+  }
+}
+
+// Selects the nearest legacy multiplayer targets into *out_reports.
+void CollectLegacyTraffic(const Settings &cfg, const FrameContext &frame,
+                          const xp2gdl90::traffic::TrafficSelection &selection,
+                          std::vector<gdl90::PositionData> *out_reports) {
   out_reports->clear();
-
-  if (g_state.traffic_tcas_refs.IsUsable()) {
-    const size_t max_slots =
-        (std::min)(g_state.traffic_tcas_refs.slot_count,
-                   static_cast<size_t>(cfg.traffic_max_targets));
-    out_reports->reserve(max_slots);
-    for (size_t slot = 1; slot <= max_slots; ++slot) {
-      gdl90::PositionData report{};
-      if (BuildTrafficReportFromTcasSlot(cfg, slot, &report)) {
-        out_reports->push_back(report);
-      }
+  std::vector<xp2gdl90::traffic::TrafficCandidate> &candidates =
+      g_state.traffic_candidates;
+  candidates.clear();
+
+  // Legacy datarefs carry no ownship row, so range comes from the converted
+  // reports against the frame's position.
+  std::vector<gdl90::PositionData> &legacy_reports =
+      g_state.legacy_traffic_reports;
+  legacy_reports.clear();
+  for (size_t slot = 1; slot <= g_state.legacy_traffic_refs.size(); ++slot) {
+    gdl90::PositionData report{};
+    if (BuildTrafficReportFromLegacySlot(cfg, frame, slot, &report)) {
+      legacy_reports.push_back(report);
     }
   }
 
-  if (!out_reports->empty() || g_state.legacy_traffic_refs.empty()) {
-    return out_reports->size();
+  xp2gdl90::traffic::TrafficReference ownship;
+  ownship.latitude_deg = frame.latitude;
+  ownship.longitude_deg = frame.longitude;
+  // Legacy reports carry pressure-corrected altitude when it is available.
+  ownship.altitude_ft = std::isfinite(frame.pressure_altitude_ft)
+                            ? frame.pressure_altitude_ft
+                            : frame.geometric_altitude_m * kMetersToFeet;
+  ownship.vx = NAN;
+  ownship.vz = NAN;
+  for (size_t i = 0; i < legacy_reports.size(); ++i) {
+    const gdl90::PositionData &report = legacy_reports[i];
+    xp2gdl90::traffic::TrafficCandidate candidate;
+    if (xp2gdl90::traffic::MeasureGeodeticTarget(
+            static_cast<uint32_t>(i), ownship, report.latitude,
+            report.longitude, report.altitude, NAN, NAN, &candidate)) {
+      candidates.push_back(candidate);
+    }
   }
-
-  const size_t max_slots =
-      (std::min)(g_state.legacy_traffic_refs.size(),
-                 static_cast<size_t>(cfg.traffic_max_targets));
-  out_reports->reserve(max_slots);
-  for (size_t slot = 1; slot <= max_slots; ++slot) {
-    gdl90::PositionData report{};
-    if (BuildTrafficReportFromLegacySlot(cfg, slot, &report)) {
-      out_reports->push_back(report);
+  xp2gdl90::traffic::SelectNearestTraffic(selection, &candidates);
+  out_reports->reserve(candidates.size());
+  for (const xp2gdl90::traffic::TrafficCandidate &candidate : candidates) {
+    out_reports->push_back(legacy_reports[candidate.row]);
+  }
+}
+
+// Sends one framed message to the destinations its class routes to.
+int SendMessage(const uint8_t *data, size_t size, uint32_t message_class,
+                bool leading = false) {
+  XP2GDL90_STAGE_TIMER(&g_state.stage_timings, xp2gdl90::Stage::SEND);
+  return g_state.engine.sendMessage(data, size, message_class, leading);
+}
+int SendMessage(const gdl90::FrameRef &frame, uint32_t message_class) {
+  XP2GDL90_STAGE_TIMER(&g_state.stage_timings, xp2gdl90::Stage::SEND);
+  return g_state.engine.sendMessage(frame, message_class);
+}
+
+// Ends the tick: flushes the packer, or wakes the sender thread and picks up
+// any errors it reported since the last tick.
+void FlushPackedDatagrams() {
+  XP2GDL90_STAGE_TIMER(&g_state.stage_timings, xp2gdl90::Stage::SEND);
+  g_state.engine.flush();
+}
+
+// Time a frame spends between the flight loop and the wire, as measured by
+// the sender thread. Frames sent inline leave within the tick.
+double SenderLeadSeconds() { return g_state.engine.senderLeadSeconds(); }
+
+// The parts of a sweep that come from the settings and the frame; the
+// anchor is filled where the arrays are read.
+xp2gdl90::traffic::TrafficSweepParams
+MakeTrafficSweepParams(const Settings &cfg, const FrameContext &frame) {
+  const float sweep_rate = TrafficSweepRate(cfg);
+  xp2gdl90::traffic::TrafficSweepParams params;
+  params.broadcast_time = frame.broadcast_time;
+  params.selection = xp2gdl90::traffic::MakeTrafficSelection(cfg);
+  params.context.nic = cfg.nic;
+  params.context.nacp = cfg.nacp;
+  params.context.ownship_address = cfg.icao_address;
+  params.context.has_ssr_mode =
+      g_state.traffic_tcas_refs.ssr_mode_ref != nullptr;
+  params.context.ownship_geometric_ft =
+      frame.geometric_altitude_m * kMetersToFeet;
+  params.context.ownship_pressure_ft = frame.pressure_altitude_ft;
+  params.smoothing = cfg.traffic_smoothing;
+  params.adaptive_rate = cfg.traffic_adaptive_rate;
+  params.rate_policy = xp2gdl90::traffic::MakeTrafficRatePolicy(cfg);
+  const double track = frame.track_deg * kDegreesToRadians;
+  params.ownship.latitude_deg = frame.latitude;
+  params.ownship.longitude_deg = frame.longitude;
+  params.ownship.altitude_ft = frame.geometric_altitude_m * kMetersToFeet;
+  params.ownship.vx = frame.ground_speed_mps * std::sin(track);
+  params.ownship.vz = -frame.ground_speed_mps * std::cos(track);
+  params.sweep_interval_s = 1.0 / sweep_rate;
+  params.stale_after_s = kTrafficStaleSweeps / sweep_rate;
+  params.pacing_window_s =
+      cfg.traffic_pacing ? udp::TRAFFIC_PACING_WINDOW_FRACTION / sweep_rate
+                         : 0.0;
+  params.extrapolation_horizon_s = cfg.extrapolation_horizon_s;
+  // The arrays are read this tick, so the lead is only the wait for the
+  // report's pacing slot and the sender queue.
+  params.lead_s = SenderLeadSeconds();
+  return params;
+}
+
+// Sweeps traffic on the simulator thread into g_state.traffic_sweep.
+void SweepTrafficInline(const Settings &cfg, const FrameContext &frame,
+                        xp2gdl90::traffic::TrafficSweepParams params) {
+  XP2GDL90_STAGE_TIMER(&g_state.stage_timings, xp2gdl90::Stage::TRAFFIC);
+  std::vector<gdl90::PositionData> &reports = g_state.traffic_reports;
+  reports.clear();
+  if (cfg.traffic_enabled && cfg.traffic_max_targets > 0) {
+    EnsureTrafficDataRefs();
+    if (g_state.traffic_tcas_refs.IsUsable()) {
+      xp2gdl90::traffic::TrafficSnapshot &snapshot = g_state.traffic_snapshot;
+      // Slot 0 is the user aircraft, followed by slot_count targets. Every
+      // slot is read so the nearest targets win, not the lowest slots.
+      ReadTcasTrafficSnapshot(g_state.traffic_tcas_refs.slot_count + 1,
+                              cfg.icao_address, frame.broadcast_time,
+                              &snapshot);
+      const bool anchored =
+          (cfg.traffic_position_mode == 1 || g_state.sim_recorder) &&
+          MakeTcasProjectionAnchor(snapshot, &params.anchor);
+      RecordSimTick(frame, anchored ? &params.anchor : nullptr, snapshot);
+      params.anchored = anchored && cfg.traffic_position_mode == 1;
+      params.projection_radius_m = cfg.traffic_projection_radius_nm *
+                                   xp2gdl90::traffic::METERS_PER_NAUTICAL_MILE;
+      params.context.local_to_world = LocalPositionToWorld;
+      g_state.traffic_sweeper.sweep(params, &snapshot, &g_state.traffic_sweep);
+      return;
     }
+    CollectLegacyTraffic(cfg, frame, params.selection, &reports);
+  }
+  g_state.traffic_sweeper.finish(params, &reports, &g_state.traffic_sweep);
+}
+
+// Reads the TCAS arrays into a job for the traffic worker. Returns false if
+// the sweep has to run inline: there is no worker or no usable TCAS, or
+// ownship has no anchor for the projection the worker positions with.
+bool SubmitTrafficSweep(const Settings &cfg, const FrameContext &frame,
+                        xp2gdl90::traffic::TrafficSweepParams params) {
+  xp2gdl90::traffic::TrafficWorker *worker = g_state.traffic_worker.get();
+  if (!worker || !cfg.traffic_enabled || cfg.traffic_max_targets == 0) {
+    return false;
+  }
+  EnsureTrafficDataRefs();
+  if (!g_state.traffic_tcas_refs.IsUsable()) {
+    return false;
+  }
+  XP2GDL90_STAGE_TIMER(&g_state.stage_timings, xp2gdl90::Stage::TRAFFIC);
+  xp2gdl90::traffic::TrafficSweepJob *job = worker->jobSlot();
+  if (!job) {
+    // Still on earlier sweeps; this one is skipped rather than waited for.
+    return true;
+  }
+  ReadTcasTrafficSnapshot(g_state.traffic_tcas_refs.slot_count + 1,
+                          cfg.icao_address, frame.broadcast_time,
+                          &job->snapshot);
+  if (!MakeTcasProjectionAnchor(job->snapshot, &params.anchor)) {
+    return false;
   }
+  RecordSimTick(frame, &params.anchor, job->snapshot);
+  params.anchored = true;
+  params.projection_radius_m = cfg.traffic_projection_radius_nm *
+                               xp2gdl90::traffic::METERS_PER_NAUTICAL_MILE;
+  // The worker cannot call XPLMLocalToWorld, so targets past the radius are
+  // converted exactly here.
+  xp2gdl90::traffic::ConvertDistantTcasTraffic(
+      params.anchor, params.projection_radius_m, LocalPositionToWorld,
+      &job->snapshot);
+  // Frames go out once a later flight loop picks the sweep up.
+  params.lead_s += g_state.traffic_worker_lag_s;
+  params.reset_tracks = g_state.traffic_worker_reset;
+  g_state.traffic_worker_reset = false;
+  // The table changes before the worker gets to the job.
+  job->relayed.assign(params.relayed, params.relayed + params.relayed_count);
+  params.relayed = job->relayed.data();
+  job->params = params;
+  worker->submit();
+  return true;
+}
 
-  return out_reports->size();
+// Hands g_state.traffic_sweep to the pacer.
+void StartTrafficSweep(double now) {
+  const xp2gdl90::traffic::TrafficSweepResult &sweep = g_state.traffic_sweep;
+  g_state.engine.startTraffic(sweep.frames, now, sweep.pacing_window_s);
+  g_state.last_traffic_send_bytes = 0;
+  g_state.last_traffic_target_count = static_cast<int>(sweep.target_count);
 }
 
-void SendTrafficReports(float sim_time, const Settings &cfg) {
-  if (!cfg.traffic_enabled || cfg.traffic_rate <= 0.0f ||
-      sim_time - g_state.last_traffic < (1.0f / cfg.traffic_rate)) {
+// Picks up the newest sweep the traffic worker finished, if any.
+void TakeWorkerTrafficSweep(double now) {
+  if (!g_state.traffic_worker ||
+      !g_state.traffic_worker->takeResult(&g_state.traffic_sweep)) {
     return;
   }
+  g_state.traffic_worker_lag_s =
+      (std::max)(0.0, now - g_state.traffic_sweep.broadcast_time);
+  StartTrafficSweep(now);
+}
 
-  std::vector<gdl90::PositionData> reports;
-  const size_t report_count = CollectTrafficData(cfg, &reports);
-
-  int total_bytes = 0;
-  bool saw_error = false;
-  for (const gdl90::PositionData &report : reports) {
-    const auto message = g_state.encoder->createTrafficReport(report);
-    const int sent = g_state.broadcaster->send(message);
-    if (sent >= 0) {
-      total_bytes += sent;
-      g_state.bytes_sent += static_cast<uint64_t>(sent);
-      g_state.traffic_packets_sent++;
-    } else {
-      saw_error = true;
-      g_state.last_send_error = g_state.broadcaster->getLastError();
-    }
+// Takes the reports the relay listener decoded since the last sweep and
+// points `params` at the relayed targets heard from recently.
+void CollectRelayedTraffic(const Settings &cfg, double now,
+                           xp2gdl90::traffic::TrafficSweepParams *params) {
+  xp2gdl90::traffic::TrafficRelayListener *listener =
+      g_state.traffic_relay.get();
+  if (!listener || !cfg.traffic_enabled || cfg.traffic_max_targets == 0) {
+    return;
   }
 
-  g_state.last_traffic_send_bytes = total_bytes;
-  g_state.last_traffic_target_count = static_cast<int>(report_count);
-  if (!saw_error) {
-    g_state.last_send_error.clear();
+  if (!listener->isRunning()) {
+    listener->pollOnce(0);
+  }
+  const uint64_t errors = listener->errorCount();
+  if (errors != g_state.traffic_relay_errors_seen) {
+    g_state.traffic_relay_errors_seen = errors;
+    g_state.last_receiver_error = listener->lastError();
   }
-  g_state.last_traffic = sim_time;
+
+  xp2gdl90::traffic::RelayedTraffic &relayed = g_state.relayed_traffic;
+  relayed.ingest(listener, now);
+  relayed.evictStale(now, xp2gdl90::traffic::TRAFFIC_RELAY_MAX_AGE_S);
+  params->relay_priority =
+      static_cast<xp2gdl90::traffic::RelayPriority>(
+          cfg.traffic_relay_priority);
+  params->relayed = relayed.data();
+  params->relayed_count = relayed.size();
 }
 
-void PollForeFlightDiscovery(float sim_time, const Settings &cfg) {
-  if (!cfg.foreflight_auto_discovery || !g_state.foreflight_receiver) {
+// Returns the bytes encoded this tick; none when the worker has the sweep.
+size_t SendTrafficReports(const FrameContext &frame, const Settings &cfg) {
+  xp2gdl90::traffic::TrafficSweepParams params =
+      MakeTrafficSweepParams(cfg, frame);
+  CollectRelayedTraffic(cfg, frame.broadcast_time, &params);
+  RecordSend(xp2gdl90::SendClass::TRAFFIC, frame.broadcast_time,
+             params.sweep_interval_s);
+  g_state.last_traffic = frame.broadcast_time;
+  if (SubmitTrafficSweep(cfg, frame, params)) {
+    return 0;
+  }
+  SweepTrafficInline(cfg, frame, params);
+  StartTrafficSweep(frame.broadcast_time);
+  return g_state.traffic_sweep.frames.size();
+}
+
+// Applies the message rates and the tick budget to the output scheduler.
+void ConfigureOutputScheduler(const Settings &cfg) {
+  xp2gdl90::OutputScheduler &scheduler = g_state.output_scheduler;
+  scheduler.configure(xp2gdl90::SendClass::HEARTBEAT,
+                      xp2gdl90::PeriodForRate(cfg.heartbeat_rate));
+  // High-rate ownship goes out from OwnshipSamplerCallback() instead.
+  const double ownship_period = xp2gdl90::PeriodForRate(cfg.position_rate);
+  scheduler.configure(xp2gdl90::SendClass::OWNSHIP,
+                      cfg.ownship_high_rate ? 0.0 : ownship_period);
+  g_state.ownship_scheduler.configure(
+      xp2gdl90::SendClass::OWNSHIP,
+      cfg.ownship_high_rate && ownship_period > 0.0
+          ? (std::max)(ownship_period, kOwnshipHighRateMinPeriod)
+          : 0.0);
+  scheduler.configure(xp2gdl90::SendClass::GEO_ALTITUDE,
+                      xp2gdl90::PeriodForRate(cfg.geo_altitude_rate));
+  scheduler.configure(xp2gdl90::SendClass::AHRS,
+                      xp2gdl90::PeriodForRate(cfg.ahrs_rate));
+  scheduler.configure(xp2gdl90::SendClass::DEVICE_INFO,
+                      xp2gdl90::PeriodForRate(cfg.device_info_rate));
+  scheduler.configure(xp2gdl90::SendClass::TRAFFIC,
+                      cfg.traffic_enabled && cfg.traffic_rate > 0.0f
+                          ? 1.0 / TrafficSweepRate(cfg)
+                          : 0.0);
+  xp2gdl90::OutputBudget budget;
+  budget.max_tick_s = cfg.output_budget_ms / 1000.0;
+  budget.max_tick_bytes = cfg.output_budget_bytes;
+  scheduler.setBudget(budget);
+}
+
+// Flight loop return value: seconds until the next message is due, or -1
+// (next frame) when something already is. Never 0, which would stop the
+// callback.
+float NextFlightLoopInterval(double now) {
+  const double deadlines[] = {
+      g_state.output_scheduler.nextRelease(),
+      g_state.engine.trafficPacer().nextDue(),
+      // A sweep on the traffic worker is picked up on the next frame.
+      g_state.traffic_worker && g_state.traffic_worker->busy() ? now : NAN,
+  };
+  const double interval = xp2gdl90::NextWakeInterval(
+      now, deadlines, sizeof(deadlines) / sizeof(deadlines[0]), 0.0,
+      kMaxFlightLoopInterval);
+  g_state.last_flight_loop_interval = interval;
+  return interval > 0.0 ? static_cast<float>(interval) : -1.0f;
+}
+
+// Sends the frames of the current traffic sweep that the pacer has released
+// by `now`. Runs on every flight loop, not only on sweep ticks.
+void SendPacedTraffic(double now) {
+  XP2GDL90_STAGE_TIMER(&g_state.stage_timings, xp2gdl90::Stage::SEND);
+  g_state.last_traffic_send_bytes +=
+      static_cast<int>(g_state.engine.sendPacedTraffic(now));
+}
+
+void PollForeFlightDiscovery(double sim_time, const Settings &cfg) {
+  XP2GDL90_STAGE_TIMER(&g_state.stage_timings, xp2gdl90::Stage::DISCOVERY);
+  xp2gdl90::foreflight::DiscoveryListener *listener =
+      g_state.foreflight_listener.get();
+  if (!cfg.foreflight_auto_discovery || !listener) {
     return;
   }
 
-  while (true) {
-    std::vector<uint8_t> packet;
-    std::string source_ip;
-    uint16_t source_port = 0;
-    const int received =
-        g_state.foreflight_receiver->receive(&packet, &source_ip, &source_port);
-    if (received == 0) {
-      break;
-    }
-    if (received < 0) {
-      g_state.last_receiver_error = g_state.foreflight_receiver->getLastError();
-      break;
-    }
-
-    uint16_t discovered_port = 0;
-    if (!ParseForeFlightBroadcastPacket(packet, &discovered_port)) {
-      continue;
-    }
+  if (!listener->isRunning()) {
+    listener->pollOnce(0);
+  }
+  const uint64_t errors = listener->errorCount();
+  if (errors != g_state.foreflight_errors_seen) {
+    g_state.foreflight_errors_seen = errors;
+    g_state.last_receiver_error = listener->lastError();
+  }
 
-    g_state.discovered_target_ip = source_ip;
-    g_state.discovered_target_port = discovered_port;
-    g_state.last_foreflight_discovery = sim_time;
+  udp::SourceAddress
+      sightings[xp2gdl90::foreflight::DISCOVERY_SIGHTING_CAPACITY];
+  const size_t count = listener->takeSightings(
+      sightings, xp2gdl90::foreflight::DISCOVERY_SIGHTING_CAPACITY);
+  if (count == 0) {
+    return;
+  }
+  g_state.last_foreflight_discovery = sim_time;
+  bool joined = false;
+  for (size_t i = 0; i < count; ++i) {
+    joined = g_state.foreflight_devices.see(sightings[i], sim_time) || joined;
+  }
+  if (joined) {
     RefreshBroadcastTarget(sim_time, cfg);
   }
 }
 
 bool SaveSettingsToDisk(std::string *out_error) {
+  if (g_state.settings_watcher.isRunning()) {
+    return g_state.settings_watcher.save(*CurrentSettings(), out_error);
+  }
   return xp2gdl90::SaveSettingsToJsonFile(g_state.settings_path,
-                                          g_state.settings, out_error);
+                                          *CurrentSettings(), out_error);
 }
 
 bool LoadSettingsFromDisk(Settings *out_settings, std::string *out_error) {
@@ -1168,20 +2005,24 @@ bool LoadSettingsFromDisk(Settings *out_settings, std::string *out_error) {
                                             out_error);
 }
 
-bool ReloadSettingsFromDisk() {
-  Settings loaded = g_state.settings;
-  std::string error;
-  if (!LoadSettingsFromDisk(&loaded, &error)) {
-    if (!error.empty()) {
-      LogMessage("ERROR: Failed to reload settings: " + error);
-      return false;
-    }
-    LogMessage("No settings file found; keeping current settings");
+// Applies one read of the settings file. The first one completes plugin
+// start; later ones are reloads.
+bool ApplySettingsLoad(const xp2gdl90::SettingsLoad &load) {
+  const bool first = !g_state.settings_ready;
+  g_state.settings_ready = true;
+  if (!load.found) {
+    LogMessage(first ? "No settings file found; using GUI defaults"
+                     : "No settings file found; keeping current settings");
     return true;
   }
+  if (!load.ok) {
+    LogMessage(first ? "Warning: Failed to load settings: " + load.error
+                     : "ERROR: Failed to reload settings: " + load.error);
+    return false;
+  }
 
   std::string apply_error;
-  if (!ApplyConfigToRuntime(loaded, &apply_error)) {
+  if (!ApplyConfigToRuntime(load.settings, &apply_error)) {
     LogMessage("ERROR: Failed to apply settings: " + apply_error);
     return false;
   }
@@ -1192,19 +2033,52 @@ bool ReloadSettingsFromDisk() {
     SyncSettingsUiFromConfig();
   }
 
-  LogMessage("Settings reloaded from disk");
+  if (first) {
+    LogMessage("Settings loaded: " + g_state.settings_path);
+    LogMessage(std::string("AHRS heading mode: ") +
+               (load.settings.ahrs_use_magnetic_heading ? "magnetic"
+                                                        : "true"));
+  } else {
+    LogMessage("Settings reloaded from disk");
+  }
   return true;
 }
 
+void ApplyPendingSettingsLoad() {
+  const std::shared_ptr<const xp2gdl90::SettingsLoad> load =
+      g_state.settings_watcher.take();
+  const bool reload = g_state.settings_ready;
+  if (load && !ApplySettingsLoad(*load) && reload) {
+    g_state.settings_last_error = "Failed to reload settings from disk";
+  }
+}
+
+// With the watcher running the read happens on its thread and lands with
+// the next ApplyPendingSettingsLoad().
+bool ReloadSettingsFromDisk() {
+  if (g_state.settings_watcher.isRunning()) {
+    g_state.settings_watcher.requestReload();
+    return true;
+  }
+
+  xp2gdl90::SettingsLoad load;
+  load.settings = *CurrentSettings();
+  load.ok = LoadSettingsFromDisk(&load.settings, &load.error);
+  load.found = load.ok || !load.error.empty();
+  return ApplySettingsLoad(load);
+}
+
 void SyncSettingsUiFromConfig() {
-  xp2gdl90::SyncSettingsUiFromConfig(&g_state.settings_ui, g_state.settings);
+  xp2gdl90::SyncSettingsUiFromConfig(&g_state.settings_ui,
+                                     *CurrentSettings());
   g_state.settings_dirty = false;
   g_state.settings_last_error.clear();
+  g_state.imgui_redraw.invalidate();
 }
 
 bool BuildConfigFromSettingsUi(Settings *out_cfg, std::string *out_error) {
   return xp2gdl90::BuildConfigFromSettingsUi(
-      g_state.settings_ui, g_state.settings, out_cfg, out_error);
+      g_state.settings_ui, *CurrentSettings(), out_cfg, out_error);
 }
 
 ImGuiKey XplmVkeyToImGuiKey(unsigned char vkey) {
@@ -1268,6 +2142,8 @@ void EnsureImGuiInitialized() {
   ImGui::StyleColorsDark();
   ImGui_ImplOpenGL2_Init();
   g_state.imgui_last_time = static_cast<double>(XPLMGetElapsedTime());
+  g_state.imgui_redraw = xp2gdl90::SettingsRedrawPolicy();
+  g_state.imgui_frame_built = false;
   g_state.imgui_initialized = true;
 }
 
@@ -1277,11 +2153,83 @@ void ShutdownImGui() {
   }
   ImGui_ImplOpenGL2_Shutdown();
   ImGui::DestroyContext();
+  g_state.imgui_frame_built = false;
   g_state.imgui_initialized = false;
 }
 
+// Shown while a worker could not take the priority or CPU mask asked for.
+void DrawThreadTuningError(const char *worker, const std::string &error) {
+  if (!error.empty()) {
+    ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s tuning: %s",
+                       worker, error.c_str());
+  }
+}
+
+// What each message class and destination puts on the link.
+void DrawBandwidthAccount(const xp2gdl90::BandwidthAccount &account,
+                          const udp::UDPBroadcaster &broadcaster) {
+  const xp2gdl90::BandwidthRate total = account.total();
+  ImGui::Text("Link load: %.1f frames/s, %.2f kB/s (last %zu s)",
+              total.frames_per_s, total.bytes_per_s / 1000.0,
+              xp2gdl90::BANDWIDTH_WINDOW_SAMPLES);
+  for (size_t i = 0; i < xp2gdl90::MESSAGE_CLASS_COUNT; ++i) {
+    const xp2gdl90::BandwidthRate rate = account.messageClass(i).rate();
+    ImGui::Text("  %s: %.1f frames/s, %.0f B/s",
+                xp2gdl90::MessageClassName(i), rate.frames_per_s,
+                rate.bytes_per_s);
+  }
+  for (size_t i = 0; i < broadcaster.destinationCount(); ++i) {
+    const xp2gdl90::BandwidthRate rate = account.destination(i).rate();
+    ImGui::Text("  %s:%u: %.1f frames/s, %.0f B/s",
+                broadcaster.destinationIp(i).c_str(),
+                static_cast<unsigned int>(broadcaster.destinationPort(i)),
+                rate.frames_per_s, rate.bytes_per_s);
+  }
+}
+
+// The link load the settings being edited would put out, before they
+// apply.
+void DrawBandwidthPlan(const xp2gdl90::BandwidthPlan &plan,
+                       uint32_t limit_bytes_per_s) {
+  ImGui::Text("Planned load: %.1f frames/s, %.2f kB/s, %.2f kB/s with "
+              "UDP/IP headers",
+              plan.total.frames_per_s, plan.total.bytes_per_s / 1000.0,
+              plan.wire_bytes_per_s / 1000.0);
+  for (size_t i = 0; i < xp2gdl90::SEND_CLASS_COUNT; ++i) {
+    const xp2gdl90::BandwidthPlanClass &planned = plan.classes[i];
+    if (planned.frames_per_s <= 0.0) {
+      continue;
+    }
+    ImGui::Text("  %s: %.1f/s x %.1f B, %.0f B/s over all destinations",
+                xp2gdl90::SendClassName(static_cast<xp2gdl90::SendClass>(i)),
+                planned.frames_per_s, planned.frame_bytes,
+                planned.load.bytes_per_s);
+  }
+  for (size_t i = 0; i < plan.destination_count; ++i) {
+    const xp2gdl90::BandwidthPlanDestination &destination =
+        plan.destinations[i];
+    if (destination.over_limit) {
+      ImGui::TextColored(ImVec4(1.0f, 0.8f, 0.2f, 1.0f),
+                         "  Destination %zu: %.0f B/s, over the %u B/s limit",
+                         i, destination.load.bytes_per_s,
+                         static_cast<unsigned int>(limit_bytes_per_s));
+    } else {
+      ImGui::Text("  Destination %zu: %.0f B/s, %.1f datagrams/s", i,
+                  destination.load.bytes_per_s, destination.datagrams_per_s);
+    }
+  }
+  if (plan.destinations_refused > 0) {
+    ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f),
+                       "%zu destinations beyond the first %zu are dropped",
+                       plan.destinations_refused, udp::MAX_DESTINATIONS);
+  }
+}
+
 void DrawSettingsWindowUI() {
-  const Settings &cfg = g_state.settings;
+  // Applying from the window publishes new settings mid-draw; the rest of
+  // this frame keeps showing the ones it started with.
+  const SettingsSnapshot settings = CurrentSettings();
+  const Settings &cfg = *settings;
 
   bool enabled = g_state.enabled;
   if (ImGui::Checkbox("Broadcasting Enabled", &enabled)) {
@@ -1296,30 +2244,30 @@ void DrawSettingsWindowUI() {
   ImGui::Text("Target: %s:%u", g_state.broadcaster->getTargetIp().c_str(),
               static_cast<unsigned int>(g_state.broadcaster->getTargetPort()));
 
-  const float broadcast_time = g_state.broadcast_clock_time;
-  const float since_heartbeat = (g_state.last_heartbeat > 0.0f)
-                                    ? (broadcast_time - g_state.last_heartbeat)
-                                    : 0.0f;
-  const float since_position = (g_state.last_position > 0.0f)
-                                   ? (broadcast_time - g_state.last_position)
-                                   : 0.0f;
-  const float since_traffic = (g_state.last_traffic > 0.0f)
-                                  ? (broadcast_time - g_state.last_traffic)
-                                  : 0.0f;
-  const float since_device_info =
-      (g_state.last_device_info > 0.0f)
+  const double broadcast_time = g_state.broadcast_clock_time;
+  const double since_heartbeat =
+      (g_state.last_heartbeat > 0.0) ? (broadcast_time - g_state.last_heartbeat)
+                                     : 0.0;
+  const double since_position =
+      (g_state.last_position > 0.0) ? (broadcast_time - g_state.last_position)
+                                    : 0.0;
+  const double since_traffic =
+      (g_state.last_traffic > 0.0) ? (broadcast_time - g_state.last_traffic)
+                                   : 0.0;
+  const double since_device_info =
+      (g_state.last_device_info > 0.0)
           ? (broadcast_time - g_state.last_device_info)
-          : 0.0f;
-  const float since_ahrs =
-      (g_state.last_ahrs > 0.0f) ? (broadcast_time - g_state.last_ahrs) : 0.0f;
-  const float since_geo_altitude =
-      (g_state.last_geo_altitude > 0.0f)
+          : 0.0;
+  const double since_ahrs =
+      (g_state.last_ahrs > 0.0) ? (broadcast_time - g_state.last_ahrs) : 0.0;
+  const double since_geo_altitude =
+      (g_state.last_geo_altitude > 0.0)
           ? (broadcast_time - g_state.last_geo_altitude)
-          : 0.0f;
-  const float since_discovery =
-      (g_state.last_foreflight_discovery >= 0.0f)
+          : 0.0;
+  const double since_discovery =
+      (g_state.last_foreflight_discovery >= 0.0)
           ? (broadcast_time - g_state.last_foreflight_discovery)
-          : -1.0f;
+          : -1.0;
 
   const std::string tail = ReadTailNumber();
   const std::string effective_callsign = !tail.empty() ? tail : cfg.callsign;
@@ -1336,6 +2284,9 @@ void DrawSettingsWindowUI() {
       ImGui::Text("Broadcast clock: %s", g_state.broadcast_clock_replay
                                              ? "wall time (replay)"
                                              : "simulator time");
+      ImGui::Text("Flight loop: %llu calls, next wake in %.0f ms",
+                  static_cast<unsigned long long>(g_state.flight_loop_calls),
+                  g_state.last_flight_loop_interval * 1000.0);
       ImGui::Text("Last heartbeat: %.2fs ago | Last position: %.2fs ago",
                   since_heartbeat, since_position);
       ImGui::Text(
@@ -1346,13 +2297,55 @@ void DrawSettingsWindowUI() {
           "Position packets: %llu (%d bytes last)",
           static_cast<unsigned long long>(g_state.position_packets_sent),
           g_state.last_position_send_bytes);
-      ImGui::Text("Traffic source: %s (%zu slots)", GetTrafficSourceName(),
-                  GetTrafficSourceSlotCount());
+      ImGui::Text("Traffic source: %s (%zu slots, %zu tracked)",
+                  GetTrafficSourceName(), GetTrafficSourceSlotCount(),
+                  g_state.traffic_sweep.tracked);
       ImGui::Text(
           "Traffic reports: %llu (%d targets, %d bytes last, %.2fs ago)",
-          static_cast<unsigned long long>(g_state.traffic_packets_sent),
+          static_cast<unsigned long long>(
+              g_state.engine.stats().traffic_packets_sent),
           g_state.last_traffic_target_count, g_state.last_traffic_send_bytes,
           since_traffic);
+      if (cfg.traffic_adaptive_rate) {
+        const xp2gdl90::traffic::TrafficScheduleStats &schedule =
+            g_state.traffic_sweep.schedule;
+        ImGui::Text("Traffic schedule: %zu sent of %zu due, %zu deferred",
+                    schedule.sent, schedule.due, schedule.deferred);
+      }
+      const udp::TrafficPacerStats &pacing =
+          g_state.engine.trafficPacer().stats();
+      ImGui::Text("Traffic bursts: %zu frames last, %zu max | gap %.0f ms "
+                  "avg, %.0f ms max",
+                  pacing.last_burst, pacing.max_burst,
+                  pacing.averageGapS() * 1000.0, pacing.max_gap_s * 1000.0);
+      if (cfg.extrapolation_horizon_s > 0.0f) {
+        ImGui::Text("Traffic extrapolated up to %.0f ms last sweep",
+                    g_state.traffic_sweep.extrapolation_s * 1000.0);
+      }
+      if (g_state.traffic_worker) {
+        const xp2gdl90::WakeLatencyStats wake =
+            g_state.traffic_worker->wakeLatency();
+        ImGui::Text(
+            "Traffic thread: %.0f ms to pickup, %llu sweeps skipped, wake "
+            "avg %.0f us, max %llu us",
+            g_state.traffic_worker_lag_s * 1000.0,
+            static_cast<unsigned long long>(
+                g_state.traffic_worker->sweepsSkipped()),
+            wake.averageUs(), static_cast<unsigned long long>(wake.max_us));
+        DrawThreadTuningError("Traffic thread",
+                              g_state.traffic_worker->threadTuningError());
+      }
+      ImGui::Text(
+          "Traffic frame cache: %llu reused, %llu encoded",
+          static_cast<unsigned long long>(g_state.traffic_sweep.cache_hits),
+          static_cast<unsigned long long>(g_state.traffic_sweep.cache_misses));
+      ImGui::Text(
+          "Heartbeat/geo-alt frames: %llu reused, %llu framed",
+          static_cast<unsigned long long>(g_state.heartbeat_frame.hits() +
+                                          g_state.geo_altitude_frame.hits()),
+          static_cast<unsigned long long>(
+              g_state.heartbeat_frame.misses() +
+              g_state.geo_altitude_frame.misses()));
       ImGui::Text(
           "ForeFlight ID: %llu (%d bytes last, %.2fs ago)",
           static_cast<unsigned long long>(g_state.device_info_packets_sent),
@@ -1367,25 +2360,60 @@ void DrawSettingsWindowUI() {
       ImGui::Text("Target mode: %s", g_state.using_discovered_target
                                          ? "ForeFlight discovery"
                                          : "Manual");
-      if (since_discovery >= 0.0f) {
-        ImGui::Text("Last ForeFlight discovery: %s:%u (%.2fs ago)",
+      if (!g_state.foreflight_devices.empty() && since_discovery >= 0.0) {
+        ImGui::Text("ForeFlight devices: %zu (primary %s:%u, last heard "
+                    "%.2fs ago)",
+                    g_state.foreflight_devices.size(),
                     g_state.discovered_target_ip.c_str(),
                     static_cast<unsigned int>(g_state.discovered_target_port),
                     since_discovery);
       } else {
-        ImGui::TextUnformatted("Last ForeFlight discovery: none");
+        ImGui::TextUnformatted("ForeFlight devices: none");
       }
       ImGui::Text("AHRS heading mode: %s",
                   cfg.ahrs_use_magnetic_heading ? "Magnetic" : "True");
       ImGui::TextUnformatted(
           "AHRS source: theta / phi / psi, indicated_airspeed, true_airspeed");
-      ImGui::Text("Bytes sent: %llu",
-                  static_cast<unsigned long long>(g_state.bytes_sent));
+      ImGui::Text("Bytes sent: %llu", static_cast<unsigned long long>(
+                                          g_state.engine.stats().bytes_sent));
+      DrawBandwidthAccount(g_state.engine.accounting(), *g_state.broadcaster);
+      if (cfg.datagram_packing) {
+        const udp::DatagramPackerStats &packing =
+            g_state.engine.packerStats();
+        ImGui::Text(
+            "Datagrams: %llu for %llu frames (fill avg %.0f%%, last %.0f%%, "
+            "min %.0f%%)",
+            static_cast<unsigned long long>(packing.datagrams_sent),
+            static_cast<unsigned long long>(packing.frames_sent),
+            packing.averageFillRatio() * 100.0,
+            packing.last_fill_ratio * 100.0, packing.min_fill_ratio * 100.0);
+      }
+      if (g_state.engine.sender()) {
+        const udp::NetworkSenderStats sender =
+            g_state.engine.sender()->stats();
+        ImGui::Text("Sender thread: %llu frames, latency avg %.0f us, max "
+                    "%llu us",
+                    static_cast<unsigned long long>(sender.frames_sent),
+                    sender.averageLatencyUs(),
+                    static_cast<unsigned long long>(sender.latency_max_us));
+        ImGui::Text(
+            "Sender wake-up: avg %.0f us, max %llu us",
+            sender.wake_latency.averageUs(),
+            static_cast<unsigned long long>(sender.wake_latency.max_us));
+        DrawThreadTuningError("Sender thread",
+                              g_state.engine.sender()->threadTuningError());
+        ImGui::Text(
+            "Dropped traffic: %llu oldest, %llu newest; priority overflows: "
+            "%llu",
+            static_cast<unsigned long long>(sender.traffic_dropped_oldest),
+            static_cast<unsigned long long>(sender.traffic_dropped_newest),
+            static_cast<unsigned long long>(sender.priority_overflows));
+      }
 
-      if (!g_state.last_send_error.empty()) {
+      if (!g_state.engine.lastError().empty()) {
         ImGui::Separator();
         ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Last send error:");
-        ImGui::TextWrapped("%s", g_state.last_send_error.c_str());
+        ImGui::TextWrapped("%s", g_state.engine.lastError().c_str());
       }
       if (!g_state.last_receiver_error.empty()) {
         ImGui::Separator();
@@ -1407,6 +2435,50 @@ void DrawSettingsWindowUI() {
       dirty_now |=
           ImGui::InputInt("ForeFlight broadcast port",
                           &g_state.settings_ui.foreflight_broadcast_port);
+      ImGui::Separator();
+      dirty_now |= ImGui::Checkbox("Pack frames into datagrams",
+                                   &g_state.settings_ui.datagram_packing);
+      dirty_now |= ImGui::InputInt("Datagram size (bytes)",
+                                   &g_state.settings_ui.datagram_max_bytes);
+      ImGui::TextUnformatted("Datagram size range: 128-65507 bytes");
+      ImGui::Separator();
+      dirty_now |= ImGui::Checkbox("Send from a background thread",
+                                   &g_state.settings_ui.sender_thread);
+      dirty_now |= ImGui::InputInt("Traffic overflow policy",
+                                   &g_state.settings_ui.sender_overflow_policy);
+      ImGui::TextUnformatted("0=Drop oldest traffic 1=Drop newest traffic");
+      dirty_now |= ImGui::InputInt("Worker thread priority",
+                                   &g_state.settings_ui.worker_thread_priority);
+      ImGui::TextUnformatted("0=Normal 1=High 2=Time-critical");
+      dirty_now |= ImGui::InputText(
+          "Worker CPU mask (hex)", g_state.settings_ui.worker_cpu_mask,
+          sizeof(g_state.settings_ui.worker_cpu_mask));
+      ImGui::TextUnformatted("Bit n allows CPU n; 0x0=any CPU");
+      ImGui::Separator();
+      dirty_now |=
+          ImGui::InputFloat("Output budget per tick (ms)",
+                            &g_state.settings_ui.output_budget_ms, 0.5f, 2.0f,
+                            "%.1f");
+      dirty_now |=
+          ImGui::InputInt("Output budget per tick (bytes)",
+                          &g_state.settings_ui.output_budget_bytes, 100, 1000);
+      ImGui::TextUnformatted("Lower-priority messages wait when over; 0=off");
+      dirty_now |= ImGui::InputInt(
+          "Bandwidth limit (bytes/s)",
+          &g_state.settings_ui.bandwidth_limit_bytes_per_s, 1000, 10000);
+      ImGui::TextUnformatted("Per destination; sheds traffic first; 0=off");
+      if (cfg.bandwidth_limit_bytes_per_s > 0) {
+        const udp::BandwidthLimiterStats &bandwidth =
+            g_state.broadcaster->bandwidthStats(0);
+        ImGui::Text("Primary: %.1f kB/s allowed, %llu shed, %llu backoffs",
+                    bandwidth.rate_bytes_per_s / 1000.0,
+                    static_cast<unsigned long long>(bandwidth.shed_messages),
+                    static_cast<unsigned long long>(bandwidth.backoffs));
+      }
+      ImGui::Separator();
+      ImGui::Text("Extra destinations: %zu (edit extra_destinations in %s)",
+                  cfg.extra_destinations.size(),
+                  "xp2gdl90.json");
       ImGui::EndTabItem();
     }
 
@@ -1445,6 +2517,20 @@ void DrawSettingsWindowUI() {
       dirty_now |= ImGui::InputFloat("Position Rate (Hz)",
                                      &g_state.settings_ui.position_rate, 0.1f,
                                      1.0f, "%.2f");
+      dirty_now |= ImGui::Checkbox("High-rate ownship (after flight model)",
+                                   &g_state.settings_ui.ownship_high_rate);
+      ImGui::TextUnformatted("High-rate ownship: position rate up to 10 Hz");
+      dirty_now |= ImGui::InputFloat("AHRS Rate (Hz)",
+                                     &g_state.settings_ui.ahrs_rate, 1.0f,
+                                     5.0f, "%.1f");
+      dirty_now |= ImGui::InputFloat("Geo Altitude Rate (Hz)",
+                                     &g_state.settings_ui.geo_altitude_rate,
+                                     0.5f, 1.0f, "%.1f");
+      dirty_now |= ImGui::InputFloat("ForeFlight ID Rate (Hz)",
+                                     &g_state.settings_ui.device_info_rate,
+                                     0.5f, 1.0f, "%.1f");
+      ImGui::TextUnformatted("AHRS 0-20 Hz, others 0-5 Hz; 0 turns a message "
+                             "off");
       dirty_now |= ImGui::Checkbox("Broadcast traffic",
                                    &g_state.settings_ui.traffic_enabled);
       dirty_now |= ImGui::InputFloat("Traffic Rate (Hz)",
@@ -1453,6 +2539,76 @@ void DrawSettingsWindowUI() {
       dirty_now |= ImGui::InputInt("Traffic Maximum",
                                    &g_state.settings_ui.traffic_max_targets);
       ImGui::TextUnformatted("Traffic maximum range: 0-63 targets");
+      dirty_now |= ImGui::InputInt("Traffic position mode",
+                                   &g_state.settings_ui.traffic_position_mode);
+      ImGui::TextUnformatted("0=Exact per target 1=Project near ownship");
+      dirty_now |= ImGui::InputFloat(
+          "Projection radius (nm)",
+          &g_state.settings_ui.traffic_projection_radius_nm, 1.0f, 5.0f,
+          "%.1f");
+      ImGui::TextUnformatted("Projection radius range: 0-40 nm");
+      dirty_now |= ImGui::InputFloat("Traffic range (nm)",
+                                     &g_state.settings_ui.traffic_range_nm,
+                                     1.0f, 10.0f, "%.1f");
+      dirty_now |= ImGui::InputFloat(
+          "Altitude band (ft)", &g_state.settings_ui.traffic_altitude_band_ft,
+          500.0f, 1000.0f, "%.0f");
+      dirty_now |= ImGui::InputFloat(
+          "Closure lookahead (s)",
+          &g_state.settings_ui.traffic_closure_lookahead_s, 10.0f, 60.0f,
+          "%.0f");
+      ImGui::TextUnformatted("0 disables range, band and lookahead");
+      dirty_now |= ImGui::Checkbox("Adaptive per-target rate",
+                                   &g_state.settings_ui.traffic_adaptive_rate);
+      dirty_now |= ImGui::InputFloat(
+          "Traffic frame budget (/s)",
+          &g_state.settings_ui.traffic_max_frames_per_second, 5.0f, 20.0f,
+          "%.0f");
+      ImGui::TextUnformatted("Frame budget range: 0-1000, 0=unlimited");
+      dirty_now |= ImGui::Checkbox("Pace traffic across the interval",
+                                   &g_state.settings_ui.traffic_pacing);
+      dirty_now |= ImGui::Checkbox("Sweep traffic on a background thread",
+                                   &g_state.settings_ui.traffic_thread);
+      dirty_now |= ImGui::Checkbox("Smooth track and rates from history",
+                                   &g_state.settings_ui.traffic_smoothing);
+      dirty_now |= ImGui::Checkbox("Relay traffic from a GDL90 feed",
+                                   &g_state.settings_ui.traffic_relay);
+      dirty_now |= ImGui::InputInt("Relay port",
+                                   &g_state.settings_ui.traffic_relay_port);
+      dirty_now |= ImGui::InputInt(
+          "Relay priority", &g_state.settings_ui.traffic_relay_priority);
+      ImGui::TextUnformatted("0=Simulator copy wins 1=Feed copy wins");
+      if (g_state.traffic_relay) {
+        const xp2gdl90::traffic::TrafficRelayStats relay =
+            g_state.traffic_relay->stats();
+        ImGui::Text("Relayed: %zu targets, %llu reports, %llu dropped",
+                    g_state.relayed_traffic.size(),
+                    static_cast<unsigned long long>(relay.reports),
+                    static_cast<unsigned long long>(relay.dropped));
+        DrawThreadTuningError("Relay thread",
+                              g_state.traffic_relay->threadTuningError());
+      }
+      dirty_now |= ImGui::InputFloat(
+          "Extrapolation horizon (s)",
+          &g_state.settings_ui.extrapolation_horizon_s, 0.1f, 1.0f, "%.1f");
+      ImGui::TextUnformatted("Also applies to ownship; 0-10, 0=off");
+      ImGui::Separator();
+      ImGui::InputInt("Targets to plan for", &g_state.plan_traffic_targets);
+      ImGui::TextUnformatted("-1=Tracked now; capped at the traffic maximum");
+      Settings planned;
+      std::string plan_error;
+      if (BuildConfigFromSettingsUi(&planned, &plan_error)) {
+        xp2gdl90::BandwidthPlanInputs inputs;
+        inputs.traffic_targets =
+            g_state.plan_traffic_targets >= 0
+                ? static_cast<size_t>(g_state.plan_traffic_targets)
+                : g_state.traffic_sweep.tracked;
+        inputs.foreflight_devices = g_state.foreflight_devices.size();
+        DrawBandwidthPlan(xp2gdl90::PlanBandwidth(planned, inputs),
+                          planned.bandwidth_limit_bytes_per_s);
+      } else {
+        ImGui::TextWrapped("Planned load: %s", plan_error.c_str());
+      }
       ImGui::EndTabItem();
     }
 
@@ -1467,6 +2623,125 @@ void DrawSettingsWindowUI() {
           ImGui::Checkbox("Debug logging", &g_state.settings_ui.debug_logging);
       dirty_now |= ImGui::Checkbox("Log raw messages",
                                    &g_state.settings_ui.log_messages);
+      dirty_now |= ImGui::Checkbox("Capture sent datagrams to pcap",
+                                   &g_state.settings_ui.stream_capture);
+      dirty_now |= ImGui::InputInt("Capture ring size (MB)",
+                                   &g_state.settings_ui.stream_capture_mb);
+      dirty_now |=
+          ImGui::Checkbox("Compact capture log (.xcap)",
+                          &g_state.settings_ui.stream_capture_compact);
+      if (g_state.stream_capture) {
+        const udp::StreamCaptureStats capture =
+            g_state.stream_capture->stats();
+        if (g_state.stream_capture_compact) {
+          ImGui::Text("Captured: %llu datagrams, %.1f MB on disk for "
+                      "%.1f MB sent, %llu dropped",
+                      static_cast<unsigned long long>(capture.records),
+                      static_cast<double>(capture.file_bytes) / 1048576.0,
+                      static_cast<double>(capture.bytes) / 1048576.0,
+                      static_cast<unsigned long long>(capture.dropped));
+        } else {
+          ImGui::Text("Captured: %llu records, %llu wraps of %zu slots",
+                      static_cast<unsigned long long>(capture.records),
+                      static_cast<unsigned long long>(capture.wraps),
+                      capture.slots);
+        }
+        ImGui::TextWrapped("%s", g_state.stream_capture->path().c_str());
+      }
+      dirty_now |= ImGui::Checkbox("Publish to shared memory",
+                                   &g_state.settings_ui.shared_output);
+      if (g_state.shared_output) {
+        const xp2gdl90::SharedOutputStats shared =
+            g_state.shared_output->stats();
+        ImGui::Text("Shared \"%s\": %llu frames, %llu snapshots",
+                    g_state.shared_output->name().c_str(),
+                    static_cast<unsigned long long>(shared.frames),
+                    static_cast<unsigned long long>(shared.snapshots));
+      }
+      dirty_now |= ImGui::Checkbox("Send link probe marks",
+                                   &g_state.settings_ui.link_probe);
+      if (g_state.engine.options().link_probe) {
+        ImGui::Text("Probe marks sent: %llu",
+                    static_cast<unsigned long long>(
+                        g_state.engine.stats().probe_marks_sent));
+      }
+      dirty_now |= ImGui::Checkbox("Record sim inputs for profiling",
+                                   &g_state.settings_ui.sim_recording);
+      if (g_state.sim_recorder) {
+        ImGui::Text("Recorded: %llu sweeps, %.1f MB",
+                    static_cast<unsigned long long>(
+                        g_state.sim_recorder->ticks()),
+                    g_state.sim_recorder->bytes() / (1024.0 * 1024.0));
+      }
+      dirty_now |= ImGui::Checkbox("Send metrics to a collector",
+                                   &g_state.settings_ui.metrics_enabled);
+      dirty_now |=
+          ImGui::InputText("Metrics IP", g_state.settings_ui.metrics_ip,
+                           sizeof(g_state.settings_ui.metrics_ip));
+      dirty_now |=
+          ImGui::InputInt("Metrics port", &g_state.settings_ui.metrics_port);
+      dirty_now |= ImGui::InputFloat("Metrics interval (s)",
+                                     &g_state.settings_ui.metrics_interval_s,
+                                     1.0f, 5.0f, "%.0f");
+      if (g_state.metrics_exporter.isOpen()) {
+        ImGui::Text("Metrics reports: %llu sent, %llu failed",
+                    static_cast<unsigned long long>(
+                        g_state.metrics_exporter.reportsSent()),
+                    static_cast<unsigned long long>(
+                        g_state.metrics_exporter.sendErrors()));
+      }
+      if (!g_state.metrics_last_error.empty()) {
+        ImGui::TextWrapped("Metrics: %s", g_state.metrics_last_error.c_str());
+      }
+      ImGui::Separator();
+      ImGui::TextUnformatted("Send interval vs period (ms late):");
+      for (size_t i = 0; i < xp2gdl90::SEND_CLASS_COUNT; ++i) {
+        const xp2gdl90::SendIntervalHistogram &intervals =
+            g_state.send_intervals[i];
+        const auto send_class = static_cast<xp2gdl90::SendClass>(i);
+        ImGui::Text("%s: %llu, mean %.1f ms, min %.1f, max %.1f",
+                    xp2gdl90::SendClassName(send_class),
+                    static_cast<unsigned long long>(intervals.count()),
+                    intervals.meanIntervalS() * 1000.0,
+                    intervals.minIntervalS() * 1000.0,
+                    intervals.maxIntervalS() * 1000.0);
+        std::string buckets;
+        for (size_t b = 0; b < xp2gdl90::SEND_INTERVAL_BUCKETS; ++b) {
+          buckets += std::string(b > 0 ? " | " : "  ") +
+                     xp2gdl90::SendIntervalHistogram::bucketLabel(b) + ": " +
+                     std::to_string(intervals.buckets()[b]);
+        }
+        ImGui::TextUnformatted(buckets.c_str());
+      }
+      ImGui::Separator();
+      xp2gdl90::DrawStatsHistory(g_state.stats_history);
+      ImGui::Separator();
+      xp2gdl90::DrawStageTimings(g_state.stage_timings);
+      ImGui::Separator();
+      const xp2gdl90::OutputScheduler &scheduler = g_state.output_scheduler;
+      ImGui::Text("Output ticks: %llu, %llu over budget",
+                  static_cast<unsigned long long>(scheduler.ticks()),
+                  static_cast<unsigned long long>(scheduler.overBudgetTicks()));
+      for (size_t i = 0; i < xp2gdl90::SEND_CLASS_COUNT; ++i) {
+        const auto send_class = static_cast<xp2gdl90::SendClass>(i);
+        const xp2gdl90::OutputClassStats &output = scheduler.stats(send_class);
+        ImGui::Text("%s: %llu deferred, %llu dropped, %llu missed, "
+                    "worst %.0f ms late",
+                    xp2gdl90::SendClassName(send_class),
+                    static_cast<unsigned long long>(output.deferred),
+                    static_cast<unsigned long long>(output.dropped),
+                    static_cast<unsigned long long>(output.deadline_misses),
+                    output.max_lateness_s * 1000.0);
+      }
+      if (ImGui::Button("Reset timing")) {
+        for (xp2gdl90::SendIntervalHistogram &intervals :
+             g_state.send_intervals) {
+          intervals.reset();
+        }
+        g_state.output_scheduler.resetStats();
+        g_state.stage_timings.reset();
+        g_state.stats_history.reset();
+      }
       ImGui::EndTabItem();
     }
 
@@ -1560,19 +2835,44 @@ void SettingsDrawCallback(XPLMWindowID in_window_id, void *in_refcon) {
   const float width = static_cast<float>(right - left);
   const float height = static_cast<float>(top - bottom);
 
+  const double now = static_cast<double>(XPLMGetElapsedTime());
+  const std::array<int, 8> geometry = {{left, top, right, bottom, screen_left,
+                                        screen_top, screen_right,
+                                        screen_bottom}};
+  if (geometry != g_state.imgui_geometry) {
+    g_state.imgui_geometry = geometry;
+    g_state.imgui_redraw.invalidate();
+  }
+  int mouse_x = 0;
+  int mouse_y = 0;
+  XPLMGetMouseLocationGlobal(&mouse_x, &mouse_y);
+  const bool mouse_inside = mouse_x >= left && mouse_x <= right &&
+                            mouse_y >= bottom && mouse_y <= top;
+  if (mouse_x != g_state.imgui_mouse_x || mouse_y != g_state.imgui_mouse_y) {
+    g_state.imgui_mouse_x = mouse_x;
+    g_state.imgui_mouse_y = mouse_y;
+    if (mouse_inside) {
+      g_state.imgui_redraw.noteInput(now);
+    } else {
+      // Once more, so hover highlights clear when the mouse leaves.
+      g_state.imgui_redraw.invalidate();
+    }
+  }
+
   ImGuiIO &io = ImGui::GetIO();
+  const bool busy = ImGui::IsAnyItemActive() || io.WantTextInput;
+  if (g_state.imgui_frame_built &&
+      !g_state.imgui_redraw.shouldRebuild(now, busy)) {
+    ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
+    return;
+  }
   io.DisplaySize = ImVec2(screen_width, screen_height);
 
-  const double now = static_cast<double>(XPLMGetElapsedTime());
   const double dt = now - g_state.imgui_last_time;
   io.DeltaTime = (dt > 0.0) ? static_cast<float>(dt) : (1.0f / 60.0f);
   g_state.imgui_last_time = now;
 
-  int mouse_x = 0;
-  int mouse_y = 0;
-  XPLMGetMouseLocationGlobal(&mouse_x, &mouse_y);
-  if (mouse_x >= left && mouse_x <= right && mouse_y >= bottom &&
-      mouse_y <= top) {
+  if (mouse_inside) {
     const float imgui_x = static_cast<float>(mouse_x - screen_left);
     const float imgui_y = static_cast<float>(screen_top - mouse_y);
     io.AddMousePosEvent(imgui_x, imgui_y);
@@ -1612,6 +2912,8 @@ void SettingsDrawCallback(XPLMWindowID in_window_id, void *in_refcon) {
 
   ImGui::Render();
   ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
+  g_state.imgui_redraw.noteRebuilt(now);
+  g_state.imgui_frame_built = true;
 }
 
 int SettingsMouseClickCallback(XPLMWindowID in_window_id, int x, int y,
@@ -1631,6 +2933,7 @@ int SettingsMouseClickCallback(XPLMWindowID in_window_id, int x, int y,
 
   XPLMTakeKeyboardFocus(in_window_id);
 
+  g_state.imgui_redraw.noteInput(static_cast<double>(XPLMGetElapsedTime()));
   if (in_mouse == xplm_MouseDown) {
     g_state.imgui_mouse_down[0] = true;
     g_state.imgui_mouse_changed[0] = true;
@@ -1658,6 +2961,7 @@ int SettingsRightClickCallback(XPLMWindowID in_window_id, int x, int y,
 
   XPLMTakeKeyboardFocus(in_window_id);
 
+  g_state.imgui_redraw.noteInput(static_cast<double>(XPLMGetElapsedTime()));
   if (in_mouse == xplm_MouseDown) {
     g_state.imgui_mouse_down[1] = true;
     g_state.imgui_mouse_changed[1] = true;
@@ -1678,6 +2982,7 @@ void SettingsKeyCallback(XPLMWindowID in_window_id, char in_key,
     return;
   }
 
+  g_state.imgui_redraw.noteInput(static_cast<double>(XPLMGetElapsedTime()));
   ImGuiIO &io = ImGui::GetIO();
   if (losing_focus) {
     io.AddFocusEvent(false);
@@ -1737,6 +3042,7 @@ int SettingsMouseWheelCallback(XPLMWindowID in_window_id, int x, int y,
     return 0;
   }
 
+  g_state.imgui_redraw.noteInput(static_cast<double>(XPLMGetElapsedTime()));
   if (wheel == 0) {
     g_state.imgui_mouse_wheel += static_cast<float>(clicks);
   } else {
@@ -1811,6 +3117,8 @@ void ShowSettingsWindow(bool show) {
   }
 
   if (show) {
+    // Flight loops stop while disabled; pick up edits made meanwhile.
+    ApplyPendingSettingsLoad();
     SyncSettingsUiFromConfig();
     XPLMSetWindowIsVisible(g_state.settings_window, 1);
     XPLMBringWindowToFront(g_state.settings_window);
@@ -1819,6 +3127,112 @@ void ShowSettingsWindow(bool show) {
   }
 }
 
+int ReadStatsInt(void *refcon) {
+  return ClampFloatToInt<int>(static_cast<StatsDataRef *>(refcon)->read());
+}
+
+float ReadStatsFloat(void *refcon) {
+  return static_cast<float>(static_cast<StatsDataRef *>(refcon)->read());
+}
+
+double ReadStatsDouble(void *refcon) {
+  return static_cast<StatsDataRef *>(refcon)->read();
+}
+
+// Publishes the status counters as read-only xp2gdl90/stats/* datarefs so
+// DataRefTool, FlyWithLua or external monitors can watch them live. Counters
+// wider than 32 bits saturate when read as int; read them as double instead.
+void RegisterStatsDataRefs() {
+  std::vector<StatsDataRef> &refs = g_state.stats_datarefs;
+  const auto add = [&refs](const char *name, std::function<double()> read) {
+    refs.push_back(StatsDataRef{std::string("xp2gdl90/stats/") + name,
+                                std::move(read), nullptr});
+  };
+  const auto counter = [&add](const char *name, const uint64_t *value) {
+    add(name, [value] { return static_cast<double>(*value); });
+  };
+  counter("packets/heartbeat", &g_state.heartbeat_packets_sent);
+  counter("packets/ownship", &g_state.position_packets_sent);
+  counter("packets/traffic", &g_state.engine.stats().traffic_packets_sent);
+  counter("packets/device_info", &g_state.device_info_packets_sent);
+  counter("packets/ahrs", &g_state.ahrs_packets_sent);
+  counter("packets/geo_altitude", &g_state.geo_altitude_packets_sent);
+  counter("bytes_sent", &g_state.engine.stats().bytes_sent);
+  counter("send_errors", &g_state.engine.stats().send_errors);
+  counter("flight_loop_calls", &g_state.flight_loop_calls);
+  add("traffic/targets", [] {
+    return static_cast<double>(g_state.last_traffic_target_count);
+  });
+  add("traffic/tracked", [] {
+    return static_cast<double>(g_state.traffic_sweep.tracked);
+  });
+  add("traffic/frame_cache_hits", [] {
+    return static_cast<double>(g_state.traffic_sweep.cache_hits);
+  });
+  add("traffic/frame_cache_misses", [] {
+    return static_cast<double>(g_state.traffic_sweep.cache_misses);
+  });
+#if XP2GDL90_STAGE_TIMING
+  add("timing/ticks", [] {
+    return static_cast<double>(g_state.stage_timings.ticks());
+  });
+  for (size_t i = 0; i < xp2gdl90::STAGE_COUNT; ++i) {
+    const auto stage = static_cast<xp2gdl90::Stage>(i);
+    const std::string prefix =
+        std::string("timing/") + xp2gdl90::StageKey(stage);
+    const auto percentile_us = [stage](double fraction) {
+      return [stage, fraction] {
+        const xp2gdl90::LatencyHistogram &histogram =
+            g_state.stage_timings.histogram(stage);
+        return static_cast<double>(histogram.percentileNs(fraction)) / 1e3;
+      };
+    };
+    add((prefix + "_p50_us").c_str(), percentile_us(0.5));
+    add((prefix + "_p99_us").c_str(), percentile_us(0.99));
+    add((prefix + "_max_us").c_str(), [stage] {
+      return static_cast<double>(
+                 g_state.stage_timings.histogram(stage).maxNs()) /
+             1e3;
+    });
+  }
+#endif
+
+  for (StatsDataRef &ref : refs) {
+    ref.ref = XPLMRegisterDataAccessor(
+        ref.name.c_str(), xplmType_Int | xplmType_Float | xplmType_Double, 0,
+        ReadStatsInt, nullptr, ReadStatsFloat, nullptr, ReadStatsDouble,
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &ref,
+        nullptr);
+  }
+  LogMessage("Registered " + std::to_string(refs.size()) +
+             " xp2gdl90/stats datarefs");
+}
+
+void UnregisterStatsDataRefs() {
+  for (StatsDataRef &ref : g_state.stats_datarefs) {
+    if (ref.ref) {
+      XPLMUnregisterDataAccessor(ref.ref);
+    }
+  }
+  g_state.stats_datarefs.clear();
+}
+
+// Lists the stats datarefs in DataRefTool, which only finds custom datarefs
+// that are announced to it. Every plugin has started by the time we are
+// enabled, so the lookup succeeds regardless of load order.
+void AnnounceStatsDataRefs() {
+  constexpr int kDataRefToolAddDataRef = 0x01000000;
+  const XPLMPluginID tool =
+      XPLMFindPluginBySignature("com.leecbaker.datareftool");
+  if (tool == XPLM_NO_PLUGIN_ID) {
+    return;
+  }
+  for (const StatsDataRef &ref : g_state.stats_datarefs) {
+    XPLMSendMessageToPlugin(tool, kDataRefToolAddDataRef,
+                            const_cast<char *>(ref.name.c_str()));
+  }
+}
+
 } // namespace
 
 PLUGIN_API int XPluginStart(char *outName, char *outSig, char *outDesc) {
@@ -1827,27 +3241,33 @@ PLUGIN_API int XPluginStart(char *outName, char *outSig, char *outDesc) {
   std::strcpy(outDesc, "GDL90 ADS-B data broadcaster for EFB applications");
 
   LogMessage("Plugin starting...");
+  const double start_time = xp2gdl90::MonotonicSeconds();
 
   XPLMEnableFeature("XPLM_USE_NATIVE_PATHS", 1);
 
   g_state.initialized = false;
   g_state.enabled = false;
-  g_state.last_heartbeat = 0.0f;
-  g_state.last_position = 0.0f;
-  g_state.last_traffic = 0.0f;
-  g_state.last_device_info = 0.0f;
-  g_state.last_ahrs = 0.0f;
-  g_state.last_geo_altitude = 0.0f;
-  g_state.last_foreflight_discovery = -1.0f;
+  g_state.last_heartbeat = 0.0;
+  g_state.last_position = 0.0;
+  g_state.last_traffic = 0.0;
+  g_state.last_device_info = 0.0;
+  g_state.last_ahrs = 0.0;
+  g_state.last_geo_altitude = 0.0;
+  g_state.last_foreflight_discovery = -1.0;
   g_state.broadcast_clock_state = {};
-  g_state.broadcast_clock_time = 0.0f;
+  g_state.broadcast_clock_time = 0.0;
+  g_state.flight_loop_calls = 0;
+  g_state.output_scheduler = xp2gdl90::OutputScheduler{};
   g_state.broadcast_clock_replay = false;
+  g_state.foreflight_devices.clear();
+  g_state.foreflight_devices_applied = g_state.foreflight_devices.generation();
   g_state.discovered_target_ip.clear();
   g_state.discovered_target_port = 0;
   g_state.using_discovered_target = false;
   g_state.last_receiver_error.clear();
 
-  g_state.encoder = std::make_unique<gdl90::GDL90Encoder>();
+  g_state.encoder =
+      std::make_unique<gdl90::TimedGDL90Encoder<gdl90::SteadyUtcClock>>();
   g_state.foreflight_encoder =
       std::make_unique<gdl90::foreflight::ForeFlightEncoder>();
 
@@ -1856,19 +3276,41 @@ PLUGIN_API int XPluginStart(char *outName, char *outSig, char *outDesc) {
   XPLMExtractFileAndPath(prefs_path); // leaves directory in prefs_path
   g_state.settings_path =
       std::string(prefs_path) + XPLMGetDirectorySeparator() + "xp2gdl90.json";
-
-  Settings loaded = g_state.settings;
-  std::string load_error;
-  if (LoadSettingsFromDisk(&loaded, &load_error)) {
-    g_state.settings = loaded;
-    LogMessage("Settings loaded: " + g_state.settings_path);
-  } else if (!load_error.empty()) {
-    LogMessage("Warning: Failed to load settings: " + load_error);
-  } else {
-    LogMessage("No settings file found; using GUI defaults");
+  g_state.capture_path = std::string(prefs_path) +
+                         XPLMGetDirectorySeparator() + "xp2gdl90_capture.pcap";
+  g_state.compact_capture_path = std::string(prefs_path) +
+                                 XPLMGetDirectorySeparator() +
+                                 "xp2gdl90_capture.xcap";
+  g_state.sim_recording_path = std::string(prefs_path) +
+                               XPLMGetDirectorySeparator() +
+                               "xp2gdl90_inputs.xpsim";
+
+  // The runtime comes up on the current settings and the flight loop
+  // applies the file once the settings thread has read it, so start never
+  // waits on a slow home directory.
+  g_state.settings_ready = false;
+  g_state.settings_wait_deadline =
+      xp2gdl90::MonotonicSeconds() + kSettingsLoadWaitS;
+  std::string watcher_error;
+  if (!g_state.settings_watcher.start(g_state.settings_path, *CurrentSettings(),
+                                      xp2gdl90::SETTINGS_POLL_INTERVAL_S,
+                                      &watcher_error)) {
+    LogMessage("Warning: " + watcher_error + "; reading settings now");
+    Settings loaded = *CurrentSettings();
+    std::string load_error;
+    if (LoadSettingsFromDisk(&loaded, &load_error)) {
+      g_state.settings.publish(loaded);
+      LogMessage("Settings loaded: " + g_state.settings_path);
+    } else if (!load_error.empty()) {
+      LogMessage("Warning: Failed to load settings: " + load_error);
+    } else {
+      LogMessage("No settings file found; using GUI defaults");
+    }
+    g_state.settings_ready = true;
   }
 
-  const Settings &cfg = g_state.settings;
+  const SettingsSnapshot settings = CurrentSettings();
+  const Settings &cfg = *settings;
 
   g_state.broadcaster =
       std::make_unique<udp::UDPBroadcaster>(cfg.target_ip, cfg.target_port);
@@ -1879,68 +3321,14 @@ PLUGIN_API int XPluginStart(char *outName, char *outSig, char *outDesc) {
   }
   LogMessage("UDP broadcaster initialized: " + cfg.target_ip + ":" +
              std::to_string(cfg.target_port));
-
-  g_state.lat_ref = XPLMFindDataRef("sim/flightmodel/position/latitude");
-  g_state.lon_ref = XPLMFindDataRef("sim/flightmodel/position/longitude");
-  g_state.alt_ref = XPLMFindDataRef("sim/flightmodel/position/elevation");
-  g_state.pressure_alt_ref =
-      XPLMFindDataRef("sim/flightmodel2/position/pressure_altitude");
-  g_state.speed_ref = XPLMFindDataRef("sim/flightmodel/position/groundspeed");
-  g_state.track_ref = XPLMFindDataRef("sim/flightmodel/position/true_psi");
-  g_state.pitch_ref = XPLMFindDataRef("sim/flightmodel/position/theta");
-  g_state.roll_ref = XPLMFindDataRef("sim/flightmodel/position/phi");
-  g_state.heading_ref = XPLMFindDataRef("sim/flightmodel/position/psi");
-  g_state.indicated_airspeed_ref =
-      XPLMFindDataRef("sim/flightmodel/position/indicated_airspeed");
-  g_state.true_airspeed_ref =
-      XPLMFindDataRef("sim/flightmodel/position/true_airspeed");
-  g_state.vs_ref = XPLMFindDataRef("sim/flightmodel/position/vh_ind_fpm");
-  g_state.airborne_ref =
-      XPLMFindDataRef("sim/flightmodel/failures/onground_any");
-  g_state.sim_time_ref = XPLMFindDataRef("sim/time/total_flight_time_sec");
-  g_state.replay_ref = XPLMFindDataRef("sim/time/is_in_replay");
-  g_state.tailnum_ref = XPLMFindDataRef("sim/aircraft/view/acf_tailnum");
-
-  bool datarefs_ok = true;
-  datarefs_ok &=
-      VerifyDataRef(g_state.lat_ref, "sim/flightmodel/position/latitude");
-  datarefs_ok &=
-      VerifyDataRef(g_state.lon_ref, "sim/flightmodel/position/longitude");
-  datarefs_ok &=
-      VerifyDataRef(g_state.alt_ref, "sim/flightmodel/position/elevation");
-  datarefs_ok &=
-      VerifyDataRef(g_state.speed_ref, "sim/flightmodel/position/groundspeed");
-  datarefs_ok &=
-      VerifyDataRef(g_state.track_ref, "sim/flightmodel/position/true_psi");
-  datarefs_ok &=
-      VerifyDataRef(g_state.pitch_ref, "sim/flightmodel/position/theta");
-  datarefs_ok &=
-      VerifyDataRef(g_state.roll_ref, "sim/flightmodel/position/phi");
-  datarefs_ok &=
-      VerifyDataRef(g_state.heading_ref, "sim/flightmodel/position/psi");
-  datarefs_ok &=
-      VerifyDataRef(g_state.vs_ref, "sim/flightmodel/position/vh_ind_fpm");
-  datarefs_ok &= VerifyDataRef(g_state.airborne_ref,
-                               "sim/flightmodel/failures/onground_any");
-  datarefs_ok &=
-      VerifyDataRef(g_state.sim_time_ref, "sim/time/total_flight_time_sec");
-
-  if (!datarefs_ok) {
-    LogMessage("ERROR: Failed to find required datarefs");
-    return 0;
-  }
-
-  if (g_state.pressure_alt_ref) {
-    LogMessage("Using pressure altitude dataref for Ownship Report altitude");
-  } else {
-    LogMessage("Pressure altitude dataref unavailable; Ownship Report altitude "
-               "will be sent invalid");
-  }
-
-  LogMessage(std::string("AHRS heading mode: ") +
-             (cfg.ahrs_use_magnetic_heading ? "magnetic" : "true"));
-
-  InitializeTrafficDataRefs();
+  g_state.engine.attach(g_state.broadcaster.get());
+  ApplyExtraDestinations(cfg);
+  ConfigureNetworkSender(cfg);
+  ConfigureTrafficWorker(cfg);
+  ConfigureStreamCapture(cfg);
+  ConfigureSharedOutput(cfg);
+  ConfigureSimRecording(cfg);
+  ConfigureMetricsExporter(cfg);
 
   std::string receiver_error;
   if (!ReconfigureRuntimeReceivers(cfg, &receiver_error)) {
@@ -1961,8 +3349,14 @@ PLUGIN_API int XPluginStart(char *outName, char *outSig, char *outDesc) {
   XPLMAppendMenuItem(g_state.menu_id, "Reload Settings",
                      reinterpret_cast<void *>(3), 0);
 
+  RegisterStatsDataRefs();
+
   g_state.initialized = true;
-  LogMessage("Plugin initialized successfully");
+  char message[96] = {};
+  std::snprintf(message, sizeof(message),
+                "Plugin initialized successfully in %.1f ms",
+                (xp2gdl90::MonotonicSeconds() - start_time) * 1000.0);
+  LogMessage(message);
 
   return 1;
 }
@@ -1970,12 +3364,26 @@ PLUGIN_API int XPluginStart(char *outName, char *outSig, char *outDesc) {
 PLUGIN_API void XPluginStop(void) {
   LogMessage("Plugin stopping...");
 
+  g_state.settings_watcher.stop();
   if (g_state.enabled) {
     XPLMUnregisterFlightLoopCallback(FlightLoopCallback, nullptr);
   }
+  StopOwnshipSampler();
 
+  g_state.traffic_worker.reset();
+  g_state.engine.attach(nullptr);
+  if (g_state.stream_capture) {
+    g_state.broadcaster->setCapture(nullptr);
+    g_state.stream_capture.reset();
+  }
+  g_state.engine.setSharedOutput(nullptr);
+  g_state.shared_output.reset();
+  g_state.sim_recorder.reset();
+  g_state.metrics_exporter.close();
+  UnregisterStatsDataRefs();
   g_state.broadcaster.reset();
-  g_state.foreflight_receiver.reset();
+  g_state.foreflight_listener.reset();
+  g_state.traffic_relay.reset();
   g_state.foreflight_encoder.reset();
   g_state.encoder.reset();
   DestroySettingsWindow();
@@ -1990,7 +3398,27 @@ PLUGIN_API int XPluginEnable(void) {
 
   LogMessage("Enabling plugin...");
 
+  if (!g_state.ownship_refs_resolved) {
+    const double resolve_start = xp2gdl90::MonotonicSeconds();
+    if (!ResolveOwnshipDataRefs()) {
+      LogMessage("ERROR: Failed to find required datarefs");
+      return 0;
+    }
+    g_state.ownship_refs_resolved = true;
+    if (CurrentSettings()->traffic_enabled) {
+      EnsureTrafficDataRefs();
+    }
+    char message[96] = {};
+    std::snprintf(
+        message, sizeof(message), "Datarefs resolved in %.1f ms (%llu lookups)",
+        (xp2gdl90::MonotonicSeconds() - resolve_start) * 1000.0,
+        static_cast<unsigned long long>(g_state.dataref_cache.lookups()));
+    LogMessage(message);
+  }
+
   XPLMRegisterFlightLoopCallback(FlightLoopCallback, -1.0f, nullptr);
+  StartOwnshipSampler();
+  AnnounceStatsDataRefs();
 
   g_state.enabled = true;
   XPLMCheckMenuItem(g_state.menu_id, g_state.menu_item_enable,
@@ -2004,6 +3432,7 @@ PLUGIN_API void XPluginDisable(void) {
   LogMessage("Disabling plugin...");
 
   XPLMUnregisterFlightLoopCallback(FlightLoopCallback, nullptr);
+  StopOwnshipSampler();
 
   g_state.enabled = false;
   XPLMCheckMenuItem(g_state.menu_id, g_state.menu_item_enable,
@@ -2021,110 +3450,228 @@ PLUGIN_API void XPluginReceiveMessage(XPLMPluginID inFrom, int inMsg,
 
 namespace {
 
-float FlightLoopCallback(float in_elapsed_since_last_call,
-                         float in_elapsed_time_since_last_flight_loop,
-                         int in_counter, void *in_refcon) {
-  (void)in_elapsed_since_last_call;
-  (void)in_elapsed_time_since_last_flight_loop;
-  (void)in_counter;
-  (void)in_refcon;
-
-  if (!g_state.enabled || !g_state.initialized) {
-    return -1.0f;
-  }
-
-  const auto clock = UpdateCurrentBroadcastClock();
-  const float broadcast_time = clock.time;
-  const Settings &cfg = g_state.settings;
-
-  PollForeFlightDiscovery(broadcast_time, cfg);
-  RefreshBroadcastTarget(broadcast_time, cfg);
-
-  if (cfg.heartbeat_rate > 0.0f &&
-      broadcast_time - g_state.last_heartbeat >= (1.0f / cfg.heartbeat_rate)) {
-    const bool gps_valid = xp2gdl90::protocol::HasValidOwnshipPosition(
-        XPLMGetDatad(g_state.lat_ref), XPLMGetDatad(g_state.lon_ref));
-    const auto heartbeat = g_state.encoder->createHeartbeat(gps_valid, true);
-    const int sent = g_state.broadcaster->send(heartbeat);
+// Encodes and sends the ownship report for `frame`, dead-reckoned over
+// `lead_s` plus the sender's lead. Returns the bytes it put out.
+size_t SendOwnshipReport(const FrameContext &frame, const Settings &cfg,
+                         double lead_s) {
+  gdl90::PositionData ownship = GetOwnshipData(cfg, frame);
+  xp2gdl90::traffic::ExtrapolateReport(lead_s + SenderLeadSeconds(),
+                                       cfg.extrapolation_horizon_s, &ownship);
+  // Every other held field follows the settings.
+  if (!(ownship.callsign == g_state.ownship_frame_callsign)) {
+    g_state.ownship_frame_callsign = ownship.callsign;
+    g_state.ownship_frame.invalidate();
+  }
+  const size_t size =
+      g_state.encoder->encodeOwnshipReportInto(ownship, g_state.ownship_frame);
+  const int sent = SendMessage(g_state.ownship_frame.frame().data(), size,
+                               xp2gdl90::MESSAGE_OWNSHIP);
+  g_state.last_position_send_bytes = sent;
+  if (sent >= 0) {
+    g_state.position_packets_sent++;
+  }
+  RecordSend(xp2gdl90::SendClass::OWNSHIP, frame.broadcast_time,
+             1.0 / cfg.position_rate);
+  g_state.last_position = frame.broadcast_time;
+  return size;
+}
+
+// Encodes and sends one message class. Returns the bytes it put out.
+size_t SendMessageClass(xp2gdl90::SendClass send_class,
+                        const FrameContext &frame, const Settings &cfg) {
+  // Collection and sending are timed by their own stages.
+  XP2GDL90_STAGE_TIMER(&g_state.stage_timings, xp2gdl90::Stage::ENCODE);
+  const double broadcast_time = frame.broadcast_time;
+  switch (send_class) {
+  case xp2gdl90::SendClass::HEARTBEAT: {
+    const size_t size = g_state.encoder->encodeHeartbeatInto(
+        frame.gps_valid, true, g_state.heartbeat_frame);
+    const int sent = SendMessage(g_state.heartbeat_frame.frame().data(), size,
+                                 xp2gdl90::MESSAGE_HEARTBEAT, true);
     g_state.last_heartbeat_send_bytes = sent;
     if (sent >= 0) {
-      g_state.bytes_sent += static_cast<uint64_t>(sent);
       g_state.heartbeat_packets_sent++;
-      g_state.last_send_error.clear();
-    } else {
-      g_state.last_send_error = g_state.broadcaster->getLastError();
     }
+    RecordSend(xp2gdl90::SendClass::HEARTBEAT, broadcast_time,
+               1.0 / cfg.heartbeat_rate);
     g_state.last_heartbeat = broadcast_time;
-  }
-
-  if (cfg.position_rate > 0.0f &&
-      broadcast_time - g_state.last_position >= (1.0f / cfg.position_rate)) {
-    const gdl90::PositionData ownship = GetOwnshipData(cfg);
-    const auto position_msg = g_state.encoder->createOwnshipReport(ownship);
-    const int sent = g_state.broadcaster->send(position_msg);
-    g_state.last_position_send_bytes = sent;
-    if (sent >= 0) {
-      g_state.bytes_sent += static_cast<uint64_t>(sent);
-      g_state.position_packets_sent++;
-      g_state.last_send_error.clear();
-    } else {
-      g_state.last_send_error = g_state.broadcaster->getLastError();
-    }
-    g_state.last_position = broadcast_time;
-  }
-
-  if (broadcast_time - g_state.last_geo_altitude >=
-      (1.0f / kOwnshipGeoAltitudeRate)) {
-    const auto geo_altitude = g_state.encoder->createOwnshipGeometricAltitude(
-        GetOwnshipGeoAltitudeData());
-    const int sent = g_state.broadcaster->send(geo_altitude);
+    return size;
+  }
+  case xp2gdl90::SendClass::OWNSHIP:
+    return SendOwnshipReport(frame, cfg, 0.0);
+  case xp2gdl90::SendClass::GEO_ALTITUDE: {
+    const size_t size = g_state.encoder->encodeOwnshipGeometricAltitudeInto(
+        GetOwnshipGeoAltitudeData(frame), g_state.geo_altitude_frame);
+    const int sent = SendMessage(g_state.geo_altitude_frame.frame().data(),
+                                 size, xp2gdl90::MESSAGE_OWNSHIP);
     g_state.last_geo_altitude_send_bytes = sent;
     if (sent >= 0) {
-      g_state.bytes_sent += static_cast<uint64_t>(sent);
       g_state.geo_altitude_packets_sent++;
-      g_state.last_send_error.clear();
-    } else {
-      g_state.last_send_error = g_state.broadcaster->getLastError();
     }
+    RecordSend(xp2gdl90::SendClass::GEO_ALTITUDE, broadcast_time,
+               xp2gdl90::PeriodForRate(cfg.geo_altitude_rate));
     g_state.last_geo_altitude = broadcast_time;
+    return size;
+  }
+  case xp2gdl90::SendClass::AHRS: {
+    // Encoded fresh each time, straight into a block the sender thread
+    // sends without copying; with the pool dry, into a local copy.
+    gdl90::FrameRef ahrs = g_state.engine.acquireFrame();
+    gdl90::FrameBuffer local;
+    const size_t size = g_state.foreflight_encoder->encodeAhrsMessageInto(
+        GetOwnshipAhrsData(frame, cfg), ahrs ? *ahrs.buffer() : local);
+    const int sent =
+        ahrs ? SendMessage(ahrs, xp2gdl90::MESSAGE_AHRS)
+             : SendMessage(local.data(), local.size(), xp2gdl90::MESSAGE_AHRS);
+    g_state.last_ahrs_send_bytes = sent;
+    if (sent >= 0) {
+      g_state.ahrs_packets_sent++;
+    }
+    RecordSend(xp2gdl90::SendClass::AHRS, broadcast_time,
+               xp2gdl90::PeriodForRate(cfg.ahrs_rate));
+    g_state.last_ahrs = broadcast_time;
+    return size;
   }
-
-  if (broadcast_time - g_state.last_device_info >=
-      (1.0f / kForeFlightDeviceInfoRate)) {
-    const auto device_info =
-        g_state.foreflight_encoder->createIdMessage(GetForeFlightDeviceInfo());
-    const int sent = g_state.broadcaster->send(device_info);
+  case xp2gdl90::SendClass::DEVICE_INFO: {
+    if (!g_state.device_info_frame.valid()) {
+      g_state.foreflight_encoder->encodeIdMessageInto(
+          GetForeFlightDeviceInfo(cfg), g_state.device_info_frame);
+    }
+    const gdl90::FrameBuffer &info = g_state.device_info_frame.frame();
+    const size_t size = info.size();
+    const int sent =
+        SendMessage(info.data(), size, xp2gdl90::MESSAGE_FOREFLIGHT_ID);
     g_state.last_device_info_send_bytes = sent;
     if (sent >= 0) {
-      g_state.bytes_sent += static_cast<uint64_t>(sent);
       g_state.device_info_packets_sent++;
-      g_state.last_send_error.clear();
-    } else {
-      g_state.last_send_error = g_state.broadcaster->getLastError();
     }
+    RecordSend(xp2gdl90::SendClass::DEVICE_INFO, broadcast_time,
+               xp2gdl90::PeriodForRate(cfg.device_info_rate));
     g_state.last_device_info = broadcast_time;
+    return size;
+  }
+  case xp2gdl90::SendClass::TRAFFIC:
+    return SendTrafficReports(frame, cfg);
   }
+  return 0;
+}
 
-  if (broadcast_time - g_state.last_ahrs >= (1.0f / kForeFlightAhrsRate)) {
-    const auto ahrs_msg =
-        g_state.foreflight_encoder->createAhrsMessage(GetOwnshipAhrsData());
-    const int sent = g_state.broadcaster->send(ahrs_msg);
-    g_state.last_ahrs_send_bytes = sent;
-    if (sent >= 0) {
-      g_state.bytes_sent += static_cast<uint64_t>(sent);
-      g_state.ahrs_packets_sent++;
-      g_state.last_send_error.clear();
-    } else {
-      g_state.last_send_error = g_state.broadcaster->getLastError();
+float FlightLoopCallback(float in_elapsed_since_last_call,
+                         float in_elapsed_time_since_last_flight_loop,
+                         int in_counter, void *in_refcon) {
+  (void)in_elapsed_since_last_call;
+  (void)in_counter;
+  (void)in_refcon;
+
+  if (!g_state.enabled || !g_state.initialized) {
+    return -1.0f;
+  }
+
+  ApplyPendingSettingsLoad();
+  if (!g_state.settings_ready) {
+    if (xp2gdl90::MonotonicSeconds() < g_state.settings_wait_deadline) {
+      return -1.0f;
     }
-    g_state.last_ahrs = broadcast_time;
+    g_state.settings_ready = true;
+    LogMessage("Settings still loading; broadcasting with current settings");
+  }
+
+  ++g_state.flight_loop_calls;
+  xp2gdl90::BroadcastClockResult clock;
+  {
+    XP2GDL90_STAGE_TIMER(&g_state.stage_timings, xp2gdl90::Stage::CLOCK);
+    clock = UpdateCurrentBroadcastClock();
   }
+  const double broadcast_time = clock.time;
+  // One snapshot for the whole tick, even if settings change meanwhile.
+  const SettingsSnapshot settings = CurrentSettings();
+  const Settings &cfg = *settings;
 
-  SendTrafficReports(broadcast_time, cfg);
+  PollForeFlightDiscovery(broadcast_time, cfg);
+  RefreshBroadcastTarget(broadcast_time, cfg);
+  g_state.broadcaster->updateBandwidth(xp2gdl90::MonotonicSeconds());
+
+  ConfigureOutputScheduler(cfg);
+  xp2gdl90::OutputScheduler &scheduler = g_state.output_scheduler;
+  // The flight loop runs once per frame at most, so frames are the ticks.
+  scheduler.setTickInterval(in_elapsed_time_since_last_flight_loop);
+  scheduler.beginTick(broadcast_time, xp2gdl90::MonotonicSeconds());
+  xp2gdl90::SendClass send_class = xp2gdl90::SendClass::HEARTBEAT;
+  if (scheduler.next(xp2gdl90::MonotonicSeconds(), &send_class)) {
+    const FrameContext frame = ReadFrameContext(broadcast_time);
+    do {
+      const size_t bytes = SendMessageClass(send_class, frame, cfg);
+      scheduler.complete(send_class, bytes, xp2gdl90::MonotonicSeconds());
+    } while (scheduler.next(xp2gdl90::MonotonicSeconds(), &send_class));
+  }
+  TakeWorkerTrafficSweep(broadcast_time);
+  SendPacedTraffic(broadcast_time);
+  FlushPackedDatagrams();
+  g_state.stage_timings.endTick();
+  UpdateStatsHistory();
+  SendMetricsReport(xp2gdl90::MonotonicSeconds(), cfg);
+
+  return NextFlightLoopInterval(broadcast_time);
+}
+
+// Runs right after each flight model step. While ownship_high_rate is on,
+// samples ownship there and sends it when due, so a report leaves as soon
+// as the position it carries exists instead of a frame later. Each report
+// is dead-reckoned from the sample to its slot on the period grid, which
+// keeps the reports evenly spaced however the frame rate varies.
+float OwnshipSamplerCallback(float in_elapsed_since_last_call,
+                             float in_elapsed_time_since_last_flight_loop,
+                             int in_counter, void *in_refcon) {
+  (void)in_elapsed_since_last_call;
+  (void)in_counter;
+  (void)in_refcon;
 
+  if (!g_state.enabled || !g_state.initialized || !g_state.settings_ready) {
+    return kOwnshipSamplerIdleInterval;
+  }
+  const SettingsSnapshot settings = CurrentSettings();
+  const Settings &cfg = *settings;
+  if (!cfg.ownship_high_rate) {
+    return kOwnshipSamplerIdleInterval;
+  }
+
+  // The simulator clock has moved on since the main flight loop read it.
+  const double sample_time = UpdateCurrentBroadcastClock().time;
+  xp2gdl90::OutputScheduler &scheduler = g_state.ownship_scheduler;
+  scheduler.setTickInterval(in_elapsed_time_since_last_flight_loop);
+  scheduler.beginTick(sample_time, xp2gdl90::MonotonicSeconds());
+  xp2gdl90::SendClass send_class = xp2gdl90::SendClass::OWNSHIP;
+  if (scheduler.next(xp2gdl90::MonotonicSeconds(), &send_class)) {
+    const double slot = scheduler.release(send_class);
+    const FrameContext frame = ReadFrameContext(sample_time);
+    const size_t bytes = SendOwnshipReport(
+        frame, cfg, std::isfinite(slot) ? slot - sample_time : 0.0);
+    scheduler.complete(send_class, bytes, xp2gdl90::MonotonicSeconds());
+    FlushPackedDatagrams();
+  }
   return -1.0f;
 }
 
+void StartOwnshipSampler() {
+  if (g_state.ownship_sampler) {
+    return;
+  }
+  XPLMCreateFlightLoop_t params = {};
+  params.structSize = sizeof(params);
+  params.phase = xplm_FlightLoop_Phase_AfterFlightModel;
+  params.callbackFunc = OwnshipSamplerCallback;
+  params.refcon = nullptr;
+  g_state.ownship_sampler = XPLMCreateFlightLoop(&params);
+  XPLMScheduleFlightLoop(g_state.ownship_sampler, -1.0f, 1);
+}
+
+void StopOwnshipSampler() {
+  if (g_state.ownship_sampler) {
+    XPLMDestroyFlightLoop(g_state.ownship_sampler);
+    g_state.ownship_sampler = nullptr;
+  }
+}
+
 void MenuHandlerCallback(void *in_menu_ref, void *in_item_ref) {
   (void)in_menu_ref;
 
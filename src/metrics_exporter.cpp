@@ -0,0 +1,165 @@
+#include "xp2gdl90/metrics_exporter.h"
+
+#include <cstdio>
+
+namespace xp2gdl90 {
+
+void MetricsReport::begin(const std::string &source, double now) {
+  interval_s_ = std::isfinite(previous_time_) ? now - previous_time_ : 0.0;
+  previous_time_ = now;
+  ++sequence_;
+  counter_index_ = 0;
+
+  writer_.clear();
+  writer_.beginObject();
+  writer_.key("type");
+  writer_.stringValue("xp2gdl90.metrics");
+  writer_.key("version");
+  writer_.unsignedValue(METRICS_REPORT_VERSION);
+  writer_.key("source");
+  writer_.stringValue(source);
+  writer_.key("seq");
+  writer_.unsignedValue(sequence_);
+  writer_.key("interval_s");
+  writer_.numberValue(interval_s_);
+  writer_.key("metrics");
+  writer_.beginObject();
+}
+
+void MetricsReport::counter(const char *name, uint64_t total) {
+  double rate = 0.0;
+  if (counter_index_ < previous_counters_.size()) {
+    const uint64_t previous = previous_counters_[counter_index_];
+    // A counter that went backwards was reset; report no rate for it.
+    if (interval_s_ > 0.0 && total >= previous) {
+      rate = static_cast<double>(total - previous) / interval_s_;
+    }
+    previous_counters_[counter_index_] = total;
+  } else {
+    previous_counters_.push_back(total);
+  }
+  ++counter_index_;
+
+  writer_.key(name);
+  writer_.beginObject();
+  writer_.key("total");
+  writer_.unsignedValue(total);
+  writer_.key("rate");
+  writer_.numberValue(rate);
+  writer_.endObject();
+}
+
+void MetricsReport::gauge(const char *name, double value) {
+  writer_.key(name);
+  writer_.numberValue(value);
+}
+
+void MetricsReport::histogram(const char *name,
+                              const LatencyHistogram &histogram) {
+  writer_.key(name);
+  writer_.beginObject();
+  writer_.key("count");
+  writer_.unsignedValue(histogram.count());
+  writer_.key("p50_us");
+  writer_.numberValue(static_cast<double>(histogram.percentileNs(0.5)) / 1e3);
+  writer_.key("p90_us");
+  writer_.numberValue(static_cast<double>(histogram.percentileNs(0.9)) / 1e3);
+  writer_.key("p99_us");
+  writer_.numberValue(static_cast<double>(histogram.percentileNs(0.99)) /
+                      1e3);
+  writer_.key("max_us");
+  writer_.numberValue(static_cast<double>(histogram.maxNs()) / 1e3);
+  writer_.key("buckets");
+  writer_.beginArray();
+  for (size_t bucket = 0; bucket < LATENCY_HISTOGRAM_BUCKETS; ++bucket) {
+    const uint64_t count = histogram.bucketCount(bucket);
+    if (count == 0) {
+      continue;
+    }
+    writer_.beginArray();
+    writer_.unsignedValue(LatencyHistogram::bucketUpperNs(bucket));
+    writer_.unsignedValue(count);
+    writer_.endArray();
+  }
+  writer_.endArray();
+  writer_.endObject();
+}
+
+void AddSendIntervalMetrics(const SendIntervalTable &intervals,
+                            MetricsReport *report) {
+  // Indexed by SendClass.
+  static constexpr const char *kNames[SEND_CLASS_COUNT] = {
+      "sends.heartbeat", "sends.ownship",     "sends.geo_altitude",
+      "sends.ahrs",      "sends.device_info", "sends.traffic"};
+  for (size_t i = 0; i < SEND_CLASS_COUNT; ++i) {
+    report->counter(kNames[i], intervals[i].count());
+  }
+}
+
+void AddStageTimingMetrics(const StageTimings &timings, MetricsReport *report) {
+  for (size_t i = 0; i < STAGE_COUNT; ++i) {
+    const auto stage = static_cast<Stage>(i);
+    char name[48];
+    std::snprintf(name, sizeof(name), "tick.%s", StageKey(stage));
+    report->histogram(name, timings.histogram(stage));
+  }
+}
+
+const std::string &MetricsReport::finish() {
+  writer_.endObject();
+  writer_.endObject();
+  return writer_.text();
+}
+
+bool MetricsExporter::open(const std::string &ip, uint16_t port,
+                           double interval_s, std::string *out_error) {
+  close();
+  auto broadcaster =
+      std::make_unique<udp::UDPBroadcaster>(ip, port, socket_ops_);
+  if (!broadcaster->initialize()) {
+    if (out_error) {
+      *out_error = "Cannot open metrics socket to " + ip + ":" +
+                   std::to_string(port) + ": " + broadcaster->getLastError();
+    }
+    return false;
+  }
+  broadcaster_ = std::move(broadcaster);
+  ip_ = ip;
+  port_ = port;
+  interval_s_ = interval_s;
+  next_report_ = 0.0;
+  report_ = MetricsReport{};
+  return true;
+}
+
+void MetricsExporter::close() {
+  broadcaster_.reset();
+  ip_.clear();
+  port_ = 0;
+}
+
+MetricsReport &MetricsExporter::begin(const std::string &source, double now) {
+  // Schedules from now rather than the missed deadline, so a stalled loop
+  // sends one late report instead of a burst.
+  next_report_ = now + interval_s_;
+  report_.begin(source, now);
+  return report_;
+}
+
+bool MetricsExporter::send(std::string *out_error) {
+  const std::string &text = report_.finish();
+  if (!broadcaster_ ||
+      broadcaster_->send(reinterpret_cast<const uint8_t *>(text.data()),
+                         text.size()) < 0) {
+    ++send_errors_;
+    if (out_error) {
+      *out_error = broadcaster_ ? broadcaster_->getLastError()
+                                : std::string("Metrics exporter is closed");
+    }
+    return false;
+  }
+  ++reports_sent_;
+  return true;
+}
+
+} // namespace xp2gdl90
@@ -1,12 +1,17 @@
 #include "xp2gdl90/msfs_bridge.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 #include <limits>
+#include <string_view>
 
 #include "xp2gdl90/foreflight_encoder.h"
 #include "xp2gdl90/protocol_utils.h"
+#include "xp2gdl90/traffic_selection.h"
+#include "xp2gdl90/traffic_support.h"
 
 namespace msfs_bridge {
 
@@ -14,6 +19,8 @@ namespace {
 
 constexpr double kRadiansToDegrees = 57.29577951308232;
 constexpr double kFeetPerSecondToFeetPerMinute = 60.0;
+constexpr double kFeetToMeters = 0.3048;
+constexpr double kKnotsToMetersPerSecond = 1852.0 / 3600.0;
 
 template <typename Int, typename Float> Int ClampFloatToInt(Float value) {
   if (!std::isfinite(static_cast<double>(value))) {
@@ -29,6 +36,37 @@ template <typename Int, typename Float> Int ClampFloatToInt(Float value) {
   return static_cast<Int>(value);
 }
 
+// Claims the track table row for `object_id` and writes the kinematic
+// columns. `Sample` is TrafficData or the packed TrafficSimData, which share
+// field names.
+template <typename Sample>
+size_t WriteTrafficSample(xp2gdl90::traffic::TrackTable *tracks,
+                          xp2gdl90::traffic::TrafficSnapshot *snapshot,
+                          uint32_t object_id, const Sample &sample,
+                          double now) {
+  const size_t row = tracks->upsert(object_id, now);
+  if (row == snapshot->size()) {
+    snapshot->append();
+  }
+
+  snapshot->source_id[row] = object_id;
+  snapshot->latitude[row] = sample.latitude_deg;
+  snapshot->longitude[row] = sample.longitude_deg;
+  snapshot->altitude_ft[row] = sample.altitude_ft;
+  // SimConnect world velocity is +z north; the snapshot frame is +z south.
+  snapshot->vx[row] =
+      static_cast<float>(sample.velocity_world_x_fps * kFeetToMeters);
+  snapshot->vy[row] =
+      static_cast<float>(sample.velocity_world_y_fps * kFeetToMeters);
+  snapshot->vz[row] =
+      static_cast<float>(-sample.velocity_world_z_fps * kFeetToMeters);
+  snapshot->ground_speed_kt[row] =
+      static_cast<float>(sample.ground_velocity_kt);
+  snapshot->heading_deg[row] = static_cast<float>(sample.true_heading_deg);
+  tracks->setPosition(row, sample.latitude_deg, sample.longitude_deg);
+  return row;
+}
+
 } // namespace
 
 double NormalizeDegrees360(double degrees) {
@@ -89,6 +127,21 @@ uint32_t SyntheticTrafficAddress(uint32_t object_id) {
   return 0xF00000u | (x & 0x0FFFFFu);
 }
 
+gdl90::Callsign SimConnectCallsign(const char *value, size_t size) {
+  if (!value || size == 0) {
+    return {};
+  }
+  const void *end = std::memchr(value, '\0', size);
+  std::string_view text(value, end ? static_cast<const char *>(end) - value
+                                   : size);
+  const size_t start = text.find_first_not_of(" \t\r\n");
+  if (start == std::string_view::npos) {
+    return {};
+  }
+  text.remove_prefix(start);
+  return xp2gdl90::protocol::MakeCallsign(text);
+}
+
 gdl90::PositionData BuildOwnshipPosition(const OwnshipData &sim,
                                          const xp2gdl90::Settings &cfg) {
   const bool gps_valid = xp2gdl90::protocol::HasValidOwnshipPosition(
@@ -109,9 +162,9 @@ gdl90::PositionData BuildOwnshipPosition(const OwnshipData &sim,
   data.nacp = cfg.nacp;
   data.icao_address = cfg.icao_address;
   data.address_type = gdl90::AddressType::ADSB_ICAO;
-  data.callsign = xp2gdl90::protocol::SanitizeCallsign(sim.callsign);
+  data.callsign = xp2gdl90::protocol::MakeCallsign(sim.callsign.view());
   if (data.callsign.empty()) {
-    data.callsign = xp2gdl90::protocol::SanitizeCallsign(cfg.callsign);
+    data.callsign = xp2gdl90::protocol::MakeCallsign(cfg.callsign);
   }
   data.emitter_category =
       static_cast<gdl90::EmitterCategory>(cfg.emitter_category);
@@ -154,55 +207,250 @@ gdl90::foreflight::DeviceInfo BuildDeviceInfo(const xp2gdl90::Settings &cfg) {
 bool BuildTrafficPosition(const TrafficData &traffic,
                           const xp2gdl90::Settings &cfg,
                           gdl90::PositionData *out_data) {
-  if (!out_data || !xp2gdl90::protocol::HasValidOwnshipPosition(
-                       traffic.latitude_deg, traffic.longitude_deg)) {
+  if (!out_data) {
+    return false;
+  }
+
+  xp2gdl90::traffic::TrackTable tracks;
+  xp2gdl90::traffic::TrafficSnapshot snapshot;
+  UpsertTrafficTarget(&tracks, &snapshot, traffic, 0.0);
+  std::vector<gdl90::PositionData> reports;
+  if (BuildTrafficPositions(&snapshot, cfg, nullptr, nullptr, &reports) == 0) {
     return false;
   }
+  *out_data = reports.front();
+  return true;
+}
+
+size_t UpsertTrafficTarget(xp2gdl90::traffic::TrackTable *tracks,
+                           xp2gdl90::traffic::TrafficSnapshot *snapshot,
+                           const TrafficData &traffic, double now) {
+  using namespace xp2gdl90::traffic;
+
+  const size_t row =
+      WriteTrafficSample(tracks, snapshot, traffic.object_id, traffic, now);
+  snapshot->callsign[row] = MakeTrafficCallsign(
+      xp2gdl90::protocol::MakeCallsign(traffic.callsign.view()));
+
+  uint8_t flags = traffic.sim_on_ground ? TRAFFIC_FLAG_ON_GROUND : 0u;
+  if (traffic.icao_address != 0) {
+    snapshot->raw_address[row] = static_cast<int>(traffic.icao_address);
+    snapshot->address[row] = traffic.icao_address & 0x00FFFFFFu;
+  } else {
+    snapshot->raw_address[row] = 0;
+    snapshot->address[row] = SyntheticTrafficAddress(traffic.object_id);
+    flags |= TRAFFIC_FLAG_SYNTHETIC_ADDRESS;
+  }
+  snapshot->flags[row] = flags;
+  return row;
+}
+
+size_t UpsertTrafficTargets(xp2gdl90::traffic::TrackTable *tracks,
+                            xp2gdl90::traffic::TrafficSnapshot *snapshot,
+                            const TrafficSimView *views, size_t count,
+                            double now) {
+  using namespace xp2gdl90::traffic;
+
+  size_t valid = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const TrafficSimData &sim = *views[i].data;
+    const uint32_t object_id = views[i].object_id;
+    const size_t row =
+        WriteTrafficSample(tracks, snapshot, object_id, sim, now);
+    snapshot->callsign[row] =
+        MakeTrafficCallsign(SimConnectCallsign(sim.atc_id, sizeof(sim.atc_id)));
+    // The data definition carries no ICAO address.
+    snapshot->raw_address[row] = 0;
+    snapshot->address[row] = SyntheticTrafficAddress(object_id);
+    snapshot->flags[row] = static_cast<uint8_t>(
+        TRAFFIC_FLAG_SYNTHETIC_ADDRESS |
+        (sim.sim_on_ground != 0 ? TRAFFIC_FLAG_ON_GROUND : 0u));
+    valid += xp2gdl90::protocol::HasValidOwnshipPosition(sim.latitude_deg,
+                                                         sim.longitude_deg)
+                 ? 1u
+                 : 0u;
+  }
+  return valid;
+}
+
+xp2gdl90::traffic::TrafficReference
+OwnshipTrafficReference(const OwnshipData &sim) {
+  // SimConnect reports heading rather than track; it stands in for the
+  // velocity direction.
+  const double heading = sim.true_heading_deg / kRadiansToDegrees;
+  const double speed = sim.ground_velocity_kt * kKnotsToMetersPerSecond;
+  xp2gdl90::traffic::TrafficReference reference;
+  reference.latitude_deg = sim.latitude_deg;
+  reference.longitude_deg = sim.longitude_deg;
+  reference.altitude_ft = sim.altitude_ft;
+  reference.vx = speed * std::sin(heading);
+  reference.vy = sim.vertical_speed_fps * kFeetToMeters;
+  reference.vz = -speed * std::cos(heading);
+  return reference;
+}
+
+namespace {
+
+// Appends a candidate for each of `rows` that is valid and measurable.
+void MeasureCandidateRows(
+    const xp2gdl90::traffic::TrafficSnapshot &snapshot,
+    const xp2gdl90::traffic::TrafficReference &reference, const uint32_t *rows,
+    size_t count, std::vector<xp2gdl90::traffic::TrafficCandidate> *out) {
+  using namespace xp2gdl90::traffic;
+
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t row = rows[i];
+    TrafficCandidate candidate;
+    if (row < snapshot.size() &&
+        (snapshot.flags[row] & TRAFFIC_FLAG_VALID) != 0u &&
+        MeasureGeodeticTarget(row, reference, snapshot.latitude[row],
+                              snapshot.longitude[row],
+                              snapshot.altitude_ft[row], snapshot.vx[row],
+                              snapshot.vz[row], &candidate)) {
+      out->push_back(candidate);
+    }
+  }
+}
 
-  const double speed = (std::max)(0.0, traffic.ground_velocity_kt);
+// Builds the report for row `i`, or returns false if it is not valid.
+bool BuildRowPosition(const xp2gdl90::traffic::TrafficSnapshot &snapshot,
+                      const xp2gdl90::Settings &cfg, size_t i,
+                      gdl90::PositionData *out_data) {
+  using namespace xp2gdl90::traffic;
+
+  const uint8_t flags = snapshot.flags[i];
+  if ((flags & TRAFFIC_FLAG_VALID) == 0u) {
+    return false;
+  }
 
   // Prefer velocity-vector track over heading when the aircraft is moving.
-  double track = traffic.true_heading_deg;
-  if (std::isfinite(traffic.velocity_world_x_fps) &&
-      std::isfinite(traffic.velocity_world_z_fps) &&
-      std::hypot(traffic.velocity_world_x_fps, traffic.velocity_world_z_fps) >
-          1.0) {
-    track =
-        std::atan2(traffic.velocity_world_x_fps, traffic.velocity_world_z_fps) *
-        kRadiansToDegrees;
+  const double vx = snapshot.vx[i];
+  const double vz = snapshot.vz[i];
+  double track = snapshot.heading_deg[i];
+  if (std::isfinite(vx) && std::isfinite(vz) &&
+      std::hypot(vx, vz) > kFeetToMeters) {
+    track = std::atan2(vx, -vz) * kRadiansToDegrees;
   }
 
-  gdl90::PositionData data;
-  data.latitude = traffic.latitude_deg;
-  data.longitude = traffic.longitude_deg;
-  data.altitude = ClampFloatToInt<int32_t>(traffic.altitude_ft);
-  data.h_velocity = ClampFloatToInt<uint16_t>(speed);
-  data.v_velocity = ClampFpmToInt16OrInvalid(traffic.velocity_world_y_fps *
-                                             kFeetPerSecondToFeetPerMinute);
+  gdl90::PositionData &data = *out_data;
+  data = gdl90::PositionData{};
+  data.latitude = snapshot.latitude[i];
+  data.longitude = snapshot.longitude[i];
+  data.altitude = ClampFloatToInt<int32_t>(snapshot.altitude_ft[i]);
+  data.h_velocity = snapshot.h_velocity_kt[i];
+  data.v_velocity = snapshot.v_velocity_fpm[i];
   data.track = NormalizeDegreesToUint16(track);
   data.track_type = gdl90::TrackType::TRUE_TRACK;
-  data.airborne = !traffic.sim_on_ground;
+  data.airborne = (flags & TRAFFIC_FLAG_ON_GROUND) == 0u;
   data.nic = cfg.nic;
   data.nacp = cfg.nacp;
-
-  if (traffic.icao_address != 0) {
-    data.icao_address = traffic.icao_address & 0x00FFFFFFu;
-    data.address_type = gdl90::AddressType::ADSB_ICAO;
-  } else {
-    data.icao_address = SyntheticTrafficAddress(traffic.object_id);
-    data.address_type = gdl90::AddressType::ADSB_SELF_ASSIGNED;
-  }
-
-  data.callsign = xp2gdl90::protocol::SanitizeCallsign(traffic.callsign);
+  data.icao_address = snapshot.address[i];
+  data.address_type = (flags & TRAFFIC_FLAG_SYNTHETIC_ADDRESS) != 0u
+                          ? gdl90::AddressType::ADSB_SELF_ASSIGNED
+                          : gdl90::AddressType::ADSB_ICAO;
+  data.callsign = ToCallsign(snapshot.callsign[i]);
   if (data.callsign.empty()) {
-    char fallback[9] = {};
+    char fallback[gdl90::CALLSIGN_SIZE + 1] = {};
     std::snprintf(fallback, sizeof(fallback), "M%06X",
                   static_cast<unsigned int>(data.icao_address & 0xFFFFFFu));
     data.callsign = fallback;
   }
   data.emitter_category = gdl90::EmitterCategory::NO_INFO;
-  *out_data = data;
   return true;
 }
 
+} // namespace
+
+size_t BuildTrafficPositions(
+    xp2gdl90::traffic::TrafficSnapshot *snapshot,
+    const xp2gdl90::Settings &cfg, const OwnshipData *ownship,
+    const std::vector<uint32_t> *candidate_rows,
+    std::vector<gdl90::PositionData> *out_reports,
+    xp2gdl90::traffic::ParallelTrafficBuild *parallel) {
+  using namespace xp2gdl90::traffic;
+
+  if (!snapshot || !out_reports) {
+    return 0;
+  }
+  const size_t rows = snapshot->size();
+  if (!parallel || !parallel->fansOut(rows)) {
+    if (MarkValidGeodeticTargets(snapshot) == 0) {
+      return 0;
+    }
+    if (ownship) {
+      const TrafficReference reference = OwnshipTrafficReference(*ownship);
+      std::vector<TrafficCandidate> candidates;
+      if (candidate_rows) {
+        candidates.reserve(candidate_rows->size());
+        MeasureCandidateRows(*snapshot, reference, candidate_rows->data(),
+                             candidate_rows->size(), &candidates);
+      } else {
+        candidates.reserve(rows);
+        MeasureGeodeticTraffic(*snapshot, reference, &candidates);
+      }
+      SelectNearestTraffic(MakeTrafficSelection(cfg), &candidates, snapshot);
+    }
+    ConvertTrafficVelocities(snapshot);
+
+    const size_t budget = cfg.traffic_max_targets;
+    size_t built = 0;
+    for (size_t i = 0; i < rows && built < budget; ++i) {
+      gdl90::PositionData data;
+      if (BuildRowPosition(*snapshot, cfg, i, &data)) {
+        out_reports->push_back(data);
+        ++built;
+      }
+    }
+    return built;
+  }
+
+  // The same passes a chunk of rows at a time; the selection and the budget
+  // are applied to the merged chunks in row order.
+  const size_t grain = parallel->grain;
+  xp2gdl90::TaskPool &pool = *parallel->pool;
+  std::atomic<size_t> valid{0};
+  const bool measure_rows = ownship && !candidate_rows;
+  const TrafficReference reference =
+      ownship ? OwnshipTrafficReference(*ownship) : TrafficReference{};
+  parallel->candidates.reset(parallel->chunks(rows));
+  pool.parallelFor(rows, grain, [&](size_t begin, size_t end) {
+    valid.fetch_add(MarkValidGeodeticTargets(snapshot, begin, end),
+                    std::memory_order_relaxed);
+    if (measure_rows) {
+      MeasureGeodeticTraffic(*snapshot, reference, begin, end,
+                             &parallel->candidates[begin / grain]);
+    }
+  });
+  if (valid.load() == 0) {
+    return 0;
+  }
+  if (ownship) {
+    std::vector<TrafficCandidate> candidates;
+    if (candidate_rows) {
+      const size_t queried = candidate_rows->size();
+      parallel->candidates.reset(parallel->chunks(queried));
+      pool.parallelFor(queried, grain, [&](size_t begin, size_t end) {
+        MeasureCandidateRows(*snapshot, reference,
+                             candidate_rows->data() + begin, end - begin,
+                             &parallel->candidates[begin / grain]);
+      });
+    }
+    parallel->candidates.appendTo(&candidates);
+    SelectNearestTraffic(MakeTrafficSelection(cfg), &candidates, snapshot);
+  }
+
+  parallel->reports.reset(parallel->chunks(rows));
+  pool.parallelFor(rows, grain, [&](size_t begin, size_t end) {
+    ConvertTrafficVelocities(snapshot, begin, end);
+    std::vector<gdl90::PositionData> &chunk = parallel->reports[begin / grain];
+    for (size_t i = begin; i < end; ++i) {
+      gdl90::PositionData data;
+      if (BuildRowPosition(*snapshot, cfg, i, &data)) {
+        chunk.push_back(data);
+      }
+    }
+  });
+  return parallel->reports.appendTo(out_reports, cfg.traffic_max_targets);
+}
+
 } // namespace msfs_bridge
@@ -4,11 +4,12 @@
 
 #include <d3d11.h>
 #include <dxgi.h>
+#include <shellapi.h>
 #include <tchar.h>
 
 #include <algorithm>
+#include <array>
 #include <atomic>
-#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
@@ -22,22 +23,50 @@
 #include <mutex>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
 #include "backends/imgui_impl_dx11.h"
 #include "backends/imgui_impl_win32.h"
 #include "imgui.h"
 
+#include "xp2gdl90/bandwidth_accounting.h"
+#include "xp2gdl90/broadcast_clock.h"
+#include "xp2gdl90/broadcast_engine.h"
+#include "xp2gdl90/cached_frame.h"
+#include "xp2gdl90/compact_capture.h"
+#include "xp2gdl90/datagram_packer.h"
+#include "xp2gdl90/foreflight_discovery.h"
 #include "xp2gdl90/foreflight_encoder.h"
 #include "xp2gdl90/foreflight_protocol.h"
 #include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/metrics_exporter.h"
+#include "xp2gdl90/mpsc_ring.h"
 #include "xp2gdl90/msfs_bridge.h"
+#include "xp2gdl90/output_scheduler.h"
 #include "xp2gdl90/protocol_utils.h"
 #include "xp2gdl90/settings.h"
 #include "xp2gdl90/settings_ui.h"
+#include "xp2gdl90/shared_output.h"
+#include "xp2gdl90/stage_timing.h"
+#include "xp2gdl90/stats_history.h"
+#include "xp2gdl90/status_panels.h"
+#include "xp2gdl90/stream_capture.h"
 #include "xp2gdl90/simconnect_compat.h"
+#include "xp2gdl90/task_pool.h"
+#include "xp2gdl90/thread_tuning.h"
+#include "xp2gdl90/traffic_build.h"
+#include "xp2gdl90/traffic_extrapolation.h"
+#include "xp2gdl90/traffic_frame_cache.h"
+#include "xp2gdl90/traffic_pacer.h"
+#include "xp2gdl90/traffic_projection.h"
+#include "xp2gdl90/traffic_relay.h"
+#include "xp2gdl90/traffic_scheduler.h"
 #include "xp2gdl90/udp_broadcaster.h"
 #include "xp2gdl90/udp_receiver.h"
+#include "xp2gdl90/utc_clock.h"
 
 // Forward declaration required by imgui_impl_win32.
 extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND, UINT, WPARAM,
@@ -49,15 +78,18 @@ namespace {
 // Constants
 // ---------------------------------------------------------------------------
 
-constexpr double kTrafficReportRate = 1.0;
-constexpr double kForeFlightDeviceRate = 1.0;
-constexpr double kForeFlightAhrsRate = 5.0;
-constexpr double kGeoAltitudeRate = 1.0;
 constexpr double kForeFlightDiscoveryTimeout = 15.0;
-constexpr DWORD kTrafficRadiusMeters = 20000;
 constexpr int kLogMaxLines = 500;
+constexpr size_t kLogRingCapacity = 1024;
+constexpr size_t kLogTextSize = 192;
+// Mapped as Local\msfs2gdl90.
+constexpr const char *kSharedOutputName = "msfs2gdl90";
 constexpr float kWindowWidth = 960.0f;
 constexpr float kWindowHeight = 680.0f;
+// Redraw rate while the window is visible but not focused.
+constexpr double kUnfocusedFrameInterval = 0.25;
+// How often a minimized or fully covered window checks whether it is shown.
+constexpr DWORD kHiddenPollMs = 250;
 
 // ---------------------------------------------------------------------------
 // SimConnect data structures (must match AddSimVar order exactly)
@@ -68,7 +100,10 @@ enum DataRequestId {
   kRequestOwnship = 1,
   kRequestTrafficAircraft = 2,
   kRequestTrafficHelicopter = 3,
+  // Per-object traffic subscriptions use this plus the object ID.
+  kRequestTrafficObjectBase = 0x100,
 };
+enum SystemEventId { kEventObjectAdded = 1, kEventObjectRemoved = 2 };
 
 #pragma pack(push, 1)
 struct OwnshipSimData {
@@ -88,54 +123,156 @@ struct OwnshipSimData {
   INT32 sim_on_ground = 0;            // SIM ON GROUND, Bool, INT32
   char atc_id[32] = {};               // ATC ID, NULL, STRING32
 };
-
-struct TrafficSimData {
-  double latitude_deg = 0.0;       // PLANE LATITUDE, degrees, FLOAT64
-  double longitude_deg = 0.0;      // PLANE LONGITUDE, degrees, FLOAT64
-  double altitude_ft = 0.0;        // PLANE ALTITUDE, feet, FLOAT64
-  double ground_velocity_kt = 0.0; // GROUND VELOCITY, knots, FLOAT64
-  double velocity_world_x_fps =
-      0.0; // VELOCITY WORLD X, feet per second, FLOAT64
-  double velocity_world_y_fps =
-      0.0; // VELOCITY WORLD Y, feet per second, FLOAT64
-  double velocity_world_z_fps =
-      0.0;                       // VELOCITY WORLD Z, feet per second, FLOAT64
-  double true_heading_deg = 0.0; // PLANE HEADING DEGREES TRUE, degrees, FLOAT64
-  INT32 sim_on_ground = 0;       // SIM ON GROUND, Bool, INT32
-  char atc_id[32] = {};          // ATC ID, NULL, STRING32
-};
 #pragma pack(pop)
 
-struct TrafficEntry {
-  DWORD object_id = 0;
-  TrafficSimData data;
-};
-
 // ---------------------------------------------------------------------------
 // Log buffer
 // ---------------------------------------------------------------------------
 
+// Records are small PODs so that logging from the send path costs one
+// lock-free push; text is only formatted when the UI thread drains them.
+enum class LogCode : uint16_t {
+  TEXT,          // text
+  PACKET_SENT,   // args: bytes, total packets
+  OWNSHIP_DEBUG, // args: lat, lon, palt ft, gs kt, hdg, on ground; text: cs
+};
+
+struct LogRecord {
+  double time = 0.0;
+  LogCode code = LogCode::TEXT;
+  bool is_error = false;
+  double args[6] = {};
+  // Only read for codes that use it, so it is left uninitialised.
+  char text[kLogTextSize];
+};
+
 struct LogEntry {
   std::string text;
   bool is_error = false;
 };
 
 struct LogBuffer {
-  std::mutex mutex;
+  // Any thread pushes; the UI or headless main thread drains.
+  xp2gdl90::MpscRing<LogRecord> ring{kLogRingCapacity};
+  const double start_time = xp2gdl90::MonotonicSeconds();
+
+  // Drained lines, touched only by the draining thread.
   std::deque<LogEntry> entries;
   bool scroll_to_bottom = false;
+  // Headless mode copies every line to these, since no window shows
+  // `entries`.
+  std::vector<FILE *> sinks;
+  uint64_t dropped_seen = 0;
+
+  void Info(const std::string &text) { Text(false, text); }
+  void Error(const std::string &text) { Text(true, text); }
+
+  void PacketSent(size_t bytes, uint64_t total) {
+    LogRecord record = Record(LogCode::PACKET_SENT, false);
+    record.args[0] = static_cast<double>(bytes);
+    record.args[1] = static_cast<double>(total);
+    ring.push(record);
+  }
+
+  void OwnshipDebug(const msfs_bridge::OwnshipData &own) {
+    LogRecord record = Record(LogCode::OWNSHIP_DEBUG, false);
+    record.args[0] = own.latitude_deg;
+    record.args[1] = own.longitude_deg;
+    record.args[2] = own.pressure_altitude_ft;
+    record.args[3] = own.ground_velocity_kt;
+    record.args[4] = own.true_heading_deg;
+    record.args[5] = own.sim_on_ground ? 1.0 : 0.0;
+    CopyText(&record, own.callsign.str());
+    ring.push(record);
+  }
+
+  // Formats everything pushed so far into `entries` and the sinks.
+  void Drain() {
+    LogRecord record;
+    while (ring.pop(&record)) {
+      Append(record.time, record.is_error, Format(record));
+    }
+    const uint64_t dropped = ring.dropped();
+    if (dropped != dropped_seen) {
+      Append(xp2gdl90::MonotonicSeconds() - start_time, true,
+             std::to_string(dropped - dropped_seen) +
+                 " log lines dropped (log ring full)");
+      dropped_seen = dropped;
+    }
+  }
+
+  // Writes the lines drained so far to `sink`, then every new one.
+  void AddSink(FILE *sink) {
+    Drain();
+    for (const LogEntry &entry : entries) {
+      Write(sink, -1.0, entry);
+    }
+    sinks.push_back(sink);
+  }
+
+private:
+  LogRecord Record(LogCode code, bool is_error) const {
+    LogRecord record;
+    record.time = xp2gdl90::MonotonicSeconds() - start_time;
+    record.code = code;
+    record.is_error = is_error;
+    return record;
+  }
+
+  static void CopyText(LogRecord *record, std::string_view text) {
+    const size_t size = (std::min)(text.size(), sizeof(record->text) - 1);
+    std::memcpy(record->text, text.data(), size);
+    record->text[size] = '\0';
+  }
+
+  void Text(bool is_error, std::string_view text) {
+    LogRecord record = Record(LogCode::TEXT, is_error);
+    CopyText(&record, text);
+    ring.push(record);
+  }
 
-  void Add(bool is_error, std::string text) {
-    std::lock_guard<std::mutex> lock(mutex);
+  static std::string Format(const LogRecord &record) {
+    char buffer[kLogTextSize + 128];
+    switch (record.code) {
+    case LogCode::PACKET_SENT:
+      std::snprintf(buffer, sizeof(buffer), "Sent %.0f bytes (total %.0f)",
+                    record.args[0], record.args[1]);
+      return buffer;
+    case LogCode::OWNSHIP_DEBUG:
+      std::snprintf(buffer, sizeof(buffer),
+                    "[debug] ownship lat=%.6f lon=%.6f palt=%.0fft gs=%.1fkt "
+                    "hdg=%.1f gnd=%s cs=%s",
+                    record.args[0], record.args[1], record.args[2],
+                    record.args[3], record.args[4],
+                    record.args[5] != 0.0 ? "Y" : "N", record.text);
+      return buffer;
+    case LogCode::TEXT:
+    default:
+      return record.text;
+    }
+  }
+
+  void Append(double time, bool is_error, std::string text) {
     entries.push_back({std::move(text), is_error});
+    for (FILE *sink : sinks) {
+      Write(sink, time, entries.back());
+    }
     if (static_cast<int>(entries.size()) > kLogMaxLines) {
       entries.pop_front();
     }
     scroll_to_bottom = true;
   }
 
-  void Info(std::string text) { Add(false, std::move(text)); }
-  void Error(std::string text) { Add(true, std::move(text)); }
+  // Sink lines carry seconds since start; lines from before the sink was
+  // added are written without one.
+  static void Write(FILE *sink, double time, const LogEntry &entry) {
+    if (time >= 0.0) {
+      std::fprintf(sink, "[%10.3f] ", time);
+    }
+    std::fprintf(sink, "%s%s\n", entry.is_error ? "ERROR: " : "",
+                 entry.text.c_str());
+    std::fflush(sink);
+  }
 };
 
 LogBuffer g_log;
@@ -144,30 +281,86 @@ LogBuffer g_log;
 // Bridge state
 // ---------------------------------------------------------------------------
 
+// Owned by the bridge worker thread once it starts; the UI only sees a
+// BridgeStatus copy.
 struct BridgeState {
   xp2gdl90::Settings settings;
-  xp2gdl90::SettingsUiState ui_state;
   std::string settings_path;
   std::string override_target_ip;
   uint16_t override_target_port = 0;
-  bool settings_dirty = false;
-  std::string settings_last_error;
   bool debug_flag = false; // --debug CLI override
+  bool headless = false;   // --headless: no window, log to console and file
+  bool tray_icon = false;  // --tray: notification area icon when headless
 
   HANDLE simconnect = nullptr;
+  // Traffic objects with a change-only data subscription.
+  std::unordered_set<DWORD> traffic_subscriptions;
+  // Real object ID of the user aircraft, learned from ownship data.
+  DWORD user_object_id = SIMCONNECT_OBJECT_ID_USER;
+  // Auto-reset event SimConnect signals when a message is queued. It outlives
+  // reconnects and is closed when the worker exits.
+  HANDLE simconnect_event = nullptr;
   bool simconnect_ready = false;
   bool ownship_valid = false;
+  // NowSeconds() when the latest ownship and traffic data arrived.
+  double ownship_sample_time = 0.0;
+  double traffic_sample_time = 0.0;
+  double last_traffic_extrapolation_s = 0.0;
   OwnshipSimData ownship;
-  std::vector<TrafficEntry> traffic;
-
-  std::unique_ptr<gdl90::GDL90Encoder> encoder;
+  // Rows follow traffic_tracks' dense order.
+  xp2gdl90::traffic::TrackTable traffic_tracks;
+  xp2gdl90::traffic::TrafficSnapshot traffic;
+  std::vector<uint32_t> traffic_query_rows;
+  xp2gdl90::traffic::GridQueryStats last_traffic_query;
+  // Send schedule per GDL90 address for the adaptive traffic rate.
+  xp2gdl90::traffic::TrackTable traffic_schedule;
+  xp2gdl90::traffic::TrafficScheduleStats traffic_schedule_stats;
+
+  std::unique_ptr<gdl90::TimedGDL90Encoder<gdl90::SteadyUtcClock>> encoder;
   std::unique_ptr<gdl90::foreflight::ForeFlightEncoder> foreflight_encoder;
   std::unique_ptr<udp::UDPBroadcaster> broadcaster;
-  std::unique_ptr<udp::UDPReceiver> foreflight_receiver;
-
+  // Routes, packs, paces and counts every send through broadcaster.
+  xp2gdl90::BroadcastEngine engine;
+  uint64_t send_errors_logged = 0;
+  // Declared after broadcaster, so it closes first.
+  std::unique_ptr<udp::CaptureSink> stream_capture;
+  size_t stream_capture_bytes = 0;
+  bool stream_capture_compact = false;
+  // Declared after engine, so it closes first.
+  std::unique_ptr<xp2gdl90::SharedOutput> shared_output;
+  std::unique_ptr<xp2gdl90::foreflight::DiscoveryListener> foreflight_listener;
+  uint64_t foreflight_errors_seen = 0;
+  // Pre-framed messages that rarely change; ApplySettings() invalidates them.
+  gdl90::CachedFrame heartbeat_frame;
+  gdl90::CachedFrame geo_altitude_frame;
+  gdl90::CachedFrame device_info_frame;
+  // Patched per report; a new callsign rebuilds it.
+  gdl90::CachedFrame ownship_frame;
+  gdl90::Callsign ownship_frame_callsign;
+  std::vector<gdl90::PositionData> traffic_reports;
+  gdl90::FrameArena traffic_frames;
+  gdl90::TrafficFrameCache traffic_frame_cache;
+  // Helpers for traffic_build_threads; the worker thread takes part too.
+  xp2gdl90::TaskPool traffic_pool;
+  xp2gdl90::traffic::ParallelTrafficBuild traffic_build;
+  // Decodes the external feed while traffic_relay is on; relayed_traffic
+  // keeps the latest report per address for the sweeps.
+  std::unique_ptr<xp2gdl90::traffic::TrafficRelayListener> traffic_relay;
+  uint64_t traffic_relay_errors_seen = 0;
+  xp2gdl90::traffic::RelayedTraffic relayed_traffic;
+  xp2gdl90::traffic::RelayMerger relay_merger;
+  // The bridge worker's own scheduling, which it applies to itself, and how
+  // late its timed waits return.
+  xp2gdl90::ThreadTuningSlot worker_tuning;
+  xp2gdl90::WakeLatencyMeter worker_wake;
+  size_t last_relayed_count = 0;
+
+  // Live ForeFlight clients. The first is the primary target and the rest
+  // are destinations after extra_destinations; the text is device 0's.
+  xp2gdl90::foreflight::DeviceTable foreflight_devices;
+  uint64_t foreflight_devices_applied = 0;
   std::string discovered_target_ip;
   uint16_t discovered_target_port = 0;
-  double last_foreflight_discovery = -1.0;
   bool using_discovered_target = false;
 
   double last_heartbeat = 0.0;
@@ -176,11 +369,90 @@ struct BridgeState {
   double last_device_info = 0.0;
   double last_ahrs = 0.0;
   double last_geo_altitude = 0.0;
+  xp2gdl90::SendIntervalTable send_intervals;
+  xp2gdl90::StageTimings stage_timings;
+  xp2gdl90::StatsHistory stats_history;
+  xp2gdl90::OutputScheduler output_scheduler;
   double last_traffic_request = 0.0;
-  double start_time = 0.0;
 
-  uint64_t packets_sent = 0;
   int last_traffic_count = 0;
+
+  // Sends link health reports while metrics_enabled is on.
+  xp2gdl90::MetricsExporter metrics_exporter;
+  std::string metrics_last_error;
+};
+
+// What the UI shows, copied out of BridgeState by the bridge worker.
+struct BridgeStatus {
+  bool simconnect_ready = false;
+  std::string target_ip;
+  uint16_t target_port = 0;
+  bool using_discovered_target = false;
+  size_t foreflight_devices = 0;
+  int last_traffic_count = 0;
+  uint64_t packets_sent = 0;
+  udp::DatagramPackerStats packing;
+  bool has_bandwidth = false;
+  udp::BandwidthLimiterStats bandwidth;
+  size_t traffic_tracks = 0;
+  size_t traffic_subscriptions = 0;
+  xp2gdl90::traffic::GridQueryStats traffic_query;
+  xp2gdl90::traffic::TrafficScheduleStats traffic_schedule;
+  udp::TrafficPacerStats traffic_pacing;
+  double last_traffic_extrapolation_s = 0.0;
+  bool relaying = false;
+  size_t relayed_targets = 0;
+  size_t last_relayed_count = 0;
+  xp2gdl90::traffic::TrafficRelayStats relay;
+  std::string relay_tuning_error;
+  xp2gdl90::WakeLatencyStats worker_wake;
+  std::string worker_tuning_error;
+  bool capturing = false;
+  udp::StreamCaptureStats capture;
+  std::string capture_path;
+  bool sharing = false;
+  xp2gdl90::SharedOutputStats shared;
+  bool metrics_open = false;
+  uint64_t metrics_reports_sent = 0;
+  uint64_t metrics_send_errors = 0;
+  std::string metrics_last_error;
+  xp2gdl90::SendIntervalTable send_intervals;
+  xp2gdl90::StageTimings stage_timings;
+  xp2gdl90::StatsHistory stats_history;
+  xp2gdl90::BandwidthAccount accounting;
+  // "ip:port" of each broadcaster destination, in the account's order.
+  std::vector<std::string> destinations;
+  uint64_t output_ticks = 0;
+  uint64_t output_over_budget_ticks = 0;
+  std::array<xp2gdl90::OutputClassStats, xp2gdl90::SEND_CLASS_COUNT>
+      output_stats{};
+};
+
+// Passes status from the bridge worker to the UI thread, and settings and
+// commands back. Everything except the atomics is guarded by `mutex`.
+struct BridgeChannel {
+  std::mutex mutex;
+  BridgeStatus status;
+  bool settings_pending = false;
+  xp2gdl90::Settings pending_settings;
+  bool reset_timing = false;
+  // Set after posting, so the worker only locks when there is work.
+  std::atomic<bool> commands_pending{false};
+  std::atomic<bool> stop{false};
+};
+
+// Owned by the UI thread.
+struct BridgeUi {
+  // The settings last sent to the worker.
+  xp2gdl90::Settings settings;
+  xp2gdl90::SettingsUiState ui_state;
+  std::string settings_path;
+  bool settings_dirty = false;
+  std::string settings_last_error;
+  double start_time = 0.0;
+  BridgeStatus status;
+  // Traffic targets the budget planner assumes; -1 takes the tracked count.
+  int plan_traffic_targets = -1;
 };
 
 // ---------------------------------------------------------------------------
@@ -250,11 +522,7 @@ void CleanupDeviceAndSwapChain() {
 // Helpers
 // ---------------------------------------------------------------------------
 
-double NowSeconds() {
-  using Clock = std::chrono::steady_clock;
-  static const auto kStart = Clock::now();
-  return std::chrono::duration<double>(Clock::now() - kStart).count();
-}
+double NowSeconds() { return xp2gdl90::MonotonicSeconds(); }
 
 std::string HexHresult(HRESULT r) {
   std::ostringstream s;
@@ -262,13 +530,6 @@ std::string HexHresult(HRESULT r) {
   return s.str();
 }
 
-std::string SafeString(const char *value, size_t size) {
-  if (!value || size == 0)
-    return "";
-  const size_t len = strnlen_s(value, size);
-  return msfs_bridge::TrimString(std::string(value, len));
-}
-
 std::string FormatUptime(double seconds) {
   const int s = static_cast<int>(seconds);
   char buf[32];
@@ -277,22 +538,22 @@ std::string FormatUptime(double seconds) {
   return buf;
 }
 
-bool IsTrafficRequest(DWORD request_id) {
-  return request_id == kRequestTrafficAircraft ||
-         request_id == kRequestTrafficHelicopter;
+// Radius scans find objects to subscribe to and refresh parked ones, whose
+// change-only subscriptions go quiet. Objects neither updated nor seen by
+// three scans are dropped; despawned ones go at once on ObjectRemoved.
+double TrafficStaleSeconds(const xp2gdl90::Settings &cfg) {
+  return 3.0 * cfg.traffic_scan_interval_s;
 }
 
-void AddOrUpdateTrafficEntry(std::vector<TrafficEntry> *traffic,
-                             DWORD object_id, const TrafficSimData &data) {
-  if (!traffic)
-    return;
-  for (TrafficEntry &entry : *traffic) {
-    if (entry.object_id == object_id) {
-      entry.data = data;
-      return;
-    }
-  }
-  traffic->push_back({object_id, data});
+DWORD TrafficScanRadiusMeters(const xp2gdl90::Settings &cfg) {
+  return static_cast<DWORD>(cfg.traffic_scan_radius_nm *
+                            xp2gdl90::traffic::METERS_PER_NAUTICAL_MILE);
+}
+
+bool IsTrafficRequest(DWORD request_id) {
+  return request_id == kRequestTrafficAircraft ||
+         request_id == kRequestTrafficHelicopter ||
+         request_id >= kRequestTrafficObjectBase;
 }
 
 msfs_bridge::OwnshipData ToOwnshipData(const OwnshipSimData &sim) {
@@ -310,24 +571,8 @@ msfs_bridge::OwnshipData ToOwnshipData(const OwnshipSimData &sim) {
   out.indicated_airspeed_kt = sim.indicated_airspeed_kt;
   out.true_airspeed_kt = sim.true_airspeed_kt;
   out.sim_on_ground = (sim.sim_on_ground != 0);
-  out.callsign = SafeString(sim.atc_id, sizeof(sim.atc_id));
-  return out;
-}
-
-msfs_bridge::TrafficData ToTrafficData(DWORD object_id,
-                                       const TrafficSimData &sim) {
-  msfs_bridge::TrafficData out;
-  out.object_id = static_cast<uint32_t>(object_id);
-  out.latitude_deg = sim.latitude_deg;
-  out.longitude_deg = sim.longitude_deg;
-  out.altitude_ft = sim.altitude_ft;
-  out.ground_velocity_kt = sim.ground_velocity_kt;
-  out.velocity_world_x_fps = sim.velocity_world_x_fps;
-  out.velocity_world_y_fps = sim.velocity_world_y_fps;
-  out.velocity_world_z_fps = sim.velocity_world_z_fps;
-  out.true_heading_deg = sim.true_heading_deg;
-  out.sim_on_ground = (sim.sim_on_ground != 0);
-  out.callsign = SafeString(sim.atc_id, sizeof(sim.atc_id));
+  out.callsign =
+      msfs_bridge::SimConnectCallsign(sim.atc_id, sizeof(sim.atc_id));
   return out;
 }
 
@@ -396,14 +641,24 @@ bool ConfigureSimConnectDefinitions(HANDLE handle) {
     g_log.Error("Failed to request ownship data: " + HexHresult(r));
     return false;
   }
+  if (FAILED(SimConnect_SubscribeToSystemEvent(handle, kEventObjectAdded,
+                                               "ObjectAdded")) ||
+      FAILED(SimConnect_SubscribeToSystemEvent(handle, kEventObjectRemoved,
+                                               "ObjectRemoved"))) {
+    g_log.Error("Failed to subscribe to object events; traffic falls back "
+                "to radius scans.");
+  }
   return true;
 }
 
 bool ConnectSimConnect(BridgeState *state) {
   if (state->simconnect)
     return true;
-  const HRESULT r =
-      SimConnect_Open(&state->simconnect, "MSFS2GDL90", nullptr, 0, nullptr, 0);
+  if (!state->simconnect_event) {
+    state->simconnect_event = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+  }
+  const HRESULT r = SimConnect_Open(&state->simconnect, "MSFS2GDL90", nullptr,
+                                    0, state->simconnect_event, 0);
   if (FAILED(r)) {
     state->simconnect = nullptr;
     return false;
@@ -425,10 +680,44 @@ void DisconnectSimConnect(BridgeState *state) {
   state->simconnect = nullptr;
   state->simconnect_ready = false;
   state->ownship_valid = false;
+  state->traffic_tracks.clear();
   state->traffic.clear();
+  state->traffic_schedule.clear();
+  state->traffic_subscriptions.clear();
+  state->user_object_id = SIMCONNECT_OBJECT_ID_USER;
   g_log.Info("Disconnected from SimConnect.");
 }
 
+bool IsUserObject(const BridgeState &state, DWORD object_id) {
+  return object_id == SIMCONNECT_OBJECT_ID_USER ||
+         object_id == state.user_object_id;
+}
+
+// Asks for `object_id`'s traffic data once a second, sent only when it
+// changed. Objects already subscribed and IDs past the request ID range are
+// left to the radius scans.
+void SubscribeTrafficObject(BridgeState *state, DWORD object_id) {
+  if (!state->settings.traffic_enabled || IsUserObject(*state, object_id) ||
+      object_id > MAXDWORD - kRequestTrafficObjectBase ||
+      !state->traffic_subscriptions.insert(object_id).second) {
+    return;
+  }
+  const HRESULT r = SimConnect_RequestDataOnSimObject(
+      state->simconnect, kRequestTrafficObjectBase + object_id,
+      kDefinitionTraffic, object_id, SIMCONNECT_PERIOD_SECOND,
+      SIMCONNECT_DATA_REQUEST_FLAG_CHANGED);
+  if (FAILED(r)) {
+    state->traffic_subscriptions.erase(object_id);
+    g_log.Error("Failed to subscribe to traffic object " +
+                std::to_string(object_id) + ": " + HexHresult(r));
+  }
+}
+
+bool IsTrafficObjectType(SIMCONNECT_SIMOBJECT_TYPE type) {
+  return type == SIMCONNECT_SIMOBJECT_TYPE_AIRCRAFT ||
+         type == SIMCONNECT_SIMOBJECT_TYPE_HELICOPTER;
+}
+
 void DispatchSimConnectMessage(BridgeState *state, SIMCONNECT_RECV *msg,
                                DWORD) {
   switch (msg->dwID) {
@@ -439,11 +728,40 @@ void DispatchSimConnectMessage(BridgeState *state, SIMCONNECT_RECV *msg,
     if (data->dwRequestID == kRequestOwnship) {
       state->ownship = *reinterpret_cast<const OwnshipSimData *>(&data->dwData);
       state->ownship_valid = true;
+      state->ownship_sample_time = NowSeconds();
+      state->user_object_id = data->dwObjectID;
     } else if (IsTrafficRequest(data->dwRequestID) &&
-               data->dwObjectID != SIMCONNECT_OBJECT_ID_USER) {
-      AddOrUpdateTrafficEntry(
-          &state->traffic, data->dwObjectID,
-          *reinterpret_cast<const TrafficSimData *>(&data->dwData));
+               !IsUserObject(*state, data->dwObjectID)) {
+      // Objects that predate the connection are subscribed when a scan
+      // first returns them.
+      if (data->dwRequestID < kRequestTrafficObjectBase) {
+        SubscribeTrafficObject(state, data->dwObjectID);
+      }
+      state->traffic_sample_time = NowSeconds();
+      // Read straight out of the dispatch buffer.
+      const msfs_bridge::TrafficSimView view{
+          static_cast<uint32_t>(data->dwObjectID),
+          reinterpret_cast<const msfs_bridge::TrafficSimData *>(
+              &data->dwData)};
+      msfs_bridge::UpsertTrafficTargets(&state->traffic_tracks,
+                                        &state->traffic, &view, 1,
+                                        state->traffic_sample_time);
+    }
+    break;
+  }
+  case SIMCONNECT_RECV_ID_EVENT_OBJECT_ADDREMOVE: {
+    const auto *event =
+        reinterpret_cast<const SIMCONNECT_RECV_EVENT_OBJECT_ADDREMOVE *>(msg);
+    if (!IsTrafficObjectType(event->eObjType)) {
+      break;
+    }
+    const DWORD object_id = event->dwData;
+    if (event->uEventID == kEventObjectAdded) {
+      SubscribeTrafficObject(state, object_id);
+    } else if (event->uEventID == kEventObjectRemoved) {
+      // SimConnect ends the object's data requests itself.
+      state->traffic_subscriptions.erase(object_id);
+      state->traffic_tracks.remove(object_id, &state->traffic);
     }
     break;
   }
@@ -464,6 +782,7 @@ void DispatchSimConnectMessage(BridgeState *state, SIMCONNECT_RECV *msg,
 }
 
 void PollSimConnect(BridgeState *state) {
+  XP2GDL90_STAGE_TIMER(&state->stage_timings, xp2gdl90::Stage::SIM_READ);
   while (state->simconnect) {
     SIMCONNECT_RECV *msg = nullptr;
     DWORD size = 0;
@@ -485,42 +804,168 @@ void PollSimConnect(BridgeState *state) {
 // ---------------------------------------------------------------------------
 
 void PollForeFlightDiscovery(BridgeState *state, double now) {
-  if (!state->settings.foreflight_auto_discovery || !state->foreflight_receiver)
+  XP2GDL90_STAGE_TIMER(&state->stage_timings, xp2gdl90::Stage::DISCOVERY);
+  xp2gdl90::foreflight::DiscoveryListener *listener =
+      state->foreflight_listener.get();
+  if (!state->settings.foreflight_auto_discovery || !listener)
     return;
-  while (true) {
-    std::vector<uint8_t> packet;
-    std::string source_ip;
-    uint16_t source_port = 0;
-    const int r =
-        state->foreflight_receiver->receive(&packet, &source_ip, &source_port);
-    if (r == 0)
-      break;
-    if (r < 0) {
-      g_log.Error("ForeFlight discovery error: " +
-                  state->foreflight_receiver->getLastError());
-      break;
+  if (!listener->isRunning())
+    listener->pollOnce(0);
+  const uint64_t errors = listener->errorCount();
+  if (errors != state->foreflight_errors_seen) {
+    state->foreflight_errors_seen = errors;
+    g_log.Error("ForeFlight discovery error: " + listener->lastError());
+  }
+
+  udp::SourceAddress
+      sightings[xp2gdl90::foreflight::DISCOVERY_SIGHTING_CAPACITY];
+  const size_t count = listener->takeSightings(
+      sightings, xp2gdl90::foreflight::DISCOVERY_SIGHTING_CAPACITY);
+  for (size_t i = 0; i < count; ++i) {
+    if (state->foreflight_devices.see(sightings[i], now)) {
+      g_log.Info("ForeFlight discovered at " +
+                 udp::FormatSourceIp(sightings[i]) + ":" +
+                 std::to_string(sightings[i].port));
     }
-    uint16_t port = 0;
-    if (!xp2gdl90::foreflight::ParseDiscoveryBroadcast(packet, &port))
-      continue;
-    if (source_ip != state->discovered_target_ip ||
-        port != state->discovered_target_port) {
-      g_log.Info("ForeFlight discovered at " + source_ip + ":" +
-                 std::to_string(port));
+  }
+}
+
+// Wraps a fresh receiver in a listener thread; falls back to polling from
+// the UI loop if the thread cannot start.
+bool StartForeFlightListener(BridgeState *state, uint16_t port) {
+  auto receiver = std::make_unique<udp::UDPReceiver>(port);
+  if (!receiver->initialize()) {
+    g_log.Error("Failed to initialize ForeFlight discovery listener: " +
+                receiver->getLastError());
+    return false;
+  }
+  state->foreflight_listener =
+      std::make_unique<xp2gdl90::foreflight::DiscoveryListener>(
+          std::move(receiver));
+  state->foreflight_errors_seen = 0;
+  if (!state->foreflight_listener->start())
+    g_log.Error(state->foreflight_listener->lastError());
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Traffic relay
+// ---------------------------------------------------------------------------
+
+// Same as StartForeFlightListener(), for the traffic relay feed.
+bool StartTrafficRelay(BridgeState *state, uint16_t port) {
+  auto receiver = std::make_unique<udp::UDPReceiver>(port);
+  if (!receiver->initialize()) {
+    g_log.Error("Failed to initialize traffic relay listener: " +
+                receiver->getLastError());
+    return false;
+  }
+  state->traffic_relay =
+      std::make_unique<xp2gdl90::traffic::TrafficRelayListener>(
+          std::move(receiver));
+  state->traffic_relay_errors_seen = 0;
+  state->relayed_traffic.clear();
+  if (!state->traffic_relay->start())
+    g_log.Error(state->traffic_relay->lastError());
+  g_log.Info("Traffic relay listener active on UDP port " +
+             std::to_string(port));
+  return true;
+}
+
+// Takes the reports the relay listener decoded since the last sweep and
+// merges the relayed targets heard from recently into traffic_reports.
+void MergeRelayedTraffic(BridgeState *state,
+                         const msfs_bridge::OwnshipData &own, double now) {
+  state->last_relayed_count = 0;
+  xp2gdl90::traffic::TrafficRelayListener *listener =
+      state->traffic_relay.get();
+  const xp2gdl90::Settings &cfg = state->settings;
+  if (!listener || cfg.traffic_max_targets == 0)
+    return;
+  if (!listener->isRunning())
+    listener->pollOnce(0);
+  const uint64_t errors = listener->errorCount();
+  if (errors != state->traffic_relay_errors_seen) {
+    state->traffic_relay_errors_seen = errors;
+    g_log.Error("Traffic relay error: " + listener->lastError());
+  }
+
+  xp2gdl90::traffic::RelayedTraffic &relayed = state->relayed_traffic;
+  relayed.ingest(listener, now);
+  relayed.evictStale(now, xp2gdl90::traffic::TRAFFIC_RELAY_MAX_AGE_S);
+  const xp2gdl90::traffic::TrafficReference ownship =
+      msfs_bridge::OwnshipTrafficReference(own);
+  const xp2gdl90::traffic::RelayMergeStats merged =
+      state->relay_merger.merge(
+          xp2gdl90::traffic::MakeTrafficSelection(cfg), &ownship,
+          static_cast<xp2gdl90::traffic::RelayPriority>(
+              cfg.traffic_relay_priority),
+          cfg.icao_address, relayed.data(), relayed.size(),
+          &state->traffic_reports);
+  state->last_relayed_count = merged.added;
+}
+
+void ApplyDeviceDestinations(BridgeState *state) {
+  std::string error;
+  if (xp2gdl90::foreflight::ApplyDeviceDestinations(
+          state->foreflight_devices, *state->broadcaster, &error) > 0) {
+    g_log.Error("ForeFlight device not added: " + error);
+  }
+}
+
+void ApplyExtraDestinations(BridgeState *state) {
+  state->broadcaster->clearDestinations();
+  state->broadcaster->setBandwidthLimit(
+      state->settings.bandwidth_limit_bytes_per_s,
+      xp2gdl90::MESSAGE_HEARTBEAT | xp2gdl90::MESSAGE_OWNSHIP,
+      xp2gdl90::MESSAGE_TRAFFIC);
+  udp::SocketOptions socket_options;
+  socket_options.dscp = state->settings.socket_dscp;
+  socket_options.send_buffer_bytes = state->settings.socket_send_buffer_bytes;
+  socket_options.bind_ip = state->settings.socket_bind_ip;
+  if (!state->broadcaster->setSocketOptions(socket_options)) {
+    g_log.Error("Socket options rejected: " +
+                state->broadcaster->getLastError());
+  }
+  udp::MulticastOptions multicast;
+  multicast.ttl = state->settings.multicast_ttl;
+  multicast.interface_ip = state->settings.multicast_interface;
+  multicast.loopback = state->settings.multicast_loopback;
+  if (!state->broadcaster->setMulticastOptions(multicast)) {
+    g_log.Error("Multicast options rejected: " +
+                state->broadcaster->getLastError());
+  }
+  for (const xp2gdl90::Destination &destination :
+       state->settings.extra_destinations) {
+    if (!state->broadcaster->addDestination(
+            destination.ip, destination.port, destination.message_mask,
+            destination.rate_divisor)) {
+      g_log.Error("Destination " + destination.ip + ":" +
+                  std::to_string(destination.port) + " rejected: " +
+                  state->broadcaster->getLastError());
     }
-    state->discovered_target_ip = source_ip;
-    state->discovered_target_port = port;
-    state->last_foreflight_discovery = now;
   }
+  ApplyDeviceDestinations(state);
 }
 
 void RefreshBroadcastTarget(BridgeState *state, double now) {
   const xp2gdl90::Settings &cfg = state->settings;
-  const bool discovery_valid =
-      cfg.foreflight_auto_discovery && !state->discovered_target_ip.empty() &&
-      state->discovered_target_port > 0 &&
-      state->last_foreflight_discovery >= 0.0 &&
-      (now - state->last_foreflight_discovery) <= kForeFlightDiscoveryTimeout;
+  xp2gdl90::foreflight::DeviceTable &devices = state->foreflight_devices;
+  if (!cfg.foreflight_auto_discovery)
+    devices.clear();
+  devices.expire(now, kForeFlightDiscoveryTimeout);
+  if (devices.generation() != state->foreflight_devices_applied) {
+    // Text is only formatted when a device joins or leaves.
+    state->foreflight_devices_applied = devices.generation();
+    state->discovered_target_ip.clear();
+    state->discovered_target_port = 0;
+    if (!devices.empty()) {
+      state->discovered_target_ip = udp::FormatSourceIp(devices[0].address);
+      state->discovered_target_port = devices[0].address.port;
+    }
+    ApplyDeviceDestinations(state);
+  }
+  const bool discovery_valid = !devices.empty();
 
   const std::string &ip =
       discovery_valid ? state->discovered_target_ip : cfg.target_ip;
@@ -529,7 +974,11 @@ void RefreshBroadcastTarget(BridgeState *state, double now) {
 
   if (state->broadcaster->getTargetIp() != ip ||
       state->broadcaster->getTargetPort() != port) {
-    state->broadcaster->setTarget(ip, port);
+    if (!state->broadcaster->setTarget(ip, port)) {
+      g_log.Error("Broadcast target rejected: " +
+                  state->broadcaster->getLastError());
+      return;
+    }
     g_log.Info("Broadcast target: " + ip + ":" + std::to_string(port) +
                (discovery_valid ? " (ForeFlight discovery)" : " (manual)"));
   }
@@ -540,27 +989,112 @@ void RefreshBroadcastTarget(BridgeState *state, double now) {
 // Packet sending
 // ---------------------------------------------------------------------------
 
-void SendPacket(BridgeState *state, const std::vector<uint8_t> &packet) {
-  const int sent = state->broadcaster->send(packet);
-  if (sent < 0) {
-    g_log.Error("UDP send failed: " + state->broadcaster->getLastError());
+// Logs the newest send error once for each batch of failures.
+void LogSendErrors(BridgeState *state) {
+  const uint64_t errors = state->engine.stats().send_errors;
+  if (errors != state->send_errors_logged) {
+    state->send_errors_logged = errors;
+    g_log.Error("UDP send failed: " + state->engine.lastError());
+  }
+}
+
+void SendPacket(BridgeState *state, const gdl90::FrameBuffer &packet,
+                uint32_t message_class, bool leading = false) {
+  XP2GDL90_STAGE_TIMER(&state->stage_timings, xp2gdl90::Stage::SEND);
+  if (state->engine.sendMessage(packet, message_class, leading) < 0) {
+    LogSendErrors(state);
+    return;
+  }
+  if (state->settings.log_messages) {
+    g_log.PacketSent(packet.size(), state->engine.stats().packets_sent);
+  }
+}
+void SendPacket(BridgeState *state, const gdl90::FrameRef &packet,
+                uint32_t message_class) {
+  XP2GDL90_STAGE_TIMER(&state->stage_timings, xp2gdl90::Stage::SEND);
+  if (state->engine.sendMessage(packet, message_class) < 0) {
+    LogSendErrors(state);
     return;
   }
-  ++state->packets_sent;
   if (state->settings.log_messages) {
-    g_log.Info("Sent " + std::to_string(packet.size()) + " bytes (total " +
-               std::to_string(state->packets_sent) + ")");
+    g_log.PacketSent(packet.size(), state->engine.stats().packets_sent);
+  }
+}
+
+// Sends the traffic frames the pacer has released by `now`.
+void SendPacedTraffic(BridgeState *state, double now) {
+  XP2GDL90_STAGE_TIMER(&state->stage_timings, xp2gdl90::Stage::SEND);
+  state->engine.sendPacedTraffic(now);
+  LogSendErrors(state);
+}
+
+void FlushPackedDatagrams(BridgeState *state) {
+  XP2GDL90_STAGE_TIMER(&state->stage_timings, xp2gdl90::Stage::SEND);
+  state->engine.flush();
+  LogSendErrors(state);
+}
+
+// Applies the packing settings to the engine. The bridge already sends from
+// its own worker thread, so the X-Plane sender thread stays off.
+void ConfigureBroadcastEngine(BridgeState *state) {
+  xp2gdl90::BroadcastOptions options =
+      xp2gdl90::MakeBroadcastOptions(state->settings);
+  options.sender_thread = false;
+  state->engine.configure(options, nullptr);
+}
+
+// Sizes the track table's grid from the settings, or turns it off.
+void ConfigureTrafficGrid(BridgeState *state) {
+  const xp2gdl90::Settings &cfg = state->settings;
+  state->traffic_tracks.setGridCellSize(
+      cfg.traffic_spatial_index
+          ? cfg.traffic_range_nm * xp2gdl90::traffic::METERS_PER_NAUTICAL_MILE
+          : 0.0);
+}
+
+// Posts the worker thread tuning to the bridge worker and the relay
+// listener. The traffic build helpers keep the default scheduling.
+void ConfigureWorkerThreads(BridgeState *state) {
+  const xp2gdl90::ThreadTuning tuning =
+      xp2gdl90::MakeWorkerThreadTuning(state->settings);
+  state->worker_tuning.set(tuning);
+  if (state->traffic_relay) {
+    state->traffic_relay->setThreadTuning(tuning);
   }
 }
 
+// Starts or stops the traffic build helpers to match the settings.
+void ConfigureTrafficBuild(BridgeState *state) {
+  const size_t threads = state->settings.traffic_build_threads;
+  state->traffic_build.pool = &state->traffic_pool;
+  if (state->traffic_pool.threads() == threads) {
+    return;
+  }
+  if (threads == 0) {
+    state->traffic_pool.stop();
+    return;
+  }
+  std::string error;
+  if (!state->traffic_pool.start(threads, &error)) {
+    g_log.Error(error);
+  }
+}
+
+// Scan and subscription records update their track's snapshot row in place
+// as they arrive, and nothing clears the snapshot between scans. Each sweep
+// therefore encodes a complete set, with every target at its latest sample,
+// and needs no front/back buffers.
 void RequestTrafficIfDue(BridgeState *state, double now) {
-  if (!state->simconnect || now - state->last_traffic_request < 1.0)
+  const xp2gdl90::Settings &cfg = state->settings;
+  if (!state->simconnect || !cfg.traffic_enabled ||
+      now - state->last_traffic_request < cfg.traffic_scan_interval_s)
     return;
   state->last_traffic_request = now;
-  state->traffic.clear();
+  state->traffic_tracks.evictStale(now, TrafficStaleSeconds(cfg),
+                                   &state->traffic);
   const HRESULT aircraft_result = SimConnect_RequestDataOnSimObjectType(
       state->simconnect, kRequestTrafficAircraft, kDefinitionTraffic,
-      kTrafficRadiusMeters, SIMCONNECT_SIMOBJECT_TYPE_AIRCRAFT);
+      TrafficScanRadiusMeters(cfg), SIMCONNECT_SIMOBJECT_TYPE_AIRCRAFT);
   if (FAILED(aircraft_result)) {
     g_log.Error("Failed to request aircraft traffic: " +
                 HexHresult(aircraft_result));
@@ -568,88 +1102,380 @@ void RequestTrafficIfDue(BridgeState *state, double now) {
 
   const HRESULT helicopter_result = SimConnect_RequestDataOnSimObjectType(
       state->simconnect, kRequestTrafficHelicopter, kDefinitionTraffic,
-      kTrafficRadiusMeters, SIMCONNECT_SIMOBJECT_TYPE_HELICOPTER);
+      TrafficScanRadiusMeters(cfg), SIMCONNECT_SIMOBJECT_TYPE_HELICOPTER);
   if (FAILED(helicopter_result)) {
     g_log.Error("Failed to request helicopter traffic: " +
                 HexHresult(helicopter_result));
   }
 }
 
-void SendScheduledPackets(BridgeState *state, double now) {
-  const xp2gdl90::Settings &cfg = state->settings;
-  const bool gps_valid =
-      state->ownship_valid &&
-      xp2gdl90::protocol::HasValidOwnshipPosition(state->ownship.latitude_deg,
-                                                  state->ownship.longitude_deg);
-
-  if (cfg.heartbeat_rate > 0.0f &&
-      now - state->last_heartbeat >= 1.0 / cfg.heartbeat_rate) {
-    SendPacket(state, state->encoder->createHeartbeat(gps_valid, true));
-    state->last_heartbeat = now;
-  }
+void RecordSend(BridgeState *state, xp2gdl90::SendClass send_class,
+                double now, double period_s) {
+  state->send_intervals[static_cast<size_t>(send_class)].recordSend(now,
+                                                                    period_s);
+}
 
-  if (!state->ownship_valid)
-    return;
+// Adaptive mode sweeps often enough for the fastest per-target interval;
+// the scheduler decides which targets each sweep sends.
+double TrafficSweepRate(const xp2gdl90::Settings &cfg) {
+  double traffic_sweep_rate = cfg.traffic_rate;
+  if (cfg.traffic_adaptive_rate) {
+    traffic_sweep_rate = (std::max)(
+        traffic_sweep_rate,
+        1.0 / xp2gdl90::traffic::MakeTrafficRatePolicy(cfg).near_interval_s);
+  }
+  return traffic_sweep_rate;
+}
 
-  const msfs_bridge::OwnshipData own = ToOwnshipData(state->ownship);
+// Applies the message rates and the tick budget to the output scheduler.
+// Without ownship only the heartbeat is scheduled.
+void ConfigureOutputScheduler(BridgeState *state) {
+  const xp2gdl90::Settings &cfg = state->settings;
+  const bool ownship = state->ownship_valid;
+  xp2gdl90::OutputScheduler &scheduler = state->output_scheduler;
+  scheduler.configure(xp2gdl90::SendClass::HEARTBEAT,
+                      xp2gdl90::PeriodForRate(cfg.heartbeat_rate));
+  scheduler.configure(xp2gdl90::SendClass::OWNSHIP,
+                      ownship ? xp2gdl90::PeriodForRate(cfg.position_rate)
+                              : 0.0);
+  scheduler.configure(xp2gdl90::SendClass::GEO_ALTITUDE,
+                      ownship ? xp2gdl90::PeriodForRate(cfg.geo_altitude_rate)
+                              : 0.0);
+  scheduler.configure(xp2gdl90::SendClass::AHRS,
+                      ownship ? xp2gdl90::PeriodForRate(cfg.ahrs_rate) : 0.0);
+  scheduler.configure(xp2gdl90::SendClass::DEVICE_INFO,
+                      ownship ? xp2gdl90::PeriodForRate(cfg.device_info_rate)
+                              : 0.0);
+  scheduler.configure(xp2gdl90::SendClass::TRAFFIC,
+                      ownship && cfg.traffic_enabled && cfg.traffic_rate > 0.0f
+                          ? 1.0 / TrafficSweepRate(cfg)
+                          : 0.0);
+  xp2gdl90::OutputBudget budget;
+  budget.max_tick_s = cfg.output_budget_ms / 1000.0;
+  budget.max_tick_bytes = cfg.output_budget_bytes;
+  scheduler.setBudget(budget);
+}
 
-  if (cfg.debug_logging &&
-      now - state->last_position >= 1.0 / cfg.position_rate) {
-    g_log.Info("[debug] ownship lat=" + std::to_string(own.latitude_deg) +
-               " lon=" + std::to_string(own.longitude_deg) +
-               " palt=" + std::to_string(own.pressure_altitude_ft) + "ft" +
-               " gs=" + std::to_string(own.ground_velocity_kt) + "kt" +
-               " hdg=" + std::to_string(own.true_heading_deg) + " gnd=" +
-               (own.sim_on_ground ? "Y" : "N") + " cs=" + own.callsign);
+// Encodes and sends one message class. Returns the bytes it put out.
+size_t SendMessageClass(BridgeState *state, xp2gdl90::SendClass send_class,
+                        const msfs_bridge::OwnshipData &own, double now) {
+  // Traffic collection and sending are timed by their own stages.
+  XP2GDL90_STAGE_TIMER(&state->stage_timings, xp2gdl90::Stage::ENCODE);
+  const xp2gdl90::Settings &cfg = state->settings;
+  switch (send_class) {
+  case xp2gdl90::SendClass::HEARTBEAT: {
+    const bool gps_valid =
+        state->ownship_valid &&
+        xp2gdl90::protocol::HasValidOwnshipPosition(own.latitude_deg,
+                                                    own.longitude_deg);
+    state->encoder->encodeHeartbeatInto(gps_valid, true,
+                                        state->heartbeat_frame);
+    SendPacket(state, state->heartbeat_frame.frame(),
+               xp2gdl90::MESSAGE_HEARTBEAT, true);
+    RecordSend(state, xp2gdl90::SendClass::HEARTBEAT, now,
+               1.0 / cfg.heartbeat_rate);
+    state->last_heartbeat = now;
+    return state->heartbeat_frame.frame().size();
   }
-
-  if (cfg.position_rate > 0.0f &&
-      now - state->last_position >= 1.0 / cfg.position_rate) {
-    SendPacket(state, state->encoder->createOwnshipReport(
-                          msfs_bridge::BuildOwnshipPosition(own, cfg)));
+  case xp2gdl90::SendClass::OWNSHIP: {
+    gdl90::PositionData ownship = msfs_bridge::BuildOwnshipPosition(own, cfg);
+    xp2gdl90::traffic::ExtrapolateReport(now - state->ownship_sample_time,
+                                         cfg.extrapolation_horizon_s,
+                                         &ownship);
+    // Every other identity field the frame holds follows the settings.
+    if (!(ownship.callsign == state->ownship_frame_callsign)) {
+      state->ownship_frame_callsign = ownship.callsign;
+      state->ownship_frame.invalidate();
+    }
+    state->encoder->encodeOwnshipReportInto(ownship, state->ownship_frame);
+    SendPacket(state, state->ownship_frame.frame(),
+               xp2gdl90::MESSAGE_OWNSHIP);
+    RecordSend(state, xp2gdl90::SendClass::OWNSHIP, now,
+               1.0 / cfg.position_rate);
     state->last_position = now;
+    return state->ownship_frame.frame().size();
   }
-
-  if (now - state->last_geo_altitude >= 1.0 / kGeoAltitudeRate) {
-    SendPacket(state, state->encoder->createOwnshipGeometricAltitude(
-                          msfs_bridge::BuildGeoAltitude(own)));
+  case xp2gdl90::SendClass::GEO_ALTITUDE:
+    state->encoder->encodeOwnshipGeometricAltitudeInto(
+        msfs_bridge::BuildGeoAltitude(own), state->geo_altitude_frame);
+    SendPacket(state, state->geo_altitude_frame.frame(),
+               xp2gdl90::MESSAGE_OWNSHIP);
+    RecordSend(state, xp2gdl90::SendClass::GEO_ALTITUDE, now,
+               xp2gdl90::PeriodForRate(cfg.geo_altitude_rate));
     state->last_geo_altitude = now;
-  }
-
-  if (now - state->last_device_info >= 1.0 / kForeFlightDeviceRate) {
-    SendPacket(state, state->foreflight_encoder->createIdMessage(
-                          msfs_bridge::BuildDeviceInfo(cfg)));
-    state->last_device_info = now;
-  }
-
-  if (now - state->last_ahrs >= 1.0 / kForeFlightAhrsRate) {
-    SendPacket(state, state->foreflight_encoder->createAhrsMessage(
-                          msfs_bridge::BuildAhrs(own, cfg)));
+    return state->geo_altitude_frame.frame().size();
+  case xp2gdl90::SendClass::AHRS: {
+    // Encoded fresh each time, straight into a block the sender thread
+    // sends without copying; with the pool dry, into a local copy.
+    gdl90::FrameRef ahrs = state->engine.acquireFrame();
+    gdl90::FrameBuffer local;
+    const size_t size = state->foreflight_encoder->encodeAhrsMessageInto(
+        msfs_bridge::BuildAhrs(own, cfg), ahrs ? *ahrs.buffer() : local);
+    if (ahrs) {
+      SendPacket(state, ahrs, xp2gdl90::MESSAGE_AHRS);
+    } else {
+      SendPacket(state, local, xp2gdl90::MESSAGE_AHRS);
+    }
+    RecordSend(state, xp2gdl90::SendClass::AHRS, now,
+               xp2gdl90::PeriodForRate(cfg.ahrs_rate));
     state->last_ahrs = now;
+    return size;
   }
-
-  if (now - state->last_traffic >= 1.0 / kTrafficReportRate) {
+  case xp2gdl90::SendClass::DEVICE_INFO:
+    if (!state->device_info_frame.valid()) {
+      state->foreflight_encoder->encodeIdMessageInto(
+          msfs_bridge::BuildDeviceInfo(cfg), state->device_info_frame);
+    }
+    SendPacket(state, state->device_info_frame.frame(),
+               xp2gdl90::MESSAGE_FOREFLIGHT_ID);
+    RecordSend(state, xp2gdl90::SendClass::DEVICE_INFO, now,
+               xp2gdl90::PeriodForRate(cfg.device_info_rate));
+    state->last_device_info = now;
+    return state->device_info_frame.frame().size();
+  case xp2gdl90::SendClass::TRAFFIC: {
+    const double traffic_sweep_rate = TrafficSweepRate(cfg);
     state->last_traffic_count = static_cast<int>(state->traffic.size());
+    {
+      XP2GDL90_STAGE_TIMER(&state->stage_timings, xp2gdl90::Stage::TRAFFIC);
+      state->traffic_reports.clear();
+      state->traffic_query_rows.clear();
+      state->traffic_tracks.queryNear(
+          own.latitude_deg, own.longitude_deg,
+          cfg.traffic_range_nm * xp2gdl90::traffic::METERS_PER_NAUTICAL_MILE,
+          &state->traffic_query_rows, &state->last_traffic_query);
+      msfs_bridge::BuildTrafficPositions(
+          &state->traffic, cfg, &own,
+          state->traffic_tracks.hasGrid() ? &state->traffic_query_rows
+                                          : nullptr,
+          &state->traffic_reports, &state->traffic_build);
+      MergeRelayedTraffic(state, own, now);
+      if (cfg.traffic_adaptive_rate) {
+        xp2gdl90::traffic::ScheduleTrafficReports(
+            xp2gdl90::traffic::MakeTrafficRatePolicy(cfg),
+            msfs_bridge::OwnshipTrafficReference(own), now,
+            1.0 / traffic_sweep_rate, &state->traffic_schedule,
+            &state->traffic_reports, &state->traffic_schedule_stats);
+        state->traffic_schedule.evictStale(now, TrafficStaleSeconds(cfg),
+                                           nullptr);
+      }
+    }
+    const double pacing_window =
+        cfg.traffic_pacing
+            ? udp::TRAFFIC_PACING_WINDOW_FRACTION / traffic_sweep_rate
+            : 0.0;
+    // Traffic is requested once a second, so the sample is up to a second
+    // old before any pacing delay.
+    state->last_traffic_extrapolation_s = 0.0;
+    if (cfg.extrapolation_horizon_s > 0.0f &&
+        !state->traffic_reports.empty()) {
+      state->last_traffic_extrapolation_s =
+          xp2gdl90::traffic::ExtrapolateTrafficReports(
+              now - state->traffic_sample_time,
+              pacing_window /
+                  static_cast<double>(state->traffic_reports.size()),
+              cfg.extrapolation_horizon_s, &state->traffic_reports);
+    }
+    xp2gdl90::traffic::EncodeTrafficReports(
+        *state->encoder, state->traffic_reports.data(),
+        state->traffic_reports.size(), state->traffic_frames,
+        &state->traffic_frame_cache, &state->traffic_build);
     if (cfg.debug_logging) {
       g_log.Info("[debug] sending " +
                  std::to_string(state->last_traffic_count) +
-                 " traffic report(s)");
-    }
-    for (const TrafficEntry &entry : state->traffic) {
-      gdl90::PositionData pos;
-      if (msfs_bridge::BuildTrafficPosition(
-              ToTrafficData(entry.object_id, entry.data), cfg, &pos)) {
-        SendPacket(state, state->encoder->createTrafficReport(pos));
-      }
+                 " traffic report(s), frame cache " +
+                 std::to_string(state->traffic_frame_cache.hits()) +
+                 " reused / " +
+                 std::to_string(state->traffic_frame_cache.misses()) +
+                 " encoded, range query " +
+                 std::to_string(state->last_traffic_query.cells) +
+                 " cells / " +
+                 std::to_string(state->last_traffic_query.entries) +
+                 " candidates");
     }
+    state->engine.startTraffic(state->traffic_frames, now, pacing_window);
+    RecordSend(state, xp2gdl90::SendClass::TRAFFIC, now,
+               1.0 / traffic_sweep_rate);
     state->last_traffic = now;
+    return state->traffic_frames.size();
+  }
+  }
+  return 0;
+}
+
+void SendScheduledPackets(BridgeState *state, double now) {
+  const xp2gdl90::Settings &cfg = state->settings;
+  state->broadcaster->updateBandwidth(now);
+  ConfigureOutputScheduler(state);
+  xp2gdl90::OutputScheduler &scheduler = state->output_scheduler;
+  // The bridge clock is already monotonic.
+  scheduler.beginTick(now, xp2gdl90::MonotonicSeconds());
+
+  const msfs_bridge::OwnshipData own =
+      state->ownship_valid ? ToOwnshipData(state->ownship)
+                           : msfs_bridge::OwnshipData{};
+  if (cfg.debug_logging && scheduler.due(xp2gdl90::SendClass::OWNSHIP)) {
+    g_log.OwnshipDebug(own);
+  }
+
+  xp2gdl90::SendClass send_class = xp2gdl90::SendClass::HEARTBEAT;
+  while (scheduler.next(xp2gdl90::MonotonicSeconds(), &send_class)) {
+    const size_t bytes = SendMessageClass(state, send_class, own, now);
+    scheduler.complete(send_class, bytes, xp2gdl90::MonotonicSeconds());
   }
+  SendPacedTraffic(state, now);
+  FlushPackedDatagrams(state);
 }
 
 // ---------------------------------------------------------------------------
 // Networking init
 // ---------------------------------------------------------------------------
 
+// Opens, resizes or closes the capture next to the settings file.
+void ConfigureStreamCapture(BridgeState *state) {
+  const xp2gdl90::Settings &cfg = state->settings;
+  const size_t bytes = static_cast<size_t>(cfg.stream_capture_mb) << 20;
+  if (state->stream_capture && cfg.stream_capture &&
+      state->stream_capture_compact == cfg.stream_capture_compact &&
+      (cfg.stream_capture_compact || state->stream_capture_bytes == bytes)) {
+    return;
+  }
+  if (state->stream_capture) {
+    state->broadcaster->setCapture(nullptr);
+    g_log.Info("Stream capture stopped: " + state->stream_capture->path());
+    state->stream_capture.reset();
+  }
+  if (!cfg.stream_capture) {
+    return;
+  }
+
+  const std::filesystem::path directory =
+      std::filesystem::path(state->settings_path).parent_path();
+  std::string error;
+  std::string detail;
+  if (cfg.stream_capture_compact) {
+    auto capture = std::make_unique<udp::CompactCaptureWriter>();
+    if (!capture->open((directory / "msfs2gdl90_capture.xcap").string(),
+                       &error)) {
+      g_log.Error(error);
+      return;
+    }
+    state->stream_capture = std::move(capture);
+    detail = "compact";
+  } else {
+    auto capture = std::make_unique<udp::StreamCapture>();
+    if (!capture->open((directory / "msfs2gdl90_capture.pcap").string(), bytes,
+                       &error)) {
+      g_log.Error(error);
+      return;
+    }
+    state->stream_capture = std::move(capture);
+    detail = std::to_string(cfg.stream_capture_mb) + " MB";
+  }
+  state->stream_capture_bytes = bytes;
+  state->stream_capture_compact = cfg.stream_capture_compact;
+  state->broadcaster->setCapture(state->stream_capture.get());
+  g_log.Info("Stream capture started: " + state->stream_capture->path() +
+             " (" + detail + ")");
+}
+
+// Opens or closes the shared-memory output to match the settings.
+void ConfigureSharedOutput(BridgeState *state) {
+  if (static_cast<bool>(state->shared_output) ==
+      state->settings.shared_output) {
+    return;
+  }
+  if (state->shared_output) {
+    state->engine.setSharedOutput(nullptr);
+    g_log.Info("Shared output closed: " + state->shared_output->name());
+    state->shared_output.reset();
+    return;
+  }
+
+  auto output = std::make_unique<xp2gdl90::SharedOutput>();
+  std::string error;
+  if (!output->open(kSharedOutputName, &error)) {
+    g_log.Error(error);
+    return;
+  }
+  state->shared_output = std::move(output);
+  state->engine.setSharedOutput(state->shared_output.get());
+  g_log.Info("Shared output open: " + state->shared_output->name());
+}
+
+// Opens, retargets or closes the metrics socket to match the settings.
+void ConfigureMetricsExporter(BridgeState *state) {
+  const xp2gdl90::Settings &cfg = state->settings;
+  xp2gdl90::MetricsExporter &exporter = state->metrics_exporter;
+  const double interval_s = static_cast<double>(cfg.metrics_interval_s);
+  if (!cfg.metrics_enabled) {
+    if (exporter.isOpen()) {
+      exporter.close();
+      g_log.Info("Metrics exporter stopped");
+    }
+    return;
+  }
+  if (exporter.isOpen() && exporter.ip() == cfg.metrics_ip &&
+      exporter.port() == cfg.metrics_port &&
+      exporter.intervalS() == interval_s) {
+    return;
+  }
+  std::string error;
+  if (!exporter.open(cfg.metrics_ip, cfg.metrics_port, interval_s, &error)) {
+    state->metrics_last_error = error;
+    g_log.Error(error);
+    return;
+  }
+  state->metrics_last_error.clear();
+  g_log.Info("Metrics exporter sending to " + cfg.metrics_ip + ":" +
+             std::to_string(cfg.metrics_port));
+}
+
+// Adds the loop to the Debug tab's sparklines and bandwidth rates.
+void UpdateStatsHistory(BridgeState *state, double now) {
+  state->engine.updateAccounting(now);
+  state->stats_history.recordTick(state->stage_timings.lastTickNs());
+  const xp2gdl90::BroadcastStats &stats = state->engine.stats();
+  xp2gdl90::StatsCounters counters;
+  counters.frames = stats.packets_sent;
+  counters.bytes = stats.bytes_sent;
+  counters.send_errors = stats.send_errors;
+  counters.targets =
+      static_cast<uint32_t>((std::max)(0, state->last_traffic_count));
+  state->stats_history.update(now, counters);
+}
+
+// Sends the link health report when one is due, after the loop's output.
+void SendMetricsReport(BridgeState *state, double now) {
+  xp2gdl90::MetricsExporter &exporter = state->metrics_exporter;
+  if (!exporter.due(now)) {
+    return;
+  }
+  xp2gdl90::MetricsReport &report =
+      exporter.begin(state->settings.device_name, now);
+  report.counter("packets_sent", state->engine.stats().packets_sent);
+  report.counter("send_errors", state->engine.stats().send_errors);
+  xp2gdl90::AddSendIntervalMetrics(state->send_intervals, &report);
+  report.gauge("queue.paced_traffic",
+               static_cast<double>(state->engine.trafficPacer().pending()));
+  report.gauge("traffic.targets",
+               static_cast<double>(state->last_traffic_count));
+  report.gauge("traffic.tracked",
+               static_cast<double>(state->traffic_tracks.size()));
+  const xp2gdl90::WakeLatencyStats wake = state->worker_wake.stats();
+  report.gauge("worker.wake_avg_us", wake.averageUs());
+  report.gauge("worker.wake_max_us", static_cast<double>(wake.max_us));
+#if XP2GDL90_STAGE_TIMING
+  xp2gdl90::AddStageTimingMetrics(state->stage_timings, &report);
+#endif
+
+  std::string error;
+  if (exporter.send(&error)) {
+    state->metrics_last_error.clear();
+  } else {
+    state->metrics_last_error = error;
+  }
+}
+
 bool InitializeNetworking(BridgeState *state) {
   state->broadcaster = std::make_unique<udp::UDPBroadcaster>(
       state->settings.target_ip, state->settings.target_port);
@@ -658,17 +1484,24 @@ bool InitializeNetworking(BridgeState *state) {
                 state->broadcaster->getLastError());
     return false;
   }
-  if (state->settings.foreflight_auto_discovery) {
-    state->foreflight_receiver = std::make_unique<udp::UDPReceiver>(
-        state->settings.foreflight_broadcast_port);
-    if (!state->foreflight_receiver->initialize()) {
-      g_log.Error("Failed to initialize ForeFlight discovery listener: " +
-                  state->foreflight_receiver->getLastError());
-      return false;
-    }
+  if (state->settings.foreflight_auto_discovery &&
+      !StartForeFlightListener(state,
+                               state->settings.foreflight_broadcast_port)) {
+    return false;
+  }
+  if (state->settings.traffic_relay &&
+      !StartTrafficRelay(state, state->settings.traffic_relay_port)) {
+    return false;
   }
   g_log.Info("Broadcast target: " + state->settings.target_ip + ":" +
              std::to_string(state->settings.target_port));
+  state->engine.attach(state->broadcaster.get());
+  ConfigureBroadcastEngine(state);
+  ConfigureWorkerThreads(state);
+  ApplyExtraDestinations(state);
+  ConfigureStreamCapture(state);
+  ConfigureSharedOutput(state);
+  ConfigureMetricsExporter(state);
   return true;
 }
 
@@ -676,22 +1509,8 @@ bool InitializeNetworking(BridgeState *state) {
 // Settings apply (from UI)
 // ---------------------------------------------------------------------------
 
-void ApplySettings(BridgeState *state) {
-  xp2gdl90::Settings new_cfg;
-  std::string error;
-  if (!xp2gdl90::BuildConfigFromSettingsUi(state->ui_state, state->settings,
-                                           &new_cfg, &error)) {
-    state->settings_last_error = error;
-    return;
-  }
-  if (!xp2gdl90::protocol::IsValidIpv4Address(new_cfg.target_ip)) {
-    state->settings_last_error = "Target IP must be a valid IPv4 address.";
-    return;
-  }
-  new_cfg.heartbeat_rate = (std::max)(0.0f, new_cfg.heartbeat_rate);
-  new_cfg.position_rate = (std::max)(0.0f, new_cfg.position_rate);
-  new_cfg.icao_address &= 0x00FFFFFFu;
-
+// Runs on the bridge worker with settings SubmitSettings() validated.
+void ApplySettings(BridgeState *state, const xp2gdl90::Settings &new_cfg) {
   if (state->broadcaster) {
     state->broadcaster->setTarget(new_cfg.target_ip, new_cfg.target_port);
   }
@@ -699,32 +1518,398 @@ void ApplySettings(BridgeState *state) {
           new_cfg.foreflight_auto_discovery ||
       state->settings.foreflight_broadcast_port !=
           new_cfg.foreflight_broadcast_port) {
-    state->foreflight_receiver.reset();
+    state->foreflight_listener.reset();
     if (new_cfg.foreflight_auto_discovery) {
-      state->foreflight_receiver =
-          std::make_unique<udp::UDPReceiver>(new_cfg.foreflight_broadcast_port);
-      state->foreflight_receiver->initialize();
+      StartForeFlightListener(state, new_cfg.foreflight_broadcast_port);
+    }
+  }
+  if (state->settings.traffic_relay != new_cfg.traffic_relay ||
+      state->settings.traffic_relay_port != new_cfg.traffic_relay_port) {
+    state->traffic_relay.reset();
+    state->relayed_traffic.clear();
+    if (new_cfg.traffic_relay) {
+      StartTrafficRelay(state, new_cfg.traffic_relay_port);
     }
   }
 
   state->settings = new_cfg;
-  state->settings_dirty = false;
-  state->settings_last_error.clear();
+  state->heartbeat_frame.invalidate();
+  state->geo_altitude_frame.invalidate();
+  state->device_info_frame.invalidate();
+  state->ownship_frame.invalidate();
+  ConfigureTrafficGrid(state);
+  ConfigureTrafficBuild(state);
+  ConfigureBroadcastEngine(state);
+  ConfigureWorkerThreads(state);
+  ConfigureSharedOutput(state);
+  if (state->broadcaster) {
+    ApplyExtraDestinations(state);
+    ConfigureStreamCapture(state);
+    ConfigureMetricsExporter(state);
+  }
   g_log.Info("Settings applied.");
+}
+
+void ResetTiming(BridgeState *state) {
+  for (xp2gdl90::SendIntervalHistogram &intervals : state->send_intervals) {
+    intervals.reset();
+  }
+  state->output_scheduler.resetStats();
+  state->stage_timings.reset();
+  state->stats_history.reset();
+}
+
+// Validates the edited settings on the UI thread, hands them to the worker
+// and saves them.
+void SubmitSettings(BridgeUi *ui, BridgeChannel *channel) {
+  xp2gdl90::Settings new_cfg;
+  std::string error;
+  if (!xp2gdl90::BuildConfigFromSettingsUi(ui->ui_state, ui->settings,
+                                           &new_cfg, &error)) {
+    ui->settings_last_error = error;
+    return;
+  }
+  if (!xp2gdl90::protocol::IsValidIpv4Address(new_cfg.target_ip)) {
+    ui->settings_last_error = "Target IP must be a valid IPv4 address.";
+    return;
+  }
+  new_cfg.heartbeat_rate = (std::max)(0.0f, new_cfg.heartbeat_rate);
+  new_cfg.position_rate = (std::max)(0.0f, new_cfg.position_rate);
+  new_cfg.icao_address &= 0x00FFFFFFu;
+
+  ui->settings = new_cfg;
+  {
+    std::lock_guard<std::mutex> lock(channel->mutex);
+    channel->pending_settings = new_cfg;
+    channel->settings_pending = true;
+  }
+  channel->commands_pending.store(true, std::memory_order_release);
+  ui->settings_dirty = false;
+  ui->settings_last_error.clear();
 
   std::string save_error;
-  if (!xp2gdl90::SaveSettingsToJsonFile(state->settings_path, state->settings,
+  if (!xp2gdl90::SaveSettingsToJsonFile(ui->settings_path, ui->settings,
                                         &save_error)) {
     g_log.Error("Could not save settings: " + save_error);
   }
 }
 
+// ---------------------------------------------------------------------------
+// Bridge worker
+// ---------------------------------------------------------------------------
+
+// The UI snapshot is refreshed this often.
+constexpr double kStatusPublishInterval = 0.1;
+// Longest the worker sleeps. SimConnect messages wake it at once; this
+// bounds the reconnect and ForeFlight discovery polls.
+constexpr double kWorkerMaxSleep = 0.05;
+// Shortest, so a class held back by the output budget cannot spin the loop.
+constexpr double kWorkerMinSleep = 0.0005;
+constexpr double kSimConnectRetryInterval = 2.0;
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+// Sleeps on a waitable timer, or until `event` is signalled. High resolution
+// timers need Windows 10 1803; older systems fall back to the default timer
+// granularity.
+class WorkerTimer {
+public:
+  WorkerTimer() {
+    timer_ = CreateWaitableTimerExW(nullptr, nullptr,
+                                    CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                    TIMER_ALL_ACCESS);
+    high_resolution_ = timer_ != nullptr;
+    if (!timer_) {
+      timer_ =
+          CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+  }
+  ~WorkerTimer() {
+    if (timer_) {
+      CloseHandle(timer_);
+    }
+  }
+  WorkerTimer(const WorkerTimer &) = delete;
+  WorkerTimer &operator=(const WorkerTimer &) = delete;
+
+  bool highResolution() const { return high_resolution_; }
+
+  // Returns true if the full wait ran out, false if `event` cut it short.
+  bool wait(double seconds, HANDLE event) {
+    if (!(seconds > 0.0)) {
+      return false;
+    }
+    // Negative due times are relative, in 100 ns units.
+    LARGE_INTEGER due;
+    due.QuadPart = -static_cast<LONGLONG>(seconds * 1e7);
+    if (!timer_ ||
+        !SetWaitableTimer(timer_, &due, 0, nullptr, nullptr, FALSE)) {
+      const DWORD ms = static_cast<DWORD>(seconds * 1000.0);
+      if (event) {
+        return WaitForSingleObject(event, ms) == WAIT_TIMEOUT;
+      }
+      Sleep(ms);
+      return true;
+    }
+    const HANDLE handles[2] = {timer_, event};
+    const DWORD woken =
+        WaitForMultipleObjects(event ? 2 : 1, handles, FALSE, INFINITE);
+    // A message woke us first; the timer is re-armed on the next wait.
+    CancelWaitableTimer(timer_);
+    return woken == WAIT_OBJECT_0;
+  }
+
+private:
+  HANDLE timer_ = nullptr;
+  bool high_resolution_ = false;
+};
+
+void TakeBridgeCommands(BridgeState *state, BridgeChannel *channel) {
+  if (!channel->commands_pending.exchange(false, std::memory_order_acquire)) {
+    return;
+  }
+  bool apply = false;
+  bool reset = false;
+  xp2gdl90::Settings new_cfg;
+  {
+    std::lock_guard<std::mutex> lock(channel->mutex);
+    if (channel->settings_pending) {
+      new_cfg = channel->pending_settings;
+      channel->settings_pending = false;
+      apply = true;
+    }
+    reset = channel->reset_timing;
+    channel->reset_timing = false;
+  }
+  if (apply) {
+    ApplySettings(state, new_cfg);
+  }
+  if (reset) {
+    ResetTiming(state);
+  }
+}
+
+// Earliest time the worker has something to send or request. SimConnect
+// messages are not included; their event wakes the worker directly.
+double NextWorkerWake(const BridgeState &state, double now) {
+  double wake = now + kWorkerMaxSleep;
+  const double next_release = state.output_scheduler.nextRelease();
+  if (std::isfinite(next_release)) {
+    wake = (std::min)(wake, next_release);
+  }
+  const double next_slice = state.engine.trafficPacer().nextDue();
+  if (std::isfinite(next_slice)) {
+    wake = (std::min)(wake, next_slice);
+  }
+  if (state.simconnect && state.settings.traffic_enabled) {
+    wake = (std::min)(wake, state.last_traffic_request +
+                                state.settings.traffic_scan_interval_s);
+  }
+  return wake;
+}
+
+// Fills `scratch` from the worker's state and swaps it into the channel, so
+// the lock is held only for the swap.
+void PublishBridgeStatus(const BridgeState &state, BridgeChannel *channel,
+                         BridgeStatus *scratch) {
+  BridgeStatus &status = *scratch;
+  status.simconnect_ready = state.simconnect_ready;
+  status.using_discovered_target = state.using_discovered_target;
+  status.foreflight_devices = state.foreflight_devices.size();
+  status.target_ip = state.using_discovered_target
+                         ? state.discovered_target_ip
+                         : state.settings.target_ip;
+  status.target_port = state.using_discovered_target
+                           ? state.discovered_target_port
+                           : state.settings.target_port;
+  status.last_traffic_count = state.last_traffic_count;
+  status.packets_sent = state.engine.stats().packets_sent;
+  status.packing = state.engine.packerStats();
+  status.has_bandwidth = state.broadcaster &&
+                         state.settings.bandwidth_limit_bytes_per_s > 0;
+  if (status.has_bandwidth) {
+    status.bandwidth = state.broadcaster->bandwidthStats(0);
+  }
+  status.traffic_tracks = state.traffic_tracks.size();
+  status.traffic_subscriptions = state.traffic_subscriptions.size();
+  status.traffic_query = state.last_traffic_query;
+  status.traffic_schedule = state.traffic_schedule_stats;
+  status.traffic_pacing = state.engine.trafficPacer().stats();
+  status.last_traffic_extrapolation_s = state.last_traffic_extrapolation_s;
+  status.relaying = state.traffic_relay != nullptr;
+  if (status.relaying) {
+    status.relayed_targets = state.relayed_traffic.size();
+    status.last_relayed_count = state.last_relayed_count;
+    status.relay = state.traffic_relay->stats();
+    status.relay_tuning_error = state.traffic_relay->threadTuningError();
+  }
+  status.worker_wake = state.worker_wake.stats();
+  status.worker_tuning_error = state.worker_tuning.lastError();
+  status.capturing = state.stream_capture != nullptr;
+  if (status.capturing) {
+    status.capture = state.stream_capture->stats();
+    status.capture_path = state.stream_capture->path();
+  }
+  status.sharing = state.shared_output != nullptr;
+  if (status.sharing) {
+    status.shared = state.shared_output->stats();
+  }
+  status.metrics_open = state.metrics_exporter.isOpen();
+  status.metrics_reports_sent = state.metrics_exporter.reportsSent();
+  status.metrics_send_errors = state.metrics_exporter.sendErrors();
+  status.metrics_last_error = state.metrics_last_error;
+  status.send_intervals = state.send_intervals;
+  status.stage_timings = state.stage_timings;
+  status.stats_history = state.stats_history;
+  status.accounting = state.engine.accounting();
+  const size_t destinations =
+      state.broadcaster ? state.broadcaster->destinationCount() : 0;
+  status.destinations.resize(destinations);
+  for (size_t i = 0; i < destinations; ++i) {
+    status.destinations[i] =
+        state.broadcaster->destinationIp(i) + ":" +
+        std::to_string(state.broadcaster->destinationPort(i));
+  }
+  status.output_ticks = state.output_scheduler.ticks();
+  status.output_over_budget_ticks = state.output_scheduler.overBudgetTicks();
+  for (size_t i = 0; i < xp2gdl90::SEND_CLASS_COUNT; ++i) {
+    status.output_stats[i] =
+        state.output_scheduler.stats(static_cast<xp2gdl90::SendClass>(i));
+  }
+
+  std::lock_guard<std::mutex> lock(channel->mutex);
+  std::swap(channel->status, status);
+}
+
+// Runs the whole pipeline off the UI thread, so send timing no longer
+// follows vsync or stalls while the window is dragged.
+void RunBridgeWorker(BridgeState *state, BridgeChannel *channel) {
+  WorkerTimer timer;
+  g_log.Info(timer.highResolution()
+                 ? "Bridge worker started (high-resolution timer)."
+                 : "Bridge worker started.");
+  BridgeStatus scratch;
+  double last_connect_attempt = -kSimConnectRetryInterval;
+  double last_publish = -kStatusPublishInterval;
+
+  while (!channel->stop.load(std::memory_order_acquire)) {
+    if (!state->worker_tuning.applyPending()) {
+      g_log.Error("Bridge worker tuning: " + state->worker_tuning.lastError());
+    }
+    double now = 0.0;
+    {
+      XP2GDL90_STAGE_TIMER(&state->stage_timings, xp2gdl90::Stage::CLOCK);
+      now = NowSeconds();
+    }
+    TakeBridgeCommands(state, channel);
+
+    if (!state->simconnect &&
+        now - last_connect_attempt >= kSimConnectRetryInterval) {
+      last_connect_attempt = now;
+      ConnectSimConnect(state);
+    }
+    PollSimConnect(state);
+    RequestTrafficIfDue(state, now);
+    PollForeFlightDiscovery(state, now);
+    RefreshBroadcastTarget(state, now);
+    SendScheduledPackets(state, now);
+    state->stage_timings.endTick();
+    UpdateStatsHistory(state, now);
+    SendMetricsReport(state, now);
+
+    if (now - last_publish >= kStatusPublishInterval) {
+      last_publish = now;
+      PublishBridgeStatus(*state, channel, &scratch);
+    }
+
+    const double wake = NextWorkerWake(*state, now);
+    const double wait_s = (std::max)(kWorkerMinSleep, wake - NowSeconds());
+    const double due = NowSeconds() + wait_s;
+    if (timer.wait(wait_s,
+                   state->simconnect ? state->simconnect_event : nullptr)) {
+      // How late the timer woke us is the scheduler's share of send jitter.
+      state->worker_wake.record(
+          static_cast<int64_t>((NowSeconds() - due) * 1e9));
+    }
+  }
+  DisconnectSimConnect(state);
+  if (state->simconnect_event) {
+    CloseHandle(state->simconnect_event);
+    state->simconnect_event = nullptr;
+  }
+}
+
 // ---------------------------------------------------------------------------
 // UI rendering
 // ---------------------------------------------------------------------------
 
-void RenderUi(BridgeState *state, double now) {
+// What each message class and destination puts on the link.
+void DrawBandwidthAccount(const xp2gdl90::BandwidthAccount &account,
+                          const std::vector<std::string> &destinations) {
+  const xp2gdl90::BandwidthRate total = account.total();
+  ImGui::Text("Link load: %.1f frames/s, %.2f kB/s (last %zu s)",
+              total.frames_per_s, total.bytes_per_s / 1000.0,
+              xp2gdl90::BANDWIDTH_WINDOW_SAMPLES);
+  for (size_t i = 0; i < xp2gdl90::MESSAGE_CLASS_COUNT; ++i) {
+    const xp2gdl90::BandwidthRate rate = account.messageClass(i).rate();
+    ImGui::Text("  %s: %.1f frames/s, %.0f B/s",
+                xp2gdl90::MessageClassName(i), rate.frames_per_s,
+                rate.bytes_per_s);
+  }
+  for (size_t i = 0; i < destinations.size(); ++i) {
+    const xp2gdl90::BandwidthRate rate = account.destination(i).rate();
+    ImGui::Text("  %s: %.1f frames/s, %.0f B/s", destinations[i].c_str(),
+                rate.frames_per_s, rate.bytes_per_s);
+  }
+}
+
+// The link load the settings being edited would put out, before they
+// apply.
+void DrawBandwidthPlan(const xp2gdl90::BandwidthPlan &plan,
+                       uint32_t limit_bytes_per_s) {
+  ImGui::Text("Planned load: %.1f frames/s, %.2f kB/s, %.2f kB/s with "
+              "UDP/IP headers",
+              plan.total.frames_per_s, plan.total.bytes_per_s / 1000.0,
+              plan.wire_bytes_per_s / 1000.0);
+  for (size_t i = 0; i < xp2gdl90::SEND_CLASS_COUNT; ++i) {
+    const xp2gdl90::BandwidthPlanClass &planned = plan.classes[i];
+    if (planned.frames_per_s <= 0.0) {
+      continue;
+    }
+    ImGui::Text("  %s: %.1f/s x %.1f B, %.0f B/s over all destinations",
+                xp2gdl90::SendClassName(static_cast<xp2gdl90::SendClass>(i)),
+                planned.frames_per_s, planned.frame_bytes,
+                planned.load.bytes_per_s);
+  }
+  for (size_t i = 0; i < plan.destination_count; ++i) {
+    const xp2gdl90::BandwidthPlanDestination &destination =
+        plan.destinations[i];
+    if (destination.over_limit) {
+      ImGui::TextColored(ImVec4(1.0f, 0.85f, 0.1f, 1.0f),
+                         "  Destination %zu: %.0f B/s, over the %u B/s limit",
+                         i, destination.load.bytes_per_s,
+                         static_cast<unsigned int>(limit_bytes_per_s));
+    } else {
+      ImGui::Text("  Destination %zu: %.0f B/s, %.1f datagrams/s", i,
+                  destination.load.bytes_per_s, destination.datagrams_per_s);
+    }
+  }
+  if (plan.destinations_refused > 0) {
+    ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f),
+                       "%zu destinations beyond the first %zu are dropped",
+                       plan.destinations_refused, udp::MAX_DESTINATIONS);
+  }
+}
+
+void RenderUi(BridgeUi *ui, BridgeChannel *channel, double now) {
   const ImGuiIO &io = ImGui::GetIO();
+  {
+    std::lock_guard<std::mutex> lock(channel->mutex);
+    ui->status = channel->status;
+  }
+  const BridgeStatus &status = ui->status;
 
   // Full-screen root window
   ImGui::SetNextWindowPos(ImVec2(0, 0));
@@ -735,7 +1920,7 @@ void RenderUi(BridgeState *state, double now) {
                    ImGuiWindowFlags_NoScrollWithMouse);
 
   // ---- Status bar --------------------------------------------------------
-  const bool connected = state->simconnect_ready;
+  const bool connected = status.simconnect_ready;
   if (connected) {
     ImGui::TextColored(ImVec4(0.2f, 0.9f, 0.2f, 1.0f), "● Connected");
   } else {
@@ -743,24 +1928,24 @@ void RenderUi(BridgeState *state, double now) {
   }
   ImGui::SameLine(180.0f);
 
-  const std::string &target_ip = state->using_discovered_target
-                                     ? state->discovered_target_ip
-                                     : state->settings.target_ip;
-  const uint16_t target_port = state->using_discovered_target
-                                   ? state->discovered_target_port
-                                   : state->settings.target_port;
-  ImGui::Text("Target: %s:%d%s", target_ip.c_str(), target_port,
-              state->using_discovered_target ? " (FF)" : "");
+  if (status.foreflight_devices > 1) {
+    ImGui::Text("Target: %s:%d (FF +%zu)", status.target_ip.c_str(),
+                status.target_port, status.foreflight_devices - 1);
+  } else {
+    ImGui::Text("Target: %s:%d%s", status.target_ip.c_str(),
+                status.target_port,
+                status.using_discovered_target ? " (FF)" : "");
+  }
 
   ImGui::SameLine(440.0f);
-  ImGui::Text("Traffic: %d", state->last_traffic_count);
+  ImGui::Text("Traffic: %d", status.last_traffic_count);
 
   ImGui::SameLine(560.0f);
   ImGui::Text("Pkts: %llu",
-              static_cast<unsigned long long>(state->packets_sent));
+              static_cast<unsigned long long>(status.packets_sent));
 
   ImGui::SameLine(680.0f);
-  ImGui::Text("Up: %s", FormatUptime(now - state->start_time).c_str());
+  ImGui::Text("Up: %s", FormatUptime(now - ui->start_time).c_str());
 
   ImGui::Separator();
 
@@ -779,89 +1964,337 @@ void RenderUi(BridgeState *state, double now) {
   bool dirty_now = false;
   if (ImGui::BeginTabBar("##tabs")) {
     if (ImGui::BeginTabItem("Network")) {
-      dirty_now |= ImGui::InputText("Target IP", state->ui_state.target_ip,
-                                    sizeof(state->ui_state.target_ip));
-      dirty_now |= ImGui::InputInt("Target Port", &state->ui_state.target_port);
+      dirty_now |= ImGui::InputText("Target IP", ui->ui_state.target_ip,
+                                    sizeof(ui->ui_state.target_ip));
+      dirty_now |= ImGui::InputInt("Target Port", &ui->ui_state.target_port);
       dirty_now |= ImGui::Checkbox("ForeFlight auto discovery",
-                                   &state->ui_state.foreflight_auto_discovery);
+                                   &ui->ui_state.foreflight_auto_discovery);
       dirty_now |= ImGui::InputInt("ForeFlight broadcast port",
-                                   &state->ui_state.foreflight_broadcast_port);
+                                   &ui->ui_state.foreflight_broadcast_port);
+      ImGui::Separator();
+      dirty_now |= ImGui::Checkbox("Pack frames into datagrams",
+                                   &ui->ui_state.datagram_packing);
+      dirty_now |= ImGui::InputInt("Datagram size (bytes)",
+                                   &ui->ui_state.datagram_max_bytes);
+      if (ui->settings.datagram_packing) {
+        const udp::DatagramPackerStats &packing = status.packing;
+        ImGui::Text("Datagrams: %llu (fill avg %.0f%%, last %.0f%%)",
+                    static_cast<unsigned long long>(packing.datagrams_sent),
+                    packing.averageFillRatio() * 100.0,
+                    packing.last_fill_ratio * 100.0);
+      }
+      dirty_now |= ImGui::InputFloat("Output budget per tick (ms)",
+                                     &ui->ui_state.output_budget_ms, 0.5f,
+                                     2.0f, "%.1f");
+      dirty_now |= ImGui::InputInt("Output budget per tick (bytes)",
+                                   &ui->ui_state.output_budget_bytes, 100,
+                                   1000);
+      ImGui::TextDisabled("Lower-priority messages wait when over; 0 = off");
+      dirty_now |= ImGui::InputInt(
+          "Bandwidth limit (bytes/s)",
+          &ui->ui_state.bandwidth_limit_bytes_per_s, 1000, 10000);
+      ImGui::TextDisabled("Per destination; sheds traffic first; 0 = off");
+      if (status.has_bandwidth) {
+        const udp::BandwidthLimiterStats &bandwidth = status.bandwidth;
+        ImGui::Text("Primary: %.1f kB/s allowed, %llu shed, %llu backoffs",
+                    bandwidth.rate_bytes_per_s / 1000.0,
+                    static_cast<unsigned long long>(bandwidth.shed_messages),
+                    static_cast<unsigned long long>(bandwidth.backoffs));
+      }
+      dirty_now |= ImGui::InputInt("Worker thread priority",
+                                   &ui->ui_state.worker_thread_priority);
+      ImGui::TextDisabled("0=Normal 1=High (MMCSS Pro Audio) "
+                          "2=Time-critical");
+      dirty_now |= ImGui::InputText("Worker CPU mask (hex)",
+                                    ui->ui_state.worker_cpu_mask,
+                                    sizeof(ui->ui_state.worker_cpu_mask));
+      ImGui::TextDisabled("Bit n allows CPU n; 0x0 = any CPU");
+      ImGui::Text("Worker wake-up: avg %.0f us, max %llu us late",
+                  status.worker_wake.averageUs(),
+                  static_cast<unsigned long long>(status.worker_wake.max_us));
+      if (!status.worker_tuning_error.empty()) {
+        ImGui::TextWrapped("Worker tuning: %s",
+                           status.worker_tuning_error.c_str());
+      }
+      ImGui::Text("Extra destinations: %zu (edit extra_destinations in %s)",
+                  ui->settings.extra_destinations.size(),
+                  "msfs2gdl90.json");
       ImGui::EndTabItem();
     }
     if (ImGui::BeginTabItem("Ownship")) {
       dirty_now |=
-          ImGui::InputText("ICAO Address (hex)", state->ui_state.icao_address,
-                           sizeof(state->ui_state.icao_address));
+          ImGui::InputText("ICAO Address (hex)", ui->ui_state.icao_address,
+                           sizeof(ui->ui_state.icao_address));
       dirty_now |=
-          ImGui::InputText("Callsign (fallback)", state->ui_state.callsign,
-                           sizeof(state->ui_state.callsign));
+          ImGui::InputText("Callsign (fallback)", ui->ui_state.callsign,
+                           sizeof(ui->ui_state.callsign));
       dirty_now |= ImGui::InputInt("Emitter Category",
-                                   &state->ui_state.emitter_category);
+                                   &ui->ui_state.emitter_category);
       ImGui::EndTabItem();
     }
     if (ImGui::BeginTabItem("Device")) {
-      dirty_now |= ImGui::InputText("Device Name", state->ui_state.device_name,
-                                    sizeof(state->ui_state.device_name));
+      dirty_now |= ImGui::InputText("Device Name", ui->ui_state.device_name,
+                                    sizeof(ui->ui_state.device_name));
       dirty_now |=
-          ImGui::InputText("Device Long Name", state->ui_state.device_long_name,
-                           sizeof(state->ui_state.device_long_name));
+          ImGui::InputText("Device Long Name", ui->ui_state.device_long_name,
+                           sizeof(ui->ui_state.device_long_name));
       dirty_now |=
-          ImGui::InputInt("Internet Policy", &state->ui_state.internet_policy);
+          ImGui::InputInt("Internet Policy", &ui->ui_state.internet_policy);
       dirty_now |= ImGui::Checkbox("AHRS magnetic heading",
-                                   &state->ui_state.ahrs_use_magnetic_heading);
+                                   &ui->ui_state.ahrs_use_magnetic_heading);
       ImGui::TextDisabled("0=Unrestricted  1=Expensive  2=Disallowed");
       ImGui::EndTabItem();
     }
     if (ImGui::BeginTabItem("Rates")) {
       dirty_now |= ImGui::InputFloat("Heartbeat Rate (Hz)",
-                                     &state->ui_state.heartbeat_rate, 0.1f,
+                                     &ui->ui_state.heartbeat_rate, 0.1f,
                                      1.0f, "%.2f");
       dirty_now |=
           ImGui::InputFloat("Position Rate (Hz)",
-                            &state->ui_state.position_rate, 0.1f, 1.0f, "%.2f");
+                            &ui->ui_state.position_rate, 0.1f, 1.0f, "%.2f");
+      dirty_now |= ImGui::InputFloat("AHRS Rate (Hz)", &ui->ui_state.ahrs_rate,
+                                     1.0f, 5.0f, "%.1f");
+      dirty_now |= ImGui::InputFloat("Geo Altitude Rate (Hz)",
+                                     &ui->ui_state.geo_altitude_rate, 0.5f,
+                                     1.0f, "%.1f");
+      dirty_now |= ImGui::InputFloat("ForeFlight ID Rate (Hz)",
+                                     &ui->ui_state.device_info_rate, 0.5f,
+                                     1.0f, "%.1f");
+      ImGui::TextDisabled("AHRS 0-20 Hz, others 0-5 Hz; 0 turns a message off");
+      ImGui::Separator();
+      ImGui::InputInt("Targets to plan for", &ui->plan_traffic_targets);
+      ImGui::TextDisabled("-1 = tracked now; capped at the traffic maximum");
+      xp2gdl90::Settings planned;
+      std::string plan_error;
+      if (xp2gdl90::BuildConfigFromSettingsUi(ui->ui_state, ui->settings,
+                                              &planned, &plan_error)) {
+        xp2gdl90::BandwidthPlanInputs inputs;
+        inputs.traffic_targets =
+            ui->plan_traffic_targets >= 0
+                ? static_cast<size_t>(ui->plan_traffic_targets)
+                : status.traffic_tracks;
+        inputs.foreflight_devices = status.foreflight_devices;
+        DrawBandwidthPlan(xp2gdl90::PlanBandwidth(planned, inputs),
+                          planned.bandwidth_limit_bytes_per_s);
+      } else {
+        ImGui::TextWrapped("Planned load: %s", plan_error.c_str());
+      }
+      ImGui::EndTabItem();
+    }
+    if (ImGui::BeginTabItem("Traffic")) {
+      dirty_now |= ImGui::Checkbox("Broadcast traffic",
+                                   &ui->ui_state.traffic_enabled);
+      dirty_now |=
+          ImGui::InputFloat("Traffic Rate (Hz)", &ui->ui_state.traffic_rate,
+                            0.1f, 1.0f, "%.2f");
+      dirty_now |= ImGui::InputInt("Traffic Maximum",
+                                   &ui->ui_state.traffic_max_targets);
+      ImGui::TextDisabled("Nearest 0-63 targets");
+      dirty_now |= ImGui::InputFloat("Scan radius (nm)",
+                                     &ui->ui_state.traffic_scan_radius_nm,
+                                     1.0f, 10.0f, "%.1f");
+      dirty_now |= ImGui::InputFloat("Scan interval (s)",
+                                     &ui->ui_state.traffic_scan_interval_s,
+                                     1.0f, 5.0f, "%.0f");
+      dirty_now |= ImGui::InputFloat("Traffic range (nm)",
+                                     &ui->ui_state.traffic_range_nm, 1.0f,
+                                     10.0f, "%.1f");
+      dirty_now |= ImGui::Checkbox("Spatial index",
+                                   &ui->ui_state.traffic_spatial_index);
+      ImGui::TextDisabled("Spatial index needs a traffic range above 0");
+      ImGui::Text("Range query: %zu cells, %zu of %zu targets",
+                  status.traffic_query.cells, status.traffic_query.entries,
+                  status.traffic_tracks);
+      ImGui::Text("Subscribed objects: %zu", status.traffic_subscriptions);
+      dirty_now |= ImGui::Checkbox("Adaptive per-target rate",
+                                   &ui->ui_state.traffic_adaptive_rate);
+      dirty_now |= ImGui::InputFloat(
+          "Frame budget (/s)", &ui->ui_state.traffic_max_frames_per_second,
+          5.0f, 20.0f, "%.0f");
+      if (ui->settings.traffic_adaptive_rate) {
+        const xp2gdl90::traffic::TrafficScheduleStats &schedule =
+            status.traffic_schedule;
+        ImGui::Text("Schedule: %zu sent of %zu due, %zu deferred",
+                    schedule.sent, schedule.due, schedule.deferred);
+      }
+      dirty_now |= ImGui::Checkbox("Pace traffic across the interval",
+                                   &ui->ui_state.traffic_pacing);
+      const udp::TrafficPacerStats &pacing = status.traffic_pacing;
+      ImGui::Text("Bursts: %zu frames last, %zu max", pacing.last_burst,
+                  pacing.max_burst);
+      ImGui::Text("Gap: %.0f ms avg, %.0f ms max",
+                  pacing.averageGapS() * 1000.0, pacing.max_gap_s * 1000.0);
+      dirty_now |= ImGui::InputFloat("Extrapolation horizon (s)",
+                                     &ui->ui_state.extrapolation_horizon_s,
+                                     0.1f, 1.0f, "%.1f");
+      ImGui::TextDisabled("Also applies to ownship; 0 disables");
+      if (ui->settings.extrapolation_horizon_s > 0.0f) {
+        ImGui::Text("Extrapolated up to %.0f ms last sweep",
+                    status.last_traffic_extrapolation_s * 1000.0);
+      }
+      dirty_now |= ImGui::Checkbox("Relay traffic from a GDL90 feed",
+                                   &ui->ui_state.traffic_relay);
+      dirty_now |=
+          ImGui::InputInt("Relay port", &ui->ui_state.traffic_relay_port);
+      dirty_now |= ImGui::InputInt("Relay priority",
+                                   &ui->ui_state.traffic_relay_priority);
+      ImGui::TextDisabled("0=Simulator copy wins 1=Feed copy wins");
+      if (status.relaying) {
+        ImGui::Text("Relayed: %zu targets, %zu sent last sweep",
+                    status.relayed_targets, status.last_relayed_count);
+        ImGui::Text("Feed: %llu reports, %llu dropped, %llu bad frames",
+                    static_cast<unsigned long long>(status.relay.reports),
+                    static_cast<unsigned long long>(status.relay.dropped),
+                    static_cast<unsigned long long>(status.relay.bad_frames));
+        if (!status.relay_tuning_error.empty()) {
+          ImGui::TextWrapped("Relay thread tuning: %s",
+                             status.relay_tuning_error.c_str());
+        }
+      }
       ImGui::EndTabItem();
     }
     if (ImGui::BeginTabItem("Accuracy")) {
-      dirty_now |= ImGui::InputInt("NIC", &state->ui_state.nic);
-      dirty_now |= ImGui::InputInt("NACp", &state->ui_state.nacp);
+      dirty_now |= ImGui::InputInt("NIC", &ui->ui_state.nic);
+      dirty_now |= ImGui::InputInt("NACp", &ui->ui_state.nacp);
       ImGui::EndTabItem();
     }
     if (ImGui::BeginTabItem("Debug")) {
       dirty_now |=
-          ImGui::Checkbox("Debug logging", &state->ui_state.debug_logging);
+          ImGui::Checkbox("Debug logging", &ui->ui_state.debug_logging);
       dirty_now |=
-          ImGui::Checkbox("Log raw messages", &state->ui_state.log_messages);
+          ImGui::Checkbox("Log raw messages", &ui->ui_state.log_messages);
+      dirty_now |= ImGui::Checkbox("Capture sent datagrams to pcap",
+                                   &ui->ui_state.stream_capture);
+      dirty_now |= ImGui::InputInt("Capture ring size (MB)",
+                                   &ui->ui_state.stream_capture_mb);
+      dirty_now |= ImGui::Checkbox("Compact capture log (.xcap)",
+                                   &ui->ui_state.stream_capture_compact);
+      if (status.capturing) {
+        const udp::StreamCaptureStats &capture = status.capture;
+        // Only the compact writer reports what reached the disk.
+        if (capture.file_bytes > 0) {
+          ImGui::Text("Captured: %llu datagrams, %.1f MB on disk for "
+                      "%.1f MB sent, %llu dropped",
+                      static_cast<unsigned long long>(capture.records),
+                      static_cast<double>(capture.file_bytes) / 1048576.0,
+                      static_cast<double>(capture.bytes) / 1048576.0,
+                      static_cast<unsigned long long>(capture.dropped));
+        } else {
+          ImGui::Text("Captured: %llu records, %llu wraps of %zu slots",
+                      static_cast<unsigned long long>(capture.records),
+                      static_cast<unsigned long long>(capture.wraps),
+                      capture.slots);
+        }
+        ImGui::TextWrapped("%s", status.capture_path.c_str());
+      }
+      dirty_now |= ImGui::Checkbox("Publish to shared memory",
+                                   &ui->ui_state.shared_output);
+      if (status.sharing) {
+        ImGui::Text("Shared \"%s\": %llu frames, %llu snapshots",
+                    kSharedOutputName,
+                    static_cast<unsigned long long>(status.shared.frames),
+                    static_cast<unsigned long long>(status.shared.snapshots));
+      }
+      dirty_now |= ImGui::Checkbox("Send link probe marks",
+                                   &ui->ui_state.link_probe);
+      dirty_now |= ImGui::Checkbox("Send metrics to a collector",
+                                   &ui->ui_state.metrics_enabled);
+      dirty_now |= ImGui::InputText("Metrics IP", ui->ui_state.metrics_ip,
+                                    sizeof(ui->ui_state.metrics_ip));
+      dirty_now |=
+          ImGui::InputInt("Metrics port", &ui->ui_state.metrics_port);
+      dirty_now |= ImGui::InputFloat("Metrics interval (s)",
+                                     &ui->ui_state.metrics_interval_s,
+                                     1.0f, 5.0f, "%.0f");
+      if (status.metrics_open) {
+        ImGui::Text(
+            "Metrics reports: %llu sent, %llu failed",
+            static_cast<unsigned long long>(status.metrics_reports_sent),
+            static_cast<unsigned long long>(status.metrics_send_errors));
+      }
+      if (!status.metrics_last_error.empty()) {
+        ImGui::TextWrapped("Metrics: %s", status.metrics_last_error.c_str());
+      }
+      ImGui::Separator();
+      ImGui::TextUnformatted("Send interval vs period (ms late):");
+      for (size_t i = 0; i < xp2gdl90::SEND_CLASS_COUNT; ++i) {
+        const xp2gdl90::SendIntervalHistogram &intervals =
+            status.send_intervals[i];
+        const auto send_class = static_cast<xp2gdl90::SendClass>(i);
+        ImGui::Text("%s: %llu, mean %.1f ms, min %.1f, max %.1f",
+                    xp2gdl90::SendClassName(send_class),
+                    static_cast<unsigned long long>(intervals.count()),
+                    intervals.meanIntervalS() * 1000.0,
+                    intervals.minIntervalS() * 1000.0,
+                    intervals.maxIntervalS() * 1000.0);
+        std::string buckets;
+        for (size_t b = 0; b < xp2gdl90::SEND_INTERVAL_BUCKETS; ++b) {
+          buckets += std::string(b > 0 ? " | " : "  ") +
+                     xp2gdl90::SendIntervalHistogram::bucketLabel(b) + ": " +
+                     std::to_string(intervals.buckets()[b]);
+        }
+        ImGui::TextUnformatted(buckets.c_str());
+      }
+      ImGui::Separator();
+      DrawBandwidthAccount(status.accounting, status.destinations);
+      ImGui::Separator();
+      xp2gdl90::DrawStatsHistory(status.stats_history);
+      ImGui::Separator();
+      xp2gdl90::DrawStageTimings(status.stage_timings);
+      ImGui::Separator();
+      ImGui::Text(
+          "Output ticks: %llu, %llu over budget",
+          static_cast<unsigned long long>(status.output_ticks),
+          static_cast<unsigned long long>(status.output_over_budget_ticks));
+      for (size_t i = 0; i < xp2gdl90::SEND_CLASS_COUNT; ++i) {
+        const auto send_class = static_cast<xp2gdl90::SendClass>(i);
+        const xp2gdl90::OutputClassStats &output = status.output_stats[i];
+        ImGui::Text("%s: %llu deferred, %llu dropped, %llu missed, "
+                    "worst %.0f ms late",
+                    xp2gdl90::SendClassName(send_class),
+                    static_cast<unsigned long long>(output.deferred),
+                    static_cast<unsigned long long>(output.dropped),
+                    static_cast<unsigned long long>(output.deadline_misses),
+                    output.max_lateness_s * 1000.0);
+      }
+      if (ImGui::Button("Reset timing")) {
+        {
+          std::lock_guard<std::mutex> lock(channel->mutex);
+          channel->reset_timing = true;
+        }
+        channel->commands_pending.store(true, std::memory_order_release);
+      }
       ImGui::EndTabItem();
     }
     ImGui::EndTabBar();
   }
 
   if (dirty_now)
-    state->settings_dirty = true;
+    ui->settings_dirty = true;
 
   ImGui::Separator();
-  if (state->settings_dirty) {
+  if (ui->settings_dirty) {
     ImGui::TextColored(ImVec4(1.0f, 0.85f, 0.1f, 1.0f), "Unsaved changes.");
   } else {
     ImGui::TextDisabled("No pending changes.");
   }
-  if (!state->settings_last_error.empty()) {
+  if (!ui->settings_last_error.empty()) {
     ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s",
-                       state->settings_last_error.c_str());
+                       ui->settings_last_error.c_str());
   }
 
-  ImGui::BeginDisabled(!state->settings_dirty);
+  ImGui::BeginDisabled(!ui->settings_dirty);
   if (ImGui::Button("Apply & Save")) {
-    ApplySettings(state);
-    xp2gdl90::SyncSettingsUiFromConfig(&state->ui_state, state->settings);
+    SubmitSettings(ui, channel);
+    xp2gdl90::SyncSettingsUiFromConfig(&ui->ui_state, ui->settings);
   }
   ImGui::EndDisabled();
   ImGui::SameLine();
-  ImGui::BeginDisabled(!state->settings_dirty);
+  ImGui::BeginDisabled(!ui->settings_dirty);
   if (ImGui::Button("Revert")) {
-    xp2gdl90::SyncSettingsUiFromConfig(&state->ui_state, state->settings);
-    state->settings_dirty = false;
-    state->settings_last_error.clear();
+    xp2gdl90::SyncSettingsUiFromConfig(&ui->ui_state, ui->settings);
+    ui->settings_dirty = false;
+    ui->settings_last_error.clear();
   }
   ImGui::EndDisabled();
 
@@ -875,21 +2308,18 @@ void RenderUi(BridgeState *state, double now) {
 
   ImGui::BeginChild("##log_scroll", ImVec2(0, 0), false,
                     ImGuiWindowFlags_HorizontalScrollbar);
-  {
-    std::lock_guard<std::mutex> lock(g_log.mutex);
-    for (const LogEntry &entry : g_log.entries) {
-      if (entry.is_error) {
-        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s",
-                           entry.text.c_str());
-      } else {
-        ImGui::TextUnformatted(entry.text.c_str());
-      }
-    }
-    if (g_log.scroll_to_bottom) {
-      ImGui::SetScrollHereY(1.0f);
-      g_log.scroll_to_bottom = false;
+  for (const LogEntry &entry : g_log.entries) {
+    if (entry.is_error) {
+      ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s",
+                         entry.text.c_str());
+    } else {
+      ImGui::TextUnformatted(entry.text.c_str());
     }
   }
+  if (g_log.scroll_to_bottom) {
+    ImGui::SetScrollHereY(1.0f);
+    g_log.scroll_to_bottom = false;
+  }
   ImGui::EndChild(); // log_scroll
   ImGui::EndChild(); // log
 
@@ -901,12 +2331,17 @@ void RenderUi(BridgeState *state, double now) {
 // ---------------------------------------------------------------------------
 
 static HWND g_hwnd = nullptr;
+// UI throttling state; networking runs on the worker regardless of these.
+static bool g_minimized = false;
+static bool g_active = true;
+static bool g_occluded = false;
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
   if (ImGui_ImplWin32_WndProcHandler(hwnd, msg, wparam, lparam))
     return true;
   switch (msg) {
   case WM_SIZE:
+    g_minimized = wparam == SIZE_MINIMIZED;
     if (g_device && wparam != SIZE_MINIMIZED) {
       CleanupRenderTarget();
       g_swap_chain->ResizeBuffers(0, LOWORD(lparam), HIWORD(lparam),
@@ -914,6 +2349,9 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
       CreateRenderTarget();
     }
     return 0;
+  case WM_ACTIVATE:
+    g_active = LOWORD(wparam) != WA_INACTIVE;
+    break;
   case WM_SYSCOMMAND:
     if ((wparam & 0xFFF0) == SC_KEYMENU)
       return 0;
@@ -927,6 +2365,134 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam) {
   return DefWindowProcW(hwnd, msg, wparam, lparam);
 }
 
+// ---------------------------------------------------------------------------
+// Headless mode
+// ---------------------------------------------------------------------------
+
+constexpr UINT kTrayMessage = WM_APP + 1;
+constexpr DWORD kHeadlessLogFlushMs = 100;
+constexpr UINT kTrayExitCommand = 1;
+
+DWORD g_main_thread_id = 0;
+
+// Ctrl+C or closing the launching console stops the bridge.
+BOOL WINAPI HeadlessCtrlHandler(DWORD) {
+  PostThreadMessageW(g_main_thread_id, WM_QUIT, 0, 0);
+  return TRUE;
+}
+
+LRESULT CALLBACK TrayWndProc(HWND hwnd, UINT msg, WPARAM wparam,
+                             LPARAM lparam) {
+  if (msg == kTrayMessage &&
+      (LOWORD(lparam) == WM_RBUTTONUP || LOWORD(lparam) == WM_LBUTTONDBLCLK)) {
+    HMENU menu = CreatePopupMenu();
+    AppendMenuW(menu, MF_STRING, kTrayExitCommand, L"Exit msfs2gdl90");
+    POINT cursor;
+    GetCursorPos(&cursor);
+    // Required so the menu closes when the user clicks elsewhere.
+    SetForegroundWindow(hwnd);
+    const UINT command =
+        TrackPopupMenu(menu, TPM_RETURNCMD | TPM_NONOTIFY, cursor.x, cursor.y,
+                       0, hwnd, nullptr);
+    DestroyMenu(menu);
+    if (command == kTrayExitCommand) {
+      PostQuitMessage(0);
+    }
+    return 0;
+  }
+  return DefWindowProcW(hwnd, msg, wparam, lparam);
+}
+
+// Sends the log to the launching console, if any, and to msfs2gdl90.log next
+// to the settings file. Returns the log file, or null if it cannot be opened.
+FILE *OpenHeadlessLog(const std::string &settings_path) {
+  if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+    FILE *console = nullptr;
+    if (freopen_s(&console, "CONOUT$", "w", stdout) == 0 && console) {
+      g_log.AddSink(console);
+    }
+  }
+  const std::string log_path =
+      (std::filesystem::path(settings_path).parent_path() / "msfs2gdl90.log")
+          .string();
+  FILE *file = nullptr;
+  if (fopen_s(&file, log_path.c_str(), "w") != 0 || !file) {
+    g_log.Error("Could not open log file: " + log_path);
+    return nullptr;
+  }
+  g_log.AddSink(file);
+  return file;
+}
+
+// Runs the bridge worker with no D3D11 device or ImGui context, so it uses
+// no GPU time. The main thread only waits for a quit message.
+int RunHeadless(BridgeState *state) {
+  FILE *log_file = OpenHeadlessLog(state->settings_path);
+  g_main_thread_id = GetCurrentThreadId();
+  MSG msg;
+  // Creates this thread's message queue before anything can post to it.
+  PeekMessageW(&msg, nullptr, WM_USER, WM_USER, PM_NOREMOVE);
+  SetConsoleCtrlHandler(HeadlessCtrlHandler, TRUE);
+
+  const HINSTANCE instance = GetModuleHandleW(nullptr);
+  HWND tray_window = nullptr;
+  NOTIFYICONDATAW tray = {};
+  if (state->tray_icon) {
+    WNDCLASSEXW wc = {};
+    wc.cbSize = sizeof(wc);
+    wc.lpfnWndProc = TrayWndProc;
+    wc.hInstance = instance;
+    wc.lpszClassName = L"MSFS2GDL90Tray";
+    RegisterClassExW(&wc);
+    // Hidden top-level window; message-only windows get no tray callbacks.
+    tray_window = CreateWindowExW(0, L"MSFS2GDL90Tray", L"msfs2gdl90", 0, 0,
+                                  0, 0, 0, nullptr, nullptr, instance,
+                                  nullptr);
+    tray.cbSize = sizeof(tray);
+    tray.hWnd = tray_window;
+    tray.uID = 1;
+    tray.uFlags = NIF_ICON | NIF_MESSAGE | NIF_TIP;
+    tray.uCallbackMessage = kTrayMessage;
+    tray.hIcon = LoadIcon(nullptr, IDI_APPLICATION);
+    wcscpy_s(tray.szTip, L"MSFS \u2192 GDL90 (headless)");
+    if (!tray_window || !Shell_NotifyIconW(NIM_ADD, &tray)) {
+      g_log.Error("Could not add the tray icon.");
+    }
+  }
+
+  g_log.Info("Running headless; waiting for MSFS 2020/2024...");
+  BridgeChannel channel;
+  std::thread worker(RunBridgeWorker, state, &channel);
+  bool running = true;
+  while (running) {
+    MsgWaitForMultipleObjects(0, nullptr, FALSE, kHeadlessLogFlushMs,
+                              QS_ALLINPUT);
+    while (PeekMessageW(&msg, nullptr, 0U, 0U, PM_REMOVE)) {
+      if (msg.message == WM_QUIT) {
+        running = false;
+      }
+      TranslateMessage(&msg);
+      DispatchMessageW(&msg);
+    }
+    g_log.Drain();
+  }
+  channel.stop.store(true, std::memory_order_release);
+  worker.join();
+
+  if (tray_window) {
+    Shell_NotifyIconW(NIM_DELETE, &tray);
+    DestroyWindow(tray_window);
+    UnregisterClassW(L"MSFS2GDL90Tray", instance);
+  }
+  g_log.Info("Stopped.");
+  g_log.Drain();
+  if (log_file) {
+    g_log.sinks.clear();
+    std::fclose(log_file);
+  }
+  return 0;
+}
+
 // ---------------------------------------------------------------------------
 // CLI
 // ---------------------------------------------------------------------------
@@ -951,12 +2517,15 @@ void EnsureSettingsDirectory(const std::string &path) {
 void PrintUsage() {
   MessageBoxA(nullptr,
               "msfs2gdl90.exe [--config PATH] [--target-ip IPv4] "
-              "[--target-port PORT] [--debug]\n\n"
+              "[--target-port PORT] [--debug] [--headless [--tray]]\n\n"
               "MSFS 2020/2024 SimConnect to GDL90 bridge.\n\n"
               "  --config PATH     Path to JSON settings file\n"
               "  --target-ip IPv4  Override broadcast target IP\n"
               "  --target-port N   Override broadcast target port\n"
-              "  --debug           Enable verbose debug logging",
+              "  --debug           Enable verbose debug logging\n"
+              "  --headless        Run without a window; log to the console\n"
+              "                    and msfs2gdl90.log\n"
+              "  --tray            With --headless, show a tray icon to exit",
               "msfs2gdl90", MB_OK | MB_ICONINFORMATION);
 }
 
@@ -990,6 +2559,14 @@ bool ParseArgs(int argc, char **argv, BridgeState *state) {
       state->debug_flag = true;
       continue;
     }
+    if (arg == "--headless") {
+      state->headless = true;
+      continue;
+    }
+    if (arg == "--tray") {
+      state->tray_icon = true;
+      continue;
+    }
     MessageBoxA(nullptr, ("Unknown argument: " + arg).c_str(), "msfs2gdl90",
                 MB_OK | MB_ICONERROR);
     return false;
@@ -1047,9 +2624,15 @@ int main(int argc, char **argv) {
     return 1;
   }
 
-  xp2gdl90::SyncSettingsUiFromConfig(&state.ui_state, state.settings);
+  BridgeUi ui;
+  ui.settings = state.settings;
+  ui.settings_path = state.settings_path;
+  xp2gdl90::SyncSettingsUiFromConfig(&ui.ui_state, ui.settings);
+  ConfigureTrafficGrid(&state);
+  ConfigureTrafficBuild(&state);
 
-  state.encoder = std::make_unique<gdl90::GDL90Encoder>();
+  state.encoder =
+      std::make_unique<gdl90::TimedGDL90Encoder<gdl90::SteadyUtcClock>>();
   state.foreflight_encoder =
       std::make_unique<gdl90::foreflight::ForeFlightEncoder>();
 
@@ -1058,6 +2641,8 @@ int main(int argc, char **argv) {
                 MB_OK | MB_ICONERROR);
     return 1;
   }
+  if (state.headless)
+    return RunHeadless(&state);
 
   // Create window
   WNDCLASSEXW wc = {};
@@ -1093,10 +2678,12 @@ int main(int argc, char **argv) {
   ImGui_ImplDX11_Init(g_device, g_device_context);
 
   g_log.Info("Waiting for MSFS 2020/2024...");
-  state.start_time = NowSeconds();
+  ui.start_time = NowSeconds();
 
-  double last_connect_attempt = -10.0;
+  BridgeChannel channel;
+  std::thread worker(RunBridgeWorker, &state, &channel);
   bool running = true;
+  double next_unfocused_frame = 0.0;
 
   while (running) {
     MSG msg;
@@ -1108,36 +2695,51 @@ int main(int argc, char **argv) {
     }
     if (!running)
       break;
+    // Drained even while throttled, so the ring cannot fill up.
+    g_log.Drain();
 
-    const double now = NowSeconds();
-
-    // SimConnect work
-    if (!state.simconnect && now - last_connect_attempt >= 2.0) {
-      last_connect_attempt = now;
-      ConnectSimConnect(&state);
+    // Nobody is looking: skip frames so MSFS gets the GPU and CPU back.
+    // Waking on messages keeps restore and input responsive.
+    if (g_minimized) {
+      MsgWaitForMultipleObjects(0, nullptr, FALSE, kHiddenPollMs, QS_ALLINPUT);
+      continue;
+    }
+    if (g_occluded) {
+      if (g_swap_chain->Present(0, DXGI_PRESENT_TEST) == DXGI_STATUS_OCCLUDED) {
+        MsgWaitForMultipleObjects(0, nullptr, FALSE, kHiddenPollMs,
+                                  QS_ALLINPUT);
+        continue;
+      }
+      g_occluded = false;
+    }
+    if (!g_active) {
+      const double wait_s = next_unfocused_frame - NowSeconds();
+      if (wait_s > 0.0) {
+        MsgWaitForMultipleObjects(0, nullptr, FALSE,
+                                  static_cast<DWORD>(wait_s * 1000.0) + 1,
+                                  QS_ALLINPUT);
+        continue;
+      }
+      next_unfocused_frame = NowSeconds() + kUnfocusedFrameInterval;
     }
-    PollSimConnect(&state);
-    RequestTrafficIfDue(&state, now);
-    PollForeFlightDiscovery(&state, now);
-    RefreshBroadcastTarget(&state, now);
-    SendScheduledPackets(&state, now);
 
     // Render
     ImGui_ImplDX11_NewFrame();
     ImGui_ImplWin32_NewFrame();
     ImGui::NewFrame();
 
-    RenderUi(&state, now);
+    RenderUi(&ui, &channel, NowSeconds());
 
     ImGui::Render();
     constexpr float kClear[4] = {0.1f, 0.1f, 0.1f, 1.0f};
     g_device_context->OMSetRenderTargets(1, &g_rtv, nullptr);
     g_device_context->ClearRenderTargetView(g_rtv, kClear);
     ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
-    g_swap_chain->Present(1, 0); // vsync
+    g_occluded = g_swap_chain->Present(1, 0) == DXGI_STATUS_OCCLUDED; // vsync
   }
 
-  DisconnectSimConnect(&state);
+  channel.stop.store(true, std::memory_order_release);
+  worker.join();
 
   ImGui_ImplDX11_Shutdown();
   ImGui_ImplWin32_Shutdown();
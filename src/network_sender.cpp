@@ -0,0 +1,350 @@
+#include "xp2gdl90/network_sender.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <system_error>
+
+namespace udp {
+
+namespace {
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+NetworkSender::NetworkSender(UDPBroadcaster &broadcaster,
+                             OverflowPolicy policy, size_t priority_capacity,
+                             size_t traffic_capacity)
+    : broadcaster_(broadcaster), priority_(priority_capacity),
+      traffic_(traffic_capacity), policy_(policy) {
+  batch_.reserve(traffic_.capacity());
+  backlog_.reserve(traffic_.capacity());
+}
+
+NetworkSender::~NetworkSender() { stop(); }
+
+bool NetworkSender::start() {
+  if (thread_.joinable()) {
+    return true;
+  }
+
+  stop_requested_.store(false);
+  try {
+    thread_ = std::thread(&NetworkSender::run, this);
+  } catch (const std::system_error &error) {
+    std::lock_guard<std::mutex> lock(broadcaster_mutex_);
+    last_error_ =
+        std::string("Sender thread failed to start: ") + error.what();
+    return false;
+  }
+  return true;
+}
+
+void NetworkSender::stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+
+  stop_requested_.store(true);
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+  }
+  wake_.notify_one();
+  thread_.join();
+}
+
+void NetworkSender::setPacking(bool enabled, size_t max_datagram_bytes) {
+  packing_max_bytes_.store(std::max(
+      DATAGRAM_MIN_MAX_BYTES,
+      std::min(DATAGRAM_MAX_MAX_BYTES, max_datagram_bytes)));
+  packing_enabled_.store(enabled);
+}
+
+void NetworkSender::notify() {
+  flushTrafficBacklog();
+  if (priority_.readable() > 0 || traffic_.readable() > 0) {
+    wake_latency_.notified(NowNs());
+  }
+  wake_.notify_one();
+}
+
+bool NetworkSender::enqueue(const uint8_t *frame, size_t size, uint32_t route,
+                            bool leading) {
+  Slot *slot = priority_.producerSlot();
+  if (!slot || size > slot->bytes.size()) {
+    priority_overflows_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  FillSlot(slot, frame, size, route, leading, 0, NowNs());
+  priority_.publish();
+  return true;
+}
+
+bool NetworkSender::enqueue(gdl90::FrameRef frame, uint32_t route,
+                            bool leading) {
+  Slot *slot = frame ? priority_.producerSlot() : nullptr;
+  if (!slot) {
+    priority_overflows_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  slot->size = frame.size();
+  slot->frame = std::move(frame);
+  slot->route = route;
+  slot->leading = leading;
+  slot->generation = 0;
+  slot->enqueued_ns = NowNs();
+  priority_.publish();
+  return true;
+}
+
+size_t NetworkSender::enqueueTraffic(const gdl90::FrameArena &frames,
+                                     uint32_t route) {
+  return enqueueTraffic(frames, 0, frames.frameCount(), route);
+}
+
+size_t NetworkSender::enqueueTraffic(const gdl90::FrameArena &frames,
+                                     size_t first, size_t count,
+                                     uint32_t route) {
+  if (first >= frames.frameCount()) {
+    return 0;
+  }
+  count = std::min(count, frames.frameCount() - first);
+  if (count == 0) {
+    return 0;
+  }
+
+  // An earlier tick still waiting to be queued is superseded by this one.
+  flushTrafficBacklog();
+  dropTrafficBacklog();
+
+  const uint64_t generation = ++traffic_generation_;
+  const bool drop_oldest =
+      policy_.load() == OverflowPolicy::DROP_OLDEST_TRAFFIC;
+  if (traffic_.freeSlots() < count && drop_oldest) {
+    // Everything still queued is superseded by this tick's picture; the
+    // sender thread releases it unsent.
+    stale_before_.store(generation, std::memory_order_release);
+  }
+
+  const int64_t now = NowNs();
+  size_t queued = 0;
+  for (; queued < count; ++queued) {
+    Slot *slot = traffic_.producerSlot();
+    if (!slot) {
+      break;
+    }
+    FillSlot(slot, frames.frameData(first + queued),
+             frames.frameSize(first + queued), route, false, generation, now);
+    traffic_.publish();
+  }
+
+  // What does not fit until the stale frames are released waits here, up
+  // to a whole ring, and is queued by a later notify() or enqueue.
+  size_t accepted = queued;
+  if (queued < count && drop_oldest) {
+    const size_t waiting =
+        std::min(count - queued, traffic_.capacity() - queued);
+    for (size_t i = 0; i < waiting; ++i) {
+      const size_t index = first + queued + i;
+      std::memcpy(backlog_.beginFrame(), frames.frameData(index),
+                  frames.frameSize(index));
+      backlog_.commitFrame(frames.frameSize(index));
+    }
+    backlog_route_ = route;
+    backlog_generation_ = generation;
+    backlog_enqueued_ns_ = now;
+    accepted += waiting;
+  }
+
+  if (accepted < count) {
+    traffic_dropped_newest_.fetch_add(count - accepted,
+                                      std::memory_order_relaxed);
+  }
+  return accepted;
+}
+
+void NetworkSender::flushTrafficBacklog() {
+  for (; backlog_next_ < backlog_.frameCount(); ++backlog_next_) {
+    Slot *slot = traffic_.producerSlot();
+    if (!slot) {
+      return;
+    }
+    FillSlot(slot, backlog_.frameData(backlog_next_),
+             backlog_.frameSize(backlog_next_), backlog_route_, false,
+             backlog_generation_, backlog_enqueued_ns_);
+    traffic_.publish();
+  }
+  backlog_.clear();
+  backlog_next_ = 0;
+}
+
+void NetworkSender::dropTrafficBacklog() {
+  const size_t waiting = backlog_.frameCount() - backlog_next_;
+  if (waiting > 0) {
+    traffic_dropped_oldest_.fetch_add(waiting, std::memory_order_relaxed);
+  }
+  backlog_.clear();
+  backlog_next_ = 0;
+}
+
+size_t NetworkSender::drain() {
+  std::lock_guard<std::mutex> lock(broadcaster_mutex_);
+
+  const bool packing = packing_enabled_.load();
+  if (packing) {
+    const size_t max_bytes = packing_max_bytes_.load();
+    if (packer_.maxDatagramBytes() != max_bytes) {
+      packer_.flush(broadcaster_);
+      packer_.setMaxDatagramBytes(max_bytes);
+    }
+  }
+
+  size_t sent = 0;
+  const size_t priority_count = priority_.readable();
+  for (size_t i = 0; i < priority_count; ++i) {
+    sent += sendSlot(priority_.peek(i)) ? 1 : 0;
+  }
+  priority_.release(priority_count);
+
+  const uint64_t stale_before = stale_before_.load(std::memory_order_acquire);
+  const size_t traffic_count = traffic_.readable();
+  for (size_t i = 0; i < traffic_count; ++i) {
+    Slot &slot = traffic_.peek(i);
+    if (slot.generation < stale_before) {
+      traffic_dropped_oldest_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    if (packing) {
+      sent += sendSlot(slot) ? 1 : 0;
+      continue;
+    }
+    // Runs of traffic for the same destinations go out as one batch.
+    if (!batch_.empty() && slot.route != batch_route_) {
+      sent += sendTrafficBatch();
+    }
+    batch_route_ = slot.route;
+    batch_enqueued_ns_ = slot.enqueued_ns;
+    batch_.push_back(SendBuffer{slot.bytes.data(), slot.size});
+  }
+  if (!batch_.empty()) {
+    sent += sendTrafficBatch();
+  }
+  traffic_.release(traffic_count);
+
+  if (packing && packer_.flush(broadcaster_) < 0) {
+    send_errors_.fetch_add(1, std::memory_order_relaxed);
+    last_error_ = broadcaster_.getLastError();
+  }
+  return sent;
+}
+
+bool NetworkSender::sendSlot(Slot &slot) {
+  const uint8_t *data = slot.frame ? slot.frame.data() : slot.bytes.data();
+  bool ok = false;
+  if (packing_enabled_.load()) {
+    ok = packer_.append(data, slot.size, slot.leading, broadcaster_,
+                        slot.route);
+  } else {
+    ok = broadcaster_.send(data, slot.size, slot.route) >= 0;
+  }
+  recordLatency(slot.enqueued_ns);
+  // The packer copied the frame, so the block can go back to its pool.
+  slot.frame.reset();
+
+  if (!ok) {
+    send_errors_.fetch_add(1, std::memory_order_relaxed);
+    last_error_ = broadcaster_.getLastError();
+    return false;
+  }
+  frames_sent_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+size_t NetworkSender::sendTrafficBatch() {
+  const int result =
+      broadcaster_.sendBatch(batch_.data(), batch_.size(), batch_route_);
+  const size_t sent = result > 0 ? static_cast<size_t>(result) : 0;
+  for (size_t i = 0; i < sent; ++i) {
+    recordLatency(batch_enqueued_ns_);
+  }
+  frames_sent_.fetch_add(sent, std::memory_order_relaxed);
+  if (sent < batch_.size()) {
+    send_errors_.fetch_add(batch_.size() - sent, std::memory_order_relaxed);
+    last_error_ = broadcaster_.getLastError();
+  }
+  batch_.clear();
+  return sent;
+}
+
+void NetworkSender::FillSlot(Slot *slot, const uint8_t *frame, size_t size,
+                             uint32_t route, bool leading, uint64_t generation,
+                             int64_t enqueued_ns) {
+  std::memcpy(slot->bytes.data(), frame, size);
+  slot->frame.reset();
+  slot->size = size;
+  slot->route = route;
+  slot->leading = leading;
+  slot->generation = generation;
+  slot->enqueued_ns = enqueued_ns;
+}
+
+void NetworkSender::recordLatency(int64_t enqueued_ns) {
+  const int64_t elapsed_ns = std::max<int64_t>(0, NowNs() - enqueued_ns);
+  const uint64_t latency_us = static_cast<uint64_t>(elapsed_ns / 1000);
+  latency_samples_.fetch_add(1, std::memory_order_relaxed);
+  latency_sum_us_.fetch_add(latency_us, std::memory_order_relaxed);
+  latency_last_us_.store(latency_us, std::memory_order_relaxed);
+  if (latency_us > latency_max_us_.load(std::memory_order_relaxed)) {
+    latency_max_us_.store(latency_us, std::memory_order_relaxed);
+  }
+}
+
+void NetworkSender::run() {
+  while (!stop_requested_.load()) {
+    tuning_.applyPending();
+    drain();
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    // The timeout bounds latency if a notify races with the check.
+    const bool for_work =
+        wake_.wait_for(lock, std::chrono::milliseconds(5), [this] {
+          return stop_requested_.load() || priority_.readable() > 0 ||
+                 traffic_.readable() > 0;
+        });
+    wake_latency_.woke(NowNs(), for_work);
+  }
+  drain();
+}
+
+NetworkSenderStats NetworkSender::stats() const {
+  NetworkSenderStats stats;
+  stats.frames_sent = frames_sent_.load(std::memory_order_relaxed);
+  stats.send_errors = send_errors_.load(std::memory_order_relaxed);
+  stats.traffic_dropped_oldest =
+      traffic_dropped_oldest_.load(std::memory_order_relaxed);
+  stats.traffic_dropped_newest =
+      traffic_dropped_newest_.load(std::memory_order_relaxed);
+  stats.priority_overflows =
+      priority_overflows_.load(std::memory_order_relaxed);
+  stats.latency_samples = latency_samples_.load(std::memory_order_relaxed);
+  stats.latency_sum_us = latency_sum_us_.load(std::memory_order_relaxed);
+  stats.latency_max_us = latency_max_us_.load(std::memory_order_relaxed);
+  stats.latency_last_us = latency_last_us_.load(std::memory_order_relaxed);
+  stats.wake_latency = wake_latency_.stats();
+  stats.priority_queued = priority_.capacity() - priority_.freeSlots();
+  stats.traffic_queued = traffic_.capacity() - traffic_.freeSlots();
+  return stats;
+}
+
+std::string NetworkSender::lastError() const {
+  std::lock_guard<std::mutex> lock(broadcaster_mutex_);
+  return last_error_;
+}
+
+} // namespace udp
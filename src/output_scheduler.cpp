@@ -0,0 +1,251 @@
+#include "xp2gdl90/output_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace xp2gdl90 {
+namespace {
+
+// Weight of the newest sample in a class's running cost estimate.
+constexpr double kCostSmoothing = 0.25;
+
+double SmoothCost(double estimate, double sample) {
+  return estimate > 0.0 ? estimate + kCostSmoothing * (sample - estimate)
+                        : sample;
+}
+
+// Insertion sort; there are only SEND_CLASS_COUNT classes.
+template <typename Less>
+void SortClasses(SendClass *classes, size_t count, Less less) {
+  for (size_t i = 1; i < count; ++i) {
+    const SendClass value = classes[i];
+    size_t j = i;
+    for (; j > 0 && less(value, classes[j - 1]); --j) {
+      classes[j] = classes[j - 1];
+    }
+    classes[j] = value;
+  }
+}
+
+} // namespace
+
+uint8_t SendClassPriority(SendClass send_class) {
+  switch (send_class) {
+  case SendClass::HEARTBEAT:
+    return 0;
+  case SendClass::OWNSHIP:
+  case SendClass::GEO_ALTITUDE:
+    return 1;
+  case SendClass::AHRS:
+    return 2;
+  case SendClass::TRAFFIC:
+    return 3;
+  case SendClass::DEVICE_INFO:
+    return 4;
+  }
+  return 4;
+}
+
+void OutputScheduler::configure(SendClass send_class, double period_s,
+                                double deadline_s) {
+  ClassState &state = classes_[static_cast<size_t>(send_class)];
+  const double period =
+      std::isfinite(period_s) && period_s > 0.0 ? period_s : 0.0;
+  if (state.period <= 0.0 && period > 0.0) {
+    state.release = NAN;
+  }
+  state.period = period;
+  state.deadline =
+      std::isfinite(deadline_s) && deadline_s > 0.0 ? deadline_s : state.period;
+}
+
+void OutputScheduler::setTickInterval(double tick_interval_s) {
+  tick_interval_ = std::isfinite(tick_interval_s) && tick_interval_s > 0.0
+                       ? tick_interval_s
+                       : 0.0;
+}
+
+void OutputScheduler::restart(double now) {
+  now_ = now;
+  for (ClassState &state : classes_) {
+    state.release = now;
+    state.deferred = false;
+  }
+  order_count_ = 0;
+  order_next_ = 0;
+}
+
+void OutputScheduler::beginTick(double now, double monotonic_now) {
+  now_ = now;
+  tick_start_ = monotonic_now;
+  tick_bytes_ = 0;
+  tick_sent_ = 0;
+  tick_over_budget_ = false;
+  order_count_ = 0;
+  order_next_ = 0;
+  ++ticks_;
+
+  std::array<SendClass, SEND_CLASS_COUNT> candidates{};
+  size_t candidate_count = 0;
+  for (size_t i = 0; i < SEND_CLASS_COUNT; ++i) {
+    ClassState &state = classes_[i];
+    if (state.period <= 0.0) {
+      state.deferred = false;
+      continue;
+    }
+    if (std::isnan(state.release)) {
+      state.release = now;
+    }
+    // Work that was only late still goes out; work that was held back for
+    // the budget gives up the releases whose deadline it missed.
+    if (state.deferred && state.release + state.deadline <= now) {
+      const double skipped = std::floor(
+          (now - state.release - state.deadline) / state.period + 1.0);
+      state.release += skipped * state.period;
+      state.stats.dropped += static_cast<uint64_t>(skipped);
+      state.stats.deadline_misses += static_cast<uint64_t>(skipped);
+    }
+    state.deferred = false;
+    if (state.release - releaseLead(state) <= now) {
+      candidates[candidate_count++] = static_cast<SendClass>(i);
+    }
+  }
+
+  // Admit by priority while the estimated cost fits the budget.
+  SortClasses(candidates.data(), candidate_count,
+              [this](SendClass a, SendClass b) {
+                const uint8_t pa = SendClassPriority(a);
+                const uint8_t pb = SendClassPriority(b);
+                if (pa != pb) {
+                  return pa < pb;
+                }
+                return absoluteDeadline(a) < absoluteDeadline(b);
+              });
+  double planned_s = 0.0;
+  double planned_bytes = 0.0;
+  for (size_t i = 0; i < candidate_count; ++i) {
+    const SendClass send_class = candidates[i];
+    ClassState &state = classes_[static_cast<size_t>(send_class)];
+    planned_s += state.cost_s;
+    planned_bytes += state.cost_bytes;
+    const bool fits =
+        (budget_.max_tick_s <= 0.0 || planned_s <= budget_.max_tick_s) &&
+        (budget_.max_tick_bytes == 0 ||
+         planned_bytes <= static_cast<double>(budget_.max_tick_bytes));
+    if (fits || order_count_ == 0 || send_class == SendClass::HEARTBEAT) {
+      order_[order_count_++] = send_class;
+    } else {
+      planned_s -= state.cost_s;
+      planned_bytes -= state.cost_bytes;
+      defer(&state);
+    }
+  }
+
+  // Send the admitted work earliest deadline first.
+  SortClasses(order_.data(), order_count_, [this](SendClass a, SendClass b) {
+    const double da = absoluteDeadline(a);
+    const double db = absoluteDeadline(b);
+    if (da != db) {
+      return da < db;
+    }
+    return SendClassPriority(a) < SendClassPriority(b);
+  });
+}
+
+bool OutputScheduler::next(double monotonic_now, SendClass *out_class) {
+  while (order_next_ < order_count_) {
+    const SendClass send_class = order_[order_next_++];
+    const bool spent =
+        tick_sent_ > 0 &&
+        ((budget_.max_tick_s > 0.0 &&
+          monotonic_now - tick_start_ >= budget_.max_tick_s) ||
+         (budget_.max_tick_bytes > 0 &&
+          tick_bytes_ >= budget_.max_tick_bytes));
+    if (spent && send_class != SendClass::HEARTBEAT) {
+      defer(&classes_[static_cast<size_t>(send_class)]);
+      continue;
+    }
+    send_start_ = monotonic_now;
+    if (out_class) {
+      *out_class = send_class;
+    }
+    return true;
+  }
+  return false;
+}
+
+void OutputScheduler::complete(SendClass send_class, size_t bytes,
+                               double monotonic_now) {
+  ClassState &state = classes_[static_cast<size_t>(send_class)];
+  ++tick_sent_;
+  tick_bytes_ += bytes;
+  state.cost_s = SmoothCost(state.cost_s,
+                            (std::max)(0.0, monotonic_now - send_start_));
+  state.cost_bytes = SmoothCost(state.cost_bytes, static_cast<double>(bytes));
+
+  ++state.stats.sent;
+  const double lateness = now_ - state.release;
+  state.stats.max_lateness_s = (std::max)(state.stats.max_lateness_s, lateness);
+  if (lateness > state.deadline) {
+    ++state.stats.deadline_misses;
+  }
+  // Releases stay on the period grid; a send more than a period late
+  // starts a new grid instead of bunching up catch-up sends.
+  state.release += state.period;
+  if (state.release <= now_) {
+    state.release = now_ + state.period;
+  }
+}
+
+bool OutputScheduler::due(SendClass send_class) const {
+  const ClassState &state = classes_[static_cast<size_t>(send_class)];
+  return state.period > 0.0 && (std::isnan(state.release) ||
+                                state.release - releaseLead(state) <= now_);
+}
+
+double OutputScheduler::nextRelease() const {
+  double earliest = NAN;
+  for (const ClassState &state : classes_) {
+    if (state.period <= 0.0) {
+      continue;
+    }
+    const double release =
+        std::isnan(state.release) ? now_ : state.release - releaseLead(state);
+    if (std::isnan(earliest) || release < earliest) {
+      earliest = release;
+    }
+  }
+  return earliest;
+}
+
+double OutputScheduler::absoluteDeadline(SendClass send_class) const {
+  const ClassState &state = classes_[static_cast<size_t>(send_class)];
+  return state.release + state.deadline;
+}
+
+double OutputScheduler::releaseLead(const ClassState &state) const {
+  if (state.period > OUTPUT_HIGH_RATE_PERIOD_S) {
+    return 0.0;
+  }
+  // Never so early that the next release would be due on the same tick.
+  return (std::min)(0.5 * tick_interval_, 0.25 * state.period);
+}
+
+void OutputScheduler::resetStats() {
+  for (ClassState &state : classes_) {
+    state.stats = OutputClassStats{};
+  }
+  ticks_ = 0;
+  over_budget_ticks_ = 0;
+}
+
+void OutputScheduler::defer(ClassState *state) {
+  state->deferred = true;
+  ++state->stats.deferred;
+  if (!tick_over_budget_) {
+    tick_over_budget_ = true;
+    ++over_budget_ticks_;
+  }
+}
+
+} // namespace xp2gdl90
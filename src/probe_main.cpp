@@ -0,0 +1,163 @@
+// xp2gdl90_probe: measures what of the stream arrives where the EFB listens.
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "xp2gdl90/link_probe.h"
+#include "xp2gdl90/udp_receiver.h"
+
+namespace {
+
+constexpr int kPollTimeoutMs = 100;
+
+std::atomic<bool> g_stop{false};
+
+void HandleSignal(int) { g_stop.store(true); }
+
+struct Arguments {
+  uint16_t port = 4000;
+  // 0 runs until Ctrl-C.
+  double duration_s = 0.0;
+  // 0 reports only at the end.
+  double interval_s = 10.0;
+  xp2gdl90::LinkProbeOptions options;
+  bool buckets = false;
+};
+
+void PrintUsage() {
+  std::fprintf(
+      stderr,
+      "usage: xp2gdl90_probe [options]\n"
+      "  --port N              UDP port to listen on (default 4000)\n"
+      "  --duration S          stop after S seconds (default: Ctrl-C)\n"
+      "  --interval S          report every S seconds, 0 only at the end "
+      "(default 10)\n"
+      "  --heartbeat-period S  expected heartbeat period (default 1)\n"
+      "  --buckets             list the histogram buckets in reports\n");
+}
+
+bool ParseSeconds(const char *text, double *out) {
+  char *end = nullptr;
+  const double value = std::strtod(text, &end);
+  if (!text[0] || *end != '\0' || !(value >= 0.0)) {
+    return false;
+  }
+  *out = value;
+  return true;
+}
+
+bool ParseArguments(int argc, char **argv, Arguments *out) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--buckets") {
+      out->buckets = true;
+      continue;
+    }
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!value) {
+      return false;
+    }
+    ++i;
+    if (arg == "--port") {
+      char *end = nullptr;
+      const unsigned long port = std::strtoul(value, &end, 10);
+      if (!value[0] || *end != '\0' || port == 0 || port > 65535) {
+        return false;
+      }
+      out->port = static_cast<uint16_t>(port);
+    } else if (arg == "--duration") {
+      if (!ParseSeconds(value, &out->duration_s)) {
+        return false;
+      }
+    } else if (arg == "--interval") {
+      if (!ParseSeconds(value, &out->interval_s)) {
+        return false;
+      }
+    } else if (arg == "--heartbeat-period") {
+      if (!ParseSeconds(value, &out->options.heartbeat_period_s) ||
+          out->options.heartbeat_period_s == 0.0) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Arguments args;
+  if (!ParseArguments(argc, argv, &args)) {
+    PrintUsage();
+    return 2;
+  }
+
+  udp::UDPReceiver receiver(args.port);
+  if (!receiver.initialize()) {
+    std::fprintf(stderr, "%s\n", receiver.getLastError().c_str());
+    return 1;
+  }
+
+  std::signal(SIGINT, HandleSignal);
+  std::printf("Listening on UDP port %u\n", static_cast<unsigned>(args.port));
+  xp2gdl90::LinkProbe probe(args.options);
+  udp::ReceiveBatch batch;
+  const auto start = std::chrono::steady_clock::now();
+  double next_report = args.interval_s;
+  while (!g_stop.load()) {
+    const double elapsed = SecondsSince(start);
+    if (args.duration_s > 0.0 && elapsed >= args.duration_s) {
+      break;
+    }
+    if (args.interval_s > 0.0 && elapsed >= next_report) {
+      std::printf("%s\n", xp2gdl90::FormatLinkProbeReport(probe.stats(),
+                                                          args.buckets)
+                              .c_str());
+      std::fflush(stdout);
+      next_report += args.interval_s;
+    }
+
+    if (receiver.waitReadable(kPollTimeoutMs) <= 0) {
+      continue;
+    }
+    int received = receiver.drain(&batch);
+    while (received > 0) {
+      // A batch drained at once shares one arrival time.
+      const int64_t arrival_ns =
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now().time_since_epoch())
+              .count();
+      const int64_t arrival_wall_us =
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::system_clock::now().time_since_epoch())
+              .count();
+      for (size_t i = 0; i < batch.count(); ++i) {
+        probe.receiveDatagram(batch.data(i), batch.size(i), arrival_ns,
+                              arrival_wall_us);
+      }
+      received = batch.count() == batch.maxDatagrams()
+                     ? receiver.drain(&batch)
+                     : 0;
+    }
+    if (received < 0) {
+      std::fprintf(stderr, "%s\n", receiver.getLastError().c_str());
+    }
+  }
+
+  std::printf("%s",
+              xp2gdl90::FormatLinkProbeReport(probe.stats(), args.buckets)
+                  .c_str());
+  return 0;
+}
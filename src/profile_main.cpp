@@ -0,0 +1,295 @@
+// xp2gdl90_profile: runs a sim recording through the traffic collection,
+// encoding and send pipeline with a null socket and reports per-stage
+// timings.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "xp2gdl90/cached_frame.h"
+#include "xp2gdl90/datagram_packer.h"
+#include "xp2gdl90/frame_buffer.h"
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/settings.h"
+#include "xp2gdl90/sim_recording.h"
+#include "xp2gdl90/tcas_traffic.h"
+#include "xp2gdl90/track_table.h"
+#include "xp2gdl90/traffic_frame_cache.h"
+#include "xp2gdl90/traffic_scheduler.h"
+#include "xp2gdl90/udp_broadcaster.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using xp2gdl90::Settings;
+
+constexpr double kMetersToFeet = 3.28084;
+constexpr float kMetersPerSecondToKnots = 1.94384f;
+constexpr double kDegreesToRadians = 3.14159265358979323846 / 180.0;
+constexpr float kTrafficStaleSweeps = 3.0f;
+
+// Accepts every call and discards the datagrams.
+struct NullSocketOps final : udp::detail::SocketOps {
+  uintptr_t CreateSocket(int, int, int) override { return 1; }
+  int SetSockOpt(uintptr_t, int, int, const void *, size_t) override {
+    return 0;
+  }
+  int InetPton(int, const char *, void *dst) override {
+    std::memset(dst, 0, 4);
+    return 1;
+  }
+  int Bind(uintptr_t, const void *, size_t) override { return 0; }
+  intptr_t SendTo(uintptr_t, const void *, size_t len, int, const void *,
+                  size_t) override {
+    return static_cast<intptr_t>(len);
+  }
+  int CloseSocket(uintptr_t) override { return 0; }
+  int LastError() override { return 0; }
+};
+
+enum Stage { COLLECT, SCHEDULE, ENCODE, SEND, STAGE_COUNT };
+const char *const kStageNames[STAGE_COUNT] = {"collect", "schedule", "encode",
+                                              "send"};
+
+// Converts rows the projection radius left out; the recording has no
+// exact conversion, so they use the same projection.
+const xp2gdl90::traffic::LocalProjection *g_projection = nullptr;
+
+bool ProjectedLocalToWorld(double x, double y, double z, double *out_latitude,
+                           double *out_longitude, int32_t *out_altitude_feet) {
+  if (!g_projection || !std::isfinite(x) || !std::isfinite(y) ||
+      !std::isfinite(z)) {
+    return false;
+  }
+  double altitude_m = 0.0;
+  g_projection->project(x, y, z, out_latitude, out_longitude, &altitude_m);
+  *out_altitude_feet = static_cast<int32_t>(altitude_m * kMetersToFeet);
+  return true;
+}
+
+float TrafficSweepRate(const Settings &cfg) {
+  if (!cfg.traffic_adaptive_rate) {
+    return cfg.traffic_rate;
+  }
+  const double fastest =
+      1.0 / xp2gdl90::traffic::MakeTrafficRatePolicy(cfg).near_interval_s;
+  return (std::max)(cfg.traffic_rate, static_cast<float>(fastest));
+}
+
+gdl90::PositionData OwnshipReport(const Settings &cfg,
+                                  const xp2gdl90::OwnshipSample &ownship) {
+  gdl90::PositionData data;
+  data.latitude = ownship.gps_valid ? ownship.latitude : 0.0;
+  data.longitude = ownship.gps_valid ? ownship.longitude : 0.0;
+  data.altitude = std::isfinite(ownship.pressure_altitude_ft)
+                      ? static_cast<int32_t>(ownship.pressure_altitude_ft)
+                      : INT32_MIN;
+  data.h_velocity =
+      static_cast<uint16_t>(ownship.ground_speed_mps * kMetersPerSecondToKnots);
+  data.v_velocity = static_cast<int16_t>(ownship.vertical_speed_fpm);
+  data.track = static_cast<uint16_t>(
+      std::fmod(std::fmod(ownship.track_deg, 360.0f) + 360.0f, 360.0f));
+  data.track_type = gdl90::TrackType::TRUE_TRACK;
+  data.airborne = !ownship.on_ground;
+  data.icao_address = cfg.icao_address;
+  data.callsign = ownship.tail_number.empty() ? gdl90::Callsign(cfg.callsign)
+                                              : ownship.tail_number;
+  data.emitter_category =
+      static_cast<gdl90::EmitterCategory>(cfg.emitter_category);
+  data.nic = ownship.gps_valid ? cfg.nic : 0;
+  data.nacp = cfg.nacp;
+  return data;
+}
+
+double Percentile(std::vector<double> sorted, double fraction) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  const size_t index = static_cast<size_t>(
+      fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+  return sorted[index];
+}
+
+void PrintUsage() {
+  std::fprintf(stderr,
+               "usage: xp2gdl90_profile [--config settings.json] "
+               "[--repeat N] <inputs.xpsim>\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string recording_path;
+  std::string config_path;
+  unsigned long repeat = 1;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--config" && i + 1 < argc) {
+      config_path = argv[++i];
+    } else if (arg == "--repeat" && i + 1 < argc) {
+      repeat = std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg[0] != '-' && recording_path.empty()) {
+      recording_path = arg;
+    } else {
+      PrintUsage();
+      return 2;
+    }
+  }
+  if (recording_path.empty() || repeat == 0) {
+    PrintUsage();
+    return 2;
+  }
+
+  Settings cfg;
+  std::string error;
+  if (!config_path.empty() &&
+      !xp2gdl90::LoadSettingsFromJsonFile(config_path, &cfg, &error)) {
+    std::fprintf(stderr, "%s\n", error.empty() ? "Cannot load settings"
+                                               : error.c_str());
+    return 1;
+  }
+
+  NullSocketOps socket_ops;
+  udp::UDPBroadcaster broadcaster(cfg.target_ip, cfg.target_port,
+                                  &socket_ops);
+  if (!broadcaster.initialize()) {
+    std::fprintf(stderr, "%s\n", broadcaster.getLastError().c_str());
+    return 1;
+  }
+  udp::DatagramPacker packer(cfg.datagram_max_bytes);
+  gdl90::GDL90Encoder encoder;
+  gdl90::CachedFrame heartbeat;
+  gdl90::FrameBuffer ownship_frame;
+  gdl90::FrameArena traffic_frames;
+  gdl90::TrafficFrameCache frame_cache;
+  std::vector<udp::SendBuffer> send_buffers;
+  xp2gdl90::traffic::TrackTable tracks;
+  xp2gdl90::traffic::TrafficScheduleStats schedule_stats;
+  std::vector<xp2gdl90::traffic::TrafficCandidate> candidates;
+  std::vector<gdl90::PositionData> reports;
+  const xp2gdl90::traffic::TrafficSelection selection =
+      xp2gdl90::traffic::MakeTrafficSelection(cfg);
+  const float sweep_rate = TrafficSweepRate(cfg);
+
+  std::vector<double> timings[STAGE_COUNT];
+  uint64_t targets = 0;
+  xp2gdl90::SimTick tick;
+  for (unsigned long pass = 0; pass < repeat; ++pass) {
+    xp2gdl90::SimPlayback playback;
+    if (!playback.open(recording_path, &error)) {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+    tracks = xp2gdl90::traffic::TrackTable();
+    while (playback.next(&tick)) {
+      const xp2gdl90::OwnshipSample &ownship = tick.ownship;
+      const double now = ownship.broadcast_time;
+
+      const Clock::time_point collect_start = Clock::now();
+      xp2gdl90::traffic::TcasReportContext context;
+      context.nic = cfg.nic;
+      context.nacp = cfg.nacp;
+      context.ownship_address = cfg.icao_address;
+      context.has_ssr_mode = tick.has_ssr_mode;
+      context.ownship_geometric_ft =
+          ownship.geometric_altitude_m * kMetersToFeet;
+      context.ownship_pressure_ft = ownship.pressure_altitude_ft;
+      context.local_to_world = ProjectedLocalToWorld;
+      const xp2gdl90::traffic::LocalProjection projection(tick.anchor);
+      g_projection = tick.has_anchor ? &projection : nullptr;
+      xp2gdl90::traffic::CollectTcasTraffic(
+          selection, context, g_projection,
+          cfg.traffic_projection_radius_nm *
+              xp2gdl90::traffic::METERS_PER_NAUTICAL_MILE,
+          &tick.traffic, &candidates, &reports);
+      targets += reports.size();
+
+      const Clock::time_point schedule_start = Clock::now();
+      if (cfg.traffic_adaptive_rate) {
+        const double track = ownship.track_deg * kDegreesToRadians;
+        xp2gdl90::traffic::TrafficReference reference;
+        reference.latitude_deg = ownship.latitude;
+        reference.longitude_deg = ownship.longitude;
+        reference.altitude_ft = ownship.geometric_altitude_m * kMetersToFeet;
+        reference.vx = ownship.ground_speed_mps * std::sin(track);
+        reference.vz = -ownship.ground_speed_mps * std::cos(track);
+        xp2gdl90::traffic::ScheduleTrafficReports(
+            xp2gdl90::traffic::MakeTrafficRatePolicy(cfg), reference, now,
+            1.0 / sweep_rate, &tracks, &reports, &schedule_stats);
+      } else {
+        for (const gdl90::PositionData &report : reports) {
+          tracks.upsert(report.icao_address, now);
+        }
+      }
+      tracks.evictStale(now, kTrafficStaleSweeps / sweep_rate, nullptr);
+
+      const Clock::time_point encode_start = Clock::now();
+      const size_t heartbeat_size =
+          encoder.encodeHeartbeatInto(ownship.gps_valid, true, heartbeat);
+      const size_t ownship_size = encoder.encodeOwnshipReportInto(
+          OwnshipReport(cfg, ownship), ownship_frame);
+      encoder.encodeTrafficBatch(reports.data(), reports.size(),
+                                 traffic_frames, &frame_cache);
+
+      const Clock::time_point send_start = Clock::now();
+      if (cfg.datagram_packing) {
+        packer.append(heartbeat.frame().data(), heartbeat_size, true,
+                      broadcaster);
+        packer.append(ownship_frame.data(), ownship_size, false, broadcaster);
+        for (size_t i = 0; i < traffic_frames.frameCount(); ++i) {
+          packer.append(traffic_frames.frameData(i),
+                        traffic_frames.frameSize(i), false, broadcaster);
+        }
+        packer.flush(broadcaster);
+      } else {
+        broadcaster.send(heartbeat.frame().data(), heartbeat_size);
+        broadcaster.send(ownship_frame.data(), ownship_size);
+        send_buffers.clear();
+        for (size_t i = 0; i < traffic_frames.frameCount(); ++i) {
+          send_buffers.push_back(udp::SendBuffer{
+              traffic_frames.frameData(i), traffic_frames.frameSize(i)});
+        }
+        broadcaster.sendBatch(send_buffers.data(), send_buffers.size());
+      }
+      const Clock::time_point end = Clock::now();
+
+      const Clock::time_point marks[] = {collect_start, schedule_start,
+                                         encode_start, send_start, end};
+      for (size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+        timings[stage].push_back(
+            std::chrono::duration<double, std::micro>(marks[stage + 1] -
+                                                      marks[stage])
+                .count());
+      }
+    }
+  }
+
+  const size_t ticks = timings[COLLECT].size();
+  if (ticks == 0) {
+    std::fprintf(stderr, "Recording holds no sweeps: %s\n",
+                 recording_path.c_str());
+    return 1;
+  }
+  std::printf("%zu sweeps, %.1f targets per sweep\n", ticks,
+              static_cast<double>(targets) / static_cast<double>(ticks));
+  std::printf("%-10s %10s %10s %10s %10s  (us)\n", "stage", "mean", "p50",
+              "p99", "max");
+  for (size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+    std::vector<double> &samples = timings[stage];
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double sample : samples) {
+      sum += sample;
+    }
+    std::printf("%-10s %10.2f %10.2f %10.2f %10.2f\n", kStageNames[stage],
+                sum / static_cast<double>(samples.size()),
+                Percentile(samples, 0.5), Percentile(samples, 0.99),
+                samples.back());
+  }
+  return 0;
+}
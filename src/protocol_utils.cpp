@@ -8,9 +8,11 @@
 namespace xp2gdl90::protocol {
 
 std::string SanitizeCallsign(std::string_view input) {
-  std::string out;
-  out.reserve(8);
+  return MakeCallsign(input).str();
+}
 
+gdl90::Callsign MakeCallsign(std::string_view input) {
+  gdl90::Callsign out;
   for (const char ch : input) {
     const unsigned char uch = static_cast<unsigned char>(ch);
     if (std::isalnum(uch) != 0) {
@@ -18,7 +20,7 @@ std::string SanitizeCallsign(std::string_view input) {
     } else if (ch == ' ' || ch == '-' || ch == '_') {
       out.push_back(' ');
     }
-    if (out.size() >= 8) {
+    if (out.full()) {
       break;
     }
   }
@@ -61,6 +63,17 @@ bool IsValidIpv4Address(std::string_view input) {
   return saw_digit && octet_count == 3;
 }
 
+bool IsMulticastIpv4Address(std::string_view input) {
+  if (!IsValidIpv4Address(input)) {
+    return false;
+  }
+  int first_octet = 0;
+  for (size_t i = 0; i < input.size() && input[i] != '.'; ++i) {
+    first_octet = first_octet * 10 + (input[i] - '0');
+  }
+  return first_octet >= 224 && first_octet <= 239;
+}
+
 bool IsValidNic(uint8_t value) { return value <= 11; }
 
 bool IsValidNacp(uint8_t value) { return value <= 11; }
@@ -0,0 +1,251 @@
+// xp2gdl90_replay: streams a stream capture back onto the network.
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "xp2gdl90/capture_replay.h"
+#include "xp2gdl90/compact_capture.h"
+#include "xp2gdl90/udp_broadcaster.h"
+
+namespace {
+
+std::atomic<bool> g_stop{false};
+
+void HandleSignal(int) { g_stop.store(true); }
+
+struct Target {
+  std::string ip;
+  uint16_t port = 0;
+};
+
+struct Arguments {
+  std::string capture_path;
+  std::vector<Target> targets;
+  udp::ReplayOptions options;
+  unsigned long loops = 1;
+  // Seconds into the capture to start from.
+  double start_s = 0.0;
+};
+
+void PrintUsage() {
+  std::fprintf(
+      stderr,
+      "usage: xp2gdl90_replay [options] <capture.pcap|capture.xcap>\n"
+      "  --target IP:PORT     send to IP:PORT (repeatable, default "
+      "127.0.0.1:4000)\n"
+      "  --speed N            play at N times the recorded rate (default 1)\n"
+      "  --flat-out           send as fast as the socket allows\n"
+      "  --multiply N         send each traffic target N times (max %u)\n"
+      "  --address-step HEX   address offset between copies (default %06X)\n"
+      "  --source N|all       capture destination to replay (default 0)\n"
+      "  --max-datagram N     datagram size when repacking (default %zu)\n"
+      "  --loop N             play the capture N times, 0 for ever\n"
+      "  --start S            skip the first S seconds of the capture\n",
+      static_cast<unsigned>(udp::REPLAY_MAX_TRAFFIC_COPIES),
+      static_cast<unsigned>(udp::REPLAY_DEFAULT_ADDRESS_STEP),
+      udp::DATAGRAM_DEFAULT_MAX_BYTES);
+}
+
+bool ParseUnsigned(const char *text, int base, unsigned long *out) {
+  char *end = nullptr;
+  const unsigned long value = std::strtoul(text, &end, base);
+  if (!text[0] || *end != '\0') {
+    return false;
+  }
+  *out = value;
+  return true;
+}
+
+bool ParseTarget(const std::string &text, Target *out) {
+  const size_t colon = text.rfind(':');
+  unsigned long port = 0;
+  if (colon == std::string::npos || colon == 0 ||
+      !ParseUnsigned(text.c_str() + colon + 1, 10, &port) || port == 0 ||
+      port > 65535) {
+    return false;
+  }
+  out->ip = text.substr(0, colon);
+  out->port = static_cast<uint16_t>(port);
+  return true;
+}
+
+bool ParseArguments(int argc, char **argv, Arguments *out) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+    unsigned long number = 0;
+    if (arg == "--flat-out") {
+      out->options.speed = 0.0;
+      continue;
+    }
+    if (arg[0] != '-') {
+      if (!out->capture_path.empty()) {
+        return false;
+      }
+      out->capture_path = arg;
+      continue;
+    }
+    if (!value) {
+      return false;
+    }
+    ++i;
+    if (arg == "--target") {
+      Target target;
+      if (!ParseTarget(value, &target)) {
+        return false;
+      }
+      out->targets.push_back(target);
+    } else if (arg == "--speed") {
+      char *end = nullptr;
+      out->options.speed = std::strtod(value, &end);
+      if (*end != '\0' || !(out->options.speed > 0.0)) {
+        return false;
+      }
+    } else if (arg == "--multiply") {
+      if (!ParseUnsigned(value, 10, &number) || number < 1 ||
+          number > udp::REPLAY_MAX_TRAFFIC_COPIES) {
+        return false;
+      }
+      out->options.traffic_copies = static_cast<uint32_t>(number);
+    } else if (arg == "--address-step") {
+      if (!ParseUnsigned(value, 16, &number) || number == 0 ||
+          number > 0xFFFFFF) {
+        return false;
+      }
+      out->options.address_step = static_cast<uint32_t>(number);
+    } else if (arg == "--source") {
+      if (std::strcmp(value, "all") == 0) {
+        out->options.source_destination = udp::REPLAY_ALL_DESTINATIONS;
+      } else if (ParseUnsigned(value, 10, &number) &&
+                 number < udp::MAX_DESTINATIONS) {
+        out->options.source_destination = static_cast<int>(number);
+      } else {
+        return false;
+      }
+    } else if (arg == "--max-datagram") {
+      if (!ParseUnsigned(value, 10, &number) ||
+          number < udp::DATAGRAM_MIN_MAX_BYTES ||
+          number > udp::DATAGRAM_MAX_MAX_BYTES) {
+        return false;
+      }
+      out->options.max_datagram_bytes = number;
+    } else if (arg == "--loop") {
+      if (!ParseUnsigned(value, 10, &out->loops)) {
+        return false;
+      }
+    } else if (arg == "--start") {
+      char *end = nullptr;
+      out->start_s = std::strtod(value, &end);
+      if (!value[0] || *end != '\0' || !(out->start_s >= 0.0)) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  if (out->targets.empty()) {
+    out->targets.push_back({"127.0.0.1", 4000});
+  }
+  return !out->capture_path.empty() &&
+         out->targets.size() <= udp::MAX_DESTINATIONS;
+}
+
+// Reads the capture from `start_s` seconds in. A compact capture seeks to
+// the block holding that time; a pcap ring is read whole and trimmed.
+bool LoadCapture(const Arguments &args, std::vector<udp::CaptureDatagram> *out,
+                 std::string *out_error) {
+  const int64_t skip_ns = static_cast<int64_t>(args.start_s * 1e9);
+  if (skip_ns > 0 && udp::IsCompactCapture(args.capture_path)) {
+    udp::CompactCaptureReader reader;
+    if (!reader.open(args.capture_path, out_error)) {
+      return false;
+    }
+    out->clear();
+    if (reader.blocks().empty()) {
+      return true;
+    }
+    reader.seek(reader.blocks().front().first_timestamp_ns + skip_ns);
+    udp::CaptureDatagram datagram;
+    while (reader.next(&datagram)) {
+      out->push_back(std::move(datagram));
+    }
+    return true;
+  }
+  if (!udp::ReadCapture(args.capture_path, out, out_error)) {
+    return false;
+  }
+  if (skip_ns > 0 && !out->empty()) {
+    const int64_t start_ns = out->front().timestamp_ns + skip_ns;
+    out->erase(out->begin(),
+               std::find_if(out->begin(), out->end(),
+                            [start_ns](const udp::CaptureDatagram &datagram) {
+                              return datagram.timestamp_ns >= start_ns;
+                            }));
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Arguments args;
+  if (!ParseArguments(argc, argv, &args)) {
+    PrintUsage();
+    return 2;
+  }
+
+  std::vector<udp::CaptureDatagram> datagrams;
+  std::string error;
+  if (!LoadCapture(args, &datagrams, &error)) {
+    std::fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  if (datagrams.empty()) {
+    std::fprintf(stderr, "Capture holds no records: %s\n",
+                 args.capture_path.c_str());
+    return 1;
+  }
+
+  udp::UDPBroadcaster broadcaster(args.targets[0].ip, args.targets[0].port);
+  if (!broadcaster.initialize()) {
+    std::fprintf(stderr, "%s\n", broadcaster.getLastError().c_str());
+    return 1;
+  }
+  for (size_t i = 1; i < args.targets.size(); ++i) {
+    if (!broadcaster.addDestination(args.targets[i].ip,
+                                    args.targets[i].port)) {
+      std::fprintf(stderr, "%s\n", broadcaster.getLastError().c_str());
+      return 1;
+    }
+  }
+
+  std::signal(SIGINT, HandleSignal);
+  std::printf("Replaying %zu datagrams from %s\n", datagrams.size(),
+              args.capture_path.c_str());
+  udp::CaptureReplay replay(broadcaster, args.options);
+  for (unsigned long loop = 0;
+       (args.loops == 0 || loop < args.loops) && !g_stop.load(); ++loop) {
+    replay.run(datagrams, &g_stop);
+  }
+
+  const udp::ReplayStats &stats = replay.stats();
+  const double seconds = stats.elapsed_seconds > 0.0 ? stats.elapsed_seconds
+                                                     : 1.0;
+  std::printf("Sent %llu datagrams, %llu bytes in %.3f s (%.0f datagrams/s, "
+              "%.2f Mbit/s)\n",
+              static_cast<unsigned long long>(stats.datagrams),
+              static_cast<unsigned long long>(stats.bytes),
+              stats.elapsed_seconds, stats.datagrams / seconds,
+              stats.bytes * 8.0 / seconds / 1e6);
+  std::printf("Synthetic reports %llu, late %llu, send errors %llu\n",
+              static_cast<unsigned long long>(stats.synthetic_reports),
+              static_cast<unsigned long long>(stats.late),
+              static_cast<unsigned long long>(stats.send_errors));
+  return stats.send_errors > 0 ? 1 : 0;
+}
@@ -11,37 +11,571 @@
 namespace xp2gdl90 {
 namespace {
 
-bool ReadUnsignedPort(const json::Value *value, uint16_t *out_port) {
-  if (!value || !value->IsNumber() || !std::isfinite(value->number_value) ||
-      value->number_value < 1.0 || value->number_value > 65535.0) {
+bool ReadUnsignedPort(const json::Value &value, uint16_t *out_port) {
+  if (!value.IsNumber() || !std::isfinite(value.AsNumber()) ||
+      value.AsNumber() < 1.0 || value.AsNumber() > 65535.0) {
     return false;
   }
   *out_port =
-      static_cast<uint16_t>(static_cast<unsigned int>(value->number_value));
+      static_cast<uint16_t>(static_cast<unsigned int>(value.AsNumber()));
   return true;
 }
 
-bool ReadPositiveRate(const json::Value *value, float *out_rate) {
-  if (!value || !value->IsNumber() || !std::isfinite(value->number_value) ||
-      value->number_value <= 0.0 ||
-      value->number_value >
+bool ReadPositiveRate(const json::Value &value, float *out_rate) {
+  if (!value.IsNumber() || !std::isfinite(value.AsNumber()) ||
+      value.AsNumber() <= 0.0 ||
+      value.AsNumber() >
           static_cast<double>(std::numeric_limits<float>::max())) {
     return false;
   }
-  *out_rate = static_cast<float>(value->number_value);
+  *out_rate = static_cast<float>(value.AsNumber());
   return true;
 }
 
-bool ReadUInt8(const json::Value *value, uint8_t *out_value) {
-  if (!value || !value->IsNumber() || !std::isfinite(value->number_value) ||
-      value->number_value < 0.0 || value->number_value > 255.0) {
+bool ReadUInt8(const json::Value &value, uint8_t *out_value) {
+  if (!value.IsNumber() || !std::isfinite(value.AsNumber()) ||
+      value.AsNumber() < 0.0 || value.AsNumber() > 255.0) {
     return false;
   }
   *out_value =
-      static_cast<uint8_t>(static_cast<unsigned int>(value->number_value));
+      static_cast<uint8_t>(static_cast<unsigned int>(value.AsNumber()));
   return true;
 }
 
+// Leaves *out untouched unless `value` is a number in [min, max].
+template <typename T>
+void ReadNumberInRange(const json::Value &value, double min, double max,
+                       T *out) {
+  if (value.IsNumber() && std::isfinite(value.AsNumber()) &&
+      value.AsNumber() >= min && value.AsNumber() <= max) {
+    *out = static_cast<T>(value.AsNumber());
+  }
+}
+
+void ReadBool(const json::Value &value, bool *out) {
+  if (value.IsBool()) {
+    *out = value.AsBool();
+  }
+}
+
+void ReadIpv4(const json::Value &value, std::string *out) {
+  if (value.IsString() && protocol::IsValidIpv4Address(value.AsString())) {
+    *out = value.AsString();
+  }
+}
+
+// Non-empty strings only, cut to `max_size` characters.
+void ReadName(const json::Value &value, size_t max_size, std::string *out) {
+  if (value.IsString() && !value.AsString().empty()) {
+    *out = value.AsString().substr(0, max_size);
+  }
+}
+
+void ReadPort(const json::Value &value, uint16_t *out) {
+  uint16_t port = 0;
+  if (ReadUnsignedPort(value, &port)) {
+    *out = port;
+  }
+}
+
+void ReadRate(const json::Value &value, float *out) {
+  float rate = 0.0f;
+  if (ReadPositiveRate(value, &rate)) {
+    *out = rate;
+  }
+}
+
+struct SettingField {
+  std::string_view key;
+  void (*apply)(const json::Value &value, Settings *settings);
+};
+
+// Top-level scalar settings. extra_destinations is read by SettingsHandler.
+constexpr SettingField kSettingFields[] = {
+    {"target_ip",
+     [](const json::Value &value, Settings *settings) {
+       ReadIpv4(value, &settings->target_ip);
+     }},
+    {"target_port",
+     [](const json::Value &value, Settings *settings) {
+       ReadPort(value, &settings->target_port);
+     }},
+    {"foreflight_broadcast_port",
+     [](const json::Value &value, Settings *settings) {
+       ReadPort(value, &settings->foreflight_broadcast_port);
+     }},
+    {"foreflight_auto_discovery",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->foreflight_auto_discovery);
+     }},
+    {"multicast_ttl",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 1.0, 255.0, &settings->multicast_ttl);
+     }},
+    {"multicast_interface",
+     [](const json::Value &value, Settings *settings) {
+       if (value.IsString() && value.AsString().empty()) {
+         settings->multicast_interface.clear();
+       } else {
+         ReadIpv4(value, &settings->multicast_interface);
+       }
+     }},
+    {"multicast_loopback",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->multicast_loopback);
+     }},
+    {"socket_dscp",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 63.0, &settings->socket_dscp);
+     }},
+    {"socket_send_buffer_bytes",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 16777216.0,
+                         &settings->socket_send_buffer_bytes);
+     }},
+    {"socket_bind_ip",
+     [](const json::Value &value, Settings *settings) {
+       if (value.IsString() && value.AsString().empty()) {
+         settings->socket_bind_ip.clear();
+       } else {
+         ReadIpv4(value, &settings->socket_bind_ip);
+       }
+     }},
+    {"datagram_packing",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->datagram_packing);
+     }},
+    {"datagram_max_bytes",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 128.0, 65507.0, &settings->datagram_max_bytes);
+     }},
+    {"sender_thread",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->sender_thread);
+     }},
+    {"sender_overflow_policy",
+     [](const json::Value &value, Settings *settings) {
+       if (uint8_t policy = 0; ReadUInt8(value, &policy) && policy <= 1u) {
+         settings->sender_overflow_policy = policy;
+       }
+     }},
+    {"worker_thread_priority",
+     [](const json::Value &value, Settings *settings) {
+       if (uint8_t priority = 0;
+           ReadUInt8(value, &priority) && priority <= 2u) {
+         settings->worker_thread_priority = priority;
+       }
+     }},
+    {"worker_cpu_mask",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 4294967295.0, &settings->worker_cpu_mask);
+     }},
+    {"icao_address",
+     [](const json::Value &value, Settings *settings) {
+       if (value.IsNumber() && std::isfinite(value.AsNumber()) &&
+           value.AsNumber() >= 0.0) {
+         const auto address = static_cast<unsigned int>(value.AsNumber());
+         settings->icao_address = static_cast<uint32_t>(address) & 0xFFFFFFu;
+       }
+     }},
+    {"callsign",
+     [](const json::Value &value, Settings *settings) {
+       ReadName(value, 8, &settings->callsign);
+     }},
+    {"device_name",
+     [](const json::Value &value, Settings *settings) {
+       ReadName(value, 8, &settings->device_name);
+     }},
+    {"device_long_name",
+     [](const json::Value &value, Settings *settings) {
+       ReadName(value, 16, &settings->device_long_name);
+     }},
+    {"emitter_category",
+     [](const json::Value &value, Settings *settings) {
+       if (uint8_t category = 0; ReadUInt8(value, &category) &&
+                                 protocol::IsValidEmitterCategory(category)) {
+         settings->emitter_category = category;
+       }
+     }},
+    {"internet_policy",
+     [](const json::Value &value, Settings *settings) {
+       if (uint8_t policy = 0; ReadUInt8(value, &policy) && policy <= 2u) {
+         settings->internet_policy = policy;
+       }
+     }},
+    {"nic",
+     [](const json::Value &value, Settings *settings) {
+       if (uint8_t nic = 0;
+           ReadUInt8(value, &nic) && protocol::IsValidNic(nic)) {
+         settings->nic = nic;
+       }
+     }},
+    {"nacp",
+     [](const json::Value &value, Settings *settings) {
+       if (uint8_t nacp = 0;
+           ReadUInt8(value, &nacp) && protocol::IsValidNacp(nacp)) {
+         settings->nacp = nacp;
+       }
+     }},
+    {"heartbeat_rate",
+     [](const json::Value &value, Settings *settings) {
+       ReadRate(value, &settings->heartbeat_rate);
+     }},
+    {"position_rate",
+     [](const json::Value &value, Settings *settings) {
+       ReadRate(value, &settings->position_rate);
+     }},
+    {"ownship_high_rate",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->ownship_high_rate);
+     }},
+    {"traffic_rate",
+     [](const json::Value &value, Settings *settings) {
+       ReadRate(value, &settings->traffic_rate);
+     }},
+    {"ahrs_rate",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 20.0, &settings->ahrs_rate);
+     }},
+    {"geo_altitude_rate",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 5.0, &settings->geo_altitude_rate);
+     }},
+    {"device_info_rate",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 5.0, &settings->device_info_rate);
+     }},
+    {"traffic_max_targets",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 63.0, &settings->traffic_max_targets);
+     }},
+    {"traffic_position_mode",
+     [](const json::Value &value, Settings *settings) {
+       if (uint8_t mode = 0; ReadUInt8(value, &mode) && mode <= 1u) {
+         settings->traffic_position_mode = mode;
+       }
+     }},
+    {"traffic_projection_radius_nm",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 40.0,
+                         &settings->traffic_projection_radius_nm);
+     }},
+    {"traffic_range_nm",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 500.0, &settings->traffic_range_nm);
+     }},
+    {"traffic_altitude_band_ft",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 60000.0,
+                         &settings->traffic_altitude_band_ft);
+     }},
+    {"traffic_closure_lookahead_s",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 600.0,
+                         &settings->traffic_closure_lookahead_s);
+     }},
+    {"ahrs_use_magnetic_heading",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->ahrs_use_magnetic_heading);
+     }},
+    {"traffic_spatial_index",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->traffic_spatial_index);
+     }},
+    {"traffic_scan_radius_nm",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 1.0, 108.0,
+                         &settings->traffic_scan_radius_nm);
+     }},
+    {"traffic_scan_interval_s",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 1.0, 60.0,
+                         &settings->traffic_scan_interval_s);
+     }},
+    {"traffic_build_threads",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 8.0, &settings->traffic_build_threads);
+     }},
+    {"traffic_adaptive_rate",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->traffic_adaptive_rate);
+     }},
+    {"traffic_max_frames_per_second",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 1000.0,
+                         &settings->traffic_max_frames_per_second);
+     }},
+    {"traffic_pacing",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->traffic_pacing);
+     }},
+    {"traffic_thread",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->traffic_thread);
+     }},
+    {"traffic_smoothing",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->traffic_smoothing);
+     }},
+    {"traffic_relay",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->traffic_relay);
+     }},
+    {"traffic_relay_port",
+     [](const json::Value &value, Settings *settings) {
+       ReadPort(value, &settings->traffic_relay_port);
+     }},
+    {"traffic_relay_priority",
+     [](const json::Value &value, Settings *settings) {
+       if (uint8_t priority = 0;
+           ReadUInt8(value, &priority) && priority <= 1u) {
+         settings->traffic_relay_priority = priority;
+       }
+     }},
+    {"extrapolation_horizon_s",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 10.0,
+                         &settings->extrapolation_horizon_s);
+     }},
+    {"output_budget_ms",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 100.0, &settings->output_budget_ms);
+     }},
+    {"output_budget_bytes",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 65536.0, &settings->output_budget_bytes);
+     }},
+    {"bandwidth_limit_bytes_per_s",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 0.0, 12500000.0,
+                         &settings->bandwidth_limit_bytes_per_s);
+     }},
+    {"traffic_enabled",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->traffic_enabled);
+     }},
+    {"debug_logging",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->debug_logging);
+     }},
+    {"log_messages",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->log_messages);
+     }},
+    {"stream_capture",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->stream_capture);
+     }},
+    {"stream_capture_mb",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 1.0, 1024.0, &settings->stream_capture_mb);
+     }},
+    {"stream_capture_compact",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->stream_capture_compact);
+     }},
+    {"shared_output",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->shared_output);
+     }},
+    {"link_probe",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->link_probe);
+     }},
+    {"sim_recording",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->sim_recording);
+     }},
+    {"metrics_enabled",
+     [](const json::Value &value, Settings *settings) {
+       ReadBool(value, &settings->metrics_enabled);
+     }},
+    {"metrics_ip",
+     [](const json::Value &value, Settings *settings) {
+       ReadIpv4(value, &settings->metrics_ip);
+     }},
+    {"metrics_port",
+     [](const json::Value &value, Settings *settings) {
+       ReadPort(value, &settings->metrics_port);
+     }},
+    {"metrics_interval_s",
+     [](const json::Value &value, Settings *settings) {
+       ReadNumberInRange(value, 1.0, 300.0, &settings->metrics_interval_s);
+     }},
+};
+
+struct MessageClassName {
+  const char *name;
+  uint32_t mask;
+};
+
+constexpr MessageClassName kMessageClassNames[] = {
+    {"heartbeat", MESSAGE_HEARTBEAT},
+    {"ownship", MESSAGE_OWNSHIP},
+    {"traffic", MESSAGE_TRAFFIC},
+    {"foreflight_id", MESSAGE_FOREFLIGHT_ID},
+    {"ahrs", MESSAGE_AHRS},
+};
+
+uint32_t MessageClassBit(const json::Value &value) {
+  if (value.IsString()) {
+    for (const MessageClassName &name : kMessageClassNames) {
+      if (value.AsString() == name.name) {
+        return name.mask;
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Applies a settings file to *settings as it is read. Unknown keys and
+ * containers are skipped whole. Destination entries without a valid ip and
+ * port are dropped; a bad optional field falls back to its default. A key
+ * given twice takes its last value.
+ */
+class SettingsHandler : public json::Handler {
+public:
+  explicit SettingsHandler(Settings *settings) : settings_(settings) {}
+
+  bool rootIsObject() const { return root_is_object_; }
+
+  bool beginObject() override { return begin(true); }
+  bool endObject() override { return end(); }
+  bool beginArray() override { return begin(false); }
+  bool endArray() override { return end(); }
+
+  bool key(std::string_view name) override {
+    if (skip_depth_ != 0) {
+      return true;
+    }
+    if (depth_ == 1) {
+      key_.assign(name);
+    } else if (in_destination_ && depth_ == 3) {
+      destination_key_.assign(name);
+    }
+    return true;
+  }
+
+  bool scalar(const json::Value &value) override {
+    if (skip_depth_ != 0) {
+      return true;
+    }
+    if (depth_ == 1) {
+      for (const SettingField &field : kSettingFields) {
+        if (field.key == key_) {
+          field.apply(value, settings_);
+          break;
+        }
+      }
+    } else if (in_destination_ && depth_ == 3) {
+      destinationField(value);
+    } else if (in_messages_ && depth_ == 4) {
+      const uint32_t bit = MessageClassBit(value);
+      messages_valid_ = messages_valid_ && bit != 0;
+      messages_mask_ |= bit;
+    }
+    return true;
+  }
+
+private:
+  // Levels: 1 is the root object, 2 the extra_destinations array, 3 one
+  // destination and 4 its messages array.
+  bool begin(bool object) {
+    ++depth_;
+    if (skip_depth_ != 0) {
+      return true;
+    }
+    if (depth_ == 1 && object) {
+      root_is_object_ = true;
+    } else if (depth_ == 2 && !object && key_ == "extra_destinations") {
+      in_destinations_ = true;
+      settings_->extra_destinations.clear();
+    } else if (depth_ == 3 && object && in_destinations_) {
+      in_destination_ = true;
+      destination_ = Destination();
+      destination_key_.clear();
+      has_ip_ = false;
+      has_port_ = false;
+    } else if (depth_ == 4 && !object && in_destination_ &&
+               destination_key_ == "messages") {
+      in_messages_ = true;
+      messages_mask_ = 0;
+      messages_valid_ = true;
+    } else {
+      messages_valid_ = messages_valid_ && !in_messages_;
+      skip_depth_ = depth_;
+    }
+    return true;
+  }
+
+  bool end() {
+    if (skip_depth_ != 0) {
+      if (depth_ == skip_depth_) {
+        skip_depth_ = 0;
+      }
+    } else if (in_messages_ && depth_ == 4) {
+      in_messages_ = false;
+      if (messages_valid_) {
+        destination_.message_mask = messages_mask_;
+      }
+    } else if (in_destination_ && depth_ == 3) {
+      in_destination_ = false;
+      if (has_ip_ && has_port_ &&
+          settings_->extra_destinations.size() < MAX_EXTRA_DESTINATIONS) {
+        settings_->extra_destinations.push_back(destination_);
+      }
+    } else if (in_destinations_ && depth_ == 2) {
+      in_destinations_ = false;
+    }
+    --depth_;
+    return true;
+  }
+
+  void destinationField(const json::Value &value) {
+    if (destination_key_ == "ip") {
+      has_ip_ = value.IsString() &&
+                protocol::IsValidIpv4Address(value.AsString());
+      if (has_ip_) {
+        destination_.ip = value.AsString();
+      }
+    } else if (destination_key_ == "port") {
+      has_port_ = ReadUnsignedPort(value, &destination_.port);
+    } else if (destination_key_ == "rate_divisor") {
+      if (uint8_t divisor = 0; ReadUInt8(value, &divisor) && divisor > 0) {
+        destination_.rate_divisor = divisor;
+      }
+    }
+  }
+
+  Settings *settings_;
+  size_t depth_ = 0;
+  // Level of the container being skipped, or 0.
+  size_t skip_depth_ = 0;
+  bool root_is_object_ = false;
+  std::string key_;
+
+  bool in_destinations_ = false;
+  bool in_destination_ = false;
+  bool in_messages_ = false;
+  std::string destination_key_;
+  Destination destination_;
+  bool has_ip_ = false;
+  bool has_port_ = false;
+  uint32_t messages_mask_ = 0;
+  bool messages_valid_ = false;
+};
+
+void WriteMessageMask(json::Writer *writer, uint32_t mask) {
+  writer->beginArray();
+  for (const MessageClassName &name : kMessageClassNames) {
+    if ((mask & name.mask) != 0) {
+      writer->stringValue(name.name);
+    }
+  }
+  writer->endArray();
+}
+
 } // namespace
 
 bool LoadSettingsFromJsonFile(const std::string &path, Settings *out_settings,
@@ -64,115 +598,23 @@ bool LoadSettingsFromJsonFile(const std::string &path, Settings *out_settings,
   std::stringstream buffer;
   buffer << file.rdbuf();
 
-  json::Value root;
+  Settings settings = *out_settings;
+  SettingsHandler handler(&settings);
+  json::Reader reader;
   std::string parse_error;
-  if (!json::Parse(buffer.str(), &root, &parse_error)) {
+  if (!reader.read(buffer.str(), &handler, &parse_error)) {
     if (out_error) {
       *out_error = "Invalid settings JSON: " + parse_error;
     }
     return false;
   }
-  if (!root.IsObject()) {
+  if (!handler.rootIsObject()) {
     if (out_error) {
       *out_error = "Invalid settings JSON: expected top-level object";
     }
     return false;
   }
 
-  Settings settings = *out_settings;
-
-  if (const json::Value *value = root.Find("target_ip");
-      value && value->IsString() &&
-      protocol::IsValidIpv4Address(value->string_value)) {
-    settings.target_ip = value->string_value;
-  }
-
-  uint16_t port = 0;
-  if (ReadUnsignedPort(root.Find("target_port"), &port)) {
-    settings.target_port = port;
-  }
-  if (ReadUnsignedPort(root.Find("foreflight_broadcast_port"), &port)) {
-    settings.foreflight_broadcast_port = port;
-  }
-
-  if (const json::Value *value = root.Find("foreflight_auto_discovery");
-      value && value->IsBool()) {
-    settings.foreflight_auto_discovery = value->bool_value;
-  }
-
-  if (const json::Value *value = root.Find("icao_address");
-      value && value->IsNumber() && std::isfinite(value->number_value) &&
-      value->number_value >= 0.0) {
-    settings.icao_address =
-        static_cast<uint32_t>(static_cast<unsigned int>(value->number_value)) &
-        0xFFFFFFu;
-  }
-
-  if (const json::Value *value = root.Find("callsign");
-      value && value->IsString() && !value->string_value.empty()) {
-    settings.callsign = value->string_value.substr(0, 8);
-  }
-  if (const json::Value *value = root.Find("device_name");
-      value && value->IsString() && !value->string_value.empty()) {
-    settings.device_name = value->string_value.substr(0, 8);
-  }
-  if (const json::Value *value = root.Find("device_long_name");
-      value && value->IsString() && !value->string_value.empty()) {
-    settings.device_long_name = value->string_value.substr(0, 16);
-  }
-
-  uint8_t byte_value = 0;
-  if (ReadUInt8(root.Find("emitter_category"), &byte_value) &&
-      protocol::IsValidEmitterCategory(byte_value)) {
-    settings.emitter_category = byte_value;
-  }
-  if (ReadUInt8(root.Find("internet_policy"), &byte_value) &&
-      byte_value <= 2u) {
-    settings.internet_policy = byte_value;
-  }
-  if (ReadUInt8(root.Find("nic"), &byte_value) &&
-      protocol::IsValidNic(byte_value)) {
-    settings.nic = byte_value;
-  }
-  if (ReadUInt8(root.Find("nacp"), &byte_value) &&
-      protocol::IsValidNacp(byte_value)) {
-    settings.nacp = byte_value;
-  }
-
-  float rate = 0.0f;
-  if (ReadPositiveRate(root.Find("heartbeat_rate"), &rate)) {
-    settings.heartbeat_rate = rate;
-  }
-  if (ReadPositiveRate(root.Find("position_rate"), &rate)) {
-    settings.position_rate = rate;
-  }
-  if (ReadPositiveRate(root.Find("traffic_rate"), &rate)) {
-    settings.traffic_rate = rate;
-  }
-
-  if (const json::Value *value = root.Find("traffic_max_targets");
-      value && value->IsNumber() && std::isfinite(value->number_value) &&
-      value->number_value >= 0.0 && value->number_value <= 63.0) {
-    settings.traffic_max_targets = static_cast<uint8_t>(value->number_value);
-  }
-
-  if (const json::Value *value = root.Find("ahrs_use_magnetic_heading");
-      value && value->IsBool()) {
-    settings.ahrs_use_magnetic_heading = value->bool_value;
-  }
-  if (const json::Value *value = root.Find("traffic_enabled");
-      value && value->IsBool()) {
-    settings.traffic_enabled = value->bool_value;
-  }
-  if (const json::Value *value = root.Find("debug_logging");
-      value && value->IsBool()) {
-    settings.debug_logging = value->bool_value;
-  }
-  if (const json::Value *value = root.Find("log_messages");
-      value && value->IsBool()) {
-    settings.log_messages = value->bool_value;
-  }
-
   *out_settings = settings;
   if (out_error) {
     out_error->clear();
@@ -188,6 +630,34 @@ bool SaveSettingsToJsonFile(const std::string &path, const Settings &settings,
     }
     return false;
   }
+  for (const Destination &destination : settings.extra_destinations) {
+    if (!protocol::IsValidIpv4Address(destination.ip)) {
+      if (out_error) {
+        *out_error = "Destination IP must be a valid IPv4 address";
+      }
+      return false;
+    }
+  }
+  if (!settings.multicast_interface.empty() &&
+      !protocol::IsValidIpv4Address(settings.multicast_interface)) {
+    if (out_error) {
+      *out_error = "Multicast interface must be a valid IPv4 address";
+    }
+    return false;
+  }
+  if (!settings.socket_bind_ip.empty() &&
+      !protocol::IsValidIpv4Address(settings.socket_bind_ip)) {
+    if (out_error) {
+      *out_error = "Socket bind IP must be a valid IPv4 address";
+    }
+    return false;
+  }
+  if (!protocol::IsValidIpv4Address(settings.metrics_ip)) {
+    if (out_error) {
+      *out_error = "Metrics IP must be a valid IPv4 address";
+    }
+    return false;
+  }
 
   std::ofstream file(path, std::ios::binary | std::ios::trunc);
   if (!file.is_open()) {
@@ -197,44 +667,159 @@ bool SaveSettingsToJsonFile(const std::string &path, const Settings &settings,
     return false;
   }
 
-  file << "{\n";
-  file << "  \"target_ip\": \"" << json::EscapeString(settings.target_ip)
-       << "\",\n";
-  file << "  \"target_port\": "
-       << static_cast<unsigned int>(settings.target_port) << ",\n";
-  file << "  \"foreflight_auto_discovery\": "
-       << (settings.foreflight_auto_discovery ? "true" : "false") << ",\n";
-  file << "  \"foreflight_broadcast_port\": "
-       << static_cast<unsigned int>(settings.foreflight_broadcast_port)
-       << ",\n";
-  file << "  \"icao_address\": "
-       << static_cast<unsigned int>(settings.icao_address & 0xFFFFFFu) << ",\n";
-  file << "  \"callsign\": \"" << json::EscapeString(settings.callsign)
-       << "\",\n";
-  file << "  \"emitter_category\": "
-       << static_cast<unsigned int>(settings.emitter_category) << ",\n";
-  file << "  \"device_name\": \"" << json::EscapeString(settings.device_name)
-       << "\",\n";
-  file << "  \"device_long_name\": \""
-       << json::EscapeString(settings.device_long_name) << "\",\n";
-  file << "  \"internet_policy\": "
-       << static_cast<unsigned int>(settings.internet_policy) << ",\n";
-  file << "  \"ahrs_use_magnetic_heading\": "
-       << (settings.ahrs_use_magnetic_heading ? "true" : "false") << ",\n";
-  file << "  \"traffic_enabled\": "
-       << (settings.traffic_enabled ? "true" : "false") << ",\n";
-  file << "  \"heartbeat_rate\": " << settings.heartbeat_rate << ",\n";
-  file << "  \"position_rate\": " << settings.position_rate << ",\n";
-  file << "  \"traffic_rate\": " << settings.traffic_rate << ",\n";
-  file << "  \"traffic_max_targets\": "
-       << static_cast<unsigned int>(settings.traffic_max_targets) << ",\n";
-  file << "  \"nic\": " << static_cast<unsigned int>(settings.nic) << ",\n";
-  file << "  \"nacp\": " << static_cast<unsigned int>(settings.nacp) << ",\n";
-  file << "  \"debug_logging\": " << (settings.debug_logging ? "true" : "false")
-       << ",\n";
-  file << "  \"log_messages\": " << (settings.log_messages ? "true" : "false")
-       << "\n";
-  file << "}\n";
+  json::Writer writer(true);
+  writer.beginObject(true);
+  writer.key("target_ip");
+  writer.stringValue(settings.target_ip);
+  writer.key("target_port");
+  writer.unsignedValue(settings.target_port);
+  writer.key("foreflight_auto_discovery");
+  writer.boolValue(settings.foreflight_auto_discovery);
+  writer.key("foreflight_broadcast_port");
+  writer.unsignedValue(settings.foreflight_broadcast_port);
+  writer.key("extra_destinations");
+  writer.beginArray(true);
+  for (const Destination &destination : settings.extra_destinations) {
+    writer.beginObject();
+    writer.key("ip");
+    writer.stringValue(destination.ip);
+    writer.key("port");
+    writer.unsignedValue(destination.port);
+    writer.key("messages");
+    WriteMessageMask(&writer, destination.message_mask);
+    writer.key("rate_divisor");
+    writer.unsignedValue(destination.rate_divisor);
+    writer.endObject();
+  }
+  writer.endArray();
+  writer.key("multicast_ttl");
+  writer.unsignedValue(settings.multicast_ttl);
+  writer.key("multicast_interface");
+  writer.stringValue(settings.multicast_interface);
+  writer.key("multicast_loopback");
+  writer.boolValue(settings.multicast_loopback);
+  writer.key("socket_dscp");
+  writer.unsignedValue(settings.socket_dscp);
+  writer.key("socket_send_buffer_bytes");
+  writer.unsignedValue(settings.socket_send_buffer_bytes);
+  writer.key("socket_bind_ip");
+  writer.stringValue(settings.socket_bind_ip);
+  writer.key("datagram_packing");
+  writer.boolValue(settings.datagram_packing);
+  writer.key("datagram_max_bytes");
+  writer.unsignedValue(settings.datagram_max_bytes);
+  writer.key("sender_thread");
+  writer.boolValue(settings.sender_thread);
+  writer.key("sender_overflow_policy");
+  writer.unsignedValue(settings.sender_overflow_policy);
+  writer.key("worker_thread_priority");
+  writer.unsignedValue(settings.worker_thread_priority);
+  writer.key("worker_cpu_mask");
+  writer.unsignedValue(settings.worker_cpu_mask);
+  writer.key("icao_address");
+  writer.unsignedValue(settings.icao_address & 0xFFFFFFu);
+  writer.key("callsign");
+  writer.stringValue(settings.callsign);
+  writer.key("emitter_category");
+  writer.unsignedValue(settings.emitter_category);
+  writer.key("device_name");
+  writer.stringValue(settings.device_name);
+  writer.key("device_long_name");
+  writer.stringValue(settings.device_long_name);
+  writer.key("internet_policy");
+  writer.unsignedValue(settings.internet_policy);
+  writer.key("ahrs_use_magnetic_heading");
+  writer.boolValue(settings.ahrs_use_magnetic_heading);
+  writer.key("traffic_enabled");
+  writer.boolValue(settings.traffic_enabled);
+  writer.key("heartbeat_rate");
+  writer.numberValue(settings.heartbeat_rate);
+  writer.key("position_rate");
+  writer.numberValue(settings.position_rate);
+  writer.key("ownship_high_rate");
+  writer.boolValue(settings.ownship_high_rate);
+  writer.key("traffic_rate");
+  writer.numberValue(settings.traffic_rate);
+  writer.key("ahrs_rate");
+  writer.numberValue(settings.ahrs_rate);
+  writer.key("geo_altitude_rate");
+  writer.numberValue(settings.geo_altitude_rate);
+  writer.key("device_info_rate");
+  writer.numberValue(settings.device_info_rate);
+  writer.key("traffic_max_targets");
+  writer.unsignedValue(settings.traffic_max_targets);
+  writer.key("traffic_position_mode");
+  writer.unsignedValue(settings.traffic_position_mode);
+  writer.key("traffic_projection_radius_nm");
+  writer.numberValue(settings.traffic_projection_radius_nm);
+  writer.key("traffic_range_nm");
+  writer.numberValue(settings.traffic_range_nm);
+  writer.key("traffic_altitude_band_ft");
+  writer.numberValue(settings.traffic_altitude_band_ft);
+  writer.key("traffic_closure_lookahead_s");
+  writer.numberValue(settings.traffic_closure_lookahead_s);
+  writer.key("traffic_spatial_index");
+  writer.boolValue(settings.traffic_spatial_index);
+  writer.key("traffic_scan_radius_nm");
+  writer.numberValue(settings.traffic_scan_radius_nm);
+  writer.key("traffic_scan_interval_s");
+  writer.numberValue(settings.traffic_scan_interval_s);
+  writer.key("traffic_build_threads");
+  writer.unsignedValue(settings.traffic_build_threads);
+  writer.key("traffic_adaptive_rate");
+  writer.boolValue(settings.traffic_adaptive_rate);
+  writer.key("traffic_max_frames_per_second");
+  writer.numberValue(settings.traffic_max_frames_per_second);
+  writer.key("traffic_pacing");
+  writer.boolValue(settings.traffic_pacing);
+  writer.key("traffic_thread");
+  writer.boolValue(settings.traffic_thread);
+  writer.key("traffic_smoothing");
+  writer.boolValue(settings.traffic_smoothing);
+  writer.key("traffic_relay");
+  writer.boolValue(settings.traffic_relay);
+  writer.key("traffic_relay_port");
+  writer.unsignedValue(settings.traffic_relay_port);
+  writer.key("traffic_relay_priority");
+  writer.unsignedValue(settings.traffic_relay_priority);
+  writer.key("extrapolation_horizon_s");
+  writer.numberValue(settings.extrapolation_horizon_s);
+  writer.key("output_budget_ms");
+  writer.numberValue(settings.output_budget_ms);
+  writer.key("output_budget_bytes");
+  writer.unsignedValue(settings.output_budget_bytes);
+  writer.key("bandwidth_limit_bytes_per_s");
+  writer.unsignedValue(settings.bandwidth_limit_bytes_per_s);
+  writer.key("nic");
+  writer.unsignedValue(settings.nic);
+  writer.key("nacp");
+  writer.unsignedValue(settings.nacp);
+  writer.key("debug_logging");
+  writer.boolValue(settings.debug_logging);
+  writer.key("log_messages");
+  writer.boolValue(settings.log_messages);
+  writer.key("stream_capture");
+  writer.boolValue(settings.stream_capture);
+  writer.key("stream_capture_mb");
+  writer.unsignedValue(settings.stream_capture_mb);
+  writer.key("stream_capture_compact");
+  writer.boolValue(settings.stream_capture_compact);
+  writer.key("shared_output");
+  writer.boolValue(settings.shared_output);
+  writer.key("link_probe");
+  writer.boolValue(settings.link_probe);
+  writer.key("sim_recording");
+  writer.boolValue(settings.sim_recording);
+  writer.key("metrics_enabled");
+  writer.boolValue(settings.metrics_enabled);
+  writer.key("metrics_ip");
+  writer.stringValue(settings.metrics_ip);
+  writer.key("metrics_port");
+  writer.unsignedValue(settings.metrics_port);
+  writer.key("metrics_interval_s");
+  writer.numberValue(settings.metrics_interval_s);
+  writer.endObject();
+  file << writer.text() << "\n";
 
   if (!file.good()) {
     if (out_error) {
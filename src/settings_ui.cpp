@@ -47,6 +47,26 @@ bool ParseHex24(const char *text, uint32_t *out_value) {
   }
 }
 
+// Unlike ParseHex24, rejects trailing text and values over 32 bits.
+bool ParseHex32(const char *text, uint32_t *out_value) {
+  const std::string trimmed = Trim(text ? text : "");
+  if (trimmed.empty()) {
+    return false;
+  }
+
+  try {
+    size_t used = 0;
+    const unsigned long long value = std::stoull(trimmed, &used, 16);
+    if (used != trimmed.size() || value > 0xFFFFFFFFull) {
+      return false;
+    }
+    *out_value = static_cast<uint32_t>(value);
+    return true;
+  } catch (...) {
+    return false;
+  }
+}
+
 } // namespace
 
 void SyncSettingsUiFromConfig(SettingsUiState *ui_state,
@@ -61,6 +81,15 @@ void SyncSettingsUiFromConfig(SettingsUiState *ui_state,
   ui_state->foreflight_auto_discovery = settings.foreflight_auto_discovery;
   ui_state->foreflight_broadcast_port =
       static_cast<int>(settings.foreflight_broadcast_port);
+  ui_state->datagram_packing = settings.datagram_packing;
+  ui_state->datagram_max_bytes = static_cast<int>(settings.datagram_max_bytes);
+  ui_state->sender_thread = settings.sender_thread;
+  ui_state->sender_overflow_policy =
+      static_cast<int>(settings.sender_overflow_policy);
+  ui_state->worker_thread_priority =
+      static_cast<int>(settings.worker_thread_priority);
+  std::snprintf(ui_state->worker_cpu_mask, sizeof(ui_state->worker_cpu_mask),
+                "0x%X", static_cast<unsigned int>(settings.worker_cpu_mask));
   std::snprintf(ui_state->icao_address, sizeof(ui_state->icao_address),
                 "0x%06X",
                 static_cast<unsigned int>(settings.icao_address & 0xFFFFFFu));
@@ -76,13 +105,58 @@ void SyncSettingsUiFromConfig(SettingsUiState *ui_state,
   ui_state->traffic_enabled = settings.traffic_enabled;
   ui_state->heartbeat_rate = settings.heartbeat_rate;
   ui_state->position_rate = settings.position_rate;
+  ui_state->ownship_high_rate = settings.ownship_high_rate;
   ui_state->traffic_rate = settings.traffic_rate;
+  ui_state->ahrs_rate = settings.ahrs_rate;
+  ui_state->geo_altitude_rate = settings.geo_altitude_rate;
+  ui_state->device_info_rate = settings.device_info_rate;
   ui_state->traffic_max_targets =
       static_cast<int>(settings.traffic_max_targets);
+  ui_state->traffic_position_mode =
+      static_cast<int>(settings.traffic_position_mode);
+  ui_state->traffic_projection_radius_nm =
+      settings.traffic_projection_radius_nm;
+  ui_state->traffic_range_nm = settings.traffic_range_nm;
+  ui_state->traffic_altitude_band_ft = settings.traffic_altitude_band_ft;
+  ui_state->traffic_closure_lookahead_s =
+      settings.traffic_closure_lookahead_s;
+  ui_state->traffic_spatial_index = settings.traffic_spatial_index;
+  ui_state->traffic_scan_radius_nm = settings.traffic_scan_radius_nm;
+  ui_state->traffic_scan_interval_s = settings.traffic_scan_interval_s;
+  ui_state->traffic_build_threads =
+      static_cast<int>(settings.traffic_build_threads);
+  ui_state->traffic_adaptive_rate = settings.traffic_adaptive_rate;
+  ui_state->traffic_max_frames_per_second =
+      settings.traffic_max_frames_per_second;
+  ui_state->traffic_pacing = settings.traffic_pacing;
+  ui_state->traffic_thread = settings.traffic_thread;
+  ui_state->traffic_smoothing = settings.traffic_smoothing;
+  ui_state->traffic_relay = settings.traffic_relay;
+  ui_state->traffic_relay_port =
+      static_cast<int>(settings.traffic_relay_port);
+  ui_state->traffic_relay_priority =
+      static_cast<int>(settings.traffic_relay_priority);
+  ui_state->extrapolation_horizon_s = settings.extrapolation_horizon_s;
+  ui_state->output_budget_ms = settings.output_budget_ms;
+  ui_state->output_budget_bytes =
+      static_cast<int>(settings.output_budget_bytes);
+  ui_state->bandwidth_limit_bytes_per_s =
+      static_cast<int>(settings.bandwidth_limit_bytes_per_s);
   ui_state->nic = static_cast<int>(settings.nic);
   ui_state->nacp = static_cast<int>(settings.nacp);
   ui_state->debug_logging = settings.debug_logging;
   ui_state->log_messages = settings.log_messages;
+  ui_state->stream_capture = settings.stream_capture;
+  ui_state->stream_capture_mb = static_cast<int>(settings.stream_capture_mb);
+  ui_state->stream_capture_compact = settings.stream_capture_compact;
+  ui_state->shared_output = settings.shared_output;
+  ui_state->link_probe = settings.link_probe;
+  ui_state->sim_recording = settings.sim_recording;
+  ui_state->metrics_enabled = settings.metrics_enabled;
+  std::snprintf(ui_state->metrics_ip, sizeof(ui_state->metrics_ip), "%s",
+                settings.metrics_ip.c_str());
+  ui_state->metrics_port = static_cast<int>(settings.metrics_port);
+  ui_state->metrics_interval_s = settings.metrics_interval_s;
 }
 
 void LoadDefaultSettingsUiState(SettingsUiState *ui_state) {
@@ -135,6 +209,43 @@ bool BuildConfigFromSettingsUi(const SettingsUiState &ui_state,
   settings.foreflight_broadcast_port =
       static_cast<uint16_t>(ui_state.foreflight_broadcast_port);
 
+  settings.datagram_packing = ui_state.datagram_packing;
+  if (ui_state.datagram_max_bytes < 128 ||
+      ui_state.datagram_max_bytes > 65507) {
+    if (out_error) {
+      *out_error = "Datagram size must be 128-65507 bytes";
+    }
+    return false;
+  }
+  settings.datagram_max_bytes =
+      static_cast<uint16_t>(ui_state.datagram_max_bytes);
+
+  settings.sender_thread = ui_state.sender_thread;
+  if (ui_state.sender_overflow_policy < 0 ||
+      ui_state.sender_overflow_policy > 1) {
+    if (out_error) {
+      *out_error = "Sender overflow policy must be 0-1";
+    }
+    return false;
+  }
+  settings.sender_overflow_policy =
+      static_cast<uint8_t>(ui_state.sender_overflow_policy);
+  if (ui_state.worker_thread_priority < 0 ||
+      ui_state.worker_thread_priority > 2) {
+    if (out_error) {
+      *out_error = "Worker thread priority must be 0-2";
+    }
+    return false;
+  }
+  settings.worker_thread_priority =
+      static_cast<uint8_t>(ui_state.worker_thread_priority);
+  if (!ParseHex32(ui_state.worker_cpu_mask, &settings.worker_cpu_mask)) {
+    if (out_error) {
+      *out_error = "Worker CPU mask must be a 32-bit hex value (e.g. 0xC)";
+    }
+    return false;
+  }
+
   uint32_t icao_address = 0;
   if (!ParseHex24(ui_state.icao_address, &icao_address)) {
     if (out_error) {
@@ -182,6 +293,14 @@ bool BuildConfigFromSettingsUi(const SettingsUiState &ui_state,
   }
   settings.position_rate = ui_state.position_rate;
 
+  if (ui_state.ownship_high_rate && ui_state.position_rate > 10.0f) {
+    if (out_error) {
+      *out_error = "High-rate ownship needs a position rate of 10 Hz or less";
+    }
+    return false;
+  }
+  settings.ownship_high_rate = ui_state.ownship_high_rate;
+
   if (ui_state.traffic_rate <= 0.0f) {
     if (out_error) {
       *out_error = "Traffic rate must be > 0";
@@ -190,6 +309,32 @@ bool BuildConfigFromSettingsUi(const SettingsUiState &ui_state,
   }
   settings.traffic_rate = ui_state.traffic_rate;
 
+  if (!(ui_state.ahrs_rate >= 0.0f && ui_state.ahrs_rate <= 20.0f)) {
+    if (out_error) {
+      *out_error = "AHRS rate must be 0-20 Hz";
+    }
+    return false;
+  }
+  settings.ahrs_rate = ui_state.ahrs_rate;
+
+  if (!(ui_state.geo_altitude_rate >= 0.0f &&
+        ui_state.geo_altitude_rate <= 5.0f)) {
+    if (out_error) {
+      *out_error = "Geo altitude rate must be 0-5 Hz";
+    }
+    return false;
+  }
+  settings.geo_altitude_rate = ui_state.geo_altitude_rate;
+
+  if (!(ui_state.device_info_rate >= 0.0f &&
+        ui_state.device_info_rate <= 5.0f)) {
+    if (out_error) {
+      *out_error = "ForeFlight ID rate must be 0-5 Hz";
+    }
+    return false;
+  }
+  settings.device_info_rate = ui_state.device_info_rate;
+
   if (ui_state.traffic_max_targets < 0 || ui_state.traffic_max_targets > 63) {
     if (out_error) {
       *out_error = "Traffic maximum must be 0-63";
@@ -199,6 +344,154 @@ bool BuildConfigFromSettingsUi(const SettingsUiState &ui_state,
   settings.traffic_max_targets =
       static_cast<uint8_t>(ui_state.traffic_max_targets);
 
+  if (ui_state.traffic_position_mode < 0 ||
+      ui_state.traffic_position_mode > 1) {
+    if (out_error) {
+      *out_error = "Traffic position mode must be 0-1";
+    }
+    return false;
+  }
+  settings.traffic_position_mode =
+      static_cast<uint8_t>(ui_state.traffic_position_mode);
+
+  if (!(ui_state.traffic_projection_radius_nm >= 0.0f &&
+        ui_state.traffic_projection_radius_nm <= 40.0f)) {
+    if (out_error) {
+      *out_error = "Traffic projection radius must be 0-40 nm";
+    }
+    return false;
+  }
+  settings.traffic_projection_radius_nm =
+      ui_state.traffic_projection_radius_nm;
+
+  if (!(ui_state.traffic_range_nm >= 0.0f &&
+        ui_state.traffic_range_nm <= 500.0f)) {
+    if (out_error) {
+      *out_error = "Traffic range must be 0-500 nm";
+    }
+    return false;
+  }
+  settings.traffic_range_nm = ui_state.traffic_range_nm;
+
+  if (!(ui_state.traffic_altitude_band_ft >= 0.0f &&
+        ui_state.traffic_altitude_band_ft <= 60000.0f)) {
+    if (out_error) {
+      *out_error = "Traffic altitude band must be 0-60000 ft";
+    }
+    return false;
+  }
+  settings.traffic_altitude_band_ft = ui_state.traffic_altitude_band_ft;
+
+  if (!(ui_state.traffic_closure_lookahead_s >= 0.0f &&
+        ui_state.traffic_closure_lookahead_s <= 600.0f)) {
+    if (out_error) {
+      *out_error = "Traffic closure lookahead must be 0-600 s";
+    }
+    return false;
+  }
+  settings.traffic_closure_lookahead_s = ui_state.traffic_closure_lookahead_s;
+  settings.traffic_spatial_index = ui_state.traffic_spatial_index;
+
+  if (!(ui_state.traffic_scan_radius_nm >= 1.0f &&
+        ui_state.traffic_scan_radius_nm <= 108.0f)) {
+    if (out_error) {
+      *out_error = "Traffic scan radius must be 1-108 nm";
+    }
+    return false;
+  }
+  settings.traffic_scan_radius_nm = ui_state.traffic_scan_radius_nm;
+
+  if (!(ui_state.traffic_scan_interval_s >= 1.0f &&
+        ui_state.traffic_scan_interval_s <= 60.0f)) {
+    if (out_error) {
+      *out_error = "Traffic scan interval must be 1-60 s";
+    }
+    return false;
+  }
+  settings.traffic_scan_interval_s = ui_state.traffic_scan_interval_s;
+
+  if (ui_state.traffic_build_threads < 0 ||
+      ui_state.traffic_build_threads > 8) {
+    if (out_error) {
+      *out_error = "Traffic build threads must be 0-8";
+    }
+    return false;
+  }
+  settings.traffic_build_threads =
+      static_cast<uint8_t>(ui_state.traffic_build_threads);
+  settings.traffic_adaptive_rate = ui_state.traffic_adaptive_rate;
+
+  if (!(ui_state.traffic_max_frames_per_second >= 0.0f &&
+        ui_state.traffic_max_frames_per_second <= 1000.0f)) {
+    if (out_error) {
+      *out_error = "Traffic frame budget must be 0-1000 per second";
+    }
+    return false;
+  }
+  settings.traffic_max_frames_per_second =
+      ui_state.traffic_max_frames_per_second;
+  settings.traffic_pacing = ui_state.traffic_pacing;
+  settings.traffic_thread = ui_state.traffic_thread;
+  settings.traffic_smoothing = ui_state.traffic_smoothing;
+
+  settings.traffic_relay = ui_state.traffic_relay;
+  if (ui_state.traffic_relay_port <= 0 ||
+      ui_state.traffic_relay_port > 65535) {
+    if (out_error) {
+      *out_error = "Traffic relay port must be 1-65535";
+    }
+    return false;
+  }
+  settings.traffic_relay_port =
+      static_cast<uint16_t>(ui_state.traffic_relay_port);
+  if (ui_state.traffic_relay_priority < 0 ||
+      ui_state.traffic_relay_priority > 1) {
+    if (out_error) {
+      *out_error = "Traffic relay priority must be 0-1";
+    }
+    return false;
+  }
+  settings.traffic_relay_priority =
+      static_cast<uint8_t>(ui_state.traffic_relay_priority);
+
+  if (!(ui_state.extrapolation_horizon_s >= 0.0f &&
+        ui_state.extrapolation_horizon_s <= 10.0f)) {
+    if (out_error) {
+      *out_error = "Extrapolation horizon must be 0-10 s";
+    }
+    return false;
+  }
+  settings.extrapolation_horizon_s = ui_state.extrapolation_horizon_s;
+
+  if (!(ui_state.output_budget_ms >= 0.0f &&
+        ui_state.output_budget_ms <= 100.0f)) {
+    if (out_error) {
+      *out_error = "Output budget must be 0-100 ms";
+    }
+    return false;
+  }
+  settings.output_budget_ms = ui_state.output_budget_ms;
+
+  if (ui_state.output_budget_bytes < 0 ||
+      ui_state.output_budget_bytes > 65536) {
+    if (out_error) {
+      *out_error = "Output byte budget must be 0-65536";
+    }
+    return false;
+  }
+  settings.output_budget_bytes =
+      static_cast<uint32_t>(ui_state.output_budget_bytes);
+
+  if (ui_state.bandwidth_limit_bytes_per_s < 0 ||
+      ui_state.bandwidth_limit_bytes_per_s > 12500000) {
+    if (out_error) {
+      *out_error = "Bandwidth limit must be 0-12500000 bytes/s";
+    }
+    return false;
+  }
+  settings.bandwidth_limit_bytes_per_s =
+      static_cast<uint32_t>(ui_state.bandwidth_limit_bytes_per_s);
+
   if (ui_state.nic < 0 || ui_state.nic > 11) {
     if (out_error) {
       *out_error = "NIC must be 0-11";
@@ -218,6 +511,45 @@ bool BuildConfigFromSettingsUi(const SettingsUiState &ui_state,
   settings.debug_logging = ui_state.debug_logging;
   settings.log_messages = ui_state.log_messages;
 
+  if (ui_state.stream_capture_mb < 1 || ui_state.stream_capture_mb > 1024) {
+    if (out_error) {
+      *out_error = "Capture size must be 1-1024 MB";
+    }
+    return false;
+  }
+  settings.stream_capture = ui_state.stream_capture;
+  settings.stream_capture_mb =
+      static_cast<uint32_t>(ui_state.stream_capture_mb);
+  settings.stream_capture_compact = ui_state.stream_capture_compact;
+  settings.shared_output = ui_state.shared_output;
+  settings.link_probe = ui_state.link_probe;
+  settings.sim_recording = ui_state.sim_recording;
+
+  const std::string metrics_ip = Trim(ui_state.metrics_ip);
+  if (!protocol::IsValidIpv4Address(metrics_ip)) {
+    if (out_error) {
+      *out_error = "Metrics IP must be a valid IPv4 address";
+    }
+    return false;
+  }
+  if (ui_state.metrics_port <= 0 || ui_state.metrics_port > 65535) {
+    if (out_error) {
+      *out_error = "Metrics port must be 1-65535";
+    }
+    return false;
+  }
+  if (!(ui_state.metrics_interval_s >= 1.0f &&
+        ui_state.metrics_interval_s <= 300.0f)) {
+    if (out_error) {
+      *out_error = "Metrics interval must be 1-300 seconds";
+    }
+    return false;
+  }
+  settings.metrics_enabled = ui_state.metrics_enabled;
+  settings.metrics_ip = metrics_ip;
+  settings.metrics_port = static_cast<uint16_t>(ui_state.metrics_port);
+  settings.metrics_interval_s = ui_state.metrics_interval_s;
+
   *out_settings = settings;
   if (out_error) {
     out_error->clear();
@@ -225,4 +557,23 @@ bool BuildConfigFromSettingsUi(const SettingsUiState &ui_state,
   return true;
 }
 
+void SettingsRedrawPolicy::noteInput(double now) {
+  dirty_ = true;
+  active_until_ = (std::max)(active_until_, now + active_hold_s_);
+}
+
+bool SettingsRedrawPolicy::shouldRebuild(double now, bool busy) const {
+  if (dirty_ || busy || now < active_until_) {
+    return true;
+  }
+  // A clock that went backwards, as after a sim reset, rebuilds too.
+  return now - last_rebuild_ >= idle_interval_s_ || now < last_rebuild_;
+}
+
+void SettingsRedrawPolicy::noteRebuilt(double now) {
+  dirty_ = false;
+  last_rebuild_ = now;
+  ++rebuilds_;
+}
+
 } // namespace xp2gdl90
@@ -0,0 +1,165 @@
+#include "xp2gdl90/settings_watcher.h"
+
+#include <chrono>
+#include <system_error>
+#include <utility>
+
+namespace xp2gdl90 {
+
+SettingsWatcher::~SettingsWatcher() { stop(); }
+
+bool SettingsWatcher::start(const std::string &path, const Settings &base,
+                            double poll_interval_s, std::string *out_error) {
+  if (thread_.joinable()) {
+    return true;
+  }
+
+  path_ = path;
+  poll_interval_s_ =
+      poll_interval_s > 0.0 ? poll_interval_s : SETTINGS_POLL_INTERVAL_S;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_requested_ = false;
+    reload_requested_ = true;
+    base_ = base;
+    pending_.reset();
+  }
+  try {
+    thread_ = std::thread(&SettingsWatcher::run, this);
+  } catch (const std::system_error &error) {
+    if (out_error) {
+      *out_error =
+          std::string("Settings thread failed to start: ") + error.what();
+    }
+    return false;
+  }
+  if (out_error) {
+    out_error->clear();
+  }
+  return true;
+}
+
+void SettingsWatcher::stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_requested_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+}
+
+std::shared_ptr<const SettingsLoad> SettingsWatcher::take() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::move(pending_);
+}
+
+void SettingsWatcher::requestReload() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    reload_requested_ = true;
+  }
+  wake_.notify_one();
+}
+
+bool SettingsWatcher::save(const Settings &settings, std::string *out_error) {
+  const std::string temp_path = path_ + ".tmp";
+  if (!SaveSettingsToJsonFile(temp_path, settings, out_error)) {
+    std::error_code ignored;
+    std::filesystem::remove(temp_path, ignored);
+    return false;
+  }
+  // The rename keeps the temp file's stamp, which is recorded as already
+  // read so the watcher skips it.
+  const FileStamp stamp = Stat(temp_path);
+  std::error_code error;
+  std::filesystem::rename(temp_path, path_, error);
+  if (error) {
+    std::error_code ignored;
+    std::filesystem::remove(temp_path, ignored);
+    if (out_error) {
+      *out_error = "Failed to replace settings file: " + error.message();
+    }
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  base_ = settings;
+  stamp_ = stamp;
+  seen_ = stamp;
+  ++saves_;
+  pending_.reset();
+  return true;
+}
+
+SettingsWatcher::FileStamp SettingsWatcher::Stat(const std::string &path) {
+  FileStamp stamp;
+  std::error_code error;
+  stamp.modified = std::filesystem::last_write_time(path, error);
+  if (error) {
+    return FileStamp();
+  }
+  stamp.size = std::filesystem::file_size(path, error);
+  if (error) {
+    return FileStamp();
+  }
+  stamp.exists = true;
+  return stamp;
+}
+
+void SettingsWatcher::run() {
+  const auto interval = std::chrono::duration<double>(poll_interval_s_);
+  for (;;) {
+    poll();
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_.wait_for(lock, interval,
+                   [this] { return stop_requested_ || reload_requested_; });
+    if (stop_requested_) {
+      return;
+    }
+  }
+}
+
+void SettingsWatcher::poll() {
+  const FileStamp stamp = Stat(path_);
+  std::shared_ptr<SettingsLoad> load;
+  uint64_t saves = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // An edit is read once the file has looked the same for a whole poll,
+    // so a save caught between truncating and writing is not reported as
+    // a broken file.
+    const bool settled = stamp == seen_;
+    seen_ = stamp;
+    if (!reload_requested_ && (stamp == stamp_ || !settled)) {
+      return;
+    }
+    reload_requested_ = false;
+    stamp_ = stamp;
+    // Allocated only for a read, not on every poll.
+    load = std::make_shared<SettingsLoad>();
+    load->settings = base_;
+    saves = saves_;
+  }
+
+  // Read without mutex_ held, so take() never waits on the disk.
+  load->ok = LoadSettingsFromJsonFile(path_, &load->settings, &load->error);
+  // A missing file is the one failure that reports no error.
+  load->found = load->ok || !load->error.empty();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (saves != saves_) {
+    // Read from before the save, or against a base it replaced.
+    return;
+  }
+  if (load->ok) {
+    base_ = load->settings;
+  }
+  load->generation = ++generation_;
+  pending_ = std::move(load);
+}
+
+} // namespace xp2gdl90
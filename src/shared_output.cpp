@@ -0,0 +1,465 @@
+#include "xp2gdl90/shared_output.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace xp2gdl90 {
+
+namespace {
+
+constexpr size_t kRecordHeader = sizeof(uint32_t);
+constexpr size_t kRingOffset =
+    (sizeof(SharedOutputHeader) + sizeof(SharedSnapshot) + 63) / 64 * 64;
+constexpr size_t kMappedBytes = kRingOffset + SHARED_OUTPUT_RING_BYTES;
+
+static_assert((SHARED_OUTPUT_RING_BYTES & (SHARED_OUTPUT_RING_BYTES - 1)) ==
+                  0,
+              "ring size must be a power of two");
+
+size_t RecordBytes(size_t size) {
+  return kRecordHeader + ((size + 3) & ~static_cast<size_t>(3));
+}
+
+#ifdef _WIN32
+std::string MappingName(const std::string &name) { return "Local\\" + name; }
+
+std::string LastErrorMessage(const char *prefix) {
+  return std::string(prefix) + std::to_string(GetLastError());
+}
+#else
+std::string MappingName(const std::string &name) { return "/" + name; }
+
+std::string LastErrorMessage(const char *prefix) {
+  return std::string(prefix) + std::strerror(errno);
+}
+#endif
+
+void SetError(std::string *out_error, const std::string &error) {
+  if (out_error) {
+    *out_error = error;
+  }
+}
+
+SharedTarget ToSharedTarget(const gdl90::PositionData &report) {
+  SharedTarget target;
+  target.latitude = report.latitude;
+  target.longitude = report.longitude;
+  target.altitude = report.altitude;
+  target.icao_address = report.icao_address;
+  target.h_velocity = report.h_velocity;
+  target.v_velocity = report.v_velocity;
+  target.track = report.track;
+  target.track_type = static_cast<uint8_t>(report.track_type);
+  target.airborne = report.airborne ? 1 : 0;
+  target.nic = report.nic;
+  target.nacp = report.nacp;
+  target.emitter_category = static_cast<uint8_t>(report.emitter_category);
+  target.address_type = static_cast<uint8_t>(report.address_type);
+  target.alert_status = report.alert_status;
+  target.emergency_code = report.emergency_code;
+  std::memset(target.callsign, ' ', sizeof(target.callsign));
+  std::memcpy(target.callsign, report.callsign.data(),
+              (std::min)(report.callsign.size(), sizeof(target.callsign)));
+  return target;
+}
+
+} // namespace
+
+SharedOutput::~SharedOutput() { close(); }
+
+bool SharedOutput::open(const std::string &name, std::string *out_error) {
+  close();
+  if (name.empty()) {
+    SetError(out_error, "Shared output name is empty");
+    return false;
+  }
+  name_ = name;
+  if (!mapShared(kMappedBytes, out_error)) {
+    name_.clear();
+    return false;
+  }
+  header_ = new (base_) SharedOutputHeader();
+  snapshot_ = reinterpret_cast<SharedSnapshot *>(base_ +
+                                                 sizeof(SharedOutputHeader));
+  ring_ = base_ + kRingOffset;
+  std::memset(static_cast<void *>(snapshot_), 0, sizeof(SharedSnapshot));
+  header_->version = SHARED_OUTPUT_VERSION;
+  header_->header_bytes = static_cast<uint16_t>(sizeof(SharedOutputHeader));
+  header_->snapshot_offset = static_cast<uint32_t>(sizeof(SharedOutputHeader));
+  header_->ring_offset = static_cast<uint32_t>(kRingOffset);
+  header_->ring_bytes = static_cast<uint32_t>(SHARED_OUTPUT_RING_BYTES);
+  header_->max_targets = static_cast<uint32_t>(SHARED_OUTPUT_MAX_TARGETS);
+  // Last, so a reader that sees the magic sees the layout.
+  std::atomic_thread_fence(std::memory_order_release);
+  header_->magic = SHARED_OUTPUT_MAGIC;
+
+  write_pos_ = 0;
+  staging_ = SharedSnapshot();
+  snapshot_dirty_ = false;
+  frames_.store(0);
+  bytes_.store(0);
+  wraps_.store(0);
+  snapshots_.store(0);
+  wall_base_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+  steady_base_ = std::chrono::steady_clock::now();
+  return true;
+}
+
+void SharedOutput::close() {
+  if (!base_) {
+    return;
+  }
+  // Readers still mapped can tell the writer has gone.
+  header_->magic = 0;
+  unmapShared();
+  header_ = nullptr;
+  snapshot_ = nullptr;
+  ring_ = nullptr;
+  name_.clear();
+}
+
+void SharedOutput::publishFrame(const uint8_t *data, size_t size) {
+  if (!base_ || !data || size == 0 ||
+      RecordBytes(size) > SHARED_OUTPUT_RING_BYTES) {
+    return;
+  }
+  const size_t record = RecordBytes(size);
+  uint64_t pos = write_pos_;
+  size_t offset = static_cast<size_t>(pos & (SHARED_OUTPUT_RING_BYTES - 1));
+  const bool wrap = offset + record > SHARED_OUTPUT_RING_BYTES;
+  const uint64_t start = wrap ? pos + (SHARED_OUTPUT_RING_BYTES - offset) : pos;
+  // Readers of the bytes about to change find out from write_end.
+  header_->write_end.store(start + record, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  if (wrap) {
+    std::memcpy(ring_ + offset, &SHARED_OUTPUT_WRAP, kRecordHeader);
+    offset = 0;
+    wraps_.fetch_add(1, std::memory_order_relaxed);
+  }
+  const uint32_t length = static_cast<uint32_t>(size);
+  std::memcpy(ring_ + offset, &length, kRecordHeader);
+  std::memcpy(ring_ + offset + kRecordHeader, data, size);
+  write_pos_ = start + record;
+  header_->write_pos.store(write_pos_, std::memory_order_release);
+
+  frames_.fetch_add(1, std::memory_order_relaxed);
+  bytes_.fetch_add(size, std::memory_order_relaxed);
+  // Ownship frames start with the flag and the unescaped message ID.
+  if (size > 1 && data[1] == gdl90::MSG_ID_OWNSHIP_REPORT &&
+      decodeTarget(data, size, &staging_.ownship)) {
+    staging_.ownship_valid = 1;
+    snapshot_dirty_ = true;
+  }
+}
+
+void SharedOutput::setTraffic(const gdl90::FrameArena &frames) {
+  if (!base_) {
+    return;
+  }
+  uint32_t count = 0;
+  for (size_t i = 0;
+       i < frames.frameCount() && count < SHARED_OUTPUT_MAX_TARGETS; ++i) {
+    if (decodeTarget(frames.frameData(i), frames.frameSize(i),
+                     &staging_.traffic[count])) {
+      ++count;
+    }
+  }
+  staging_.traffic_count = count;
+  snapshot_dirty_ = true;
+}
+
+void SharedOutput::clearTraffic() {
+  if (staging_.traffic_count != 0) {
+    staging_.traffic_count = 0;
+    snapshot_dirty_ = true;
+  }
+}
+
+void SharedOutput::publishSnapshot() {
+  if (!base_ || !snapshot_dirty_) {
+    return;
+  }
+  ++staging_.tick;
+  staging_.timestamp_ns =
+      wall_base_ns_ + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - steady_base_)
+                          .count();
+  std::atomic<uint64_t> &sequence = header_->snapshot_sequence;
+  const uint64_t begin = sequence.load(std::memory_order_relaxed) + 1;
+  sequence.store(begin, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  // Only the targets in use; readers ignore the rest.
+  std::memcpy(static_cast<void *>(snapshot_), &staging_,
+              offsetof(SharedSnapshot, traffic) +
+                  staging_.traffic_count * sizeof(SharedTarget));
+  sequence.store(begin + 1, std::memory_order_release);
+  snapshot_dirty_ = false;
+  snapshots_.fetch_add(1, std::memory_order_relaxed);
+}
+
+SharedOutputStats SharedOutput::stats() const {
+  SharedOutputStats stats;
+  stats.frames = frames_.load(std::memory_order_relaxed);
+  stats.bytes = bytes_.load(std::memory_order_relaxed);
+  stats.wraps = wraps_.load(std::memory_order_relaxed);
+  stats.snapshots = snapshots_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+bool SharedOutput::decodeTarget(const uint8_t *data, size_t size,
+                                SharedTarget *out) {
+  decoder_.reset(data, size);
+  gdl90::FrameSpan frame;
+  gdl90::PositionData report;
+  if (!decoder_.next(&frame) || !gdl90::DecodePositionReport(frame, &report)) {
+    return false;
+  }
+  *out = ToSharedTarget(report);
+  return true;
+}
+
+SharedOutputReader::~SharedOutputReader() { close(); }
+
+bool SharedOutputReader::open(const std::string &name,
+                              std::string *out_error) {
+  close();
+#ifdef _WIN32
+  HANDLE mapping =
+      OpenFileMappingA(FILE_MAP_READ, FALSE, MappingName(name).c_str());
+  void *view =
+      mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (!view) {
+    SetError(out_error, LastErrorMessage("Cannot open shared output: "));
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    return false;
+  }
+  MEMORY_BASIC_INFORMATION region;
+  const size_t bytes =
+      VirtualQuery(view, &region, sizeof(region)) ? region.RegionSize : 0;
+  mapping_ = mapping;
+#else
+  const int fd = ::shm_open(MappingName(name).c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    SetError(out_error, LastErrorMessage("Cannot open shared output: "));
+    return false;
+  }
+  struct stat info;
+  const size_t bytes =
+      ::fstat(fd, &info) == 0 ? static_cast<size_t>(info.st_size) : 0;
+  void *view = bytes > 0 ? ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0)
+                         : MAP_FAILED;
+  ::close(fd);
+  if (view == MAP_FAILED) {
+    SetError(out_error, LastErrorMessage("Cannot map shared output: "));
+    return false;
+  }
+#endif
+  base_ = static_cast<const uint8_t *>(view);
+  mapped_bytes_ = bytes;
+
+  const SharedOutputHeader *header =
+      reinterpret_cast<const SharedOutputHeader *>(base_);
+  const bool valid =
+      bytes >= sizeof(SharedOutputHeader) &&
+      header->magic == SHARED_OUTPUT_MAGIC &&
+      header->version == SHARED_OUTPUT_VERSION &&
+      header->ring_bytes != 0 &&
+      (header->ring_bytes & (header->ring_bytes - 1)) == 0 &&
+      header->max_targets == SHARED_OUTPUT_MAX_TARGETS &&
+      static_cast<uint64_t>(header->ring_offset) + header->ring_bytes <=
+          bytes;
+  if (!valid) {
+    SetError(out_error, "Shared output has no writer or another version");
+    close();
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  header_ = header;
+  ring_ = base_ + header->ring_offset;
+  ring_bytes_ = header->ring_bytes;
+  overruns_ = 0;
+  resync();
+  return true;
+}
+
+void SharedOutputReader::close() {
+  if (!base_) {
+    return;
+  }
+#ifdef _WIN32
+  UnmapViewOfFile(base_);
+  CloseHandle(static_cast<HANDLE>(mapping_));
+  mapping_ = nullptr;
+#else
+  ::munmap(const_cast<uint8_t *>(base_), mapped_bytes_);
+#endif
+  base_ = nullptr;
+  mapped_bytes_ = 0;
+  header_ = nullptr;
+  ring_ = nullptr;
+}
+
+size_t SharedOutputReader::readFrames(SharedFrame *out, size_t capacity) {
+  if (!header_ || !out) {
+    return 0;
+  }
+  const uint64_t end = header_->write_pos.load(std::memory_order_acquire);
+  // A writer that reopened starts again from zero.
+  if (end < cursor_ || end - cursor_ > ring_bytes_) {
+    ++overruns_;
+    resync();
+    return 0;
+  }
+  batch_start_ = cursor_;
+  size_t count = 0;
+  while (cursor_ < end && count < capacity) {
+    const uint64_t offset = cursor_ & (ring_bytes_ - 1);
+    uint32_t length = 0;
+    std::memcpy(&length, ring_ + offset, kRecordHeader);
+    if (length == SHARED_OUTPUT_WRAP) {
+      cursor_ += ring_bytes_ - offset;
+      continue;
+    }
+    // Only a torn length runs past the ring.
+    if (length == 0 || offset + RecordBytes(length) > ring_bytes_) {
+      ++overruns_;
+      resync();
+      return 0;
+    }
+    out[count].data = ring_ + offset + kRecordHeader;
+    out[count].size = length;
+    ++count;
+    cursor_ += RecordBytes(length);
+  }
+  return count;
+}
+
+bool SharedOutputReader::framesIntact() const {
+  if (!header_) {
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t end = header_->write_end.load(std::memory_order_relaxed);
+  return end >= batch_start_ && end - batch_start_ <= ring_bytes_;
+}
+
+bool SharedOutputReader::readSnapshot(SharedSnapshot *out,
+                                      int attempts) const {
+  if (!header_ || !out) {
+    return false;
+  }
+  const SharedSnapshot *snapshot = reinterpret_cast<const SharedSnapshot *>(
+      base_ + header_->snapshot_offset);
+  for (int attempt = 0; attempt < attempts; ++attempt) {
+    const uint64_t begin =
+        header_->snapshot_sequence.load(std::memory_order_acquire);
+    if (begin == 0) {
+      return false;
+    }
+    if (begin & 1) {
+      continue;
+    }
+    std::memcpy(static_cast<void *>(out), snapshot,
+                offsetof(SharedSnapshot, traffic));
+    const size_t count =
+        (std::min)(static_cast<size_t>(out->traffic_count),
+                   SHARED_OUTPUT_MAX_TARGETS);
+    std::memcpy(out->traffic, snapshot->traffic, count * sizeof(SharedTarget));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header_->snapshot_sequence.load(std::memory_order_relaxed) == begin) {
+      out->traffic_count = static_cast<uint32_t>(count);
+      return true;
+    }
+  }
+  return false;
+}
+
+void SharedOutputReader::resync() {
+  cursor_ = header_->write_pos.load(std::memory_order_acquire);
+  batch_start_ = cursor_;
+}
+
+#ifdef _WIN32
+bool SharedOutput::mapShared(size_t bytes, std::string *out_error) {
+  const uint64_t size = bytes;
+  HANDLE mapping = CreateFileMappingA(
+      INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+      static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFFu),
+      MappingName(name_).c_str());
+  void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, bytes)
+                       : nullptr;
+  if (!view) {
+    SetError(out_error, LastErrorMessage("Cannot create shared output: "));
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    return false;
+  }
+  mapping_ = mapping;
+  base_ = static_cast<uint8_t *>(view);
+  mapped_bytes_ = bytes;
+  return true;
+}
+
+// The name goes with the last handle to the mapping.
+void SharedOutput::unmapShared() {
+  UnmapViewOfFile(base_);
+  CloseHandle(static_cast<HANDLE>(mapping_));
+  mapping_ = nullptr;
+  base_ = nullptr;
+  mapped_bytes_ = 0;
+}
+#else
+bool SharedOutput::mapShared(size_t bytes, std::string *out_error) {
+  const std::string name = MappingName(name_);
+  const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    SetError(out_error, LastErrorMessage("Cannot create shared output: "));
+    return false;
+  }
+  if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+    SetError(out_error, LastErrorMessage("Cannot size shared output: "));
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    return false;
+  }
+  void *view =
+      ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (view == MAP_FAILED) {
+    SetError(out_error, LastErrorMessage("Cannot map shared output: "));
+    ::shm_unlink(name.c_str());
+    return false;
+  }
+  base_ = static_cast<uint8_t *>(view);
+  mapped_bytes_ = bytes;
+  return true;
+}
+
+void SharedOutput::unmapShared() {
+  ::munmap(base_, mapped_bytes_);
+  ::shm_unlink(MappingName(name_).c_str());
+  base_ = nullptr;
+  mapped_bytes_ = 0;
+}
+#endif
+
+} // namespace xp2gdl90
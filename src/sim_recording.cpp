@@ -0,0 +1,259 @@
+#include "xp2gdl90/sim_recording.h"
+
+#include <cstring>
+
+namespace xp2gdl90 {
+namespace {
+
+constexpr char kMagic[8] = {'X', 'P', 'G', 'D', 'L', 'S', 'I', 'M'};
+constexpr size_t kFileHeaderSize = sizeof(kMagic) + sizeof(uint32_t);
+// Larger ticks are treated as damage rather than allocated.
+constexpr uint32_t kMaxRows = 1u << 16;
+
+constexpr uint8_t kGpsValid = 1u << 0;
+constexpr uint8_t kOnGround = 1u << 1;
+constexpr uint8_t kHasAnchor = 1u << 2;
+constexpr uint8_t kHasSsrMode = 1u << 3;
+
+static_assert(sizeof(int) == sizeof(int32_t), "int columns are 32-bit");
+
+// Values and columns are written in host byte order.
+template <typename T> void Put(std::vector<uint8_t> *out, const T &value) {
+  const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+  out->insert(out->end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+void PutColumn(std::vector<uint8_t> *out, const std::vector<T> &column) {
+  const auto *bytes = reinterpret_cast<const uint8_t *>(column.data());
+  out->insert(out->end(), bytes, bytes + column.size() * sizeof(T));
+}
+
+class Cursor {
+public:
+  Cursor(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+  template <typename T> bool get(T *out) {
+    return read(out, sizeof(T));
+  }
+
+  template <typename T> bool getColumn(size_t rows, std::vector<T> *out) {
+    out->resize(rows);
+    return read(out->data(), rows * sizeof(T));
+  }
+
+  bool done() const { return offset_ == size_; }
+
+private:
+  bool read(void *out, size_t size) {
+    if (size > size_ - offset_) {
+      return false;
+    }
+    std::memcpy(out, data_ + offset_, size);
+    offset_ += size;
+    return true;
+  }
+
+  const uint8_t *data_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+
+} // namespace
+
+bool SimRecorder::open(const std::string &path, std::string *out_error) {
+  close();
+  file_.open(path, std::ios::binary | std::ios::trunc);
+  if (!file_) {
+    if (out_error) {
+      *out_error = "Cannot create sim recording: " + path;
+    }
+    return false;
+  }
+  file_.write(kMagic, sizeof(kMagic));
+  const uint32_t version = SIM_RECORDING_VERSION;
+  file_.write(reinterpret_cast<const char *>(&version), sizeof(version));
+  path_ = path;
+  ticks_ = 0;
+  bytes_ = kFileHeaderSize;
+  return true;
+}
+
+void SimRecorder::close() {
+  if (file_.is_open()) {
+    file_.close();
+  }
+}
+
+bool SimRecorder::append(const OwnshipSample &ownship,
+                         const traffic::ProjectionAnchor *anchor,
+                         bool has_ssr_mode,
+                         const traffic::TrafficSnapshot &traffic) {
+  if (!file_) {
+    return false;
+  }
+  buffer_.clear();
+  Put(&buffer_, uint32_t{0}); // Patched with the body size below.
+  Put(&buffer_, ownship.broadcast_time);
+  Put(&buffer_, ownship.latitude);
+  Put(&buffer_, ownship.longitude);
+  Put(&buffer_, ownship.geometric_altitude_m);
+  Put(&buffer_, ownship.pressure_altitude_ft);
+  Put(&buffer_, ownship.ground_speed_mps);
+  Put(&buffer_, ownship.vertical_speed_fpm);
+  Put(&buffer_, ownship.track_deg);
+  Put(&buffer_, ownship.roll_deg);
+  Put(&buffer_, ownship.pitch_deg);
+  Put(&buffer_, ownship.heading_deg);
+  Put(&buffer_, ownship.indicated_airspeed_kt);
+  Put(&buffer_, ownship.true_airspeed_kt);
+  uint8_t flags = 0;
+  flags |= ownship.gps_valid ? kGpsValid : 0;
+  flags |= ownship.on_ground ? kOnGround : 0;
+  flags |= anchor ? kHasAnchor : 0;
+  flags |= has_ssr_mode ? kHasSsrMode : 0;
+  Put(&buffer_, flags);
+  Put(&buffer_, static_cast<uint8_t>(ownship.tail_number.size()));
+  char tail[gdl90::CALLSIGN_SIZE] = {};
+  std::memcpy(tail, ownship.tail_number.data(), ownship.tail_number.size());
+  Put(&buffer_, tail);
+
+  const traffic::ProjectionAnchor none;
+  const traffic::ProjectionAnchor &written = anchor ? *anchor : none;
+  Put(&buffer_, written.x);
+  Put(&buffer_, written.y);
+  Put(&buffer_, written.z);
+  Put(&buffer_, written.latitude_deg);
+  Put(&buffer_, written.longitude_deg);
+  Put(&buffer_, written.altitude_m);
+  Put(&buffer_, written.origin_latitude_deg);
+  Put(&buffer_, written.origin_longitude_deg);
+
+  Put(&buffer_, static_cast<uint32_t>(traffic.size()));
+  PutColumn(&buffer_, traffic.raw_address);
+  PutColumn(&buffer_, traffic.x);
+  PutColumn(&buffer_, traffic.y);
+  PutColumn(&buffer_, traffic.z);
+  PutColumn(&buffer_, traffic.vx);
+  PutColumn(&buffer_, traffic.vy);
+  PutColumn(&buffer_, traffic.vz);
+  PutColumn(&buffer_, traffic.vertical_speed_fpm);
+  PutColumn(&buffer_, traffic.heading_deg);
+  PutColumn(&buffer_, traffic.weight_on_wheels);
+  PutColumn(&buffer_, traffic.ssr_mode);
+  PutColumn(&buffer_, traffic.squawk);
+  PutColumn(&buffer_, traffic.wake_category);
+  PutColumn(&buffer_, traffic.callsign);
+
+  const uint32_t body = static_cast<uint32_t>(buffer_.size() - sizeof(body));
+  std::memcpy(buffer_.data(), &body, sizeof(body));
+  file_.write(reinterpret_cast<const char *>(buffer_.data()),
+              static_cast<std::streamsize>(buffer_.size()));
+  if (!file_) {
+    return false;
+  }
+  ++ticks_;
+  bytes_ += buffer_.size();
+  return true;
+}
+
+bool SimPlayback::open(const std::string &path, std::string *out_error) {
+  file_.close();
+  file_.clear();
+  ticks_ = 0;
+  file_.open(path, std::ios::binary);
+  char magic[sizeof(kMagic)] = {};
+  uint32_t version = 0;
+  if (!file_) {
+    if (out_error) {
+      *out_error = "Cannot open sim recording: " + path;
+    }
+    return false;
+  }
+  file_.read(magic, sizeof(magic));
+  file_.read(reinterpret_cast<char *>(&version), sizeof(version));
+  if (!file_ || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      version != SIM_RECORDING_VERSION) {
+    if (out_error) {
+      *out_error = "Not a version " + std::to_string(SIM_RECORDING_VERSION) +
+                   " sim recording: " + path;
+    }
+    file_.close();
+    return false;
+  }
+  return true;
+}
+
+bool SimPlayback::next(SimTick *out) {
+  uint32_t body = 0;
+  if (!out || !file_.is_open() ||
+      !file_.read(reinterpret_cast<char *>(&body), sizeof(body))) {
+    return false;
+  }
+  buffer_.resize(body);
+  if (!file_.read(reinterpret_cast<char *>(buffer_.data()), body)) {
+    return false;
+  }
+
+  Cursor cursor(buffer_.data(), buffer_.size());
+  OwnshipSample &ownship = out->ownship;
+  uint8_t flags = 0;
+  uint8_t tail_size = 0;
+  char tail[gdl90::CALLSIGN_SIZE] = {};
+  traffic::ProjectionAnchor &anchor = out->anchor;
+  uint32_t rows = 0;
+  if (!cursor.get(&ownship.broadcast_time) || !cursor.get(&ownship.latitude) ||
+      !cursor.get(&ownship.longitude) ||
+      !cursor.get(&ownship.geometric_altitude_m) ||
+      !cursor.get(&ownship.pressure_altitude_ft) ||
+      !cursor.get(&ownship.ground_speed_mps) ||
+      !cursor.get(&ownship.vertical_speed_fpm) ||
+      !cursor.get(&ownship.track_deg) || !cursor.get(&ownship.roll_deg) ||
+      !cursor.get(&ownship.pitch_deg) || !cursor.get(&ownship.heading_deg) ||
+      !cursor.get(&ownship.indicated_airspeed_kt) ||
+      !cursor.get(&ownship.true_airspeed_kt) || !cursor.get(&flags) ||
+      !cursor.get(&tail_size) || !cursor.get(&tail) ||
+      !cursor.get(&anchor.x) || !cursor.get(&anchor.y) ||
+      !cursor.get(&anchor.z) || !cursor.get(&anchor.latitude_deg) ||
+      !cursor.get(&anchor.longitude_deg) || !cursor.get(&anchor.altitude_m) ||
+      !cursor.get(&anchor.origin_latitude_deg) ||
+      !cursor.get(&anchor.origin_longitude_deg) || !cursor.get(&rows) ||
+      rows > kMaxRows) {
+    return false;
+  }
+  ownship.gps_valid = (flags & kGpsValid) != 0;
+  ownship.on_ground = (flags & kOnGround) != 0;
+  out->has_anchor = (flags & kHasAnchor) != 0;
+  out->has_ssr_mode = (flags & kHasSsrMode) != 0;
+  ownship.tail_number = gdl90::Callsign::fromBytes(
+      tail, tail_size < sizeof(tail) ? tail_size : sizeof(tail));
+
+  traffic::TrafficSnapshot &traffic = out->traffic;
+  traffic.resize(rows);
+  if (!cursor.getColumn(rows, &traffic.raw_address) ||
+      !cursor.getColumn(rows, &traffic.x) ||
+      !cursor.getColumn(rows, &traffic.y) ||
+      !cursor.getColumn(rows, &traffic.z) ||
+      !cursor.getColumn(rows, &traffic.vx) ||
+      !cursor.getColumn(rows, &traffic.vy) ||
+      !cursor.getColumn(rows, &traffic.vz) ||
+      !cursor.getColumn(rows, &traffic.vertical_speed_fpm) ||
+      !cursor.getColumn(rows, &traffic.heading_deg) ||
+      !cursor.getColumn(rows, &traffic.weight_on_wheels) ||
+      !cursor.getColumn(rows, &traffic.ssr_mode) ||
+      !cursor.getColumn(rows, &traffic.squawk) ||
+      !cursor.getColumn(rows, &traffic.wake_category) ||
+      !cursor.getColumn(rows, &traffic.callsign) || !cursor.done()) {
+    return false;
+  }
+  // The columns the plugin sets itself after reading the arrays.
+  for (size_t row = 0; row < rows; ++row) {
+    traffic.source_id[row] = static_cast<uint32_t>(row);
+    traffic.flags[row] = 0;
+    traffic.ground_speed_kt[row] = NAN;
+  }
+  ++ticks_;
+  return true;
+}
+
+} // namespace xp2gdl90
@@ -1,10 +1,15 @@
 #include "xp2gdl90/simple_json.h"
 
+#include <algorithm>
 #include <cctype>
 #include <cmath>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <limits>
+#include <memory>
+#include <new>
 
 namespace xp2gdl90::json {
 namespace {
@@ -52,25 +57,24 @@ bool ParseHexNibble(char ch, uint8_t *out_value) {
   return false;
 }
 
-void AppendUtf8(std::string *out, uint32_t codepoint) {
-  if (!out) {
-    return;
-  }
+// Writes at most four bytes and returns the end of what it wrote.
+char *AppendUtf8(char *out, uint32_t codepoint) {
   if (codepoint <= 0x7F) {
-    out->push_back(static_cast<char>(codepoint));
+    *out++ = static_cast<char>(codepoint);
   } else if (codepoint <= 0x7FF) {
-    out->push_back(static_cast<char>(0xC0 | ((codepoint >> 6) & 0x1F)));
-    out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    *out++ = static_cast<char>(0xC0 | ((codepoint >> 6) & 0x1F));
+    *out++ = static_cast<char>(0x80 | (codepoint & 0x3F));
   } else if (codepoint <= 0xFFFF) {
-    out->push_back(static_cast<char>(0xE0 | ((codepoint >> 12) & 0x0F)));
-    out->push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
-    out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    *out++ = static_cast<char>(0xE0 | ((codepoint >> 12) & 0x0F));
+    *out++ = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (codepoint & 0x3F));
   } else {
-    out->push_back(static_cast<char>(0xF0 | ((codepoint >> 18) & 0x07)));
-    out->push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
-    out->push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
-    out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    *out++ = static_cast<char>(0xF0 | ((codepoint >> 18) & 0x07));
+    *out++ = static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+    *out++ = static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (codepoint & 0x3F));
   }
+  return out;
 }
 
 bool ParseUnicodeEscape(Cursor *cursor, uint32_t *out_codepoint,
@@ -122,428 +126,945 @@ bool ParseUnicodeEscape(Cursor *cursor, uint32_t *out_codepoint,
   return true;
 }
 
-bool ParseString(Cursor *cursor, std::string *out_string,
-                 std::string *out_error) {
-  if (!Consume(cursor, '"')) {
-    if (out_error) {
-      *out_error = "Expected '\"' to start JSON string";
+bool ParseLiteral(Cursor *cursor, const char *literal) {
+  const char *p = literal;
+  while (*p != '\0') {
+    if (cursor->p >= cursor->end || *cursor->p != *p) {
+      return false;
     }
+    ++cursor->p;
+    ++p;
+  }
+  return true;
+}
+
+void SetError(std::string *out_error, const char *message) {
+  if (out_error) {
+    *out_error = message;
+  }
+}
+
+// Objects with more members than this get a hash index.
+constexpr uint32_t kIndexedObjectMinMembers = 8;
+constexpr size_t kArenaMaxBlockSize = 64 * 1024;
+// Enough scratch for a settings file without regrowing.
+constexpr size_t kScratchReserve = 64;
+
+uint32_t HashKey(std::string_view key) {
+  uint32_t hash = 2166136261u;
+  for (const char ch : key) {
+    hash = (hash ^ static_cast<unsigned char>(ch)) * 16777619u;
+  }
+  return hash;
+}
+
+// A string's raw span between its quotes.
+struct StringToken {
+  const char *start = nullptr;
+  const char *close = nullptr;
+  bool escaped = false;
+
+  size_t rawSize() const { return static_cast<size_t>(close - start); }
+};
+
+// Finds the closing quote, leaving the cursor past it. Escapes are checked
+// for completeness only; UnescapeString() validates them.
+bool ScanString(Cursor *cursor, StringToken *out, std::string *out_error) {
+  if (!Consume(cursor, '"')) {
+    SetError(out_error, "Expected '\"' to start JSON string");
     return false;
   }
 
-  std::string result;
-  while (cursor->p < cursor->end) {
-    const char ch = *cursor->p++;
-    if (ch == '"') {
-      *out_string = std::move(result);
-      return true;
-    }
-    if (static_cast<unsigned char>(ch) < 0x20) {
-      if (out_error) {
-        *out_error = "JSON strings cannot contain control characters";
-      }
+  const char *p = cursor->p;
+  out->start = p;
+  out->escaped = false;
+  while (p < cursor->end && *p != '"') {
+    if (static_cast<unsigned char>(*p) < 0x20) {
+      SetError(out_error, "JSON strings cannot contain control characters");
       return false;
     }
-    if (ch != '\\') {
-      result.push_back(ch);
-      continue;
-    }
-
-    if (cursor->p >= cursor->end) {
-      if (out_error) {
-        *out_error = "Unexpected end of input in JSON string escape";
+    if (*p == '\\') {
+      out->escaped = true;
+      if (++p >= cursor->end) {
+        SetError(out_error, "Unexpected end of input in JSON string escape");
+        return false;
       }
-      return false;
     }
+    ++p;
+  }
+  if (p >= cursor->end) {
+    SetError(out_error, "Unexpected end of input in JSON string");
+    return false;
+  }
+  out->close = p;
+  cursor->p = p + 1;
+  return true;
+}
 
-    const char escape = *cursor->p++;
+// Decodes `token` into `out`, which must hold token.rawSize() bytes:
+// unescaping never makes a string longer.
+bool UnescapeString(const StringToken &token, char *out, size_t *out_size,
+                    std::string *out_error) {
+  char *write = out;
+  Cursor cursor{token.start, token.close};
+  while (cursor.p < token.close) {
+    const char ch = *cursor.p++;
+    if (ch != '\\') {
+      *write++ = ch;
+      continue;
+    }
+    const char escape = *cursor.p++;
     switch (escape) {
     case '"':
     case '\\':
     case '/':
-      result.push_back(escape);
+      *write++ = escape;
       break;
     case 'b':
-      result.push_back('\b');
+      *write++ = '\b';
       break;
     case 'f':
-      result.push_back('\f');
+      *write++ = '\f';
       break;
     case 'n':
-      result.push_back('\n');
+      *write++ = '\n';
       break;
     case 'r':
-      result.push_back('\r');
+      *write++ = '\r';
       break;
     case 't':
-      result.push_back('\t');
+      *write++ = '\t';
       break;
     case 'u': {
       uint32_t codepoint = 0;
-      if (!ParseUnicodeEscape(cursor, &codepoint)) {
-        if (out_error) {
-          *out_error = "Invalid JSON unicode escape";
-        }
+      if (!ParseUnicodeEscape(&cursor, &codepoint)) {
+        SetError(out_error, "Invalid JSON unicode escape");
         return false;
       }
-      AppendUtf8(&result, codepoint);
+      write = AppendUtf8(write, codepoint);
       break;
     }
     default:
-      if (out_error) {
-        *out_error = "Invalid JSON string escape";
-      }
+      SetError(out_error, "Invalid JSON string escape");
       return false;
     }
   }
-
-  if (out_error) {
-    *out_error = "Unexpected end of input in JSON string";
-  }
-  return false;
+  *out_size = static_cast<size_t>(write - out);
+  return true;
 }
 
-bool ParseNumber(Cursor *cursor, double *out_number, std::string *out_error) {
+bool ScanNumber(Cursor *cursor, double *out, std::string *out_error) {
   SkipWhitespace(cursor);
   if (cursor->p >= cursor->end) {
-    if (out_error) {
-      *out_error = "Unexpected end of input while parsing JSON number";
-    }
+    SetError(out_error, "Unexpected end of input while parsing JSON number");
     return false;
   }
 
   const char *start = cursor->p;
   const char *p = start;
+  const char *end = cursor->end;
 
   if (*p == '-' || *p == '+') {
     ++p;
   }
 
   bool saw_digit = false;
-  while (p < cursor->end && std::isdigit(static_cast<unsigned char>(*p)) != 0) {
+  while (p < end && std::isdigit(static_cast<unsigned char>(*p)) != 0) {
     saw_digit = true;
     ++p;
   }
 
-  if (p < cursor->end && *p == '.') {
+  if (p < end && *p == '.') {
     ++p;
-    while (p < cursor->end &&
-           std::isdigit(static_cast<unsigned char>(*p)) != 0) {
+    while (p < end && std::isdigit(static_cast<unsigned char>(*p)) != 0) {
       saw_digit = true;
       ++p;
     }
   }
 
   if (!saw_digit) {
-    if (out_error) {
-      *out_error = "Invalid JSON number";
-    }
+    SetError(out_error, "Invalid JSON number");
     return false;
   }
 
-  if (p < cursor->end && (*p == 'e' || *p == 'E')) {
+  if (p < end && (*p == 'e' || *p == 'E')) {
     ++p;
-    if (p < cursor->end && (*p == '+' || *p == '-')) {
+    if (p < end && (*p == '+' || *p == '-')) {
       ++p;
     }
     bool saw_exp_digit = false;
-    while (p < cursor->end &&
-           std::isdigit(static_cast<unsigned char>(*p)) != 0) {
+    while (p < end && std::isdigit(static_cast<unsigned char>(*p)) != 0) {
       saw_exp_digit = true;
       ++p;
     }
     if (!saw_exp_digit) {
-      if (out_error) {
-        *out_error = "Invalid JSON exponent";
-      }
+      SetError(out_error, "Invalid JSON exponent");
       return false;
     }
   }
 
-  std::string text(start, p);
+  // strtod needs a terminated copy; settings numbers fit on the stack.
+  const size_t length = static_cast<size_t>(p - start);
+  char stack_buffer[64];
+  std::string heap_buffer;
+  const char *text = stack_buffer;
+  if (length < sizeof(stack_buffer)) {
+    std::memcpy(stack_buffer, start, length);
+    stack_buffer[length] = '\0';
+  } else {
+    heap_buffer.assign(start, length);
+    text = heap_buffer.c_str();
+  }
   char *parse_end = nullptr;
-  const double value = std::strtod(text.c_str(), &parse_end);
+  const double value = std::strtod(text, &parse_end);
   if (!parse_end || *parse_end != '\0' || !std::isfinite(value)) {
-    if (out_error) {
-      *out_error = "Invalid JSON number";
-    }
+    SetError(out_error, "Invalid JSON number");
     return false;
   }
 
   cursor->p = p;
-  *out_number = value;
+  *out = value;
   return true;
 }
 
-bool ParseValue(Cursor *cursor, Value *out_value, std::string *out_error);
+} // namespace
 
-bool ParseArray(Cursor *cursor, Value *out_value, std::string *out_error) {
-  if (!Consume(cursor, '[')) {
-    if (out_error) {
-      *out_error = "Expected '[' to start JSON array";
-    }
+// Open-addressed slots hold a member index plus one; zero marks an empty
+// slot. Null for objects too small to be worth indexing.
+struct ObjectNode {
+  const Member *members = nullptr;
+  const uint32_t *slots = nullptr;
+  uint32_t slot_mask = 0;
+};
+
+// Children are collected on scratch stacks and copied into the arena once
+// their container closes, so each array or object is one exact-size block.
+class Parser {
+public:
+  Parser(Arena *arena, const char *begin, const char *end, std::string *error)
+      : arena_(arena), cursor_{begin, end}, error_(error) {
+    elements_.reserve(kScratchReserve);
+    members_.reserve(kScratchReserve);
+  }
+
+  bool parseDocument(Value *out);
+
+private:
+  bool parseValue(Value *out);
+  bool parseString(std::string_view *out);
+  bool parseArray(Value *out);
+  bool parseObject(Value *out);
+  const ObjectNode *makeObject(const Member *members, uint32_t count);
+
+  Arena *arena_;
+  Cursor cursor_;
+  std::string *error_;
+  std::vector<Value> elements_;
+  std::vector<Member> members_;
+};
+
+bool Parser::parseDocument(Value *out) {
+  if (!parseValue(out)) {
+    return false;
+  }
+  SkipWhitespace(&cursor_);
+  if (cursor_.p != cursor_.end) {
+    SetError(error_, "Unexpected trailing characters after JSON value");
+    return false;
+  }
+  return true;
+}
+
+bool Parser::parseString(std::string_view *out) {
+  StringToken token;
+  if (!ScanString(&cursor_, &token, error_)) {
+    return false;
+  }
+  if (!token.escaped) {
+    *out = std::string_view(token.start, token.rawSize());
+    return true;
+  }
+  char *result = arena_->allocateArray<char>(token.rawSize());
+  size_t size = 0;
+  if (!UnescapeString(token, result, &size, error_)) {
+    return false;
+  }
+  *out = std::string_view(result, size);
+  return true;
+}
+
+bool Parser::parseArray(Value *out) {
+  if (!Consume(&cursor_, '[')) {
+    SetError(error_, "Expected '[' to start JSON array");
     return false;
   }
 
   Value result;
-  result.type = Type::Array;
+  result.type_ = Type::Array;
 
-  SkipWhitespace(cursor);
-  if (cursor->p < cursor->end && *cursor->p == ']') {
-    ++cursor->p;
-    *out_value = std::move(result);
+  SkipWhitespace(&cursor_);
+  if (cursor_.p < cursor_.end && *cursor_.p == ']') {
+    ++cursor_.p;
+    *out = result;
     return true;
   }
 
+  const size_t base = elements_.size();
   while (true) {
     Value element;
-    if (!ParseValue(cursor, &element, out_error)) {
+    if (!parseValue(&element)) {
       return false;
     }
-    result.array_values.push_back(std::move(element));
+    elements_.push_back(element);
 
-    SkipWhitespace(cursor);
-    if (cursor->p >= cursor->end) {
-      if (out_error) {
-        *out_error = "Unexpected end of input in JSON array";
-      }
+    SkipWhitespace(&cursor_);
+    if (cursor_.p >= cursor_.end) {
+      SetError(error_, "Unexpected end of input in JSON array");
       return false;
     }
-    if (*cursor->p == ',') {
-      ++cursor->p;
+    if (*cursor_.p == ',') {
+      ++cursor_.p;
       continue;
     }
-    if (*cursor->p == ']') {
-      ++cursor->p;
-      *out_value = std::move(result);
-      return true;
-    }
-    if (out_error) {
-      *out_error = "Expected ',' or ']' in JSON array";
+    if (*cursor_.p == ']') {
+      ++cursor_.p;
+      break;
     }
+    SetError(error_, "Expected ',' or ']' in JSON array");
     return false;
   }
+
+  const size_t count = elements_.size() - base;
+  Value *elements = arena_->allocateArray<Value>(count);
+  std::uninitialized_copy(elements_.begin() + static_cast<std::ptrdiff_t>(base),
+                          elements_.end(), elements);
+  elements_.resize(base);
+  result.size_ = static_cast<uint32_t>(count);
+  result.elements_ = elements;
+  *out = result;
+  return true;
 }
 
-bool ParseObject(Cursor *cursor, Value *out_value, std::string *out_error) {
-  if (!Consume(cursor, '{')) {
-    if (out_error) {
-      *out_error = "Expected '{' to start JSON object";
+const ObjectNode *Parser::makeObject(const Member *members, uint32_t count) {
+  auto *object = new (arena_->allocateArray<ObjectNode>(1)) ObjectNode{};
+  object->members = members;
+  if (count <= kIndexedObjectMinMembers) {
+    return object;
+  }
+
+  uint32_t slot_count = 1;
+  while (slot_count < 2 * count) {
+    slot_count <<= 1;
+  }
+  uint32_t *slots = arena_->allocateArray<uint32_t>(slot_count);
+  std::fill(slots, slots + slot_count, 0u);
+  const uint32_t mask = slot_count - 1;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t slot = HashKey(members[i].key) & mask;
+    // Duplicate keys keep the first member, as a scan would.
+    while (slots[slot] != 0 && members[slots[slot] - 1].key != members[i].key) {
+      slot = (slot + 1) & mask;
+    }
+    if (slots[slot] == 0) {
+      slots[slot] = i + 1;
     }
+  }
+  object->slots = slots;
+  object->slot_mask = mask;
+  return object;
+}
+
+bool Parser::parseObject(Value *out) {
+  if (!Consume(&cursor_, '{')) {
+    SetError(error_, "Expected '{' to start JSON object");
     return false;
   }
 
   Value result;
-  result.type = Type::Object;
+  result.type_ = Type::Object;
+  result.object_ = nullptr;
 
-  SkipWhitespace(cursor);
-  if (cursor->p < cursor->end && *cursor->p == '}') {
-    ++cursor->p;
-    *out_value = std::move(result);
+  SkipWhitespace(&cursor_);
+  if (cursor_.p < cursor_.end && *cursor_.p == '}') {
+    ++cursor_.p;
+    *out = result;
     return true;
   }
 
+  const size_t base = members_.size();
   while (true) {
-    std::string key;
-    if (!ParseString(cursor, &key, out_error)) {
+    Member member;
+    if (!parseString(&member.key)) {
       return false;
     }
-    if (!Consume(cursor, ':')) {
-      if (out_error) {
-        *out_error = "Expected ':' after JSON object key";
-      }
+    if (!Consume(&cursor_, ':')) {
+      SetError(error_, "Expected ':' after JSON object key");
       return false;
     }
-
-    Value value;
-    if (!ParseValue(cursor, &value, out_error)) {
+    if (!parseValue(&member.value)) {
       return false;
     }
-    result.object_values.emplace_back(std::move(key), std::move(value));
+    members_.push_back(member);
 
-    SkipWhitespace(cursor);
-    if (cursor->p >= cursor->end) {
-      if (out_error) {
-        *out_error = "Unexpected end of input in JSON object";
-      }
+    SkipWhitespace(&cursor_);
+    if (cursor_.p >= cursor_.end) {
+      SetError(error_, "Unexpected end of input in JSON object");
       return false;
     }
-    if (*cursor->p == ',') {
-      ++cursor->p;
+    if (*cursor_.p == ',') {
+      ++cursor_.p;
       continue;
     }
-    if (*cursor->p == '}') {
-      ++cursor->p;
-      *out_value = std::move(result);
-      return true;
-    }
-    if (out_error) {
-      *out_error = "Expected ',' or '}' in JSON object";
+    if (*cursor_.p == '}') {
+      ++cursor_.p;
+      break;
     }
+    SetError(error_, "Expected ',' or '}' in JSON object");
     return false;
   }
-}
 
-bool ParseLiteral(Cursor *cursor, const char *literal) {
-  const char *p = literal;
-  while (*p != '\0') {
-    if (cursor->p >= cursor->end || *cursor->p != *p) {
-      return false;
-    }
-    ++cursor->p;
-    ++p;
-  }
+  const size_t count = members_.size() - base;
+  Member *members = arena_->allocateArray<Member>(count);
+  std::uninitialized_copy(members_.begin() + static_cast<std::ptrdiff_t>(base),
+                          members_.end(), members);
+  members_.resize(base);
+  result.size_ = static_cast<uint32_t>(count);
+  result.object_ = makeObject(members, result.size_);
+  *out = result;
   return true;
 }
 
-bool ParseValue(Cursor *cursor, Value *out_value, std::string *out_error) {
-  SkipWhitespace(cursor);
-  if (cursor->p >= cursor->end) {
-    if (out_error) {
-      *out_error = "Unexpected end of input while parsing JSON value";
-    }
+bool Parser::parseValue(Value *out) {
+  SkipWhitespace(&cursor_);
+  if (cursor_.p >= cursor_.end) {
+    SetError(error_, "Unexpected end of input while parsing JSON value");
     return false;
   }
 
-  switch (*cursor->p) {
+  Value result;
+  switch (*cursor_.p) {
   case '{':
-    return ParseObject(cursor, out_value, out_error);
+    return parseObject(out);
   case '[':
-    return ParseArray(cursor, out_value, out_error);
+    return parseArray(out);
   case '"': {
-    std::string value;
-    if (!ParseString(cursor, &value, out_error)) {
+    std::string_view text;
+    if (!parseString(&text)) {
       return false;
     }
-    out_value->type = Type::String;
-    out_value->string_value = std::move(value);
-    out_value->object_values.clear();
-    out_value->array_values.clear();
+    result.type_ = Type::String;
+    result.size_ = static_cast<uint32_t>(text.size());
+    result.chars_ = text.data();
+    *out = result;
     return true;
   }
   case 't':
-    if (!ParseLiteral(cursor, "true")) {
+    if (!ParseLiteral(&cursor_, "true")) {
       break;
     }
-    out_value->type = Type::Bool;
-    out_value->bool_value = true;
-    out_value->object_values.clear();
-    out_value->array_values.clear();
+    result.type_ = Type::Bool;
+    result.bool_ = true;
+    *out = result;
     return true;
   case 'f':
-    if (!ParseLiteral(cursor, "false")) {
+    if (!ParseLiteral(&cursor_, "false")) {
       break;
     }
-    out_value->type = Type::Bool;
-    out_value->bool_value = false;
-    out_value->object_values.clear();
-    out_value->array_values.clear();
+    result.type_ = Type::Bool;
+    *out = result;
     return true;
   case 'n':
-    if (!ParseLiteral(cursor, "null")) {
+    if (!ParseLiteral(&cursor_, "null")) {
       break;
     }
-    *out_value = Value{};
+    *out = result;
     return true;
   default:
     break;
   }
 
-  double number_value = 0.0;
-  if (!ParseNumber(cursor, &number_value, out_error)) {
+  double number = 0.0;
+  if (!ScanNumber(&cursor_, &number, error_)) {
     return false;
   }
-  out_value->type = Type::Number;
-  out_value->number_value = number_value;
-  out_value->object_values.clear();
-  out_value->array_values.clear();
-  out_value->string_value.clear();
+  result.type_ = Type::Number;
+  result.number_ = number;
+  *out = result;
   return true;
 }
 
-} // namespace
+std::string_view Value::AsString() const {
+  if (type_ != Type::String) {
+    return {};
+  }
+  return std::string_view(chars_, size_);
+}
+
+Span<Value> Value::Elements() const {
+  if (type_ != Type::Array || size_ == 0) {
+    return {};
+  }
+  return Span<Value>(elements_, size_);
+}
+
+Span<Member> Value::Members() const {
+  if (type_ != Type::Object || size_ == 0) {
+    return {};
+  }
+  return Span<Member>(object_->members, size_);
+}
 
 const Value *Value::Find(std::string_view key) const {
-  if (type != Type::Object) {
+  if (type_ != Type::Object || size_ == 0) {
+    return nullptr;
+  }
+  const Member *members = object_->members;
+  if (object_->slots) {
+    const uint32_t mask = object_->slot_mask;
+    for (uint32_t slot = HashKey(key) & mask; object_->slots[slot] != 0;
+         slot = (slot + 1) & mask) {
+      const Member &member = members[object_->slots[slot] - 1];
+      if (member.key == key) {
+        return &member.value;
+      }
+    }
     return nullptr;
   }
-  for (const auto &entry : object_values) {
-    if (entry.first == key) {
-      return &entry.second;
+  for (uint32_t i = 0; i < size_; ++i) {
+    if (members[i].key == key) {
+      return &members[i].value;
     }
   }
   return nullptr;
 }
 
-bool Parse(std::string_view text, Value *out_value, std::string *out_error) {
-  if (!out_value) {
-    if (out_error) {
-      *out_error = "Output JSON value is required";
+void *Arena::allocate(size_t size, size_t alignment) {
+  size_t padding = 0;
+  if (cursor_) {
+    const auto address = reinterpret_cast<uintptr_t>(cursor_);
+    padding = (alignment - address % alignment) % alignment;
+  }
+  if (!cursor_ || static_cast<size_t>(end_ - cursor_) < padding + size) {
+    const size_t block_size = (std::max)(next_block_size_, size + alignment);
+    blocks_.push_back(std::make_unique<char[]>(block_size));
+    cursor_ = blocks_.back().get();
+    end_ = cursor_ + block_size;
+    bytes_reserved_ += block_size;
+    next_block_size_ = (std::min)(block_size * 2, kArenaMaxBlockSize);
+    const auto address = reinterpret_cast<uintptr_t>(cursor_);
+    padding = (alignment - address % alignment) % alignment;
+  }
+  char *result = cursor_ + padding;
+  cursor_ = result + size;
+  bytes_used_ += size;
+  return result;
+}
+
+void Arena::reserve(size_t bytes) {
+  next_block_size_ = (std::max)(next_block_size_, bytes);
+}
+
+bool Parse(std::string_view text, Document *out_document,
+           std::string *out_error) {
+  if (!out_document) {
+    SetError(out_error, "Output JSON value is required");
+    return false;
+  }
+
+  // Room for the text and, for typical documents, all of its nodes.
+  Document document;
+  document.arena_.reserve(3 * text.size() + 256);
+  char *copy = document.arena_.allocateArray<char>(text.size() + 1);
+  std::memcpy(copy, text.data(), text.size());
+  copy[text.size()] = '\0';
+
+  Parser parser(&document.arena_, copy, copy + text.size(), out_error);
+  if (!parser.parseDocument(&document.root_)) {
+    return false;
+  }
+  *out_document = std::move(document);
+  if (out_error) {
+    out_error->clear();
+  }
+  return true;
+}
+
+// Reports values to a Handler as they are parsed; the grammar and errors
+// match Parser.
+class EventParser {
+public:
+  EventParser(const char *begin, const char *end, Handler *handler,
+              std::string *scratch, std::string *error)
+      : cursor_{begin, end}, handler_(handler), scratch_(scratch),
+        error_(error) {}
+
+  bool parseDocument();
+
+private:
+  bool parseValue();
+  bool parseString(std::string_view *out);
+  bool parseArray();
+  bool parseObject();
+  bool stopped();
+
+  Cursor cursor_;
+  Handler *handler_;
+  std::string *scratch_;
+  std::string *error_;
+};
+
+bool EventParser::stopped() {
+  SetError(error_, "JSON reading stopped by handler");
+  return false;
+}
+
+bool EventParser::parseDocument() {
+  if (!parseValue()) {
+    return false;
+  }
+  SkipWhitespace(&cursor_);
+  if (cursor_.p != cursor_.end) {
+    SetError(error_, "Unexpected trailing characters after JSON value");
+    return false;
+  }
+  return true;
+}
+
+bool EventParser::parseString(std::string_view *out) {
+  StringToken token;
+  if (!ScanString(&cursor_, &token, error_)) {
+    return false;
+  }
+  if (!token.escaped) {
+    *out = std::string_view(token.start, token.rawSize());
+    return true;
+  }
+  scratch_->resize(token.rawSize());
+  size_t size = 0;
+  if (!UnescapeString(token, &(*scratch_)[0], &size, error_)) {
+    return false;
+  }
+  *out = std::string_view(scratch_->data(), size);
+  return true;
+}
+
+bool EventParser::parseArray() {
+  if (!Consume(&cursor_, '[')) {
+    SetError(error_, "Expected '[' to start JSON array");
+    return false;
+  }
+  if (!handler_->beginArray()) {
+    return stopped();
+  }
+
+  SkipWhitespace(&cursor_);
+  if (cursor_.p < cursor_.end && *cursor_.p == ']') {
+    ++cursor_.p;
+    return handler_->endArray() || stopped();
+  }
+
+  while (true) {
+    if (!parseValue()) {
+      return false;
+    }
+
+    SkipWhitespace(&cursor_);
+    if (cursor_.p >= cursor_.end) {
+      SetError(error_, "Unexpected end of input in JSON array");
+      return false;
+    }
+    if (*cursor_.p == ',') {
+      ++cursor_.p;
+      continue;
     }
+    if (*cursor_.p == ']') {
+      ++cursor_.p;
+      return handler_->endArray() || stopped();
+    }
+    SetError(error_, "Expected ',' or ']' in JSON array");
+    return false;
+  }
+}
+
+bool EventParser::parseObject() {
+  if (!Consume(&cursor_, '{')) {
+    SetError(error_, "Expected '{' to start JSON object");
     return false;
   }
+  if (!handler_->beginObject()) {
+    return stopped();
+  }
+
+  SkipWhitespace(&cursor_);
+  if (cursor_.p < cursor_.end && *cursor_.p == '}') {
+    ++cursor_.p;
+    return handler_->endObject() || stopped();
+  }
+
+  while (true) {
+    std::string_view key;
+    if (!parseString(&key)) {
+      return false;
+    }
+    if (!handler_->key(key)) {
+      return stopped();
+    }
+    if (!Consume(&cursor_, ':')) {
+      SetError(error_, "Expected ':' after JSON object key");
+      return false;
+    }
+    if (!parseValue()) {
+      return false;
+    }
+
+    SkipWhitespace(&cursor_);
+    if (cursor_.p >= cursor_.end) {
+      SetError(error_, "Unexpected end of input in JSON object");
+      return false;
+    }
+    if (*cursor_.p == ',') {
+      ++cursor_.p;
+      continue;
+    }
+    if (*cursor_.p == '}') {
+      ++cursor_.p;
+      return handler_->endObject() || stopped();
+    }
+    SetError(error_, "Expected ',' or '}' in JSON object");
+    return false;
+  }
+}
 
-  Cursor cursor{text.data(), text.data() + text.size()};
-  Value value;
-  if (!ParseValue(&cursor, &value, out_error)) {
+bool EventParser::parseValue() {
+  SkipWhitespace(&cursor_);
+  if (cursor_.p >= cursor_.end) {
+    SetError(error_, "Unexpected end of input while parsing JSON value");
     return false;
   }
 
-  SkipWhitespace(&cursor);
-  if (cursor.p != cursor.end) {
-    if (out_error) {
-      *out_error = "Unexpected trailing characters after JSON value";
+  Value result;
+  switch (*cursor_.p) {
+  case '{':
+    return parseObject();
+  case '[':
+    return parseArray();
+  case '"': {
+    std::string_view text;
+    if (!parseString(&text)) {
+      return false;
+    }
+    result.type_ = Type::String;
+    result.size_ = static_cast<uint32_t>(text.size());
+    result.chars_ = text.data();
+    return handler_->scalar(result) || stopped();
+  }
+  case 't':
+    if (!ParseLiteral(&cursor_, "true")) {
+      break;
     }
+    result.type_ = Type::Bool;
+    result.bool_ = true;
+    return handler_->scalar(result) || stopped();
+  case 'f':
+    if (!ParseLiteral(&cursor_, "false")) {
+      break;
+    }
+    result.type_ = Type::Bool;
+    return handler_->scalar(result) || stopped();
+  case 'n':
+    if (!ParseLiteral(&cursor_, "null")) {
+      break;
+    }
+    return handler_->scalar(result) || stopped();
+  default:
+    break;
+  }
+
+  double number = 0.0;
+  if (!ScanNumber(&cursor_, &number, error_)) {
     return false;
   }
+  result.type_ = Type::Number;
+  result.number_ = number;
+  return handler_->scalar(result) || stopped();
+}
 
-  *out_value = std::move(value);
+bool Reader::read(std::string_view text, Handler *handler,
+                  std::string *out_error) {
+  if (!handler) {
+    SetError(out_error, "JSON handler is required");
+    return false;
+  }
+  EventParser parser(text.data(), text.data() + text.size(), handler,
+                     &scratch_, out_error);
+  if (!parser.parseDocument()) {
+    return false;
+  }
   if (out_error) {
     out_error->clear();
   }
   return true;
 }
 
-std::string EscapeString(std::string_view input) {
-  std::string output;
-  output.reserve(input.size() + 8);
+void Writer::clear() {
+  text_.clear();
+  depth_ = 0;
+  after_key_ = false;
+}
+
+void Writer::newline(size_t depth) {
+  text_.push_back('\n');
+  text_.append(2 * depth, ' ');
+}
+
+void Writer::beforeValue() {
+  if (after_key_) {
+    after_key_ = false;
+    return;
+  }
+  if (depth_ == 0) {
+    return;
+  }
+  Frame &frame = frames_[(std::min)(depth_, kMaxDepth) - 1];
+  if (!frame.empty) {
+    text_.push_back(',');
+  }
+  if (frame.multiline) {
+    newline(depth_);
+  } else if (!frame.empty && pretty_) {
+    text_.push_back(' ');
+  }
+  frame.empty = false;
+}
+
+void Writer::begin(char bracket, bool multiline) {
+  beforeValue();
+  text_.push_back(bracket);
+  ++depth_;
+  // Deeper levels share the last frame; settings and stats stay shallow.
+  frames_[(std::min)(depth_, kMaxDepth) - 1] =
+      Frame{multiline && pretty_, true};
+}
+
+void Writer::end(char bracket) {
+  if (depth_ == 0) {
+    return;
+  }
+  const Frame &frame = frames_[(std::min)(depth_, kMaxDepth) - 1];
+  --depth_;
+  if (frame.multiline && !frame.empty) {
+    newline(depth_);
+  }
+  text_.push_back(bracket);
+}
+
+void Writer::beginObject(bool multiline) { begin('{', multiline); }
+void Writer::endObject() { end('}'); }
+void Writer::beginArray(bool multiline) { begin('[', multiline); }
+void Writer::endArray() { end(']'); }
 
+void Writer::key(std::string_view name) {
+  beforeValue();
+  text_.push_back('"');
+  AppendEscaped(&text_, name);
+  text_.append(pretty_ ? "\": " : "\":");
+  after_key_ = true;
+}
+
+void Writer::stringValue(std::string_view value) {
+  beforeValue();
+  text_.push_back('"');
+  AppendEscaped(&text_, value);
+  text_.push_back('"');
+}
+
+void Writer::numberValue(double value) {
+  beforeValue();
+  if (!std::isfinite(value)) {
+    text_.append("null");
+    return;
+  }
+  char buffer[32];
+  const int size = std::snprintf(buffer, sizeof(buffer), "%.6g", value);
+  text_.append(buffer, static_cast<size_t>(size));
+}
+
+void Writer::unsignedValue(uint64_t value) {
+  beforeValue();
+  // Counters are written far more often than anything else; snprintf()
+  // would cost several times as much.
+  char buffer[20];
+  char *digits = buffer + sizeof(buffer);
+  do {
+    *--digits = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  text_.append(digits, static_cast<size_t>(buffer + sizeof(buffer) - digits));
+}
+
+void Writer::boolValue(bool value) {
+  beforeValue();
+  text_.append(value ? "true" : "false");
+}
+
+void Writer::nullValue() {
+  beforeValue();
+  text_.append("null");
+}
+
+void AppendEscaped(std::string *out, std::string_view input) {
   static const char kHex[] = "0123456789ABCDEF";
-  for (const unsigned char ch : input) {
+  const char *p = input.data();
+  const char *end = p + input.size();
+  while (p < end) {
+    // Runs that need no escaping, which is nearly everything, are copied
+    // in one append.
+    const char *run = p;
+    while (p < end && static_cast<unsigned char>(*p) >= 0x20 && *p != '"' &&
+           *p != '\\') {
+      ++p;
+    }
+    out->append(run, static_cast<size_t>(p - run));
+    if (p == end) {
+      break;
+    }
+
+    const unsigned char ch = static_cast<unsigned char>(*p++);
     switch (ch) {
     case '\\':
-      output += "\\\\";
+      out->append("\\\\");
       break;
     case '"':
-      output += "\\\"";
+      out->append("\\\"");
       break;
     case '\b':
-      output += "\\b";
+      out->append("\\b");
       break;
     case '\f':
-      output += "\\f";
+      out->append("\\f");
       break;
     case '\n':
-      output += "\\n";
+      out->append("\\n");
       break;
     case '\r':
-      output += "\\r";
+      out->append("\\r");
       break;
     case '\t':
-      output += "\\t";
+      out->append("\\t");
       break;
     default:
-      if (ch < 0x20) {
-        output += "\\u00";
-        output.push_back(kHex[(ch >> 4) & 0x0F]);
-        output.push_back(kHex[ch & 0x0F]);
-      } else {
-        output.push_back(static_cast<char>(ch));
-      }
+      out->append("\\u00");
+      out->push_back(kHex[(ch >> 4) & 0x0F]);
+      out->push_back(kHex[ch & 0x0F]);
       break;
     }
   }
+}
 
+std::string EscapeString(std::string_view input) {
+  std::string output;
+  output.reserve(input.size() + 8);
+  AppendEscaped(&output, input);
   return output;
 }
 
@@ -0,0 +1,127 @@
+#include "xp2gdl90/stage_timing.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace xp2gdl90 {
+namespace {
+
+constexpr size_t kSubBuckets = 4;
+
+int HighestBit(uint64_t value) {
+  int bit = 0;
+  for (int shift = 32; shift > 0; shift /= 2) {
+    if (value >> shift) {
+      value >>= shift;
+      bit += shift;
+    }
+  }
+  return bit;
+}
+
+} // namespace
+
+const char *StageName(Stage stage) {
+  switch (stage) {
+  case Stage::CLOCK:
+    return "Clock";
+  case Stage::DISCOVERY:
+    return "Discovery";
+  case Stage::SIM_READ:
+    return "Sim read";
+  case Stage::TRAFFIC:
+    return "Traffic";
+  case Stage::ENCODE:
+    return "Encode";
+  case Stage::SEND:
+    return "Send";
+  }
+  return "Unknown";
+}
+
+const char *StageKey(Stage stage) {
+  switch (stage) {
+  case Stage::CLOCK:
+    return "clock";
+  case Stage::DISCOVERY:
+    return "discovery";
+  case Stage::SIM_READ:
+    return "sim_read";
+  case Stage::TRAFFIC:
+    return "traffic";
+  case Stage::ENCODE:
+    return "encode";
+  case Stage::SEND:
+    return "send";
+  }
+  return "unknown";
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t ns) {
+  if (ns < kSubBuckets) {
+    return static_cast<size_t>(ns);
+  }
+  const int bit = HighestBit(ns);
+  const size_t sub = static_cast<size_t>(ns >> (bit - 2)) & (kSubBuckets - 1);
+  const size_t index = static_cast<size_t>(bit - 1) * kSubBuckets + sub;
+  return (std::min)(index, LATENCY_HISTOGRAM_BUCKETS - 1);
+}
+
+uint64_t LatencyHistogram::bucketUpperNs(size_t bucket) {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+  const int bit = static_cast<int>(bucket / kSubBuckets) + 1;
+  const uint64_t sub = bucket % kSubBuckets;
+  const uint64_t step = uint64_t{1} << (bit - 2);
+  return (kSubBuckets + sub) * step + step - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+  ++buckets_[bucketIndex(ns)];
+  ++count_;
+  max_ns_ = (std::max)(max_ns_, ns);
+}
+
+uint64_t LatencyHistogram::percentileNs(double fraction) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  const double clamped = (std::min)(1.0, (std::max)(0.0, fraction));
+  const uint64_t rank = (std::max)(
+      uint64_t{1},
+      static_cast<uint64_t>(std::ceil(clamped * static_cast<double>(count_))));
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < buckets_.size(); ++bucket) {
+    seen += buckets_[bucket];
+    if (seen >= rank) {
+      return (std::min)(bucketUpperNs(bucket), max_ns_);
+    }
+  }
+  return max_ns_;
+}
+
+void StageTimings::endTick() {
+  last_tick_ns_ = 0;
+  for (size_t i = 0; i < STAGE_COUNT; ++i) {
+    if (ran_mask_ & (1u << i)) {
+      histograms_[i].record(tick_ns_[i]);
+      last_tick_ns_ += tick_ns_[i];
+    }
+    tick_ns_[i] = 0;
+  }
+  ran_mask_ = 0;
+  ++ticks_;
+}
+
+void StageTimings::reset() {
+  for (LatencyHistogram &histogram : histograms_) {
+    histogram.reset();
+  }
+  tick_ns_.fill(0);
+  ran_mask_ = 0;
+  ticks_ = 0;
+  last_tick_ns_ = 0;
+}
+
+} // namespace xp2gdl90
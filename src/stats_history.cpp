@@ -0,0 +1,80 @@
+#include "xp2gdl90/stats_history.h"
+
+#include <algorithm>
+
+namespace xp2gdl90 {
+
+namespace {
+
+float Rate(uint64_t now, uint64_t before, double elapsed) {
+  return static_cast<float>(static_cast<double>(now - before) / elapsed);
+}
+
+} // namespace
+
+const char *StatsSeriesName(StatsSeries series) {
+  switch (series) {
+  case StatsSeries::FRAMES_PER_S:
+    return "Frames/s";
+  case StatsSeries::BYTES_PER_S:
+    return "Bytes/s";
+  case StatsSeries::TARGETS:
+    return "Targets";
+  case StatsSeries::TICK_P99_US:
+    return "Tick p99 (us)";
+  case StatsSeries::SEND_ERRORS:
+    return "Send errors/s";
+  }
+  return "Unknown";
+}
+
+bool StatsHistory::update(double now, const StatsCounters &counters) {
+  if (has_baseline_ && now >= last_time_ &&
+      now - last_time_ < STATS_HISTORY_INTERVAL_S) {
+    return false;
+  }
+  const bool sample = has_baseline_ && now > last_time_ &&
+                      counters.frames >= last_.frames &&
+                      counters.bytes >= last_.bytes &&
+                      counters.send_errors >= last_.send_errors;
+  if (sample) {
+    const double elapsed = now - last_time_;
+    const std::array<float, STATS_SERIES_COUNT> values = {
+        Rate(counters.frames, last_.frames, elapsed),
+        Rate(counters.bytes, last_.bytes, elapsed),
+        static_cast<float>(counters.targets),
+        static_cast<float>(tick_ns_.percentileNs(0.99)) / 1000.0f,
+        Rate(counters.send_errors, last_.send_errors, elapsed),
+    };
+    for (size_t i = 0; i < STATS_SERIES_COUNT; ++i) {
+      values_[i][head_] = values[i];
+    }
+    head_ = (head_ + 1) % STATS_HISTORY_SAMPLES;
+    size_ = (std::min)(size_ + 1, STATS_HISTORY_SAMPLES);
+  }
+  has_baseline_ = true;
+  last_time_ = now;
+  last_ = counters;
+  tick_ns_.reset();
+  return sample;
+}
+
+void StatsHistory::reset() { *this = StatsHistory{}; }
+
+float StatsHistory::value(StatsSeries series, size_t i) const {
+  return data(series)[(offset() + i) % STATS_HISTORY_SAMPLES];
+}
+
+float StatsHistory::latest(StatsSeries series) const {
+  return size_ > 0 ? value(series, size_ - 1) : 0.0f;
+}
+
+float StatsHistory::peak(StatsSeries series) const {
+  float result = 0.0f;
+  for (size_t i = 0; i < size_; ++i) {
+    result = (std::max)(result, value(series, i));
+  }
+  return result;
+}
+
+} // namespace xp2gdl90
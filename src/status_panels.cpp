@@ -0,0 +1,46 @@
+#include "xp2gdl90/status_panels.h"
+
+#include <cfloat>
+#include <cstdio>
+
+#include "imgui.h"
+
+namespace xp2gdl90 {
+
+void DrawStageTimings(const StageTimings &timings) {
+#if XP2GDL90_STAGE_TIMING
+  ImGui::Text("Stage time per tick (us), %llu ticks:",
+              static_cast<unsigned long long>(timings.ticks()));
+  for (size_t i = 0; i < STAGE_COUNT; ++i) {
+    const auto stage = static_cast<Stage>(i);
+    const LatencyHistogram &histogram = timings.histogram(stage);
+    ImGui::Text("%s: %llu, p50 %.1f, p99 %.1f, max %.1f", StageName(stage),
+                static_cast<unsigned long long>(histogram.count()),
+                histogram.percentileNs(0.5) / 1000.0,
+                histogram.percentileNs(0.99) / 1000.0,
+                histogram.maxNs() / 1000.0);
+  }
+#else
+  (void)timings;
+  ImGui::TextDisabled("Stage timing is compiled out");
+#endif
+}
+
+void DrawStatsHistory(const StatsHistory &history) {
+  ImGui::Text("Last %zu s:", history.size());
+  for (size_t i = 0; i < STATS_SERIES_COUNT; ++i) {
+    const auto series = static_cast<StatsSeries>(i);
+    char overlay[64];
+    std::snprintf(overlay, sizeof(overlay), "%s %.0f, max %.0f",
+                  StatsSeriesName(series), history.latest(series),
+                  history.peak(series));
+    ImGui::PushID(static_cast<int>(i));
+    ImGui::PlotLines("##history", history.data(series),
+                     static_cast<int>(history.size()),
+                     static_cast<int>(history.offset()), overlay, 0.0f,
+                     FLT_MAX, ImVec2(0.0f, 36.0f));
+    ImGui::PopID();
+  }
+}
+
+} // namespace xp2gdl90
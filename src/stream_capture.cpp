@@ -0,0 +1,305 @@
+#include "xp2gdl90/stream_capture.h"
+
+#include <cstring>
+#include <system_error>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace udp {
+
+namespace {
+
+// Nanosecond-resolution pcap, written in host byte order as the magic
+// tells readers.
+constexpr uint32_t kPcapMagic = 0xA1B23C4Du;
+constexpr uint16_t kPcapVersionMajor = 2;
+constexpr uint16_t kPcapVersionMinor = 4;
+constexpr size_t kPcapFileHeaderSize = 24;
+constexpr size_t kPcapRecordHeaderSize = 16;
+constexpr size_t kSlotSize = kPcapRecordHeaderSize + CAPTURE_RECORD_DATA;
+constexpr auto kFlushInterval = std::chrono::seconds(1);
+constexpr uint8_t kFrameFlag = 0x7E;
+
+void Put16(uint8_t *out, uint16_t value) {
+  std::memcpy(out, &value, sizeof(value));
+}
+
+void Put32(uint8_t *out, uint32_t value) {
+  std::memcpy(out, &value, sizeof(value));
+}
+
+// Length of the longest run of whole frames at the start of `data` that
+// fits in `limit` bytes, or 0 if the first frame alone is longer. Frames
+// in a packed datagram sit back to back, so a cut goes between two flags.
+size_t FrameBoundary(const uint8_t *data, size_t size, size_t limit) {
+  for (size_t cut = limit; cut >= 2; --cut) {
+    if (cut < size && data[cut - 1] == kFrameFlag && data[cut] == kFrameFlag) {
+      return cut;
+    }
+  }
+  return 0;
+}
+
+#ifdef _WIN32
+std::string LastErrorMessage(const char *prefix) {
+  return std::string(prefix) + std::to_string(GetLastError());
+}
+#else
+std::string LastErrorMessage(const char *prefix) {
+  return std::string(prefix) + std::strerror(errno);
+}
+#endif
+
+} // namespace
+
+StreamCapture::~StreamCapture() { close(); }
+
+bool StreamCapture::open(const std::string &path, size_t bytes,
+                         std::string *out_error) {
+  close();
+  if (bytes < CAPTURE_MIN_BYTES) {
+    bytes = CAPTURE_MIN_BYTES;
+  }
+  const size_t slots = (bytes - kPcapFileHeaderSize) / kSlotSize;
+  if (!mapFile(path, kPcapFileHeaderSize + slots * kSlotSize, out_error)) {
+    return false;
+  }
+  path_ = path;
+  slot_count_ = slots;
+  next_slot_ = 0;
+  sequence_ = 0;
+  records_.store(0);
+  bytes_.store(0);
+  wraps_.store(0);
+  split_.store(0);
+  flushes_.store(0);
+
+  // Every slot starts as an empty record, so the file parses as a pcap
+  // before the ring has filled.
+  Put32(base_, kPcapMagic);
+  Put16(base_ + 4, kPcapVersionMajor);
+  Put16(base_ + 6, kPcapVersionMinor);
+  Put32(base_ + 16, static_cast<uint32_t>(CAPTURE_RECORD_DATA));
+  Put32(base_ + 20, CAPTURE_LINKTYPE);
+  for (size_t i = 0; i < slot_count_; ++i) {
+    uint8_t *slot = base_ + kPcapFileHeaderSize + i * kSlotSize;
+    Put32(slot + 8, static_cast<uint32_t>(CAPTURE_RECORD_DATA));
+    Put32(slot + 12, static_cast<uint32_t>(CAPTURE_RECORD_DATA));
+  }
+
+  wall_base_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+  steady_base_ = std::chrono::steady_clock::now();
+
+  stop_requested_ = false;
+  try {
+    thread_ = std::thread(&StreamCapture::run, this);
+  } catch (const std::system_error &error) {
+    if (out_error) {
+      *out_error =
+          std::string("Capture flush thread failed to start: ") + error.what();
+    }
+    unmapFile();
+    return false;
+  }
+  return true;
+}
+
+void StreamCapture::close() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+      stop_requested_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+  if (base_) {
+    flush(true);
+    unmapFile();
+  }
+}
+
+void StreamCapture::record(const uint8_t *data, size_t size,
+                           uint32_t destination) {
+  if (!base_ || !data || size == 0) {
+    return;
+  }
+  const int64_t timestamp_ns =
+      wall_base_ns_ + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - steady_base_)
+                          .count();
+
+  size_t offset = 0;
+  while (offset < size) {
+    size_t chunk = size - offset;
+    uint8_t flags = 0;
+    if (chunk > CAPTURE_FRAME_BYTES) {
+      chunk = FrameBoundary(data + offset, chunk, CAPTURE_FRAME_BYTES);
+      if (chunk == 0) {
+        chunk = CAPTURE_FRAME_BYTES;
+        flags = CAPTURE_FLAG_SPLIT;
+        split_.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    writeSlot(data + offset, chunk, destination, flags, timestamp_ns);
+    offset += chunk;
+  }
+  bytes_.fetch_add(size, std::memory_order_relaxed);
+}
+
+void StreamCapture::writeSlot(const uint8_t *data, size_t size,
+                              uint32_t destination, uint8_t flags,
+                              int64_t timestamp_ns) {
+  uint8_t *slot = base_ + kPcapFileHeaderSize + next_slot_ * kSlotSize;
+  Put32(slot, static_cast<uint32_t>(timestamp_ns / 1000000000));
+  Put32(slot + 4, static_cast<uint32_t>(timestamp_ns % 1000000000));
+
+  CaptureRecordHeader header;
+  header.sequence = ++sequence_;
+  header.destination = static_cast<uint8_t>(destination);
+  header.flags = flags;
+  header.size = static_cast<uint16_t>(size);
+  uint8_t *record = slot + kPcapRecordHeaderSize;
+  std::memcpy(record, &header, sizeof(header));
+  std::memcpy(record + sizeof(header), data, size);
+  // Clears what a longer record left behind in this slot.
+  std::memset(record + sizeof(header) + size, 0, CAPTURE_FRAME_BYTES - size);
+
+  records_.fetch_add(1, std::memory_order_relaxed);
+  if (++next_slot_ == slot_count_) {
+    next_slot_ = 0;
+    wraps_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void StreamCapture::run() {
+  std::unique_lock<std::mutex> lock(wake_mutex_);
+  while (!stop_requested_) {
+    wake_.wait_for(lock, kFlushInterval, [this] { return stop_requested_; });
+    if (!stop_requested_) {
+      flush(false);
+    }
+  }
+}
+
+StreamCaptureStats StreamCapture::stats() const {
+  StreamCaptureStats stats;
+  stats.records = records_.load(std::memory_order_relaxed);
+  stats.bytes = bytes_.load(std::memory_order_relaxed);
+  stats.wraps = wraps_.load(std::memory_order_relaxed);
+  stats.split = split_.load(std::memory_order_relaxed);
+  stats.flushes = flushes_.load(std::memory_order_relaxed);
+  stats.slots = slot_count_;
+  return stats;
+}
+
+#ifdef _WIN32
+bool StreamCapture::mapFile(const std::string &path, size_t bytes,
+                            std::string *out_error) {
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                            FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    if (out_error) {
+      *out_error = LastErrorMessage("Cannot create capture file: ");
+    }
+    return false;
+  }
+  const uint64_t size = bytes;
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+                         static_cast<DWORD>(size >> 32),
+                         static_cast<DWORD>(size & 0xFFFFFFFFu), nullptr);
+  void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, bytes)
+                       : nullptr;
+  if (!view) {
+    if (out_error) {
+      *out_error = LastErrorMessage("Cannot map capture file: ");
+    }
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    return false;
+  }
+  file_ = file;
+  mapping_ = mapping;
+  base_ = static_cast<uint8_t *>(view);
+  mapped_bytes_ = bytes;
+  return true;
+}
+
+void StreamCapture::unmapFile() {
+  UnmapViewOfFile(base_);
+  CloseHandle(static_cast<HANDLE>(mapping_));
+  CloseHandle(static_cast<HANDLE>(file_));
+  base_ = nullptr;
+  mapping_ = nullptr;
+  file_ = nullptr;
+  mapped_bytes_ = 0;
+}
+
+void StreamCapture::flush(bool synchronous) {
+  FlushViewOfFile(base_, mapped_bytes_);
+  if (synchronous) {
+    FlushFileBuffers(static_cast<HANDLE>(file_));
+  }
+  flushes_.fetch_add(1, std::memory_order_relaxed);
+}
+#else
+bool StreamCapture::mapFile(const std::string &path, size_t bytes,
+                            std::string *out_error) {
+  const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    if (out_error) {
+      *out_error = LastErrorMessage("Cannot create capture file: ");
+    }
+    return false;
+  }
+  if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+    if (out_error) {
+      *out_error = LastErrorMessage("Cannot size capture file: ");
+    }
+    ::close(fd);
+    return false;
+  }
+  void *view =
+      ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  // The mapping keeps the file open.
+  ::close(fd);
+  if (view == MAP_FAILED) {
+    if (out_error) {
+      *out_error = LastErrorMessage("Cannot map capture file: ");
+    }
+    return false;
+  }
+  base_ = static_cast<uint8_t *>(view);
+  mapped_bytes_ = bytes;
+  return true;
+}
+
+void StreamCapture::unmapFile() {
+  ::munmap(base_, mapped_bytes_);
+  base_ = nullptr;
+  mapped_bytes_ = 0;
+}
+
+void StreamCapture::flush(bool synchronous) {
+  ::msync(base_, mapped_bytes_, synchronous ? MS_SYNC : MS_ASYNC);
+  flushes_.fetch_add(1, std::memory_order_relaxed);
+}
+#endif
+
+} // namespace udp
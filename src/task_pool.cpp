@@ -0,0 +1,174 @@
+#include "xp2gdl90/task_pool.h"
+
+#include <system_error>
+
+namespace xp2gdl90 {
+namespace {
+
+uint64_t PackChunks(uint64_t begin, uint64_t end) {
+  return (begin << 32) | end;
+}
+
+uint64_t ChunksBegin(uint64_t chunks) { return chunks >> 32; }
+
+uint64_t ChunksEnd(uint64_t chunks) { return chunks & 0xFFFFFFFFull; }
+
+} // namespace
+
+TaskPool::~TaskPool() { stop(); }
+
+bool TaskPool::start(size_t threads, std::string *out_error) {
+  stop();
+
+  lanes_ = std::make_unique<Lane[]>(threads + 1);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_requested_ = false;
+  }
+  try {
+    threads_.reserve(threads);
+    for (size_t lane = 0; lane < threads; ++lane) {
+      threads_.emplace_back(&TaskPool::threadMain, this, lane);
+    }
+  } catch (const std::system_error &error) {
+    stop();
+    if (out_error) {
+      *out_error = std::string("Pool threads failed to start: ") + error.what();
+    }
+    return false;
+  }
+  return true;
+}
+
+void TaskPool::stop() {
+  if (threads_.empty()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_requested_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+}
+
+void TaskPool::run(size_t count, size_t grain, ChunkFn fn, void *body) {
+  if (count == 0) {
+    return;
+  }
+  if (grain == 0) {
+    grain = 1;
+  }
+
+  std::lock_guard<std::mutex> run_lock(run_mutex_);
+  const size_t chunks = (count + grain - 1) / grain;
+  if (threads_.empty() || chunks == 1) {
+    for (size_t begin = 0; begin < count; begin += grain) {
+      fn(body, begin, count - begin < grain ? count : begin + grain);
+    }
+    return;
+  }
+
+  const size_t lanes = threads_.size() + 1;
+  for (size_t lane = 0; lane < lanes; ++lane) {
+    lanes_[lane].chunks.store(
+        PackChunks(chunks * lane / lanes, chunks * (lane + 1) / lanes));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fn_ = fn;
+    body_ = body;
+    count_ = count;
+    grain_ = grain;
+    job_open_ = true;
+    ++generation_;
+  }
+  wake_.notify_all();
+
+  work(lanes - 1);
+
+  // Every lane is empty now, but helpers may still be in their last chunk.
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return active_ == 0; });
+  job_open_ = false;
+}
+
+void TaskPool::threadMain(size_t lane) {
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    wake_.wait(lock, [this, seen] {
+      return stop_requested_ || (job_open_ && generation_ != seen);
+    });
+    if (stop_requested_) {
+      return;
+    }
+    seen = generation_;
+    ++active_;
+    lock.unlock();
+    work(lane);
+    lock.lock();
+    if (--active_ == 0) {
+      idle_.notify_one();
+    }
+  }
+}
+
+void TaskPool::work(size_t lane) {
+  const size_t lanes = threads_.size() + 1;
+  std::atomic<uint64_t> &own = lanes_[lane].chunks;
+  for (;;) {
+    uint64_t chunks = own.load();
+    while (ChunksBegin(chunks) < ChunksEnd(chunks)) {
+      const uint64_t begin = ChunksBegin(chunks);
+      if (own.compare_exchange_weak(chunks,
+                                    PackChunks(begin + 1, ChunksEnd(chunks)))) {
+        runChunk(static_cast<size_t>(begin));
+        chunks = own.load();
+      }
+    }
+
+    // Steal the back half of the fullest lane.
+    size_t victim = lanes;
+    uint64_t most = 0;
+    for (size_t other = 0; other < lanes; ++other) {
+      const uint64_t theirs = lanes_[other].chunks.load();
+      const uint64_t left = ChunksEnd(theirs) - ChunksBegin(theirs);
+      if (other != lane && ChunksBegin(theirs) < ChunksEnd(theirs) &&
+          left > most) {
+        victim = other;
+        most = left;
+      }
+    }
+    if (victim == lanes) {
+      return;
+    }
+    std::atomic<uint64_t> &theirs = lanes_[victim].chunks;
+    uint64_t expected = theirs.load();
+    const uint64_t begin = ChunksBegin(expected);
+    const uint64_t end = ChunksEnd(expected);
+    if (begin >= end) {
+      continue;
+    }
+    const uint64_t split = end - (end - begin + 1) / 2;
+    if (!theirs.compare_exchange_strong(expected, PackChunks(begin, split))) {
+      continue;
+    }
+    steals_.fetch_add(1, std::memory_order_relaxed);
+    // Nobody steals from an empty lane, so the store cannot lose chunks.
+    own.store(PackChunks(split + 1, end));
+    runChunk(static_cast<size_t>(split));
+  }
+}
+
+void TaskPool::runChunk(size_t chunk) {
+  const size_t begin = chunk * grain_;
+  const size_t end = count_ - begin < grain_ ? count_ : begin + grain_;
+  fn_(body_, begin, end);
+}
+
+} // namespace xp2gdl90
@@ -0,0 +1,264 @@
+#include "xp2gdl90/tcas_traffic.h"
+
+#include <cstdio>
+#include <limits>
+
+#include "xp2gdl90/traffic_support.h"
+
+namespace xp2gdl90::traffic {
+namespace {
+
+constexpr double kMinTrackSpeedMps = 0.5;
+constexpr double kRadiansToDegrees = 57.29577951308232;
+
+// Truncates toward zero and saturates; non-finite values give 0.
+template <typename Int> Int ClampToInt(double value) {
+  if (!std::isfinite(value)) {
+    return Int{0};
+  }
+  if (value <= static_cast<double>(std::numeric_limits<Int>::min())) {
+    return std::numeric_limits<Int>::min();
+  }
+  if (value >= static_cast<double>(std::numeric_limits<Int>::max())) {
+    return std::numeric_limits<Int>::max();
+  }
+  return static_cast<Int>(value);
+}
+
+double NormalizeDegrees(double degrees) {
+  double normalized = std::fmod(degrees, 360.0);
+  if (normalized < 0.0) {
+    normalized += 360.0;
+  }
+  return normalized;
+}
+
+int32_t CorrectAltitude(const TcasReportContext &context,
+                        int32_t geometric_altitude_feet) {
+  if (!std::isfinite(context.ownship_pressure_ft)) {
+    return geometric_altitude_feet;
+  }
+  return CorrectGeometricToPressureAltitude(geometric_altitude_feet,
+                                            context.ownship_geometric_ft,
+                                            context.ownship_pressure_ft);
+}
+
+} // namespace
+
+bool TcasSsrModeHasAltitude(int ssr_mode) {
+  switch (static_cast<TcasSsrMode>(ssr_mode)) {
+  case TcasSsrMode::ModeC:
+  case TcasSsrMode::Ground:
+  case TcasSsrMode::TaOnly:
+  case TcasSsrMode::TaRa:
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool TcasSsrModeIndicatesGround(int ssr_mode) {
+  return static_cast<TcasSsrMode>(ssr_mode) == TcasSsrMode::Ground;
+}
+
+gdl90::AddressType ResolveTcasAddressType(int raw_address) {
+  return (static_cast<uint32_t>(raw_address) & 0x80000000u) != 0u
+             ? gdl90::AddressType::ADSB_ICAO
+             : gdl90::AddressType::ADSB_SELF_ASSIGNED;
+}
+
+uint8_t EmergencyCodeFromSquawk(int squawk) {
+  switch (squawk) {
+  case 7500:
+    return 5;
+  case 7600:
+    return 4;
+  case 7700:
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+gdl90::EmitterCategory WakeCategoryToEmitterCategory(int wake_category) {
+  switch (wake_category) {
+  case 0:
+    return gdl90::EmitterCategory::LIGHT;
+  case 1:
+    return gdl90::EmitterCategory::LARGE;
+  case 2:
+    return gdl90::EmitterCategory::HEAVY;
+  case 3:
+    return gdl90::EmitterCategory::HIGH_VORTEX_LARGE;
+  default:
+    return gdl90::EmitterCategory::NO_INFO;
+  }
+}
+
+gdl90::Callsign FallbackTrafficCallsign(uint32_t address) {
+  char buffer[gdl90::CALLSIGN_SIZE + 1] = {};
+  std::snprintf(buffer, sizeof(buffer), "V%06X",
+                static_cast<unsigned int>(address & 0xFFFFFFu));
+  return buffer;
+}
+
+void ResolveTrafficTrack(float vx, float vz, float heading_deg,
+                         uint16_t *out_track, gdl90::TrackType *out_type) {
+  if (!out_track || !out_type) {
+    return;
+  }
+  const double east = static_cast<double>(vx);
+  const double south = static_cast<double>(vz);
+  if (std::isfinite(east) && std::isfinite(south) &&
+      std::hypot(east, south) >= kMinTrackSpeedMps) {
+    *out_track = ClampToInt<uint16_t>(
+        NormalizeDegrees(std::atan2(east, -south) * kRadiansToDegrees));
+    *out_type = gdl90::TrackType::TRUE_TRACK;
+    return;
+  }
+  if (std::isfinite(static_cast<double>(heading_deg))) {
+    *out_track = ClampToInt<uint16_t>(
+        NormalizeDegrees(static_cast<double>(heading_deg)));
+    *out_type = gdl90::TrackType::TRUE_HEADING;
+    return;
+  }
+  *out_track = 0;
+  *out_type = gdl90::TrackType::INVALID;
+}
+
+bool BuildTcasTrafficReport(const TcasReportContext &context,
+                            const TrafficSnapshot &snapshot, size_t slot,
+                            gdl90::PositionData *out_report) {
+  if (!out_report || slot >= snapshot.size() ||
+      (snapshot.flags[slot] & TRAFFIC_FLAG_VALID) == 0u) {
+    return false;
+  }
+
+  gdl90::PositionData report{};
+  if ((snapshot.flags[slot] &
+       (TRAFFIC_FLAG_GEODETIC | TRAFFIC_FLAG_EXACT)) != 0u) {
+    report.latitude = snapshot.latitude[slot];
+    report.longitude = snapshot.longitude[slot];
+    report.altitude = ClampToInt<int32_t>(snapshot.altitude_ft[slot]);
+  } else if (!context.local_to_world ||
+             !context.local_to_world(snapshot.x[slot], snapshot.y[slot],
+                                     snapshot.z[slot], &report.latitude,
+                                     &report.longitude, &report.altitude)) {
+    return false;
+  }
+  report.altitude = CorrectAltitude(context, report.altitude);
+
+  const int ssr_mode = snapshot.ssr_mode[slot];
+  const int weight_on_wheels = snapshot.weight_on_wheels[slot];
+  if (context.has_ssr_mode && !TcasSsrModeHasAltitude(ssr_mode)) {
+    report.altitude = std::numeric_limits<int32_t>::min();
+  }
+
+  const uint32_t address = snapshot.address[slot];
+  const gdl90::Callsign identity = ToCallsign(snapshot.callsign[slot]);
+  report.h_velocity = snapshot.h_velocity_kt[slot];
+  report.v_velocity = snapshot.v_velocity_fpm[slot];
+  ResolveTrafficTrack(snapshot.vx[slot], snapshot.vz[slot],
+                      snapshot.heading_deg[slot], &report.track,
+                      &report.track_type);
+  report.airborne = weight_on_wheels >= 0
+                        ? weight_on_wheels == 0
+                        : !TcasSsrModeIndicatesGround(ssr_mode);
+  report.nic = context.nic;
+  report.nacp = context.nacp;
+  report.icao_address = address;
+  report.callsign = identity.empty() ? FallbackTrafficCallsign(address)
+                                     : identity;
+  report.emitter_category =
+      WakeCategoryToEmitterCategory(snapshot.wake_category[slot]);
+  report.address_type =
+      (snapshot.flags[slot] & TRAFFIC_FLAG_SYNTHETIC_ADDRESS) != 0u
+          ? gdl90::AddressType::TISB_TRACK_FILE
+          : ResolveTcasAddressType(snapshot.raw_address[slot]);
+  report.alert_status = 0;
+  report.emergency_code = EmergencyCodeFromSquawk(snapshot.squawk[slot]);
+
+  *out_report = report;
+  return true;
+}
+
+size_t ConvertDistantTcasTraffic(const ProjectionAnchor &anchor,
+                                 double max_radius_m,
+                                 LocalToWorldFn local_to_world,
+                                 TrafficSnapshot *snapshot) {
+  if (!snapshot || !local_to_world) {
+    return 0;
+  }
+  MarkPopulatedTcasTargets(snapshot);
+
+  // The complement of ProjectTrafficSnapshot's range test.
+  const bool projects = max_radius_m > 0.0;
+  const double max_radius_squared = max_radius_m * max_radius_m;
+  size_t converted = 0;
+  for (size_t i = 1; i < snapshot->size(); ++i) {
+    snapshot->flags[i] &= static_cast<uint8_t>(~TRAFFIC_FLAG_EXACT);
+    if ((snapshot->flags[i] & TRAFFIC_FLAG_VALID) == 0u) {
+      continue;
+    }
+    const double dx = snapshot->x[i] - anchor.x;
+    const double dz = snapshot->z[i] - anchor.z;
+    if (projects && dx * dx + dz * dz <= max_radius_squared &&
+        std::isfinite(snapshot->y[i])) {
+      continue;
+    }
+    int32_t altitude_ft = 0;
+    if (local_to_world(snapshot->x[i], snapshot->y[i], snapshot->z[i],
+                       &snapshot->latitude[i], &snapshot->longitude[i],
+                       &altitude_ft)) {
+      snapshot->altitude_ft[i] = static_cast<double>(altitude_ft);
+      snapshot->flags[i] |= TRAFFIC_FLAG_EXACT;
+      ++converted;
+    }
+  }
+  return converted;
+}
+
+size_t CollectTcasTraffic(const TrafficSelection &selection,
+                          const TcasReportContext &context,
+                          const LocalProjection *projection,
+                          double projection_radius_m,
+                          TrafficSnapshot *snapshot,
+                          std::vector<TrafficCandidate> *candidates,
+                          std::vector<gdl90::PositionData> *out_reports) {
+  if (!snapshot || !candidates || !out_reports) {
+    return 0;
+  }
+  out_reports->clear();
+  candidates->clear();
+  if (snapshot->empty()) {
+    return 0;
+  }
+
+  MarkPopulatedTcasTargets(snapshot);
+  AssignTcasAddresses(snapshot, context.ownship_address);
+
+  TrafficReference ownship;
+  ownship.x = snapshot->x[0];
+  ownship.y = snapshot->y[0];
+  ownship.z = snapshot->z[0];
+  ownship.vx = snapshot->vx[0];
+  ownship.vy = snapshot->vy[0];
+  ownship.vz = snapshot->vz[0];
+  MeasureLocalTraffic(*snapshot, ownship, candidates);
+  SelectNearestTraffic(selection, candidates, snapshot);
+
+  ConvertTrafficVelocities(snapshot);
+  if (projection) {
+    ProjectTrafficSnapshot(*projection, projection_radius_m, snapshot);
+  }
+  out_reports->reserve(candidates->size());
+  for (size_t slot = 1; slot < snapshot->size(); ++slot) {
+    gdl90::PositionData report;
+    if (BuildTcasTrafficReport(context, *snapshot, slot, &report)) {
+      out_reports->push_back(report);
+    }
+  }
+  return out_reports->size();
+}
+
+} // namespace xp2gdl90::traffic
@@ -0,0 +1,253 @@
+#include "xp2gdl90/thread_tuning.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <avrt.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#if defined(__APPLE__)
+#include <pthread/qos.h>
+#else
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace xp2gdl90 {
+
+namespace {
+
+#if !defined(_WIN32) && !defined(__APPLE__)
+constexpr int kHighNice = -10;
+// Above the default of every SCHED_FIFO thread a desktop session starts
+// with priority 1, below the kernel's own real-time threads.
+constexpr int kTimeCriticalFifoPriority = 10;
+#endif
+
+void AppendError(std::string *errors, const std::string &error) {
+  if (!errors->empty()) {
+    errors->append("; ");
+  }
+  errors->append(error);
+}
+
+#ifdef _WIN32
+std::string LastErrorMessage(const char *prefix) {
+  return std::string(prefix) + std::to_string(GetLastError());
+}
+
+// The MMCSS registration of the calling thread, if any.
+thread_local HANDLE t_mmcss_task = nullptr;
+
+void ApplyPriority(ThreadPriority priority, std::string *errors) {
+  if (priority != ThreadPriority::HIGH && t_mmcss_task) {
+    AvRevertMmThreadCharacteristics(t_mmcss_task);
+    t_mmcss_task = nullptr;
+  }
+  int level = THREAD_PRIORITY_NORMAL;
+  if (priority == ThreadPriority::HIGH) {
+    if (!t_mmcss_task) {
+      DWORD task_index = 0;
+      t_mmcss_task = AvSetMmThreadCharacteristicsW(L"Pro Audio", &task_index);
+    }
+    if (t_mmcss_task) {
+      return;
+    }
+    // Without the MMCSS service a plain priority boost is the next best.
+    level = THREAD_PRIORITY_HIGHEST;
+  } else if (priority == ThreadPriority::TIME_CRITICAL) {
+    level = THREAD_PRIORITY_TIME_CRITICAL;
+  }
+  if (!SetThreadPriority(GetCurrentThread(), level)) {
+    AppendError(errors, LastErrorMessage("SetThreadPriority failed: "));
+  }
+}
+
+void ApplyAffinity(uint32_t cpu_mask, std::string *errors) {
+  DWORD_PTR mask = cpu_mask;
+  if (mask == 0) {
+    DWORD_PTR system_mask = 0;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &mask, &system_mask)) {
+      AppendError(errors,
+                  LastErrorMessage("GetProcessAffinityMask failed: "));
+      return;
+    }
+  }
+  if (!SetThreadAffinityMask(GetCurrentThread(), mask)) {
+    AppendError(errors, LastErrorMessage("SetThreadAffinityMask failed: "));
+  }
+}
+#elif defined(__APPLE__)
+void ApplyPriority(ThreadPriority priority, std::string *errors) {
+  const qos_class_t qos = priority == ThreadPriority::NORMAL
+                              ? QOS_CLASS_DEFAULT
+                              : QOS_CLASS_USER_INTERACTIVE;
+  const int result = pthread_set_qos_class_self_np(qos, 0);
+  if (result != 0) {
+    AppendError(errors, std::string("pthread_set_qos_class_self_np failed: ") +
+                            std::strerror(result));
+  }
+}
+
+void ApplyAffinity(uint32_t cpu_mask, std::string *errors) {
+  if (cpu_mask != 0) {
+    AppendError(errors, "CPU affinity is not supported on macOS");
+  }
+}
+#else
+void ApplyPriority(ThreadPriority priority, std::string *errors) {
+  sched_param param{};
+  int policy = SCHED_OTHER;
+  if (priority == ThreadPriority::TIME_CRITICAL) {
+    policy = SCHED_FIFO;
+    param.sched_priority = (std::min)(kTimeCriticalFifoPriority,
+                                      sched_get_priority_max(SCHED_FIFO));
+  }
+  const int result = pthread_setschedparam(pthread_self(), policy, &param);
+  if (result != 0) {
+    AppendError(errors, std::string("pthread_setschedparam failed: ") +
+                            std::strerror(result));
+  }
+  if (policy == SCHED_FIFO) {
+    return;
+  }
+  // Nice values are per thread on Linux, addressed by thread ID. Normal is
+  // the process's own, which a thread may return to without privileges.
+  const int nice = priority == ThreadPriority::HIGH
+                       ? kHighNice
+                       : getpriority(PRIO_PROCESS, getpid());
+  const id_t thread_id = static_cast<id_t>(syscall(SYS_gettid));
+  if (setpriority(PRIO_PROCESS, thread_id, nice) != 0) {
+    AppendError(errors,
+                std::string("setpriority failed: ") + std::strerror(errno));
+  }
+}
+
+void ApplyAffinity(uint32_t cpu_mask, std::string *errors) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    const bool allowed =
+        cpu_mask == 0 || (cpu < 32 && ((cpu_mask >> cpu) & 1u) != 0);
+    if (allowed) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  const int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (result != 0) {
+    AppendError(errors, std::string("pthread_setaffinity_np failed: ") +
+                            std::strerror(result));
+  }
+}
+#endif
+
+} // namespace
+
+const char *ThreadPriorityName(ThreadPriority priority) {
+  switch (priority) {
+  case ThreadPriority::NORMAL:
+    return "Normal";
+  case ThreadPriority::HIGH:
+    return "High";
+  case ThreadPriority::TIME_CRITICAL:
+    return "Time-critical";
+  }
+  return "Unknown";
+}
+
+ThreadTuning MakeWorkerThreadTuning(const Settings &cfg) {
+  ThreadTuning tuning;
+  tuning.priority = static_cast<ThreadPriority>(cfg.worker_thread_priority);
+  tuning.cpu_mask = cfg.worker_cpu_mask;
+  return tuning;
+}
+
+bool ApplyThreadTuning(const ThreadTuning &tuning, std::string *out_error) {
+  std::string errors;
+  ApplyPriority(tuning.priority, &errors);
+  ApplyAffinity(tuning.cpu_mask, &errors);
+  if (out_error) {
+    *out_error = errors;
+  }
+  return errors.empty();
+}
+
+void ThreadTuningSlot::set(const ThreadTuning &tuning) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_ = tuning;
+  changed_.store(true, std::memory_order_release);
+}
+
+bool ThreadTuningSlot::applyPending() {
+  if (!changed_.exchange(false, std::memory_order_acquire)) {
+    return true;
+  }
+  ThreadTuning tuning;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tuning = pending_;
+    if (tuning == applied_ && last_error_.empty()) {
+      return true;
+    }
+  }
+  std::string error;
+  const bool ok = ApplyThreadTuning(tuning, &error);
+  std::lock_guard<std::mutex> lock(mutex_);
+  applied_ = tuning;
+  last_error_ = error;
+  return ok;
+}
+
+bool ThreadTuningSlot::ok() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return last_error_.empty();
+}
+
+std::string ThreadTuningSlot::lastError() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return last_error_;
+}
+
+void WakeLatencyMeter::notified(int64_t now_ns) {
+  int64_t expected = 0;
+  marked_ns_.compare_exchange_strong(expected, now_ns,
+                                     std::memory_order_relaxed);
+}
+
+void WakeLatencyMeter::woke(int64_t now_ns, bool for_work) {
+  const int64_t marked = marked_ns_.exchange(0, std::memory_order_relaxed);
+  if (marked != 0 && for_work) {
+    record(now_ns - marked);
+  }
+}
+
+void WakeLatencyMeter::record(int64_t latency_ns) {
+  const uint64_t latency_us =
+      static_cast<uint64_t>((std::max)(int64_t{0}, latency_ns) / 1000);
+  samples_.fetch_add(1, std::memory_order_relaxed);
+  sum_us_.fetch_add(latency_us, std::memory_order_relaxed);
+  last_us_.store(latency_us, std::memory_order_relaxed);
+  if (latency_us > max_us_.load(std::memory_order_relaxed)) {
+    max_us_.store(latency_us, std::memory_order_relaxed);
+  }
+}
+
+WakeLatencyStats WakeLatencyMeter::stats() const {
+  WakeLatencyStats stats;
+  stats.samples = samples_.load(std::memory_order_relaxed);
+  stats.sum_us = sum_us_.load(std::memory_order_relaxed);
+  stats.max_us = max_us_.load(std::memory_order_relaxed);
+  stats.last_us = last_us_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+} // namespace xp2gdl90
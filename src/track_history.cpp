@@ -0,0 +1,374 @@
+#include "xp2gdl90/track_history.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XP2GDL90_HISTORY_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define XP2GDL90_HISTORY_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace xp2gdl90::traffic {
+namespace {
+
+constexpr double kDegreesToRadians = 3.14159265358979323846 / 180.0;
+constexpr double kRadiansToDegrees = 180.0 / 3.14159265358979323846;
+// Along a meridian, on a mean-radius sphere.
+constexpr double kMetersPerDegree = 6371008.8 * kDegreesToRadians;
+constexpr double kInfinity = std::numeric_limits<double>::infinity();
+constexpr size_t kMinFitSamples = 3;
+
+static_assert(TRACK_HISTORY_SAMPLES % 2 == 0,
+              "The vector sums take samples in pairs");
+
+size_t Newest(const TrackHistory &history) {
+  return (history.next + TRACK_HISTORY_SAMPLES - 1) % TRACK_HISTORY_SAMPLES;
+}
+
+// The newest sample, which the fit is taken around.
+struct FitOrigin {
+  double time = 0.0;
+  double latitude_deg = 0.0;
+  double longitude_deg = 0.0;
+  double east_scale = 0.0; // Meters per degree of longitude.
+  double count = 0.0;
+};
+
+// Running sums for the least-squares lines of east, north and altitude
+// against time, and the time span each covers. Times are relative to the
+// origin, so they are zero or less.
+struct FitSums {
+  double w = 0.0, st = 0.0, stt = 0.0;
+  double se = 0.0, ste = 0.0, sn = 0.0, stn = 0.0;
+  double aw = 0.0, ast = 0.0, astt = 0.0, sa = 0.0, sta = 0.0;
+  double oldest = 0.0;
+  double altitude_oldest = kInfinity;
+  double altitude_newest = -kInfinity;
+};
+
+FitOrigin MakeOrigin(const TrackHistory &history) {
+  const size_t newest = Newest(history);
+  FitOrigin origin;
+  origin.time = history.time[newest];
+  origin.latitude_deg = history.latitude_deg[newest];
+  origin.longitude_deg = history.longitude_deg[newest];
+  origin.east_scale =
+      kMetersPerDegree * std::cos(origin.latitude_deg * kDegreesToRadians);
+  origin.count = static_cast<double>(history.count);
+  return origin;
+}
+
+// Every slot is visited with a 0/1 weight rather than skipped, so the
+// vector paths below can take the slots two at a time without branches.
+void SumSamplesScalar(const TrackHistory &history, const FitOrigin &origin,
+                      FitSums *out) {
+  FitSums sums;
+  for (size_t i = 0; i < TRACK_HISTORY_SAMPLES; ++i) {
+    const double used = static_cast<double>(i) < origin.count ? 1.0 : 0.0;
+    const double t = used * (history.time[i] - origin.time);
+    double dlon = history.longitude_deg[i] - origin.longitude_deg;
+    dlon += dlon > 180.0 ? -360.0 : 0.0;
+    dlon += dlon < -180.0 ? 360.0 : 0.0;
+    const double east = used * dlon * origin.east_scale;
+    const double north =
+        used * (history.latitude_deg[i] - origin.latitude_deg) *
+        kMetersPerDegree;
+    sums.w += used;
+    sums.st += t;
+    sums.stt += t * t;
+    sums.se += east;
+    sums.ste += t * east;
+    sums.sn += north;
+    sums.stn += t * north;
+    sums.oldest = (std::min)(sums.oldest, t);
+
+    // NaN compares unequal to itself.
+    const double altitude = history.altitude_ft[i];
+    const bool has_altitude = used > 0.0 && altitude == altitude;
+    const double a_used = has_altitude ? 1.0 : 0.0;
+    const double a = has_altitude ? altitude : 0.0;
+    sums.aw += a_used;
+    sums.ast += a_used * t;
+    sums.astt += a_used * (t * t);
+    sums.sa += a;
+    sums.sta += t * a;
+    sums.altitude_oldest = (std::min)(sums.altitude_oldest,
+                                      has_altitude ? t : kInfinity);
+    sums.altitude_newest = (std::max)(sums.altitude_newest,
+                                      has_altitude ? t : -kInfinity);
+  }
+  *out = sums;
+}
+
+#if defined(XP2GDL90_HISTORY_SSE2)
+inline double Sum(__m128d v) {
+  return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+inline __m128d Select(__m128d mask, __m128d when_set, __m128d otherwise) {
+  return _mm_or_pd(_mm_and_pd(mask, when_set),
+                   _mm_andnot_pd(mask, otherwise));
+}
+
+void SumSamples(const TrackHistory &history, const FitOrigin &origin,
+                FitSums *out) {
+  const __m128d zero = _mm_setzero_pd();
+  const __m128d one = _mm_set1_pd(1.0);
+  const __m128d infinity = _mm_set1_pd(kInfinity);
+  const __m128d negative_infinity = _mm_set1_pd(-kInfinity);
+  const __m128d half_turn = _mm_set1_pd(180.0);
+  const __m128d negative_half_turn = _mm_set1_pd(-180.0);
+  const __m128d turn = _mm_set1_pd(360.0);
+  const __m128d negative_turn = _mm_set1_pd(-360.0);
+  const __m128d count = _mm_set1_pd(origin.count);
+  const __m128d t0 = _mm_set1_pd(origin.time);
+  const __m128d latitude0 = _mm_set1_pd(origin.latitude_deg);
+  const __m128d longitude0 = _mm_set1_pd(origin.longitude_deg);
+  const __m128d east_scale = _mm_set1_pd(origin.east_scale);
+  const __m128d north_scale = _mm_set1_pd(kMetersPerDegree);
+
+  __m128d w = zero, st = zero, stt = zero;
+  __m128d se = zero, ste = zero, sn = zero, stn = zero;
+  __m128d aw = zero, ast = zero, astt = zero, sa = zero, sta = zero;
+  __m128d oldest = zero;
+  __m128d altitude_oldest = infinity;
+  __m128d altitude_newest = negative_infinity;
+  for (size_t i = 0; i < TRACK_HISTORY_SAMPLES; i += 2) {
+    const __m128d index =
+        _mm_set_pd(static_cast<double>(i + 1), static_cast<double>(i));
+    const __m128d used = _mm_and_pd(_mm_cmplt_pd(index, count), one);
+    const __m128d t =
+        _mm_mul_pd(used, _mm_sub_pd(_mm_loadu_pd(history.time + i), t0));
+    __m128d dlon =
+        _mm_sub_pd(_mm_loadu_pd(history.longitude_deg + i), longitude0);
+    dlon = _mm_add_pd(
+        dlon, _mm_and_pd(_mm_cmpgt_pd(dlon, half_turn), negative_turn));
+    dlon = _mm_add_pd(
+        dlon, _mm_and_pd(_mm_cmplt_pd(dlon, negative_half_turn), turn));
+    const __m128d east = _mm_mul_pd(_mm_mul_pd(used, dlon), east_scale);
+    const __m128d north = _mm_mul_pd(
+        _mm_mul_pd(used,
+                   _mm_sub_pd(_mm_loadu_pd(history.latitude_deg + i),
+                              latitude0)),
+        north_scale);
+    const __m128d tt = _mm_mul_pd(t, t);
+    w = _mm_add_pd(w, used);
+    st = _mm_add_pd(st, t);
+    stt = _mm_add_pd(stt, tt);
+    se = _mm_add_pd(se, east);
+    ste = _mm_add_pd(ste, _mm_mul_pd(t, east));
+    sn = _mm_add_pd(sn, north);
+    stn = _mm_add_pd(stn, _mm_mul_pd(t, north));
+    oldest = _mm_min_pd(oldest, t);
+
+    const __m128d altitude = _mm_loadu_pd(history.altitude_ft + i);
+    const __m128d has_altitude = _mm_and_pd(_mm_cmpeq_pd(altitude, altitude),
+                                            _mm_cmpgt_pd(used, zero));
+    const __m128d a_used = _mm_and_pd(has_altitude, one);
+    const __m128d a = _mm_and_pd(has_altitude, altitude);
+    aw = _mm_add_pd(aw, a_used);
+    ast = _mm_add_pd(ast, _mm_mul_pd(a_used, t));
+    astt = _mm_add_pd(astt, _mm_mul_pd(a_used, tt));
+    sa = _mm_add_pd(sa, a);
+    sta = _mm_add_pd(sta, _mm_mul_pd(t, a));
+    altitude_oldest = _mm_min_pd(altitude_oldest,
+                                 Select(has_altitude, t, infinity));
+    altitude_newest = _mm_max_pd(altitude_newest,
+                                 Select(has_altitude, t, negative_infinity));
+  }
+
+  out->w = Sum(w);
+  out->st = Sum(st);
+  out->stt = Sum(stt);
+  out->se = Sum(se);
+  out->ste = Sum(ste);
+  out->sn = Sum(sn);
+  out->stn = Sum(stn);
+  out->aw = Sum(aw);
+  out->ast = Sum(ast);
+  out->astt = Sum(astt);
+  out->sa = Sum(sa);
+  out->sta = Sum(sta);
+  out->oldest = _mm_cvtsd_f64(_mm_min_sd(oldest, _mm_unpackhi_pd(oldest,
+                                                                 oldest)));
+  out->altitude_oldest = _mm_cvtsd_f64(_mm_min_sd(
+      altitude_oldest, _mm_unpackhi_pd(altitude_oldest, altitude_oldest)));
+  out->altitude_newest = _mm_cvtsd_f64(_mm_max_sd(
+      altitude_newest, _mm_unpackhi_pd(altitude_newest, altitude_newest)));
+}
+#elif defined(XP2GDL90_HISTORY_NEON)
+void SumSamples(const TrackHistory &history, const FitOrigin &origin,
+                FitSums *out) {
+  const float64x2_t zero = vdupq_n_f64(0.0);
+  const float64x2_t infinity = vdupq_n_f64(kInfinity);
+  const float64x2_t negative_infinity = vdupq_n_f64(-kInfinity);
+  const float64x2_t count = vdupq_n_f64(origin.count);
+  const float64x2_t t0 = vdupq_n_f64(origin.time);
+  const float64x2_t latitude0 = vdupq_n_f64(origin.latitude_deg);
+  const float64x2_t longitude0 = vdupq_n_f64(origin.longitude_deg);
+  const float64x2_t east_scale = vdupq_n_f64(origin.east_scale);
+  const float64x2_t north_scale = vdupq_n_f64(kMetersPerDegree);
+
+  float64x2_t w = zero, st = zero, stt = zero;
+  float64x2_t se = zero, ste = zero, sn = zero, stn = zero;
+  float64x2_t aw = zero, ast = zero, astt = zero, sa = zero, sta = zero;
+  float64x2_t oldest = zero;
+  float64x2_t altitude_oldest = infinity;
+  float64x2_t altitude_newest = negative_infinity;
+  for (size_t i = 0; i < TRACK_HISTORY_SAMPLES; i += 2) {
+    const double lanes[2] = {static_cast<double>(i),
+                             static_cast<double>(i + 1)};
+    const float64x2_t used = vbslq_f64(vcltq_f64(vld1q_f64(lanes), count),
+                                       vdupq_n_f64(1.0), zero);
+    const float64x2_t t =
+        vmulq_f64(used, vsubq_f64(vld1q_f64(history.time + i), t0));
+    float64x2_t dlon =
+        vsubq_f64(vld1q_f64(history.longitude_deg + i), longitude0);
+    dlon = vaddq_f64(dlon, vbslq_f64(vcgtq_f64(dlon, vdupq_n_f64(180.0)),
+                                     vdupq_n_f64(-360.0), zero));
+    dlon = vaddq_f64(dlon, vbslq_f64(vcltq_f64(dlon, vdupq_n_f64(-180.0)),
+                                     vdupq_n_f64(360.0), zero));
+    const float64x2_t east = vmulq_f64(vmulq_f64(used, dlon), east_scale);
+    const float64x2_t north = vmulq_f64(
+        vmulq_f64(used, vsubq_f64(vld1q_f64(history.latitude_deg + i),
+                                  latitude0)),
+        north_scale);
+    const float64x2_t tt = vmulq_f64(t, t);
+    w = vaddq_f64(w, used);
+    st = vaddq_f64(st, t);
+    stt = vaddq_f64(stt, tt);
+    se = vaddq_f64(se, east);
+    ste = vaddq_f64(ste, vmulq_f64(t, east));
+    sn = vaddq_f64(sn, north);
+    stn = vaddq_f64(stn, vmulq_f64(t, north));
+    oldest = vminq_f64(oldest, t);
+
+    const float64x2_t altitude = vld1q_f64(history.altitude_ft + i);
+    const uint64x2_t has_altitude =
+        vandq_u64(vceqq_f64(altitude, altitude), vcgtq_f64(used, zero));
+    const float64x2_t a_used = vbslq_f64(has_altitude, vdupq_n_f64(1.0), zero);
+    const float64x2_t a = vbslq_f64(has_altitude, altitude, zero);
+    aw = vaddq_f64(aw, a_used);
+    ast = vaddq_f64(ast, vmulq_f64(a_used, t));
+    astt = vaddq_f64(astt, vmulq_f64(a_used, tt));
+    sa = vaddq_f64(sa, a);
+    sta = vaddq_f64(sta, vmulq_f64(t, a));
+    altitude_oldest =
+        vminq_f64(altitude_oldest, vbslq_f64(has_altitude, t, infinity));
+    altitude_newest = vmaxq_f64(altitude_newest,
+                                vbslq_f64(has_altitude, t, negative_infinity));
+  }
+
+  out->w = vaddvq_f64(w);
+  out->st = vaddvq_f64(st);
+  out->stt = vaddvq_f64(stt);
+  out->se = vaddvq_f64(se);
+  out->ste = vaddvq_f64(ste);
+  out->sn = vaddvq_f64(sn);
+  out->stn = vaddvq_f64(stn);
+  out->aw = vaddvq_f64(aw);
+  out->ast = vaddvq_f64(ast);
+  out->astt = vaddvq_f64(astt);
+  out->sa = vaddvq_f64(sa);
+  out->sta = vaddvq_f64(sta);
+  out->oldest = vminvq_f64(oldest);
+  out->altitude_oldest = vminvq_f64(altitude_oldest);
+  out->altitude_newest = vmaxvq_f64(altitude_newest);
+}
+#else
+void SumSamples(const TrackHistory &history, const FitOrigin &origin,
+                FitSums *out) {
+  SumSamplesScalar(history, origin, out);
+}
+#endif
+
+// Slope of the least-squares line through the weighted points, from their
+// running sums; NaN when every weighted point shares a time.
+double Slope(double w, double st, double stt, double sx, double stx) {
+  const double denominator = w * stt - st * st;
+  return denominator > 0.0 ? (w * stx - st * sx) / denominator : NAN;
+}
+
+bool FinishTrend(const FitSums &sums, double min_span_s,
+                 TrackTrend *out_trend) {
+  if (-sums.oldest >= min_span_s) {
+    const double east_mps =
+        Slope(sums.w, sums.st, sums.stt, sums.se, sums.ste);
+    const double north_mps =
+        Slope(sums.w, sums.st, sums.stt, sums.sn, sums.stn);
+    if (std::isfinite(east_mps) && std::isfinite(north_mps)) {
+      out_trend->has_velocity = true;
+      out_trend->ground_speed_mps = std::hypot(east_mps, north_mps);
+      double track = std::atan2(east_mps, north_mps) * kRadiansToDegrees;
+      if (track < 0.0) {
+        track += 360.0;
+      }
+      out_trend->track_deg = track;
+    }
+  }
+  if (sums.aw >= kMinFitSamples &&
+      sums.altitude_newest - sums.altitude_oldest >= min_span_s) {
+    const double feet_per_second =
+        Slope(sums.aw, sums.ast, sums.astt, sums.sa, sums.sta);
+    if (std::isfinite(feet_per_second)) {
+      out_trend->has_vertical_rate = true;
+      out_trend->vertical_rate_fpm = feet_per_second * 60.0;
+    }
+  }
+  return out_trend->has_velocity || out_trend->has_vertical_rate;
+}
+
+template <typename SumFn>
+bool FitWith(SumFn sum, const TrackHistory &history, double min_span_s,
+             TrackTrend *out_trend) {
+  if (!out_trend) {
+    return false;
+  }
+  *out_trend = TrackTrend{};
+  if (history.count < kMinFitSamples) {
+    return false;
+  }
+  FitSums sums;
+  sum(history, MakeOrigin(history), &sums);
+  return FinishTrend(sums, min_span_s, out_trend);
+}
+
+} // namespace
+
+void TrackHistory::push(double sample_time, double latitude, double longitude,
+                        double altitude) {
+  if (count > 0) {
+    const size_t newest = Newest(*this);
+    if (sample_time < time[newest]) {
+      // The clock went back; older samples no longer line up.
+      clear();
+    } else if (sample_time == time[newest]) {
+      next = static_cast<uint8_t>(newest);
+      --count;
+    }
+  }
+  time[next] = sample_time;
+  latitude_deg[next] = latitude;
+  longitude_deg[next] = longitude;
+  altitude_ft[next] = altitude;
+  next = static_cast<uint8_t>((next + 1) % TRACK_HISTORY_SAMPLES);
+  count = static_cast<uint8_t>(
+      (std::min)(static_cast<size_t>(count) + 1, TRACK_HISTORY_SAMPLES));
+}
+
+bool FitTrackTrend(const TrackHistory &history, double min_span_s,
+                   TrackTrend *out_trend) {
+  return FitWith(SumSamples, history, min_span_s, out_trend);
+}
+
+bool FitTrackTrendScalar(const TrackHistory &history, double min_span_s,
+                         TrackTrend *out_trend) {
+  return FitWith(SumSamplesScalar, history, min_span_s, out_trend);
+}
+
+} // namespace xp2gdl90::traffic
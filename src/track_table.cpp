@@ -0,0 +1,232 @@
+#include "xp2gdl90/track_table.h"
+
+#include <algorithm>
+
+namespace xp2gdl90::traffic {
+namespace {
+
+constexpr size_t kMinSlots = 16;
+
+} // namespace
+
+size_t TrackTable::home(uint32_t key) const {
+  // Fibonacci hashing spreads sequential object IDs across the table.
+  return static_cast<size_t>((key * 0x9E3779B1u) >> shift_);
+}
+
+size_t TrackTable::findSlot(uint32_t key) const {
+  if (slots_.empty()) {
+    return npos;
+  }
+  const size_t mask = slots_.size() - 1;
+  for (size_t slot = home(key);; slot = (slot + 1) & mask) {
+    const uint32_t entry = slots_[slot];
+    if (entry == 0) {
+      return npos;
+    }
+    if (tracks_[entry - 1].key == key) {
+      return slot;
+    }
+  }
+}
+
+size_t TrackTable::find(uint32_t key) const {
+  const size_t slot = findSlot(key);
+  return slot == npos ? npos : slots_[slot] - 1;
+}
+
+size_t TrackTable::upsert(uint32_t key, double now) {
+  if (const size_t index = find(key); index != npos) {
+    tracks_[index].last_seen = now;
+    ++tracks_[index].generation;
+    return index;
+  }
+
+  // Keep the load factor at or below one half so probe runs stay short.
+  if ((tracks_.size() + 1) * 2 > slots_.size()) {
+    grow();
+  }
+  const size_t mask = slots_.size() - 1;
+  size_t slot = home(key);
+  while (slots_[slot] != 0) {
+    slot = (slot + 1) & mask;
+  }
+  TrackInfo info;
+  info.key = key;
+  info.first_seen = now;
+  info.last_seen = now;
+  info.generation = 1;
+  tracks_.push_back(info);
+  if (history_enabled_) {
+    histories_.emplace_back();
+  }
+  slots_[slot] = static_cast<uint32_t>(tracks_.size());
+  ++generation_;
+  return tracks_.size() - 1;
+}
+
+size_t TrackTable::evictStale(double now, double max_age,
+                              TrafficSnapshot *rows) {
+  size_t removed = 0;
+  for (size_t index = 0; index < tracks_.size();) {
+    if (now - tracks_[index].last_seen <= max_age) {
+      ++index;
+      continue;
+    }
+    removeAt(index);
+    if (rows && index < rows->size()) {
+      rows->removeRow(index);
+    }
+    ++removed;
+  }
+  if (removed > 0) {
+    ++generation_;
+  }
+  return removed;
+}
+
+bool TrackTable::remove(uint32_t key, TrafficSnapshot *rows) {
+  const size_t index = find(key);
+  if (index == npos) {
+    return false;
+  }
+  removeAt(index);
+  if (rows && index < rows->size()) {
+    rows->removeRow(index);
+  }
+  ++generation_;
+  return true;
+}
+
+void TrackTable::clear() {
+  if (tracks_.empty()) {
+    return;
+  }
+  tracks_.clear();
+  histories_.clear();
+  std::fill(slots_.begin(), slots_.end(), 0u);
+  grid_.clear();
+  ++generation_;
+}
+
+void TrackTable::setGridCellSize(double cell_size_m) {
+  grid_.configure(cell_size_m);
+  for (size_t index = 0; index < tracks_.size(); ++index) {
+    grid_.place(static_cast<uint32_t>(index), tracks_[index].latitude_deg,
+                tracks_[index].longitude_deg);
+  }
+}
+
+void TrackTable::setPosition(size_t index, double latitude_deg,
+                             double longitude_deg) {
+  if (index >= tracks_.size()) {
+    return;
+  }
+  tracks_[index].latitude_deg = latitude_deg;
+  tracks_[index].longitude_deg = longitude_deg;
+  grid_.place(static_cast<uint32_t>(index), latitude_deg, longitude_deg);
+}
+
+void TrackTable::setSchedule(size_t index, double next_send,
+                             double send_interval) {
+  if (index >= tracks_.size()) {
+    return;
+  }
+  tracks_[index].next_send = next_send;
+  tracks_[index].send_interval = send_interval;
+}
+
+void TrackTable::setHistoryEnabled(bool enabled) {
+  if (enabled == history_enabled_) {
+    return;
+  }
+  history_enabled_ = enabled;
+  histories_.clear();
+  if (enabled) {
+    histories_.resize(tracks_.size());
+  }
+}
+
+void TrackTable::pushSample(size_t index, double sample_time,
+                            double latitude_deg, double longitude_deg,
+                            double altitude_ft) {
+  if (!history_enabled_ || index >= histories_.size()) {
+    return;
+  }
+  histories_[index].push(sample_time, latitude_deg, longitude_deg,
+                         altitude_ft);
+}
+
+size_t TrackTable::queryNear(double latitude_deg, double longitude_deg,
+                             double radius_m,
+                             std::vector<uint32_t> *out_indices,
+                             GridQueryStats *out_stats) const {
+  if (grid_.enabled()) {
+    return grid_.query(latitude_deg, longitude_deg, radius_m, out_indices,
+                       out_stats);
+  }
+  if (!out_indices) {
+    return 0;
+  }
+  for (size_t index = 0; index < tracks_.size(); ++index) {
+    out_indices->push_back(static_cast<uint32_t>(index));
+  }
+  if (out_stats) {
+    *out_stats = GridQueryStats{0, tracks_.size()};
+  }
+  return tracks_.size();
+}
+
+void TrackTable::grow() {
+  const size_t capacity = slots_.empty() ? kMinSlots : slots_.size() * 2;
+  slots_.assign(capacity, 0u);
+  shift_ = 32;
+  for (size_t size = capacity; size > 1; size >>= 1) {
+    --shift_;
+  }
+
+  const size_t mask = capacity - 1;
+  for (size_t index = 0; index < tracks_.size(); ++index) {
+    size_t slot = home(tracks_[index].key);
+    while (slots_[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    slots_[slot] = static_cast<uint32_t>(index + 1);
+  }
+}
+
+void TrackTable::removeAt(size_t index) {
+  // Backward-shift deletion keeps every probe run contiguous without
+  // tombstones.
+  const size_t mask = slots_.size() - 1;
+  size_t hole = findSlot(tracks_[index].key);
+  for (size_t next = (hole + 1) & mask; slots_[next] != 0;
+       next = (next + 1) & mask) {
+    const size_t want = home(tracks_[slots_[next] - 1].key);
+    // Move the entry back unless its home lies cyclically in (hole, next].
+    const bool stays = hole <= next ? (hole < want && want <= next)
+                                    : (hole < want || want <= next);
+    if (!stays) {
+      slots_[hole] = slots_[next];
+      hole = next;
+    }
+  }
+  slots_[hole] = 0;
+
+  const size_t last = tracks_.size() - 1;
+  grid_.remove(static_cast<uint32_t>(index));
+  if (index != last) {
+    grid_.renumber(static_cast<uint32_t>(last), static_cast<uint32_t>(index));
+    tracks_[index] = tracks_[last];
+    slots_[findSlot(tracks_[index].key)] = static_cast<uint32_t>(index + 1);
+    if (history_enabled_) {
+      histories_[index] = histories_[last];
+    }
+  }
+  tracks_.pop_back();
+  if (history_enabled_) {
+    histories_.pop_back();
+  }
+}
+
+} // namespace xp2gdl90::traffic
@@ -0,0 +1,29 @@
+#include "xp2gdl90/traffic_build.h"
+
+namespace xp2gdl90::traffic {
+
+size_t EncodeTrafficReports(const gdl90::GDL90Encoder &encoder,
+                            const gdl90::PositionData *reports, size_t count,
+                            gdl90::FrameArena &arena,
+                            gdl90::TrafficFrameCache *cache,
+                            ParallelTrafficBuild *build) {
+  if (!build || !build->pool || build->pool->threads() == 0 ||
+      count < build->min_reports || !reports) {
+    return encoder.encodeTrafficBatch(reports, count, arena, cache);
+  }
+
+  std::vector<uint8_t> &payloads = build->payloads;
+  if (payloads.size() < count * gdl90::TRAFFIC_PAYLOAD_SIZE) {
+    payloads.resize(count * gdl90::TRAFFIC_PAYLOAD_SIZE);
+  }
+  build->pool->parallelFor(
+      count, build->encode_grain, [&](size_t begin, size_t end) {
+        encoder.packTrafficPayloads(
+            reports + begin, end - begin,
+            payloads.data() + begin * gdl90::TRAFFIC_PAYLOAD_SIZE);
+      });
+  return encoder.frameTrafficPayloads(reports, payloads.data(), count, arena,
+                                      cache);
+}
+
+} // namespace xp2gdl90::traffic
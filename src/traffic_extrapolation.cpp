@@ -0,0 +1,67 @@
+#include "xp2gdl90/traffic_extrapolation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace xp2gdl90::traffic {
+namespace {
+
+constexpr double kDegreesToRadians = 3.14159265358979323846 / 180.0;
+constexpr double kKnotsToMetersPerSecond = 1852.0 / 3600.0;
+// Along a meridian, on a mean-radius sphere.
+constexpr double kMetersPerDegree = 6371008.8 * kDegreesToRadians;
+
+} // namespace
+
+double ExtrapolateReport(double dt_s, double max_horizon_s,
+                         gdl90::PositionData *report) {
+  if (!report || !(dt_s > 0.0) || !(max_horizon_s > 0.0)) {
+    return 0.0;
+  }
+  const double dt = (std::min)(dt_s, max_horizon_s);
+
+  if (report->h_velocity != gdl90::VELOCITY_INVALID &&
+      report->track_type != gdl90::TrackType::INVALID &&
+      std::fabs(report->latitude) < 90.0) {
+    const double distance = report->h_velocity * kKnotsToMetersPerSecond * dt;
+    const double track = report->track * kDegreesToRadians;
+    const double cos_latitude = std::cos(report->latitude * kDegreesToRadians);
+    report->latitude = std::clamp(
+        report->latitude + distance * std::cos(track) / kMetersPerDegree,
+        -90.0, 90.0);
+    double longitude =
+        report->longitude +
+        distance * std::sin(track) / (kMetersPerDegree * cos_latitude);
+    if (longitude >= 180.0) {
+      longitude -= 360.0;
+    } else if (longitude < -180.0) {
+      longitude += 360.0;
+    }
+    report->longitude = longitude;
+  }
+
+  if (report->v_velocity != std::numeric_limits<int16_t>::min() &&
+      report->altitude != std::numeric_limits<int32_t>::min()) {
+    report->altitude += static_cast<int32_t>(
+        std::lround(report->v_velocity * dt / 60.0));
+  }
+  return dt;
+}
+
+double ExtrapolateTrafficReports(double lead_s, double spacing_s,
+                                 double max_horizon_s,
+                                 std::vector<gdl90::PositionData> *reports) {
+  if (!reports) {
+    return 0.0;
+  }
+  double max_lead = 0.0;
+  for (size_t i = 0; i < reports->size(); ++i) {
+    max_lead = (std::max)(
+        max_lead, ExtrapolateReport(lead_s + static_cast<double>(i) * spacing_s,
+                                    max_horizon_s, &(*reports)[i]));
+  }
+  return max_lead;
+}
+
+} // namespace xp2gdl90::traffic
@@ -0,0 +1,49 @@
+#include "xp2gdl90/traffic_frame_cache.h"
+
+#include <cstring>
+#include <iterator>
+
+#include "xp2gdl90/gdl90_framing.h"
+
+namespace gdl90 {
+
+static_assert(FRAME_BUFFER_CAPACITY <= 0xFF,
+              "cached frame sizes are stored in a byte");
+
+void TrafficFrameCache::endBatch() {
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    it = it->second.batch == batch_ ? std::next(it) : entries_.erase(it);
+  }
+}
+
+size_t TrafficFrameCache::frame(uint32_t address, const uint8_t *payload,
+                                size_t size, uint8_t *out) {
+  Entry &entry = entries_[address];
+  entry.batch = batch_;
+  if (entry.frame_size != 0 && entry.payload_size == size &&
+      std::memcmp(entry.payload.data(), payload, size) == 0) {
+    ++hits_;
+    std::memcpy(out, entry.frame.data(), entry.frame_size);
+    return entry.frame_size;
+  }
+
+  ++misses_;
+  const size_t framed = FrameMessage(payload, size, out);
+  if (size <= entry.payload.size() && framed <= entry.frame.size()) {
+    std::memcpy(entry.payload.data(), payload, size);
+    std::memcpy(entry.frame.data(), out, framed);
+    entry.payload_size = static_cast<uint8_t>(size);
+    entry.frame_size = static_cast<uint8_t>(framed);
+  } else {
+    entry.frame_size = 0;
+  }
+  return framed;
+}
+
+void TrafficFrameCache::clear() {
+  entries_.clear();
+  hits_ = 0;
+  misses_ = 0;
+}
+
+} // namespace gdl90
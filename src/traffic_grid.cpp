@@ -0,0 +1,160 @@
+#include "xp2gdl90/traffic_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace xp2gdl90::traffic {
+namespace {
+
+constexpr double kDegreesToRadians = 3.14159265358979323846 / 180.0;
+// Along a meridian, on a mean-radius sphere.
+constexpr double kMetersPerDegree = 6371008.8 * kDegreesToRadians;
+
+int64_t FloorToCell(double value, double cell) {
+  return static_cast<int64_t>(std::floor(value / cell));
+}
+
+} // namespace
+
+void TrafficGrid::configure(double cell_size_m) {
+  clear();
+  placements_.clear();
+  if (!(cell_size_m > 0.0) || !std::isfinite(cell_size_m)) {
+    cell_deg_ = 0.0;
+    rows_ = 0;
+    columns_ = 0;
+    return;
+  }
+  // Round the cell so whole rows and columns tile the globe; a column index
+  // can then wrap at the antimeridian with a plain modulo.
+  rows_ = static_cast<int64_t>(
+      std::ceil(180.0 / (std::min)(cell_size_m / kMetersPerDegree, 180.0)));
+  columns_ = rows_ * 2;
+  cell_deg_ = 180.0 / static_cast<double>(rows_);
+}
+
+void TrafficGrid::clear() {
+  cells_.clear();
+  std::fill(placements_.begin(), placements_.end(), Placement{});
+}
+
+uint64_t TrafficGrid::cellKey(int64_t row, int64_t column) const {
+  row = std::clamp<int64_t>(row, 0, rows_ - 1);
+  column %= columns_;
+  if (column < 0) {
+    column += columns_;
+  }
+  return (static_cast<uint64_t>(row) << 32) | static_cast<uint64_t>(column);
+}
+
+void TrafficGrid::place(uint32_t index, double latitude_deg,
+                        double longitude_deg) {
+  if (!enabled()) {
+    return;
+  }
+  if (!std::isfinite(latitude_deg) || !std::isfinite(longitude_deg)) {
+    remove(index);
+    return;
+  }
+
+  const uint64_t cell = cellKey(FloorToCell(latitude_deg + 90.0, cell_deg_),
+                                FloorToCell(longitude_deg + 180.0, cell_deg_));
+  if (index >= placements_.size()) {
+    placements_.resize(static_cast<size_t>(index) + 1);
+  }
+  if (placements_[index].placed) {
+    if (placements_[index].cell == cell) {
+      return;
+    }
+    remove(index);
+  }
+
+  std::vector<uint32_t> &members = cells_[cell];
+  placements_[index] =
+      Placement{cell, static_cast<uint32_t>(members.size()), true};
+  members.push_back(index);
+}
+
+void TrafficGrid::remove(uint32_t index) {
+  if (index >= placements_.size() || !placements_[index].placed) {
+    return;
+  }
+  const Placement placement = placements_[index];
+  const auto it = cells_.find(placement.cell);
+  std::vector<uint32_t> &members = it->second;
+  const uint32_t moved = members.back();
+  members[placement.slot] = moved;
+  placements_[moved].slot = placement.slot;
+  members.pop_back();
+  if (members.empty()) {
+    cells_.erase(it);
+  }
+  placements_[index] = Placement{};
+}
+
+void TrafficGrid::renumber(uint32_t from, uint32_t to) {
+  if (from == to || from >= placements_.size() ||
+      !placements_[from].placed) {
+    return;
+  }
+  if (to >= placements_.size()) {
+    placements_.resize(static_cast<size_t>(to) + 1);
+  }
+  const Placement placement = placements_[from];
+  cells_[placement.cell][placement.slot] = to;
+  placements_[to] = placement;
+  placements_[from] = Placement{};
+}
+
+size_t TrafficGrid::query(double latitude_deg, double longitude_deg,
+                          double radius_m, std::vector<uint32_t> *out_indices,
+                          GridQueryStats *out_stats) const {
+  GridQueryStats stats;
+  if (!enabled() || !out_indices || !std::isfinite(latitude_deg) ||
+      !std::isfinite(longitude_deg) || !(radius_m >= 0.0)) {
+    if (out_stats) {
+      *out_stats = stats;
+    }
+    return 0;
+  }
+
+  const double radius_deg = radius_m / kMetersPerDegree;
+  const int64_t row_lo = std::clamp<int64_t>(
+      FloorToCell(latitude_deg - radius_deg + 90.0, cell_deg_), 0, rows_ - 1);
+  const int64_t row_hi = std::clamp<int64_t>(
+      FloorToCell(latitude_deg + radius_deg + 90.0, cell_deg_), 0, rows_ - 1);
+
+  // Columns narrow toward the poles, so widen by the most poleward latitude
+  // the circle reaches.
+  const double poleward =
+      (std::min)(90.0, std::fabs(latitude_deg) + radius_deg);
+  const double cos_poleward = std::cos(poleward * kDegreesToRadians);
+  int64_t column_lo = 0;
+  int64_t column_count = columns_;
+  if (cos_poleward > 1e-9) {
+    const double half_width = radius_deg / cos_poleward;
+    column_lo = FloorToCell(longitude_deg - half_width + 180.0, cell_deg_);
+    const int64_t column_hi =
+        FloorToCell(longitude_deg + half_width + 180.0, cell_deg_);
+    column_count = (std::min)(column_hi - column_lo + 1, columns_);
+  }
+
+  for (int64_t row = row_lo; row <= row_hi; ++row) {
+    for (int64_t offset = 0; offset < column_count; ++offset) {
+      ++stats.cells;
+      const auto it = cells_.find(cellKey(row, column_lo + offset));
+      if (it == cells_.end()) {
+        continue;
+      }
+      out_indices->insert(out_indices->end(), it->second.begin(),
+                          it->second.end());
+      stats.entries += it->second.size();
+    }
+  }
+  if (out_stats) {
+    *out_stats = stats;
+  }
+  return stats.entries;
+}
+
+} // namespace xp2gdl90::traffic
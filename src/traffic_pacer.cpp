@@ -0,0 +1,68 @@
+#include "xp2gdl90/traffic_pacer.h"
+
+#include <algorithm>
+
+namespace udp {
+
+void TrafficPacer::start(size_t frame_count, double now, double window_s) {
+  stats_.superseded += pending();
+  count_ = frame_count;
+  next_ = 0;
+  start_ = now;
+  window_ = window_s > 0.0 ? window_s : 0.0;
+}
+
+size_t TrafficPacer::release(double now, size_t *out_first) {
+  if (next_ >= count_) {
+    return 0;
+  }
+
+  size_t due = count_;
+  if (window_ > 0.0) {
+    const double elapsed = (std::max)(0.0, now - start_);
+    const double slot = window_ / static_cast<double>(count_);
+    due = (std::min)(count_, static_cast<size_t>(elapsed / slot) + 1);
+  }
+  if (due <= next_) {
+    return 0;
+  }
+
+  const size_t released = due - next_;
+  if (out_first) {
+    *out_first = next_;
+  }
+  next_ = due;
+
+  ++stats_.slices;
+  stats_.frames += released;
+  stats_.last_burst = released;
+  stats_.max_burst = (std::max)(stats_.max_burst, released);
+  if (!std::isnan(last_slice_) && now >= last_slice_) {
+    const double gap = now - last_slice_;
+    stats_.last_gap_s = gap;
+    stats_.max_gap_s = (std::max)(stats_.max_gap_s, gap);
+    stats_.gap_sum_s += gap;
+    ++stats_.gap_samples;
+  }
+  last_slice_ = now;
+  return released;
+}
+
+double TrafficPacer::nextDue() const {
+  if (next_ >= count_) {
+    return NAN;
+  }
+  return start_ + window_ * static_cast<double>(next_) /
+                      static_cast<double>(count_);
+}
+
+void TrafficPacer::reset() {
+  count_ = 0;
+  next_ = 0;
+  start_ = 0.0;
+  window_ = 0.0;
+  last_slice_ = NAN;
+  stats_ = TrafficPacerStats{};
+}
+
+} // namespace udp
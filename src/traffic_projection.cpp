@@ -0,0 +1,130 @@
+#include "xp2gdl90/traffic_projection.h"
+
+#include <cmath>
+
+namespace xp2gdl90::traffic {
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kDegreesToRadians = kPi / 180.0;
+constexpr double kRadiansToDegrees = 180.0 / kPi;
+constexpr double kMetersToFeet = 3.28084;
+constexpr double kWgs84SemiMajorAxis = 6378137.0;
+constexpr double kWgs84EccentricitySquared = 6.69437999014e-3;
+
+struct EnuBasis {
+  double east[3];
+  double north[3];
+  double up[3];
+};
+
+EnuBasis MakeEnuBasis(double latitude_deg, double longitude_deg) {
+  const double lat = latitude_deg * kDegreesToRadians;
+  const double lon = longitude_deg * kDegreesToRadians;
+  const double sin_lat = std::sin(lat);
+  const double cos_lat = std::cos(lat);
+  const double sin_lon = std::sin(lon);
+  const double cos_lon = std::cos(lon);
+  return EnuBasis{{-sin_lon, cos_lon, 0.0},
+                  {-sin_lat * cos_lon, -sin_lat * sin_lon, cos_lat},
+                  {cos_lat * cos_lon, cos_lat * sin_lon, sin_lat}};
+}
+
+double Dot(const double *a, const double *b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+} // namespace
+
+LocalProjection::LocalProjection(const ProjectionAnchor &anchor)
+    : anchor_(anchor) {
+  const double lat = anchor.latitude_deg * kDegreesToRadians;
+  const double sin_lat = std::sin(lat);
+  const double w = 1.0 - kWgs84EccentricitySquared * sin_lat * sin_lat;
+  normal_radius_ = kWgs84SemiMajorAxis / std::sqrt(w) + anchor.altitude_m;
+  meridional_radius_ =
+      kWgs84SemiMajorAxis * (1.0 - kWgs84EccentricitySquared) /
+          (w * std::sqrt(w)) +
+      anchor.altitude_m;
+  cos_latitude_ = std::cos(lat);
+  tan_latitude_ = std::tan(lat);
+
+  // The local axes are fixed at the frame origin, so a target's offset from
+  // the anchor is rotated into the anchor's east/north/up frame first.
+  const EnuBasis origin =
+      MakeEnuBasis(anchor.origin_latitude_deg, anchor.origin_longitude_deg);
+  const EnuBasis local =
+      MakeEnuBasis(anchor.latitude_deg, anchor.longitude_deg);
+  const double *axes[3] = {origin.east, origin.up, origin.north};
+  const double signs[3] = {1.0, 1.0, -1.0}; // +z points south.
+  for (int axis = 0; axis < 3; ++axis) {
+    rotation_[0][axis] = signs[axis] * Dot(local.east, axes[axis]);
+    rotation_[1][axis] = signs[axis] * Dot(local.north, axes[axis]);
+    rotation_[2][axis] = signs[axis] * Dot(local.up, axes[axis]);
+  }
+}
+
+void LocalProjection::project(double x, double y, double z,
+                              double *out_latitude_deg,
+                              double *out_longitude_deg,
+                              double *out_altitude_m) const {
+  const double dx = x - anchor_.x;
+  const double dy = y - anchor_.y;
+  const double dz = z - anchor_.z;
+  const double east =
+      rotation_[0][0] * dx + rotation_[0][1] * dy + rotation_[0][2] * dz;
+  const double north =
+      rotation_[1][0] * dx + rotation_[1][1] * dy + rotation_[1][2] * dz;
+  const double up =
+      rotation_[2][0] * dx + rotation_[2][1] * dy + rotation_[2][2] * dz;
+
+  const double m = meridional_radius_;
+  const double n = normal_radius_;
+  // Second-order terms: tangent-plane convergence toward the pole, height
+  // above the anchor, and the earth curving away below the plane.
+  const double dlat = north / m * (1.0 - up / m) -
+                      east * east * tan_latitude_ / (2.0 * m * n);
+  const double dlon = east / (n * cos_latitude_) *
+                      (1.0 - up / n + north * tan_latitude_ / m);
+  const double dalt =
+      up + east * east / (2.0 * n) + north * north / (2.0 * m);
+
+  *out_latitude_deg = anchor_.latitude_deg + dlat * kRadiansToDegrees;
+  *out_longitude_deg = anchor_.longitude_deg + dlon * kRadiansToDegrees;
+  *out_altitude_m = anchor_.altitude_m + dalt;
+}
+
+size_t ProjectTrafficSnapshot(const LocalProjection &projection,
+                              double max_radius_m, TrafficSnapshot *snapshot) {
+  if (!snapshot || !(max_radius_m > 0.0)) {
+    return 0;
+  }
+
+  const ProjectionAnchor &anchor = projection.anchor();
+  const double max_radius_squared = max_radius_m * max_radius_m;
+  size_t projected = 0;
+  const size_t count = snapshot->size();
+  for (size_t i = 0; i < count; ++i) {
+    const double dx = snapshot->x[i] - anchor.x;
+    const double dz = snapshot->z[i] - anchor.z;
+    // NaN positions fail the comparison and stay on the exact path.
+    const bool in_range = (snapshot->flags[i] & TRAFFIC_FLAG_VALID) != 0u &&
+                          dx * dx + dz * dz <= max_radius_squared &&
+                          std::isfinite(snapshot->y[i]);
+    if (!in_range) {
+      snapshot->flags[i] &= static_cast<uint8_t>(~TRAFFIC_FLAG_GEODETIC);
+      continue;
+    }
+
+    double altitude_m = 0.0;
+    projection.project(snapshot->x[i], snapshot->y[i], snapshot->z[i],
+                       &snapshot->latitude[i], &snapshot->longitude[i],
+                       &altitude_m);
+    snapshot->altitude_ft[i] = altitude_m * kMetersToFeet;
+    snapshot->flags[i] |= TRAFFIC_FLAG_GEODETIC;
+    ++projected;
+  }
+  return projected;
+}
+
+} // namespace xp2gdl90::traffic
@@ -0,0 +1,276 @@
+#include "xp2gdl90/traffic_relay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <system_error>
+#include <utility>
+
+namespace xp2gdl90::traffic {
+namespace {
+
+constexpr double kDegreesToRadians = 3.14159265358979323846 / 180.0;
+constexpr double kKnotsToMetersPerSecond = 1852.0 / 3600.0;
+// Reports moved off the listener's queue per take.
+constexpr size_t kIngestChunk = 64;
+
+// Measures a relayed report from ownship. A report without a valid
+// velocity holds still, and one without an altitude is taken to be level
+// with ownship, so only the range limit applies to it.
+bool MeasureRelayedTarget(uint32_t row, const TrafficReference &ownship,
+                          const gdl90::PositionData &report,
+                          TrafficCandidate *out_candidate) {
+  const double altitude_ft =
+      report.altitude == std::numeric_limits<int32_t>::min()
+          ? ownship.altitude_ft
+          : static_cast<double>(report.altitude);
+  double vx = 0.0;
+  double vz = 0.0;
+  if (report.h_velocity != gdl90::VELOCITY_INVALID &&
+      report.track_type != gdl90::TrackType::INVALID) {
+    const double speed = report.h_velocity * kKnotsToMetersPerSecond;
+    const double track = report.track * kDegreesToRadians;
+    vx = speed * std::sin(track);
+    vz = -speed * std::cos(track);
+  }
+  return MeasureGeodeticTarget(row, ownship, report.latitude,
+                               report.longitude, altitude_ft, vx, vz,
+                               out_candidate);
+}
+
+} // namespace
+
+TrafficRelayListener::TrafficRelayListener(
+    std::unique_ptr<udp::UDPReceiver> receiver, int wait_timeout_ms)
+    : receiver_(std::move(receiver)),
+      listen_port_(receiver_ ? receiver_->getListenPort() : 0),
+      wait_timeout_ms_(wait_timeout_ms) {}
+
+TrafficRelayListener::~TrafficRelayListener() { stop(); }
+
+bool TrafficRelayListener::start() {
+  if (thread_.joinable()) {
+    return true;
+  }
+
+  stop_requested_.store(false);
+  try {
+    thread_ = std::thread(&TrafficRelayListener::run, this);
+  } catch (const std::system_error &error) {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    last_error_ =
+        std::string("Traffic relay thread failed to start: ") + error.what();
+    return false;
+  }
+  return true;
+}
+
+void TrafficRelayListener::stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  stop_requested_.store(true);
+  thread_.join();
+}
+
+int TrafficRelayListener::pollOnce(int timeout_ms) {
+  if (!receiver_) {
+    return -1;
+  }
+
+  const int ready = receiver_->waitReadable(timeout_ms);
+  int received = ready > 0 ? receiver_->drain(&batch_) : ready;
+  if (received < 0) {
+    error_count_.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    last_error_ = receiver_->getLastError();
+    return -1;
+  }
+
+  int queued = 0;
+  while (received > 0) {
+    datagrams_.fetch_add(batch_.count(), std::memory_order_relaxed);
+    const uint64_t bad_before = decoder_.crcErrors() + decoder_.malformed();
+    for (size_t i = 0; i < batch_.count(); ++i) {
+      decoder_.reset(batch_.data(i), batch_.size(i));
+      gdl90::FrameSpan frame;
+      while (decoder_.next(&frame)) {
+        if (frame.messageId() != gdl90::MSG_ID_TRAFFIC_REPORT) {
+          continue;
+        }
+        gdl90::PositionData *slot = reports_.producerSlot();
+        if (!slot) {
+          dropped_.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        if (gdl90::DecodePositionReport(frame, slot)) {
+          reports_.publish();
+          decoded_.fetch_add(1, std::memory_order_relaxed);
+          ++queued;
+        }
+      }
+    }
+    bad_frames_.fetch_add(decoder_.crcErrors() + decoder_.malformed() -
+                              bad_before,
+                          std::memory_order_relaxed);
+    // A full batch means more datagrams may be queued behind it.
+    received = batch_.count() == batch_.maxDatagrams()
+                   ? receiver_->drain(&batch_)
+                   : 0;
+  }
+  return queued;
+}
+
+size_t TrafficRelayListener::takeReports(gdl90::PositionData *out,
+                                         size_t capacity) {
+  const size_t count = std::min(reports_.readable(), capacity);
+  for (size_t i = 0; i < count; ++i) {
+    out[i] = reports_.peek(i);
+  }
+  reports_.release(count);
+  return count;
+}
+
+TrafficRelayStats TrafficRelayListener::stats() const {
+  TrafficRelayStats stats;
+  stats.datagrams = datagrams_.load(std::memory_order_relaxed);
+  stats.reports = decoded_.load(std::memory_order_relaxed);
+  stats.dropped = dropped_.load(std::memory_order_relaxed);
+  stats.bad_frames = bad_frames_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+std::string TrafficRelayListener::lastError() const {
+  std::lock_guard<std::mutex> lock(error_mutex_);
+  return last_error_;
+}
+
+void TrafficRelayListener::run() {
+  while (!stop_requested_.load()) {
+    tuning_.applyPending();
+    if (pollOnce(wait_timeout_ms_) < 0) {
+      // Avoid spinning on a persistent socket error.
+      std::this_thread::sleep_for(
+          std::chrono::milliseconds(wait_timeout_ms_));
+    }
+  }
+}
+
+size_t RelayedTraffic::ingest(TrafficRelayListener *listener, double now) {
+  if (!listener) {
+    return 0;
+  }
+  gdl90::PositionData chunk[kIngestChunk];
+  size_t total = 0;
+  size_t taken = 0;
+  while ((taken = listener->takeReports(chunk, kIngestChunk)) > 0) {
+    for (size_t i = 0; i < taken; ++i) {
+      update(chunk[i], now);
+    }
+    total += taken;
+  }
+  return total;
+}
+
+void RelayedTraffic::update(const gdl90::PositionData &report, double now) {
+  const size_t index = tracks_.upsert(report.icao_address, now);
+  if (index == reports_.size()) {
+    reports_.push_back(report);
+  } else {
+    reports_[index] = report;
+  }
+}
+
+size_t RelayedTraffic::evictStale(double now, double max_age) {
+  size_t removed = 0;
+  // From the back, so the track that removal swaps in was already checked.
+  for (size_t index = tracks_.size(); index-- > 0;) {
+    const TrackInfo &track = tracks_.track(index);
+    if (now - track.last_seen <= max_age) {
+      continue;
+    }
+    reports_[index] = reports_.back();
+    reports_.pop_back();
+    tracks_.remove(track.key, nullptr);
+    ++removed;
+  }
+  return removed;
+}
+
+void RelayedTraffic::clear() {
+  tracks_.clear();
+  reports_.clear();
+}
+
+RelayMergeStats RelayMerger::merge(const TrafficSelection &selection,
+                                   const TrafficReference *ownship,
+                                   RelayPriority priority,
+                                   uint32_t ownship_address,
+                                   const gdl90::PositionData *relayed,
+                                   size_t count,
+                                   std::vector<gdl90::PositionData> *reports) {
+  RelayMergeStats stats;
+  if (!reports || !relayed || count == 0) {
+    return stats;
+  }
+
+  addresses_.clear();
+  for (size_t i = 0; i < reports->size(); ++i) {
+    addresses_.push_back(
+        (static_cast<uint64_t>((*reports)[i].icao_address) << 32) | i);
+  }
+  std::sort(addresses_.begin(), addresses_.end());
+
+  candidates_.clear();
+  for (size_t i = 0; i < count; ++i) {
+    const gdl90::PositionData &report = relayed[i];
+    if (report.icao_address == ownship_address) {
+      continue;
+    }
+    const uint64_t key = static_cast<uint64_t>(report.icao_address) << 32;
+    const auto match =
+        std::lower_bound(addresses_.begin(), addresses_.end(), key);
+    if (match != addresses_.end() && (*match >> 32) == (key >> 32)) {
+      if (priority == RelayPriority::RELAY) {
+        (*reports)[static_cast<uint32_t>(*match)] = report;
+        ++stats.replaced;
+      }
+      continue;
+    }
+    TrafficCandidate candidate;
+    candidate.row = static_cast<uint32_t>(i);
+    if (!ownship ||
+        MeasureRelayedTarget(candidate.row, *ownship, report, &candidate)) {
+      candidates_.push_back(candidate);
+    }
+  }
+
+  // Zero max_targets leaves the count unlimited.
+  TrafficSelection remaining = selection;
+  if (selection.max_targets > 0) {
+    if (reports->size() >= selection.max_targets) {
+      return stats;
+    }
+    remaining.max_targets = selection.max_targets - reports->size();
+  }
+  if (ownship) {
+    SelectNearestTraffic(remaining, &candidates_);
+    // Back into feed order, so the merge does not depend on the partial
+    // sort.
+    std::sort(candidates_.begin(), candidates_.end(),
+              [](const TrafficCandidate &a, const TrafficCandidate &b) {
+                return a.row < b.row;
+              });
+  } else if (remaining.max_targets > 0 &&
+             candidates_.size() > remaining.max_targets) {
+    candidates_.resize(remaining.max_targets);
+  }
+  for (const TrafficCandidate &candidate : candidates_) {
+    reports->push_back(relayed[candidate.row]);
+  }
+  stats.added = candidates_.size();
+  return stats;
+}
+
+} // namespace xp2gdl90::traffic
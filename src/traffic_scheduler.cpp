@@ -0,0 +1,150 @@
+#include "xp2gdl90/traffic_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace xp2gdl90::traffic {
+namespace {
+
+constexpr double kDegreesToRadians = 3.14159265358979323846 / 180.0;
+constexpr double kKnotsToMetersPerSecond = 1852.0 / 3600.0;
+
+struct DueReport {
+  size_t report = 0;
+  size_t track = 0;
+  double lateness = 0.0; // Seconds past due over the interval.
+};
+
+// Deterministic phase in [0, 1) from the address.
+double AddressPhase(uint32_t address) {
+  return static_cast<double>((address * 0x9E3779B1u) >> 8) / 16777216.0;
+}
+
+void ReportVelocity(const gdl90::PositionData &report, double *out_vx,
+                    double *out_vz) {
+  if (report.h_velocity == gdl90::VELOCITY_INVALID ||
+      report.track_type == gdl90::TrackType::INVALID) {
+    *out_vx = NAN;
+    *out_vz = NAN;
+    return;
+  }
+  const double speed = report.h_velocity * kKnotsToMetersPerSecond;
+  const double track = report.track * kDegreesToRadians;
+  *out_vx = speed * std::sin(track);
+  *out_vz = -speed * std::cos(track);
+}
+
+} // namespace
+
+TrafficRatePolicy MakeTrafficRatePolicy(const Settings &cfg) {
+  TrafficRatePolicy policy;
+  policy.max_frames_per_second = cfg.traffic_max_frames_per_second;
+  return policy;
+}
+
+double TrafficUpdateInterval(const TrafficRatePolicy &policy, double range_m,
+                             double closure_mps) {
+  if (!std::isfinite(range_m)) {
+    return policy.far_interval_s;
+  }
+  double rated = range_m;
+  if (std::isfinite(closure_mps) && closure_mps > 0.0) {
+    rated = (std::max)(0.0, range_m - closure_mps * policy.closure_horizon_s);
+  }
+  const double span = policy.far_range_m - policy.near_range_m;
+  const double t =
+      span > 0.0
+          ? std::clamp((rated - policy.near_range_m) / span, 0.0, 1.0)
+          : (rated <= policy.near_range_m ? 0.0 : 1.0);
+  return policy.near_interval_s +
+         t * (policy.far_interval_s - policy.near_interval_s);
+}
+
+size_t ScheduleTrafficReports(const TrafficRatePolicy &policy,
+                              const TrafficReference &ownship, double now,
+                              double sweep_interval_s, TrackTable *tracks,
+                              std::vector<gdl90::PositionData> *reports,
+                              TrafficScheduleStats *out_stats) {
+  TrafficScheduleStats stats;
+  if (!tracks || !reports) {
+    if (out_stats) {
+      *out_stats = stats;
+    }
+    return 0;
+  }
+
+  // A target is sent on the sweep nearest its due time.
+  const double tolerance = (std::max)(0.0, sweep_interval_s) * 0.5;
+  std::vector<DueReport> due;
+  due.reserve(reports->size());
+  for (size_t i = 0; i < reports->size(); ++i) {
+    const gdl90::PositionData &report = (*reports)[i];
+    const size_t index = tracks->upsert(report.icao_address, now);
+
+    double vx = NAN;
+    double vz = NAN;
+    ReportVelocity(report, &vx, &vz);
+    TrafficCandidate candidate;
+    const double interval =
+        MeasureGeodeticTarget(0, ownship, report.latitude, report.longitude,
+                              report.altitude, vx, vz, &candidate)
+            ? TrafficUpdateInterval(policy, candidate.range_m,
+                                    candidate.closure_mps)
+            : policy.far_interval_s;
+
+    double next_send = tracks->track(index).next_send;
+    if (std::isnan(next_send)) {
+      next_send = now + AddressPhase(report.icao_address) * interval;
+    }
+    // A target that moved into a faster band should not wait out its old
+    // interval.
+    next_send = (std::min)(next_send, now + interval);
+    tracks->setSchedule(index, next_send, interval);
+
+    if (next_send <= now + tolerance) {
+      due.push_back(DueReport{i, index, (now - next_send) / interval});
+    }
+  }
+  stats.due = due.size();
+
+  if (policy.max_frames_per_second > 0.0) {
+    const size_t budget = (std::max)(
+        static_cast<size_t>(1),
+        static_cast<size_t>(policy.max_frames_per_second * sweep_interval_s));
+    if (due.size() > budget) {
+      std::nth_element(due.begin(),
+                       due.begin() + static_cast<std::ptrdiff_t>(budget),
+                       due.end(), [](const DueReport &a, const DueReport &b) {
+                         return a.lateness > b.lateness;
+                       });
+      stats.deferred = due.size() - budget;
+      due.resize(budget);
+      std::sort(due.begin(), due.end(),
+                [](const DueReport &a, const DueReport &b) {
+                  return a.report < b.report;
+                });
+    }
+  }
+
+  size_t kept = 0;
+  for (const DueReport &entry : due) {
+    const TrackInfo &track = tracks->track(entry.track);
+    double next_send = track.next_send + track.send_interval;
+    if (next_send <= now) {
+      next_send = now + track.send_interval;
+    }
+    tracks->setSchedule(entry.track, next_send, track.send_interval);
+    if (kept != entry.report) {
+      (*reports)[kept] = std::move((*reports)[entry.report]);
+    }
+    ++kept;
+  }
+  reports->resize(kept);
+  stats.sent = kept;
+  if (out_stats) {
+    *out_stats = stats;
+  }
+  return kept;
+}
+
+} // namespace xp2gdl90::traffic
@@ -0,0 +1,176 @@
+#include "xp2gdl90/traffic_selection.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "xp2gdl90/traffic_projection.h"
+
+namespace xp2gdl90::traffic {
+namespace {
+
+constexpr double kDegreesToRadians = 3.14159265358979323846 / 180.0;
+constexpr double kMetersToFeet = 3.28084;
+constexpr double kFeetToMeters = 0.3048;
+// Mean earth radius; plenty for ranking targets a few hundred miles out.
+constexpr double kEarthRadiusMeters = 6371008.8;
+
+} // namespace
+
+TrafficSelection MakeTrafficSelection(const Settings &cfg) {
+  TrafficSelection selection;
+  selection.max_targets = cfg.traffic_max_targets;
+  selection.max_range_m = cfg.traffic_range_nm * METERS_PER_NAUTICAL_MILE;
+  selection.max_altitude_delta_ft = cfg.traffic_altitude_band_ft;
+  selection.closure_lookahead_s = cfg.traffic_closure_lookahead_s;
+  return selection;
+}
+
+bool MakeTrafficCandidate(uint32_t row, double dx, double dy, double dz,
+                          double dvx, double dvz,
+                          TrafficCandidate *out_candidate) {
+  if (!out_candidate || !std::isfinite(dx) || !std::isfinite(dy) ||
+      !std::isfinite(dz)) {
+    return false;
+  }
+
+  const double range = std::hypot(dx, dz);
+  double closure = 0.0;
+  if (range > 0.0) {
+    closure = -(dx * dvx + dz * dvz) / range;
+  }
+  if (!std::isfinite(closure)) {
+    closure = 0.0;
+  }
+
+  out_candidate->row = row;
+  out_candidate->range_m = static_cast<float>(range);
+  out_candidate->closure_mps = static_cast<float>(closure);
+  out_candidate->altitude_delta_ft = static_cast<float>(dy * kMetersToFeet);
+  out_candidate->score = out_candidate->range_m;
+  return true;
+}
+
+void MeasureLocalTraffic(const TrafficSnapshot &snapshot,
+                         const TrafficReference &ownship,
+                         std::vector<TrafficCandidate> *out_candidates) {
+  if (!out_candidates) {
+    return;
+  }
+  const size_t count = snapshot.size();
+  for (size_t i = 0; i < count; ++i) {
+    if ((snapshot.flags[i] & TRAFFIC_FLAG_VALID) == 0u) {
+      continue;
+    }
+    TrafficCandidate candidate;
+    if (MakeTrafficCandidate(
+            static_cast<uint32_t>(i), snapshot.x[i] - ownship.x,
+            snapshot.y[i] - ownship.y, snapshot.z[i] - ownship.z,
+            snapshot.vx[i] - ownship.vx, snapshot.vz[i] - ownship.vz,
+            &candidate)) {
+      out_candidates->push_back(candidate);
+    }
+  }
+}
+
+bool MeasureGeodeticTarget(uint32_t row, const TrafficReference &ownship,
+                           double latitude_deg, double longitude_deg,
+                           double altitude_ft, double vx, double vz,
+                           TrafficCandidate *out_candidate) {
+  constexpr double kMetersPerDegree = kEarthRadiusMeters * kDegreesToRadians;
+  double dlon = longitude_deg - ownship.longitude_deg;
+  if (dlon > 180.0) {
+    dlon -= 360.0;
+  } else if (dlon < -180.0) {
+    dlon += 360.0;
+  }
+  const double east = dlon * kMetersPerDegree *
+                      std::cos(ownship.latitude_deg * kDegreesToRadians);
+  const double north = (latitude_deg - ownship.latitude_deg) * kMetersPerDegree;
+  return MakeTrafficCandidate(
+      row, east, (altitude_ft - ownship.altitude_ft) * kFeetToMeters, -north,
+      vx - ownship.vx, vz - ownship.vz, out_candidate);
+}
+
+void MeasureGeodeticTraffic(const TrafficSnapshot &snapshot,
+                            const TrafficReference &ownship,
+                            std::vector<TrafficCandidate> *out_candidates) {
+  MeasureGeodeticTraffic(snapshot, ownship, 0, snapshot.size(),
+                         out_candidates);
+}
+
+void MeasureGeodeticTraffic(const TrafficSnapshot &snapshot,
+                            const TrafficReference &ownship, size_t begin,
+                            size_t end,
+                            std::vector<TrafficCandidate> *out_candidates) {
+  if (!out_candidates) {
+    return;
+  }
+  for (size_t i = begin; i < end; ++i) {
+    if ((snapshot.flags[i] & TRAFFIC_FLAG_VALID) == 0u) {
+      continue;
+    }
+    TrafficCandidate candidate;
+    if (MeasureGeodeticTarget(static_cast<uint32_t>(i), ownship,
+                              snapshot.latitude[i], snapshot.longitude[i],
+                              snapshot.altitude_ft[i], snapshot.vx[i],
+                              snapshot.vz[i], &candidate)) {
+      out_candidates->push_back(candidate);
+    }
+  }
+}
+
+size_t SelectNearestTraffic(const TrafficSelection &selection,
+                            std::vector<TrafficCandidate> *candidates) {
+  if (!candidates) {
+    return 0;
+  }
+
+  const bool limit_range = selection.max_range_m > 0.0;
+  const bool limit_altitude = selection.max_altitude_delta_ft > 0.0;
+  const double lookahead =
+      selection.closure_lookahead_s > 0.0 ? selection.closure_lookahead_s : 0.0;
+  size_t kept = 0;
+  for (const TrafficCandidate &candidate : *candidates) {
+    if ((limit_range && !(candidate.range_m <= selection.max_range_m)) ||
+        (limit_altitude && !(std::fabs(candidate.altitude_delta_ft) <=
+                             selection.max_altitude_delta_ft))) {
+      continue;
+    }
+    TrafficCandidate &out = (*candidates)[kept++];
+    out = candidate;
+    out.score = static_cast<float>((std::max)(
+        0.0, candidate.range_m - candidate.closure_mps * lookahead));
+  }
+  candidates->resize(kept);
+
+  if (candidates->size() > selection.max_targets) {
+    const auto nth = candidates->begin() +
+                     static_cast<std::ptrdiff_t>(selection.max_targets);
+    std::nth_element(candidates->begin(), nth, candidates->end(),
+                     [](const TrafficCandidate &a, const TrafficCandidate &b) {
+                       return a.score < b.score;
+                     });
+    candidates->resize(selection.max_targets);
+  }
+  return candidates->size();
+}
+
+size_t SelectNearestTraffic(const TrafficSelection &selection,
+                            std::vector<TrafficCandidate> *candidates,
+                            TrafficSnapshot *snapshot) {
+  const size_t selected = SelectNearestTraffic(selection, candidates);
+  if (!candidates || !snapshot) {
+    return selected;
+  }
+  for (uint8_t &flags : snapshot->flags) {
+    flags &= static_cast<uint8_t>(~TRAFFIC_FLAG_VALID);
+  }
+  for (const TrafficCandidate &candidate : *candidates) {
+    if (candidate.row < snapshot->size()) {
+      snapshot->flags[candidate.row] |= TRAFFIC_FLAG_VALID;
+    }
+  }
+  return selected;
+}
+
+} // namespace xp2gdl90::traffic
@@ -0,0 +1,58 @@
+#include "xp2gdl90/traffic_smoothing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace xp2gdl90::traffic {
+namespace {
+
+constexpr double kMetersPerSecondToKnots = 3600.0 / 1852.0;
+// Same threshold as ResolveTrafficTrack().
+constexpr double kMinTrackSpeedMps = 0.5;
+constexpr double kMaxVerticalRateFpm = 32000.0;
+
+} // namespace
+
+size_t SmoothTrafficReports(double now, double min_span_s, TrackTable *tracks,
+                            std::vector<gdl90::PositionData> *reports) {
+  if (!tracks || !reports || !tracks->hasHistory()) {
+    return 0;
+  }
+  size_t smoothed = 0;
+  for (gdl90::PositionData &report : *reports) {
+    const size_t index = tracks->upsert(report.icao_address, now);
+    const double altitude =
+        report.altitude == std::numeric_limits<int32_t>::min()
+            ? NAN
+            : static_cast<double>(report.altitude);
+    tracks->pushSample(index, now, report.latitude, report.longitude,
+                       altitude);
+
+    TrackTrend trend;
+    if (!FitTrackTrend(tracks->history(index), min_span_s, &trend)) {
+      continue;
+    }
+    if (trend.has_velocity) {
+      report.h_velocity = static_cast<uint16_t>(std::lround((std::min)(
+          trend.ground_speed_mps * kMetersPerSecondToKnots,
+          static_cast<double>(gdl90::VELOCITY_INVALID - 1))));
+      if (trend.ground_speed_mps >= kMinTrackSpeedMps) {
+        report.track =
+            static_cast<uint16_t>(static_cast<int>(trend.track_deg) % 360);
+        report.track_type = gdl90::TrackType::TRUE_TRACK;
+      }
+    }
+    if (trend.has_vertical_rate &&
+        report.altitude != std::numeric_limits<int32_t>::min()) {
+      report.v_velocity = static_cast<int16_t>(std::lround(
+          std::clamp(trend.vertical_rate_fpm, -kMaxVerticalRateFpm,
+                     kMaxVerticalRateFpm)));
+    }
+    ++smoothed;
+  }
+  return smoothed;
+}
+
+} // namespace xp2gdl90::traffic
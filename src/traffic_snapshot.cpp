@@ -0,0 +1,93 @@
+#include "xp2gdl90/traffic_snapshot.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace xp2gdl90::traffic {
+namespace {
+
+template <typename T> void RemoveUnordered(std::vector<T> *column, size_t row) {
+  (*column)[row] = column->back();
+  column->pop_back();
+}
+
+} // namespace
+
+void TrafficSnapshot::resize(size_t count) {
+  source_id.resize(count, 0);
+  raw_address.resize(count, 0);
+  x.resize(count, 0.0f);
+  y.resize(count, 0.0f);
+  z.resize(count, 0.0f);
+  latitude.resize(count, 0.0);
+  longitude.resize(count, 0.0);
+  altitude_ft.resize(count, 0.0);
+  vx.resize(count, 0.0f);
+  vy.resize(count, 0.0f);
+  vz.resize(count, 0.0f);
+  ground_speed_kt.resize(count, NAN);
+  vertical_speed_fpm.resize(count, NAN);
+  heading_deg.resize(count, NAN);
+  ssr_mode.resize(count, -1);
+  weight_on_wheels.resize(count, -1);
+  squawk.resize(count, 0);
+  wake_category.resize(count, -1);
+  callsign.resize(count, TrafficCallsign{});
+  flags.resize(count, 0);
+  synthetic_address.resize(count, 0);
+  address.resize(count, 0);
+  h_velocity_kt.resize(count, 0);
+  v_velocity_fpm.resize(count, 0);
+}
+
+size_t TrafficSnapshot::append() {
+  const size_t index = size();
+  resize(index + 1);
+  return index;
+}
+
+void TrafficSnapshot::removeRow(size_t row) {
+  if (row >= size()) {
+    return;
+  }
+  RemoveUnordered(&source_id, row);
+  RemoveUnordered(&raw_address, row);
+  RemoveUnordered(&x, row);
+  RemoveUnordered(&y, row);
+  RemoveUnordered(&z, row);
+  RemoveUnordered(&latitude, row);
+  RemoveUnordered(&longitude, row);
+  RemoveUnordered(&altitude_ft, row);
+  RemoveUnordered(&vx, row);
+  RemoveUnordered(&vy, row);
+  RemoveUnordered(&vz, row);
+  RemoveUnordered(&ground_speed_kt, row);
+  RemoveUnordered(&vertical_speed_fpm, row);
+  RemoveUnordered(&heading_deg, row);
+  RemoveUnordered(&ssr_mode, row);
+  RemoveUnordered(&weight_on_wheels, row);
+  RemoveUnordered(&squawk, row);
+  RemoveUnordered(&wake_category, row);
+  RemoveUnordered(&callsign, row);
+  RemoveUnordered(&flags, row);
+  RemoveUnordered(&synthetic_address, row);
+  RemoveUnordered(&address, row);
+  RemoveUnordered(&h_velocity_kt, row);
+  RemoveUnordered(&v_velocity_fpm, row);
+}
+
+TrafficCallsign MakeTrafficCallsign(const gdl90::Callsign &callsign) {
+  TrafficCallsign bytes{};
+  std::copy(callsign.begin(), callsign.end(), bytes.begin());
+  return bytes;
+}
+
+gdl90::Callsign ToCallsign(const TrafficCallsign &callsign) {
+  return gdl90::Callsign::fromBytes(callsign.data(), callsign.size());
+}
+
+std::string TrafficCallsignToString(const TrafficCallsign &callsign) {
+  return ToCallsign(callsign).str();
+}
+
+} // namespace xp2gdl90::traffic
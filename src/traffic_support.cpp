@@ -4,6 +4,8 @@
 #include <cmath>
 #include <limits>
 
+#include "xp2gdl90/protocol_utils.h"
+
 namespace xp2gdl90::traffic {
 namespace {
 
@@ -25,28 +27,41 @@ bool HasMeaningfulMotion(double value) {
          std::abs(value) > kPresenceEpsilon;
 }
 
-} // namespace
-
-bool IsPopulatedTcasTarget(const TcasPresenceSample &sample) {
-  if (sample.slot == 0 ||
-      !IsUsableMagnitude(sample.local_x, kMaxLocalCoordinateMagnitude) ||
-      !IsUsableMagnitude(sample.local_y, kMaxLocalCoordinateMagnitude) ||
-      !IsUsableMagnitude(sample.local_z, kMaxLocalCoordinateMagnitude)) {
+bool IsPopulated(size_t slot, int raw_address, int ssr_mode, bool has_callsign,
+                 double local_x, double local_y, double local_z,
+                 double velocity_x, double velocity_y, double velocity_z) {
+  if (slot == 0 ||
+      !IsUsableMagnitude(local_x, kMaxLocalCoordinateMagnitude) ||
+      !IsUsableMagnitude(local_y, kMaxLocalCoordinateMagnitude) ||
+      !IsUsableMagnitude(local_z, kMaxLocalCoordinateMagnitude)) {
     return false;
   }
 
-  const uint32_t address =
-      static_cast<uint32_t>(sample.raw_address) & kAddressMask;
-  return address != 0u || !sample.callsign.empty() || sample.ssr_mode > 0 ||
-         std::abs(sample.local_x) > kPresenceEpsilon ||
-         std::abs(sample.local_y) > kPresenceEpsilon ||
-         std::abs(sample.local_z) > kPresenceEpsilon ||
-         HasMeaningfulMotion(sample.velocity_x) ||
-         HasMeaningfulMotion(sample.velocity_y) ||
-         HasMeaningfulMotion(sample.velocity_z);
+  const uint32_t address = static_cast<uint32_t>(raw_address) & kAddressMask;
+  return address != 0u || has_callsign || ssr_mode > 0 ||
+         std::abs(local_x) > kPresenceEpsilon ||
+         std::abs(local_y) > kPresenceEpsilon ||
+         std::abs(local_z) > kPresenceEpsilon ||
+         HasMeaningfulMotion(velocity_x) || HasMeaningfulMotion(velocity_y) ||
+         HasMeaningfulMotion(velocity_z);
+}
+
+template <typename Int> Int ClampToInt(double value) {
+  const double lo = static_cast<double>(std::numeric_limits<Int>::min());
+  const double hi = static_cast<double>(std::numeric_limits<Int>::max());
+  return static_cast<Int>((std::max)(lo, (std::min)(hi, value)));
 }
 
-uint32_t SyntheticTrafficAddress(size_t slot, const std::string &callsign,
+} // namespace
+
+bool IsPopulatedTcasTarget(const TcasPresenceSample &sample) {
+  return IsPopulated(sample.slot, sample.raw_address, sample.ssr_mode,
+                     !sample.callsign.empty(), sample.local_x, sample.local_y,
+                     sample.local_z, sample.velocity_x, sample.velocity_y,
+                     sample.velocity_z);
+}
+
+uint32_t SyntheticTrafficAddress(size_t slot, const gdl90::Callsign &callsign,
                                  uint32_t ownship_address) {
   uint32_t hash = 2166136261u;
   const auto mix = [&hash](uint8_t value) {
@@ -90,4 +105,133 @@ int32_t CorrectGeometricToPressureAltitude(int32_t geometric_altitude_feet,
   return static_cast<int32_t>((std::max)(low, (std::min)(high, corrected)));
 }
 
+size_t MarkPopulatedTcasTargets(TrafficSnapshot *snapshot) {
+  size_t valid = 0;
+  for (size_t i = 0; i < snapshot->size(); ++i) {
+    const bool populated = IsPopulated(
+        snapshot->source_id[i], snapshot->raw_address[i],
+        snapshot->ssr_mode[i], snapshot->callsign[i][0] != '\0',
+        snapshot->x[i], snapshot->y[i], snapshot->z[i], snapshot->vx[i],
+        snapshot->vy[i], snapshot->vz[i]);
+    snapshot->flags[i] = static_cast<uint8_t>(
+        (snapshot->flags[i] & ~TRAFFIC_FLAG_VALID) |
+        (populated ? TRAFFIC_FLAG_VALID : 0u));
+    valid += populated ? 1u : 0u;
+  }
+  return valid;
+}
+
+size_t MarkValidGeodeticTargets(TrafficSnapshot *snapshot) {
+  return MarkValidGeodeticTargets(snapshot, 0, snapshot->size());
+}
+
+size_t MarkValidGeodeticTargets(TrafficSnapshot *snapshot, size_t begin,
+                                size_t end) {
+  size_t valid = 0;
+  for (size_t i = begin; i < end; ++i) {
+    const bool in_range = protocol::HasValidOwnshipPosition(
+        snapshot->latitude[i], snapshot->longitude[i]);
+    snapshot->flags[i] = static_cast<uint8_t>(
+        (snapshot->flags[i] & ~TRAFFIC_FLAG_VALID) |
+        (in_range ? TRAFFIC_FLAG_VALID : 0u));
+    valid += in_range ? 1u : 0u;
+  }
+  return valid;
+}
+
+void AssignTcasAddresses(TrafficSnapshot *snapshot, uint32_t ownship_address) {
+  const uint32_t ownship = ownship_address & kAddressMask;
+  for (size_t i = 0; i < snapshot->size(); ++i) {
+    uint32_t address =
+        static_cast<uint32_t>(snapshot->raw_address[i]) & kAddressMask;
+    uint8_t flags = static_cast<uint8_t>(snapshot->flags[i] &
+                                         ~TRAFFIC_FLAG_SYNTHETIC_ADDRESS);
+    if (address == 0u && (flags & TRAFFIC_FLAG_VALID) != 0u) {
+      // Hashing is only worth doing for rows that will be reported.
+      address = snapshot->synthetic_address[i];
+      if (address == 0u) {
+        address = SyntheticTrafficAddress(snapshot->source_id[i],
+                                          ToCallsign(snapshot->callsign[i]),
+                                          ownship_address);
+      }
+      flags |= TRAFFIC_FLAG_SYNTHETIC_ADDRESS;
+    }
+    if (address == ownship) {
+      flags = static_cast<uint8_t>(flags & ~TRAFFIC_FLAG_VALID);
+    }
+    snapshot->address[i] = address;
+    snapshot->flags[i] = flags;
+  }
+}
+
+void ConvertTrafficVelocities(TrafficSnapshot *snapshot) {
+  ConvertTrafficVelocities(snapshot, 0, snapshot->size());
+}
+
+void ConvertTrafficVelocities(TrafficSnapshot *snapshot, size_t begin,
+                              size_t end) {
+  constexpr double kMetersPerSecondToKnots = 1.94384;
+  constexpr double kMetersPerSecondToFeetPerMinute = 196.8504;
+  constexpr uint16_t kVelocityInvalid = 0xFFF;
+
+  for (size_t i = begin; i < end; ++i) {
+    const double vx = snapshot->vx[i];
+    const double vz = snapshot->vz[i];
+    const double ground_speed = snapshot->ground_speed_kt[i];
+    const double speed_kt = std::isfinite(ground_speed)
+                                ? (std::max)(0.0, ground_speed)
+                                : std::sqrt(vx * vx + vz * vz) *
+                                      kMetersPerSecondToKnots;
+    snapshot->h_velocity_kt[i] = std::isfinite(speed_kt)
+                                     ? ClampToInt<uint16_t>(speed_kt)
+                                     : kVelocityInvalid;
+
+    const double reported_fpm = snapshot->vertical_speed_fpm[i];
+    const double fpm =
+        std::isfinite(reported_fpm)
+            ? reported_fpm
+            : static_cast<double>(snapshot->vy[i]) *
+                  kMetersPerSecondToFeetPerMinute;
+    // INT16_MIN is the encoder's "no vertical rate" sentinel.
+    snapshot->v_velocity_fpm[i] =
+        std::isfinite(fpm)
+            ? (std::max)(static_cast<int16_t>(
+                             std::numeric_limits<int16_t>::min() + 1),
+                         ClampToInt<int16_t>(fpm))
+            : std::numeric_limits<int16_t>::min();
+  }
+}
+
+bool TrafficIdentityCache::needsRefresh(size_t slot, int raw_address,
+                                        uint32_t ownship_address,
+                                        double now_s) const {
+  if (slot >= entries_.size()) {
+    return true;
+  }
+  const Entry &entry = entries_[slot];
+  return !entry.stored || entry.raw_address != raw_address ||
+         entry.ownship_address != ownship_address ||
+         !(now_s >= entry.refreshed_s &&
+           now_s - entry.refreshed_s < refresh_s_);
+}
+
+const TrafficIdentity &
+TrafficIdentityCache::store(size_t slot, int raw_address,
+                            const gdl90::Callsign &callsign,
+                            uint32_t ownship_address, double now_s) {
+  if (slot >= entries_.size()) {
+    entries_.resize(slot + 1);
+  }
+  Entry &entry = entries_[slot];
+  entry.identity.callsign = MakeTrafficCallsign(callsign);
+  entry.identity.synthetic_address =
+      SyntheticTrafficAddress(slot, callsign, ownship_address);
+  entry.raw_address = raw_address;
+  entry.ownship_address = ownship_address;
+  entry.refreshed_s = now_s;
+  entry.stored = true;
+  ++refreshes_;
+  return entry.identity;
+}
+
 } // namespace xp2gdl90::traffic
@@ -0,0 +1,174 @@
+#include "xp2gdl90/traffic_worker.h"
+
+#include <chrono>
+#include <system_error>
+
+#include "xp2gdl90/traffic_extrapolation.h"
+
+namespace xp2gdl90::traffic {
+
+namespace {
+
+int64_t NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+void TrafficSweeper::sweep(const TrafficSweepParams &params,
+                           TrafficSnapshot *snapshot,
+                           TrafficSweepResult *out_result) {
+  const LocalProjection projection(params.anchor);
+  CollectTcasTraffic(params.selection, params.context,
+                     params.anchored ? &projection : nullptr,
+                     params.projection_radius_m, snapshot, &candidates_,
+                     &reports_);
+  finish(params, &reports_, out_result);
+}
+
+void TrafficSweeper::finish(const TrafficSweepParams &params,
+                            std::vector<gdl90::PositionData> *reports,
+                            TrafficSweepResult *out_result) {
+  if (params.reset_tracks) {
+    tracks_.clear();
+  }
+  TrafficSweepResult &result = *out_result;
+  result.broadcast_time = params.broadcast_time;
+  result.pacing_window_s = params.pacing_window_s;
+  const RelayMergeStats merged = merger_.merge(
+      params.selection, &params.ownship, params.relay_priority,
+      params.context.ownship_address, params.relayed, params.relayed_count,
+      reports);
+  result.relayed_count = merged.added;
+  result.target_count = reports->size();
+  result.schedule = TrafficScheduleStats{};
+  tracks_.setHistoryEnabled(params.smoothing);
+  if (params.smoothing) {
+    // Before the scheduler, so held-back targets still add a sample.
+    SmoothTrafficReports(params.broadcast_time, TRAFFIC_SMOOTHING_MIN_SPAN_S,
+                         &tracks_, reports);
+  }
+  if (params.adaptive_rate) {
+    ScheduleTrafficReports(params.rate_policy, params.ownship,
+                           params.broadcast_time, params.sweep_interval_s,
+                           &tracks_, reports, &result.schedule);
+  } else if (!params.smoothing) {
+    for (const gdl90::PositionData &report : *reports) {
+      tracks_.upsert(report.icao_address, params.broadcast_time);
+    }
+  }
+  tracks_.evictStale(params.broadcast_time, params.stale_after_s, nullptr);
+
+  result.extrapolation_s = 0.0;
+  if (params.extrapolation_horizon_s > 0.0 && !reports->empty()) {
+    result.extrapolation_s = ExtrapolateTrafficReports(
+        params.lead_s,
+        params.pacing_window_s / static_cast<double>(reports->size()),
+        params.extrapolation_horizon_s, reports);
+  }
+
+  encoder_.encodeTrafficBatch(reports->data(), reports->size(), result.frames,
+                              &frame_cache_);
+  result.tracked = tracks_.size();
+  result.cache_hits = frame_cache_.hits();
+  result.cache_misses = frame_cache_.misses();
+}
+
+TrafficWorker::TrafficWorker(size_t capacity)
+    : jobs_(capacity), results_(capacity) {}
+
+TrafficWorker::~TrafficWorker() { stop(); }
+
+bool TrafficWorker::start(std::string *out_error) {
+  if (thread_.joinable()) {
+    return true;
+  }
+
+  stop_requested_.store(false);
+  try {
+    thread_ = std::thread(&TrafficWorker::run, this);
+  } catch (const std::system_error &error) {
+    if (out_error) {
+      *out_error =
+          std::string("Traffic thread failed to start: ") + error.what();
+    }
+    return false;
+  }
+  return true;
+}
+
+void TrafficWorker::stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+
+  stop_requested_.store(true);
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+  }
+  wake_.notify_one();
+  thread_.join();
+}
+
+TrafficSweepJob *TrafficWorker::jobSlot() {
+  TrafficSweepJob *job = jobs_.producerSlot();
+  if (!job) {
+    ++skipped_;
+  }
+  return job;
+}
+
+void TrafficWorker::submit() {
+  jobs_.publish();
+  ++submitted_;
+  wake_latency_.notified(NowNs());
+  wake_.notify_one();
+}
+
+bool TrafficWorker::takeResult(TrafficSweepResult *out_result) {
+  const size_t ready = results_.readable();
+  if (ready == 0) {
+    return false;
+  }
+  *out_result = results_.peek(ready - 1);
+  results_.release(ready);
+  taken_ += ready;
+  // The worker may be holding a job until a result slot frees up.
+  wake_.notify_one();
+  return true;
+}
+
+size_t TrafficWorker::drain() {
+  size_t done = 0;
+  while (jobs_.readable() > 0) {
+    TrafficSweepResult *result = results_.producerSlot();
+    if (!result) {
+      break;
+    }
+    TrafficSweepJob &job = jobs_.peek(0);
+    sweeper_.sweep(job.params, &job.snapshot, result);
+    results_.publish();
+    jobs_.release(1);
+    ++done;
+  }
+  return done;
+}
+
+void TrafficWorker::run() {
+  while (!stop_requested_.load()) {
+    tuning_.applyPending();
+    drain();
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    // The timeout bounds latency if a notify races with the check.
+    const bool for_work =
+        wake_.wait_for(lock, std::chrono::milliseconds(5), [this] {
+          return stop_requested_.load() ||
+                 (jobs_.readable() > 0 && results_.freeSlots() > 0);
+        });
+    wake_latency_.woke(NowNs(), for_work);
+  }
+}
+
+} // namespace xp2gdl90::traffic
@@ -1,5 +1,9 @@
 #include "xp2gdl90/udp_broadcaster.h"
 
+#include "xp2gdl90/protocol_utils.h"
+#include "xp2gdl90/stream_capture.h"
+
+#include <algorithm>
 #include <cstring>
 
 #ifdef _WIN32
@@ -18,11 +22,15 @@
 #include <errno.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #endif
 
 namespace udp {
 
+static_assert(sizeof(sockaddr_in) <= 16,
+              "cached target address must fit sockaddr_in");
+
 namespace {
 
 #ifdef _WIN32
@@ -39,6 +47,19 @@ std::string SocketErrorMessage(const char *prefix, int code) {
 
 namespace detail {
 
+intptr_t SocketOps::SendBatch(uintptr_t socket, const SendBuffer *buffers,
+                              size_t count, int flags, const void *dest_addr,
+                              size_t addrlen) {
+  size_t sent = 0;
+  for (; sent < count; ++sent) {
+    if (SendTo(socket, buffers[sent].data, buffers[sent].size, flags,
+               dest_addr, addrlen) < 0) {
+      break;
+    }
+  }
+  return (sent == 0 && count > 0) ? -1 : static_cast<intptr_t>(sent);
+}
+
 class DefaultSocketOpsImpl final : public SocketOps {
 public:
   int Startup() override {
@@ -94,6 +115,19 @@ public:
 #endif
   }
 
+  int Bind(uintptr_t socket_handle, const void *addr,
+           size_t addrlen) override {
+#ifdef _WIN32
+    return ::bind(static_cast<SOCKET>(socket_handle),
+                  reinterpret_cast<const sockaddr *>(addr),
+                  static_cast<int>(addrlen));
+#else
+    return ::bind(static_cast<int>(socket_handle),
+                  reinterpret_cast<const sockaddr *>(addr),
+                  static_cast<socklen_t>(addrlen));
+#endif
+  }
+
   intptr_t SendTo(uintptr_t socket_handle, const void *buf, size_t len,
                   int flags, const void *dest_addr, size_t addrlen) override {
 #ifdef _WIN32
@@ -115,6 +149,40 @@ public:
 #endif
   }
 
+#if defined(__linux__)
+  intptr_t SendBatch(uintptr_t socket_handle, const SendBuffer *buffers,
+                     size_t count, int flags, const void *dest_addr,
+                     size_t addrlen) override {
+    constexpr size_t kChunk = 64;
+    const int socket_value = static_cast<int>(socket_handle);
+    size_t sent = 0;
+    while (sent < count) {
+      mmsghdr messages[kChunk];
+      iovec vectors[kChunk];
+      const size_t chunk = std::min(kChunk, count - sent);
+      std::memset(messages, 0, sizeof(messages[0]) * chunk);
+      for (size_t i = 0; i < chunk; ++i) {
+        vectors[i].iov_base = const_cast<uint8_t *>(buffers[sent + i].data);
+        vectors[i].iov_len = buffers[sent + i].size;
+        messages[i].msg_hdr.msg_name = const_cast<void *>(dest_addr);
+        messages[i].msg_hdr.msg_namelen = static_cast<socklen_t>(addrlen);
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+      }
+      const int result = ::sendmmsg(socket_value, messages,
+                                    static_cast<unsigned int>(chunk), flags);
+      if (result <= 0) {
+        break;
+      }
+      sent += static_cast<size_t>(result);
+      if (static_cast<size_t>(result) < chunk) {
+        break;
+      }
+    }
+    return (sent == 0 && count > 0) ? -1 : static_cast<intptr_t>(sent);
+  }
+#endif
+
   int CloseSocket(uintptr_t socket_handle) override {
 #ifdef _WIN32
     return ::closesocket(static_cast<SOCKET>(socket_handle));
@@ -142,8 +210,7 @@ SocketOps &DefaultSocketOps() {
 UDPBroadcaster::UDPBroadcaster(const std::string &target_ip,
                                uint16_t target_port,
                                detail::SocketOps *socket_ops)
-    : target_ip_(target_ip), target_port_(target_port), initialized_(false),
-      last_error_(),
+    : destinations_(1), initialized_(false), last_error_(),
       socket_ops_(socket_ops ? socket_ops : &detail::DefaultSocketOps()),
       socket_(kInvalidSocket)
 #ifdef _WIN32
@@ -151,6 +218,11 @@ UDPBroadcaster::UDPBroadcaster(const std::string &target_ip,
       wsa_initialized_(false)
 #endif
 {
+  // An unresolvable constructor target surfaces on the first send instead.
+  Destination &primary = destinations_[0];
+  primary.resolved = resolveDestination(target_ip, target_port, &primary);
+  primary.ip = target_ip;
+  primary.port = target_port;
 }
 
 UDPBroadcaster::~UDPBroadcaster() { close(); }
@@ -217,48 +289,366 @@ bool UDPBroadcaster::initialize() {
   }
 #endif
 
+  if (!applySocketOptions() || !applyMulticastOptions(multicast_)) {
+    socket_ops_->CloseSocket(socket_);
+    socket_ = kInvalidSocket;
+#ifdef _WIN32
+    socket_ops_->Cleanup();
+    wsa_initialized_ = false;
+#endif
+    return false;
+  }
+
   initialized_ = true;
   last_error_.clear();
   return true;
 }
 
-int UDPBroadcaster::send(const uint8_t *data, size_t size) {
+int UDPBroadcaster::send(const uint8_t *data, size_t size,
+                         uint32_t destinations) {
   if (!initialized_) {
     last_error_ = "Socket not initialized";
     return -1;
   }
 
-  sockaddr_in target_addr;
-  std::memset(&target_addr, 0, sizeof(target_addr));
-  target_addr.sin_family = AF_INET;
-  target_addr.sin_port = htons(target_port_);
-
-  if (socket_ops_->InetPton(AF_INET, target_ip_.c_str(),
-                            &target_addr.sin_addr) != 1) {
-    last_error_ = "Invalid IP address: " + target_ip_;
-    return -1;
+  bool any_selected = false;
+  bool ok = true;
+  for (size_t i = 0; i < destinations_.size(); ++i) {
+    if ((destinations & (1u << i)) == 0) {
+      continue;
+    }
+    any_selected = true;
+    const Destination &destination = destinations_[i];
+    if (!destination.resolved) {
+      last_error_ = "Invalid IP address: " + destination.ip;
+      ok = false;
+      continue;
+    }
+    if (socket_ops_->SendTo(socket_, data, size, 0, destination.addr.data(),
+                            sizeof(sockaddr_in)) < 0) {
+      last_error_ =
+          SocketErrorMessage("sendto failed: ", socket_ops_->LastError());
+      send_errors_[i].fetch_add(1, std::memory_order_relaxed);
+      ok = false;
+    } else if (capture_) {
+      capture_->record(data, size, static_cast<uint32_t>(i));
+    }
   }
 
-  const intptr_t sent = socket_ops_->SendTo(socket_, data, size, 0,
-                                            &target_addr, sizeof(target_addr));
-  if (sent < 0) {
-    last_error_ =
-        SocketErrorMessage("sendto failed: ", socket_ops_->LastError());
+  if (!ok) {
     return -1;
   }
-
   last_error_.clear();
-  return static_cast<int>(sent);
+  return any_selected ? static_cast<int>(size) : 0;
 }
 
 int UDPBroadcaster::send(const std::vector<uint8_t> &data) {
   return send(data.data(), data.size());
 }
 
-void UDPBroadcaster::setTarget(const std::string &target_ip,
+int UDPBroadcaster::sendBatch(const SendBuffer *buffers, size_t count,
+                              uint32_t destinations) {
+  if (!initialized_) {
+    last_error_ = "Socket not initialized";
+    return -1;
+  }
+  if (count == 0) {
+    return 0;
+  }
+
+  size_t min_sent = count;
+  bool failed = false;
+  bool partial = false;
+  for (size_t i = 0; i < destinations_.size(); ++i) {
+    if ((destinations & (1u << i)) == 0) {
+      continue;
+    }
+    const Destination &destination = destinations_[i];
+    if (!destination.resolved) {
+      last_error_ = "Invalid IP address: " + destination.ip;
+      failed = true;
+      continue;
+    }
+    const intptr_t sent =
+        socket_ops_->SendBatch(socket_, buffers, count, 0,
+                               destination.addr.data(), sizeof(sockaddr_in));
+    if (sent < 0) {
+      last_error_ =
+          SocketErrorMessage("Batch send failed: ", socket_ops_->LastError());
+      send_errors_[i].fetch_add(1, std::memory_order_relaxed);
+      failed = true;
+    } else if (static_cast<size_t>(sent) < count) {
+      last_error_ = SocketErrorMessage("Batch send stopped early: ",
+                                       socket_ops_->LastError());
+      send_errors_[i].fetch_add(1, std::memory_order_relaxed);
+      partial = true;
+      min_sent = std::min(min_sent, static_cast<size_t>(sent));
+    }
+    if (capture_ && sent > 0) {
+      for (intptr_t j = 0; j < sent; ++j) {
+        capture_->record(buffers[j].data, buffers[j].size,
+                         static_cast<uint32_t>(i));
+      }
+    }
+  }
+
+  if (failed) {
+    return -1;
+  }
+  if (!partial) {
+    last_error_.clear();
+  }
+  return static_cast<int>(min_sent);
+}
+
+bool UDPBroadcaster::resolveDestination(const std::string &ip, uint16_t port,
+                                        Destination *out_destination) {
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+
+  if (socket_ops_->InetPton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
+    last_error_ = "Invalid IP address: " + ip;
+    return false;
+  }
+
+  std::memcpy(out_destination->addr.data(), &addr, sizeof(addr));
+  out_destination->multicast = xp2gdl90::protocol::IsMulticastIpv4Address(ip);
+  return true;
+}
+
+bool UDPBroadcaster::applySocketOptions() {
+  const SocketOptions &options = socket_options_;
+  if (options.dscp != 0) {
+    // The code point is the top six bits of the TOS byte.
+    const int tos = (options.dscp & 0x3F) << 2;
+    if (socket_ops_->SetSockOpt(socket_, IPPROTO_IP, IP_TOS, &tos,
+                                sizeof(tos)) != 0) {
+      last_error_ = SocketErrorMessage("Failed to set IP_TOS: ",
+                                       socket_ops_->LastError());
+      return false;
+    }
+  }
+  if (options.send_buffer_bytes != 0) {
+    const int bytes = static_cast<int>(
+        std::min<uint32_t>(options.send_buffer_bytes, 0x7FFFFFFFu));
+    if (socket_ops_->SetSockOpt(socket_, SOL_SOCKET, SO_SNDBUF, &bytes,
+                                sizeof(bytes)) != 0) {
+      last_error_ = SocketErrorMessage("Failed to set SO_SNDBUF: ",
+                                       socket_ops_->LastError());
+      return false;
+    }
+  }
+  if (!options.bind_ip.empty()) {
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0;
+    if (socket_ops_->InetPton(AF_INET, options.bind_ip.c_str(),
+                              &addr.sin_addr) != 1) {
+      last_error_ = "Invalid bind address: " + options.bind_ip;
+      return false;
+    }
+    if (socket_ops_->Bind(socket_, &addr, sizeof(addr)) != 0) {
+      last_error_ = SocketErrorMessage("bind failed: ",
+                                       socket_ops_->LastError());
+      return false;
+    }
+  }
+  return true;
+}
+
+bool UDPBroadcaster::setSocketOptions(const SocketOptions &options) {
+  if (!options.bind_ip.empty() &&
+      !xp2gdl90::protocol::IsValidIpv4Address(options.bind_ip)) {
+    last_error_ = "Invalid bind address: " + options.bind_ip;
+    return false;
+  }
+  if (options.dscp == socket_options_.dscp &&
+      options.send_buffer_bytes == socket_options_.send_buffer_bytes &&
+      options.bind_ip == socket_options_.bind_ip) {
+    return true;
+  }
+
+  const SocketOptions previous = socket_options_;
+  socket_options_ = options;
+  if (!initialized_) {
+    return true;
+  }
+  close();
+  if (initialize()) {
+    return true;
+  }
+  const std::string error = last_error_;
+  socket_options_ = previous;
+  initialize();
+  last_error_ = error;
+  return false;
+}
+
+bool UDPBroadcaster::applyMulticastOptions(const MulticastOptions &options) {
+  in_addr interface_addr;
+  std::memset(&interface_addr, 0, sizeof(interface_addr));
+  interface_addr.s_addr = htonl(INADDR_ANY);
+  if (!options.interface_ip.empty() &&
+      socket_ops_->InetPton(AF_INET, options.interface_ip.c_str(),
+                            &interface_addr) != 1) {
+    last_error_ = "Invalid multicast interface: " + options.interface_ip;
+    return false;
+  }
+  if (socket_ == kInvalidSocket) {
+    return true;
+  }
+
+  const int ttl = options.ttl;
+  const int loopback = options.loopback ? 1 : 0;
+  if (socket_ops_->SetSockOpt(socket_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl,
+                              sizeof(ttl)) != 0 ||
+      socket_ops_->SetSockOpt(socket_, IPPROTO_IP, IP_MULTICAST_LOOP,
+                              &loopback, sizeof(loopback)) != 0 ||
+      socket_ops_->SetSockOpt(socket_, IPPROTO_IP, IP_MULTICAST_IF,
+                              &interface_addr, sizeof(interface_addr)) != 0) {
+    last_error_ = SocketErrorMessage("Failed to set multicast options: ",
+                                     socket_ops_->LastError());
+    return false;
+  }
+  return true;
+}
+
+bool UDPBroadcaster::setMulticastOptions(const MulticastOptions &options) {
+  if (!applyMulticastOptions(options)) {
+    // Put back whatever part of the old options the failed call replaced.
+    const std::string error = last_error_;
+    applyMulticastOptions(multicast_);
+    last_error_ = error;
+    return false;
+  }
+  multicast_ = options;
+  last_error_.clear();
+  return true;
+}
+
+bool UDPBroadcaster::setTarget(const std::string &target_ip,
                                uint16_t target_port) {
-  target_ip_ = target_ip;
-  target_port_ = target_port;
+  Destination &primary = destinations_[0];
+  if (!resolveDestination(target_ip, target_port, &primary)) {
+    return false;
+  }
+  primary.ip = target_ip;
+  primary.port = target_port;
+  primary.resolved = true;
+  last_error_.clear();
+  return true;
+}
+
+bool UDPBroadcaster::addDestination(const std::string &ip, uint16_t port,
+                                    uint32_t message_mask,
+                                    uint32_t rate_divisor) {
+  if (destinations_.size() >= MAX_DESTINATIONS) {
+    last_error_ = "Too many destinations (max " +
+                  std::to_string(MAX_DESTINATIONS) + ")";
+    return false;
+  }
+
+  Destination destination;
+  if (!resolveDestination(ip, port, &destination)) {
+    return false;
+  }
+  destination.ip = ip;
+  destination.port = port;
+  destination.resolved = true;
+  destination.message_mask = message_mask;
+  destination.rate_divisor = rate_divisor > 0 ? rate_divisor : 1;
+  destination.bandwidth.setCeiling(bandwidth_limit_);
+  destinations_.push_back(destination);
+  return true;
+}
+
+void UDPBroadcaster::clearDestinations() { destinations_.resize(1); }
+
+void UDPBroadcaster::truncateDestinations(size_t count) {
+  if (count < destinations_.size()) {
+    destinations_.resize(std::max<size_t>(count, 1));
+  }
+}
+
+bool UDPBroadcaster::addDiscoveredDestination(const std::string &ip,
+                                              uint16_t port) {
+  if (!addDestination(ip, port)) {
+    return false;
+  }
+  destinations_.back().discovered = true;
+  return true;
+}
+
+size_t UDPBroadcaster::firstDiscoveredDestination() const {
+  for (size_t i = 1; i < destinations_.size(); ++i) {
+    if (destinations_[i].discovered) {
+      return i;
+    }
+  }
+  return destinations_.size();
+}
+
+uint32_t UDPBroadcaster::routeMessage(uint32_t message_class, size_t bytes) {
+  uint32_t route = routeMessage(message_class);
+  if (bytes == 0 || bandwidth_limit_ <= 0.0) {
+    return route;
+  }
+  BandwidthTier tier = BandwidthTier::NORMAL;
+  if ((message_class & essential_classes_) != 0) {
+    tier = BandwidthTier::ESSENTIAL;
+  } else if ((message_class & sheddable_classes_) != 0) {
+    tier = BandwidthTier::SHEDDABLE;
+  }
+  for (size_t i = 0; i < destinations_.size(); ++i) {
+    if ((route & (1u << i)) != 0 &&
+        !destinations_[i].bandwidth.admit(bytes, tier)) {
+      route &= ~(1u << i);
+    }
+  }
+  return route;
+}
+
+void UDPBroadcaster::setBandwidthLimit(double bytes_per_s,
+                                       uint32_t essential_classes,
+                                       uint32_t sheddable_classes) {
+  bandwidth_limit_ = bytes_per_s > 0.0 ? bytes_per_s : 0.0;
+  essential_classes_ = essential_classes;
+  sheddable_classes_ = sheddable_classes;
+  for (Destination &destination : destinations_) {
+    destination.bandwidth.setCeiling(bandwidth_limit_);
+  }
+}
+
+void UDPBroadcaster::updateBandwidth(double now) {
+  for (size_t i = 0; i < destinations_.size(); ++i) {
+    const uint64_t errors = send_errors_[i].load(std::memory_order_relaxed);
+    const uint64_t new_errors = errors - send_errors_seen_[i];
+    send_errors_seen_[i] = errors;
+    destinations_[i].bandwidth.update(now, new_errors);
+  }
+}
+
+uint32_t UDPBroadcaster::routeMessage(uint32_t message_class) {
+  size_t class_index = 0;
+  while (class_index < 31 && (message_class & (1u << class_index)) == 0) {
+    ++class_index;
+  }
+
+  uint32_t route = 0;
+  for (size_t i = 0; i < destinations_.size(); ++i) {
+    Destination &destination = destinations_[i];
+    if ((destination.message_mask & message_class) == 0) {
+      continue;
+    }
+    const uint32_t count = destination.class_counts[class_index]++;
+    if (count % destination.rate_divisor == 0) {
+      route |= 1u << i;
+    }
+  }
+  return route;
 }
 
 void UDPBroadcaster::close() {
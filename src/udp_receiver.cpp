@@ -1,6 +1,6 @@
 #include "xp2gdl90/udp_receiver.h"
 
-#include <array>
+#include <algorithm>
 #include <cstring>
 
 #ifdef _WIN32
@@ -15,7 +15,9 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #endif
 
@@ -35,6 +37,23 @@ std::string SocketErrorMessage(const char *prefix, int code) {
 
 } // namespace
 
+std::string FormatSourceIp(const SourceAddress &address) {
+  in_addr addr{};
+  addr.s_addr = address.ipv4;
+  char ip_buffer[INET_ADDRSTRLEN] = {};
+#ifdef _WIN32
+  if (::InetNtopA(AF_INET, &addr, ip_buffer,
+                  static_cast<DWORD>(sizeof(ip_buffer))) == nullptr) {
+    return std::string();
+  }
+#else
+  if (::inet_ntop(AF_INET, &addr, ip_buffer, sizeof(ip_buffer)) == nullptr) {
+    return std::string();
+  }
+#endif
+  return std::string(ip_buffer);
+}
+
 UDPReceiver::UDPReceiver(uint16_t listen_port)
     : listen_port_(listen_port), initialized_(false), last_error_(),
       socket_(kInvalidSocket)
@@ -145,22 +164,46 @@ bool UDPReceiver::initialize() {
 int UDPReceiver::receive(std::vector<uint8_t> *out_data,
                          std::string *out_source_ip,
                          uint16_t *out_source_port) {
+  if (!out_data) {
+    last_error_ = "Output buffer is required";
+    return -1;
+  }
+
+  out_data->resize(RECEIVE_DATAGRAM_CAPACITY);
+  SourceAddress source;
+  const int received =
+      receiveInto(out_data->data(), out_data->size(), &source);
+  out_data->resize(received > 0 ? static_cast<size_t>(received) : 0);
+  if (received <= 0) {
+    return received;
+  }
+
+  if (out_source_ip) {
+    *out_source_ip = FormatSourceIp(source);
+  }
+  if (out_source_port) {
+    *out_source_port = source.port;
+  }
+  return received;
+}
+
+int UDPReceiver::receiveInto(uint8_t *buffer, size_t capacity,
+                             SourceAddress *out_source) {
   if (!initialized_) {
     last_error_ = "Socket not initialized";
     return -1;
   }
-  if (!out_data) {
+  if (!buffer) {
     last_error_ = "Output buffer is required";
     return -1;
   }
 
-  std::array<uint8_t, 2048> buffer{};
   sockaddr_in source_addr{};
 #ifdef _WIN32
   int source_len = static_cast<int>(sizeof(source_addr));
   const int received = ::recvfrom(
-      static_cast<SOCKET>(socket_), reinterpret_cast<char *>(buffer.data()),
-      static_cast<int>(buffer.size()), 0,
+      static_cast<SOCKET>(socket_), reinterpret_cast<char *>(buffer),
+      static_cast<int>(capacity), 0,
       reinterpret_cast<sockaddr *>(&source_addr), &source_len);
   if (received == SOCKET_ERROR) {
     const int err = WSAGetLastError();
@@ -171,10 +214,11 @@ int UDPReceiver::receive(std::vector<uint8_t> *out_data,
     last_error_ = SocketErrorMessage("recvfrom failed: ", err);
     return -1;
   }
+  const int length = received;
 #else
   socklen_t source_len = static_cast<socklen_t>(sizeof(source_addr));
   const ssize_t received =
-      ::recvfrom(static_cast<int>(socket_), buffer.data(), buffer.size(), 0,
+      ::recvfrom(static_cast<int>(socket_), buffer, capacity, 0,
                  reinterpret_cast<sockaddr *>(&source_addr), &source_len);
   if (received < 0) {
     if (errno == EAGAIN || errno == EWOULDBLOCK) {
@@ -184,35 +228,122 @@ int UDPReceiver::receive(std::vector<uint8_t> *out_data,
     last_error_ = SocketErrorMessage("recvfrom failed: ", errno);
     return -1;
   }
+  const int length = static_cast<int>(received);
 #endif
 
-  out_data->assign(buffer.begin(), buffer.begin() + received);
+  if (out_source) {
+    out_source->ipv4 = source_addr.sin_addr.s_addr;
+    out_source->port = ntohs(source_addr.sin_port);
+  }
+  last_error_.clear();
+  return length;
+}
 
-  if (out_source_ip) {
-    char ip_buffer[INET_ADDRSTRLEN] = {};
-#ifdef _WIN32
-    if (::InetNtopA(AF_INET, &source_addr.sin_addr, ip_buffer,
-                    static_cast<DWORD>(sizeof(ip_buffer))) != nullptr) {
-      *out_source_ip = ip_buffer;
-    } else {
-      out_source_ip->clear();
+int UDPReceiver::drain(ReceiveBatch *batch) {
+  if (!batch) {
+    last_error_ = "Output batch is required";
+    return -1;
+  }
+  batch->count_ = 0;
+  if (!initialized_) {
+    last_error_ = "Socket not initialized";
+    return -1;
+  }
+
+  const size_t max_datagrams = batch->maxDatagrams();
+#if defined(__linux__)
+  constexpr size_t kChunk = 64;
+  while (batch->count_ < max_datagrams) {
+    mmsghdr messages[kChunk];
+    iovec vectors[kChunk];
+    sockaddr_in sources[kChunk];
+    const size_t first = batch->count_;
+    const size_t chunk = std::min(kChunk, max_datagrams - first);
+    std::memset(messages, 0, sizeof(messages[0]) * chunk);
+    for (size_t i = 0; i < chunk; ++i) {
+      vectors[i].iov_base =
+          batch->bytes_.data() + (first + i) * RECEIVE_DATAGRAM_CAPACITY;
+      vectors[i].iov_len = RECEIVE_DATAGRAM_CAPACITY;
+      messages[i].msg_hdr.msg_name = &sources[i];
+      messages[i].msg_hdr.msg_namelen =
+          static_cast<socklen_t>(sizeof(sources[i]));
+      messages[i].msg_hdr.msg_iov = &vectors[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    const int result =
+        ::recvmmsg(static_cast<int>(socket_), messages,
+                   static_cast<unsigned int>(chunk), MSG_DONTWAIT, nullptr);
+    if (result < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || batch->count_ > 0) {
+        break;
+      }
+      last_error_ = SocketErrorMessage("recvmmsg failed: ", errno);
+      return -1;
+    }
+    for (int i = 0; i < result; ++i) {
+      batch->sizes_[first + i] = messages[i].msg_len;
+      batch->sources_[first + i].ipv4 = sources[i].sin_addr.s_addr;
+      batch->sources_[first + i].port = ntohs(sources[i].sin_port);
     }
+    batch->count_ += static_cast<size_t>(result);
+    if (static_cast<size_t>(result) < chunk) {
+      break;
+    }
+  }
 #else
-    if (::inet_ntop(AF_INET, &source_addr.sin_addr, ip_buffer,
-                    sizeof(ip_buffer)) != nullptr) {
-      *out_source_ip = ip_buffer;
-    } else {
-      out_source_ip->clear();
+  while (batch->count_ < max_datagrams) {
+    const size_t index = batch->count_;
+    const int received =
+        receiveInto(batch->bytes_.data() + index * RECEIVE_DATAGRAM_CAPACITY,
+                    RECEIVE_DATAGRAM_CAPACITY, &batch->sources_[index]);
+    if (received == 0) {
+      break;
     }
+    if (received < 0) {
+      if (batch->count_ > 0) {
+        break;
+      }
+      return -1;
+    }
+    batch->sizes_[index] = static_cast<size_t>(received);
+    ++batch->count_;
+  }
 #endif
+
+  last_error_.clear();
+  return static_cast<int>(batch->count_);
+}
+
+int UDPReceiver::waitReadable(int timeout_ms) {
+  if (!initialized_) {
+    last_error_ = "Socket not initialized";
+    return -1;
   }
 
-  if (out_source_port) {
-    *out_source_port = ntohs(source_addr.sin_port);
+#ifdef _WIN32
+  WSAPOLLFD descriptor{};
+  descriptor.fd = static_cast<SOCKET>(socket_);
+  descriptor.events = POLLRDNORM;
+  const int result = ::WSAPoll(&descriptor, 1, timeout_ms);
+  if (result == SOCKET_ERROR) {
+    last_error_ = SocketErrorMessage("WSAPoll failed: ", WSAGetLastError());
+    return -1;
   }
+#else
+  pollfd descriptor{};
+  descriptor.fd = static_cast<int>(socket_);
+  descriptor.events = POLLIN;
+  const int result = ::poll(&descriptor, 1, timeout_ms);
+  if (result < 0) {
+    if (errno == EINTR) {
+      return 0;
+    }
+    last_error_ = SocketErrorMessage("poll failed: ", errno);
+    return -1;
+  }
+#endif
 
-  last_error_.clear();
-  return static_cast<int>(received);
+  return result > 0 ? 1 : 0;
 }
 
 void UDPReceiver::close() {
@@ -0,0 +1,36 @@
+#include "xp2gdl90/virtual_clock.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace xp2gdl90 {
+
+int64_t VirtualClock::wallMicroseconds() {
+  return wall_epoch_us_ + static_cast<int64_t>(std::llround(now_s_ * 1e6));
+}
+
+void VirtualClock::advance(double seconds) {
+  if (seconds > 0.0) {
+    now_s_ += seconds;
+  }
+}
+
+FrameTicker::FrameTicker(VirtualClock *clock, double interval_s,
+                         double jitter_s, uint32_t seed)
+    : clock_(clock), interval_s_(interval_s),
+      jitter_s_((std::min)(std::fabs(jitter_s), interval_s)),
+      state_(seed != 0 ? seed : 1) {}
+
+double FrameTicker::next() {
+  // xorshift32: enough spread for frame jitter, and the same on every
+  // platform.
+  state_ ^= state_ << 13;
+  state_ ^= state_ >> 17;
+  state_ ^= state_ << 5;
+  const double unit = static_cast<double>(state_) / 4294967296.0;
+  clock_->advance(interval_s_ + jitter_s_ * (2.0 * unit - 1.0));
+  ++frames_;
+  return clock_->now();
+}
+
+} // namespace xp2gdl90
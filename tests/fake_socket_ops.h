@@ -0,0 +1,117 @@
+#ifndef XP2GDL90_TESTS_FAKE_SOCKET_OPS_H
+#define XP2GDL90_TESTS_FAKE_SOCKET_OPS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "xp2gdl90/udp_broadcaster.h"
+
+namespace xp2gdl90::test {
+
+struct FakeSocketOps final : udp::detail::SocketOps {
+  int startup_result = 0;
+  uintptr_t create_socket_result = udp::UDPBroadcaster::kInvalidSocket;
+  int setsockopt_result = 0;
+  int inet_pton_result = 1;
+  int bind_result = 0;
+  intptr_t sendto_result = -1;
+  int close_result = 0;
+  int last_error_value = 0;
+
+  int startup_calls = 0;
+  int cleanup_calls = 0;
+  int create_socket_calls = 0;
+  int setsockopt_calls = 0;
+  // Option name and int value (or 0 for other types) of each SetSockOpt.
+  std::vector<int> setsockopt_names;
+  std::vector<int> setsockopt_values;
+  int inet_pton_calls = 0;
+  int bind_calls = 0;
+  int sendto_calls = 0;
+  int send_batch_calls = 0;
+  // When >= 0, SendTo fails once this many calls have succeeded.
+  int fail_sendto_after = -1;
+  int close_calls = 0;
+  // Off for allocation tests, which must not grow the vectors below.
+  bool record_sends = true;
+  // Runs at the start of every SendTo, e.g. to hold a send in progress.
+  std::function<void()> on_sendto;
+
+  uintptr_t last_closed_socket = udp::UDPBroadcaster::kInvalidSocket;
+  std::vector<std::vector<uint8_t>> sent_datagrams;
+  // Raw sockaddr bytes of each datagram's destination.
+  std::vector<std::vector<uint8_t>> sent_addresses;
+
+  int Startup() override {
+    ++startup_calls;
+    return startup_result;
+  }
+
+  void Cleanup() override { ++cleanup_calls; }
+
+  uintptr_t CreateSocket(int, int, int) override {
+    ++create_socket_calls;
+    return create_socket_result;
+  }
+
+  int SetSockOpt(uintptr_t, int, int optname, const void *optval,
+                 size_t optlen) override {
+    ++setsockopt_calls;
+    setsockopt_names.push_back(optname);
+    setsockopt_values.push_back(
+        optlen == sizeof(int) && optval ? *static_cast<const int *>(optval)
+                                        : 0);
+    return setsockopt_result;
+  }
+
+  int InetPton(int, const char *, void *) override {
+    ++inet_pton_calls;
+    return inet_pton_result;
+  }
+
+  int Bind(uintptr_t, const void *, size_t) override {
+    ++bind_calls;
+    return bind_result;
+  }
+
+  intptr_t SendTo(uintptr_t, const void *buf, size_t len, int,
+                  const void *dest_addr, size_t addrlen) override {
+    if (on_sendto) {
+      on_sendto();
+    }
+    ++sendto_calls;
+    if (fail_sendto_after >= 0 && sendto_calls > fail_sendto_after) {
+      return -1;
+    }
+    if (!record_sends) {
+      return sendto_result;
+    }
+    const uint8_t *bytes = static_cast<const uint8_t *>(buf);
+    sent_datagrams.emplace_back(bytes, bytes + len);
+    const uint8_t *addr = static_cast<const uint8_t *>(dest_addr);
+    sent_addresses.emplace_back(addr, addr + addrlen);
+    return sendto_result;
+  }
+
+  intptr_t SendBatch(uintptr_t socket, const udp::SendBuffer *buffers,
+                     size_t count, int flags, const void *dest_addr,
+                     size_t addrlen) override {
+    ++send_batch_calls;
+    return SocketOps::SendBatch(socket, buffers, count, flags, dest_addr,
+                                addrlen);
+  }
+
+  int CloseSocket(uintptr_t socket_handle) override {
+    ++close_calls;
+    last_closed_socket = socket_handle;
+    return close_result;
+  }
+
+  int LastError() override { return last_error_value; }
+};
+
+} // namespace xp2gdl90::test
+
+#endif // XP2GDL90_TESTS_FAKE_SOCKET_OPS_H
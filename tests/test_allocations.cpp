@@ -0,0 +1,185 @@
+#include "test_harness.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "fake_socket_ops.h"
+#include "xp2gdl90/cached_frame.h"
+#include "xp2gdl90/datagram_packer.h"
+#include "xp2gdl90/foreflight_encoder.h"
+#include "xp2gdl90/frame_buffer.h"
+#include "xp2gdl90/frame_pool.h"
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/gdl90_framing.h"
+#include "xp2gdl90/stats_history.h"
+#include "xp2gdl90/track_table.h"
+#include "xp2gdl90/traffic_frame_cache.h"
+#include "xp2gdl90/udp_broadcaster.h"
+
+namespace {
+
+constexpr size_t kTargets = 32;
+constexpr int kTicks = 20;
+
+std::vector<gdl90::PositionData> MakeReports() {
+  std::vector<gdl90::PositionData> reports(kTargets);
+  for (size_t i = 0; i < reports.size(); ++i) {
+    reports[i].latitude = 47.0 + 0.01 * static_cast<double>(i);
+    reports[i].longitude = 8.0;
+    reports[i].altitude = 3000 + 100 * static_cast<int32_t>(i);
+    reports[i].icao_address = 0x100000u + static_cast<uint32_t>(i);
+    reports[i].callsign = gdl90::Callsign("TEST");
+    reports[i].airborne = true;
+  }
+  return reports;
+}
+
+// Moves every target a little, as consecutive sweeps do.
+void Advance(std::vector<gdl90::PositionData> *reports) {
+  for (gdl90::PositionData &report : *reports) {
+    report.latitude += 0.0005;
+    report.altitude += 25;
+  }
+}
+
+} // namespace
+
+TEST_CASE("Allocation scope counts this thread's allocations") {
+  test_harness::AllocationScope scope;
+  ASSERT_EQ(uint64_t{0}, scope.count());
+  std::vector<int> values(16);
+  ASSERT_EQ(uint64_t{1}, scope.count());
+  EXPECT_NO_ALLOCATIONS(values[0] = 1);
+}
+
+TEST_CASE("Steady-state encoding does not allocate") {
+  const gdl90::GDL90Encoder encoder;
+  const gdl90::foreflight::ForeFlightEncoder foreflight;
+  gdl90::CachedFrame heartbeat;
+  gdl90::FrameBuffer ownship;
+  gdl90::FrameBuffer ahrs;
+  gdl90::FrameArena arena;
+  gdl90::TrafficFrameCache cache;
+  std::vector<gdl90::PositionData> reports = MakeReports();
+  gdl90::foreflight::AhrsData attitude;
+  attitude.roll_deg = 5.0;
+  attitude.pitch_deg = 2.0;
+  attitude.heading_deg = 90.0;
+
+  // The first tick sizes the arena and the cache.
+  encoder.encodeTrafficBatch(reports.data(), reports.size(), arena, &cache);
+  for (int tick = 0; tick < kTicks; ++tick) {
+    Advance(&reports);
+    EXPECT_NO_ALLOCATIONS(encoder.encodeHeartbeatInto(true, true, heartbeat));
+    EXPECT_NO_ALLOCATIONS(encoder.encodeOwnshipReportInto(reports[0], ownship));
+    EXPECT_NO_ALLOCATIONS(foreflight.encodeAhrsMessageInto(attitude, ahrs));
+    EXPECT_NO_ALLOCATIONS(encoder.encodeTrafficBatch(
+        reports.data(), reports.size(), arena, &cache));
+  }
+  ASSERT_EQ(kTargets, arena.frameCount());
+}
+
+TEST_CASE("Framing does not allocate") {
+  std::vector<uint8_t> payload(28, gdl90::FRAME_FLAG);
+  std::vector<uint8_t> out(gdl90::MaxFrameSize(payload.size()));
+  EXPECT_NO_ALLOCATIONS(
+      gdl90::FrameMessage(payload.data(), payload.size(), out.data()));
+  EXPECT_NO_ALLOCATIONS(
+      gdl90::FrameMessageScalar(payload.data(), payload.size(), out.data()));
+}
+
+TEST_CASE("Track table refreshes known targets without allocating") {
+  xp2gdl90::traffic::TrackTable tracks;
+  for (uint32_t key = 1; key <= kTargets; ++key) {
+    tracks.upsert(key, 0.0);
+  }
+  for (int tick = 1; tick <= kTicks; ++tick) {
+    const double now = static_cast<double>(tick);
+    EXPECT_NO_ALLOCATIONS(for (uint32_t key = 1; key <= kTargets; ++key) {
+      tracks.upsert(key, now);
+    });
+    EXPECT_NO_ALLOCATIONS(tracks.evictStale(now, 5.0, nullptr));
+  }
+  ASSERT_EQ(kTargets, tracks.size());
+}
+
+TEST_CASE("Track histories take samples without allocating") {
+  xp2gdl90::traffic::TrackTable tracks;
+  tracks.setHistoryEnabled(true);
+  std::vector<gdl90::PositionData> reports = MakeReports();
+  for (const gdl90::PositionData &report : reports) {
+    tracks.upsert(report.icao_address, 0.0);
+  }
+  for (int tick = 1; tick <= kTicks; ++tick) {
+    Advance(&reports);
+    const double now = static_cast<double>(tick);
+    EXPECT_NO_ALLOCATIONS(for (const gdl90::PositionData &report : reports) {
+      const size_t index = tracks.upsert(report.icao_address, now);
+      tracks.pushSample(index, now, report.latitude, report.longitude,
+                        report.altitude);
+      xp2gdl90::traffic::TrackTrend trend;
+      xp2gdl90::traffic::FitTrackTrend(tracks.history(index), 1.0, &trend);
+    });
+  }
+  ASSERT_EQ(static_cast<int>(xp2gdl90::traffic::TRACK_HISTORY_SAMPLES),
+            static_cast<int>(tracks.history(0).count));
+}
+
+TEST_CASE("Stats history records and wraps without allocating") {
+  xp2gdl90::StatsHistory history;
+  xp2gdl90::StatsCounters counters;
+  const size_t samples = xp2gdl90::STATS_HISTORY_SAMPLES + 10;
+  EXPECT_NO_ALLOCATIONS(for (size_t i = 0; i <= samples; ++i) {
+    counters.frames += 30;
+    counters.bytes += 1500;
+    history.recordTick(50000);
+    history.update(static_cast<double>(i), counters);
+  });
+  ASSERT_EQ(xp2gdl90::STATS_HISTORY_SAMPLES, history.size());
+}
+
+TEST_CASE("Pooled frames are encoded and shared without allocating") {
+  gdl90::FramePool pool(4);
+  const gdl90::GDL90Encoder encoder;
+  EXPECT_NO_ALLOCATIONS(for (int tick = 0; tick < kTicks; ++tick) {
+    gdl90::FrameRef frame = pool.acquire();
+    encoder.encodeHeartbeatInto(true, true, *frame.buffer());
+    gdl90::FrameRef shared = frame;
+    frame.reset();
+  });
+  ASSERT_EQ(pool.capacity(), pool.available());
+}
+
+TEST_CASE("Broadcasting and packing do not allocate") {
+  xp2gdl90::test::FakeSocketOps ops;
+  ops.create_socket_result = 42;
+  ops.sendto_result = 0;
+  ops.record_sends = false;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  const gdl90::GDL90Encoder encoder;
+  gdl90::FrameArena arena;
+  std::vector<gdl90::PositionData> reports = MakeReports();
+  std::vector<udp::SendBuffer> buffers(kTargets);
+  udp::DatagramPacker packer(1400);
+  encoder.encodeTrafficBatch(reports.data(), reports.size(), arena);
+  for (size_t i = 0; i < arena.frameCount(); ++i) {
+    buffers[i] = udp::SendBuffer{arena.frameData(i), arena.frameSize(i)};
+  }
+  // Warm up the packer's pending datagram.
+  packer.append(arena.frameData(0), arena.frameSize(0), true, broadcaster);
+  packer.flush(broadcaster);
+
+  for (int tick = 0; tick < kTicks; ++tick) {
+    EXPECT_NO_ALLOCATIONS(
+        broadcaster.send(arena.frameData(0), arena.frameSize(0)));
+    EXPECT_NO_ALLOCATIONS(
+        broadcaster.sendBatch(buffers.data(), buffers.size()));
+    EXPECT_NO_ALLOCATIONS(for (size_t i = 0; i < arena.frameCount(); ++i) {
+      packer.append(arena.frameData(i), arena.frameSize(i), i == 0,
+                    broadcaster);
+    } packer.flush(broadcaster));
+  }
+  ASSERT_TRUE(ops.sendto_calls > kTicks);
+}
@@ -0,0 +1,205 @@
+#include "test_harness.h"
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include "fake_socket_ops.h"
+#include "xp2gdl90/bandwidth_accounting.h"
+#include "xp2gdl90/broadcast_engine.h"
+
+using xp2gdl90::BandwidthAccount;
+using xp2gdl90::BandwidthMeter;
+using xp2gdl90::BandwidthPlan;
+using xp2gdl90::BandwidthPlanInputs;
+using xp2gdl90::SendClass;
+using xp2gdl90::Settings;
+using xp2gdl90::test::FakeSocketOps;
+
+namespace {
+
+bool Near(double expected, double actual) {
+  return std::fabs(expected - actual) < 1e-6;
+}
+
+const xp2gdl90::BandwidthPlanClass &PlanFor(const BandwidthPlan &plan,
+                                             SendClass send_class) {
+  return plan.classes[static_cast<size_t>(send_class)];
+}
+
+} // namespace
+
+TEST_CASE("Bandwidth meter averages over its window of samples") {
+  BandwidthMeter meter;
+  meter.sample(0.0);
+  ASSERT_EQ(0.0, meter.rate().bytes_per_s);
+  for (int second = 1; second <= 10; ++second) {
+    // 10 frames a second, then 40 from the seventh second on.
+    const uint64_t frames = second <= 6 ? 10 : 40;
+    meter.add(frames, frames * 32);
+    meter.sample(static_cast<double>(second));
+  }
+  // The last five seconds: one at 10 frames/s and four at 40.
+  ASSERT_TRUE(Near(34.0, meter.rate().frames_per_s));
+  ASSERT_TRUE(Near(34.0 * 32.0, meter.rate().bytes_per_s));
+  ASSERT_EQ(static_cast<uint64_t>(220), meter.totals().frames);
+
+  // A clock that went backwards starts the window over.
+  meter.sample(2.0);
+  ASSERT_EQ(0.0, meter.rate().frames_per_s);
+  meter.add(5, 100);
+  meter.sample(3.0);
+  ASSERT_TRUE(Near(5.0, meter.rate().frames_per_s));
+  meter.reset();
+  ASSERT_EQ(static_cast<uint64_t>(0), meter.totals().bytes);
+
+  ASSERT_EQ(static_cast<size_t>(2),
+            xp2gdl90::MessageClassIndex(xp2gdl90::MESSAGE_TRAFFIC));
+  ASSERT_EQ(xp2gdl90::MESSAGE_CLASS_COUNT, xp2gdl90::MessageClassIndex(0));
+  ASSERT_EQ(std::string("ForeFlight ID"),
+            std::string(xp2gdl90::MessageClassName(3)));
+  ASSERT_EQ(std::string("Unknown"), std::string(xp2gdl90::MessageClassName(
+                                        xp2gdl90::MESSAGE_CLASS_COUNT)));
+}
+
+TEST_CASE("Bandwidth account splits the link by class and destination") {
+  BandwidthAccount account;
+  ASSERT_TRUE(account.update(0.0));
+  // One heartbeat to both destinations, traffic only to the second, and a
+  // route bit past the destinations that exist.
+  account.record(xp2gdl90::MESSAGE_HEARTBEAT, 0x3u, 2, 1, 11);
+  account.record(xp2gdl90::MESSAGE_TRAFFIC, 0x2u | 0x80u, 2, 20, 640);
+  account.record(0, 0x1u, 2, 1, 16);
+  ASSERT_TRUE(!account.update(0.5));
+  ASSERT_TRUE(account.update(1.0));
+
+  ASSERT_TRUE(Near(22.0, account.messageClass(0).rate().bytes_per_s));
+  ASSERT_TRUE(Near(2.0, account.messageClass(0).rate().frames_per_s));
+  ASSERT_TRUE(Near(640.0, account.messageClass(2).rate().bytes_per_s));
+  ASSERT_TRUE(Near(27.0, account.destination(0).rate().bytes_per_s));
+  ASSERT_TRUE(Near(651.0, account.destination(1).rate().bytes_per_s));
+  ASSERT_TRUE(Near(21.0, account.destination(1).rate().frames_per_s));
+  ASSERT_EQ(static_cast<uint64_t>(0), account.destination(7).totals().frames);
+  ASSERT_TRUE(Near(678.0, account.total().bytes_per_s));
+
+  account.reset();
+  ASSERT_EQ(static_cast<uint64_t>(0), account.messageClass(2).totals().bytes);
+  ASSERT_TRUE(account.update(1.2));
+}
+
+TEST_CASE("Broadcast engine accounts each send where it went") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  ASSERT_TRUE(broadcaster.addDestination("127.0.0.2", 4001,
+                                         xp2gdl90::MESSAGE_TRAFFIC));
+  ASSERT_EQ(std::string("127.0.0.2"), broadcaster.destinationIp(1));
+  ASSERT_EQ(static_cast<uint16_t>(4001), broadcaster.destinationPort(1));
+
+  xp2gdl90::BroadcastEngine engine;
+  engine.attach(&broadcaster);
+  engine.updateAccounting(0.0);
+  const uint8_t heartbeat[] = {0x7E, 0x00, 0x7E};
+  engine.sendMessage(heartbeat, sizeof(heartbeat),
+                     xp2gdl90::MESSAGE_HEARTBEAT);
+  gdl90::FrameArena frames;
+  for (uint8_t i = 0; i < 4; ++i) {
+    uint8_t *frame = frames.beginFrame();
+    frame[0] = 0x7E;
+    frame[1] = 0x14;
+    frame[2] = i;
+    frame[3] = 0x7E;
+    frames.commitFrame(4);
+  }
+  engine.startTraffic(frames, 0.0, 0.0);
+  engine.sendPacedTraffic(0.0);
+  engine.flush();
+  engine.updateAccounting(1.0);
+
+  const BandwidthAccount &account = engine.accounting();
+  ASSERT_EQ(static_cast<uint64_t>(1), account.messageClass(0).totals().frames);
+  // Both destinations take traffic.
+  ASSERT_EQ(static_cast<uint64_t>(8), account.messageClass(2).totals().frames);
+  ASSERT_EQ(static_cast<uint64_t>(32), account.messageClass(2).totals().bytes);
+  ASSERT_TRUE(Near(19.0, account.destination(0).rate().bytes_per_s));
+  ASSERT_TRUE(Near(4.0, account.destination(1).rate().frames_per_s));
+  ASSERT_TRUE(Near(35.0, account.total().bytes_per_s));
+}
+
+TEST_CASE("Bandwidth plan predicts the load of pending settings") {
+  Settings cfg;
+  cfg.heartbeat_rate = 1.0f;
+  cfg.position_rate = 5.0f;
+  cfg.geo_altitude_rate = 1.0f;
+  cfg.ahrs_rate = 10.0f;
+  cfg.device_info_rate = 0.0f;
+  cfg.traffic_rate = 1.0f;
+  cfg.traffic_max_targets = 20;
+  xp2gdl90::Destination traffic_only;
+  traffic_only.ip = "10.0.0.2";
+  traffic_only.message_mask = xp2gdl90::MESSAGE_TRAFFIC;
+  traffic_only.rate_divisor = 2;
+  cfg.extra_destinations.push_back(traffic_only);
+
+  BandwidthPlanInputs inputs;
+  inputs.traffic_targets = 30;
+  // Discovery takes the primary and adds one more destination.
+  inputs.foreflight_devices = 2;
+  BandwidthPlan plan = xp2gdl90::PlanBandwidth(cfg, inputs);
+  ASSERT_EQ(static_cast<size_t>(3), plan.destination_count);
+  ASSERT_EQ(static_cast<size_t>(0), plan.destinations_refused);
+
+  // 28-byte reports: 30 payload and CRC bytes with random escapes.
+  const double report = xp2gdl90::ExpectedFrameBytes(28);
+  ASSERT_TRUE(Near(2.0 + 30.0 * (1.0 + 2.0 / 256.0), report));
+  ASSERT_TRUE(Near(20.0, PlanFor(plan, SendClass::TRAFFIC).frames_per_s));
+  ASSERT_TRUE(Near(report, PlanFor(plan, SendClass::TRAFFIC).frame_bytes));
+  ASSERT_EQ(0.0, PlanFor(plan, SendClass::DEVICE_INFO).frames_per_s);
+  // Traffic: everything to both full destinations, half to the other.
+  ASSERT_TRUE(
+      Near(50.0, PlanFor(plan, SendClass::TRAFFIC).load.frames_per_s));
+
+  const double full = 1.0 * xp2gdl90::ExpectedFrameBytes(7) +
+                      5.0 * report + 1.0 * xp2gdl90::ExpectedFrameBytes(5) +
+                      10.0 * xp2gdl90::ExpectedFrameBytes(12) + 20.0 * report;
+  ASSERT_TRUE(Near(full, plan.destinations[0].load.bytes_per_s));
+  ASSERT_TRUE(Near(full, plan.destinations[2].load.bytes_per_s));
+  ASSERT_TRUE(Near(10.0 * report, plan.destinations[1].load.bytes_per_s));
+  ASSERT_TRUE(Near(2.0 * full + 10.0 * report, plan.total.bytes_per_s));
+  // Unpacked, each frame is a datagram with its own headers.
+  ASSERT_TRUE(Near(plan.total.bytes_per_s + plan.total.frames_per_s * 28.0,
+                   plan.wire_bytes_per_s));
+  ASSERT_EQ(static_cast<size_t>(0), plan.destinations_over_limit);
+
+  // Packing leaves a datagram per AHRS send, the fastest class, and a cap
+  // below the full load flags the two full destinations.
+  cfg.datagram_packing = true;
+  cfg.bandwidth_limit_bytes_per_s = 900;
+  plan = xp2gdl90::PlanBandwidth(cfg, inputs);
+  ASSERT_TRUE(Near(10.0, plan.destinations[0].datagrams_per_s));
+  ASSERT_TRUE(Near(0.5, plan.destinations[1].datagrams_per_s));
+  ASSERT_EQ(static_cast<size_t>(2), plan.destinations_over_limit);
+  ASSERT_TRUE(plan.destinations[0].over_limit);
+  ASSERT_TRUE(!plan.destinations[1].over_limit);
+
+  // Adaptive rates count every target at the near rate within the budget;
+  // discovery off drops its destination.
+  cfg.traffic_adaptive_rate = true;
+  cfg.traffic_max_frames_per_second = 30.0f;
+  cfg.foreflight_auto_discovery = false;
+  plan = xp2gdl90::PlanBandwidth(cfg, inputs);
+  ASSERT_TRUE(Near(30.0, PlanFor(plan, SendClass::TRAFFIC).frames_per_s));
+  ASSERT_EQ(static_cast<size_t>(2), plan.destination_count);
+  cfg.traffic_enabled = false;
+  plan = xp2gdl90::PlanBandwidth(cfg, inputs);
+  ASSERT_EQ(0.0, PlanFor(plan, SendClass::TRAFFIC).load.bytes_per_s);
+
+  // Past the broadcaster's limit, destinations are refused.
+  cfg.extra_destinations.assign(xp2gdl90::MAX_EXTRA_DESTINATIONS + 2,
+                                traffic_only);
+  plan = xp2gdl90::PlanBandwidth(cfg, inputs);
+  ASSERT_EQ(udp::MAX_DESTINATIONS, plan.destination_count);
+  ASSERT_EQ(static_cast<size_t>(2), plan.destinations_refused);
+}
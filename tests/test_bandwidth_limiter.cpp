@@ -0,0 +1,84 @@
+#include "test_harness.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include "xp2gdl90/bandwidth_limiter.h"
+
+using udp::BandwidthLimiter;
+using udp::BandwidthTier;
+
+TEST_CASE("BandwidthLimiter admits everything while disabled") {
+  BandwidthLimiter limiter;
+  limiter.update(0.0, 5);
+  ASSERT_TRUE(!limiter.enabled());
+  ASSERT_TRUE(limiter.admit(1u << 20, BandwidthTier::SHEDDABLE));
+  ASSERT_EQ(static_cast<uint64_t>(0), limiter.stats().backoffs);
+  ASSERT_EQ(static_cast<uint64_t>(1u << 20), limiter.stats().admitted_bytes);
+}
+
+TEST_CASE("BandwidthLimiter sheds by tier as the bucket drains") {
+  BandwidthLimiter limiter;
+  limiter.setCeiling(8000.0);
+  limiter.update(0.0, 0);
+  // A quarter second of the ceiling.
+  ASSERT_EQ(2000.0, limiter.capacity());
+
+  // Sheddable messages must leave a quarter of the bucket.
+  ASSERT_TRUE(limiter.admit(1400, BandwidthTier::SHEDDABLE));
+  ASSERT_TRUE(!limiter.admit(200, BandwidthTier::SHEDDABLE));
+  ASSERT_TRUE(limiter.admit(550, BandwidthTier::NORMAL));
+  ASSERT_TRUE(!limiter.admit(100, BandwidthTier::NORMAL));
+  // Essential messages go out regardless, into debt.
+  ASSERT_TRUE(limiter.admit(500, BandwidthTier::ESSENTIAL));
+  ASSERT_TRUE(std::fabs(limiter.tokens() + 450.0) < 1e-9);
+
+  const udp::BandwidthLimiterStats &stats = limiter.stats();
+  ASSERT_EQ(static_cast<uint64_t>(2), stats.shed_messages);
+  ASSERT_EQ(static_cast<uint64_t>(300), stats.shed_bytes);
+  ASSERT_EQ(static_cast<uint64_t>(2450), stats.admitted_bytes);
+
+  // Refill at the ceiling, capped at the bucket size.
+  limiter.update(0.1, 0);
+  ASSERT_TRUE(std::fabs(limiter.tokens() - 350.0) < 1e-9);
+  limiter.update(5.0, 0);
+  ASSERT_EQ(2000.0, limiter.tokens());
+}
+
+TEST_CASE("BandwidthLimiter backs off on errors and recovers gradually") {
+  BandwidthLimiter limiter;
+  limiter.setCeiling(10000.0);
+  limiter.update(0.0, 0);
+
+  limiter.update(0.1, 3);
+  ASSERT_EQ(0.5, limiter.backoffFactor());
+  ASSERT_TRUE(limiter.tokens() <= 5000.0 * 0.1 + 1e-9);
+  // Errors inside the hold period do not compound.
+  limiter.update(0.2, 1);
+  ASSERT_EQ(0.5, limiter.backoffFactor());
+  limiter.update(0.4, 1);
+  ASSERT_EQ(0.25, limiter.backoffFactor());
+  ASSERT_EQ(static_cast<uint64_t>(2), limiter.stats().backoffs);
+  ASSERT_EQ(2500.0, limiter.stats().rate_bytes_per_s);
+
+  // Nothing recovers until a second passes without errors.
+  limiter.update(1.3, 0);
+  ASSERT_EQ(0.25, limiter.backoffFactor());
+  limiter.update(2.4, 0);
+  ASSERT_TRUE(std::fabs(limiter.backoffFactor() - 0.35) < 1e-9);
+  for (int i = 0; i < 20; ++i) {
+    limiter.update(3.4 + i, 0);
+  }
+  ASSERT_EQ(1.0, limiter.backoffFactor());
+
+  // Never below a sixteenth of the ceiling.
+  for (int i = 0; i < 10; ++i) {
+    limiter.update(30.0 + i, 1);
+  }
+  ASSERT_EQ(1.0 / 16.0, limiter.backoffFactor());
+
+  limiter.reset();
+  ASSERT_EQ(1.0, limiter.backoffFactor());
+  ASSERT_EQ(static_cast<uint64_t>(0), limiter.stats().backoffs);
+  ASSERT_EQ(10000.0, limiter.ceiling());
+}
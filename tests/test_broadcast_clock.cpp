@@ -1,9 +1,20 @@
 #include "test_harness.h"
 
+#include <cmath>
+#include <cstdint>
 #include <limits>
 
 #include "xp2gdl90/broadcast_clock.h"
 
+TEST_CASE("System clock reads the steady and wall clocks") {
+  xp2gdl90::Clock &clock = xp2gdl90::SystemClock();
+  const double first = clock.monotonicSeconds();
+  ASSERT_TRUE(clock.monotonicSeconds() >= first);
+  // Later than 2020-01-01.
+  ASSERT_TRUE(clock.wallMicroseconds() > int64_t{1577836800} * 1000000);
+  ASSERT_TRUE(&clock == &xp2gdl90::SystemClock());
+}
+
 TEST_CASE("Broadcast clock uses simulator time during normal flight") {
   xp2gdl90::BroadcastClockState state;
   const auto result =
@@ -49,3 +60,76 @@ TEST_CASE("Broadcast clock falls back when simulator time is invalid") {
       std::numeric_limits<float>::quiet_NaN(), 42.0f, false, &state);
   ASSERT_EQ(42.0f, result.time);
 }
+
+TEST_CASE("Broadcast clock keeps sub-millisecond steps on long sessions") {
+  xp2gdl90::BroadcastClockState state;
+  const double start = 100000.0;
+  xp2gdl90::UpdateBroadcastClock(static_cast<float>(start), 10.0, false,
+                                 &state);
+  double previous = start;
+  for (int frame = 1; frame <= 120; ++frame) {
+    const double truth = start + frame / 60.0;
+    // A float simulator time only resolves 7.8 ms here.
+    const auto result = xp2gdl90::UpdateBroadcastClock(
+        static_cast<float>(truth), 10.0 + frame / 60.0, false, &state);
+    ASSERT_TRUE(!result.schedule_reset_required);
+    ASSERT_TRUE(std::fabs(result.time - truth) < 1e-6);
+    ASSERT_TRUE(std::fabs(result.time - previous - 1.0 / 60.0) < 1e-6);
+    previous = result.time;
+  }
+}
+
+TEST_CASE("Broadcast clock holds near simulator time while paused") {
+  xp2gdl90::BroadcastClockState state;
+  xp2gdl90::UpdateBroadcastClock(5000.0f, 1.0, false, &state);
+  double previous = 5000.0;
+  for (int tick = 1; tick <= 10; ++tick) {
+    const auto paused =
+        xp2gdl90::UpdateBroadcastClock(5000.0f, 1.0 + tick, false, &state);
+    ASSERT_TRUE(!paused.schedule_reset_required);
+    ASSERT_TRUE(paused.time >= previous);
+    ASSERT_TRUE(paused.time <= 5000.001);
+    previous = paused.time;
+  }
+  // Time acceleration follows simulator time.
+  const auto accelerated =
+      xp2gdl90::UpdateBroadcastClock(5010.0f, 12.0, false, &state);
+  ASSERT_TRUE(std::fabs(accelerated.time - 5010.0) < 0.001);
+}
+
+TEST_CASE("Send interval histogram buckets deviation from the period") {
+  xp2gdl90::SendIntervalHistogram histogram;
+  histogram.recordSend(10.0, 1.0);
+  ASSERT_EQ(static_cast<uint64_t>(0), histogram.count());
+  histogram.recordSend(11.0, 1.0);    // On time.
+  histogram.recordSend(12.003, 1.0);  // 3 ms late.
+  histogram.recordSend(12.853, 1.0);  // 150 ms early.
+  histogram.recordSend(14.0, 1.0);    // 147 ms late.
+  ASSERT_EQ(static_cast<uint64_t>(4), histogram.count());
+  ASSERT_EQ(static_cast<uint64_t>(1), histogram.buckets()[0]);
+  ASSERT_EQ(static_cast<uint64_t>(1), histogram.buckets()[4]);
+  ASSERT_EQ(static_cast<uint64_t>(1), histogram.buckets()[5]);
+  ASSERT_EQ(static_cast<uint64_t>(1), histogram.buckets()[8]);
+  ASSERT_TRUE(std::fabs(histogram.minIntervalS() - 0.85) < 1e-9);
+  ASSERT_TRUE(std::fabs(histogram.maxIntervalS() - 1.147) < 1e-9);
+  ASSERT_TRUE(std::fabs(histogram.meanIntervalS() - 1.0) < 1e-9);
+
+  // A restart skips the gap across a schedule reset.
+  histogram.restart();
+  histogram.recordSend(100.0, 1.0);
+  ASSERT_EQ(static_cast<uint64_t>(4), histogram.count());
+  histogram.reset();
+  ASSERT_EQ(static_cast<uint64_t>(0), histogram.count());
+  ASSERT_EQ(0.0, histogram.minIntervalS());
+}
+
+TEST_CASE("Next wake interval picks the earliest deadline") {
+  const double deadlines[] = {12.0, NAN, 10.4, 11.0};
+  ASSERT_TRUE(std::fabs(xp2gdl90::NextWakeInterval(10.0, deadlines, 4, 0.0,
+                                                   1.0) -
+                        0.4) < 1e-12);
+  // Overdue work wakes at the minimum, distant work at the maximum.
+  ASSERT_EQ(0.01, xp2gdl90::NextWakeInterval(11.5, deadlines, 4, 0.01, 1.0));
+  ASSERT_EQ(0.25, xp2gdl90::NextWakeInterval(0.0, deadlines, 4, 0.01, 0.25));
+  ASSERT_EQ(0.25, xp2gdl90::NextWakeInterval(0.0, nullptr, 0, 0.01, 0.25));
+}
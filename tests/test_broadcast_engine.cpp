@@ -0,0 +1,240 @@
+#include "test_harness.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fake_socket_ops.h"
+#include "xp2gdl90/broadcast_engine.h"
+
+using xp2gdl90::BroadcastEngine;
+using xp2gdl90::BroadcastOptions;
+using xp2gdl90::test::FakeSocketOps;
+
+namespace {
+
+void FillArena(gdl90::FrameArena *arena, size_t count) {
+  arena->clear();
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t *frame = arena->beginFrame();
+    frame[0] = 0x7E;
+    frame[1] = 0x14;
+    frame[2] = static_cast<uint8_t>(i);
+    frame[3] = 0x7E;
+    arena->commitFrame(4);
+  }
+}
+
+const uint8_t kHeartbeat[] = {0x7E, 0x00, 0x7E};
+
+} // namespace
+
+TEST_CASE("Broadcast engine sends inline and keeps the counters") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  BroadcastEngine engine;
+  ASSERT_EQ(-1, engine.sendMessage(kHeartbeat, sizeof(kHeartbeat),
+                                   xp2gdl90::MESSAGE_HEARTBEAT));
+  ASSERT_EQ(static_cast<uint64_t>(1), engine.stats().send_errors);
+
+  engine.attach(&broadcaster);
+  ASSERT_EQ(3, engine.sendMessage(kHeartbeat, sizeof(kHeartbeat),
+                                  xp2gdl90::MESSAGE_HEARTBEAT, true));
+  ASSERT_TRUE(engine.lastError().empty());
+  ASSERT_EQ(static_cast<size_t>(1), ops.sent_datagrams.size());
+  ASSERT_EQ(static_cast<uint64_t>(1), engine.stats().packets_sent);
+  ASSERT_EQ(static_cast<uint64_t>(3), engine.stats().bytes_sent);
+
+  ops.fail_sendto_after = ops.sendto_calls;
+  ASSERT_EQ(-1, engine.sendFrame(kHeartbeat, sizeof(kHeartbeat),
+                                 udp::ALL_DESTINATIONS));
+  ASSERT_EQ(static_cast<uint64_t>(2), engine.stats().send_errors);
+  ASSERT_TRUE(!engine.lastError().empty());
+
+  ops.fail_sendto_after = -1;
+  ASSERT_EQ(3, engine.sendFrame(kHeartbeat, sizeof(kHeartbeat),
+                                udp::ALL_DESTINATIONS));
+  ASSERT_TRUE(engine.lastError().empty());
+  ASSERT_EQ(static_cast<uint64_t>(2), engine.stats().packets_sent);
+}
+
+TEST_CASE("Broadcast engine packs frames until the tick ends") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  BroadcastEngine engine;
+  engine.attach(&broadcaster);
+  BroadcastOptions options;
+  options.datagram_packing = true;
+  std::string error;
+  ASSERT_TRUE(engine.configure(options, &error));
+
+  ASSERT_EQ(3, engine.sendMessage(kHeartbeat, sizeof(kHeartbeat),
+                                  xp2gdl90::MESSAGE_HEARTBEAT, true));
+  gdl90::FrameArena traffic;
+  FillArena(&traffic, 2);
+  engine.startTraffic(traffic, 10.0, 0.0);
+  ASSERT_EQ(static_cast<size_t>(8), engine.sendPacedTraffic(10.0));
+  ASSERT_TRUE(ops.sent_datagrams.empty());
+
+  engine.flush();
+  ASSERT_EQ(static_cast<size_t>(1), ops.sent_datagrams.size());
+  ASSERT_EQ(static_cast<size_t>(11), ops.sent_datagrams[0].size());
+  ASSERT_EQ(static_cast<uint64_t>(3), engine.packerStats().frames_sent);
+  ASSERT_EQ(static_cast<uint64_t>(3), engine.stats().packets_sent);
+  ASSERT_EQ(static_cast<uint64_t>(2), engine.stats().traffic_packets_sent);
+  ASSERT_EQ(static_cast<uint64_t>(11), engine.stats().bytes_sent);
+}
+
+TEST_CASE("Broadcast engine paces a traffic sweep over its window") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  BroadcastEngine engine;
+  engine.attach(&broadcaster);
+  gdl90::FrameArena traffic;
+  FillArena(&traffic, 4);
+  engine.startTraffic(traffic, 10.0, 1.0);
+  ASSERT_EQ(static_cast<size_t>(4), engine.trafficPacer().pending());
+
+  const size_t first = engine.sendPacedTraffic(10.0);
+  ASSERT_TRUE(first > 0 && first < 16);
+  ASSERT_TRUE(engine.trafficPacer().pending() > 0);
+  ASSERT_EQ(static_cast<size_t>(16) - first, engine.sendPacedTraffic(11.0));
+  ASSERT_EQ(static_cast<size_t>(0), engine.sendPacedTraffic(12.0));
+
+  ASSERT_EQ(static_cast<size_t>(4), ops.sent_datagrams.size());
+  ASSERT_TRUE(ops.send_batch_calls >= 2);
+  ASSERT_EQ(static_cast<uint64_t>(4), engine.stats().traffic_packets_sent);
+  ASSERT_EQ(static_cast<uint64_t>(16), engine.stats().bytes_sent);
+
+  // A reset drops the rest of the sweep.
+  engine.startTraffic(traffic, 20.0, 1.0);
+  engine.resetTraffic();
+  ASSERT_EQ(static_cast<size_t>(0), engine.sendPacedTraffic(21.0));
+}
+
+TEST_CASE("Broadcast engine hands frames to the sender thread") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  BroadcastEngine engine;
+  engine.attach(&broadcaster);
+  BroadcastOptions options;
+  options.sender_thread = true;
+  std::string error;
+  ASSERT_TRUE(engine.configure(options, &error));
+  ASSERT_TRUE(engine.senderRunning());
+
+  gdl90::FrameArena traffic;
+  FillArena(&traffic, 3);
+  ASSERT_EQ(3, engine.sendMessage(kHeartbeat, sizeof(kHeartbeat),
+                                  xp2gdl90::MESSAGE_HEARTBEAT, true));
+  engine.startTraffic(traffic, 5.0, 0.0);
+  ASSERT_EQ(static_cast<size_t>(12), engine.sendPacedTraffic(5.0));
+  engine.flush();
+  for (int i = 0; i < 200 && engine.sender()->stats().frames_sent < 4; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_EQ(static_cast<uint64_t>(4), engine.sender()->stats().frames_sent);
+  ASSERT_TRUE(engine.senderLeadSeconds() >= 0.0);
+
+  // Stopping the thread leaves the engine sending inline.
+  options.sender_thread = false;
+  ASSERT_TRUE(engine.configure(options, &error));
+  ASSERT_TRUE(!engine.senderRunning());
+  ASSERT_EQ(static_cast<size_t>(4), ops.sent_datagrams.size());
+  ASSERT_EQ(3, engine.sendMessage(kHeartbeat, sizeof(kHeartbeat),
+                                  xp2gdl90::MESSAGE_HEARTBEAT));
+  ASSERT_EQ(static_cast<size_t>(5), ops.sent_datagrams.size());
+  ASSERT_EQ(static_cast<uint64_t>(5), engine.stats().packets_sent);
+  ASSERT_EQ(static_cast<uint64_t>(0), engine.stats().send_errors);
+}
+
+TEST_CASE("Broadcast options follow the settings") {
+  xp2gdl90::Settings cfg;
+  cfg.datagram_packing = true;
+  cfg.datagram_max_bytes = 512;
+  cfg.sender_thread = true;
+  cfg.sender_overflow_policy = 1;
+  cfg.link_probe = true;
+  cfg.worker_thread_priority = 1;
+  cfg.worker_cpu_mask = 0x3;
+  const BroadcastOptions options = xp2gdl90::MakeBroadcastOptions(cfg);
+  ASSERT_TRUE(options.datagram_packing);
+  ASSERT_EQ(static_cast<size_t>(512), options.datagram_max_bytes);
+  ASSERT_TRUE(options.sender_thread);
+  ASSERT_TRUE(options.overflow_policy ==
+              udp::OverflowPolicy::DROP_NEWEST_TRAFFIC);
+  ASSERT_TRUE(options.link_probe);
+  ASSERT_TRUE(options.sender_tuning.priority ==
+              xp2gdl90::ThreadPriority::HIGH);
+  ASSERT_EQ(0x3u, options.sender_tuning.cpu_mask);
+}
+
+TEST_CASE("Broadcast engine ends ticks that sent with a link probe mark") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  BroadcastEngine engine;
+  engine.attach(&broadcaster);
+  BroadcastOptions options;
+  options.datagram_packing = true;
+  options.link_probe = true;
+  std::string error;
+  ASSERT_TRUE(engine.configure(options, &error));
+
+  // An idle tick sends nothing, not even a mark.
+  engine.flush();
+  ASSERT_TRUE(ops.sent_datagrams.empty());
+
+  const std::vector<uint8_t> heartbeat =
+      gdl90::GDL90Encoder().createHeartbeat();
+  xp2gdl90::LinkProbe probe;
+  for (int tick = 0; tick < 2; ++tick) {
+    ASSERT_EQ(static_cast<int>(heartbeat.size()),
+              engine.sendMessage(heartbeat.data(), heartbeat.size(),
+                                 xp2gdl90::MESSAGE_HEARTBEAT, true));
+    engine.flush();
+    ASSERT_EQ(static_cast<size_t>(tick + 1), ops.sent_datagrams.size());
+    const std::vector<uint8_t> &datagram = ops.sent_datagrams.back();
+    probe.receiveDatagram(datagram.data(), datagram.size(),
+                          1000000000LL * (tick + 1), 0);
+  }
+  ASSERT_EQ(static_cast<uint64_t>(2), engine.stats().probe_marks_sent);
+  ASSERT_EQ(static_cast<uint64_t>(2), probe.stats().marks);
+  ASSERT_EQ(static_cast<uint64_t>(0), probe.stats().marks_lost);
+  ASSERT_EQ(static_cast<uint64_t>(2),
+            probe.stats().of(xp2gdl90::ProbeClass::HEARTBEAT).frames);
+
+  // A dry frame pool falls back to copying the mark.
+  std::vector<gdl90::FrameRef> held;
+  while (gdl90::FrameRef frame = engine.acquireFrame()) {
+    held.push_back(std::move(frame));
+  }
+  engine.sendMessage(heartbeat.data(), heartbeat.size(),
+                     xp2gdl90::MESSAGE_HEARTBEAT, true);
+  engine.flush();
+  const std::vector<uint8_t> &datagram = ops.sent_datagrams.back();
+  probe.receiveDatagram(datagram.data(), datagram.size(), 3000000000LL, 0);
+  ASSERT_EQ(static_cast<uint64_t>(3), engine.stats().probe_marks_sent);
+  ASSERT_EQ(static_cast<uint64_t>(3), probe.stats().marks);
+}
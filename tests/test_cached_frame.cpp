@@ -0,0 +1,130 @@
+#include "test_harness.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "xp2gdl90/cached_frame.h"
+#include "xp2gdl90/foreflight_encoder.h"
+#include "xp2gdl90/gdl90_encoder.h"
+
+namespace {
+
+std::vector<uint8_t> Bytes(const gdl90::FrameBuffer &frame) {
+  return frame.toVector();
+}
+
+} // namespace
+
+TEST_CASE("Cached frame reuses an unchanged payload") {
+  gdl90::CachedFrame cache;
+  ASSERT_TRUE(!cache.valid());
+  ASSERT_EQ(static_cast<size_t>(0), cache.patch(0, nullptr, 0));
+
+  const uint8_t payload[] = {0x0B, 0x01, 0x02, 0x7F, 0xFF};
+  const size_t size = cache.update(payload, sizeof(payload));
+  ASSERT_TRUE(cache.valid());
+  ASSERT_EQ(cache.frame().size(), size);
+  ASSERT_EQ(static_cast<uint64_t>(1), cache.misses());
+
+  ASSERT_EQ(size, cache.update(payload, sizeof(payload)));
+  ASSERT_EQ(static_cast<uint64_t>(1), cache.hits());
+
+  // A patch re-frames, escaping a flag byte like a full update would.
+  const uint8_t flag = 0x7E;
+  cache.patch(2, &flag, 1);
+  ASSERT_EQ(static_cast<uint64_t>(2), cache.misses());
+  const uint8_t patched[] = {0x0B, 0x01, 0x7E, 0x7F, 0xFF};
+  gdl90::CachedFrame fresh;
+  fresh.update(patched, sizeof(patched));
+  ASSERT_TRUE(Bytes(cache.frame()) == Bytes(fresh.frame()));
+  // Out-of-range patches are refused.
+  ASSERT_EQ(static_cast<size_t>(0), cache.patch(4, payload, 2));
+
+  cache.invalidate();
+  ASSERT_TRUE(!cache.valid());
+  cache.update(payload, sizeof(payload));
+  ASSERT_EQ(static_cast<uint64_t>(3), cache.misses());
+}
+
+TEST_CASE("Cached heartbeat patches status and timestamp bytes") {
+  uint32_t utc = 0x1007D;
+  gdl90::GDL90Encoder encoder(gdl90::UtcTimeProvider([&utc]() { return utc; }));
+  gdl90::CachedFrame cache;
+
+  encoder.encodeHeartbeatInto(true, true, cache);
+  ASSERT_TRUE(Bytes(cache.frame()) == encoder.createHeartbeat(true, true));
+  encoder.encodeHeartbeatInto(true, true, cache);
+  ASSERT_EQ(static_cast<uint64_t>(1), cache.hits());
+
+  utc = 3600;
+  encoder.encodeHeartbeatInto(false, true, cache);
+  ASSERT_TRUE(Bytes(cache.frame()) == encoder.createHeartbeat(false, true));
+  utc = 0x17E7E;
+  encoder.encodeHeartbeatInto(true, false, cache);
+  ASSERT_TRUE(Bytes(cache.frame()) == encoder.createHeartbeat(true, false));
+  ASSERT_EQ(static_cast<uint64_t>(3), cache.misses());
+}
+
+TEST_CASE("Cached geo-altitude and ID frames match the plain encoders") {
+  gdl90::GDL90Encoder encoder;
+  gdl90::CachedFrame geo_cache;
+  gdl90::GeoAltitudeData geo;
+  geo.altitude_feet = 5500;
+  encoder.encodeOwnshipGeometricAltitudeInto(geo, geo_cache);
+  // Below wire resolution (5 ft), so the frame is reused.
+  geo.altitude_feet = 5501;
+  encoder.encodeOwnshipGeometricAltitudeInto(geo, geo_cache);
+  ASSERT_EQ(static_cast<uint64_t>(1), geo_cache.hits());
+  ASSERT_TRUE(Bytes(geo_cache.frame()) ==
+              encoder.createOwnshipGeometricAltitude(geo));
+
+  gdl90::foreflight::ForeFlightEncoder foreflight;
+  gdl90::foreflight::DeviceInfo info;
+  info.device_name = "XP2GDL90";
+  info.device_long_name = "X-Plane to GDL90";
+  info.capabilities_mask = 0x01u;
+  gdl90::CachedFrame id_cache;
+  foreflight.encodeIdMessageInto(info, id_cache);
+  ASSERT_TRUE(Bytes(id_cache.frame()) == foreflight.createIdMessage(info));
+}
+
+TEST_CASE("Cached ownship report patches only the motion bytes") {
+  gdl90::GDL90Encoder encoder;
+  gdl90::PositionData ownship;
+  ownship.latitude = 47.25;
+  ownship.longitude = 8.5;
+  ownship.altitude = 4500;
+  ownship.h_velocity = 120;
+  ownship.v_velocity = 640;
+  ownship.track = 270;
+  ownship.airborne = true;
+  ownship.icao_address = 0xABCDEF;
+  ownship.callsign = "N12345";
+  gdl90::CachedFrame cache;
+  encoder.encodeOwnshipReportInto(ownship, cache);
+  ASSERT_TRUE(Bytes(cache.frame()) == encoder.createOwnshipReport(ownship));
+
+  // Every motion field, plus the airborne bit that shares a byte with the
+  // altitude, follows the report.
+  ownship.latitude = -33.9;
+  ownship.longitude = 151.2;
+  ownship.altitude = 35000;
+  ownship.h_velocity = gdl90::VELOCITY_INVALID;
+  ownship.v_velocity = -1280;
+  ownship.track = 45;
+  ownship.airborne = false;
+  ownship.nic = 0;
+  encoder.encodeOwnshipReportInto(ownship, cache);
+  ASSERT_TRUE(Bytes(cache.frame()) == encoder.createOwnshipReport(ownship));
+  encoder.encodeOwnshipReportInto(ownship, cache);
+  ASSERT_EQ(static_cast<uint64_t>(1), cache.hits());
+
+  // The held identity stays until the cache is invalidated.
+  gdl90::PositionData renamed = ownship;
+  renamed.callsign = "N999";
+  encoder.encodeOwnshipReportInto(renamed, cache);
+  ASSERT_TRUE(Bytes(cache.frame()) == encoder.createOwnshipReport(ownship));
+  cache.invalidate();
+  encoder.encodeOwnshipReportInto(renamed, cache);
+  ASSERT_TRUE(Bytes(cache.frame()) == encoder.createOwnshipReport(renamed));
+}
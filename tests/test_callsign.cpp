@@ -0,0 +1,35 @@
+#include "test_harness.h"
+
+#include <cstring>
+#include <string>
+
+#include "xp2gdl90/callsign.h"
+
+TEST_CASE("Callsign truncates to the GDL90 field width") {
+  const gdl90::Callsign callsign("ABCDEFGHIJ");
+  ASSERT_EQ(std::string("ABCDEFGH"), callsign.str());
+  ASSERT_TRUE(callsign.full());
+  ASSERT_TRUE(gdl90::Callsign(std::string("N1")) == gdl90::Callsign("N1"));
+  ASSERT_TRUE(gdl90::Callsign("N1") != gdl90::Callsign("N12"));
+  ASSERT_TRUE(gdl90::Callsign(static_cast<const char *>(nullptr)).empty());
+
+  gdl90::Callsign edited = callsign;
+  edited.pop_back();
+  edited.pop_back();
+  ASSERT_EQ(std::string("ABCDEF"), std::string(edited.view()));
+  edited.clear();
+  ASSERT_TRUE(edited.empty());
+}
+
+TEST_CASE("Callsign reads NUL-padded bytes and copies as plain memory") {
+  const char bytes[8] = {'T', 'F', 'C', '\0', 'X', 'X', 'X', 'X'};
+  const gdl90::Callsign callsign = gdl90::Callsign::fromBytes(bytes, 8);
+  ASSERT_EQ(std::string("TFC"), callsign.str());
+  const char full[8] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H'};
+  ASSERT_EQ(std::string("ABCDEFGH"),
+            gdl90::Callsign::fromBytes(full, sizeof(full)).str());
+
+  gdl90::Callsign copy;
+  std::memcpy(static_cast<void *>(&copy), &callsign, sizeof(copy));
+  ASSERT_TRUE(copy == callsign);
+}
@@ -0,0 +1,163 @@
+#include "test_harness.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "fake_socket_ops.h"
+#include "xp2gdl90/capture_replay.h"
+#include "xp2gdl90/gdl90_decoder.h"
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/stream_capture.h"
+
+namespace {
+
+std::filesystem::path MakeTempPath(const char *suffix) {
+  const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+  return std::filesystem::temp_directory_path() /
+         ("xp2gdl90_" + std::to_string(now) + "_" + suffix);
+}
+
+struct ScopedFileCleanup {
+  explicit ScopedFileCleanup(std::filesystem::path file_path)
+      : path(std::move(file_path)) {}
+
+  ~ScopedFileCleanup() {
+    std::error_code error;
+    std::filesystem::remove(path, error);
+  }
+
+  std::filesystem::path path;
+};
+
+std::vector<uint8_t> PackedTraffic(const gdl90::GDL90Encoder &encoder,
+                                   uint32_t first_address, size_t count) {
+  std::vector<uint8_t> packed;
+  gdl90::PositionData report;
+  report.latitude = 47.5;
+  report.longitude = -122.25;
+  report.altitude = 4500;
+  for (size_t i = 0; i < count; ++i) {
+    report.icao_address = first_address + static_cast<uint32_t>(i);
+    const std::vector<uint8_t> frame = encoder.createTrafficReport(report);
+    packed.insert(packed.end(), frame.begin(), frame.end());
+  }
+  return packed;
+}
+
+} // namespace
+
+TEST_CASE("Capture reader joins the records of each datagram") {
+  ScopedFileCleanup cleanup(MakeTempPath("replay_read.pcap"));
+  gdl90::GDL90Encoder encoder;
+  const std::vector<uint8_t> heartbeat = encoder.createHeartbeat(true, true);
+  const std::vector<uint8_t> packed = PackedTraffic(encoder, 0xABC000, 6);
+  {
+    udp::StreamCapture capture;
+    std::string error;
+    ASSERT_TRUE(capture.open(cleanup.path.string(), 0, &error));
+    capture.record(heartbeat.data(), heartbeat.size(), 0);
+    capture.record(packed.data(), packed.size(), 0);
+    capture.record(heartbeat.data(), heartbeat.size(), 1);
+    ASSERT_TRUE(capture.stats().records > 3);
+  }
+
+  std::vector<udp::CaptureDatagram> datagrams;
+  std::string error;
+  ASSERT_TRUE(udp::ReadCapture(cleanup.path.string(), &datagrams, &error));
+  ASSERT_EQ(static_cast<size_t>(3), datagrams.size());
+  ASSERT_TRUE(datagrams[0].data == heartbeat);
+  ASSERT_TRUE(datagrams[1].data == packed);
+  ASSERT_EQ(0, static_cast<int>(datagrams[1].destination));
+  ASSERT_TRUE(datagrams[2].data == heartbeat);
+  ASSERT_EQ(1, static_cast<int>(datagrams[2].destination));
+  ASSERT_TRUE(datagrams[0].timestamp_ns <= datagrams[1].timestamp_ns);
+
+  ASSERT_TRUE(!udp::ReadCapture(MakeTempPath("missing.pcap").string(),
+                                &datagrams, &error));
+  ASSERT_TRUE(!error.empty());
+}
+
+TEST_CASE("Replay multiplies traffic into synthetic addresses") {
+  gdl90::GDL90Encoder encoder;
+  udp::CaptureDatagram datagram;
+  datagram.data = encoder.createHeartbeat(true, true);
+  const std::vector<uint8_t> packed = PackedTraffic(encoder, 0xA00000, 2);
+  datagram.data.insert(datagram.data.end(), packed.begin(), packed.end());
+  udp::CaptureDatagram other = datagram;
+  other.destination = 2;
+
+  xp2gdl90::test::FakeSocketOps ops;
+  ops.create_socket_result = 42;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  udp::ReplayOptions options;
+  options.speed = 0.0;
+  options.traffic_copies = 100;
+  options.address_step = 0x10;
+  udp::CaptureReplay replay(broadcaster, options);
+  replay.run({datagram, other});
+
+  // Records for other capture destinations are not replayed.
+  const udp::ReplayStats &stats = replay.stats();
+  ASSERT_EQ(static_cast<uint64_t>(198), stats.synthetic_reports);
+  ASSERT_EQ(static_cast<uint64_t>(0), stats.send_errors);
+  ASSERT_EQ(static_cast<uint64_t>(ops.sent_datagrams.size()), stats.datagrams);
+  ASSERT_TRUE(stats.datagrams > 1);
+
+  size_t heartbeats = 0;
+  std::vector<bool> seen(200, false);
+  for (const std::vector<uint8_t> &sent : ops.sent_datagrams) {
+    ASSERT_TRUE(sent.size() <= udp::DATAGRAM_DEFAULT_MAX_BYTES);
+    gdl90::Decoder decoder(sent.data(), sent.size());
+    gdl90::FrameSpan frame;
+    while (decoder.next(&frame)) {
+      gdl90::PositionData report;
+      if (frame.messageId() == gdl90::MSG_ID_HEARTBEAT) {
+        ++heartbeats;
+        continue;
+      }
+      ASSERT_TRUE(gdl90::DecodePositionReport(frame, &report));
+      ASSERT_EQ(4500, report.altitude);
+      const uint32_t offset = report.icao_address - 0xA00000;
+      const size_t target = (offset & 0xF) * 100 + offset / 0x10;
+      ASSERT_TRUE(target < seen.size() && !seen[target]);
+      seen[target] = true;
+    }
+  }
+  ASSERT_EQ(static_cast<size_t>(1), heartbeats);
+  for (bool target : seen) {
+    ASSERT_TRUE(target);
+  }
+}
+
+TEST_CASE("Replay keeps the recorded spacing at the chosen speed") {
+  xp2gdl90::test::FakeSocketOps ops;
+  ops.create_socket_result = 42;
+  ops.sendto_result = 4;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  std::vector<udp::CaptureDatagram> datagrams(3);
+  for (size_t i = 0; i < datagrams.size(); ++i) {
+    datagrams[i].timestamp_ns = 1700000000000000000 + i * 40000000;
+    datagrams[i].data = {0x7E, static_cast<uint8_t>(i), 0x00, 0x7E};
+  }
+  udp::ReplayOptions options;
+  options.speed = 4.0;
+  udp::CaptureReplay replay(broadcaster, options);
+  const auto start = std::chrono::steady_clock::now();
+  replay.run(datagrams);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // 80 ms of capture at 4x takes at least 20 ms.
+  ASSERT_TRUE(elapsed >= std::chrono::milliseconds(20));
+  ASSERT_EQ(static_cast<uint64_t>(3), replay.stats().datagrams);
+  ASSERT_EQ(static_cast<size_t>(3), ops.sent_datagrams.size());
+  // Unmultiplied datagrams go out as recorded.
+  ASSERT_TRUE(ops.sent_datagrams[2] == datagrams[2].data);
+}
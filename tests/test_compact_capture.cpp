@@ -0,0 +1,287 @@
+#include "test_harness.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "xp2gdl90/capture_replay.h"
+#include "xp2gdl90/compact_capture.h"
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/stream_capture.h"
+
+namespace {
+
+constexpr int64_t kStartNs = 1700000000000000000;
+constexpr int64_t kSecondNs = 1000000000;
+constexpr size_t kTargets = 60;
+// The pcap ring's slot: record header plus one record's data.
+constexpr size_t kPcapSlotSize = 16 + udp::CAPTURE_RECORD_DATA;
+
+std::filesystem::path MakeTempPath(const char *suffix) {
+  const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+  return std::filesystem::temp_directory_path() /
+         ("xp2gdl90_" + std::to_string(now) + "_" + suffix);
+}
+
+struct ScopedFileCleanup {
+  explicit ScopedFileCleanup(std::filesystem::path file_path)
+      : path(std::move(file_path)) {}
+
+  ~ScopedFileCleanup() {
+    std::error_code error;
+    std::filesystem::remove(path, error);
+  }
+
+  std::filesystem::path path;
+};
+
+udp::CaptureDatagram Datagram(int64_t timestamp_ns, std::vector<uint8_t> data,
+                              uint8_t destination = 0) {
+  udp::CaptureDatagram datagram;
+  datagram.timestamp_ns = timestamp_ns;
+  datagram.destination = destination;
+  datagram.data = std::move(data);
+  return datagram;
+}
+
+// `seconds` of a 5 Hz ownship stream with a heartbeat and a sweep of
+// kTargets climbing, turning targets each second, packed 30 to a datagram.
+std::vector<udp::CaptureDatagram> MakeSession(int seconds) {
+  uint32_t utc = 43200;
+  gdl90::GDL90Encoder encoder([&utc]() { return utc; });
+  std::vector<udp::CaptureDatagram> session;
+  gdl90::PositionData ownship;
+  ownship.latitude = 37.5;
+  ownship.longitude = -122.25;
+  ownship.altitude = 4500;
+  ownship.h_velocity = 120;
+  ownship.track = 90;
+  ownship.airborne = true;
+  ownship.nic = 8;
+  ownship.nacp = 9;
+  ownship.icao_address = 0xA12345;
+  ownship.callsign = "N12345";
+  gdl90::GeoAltitudeData geo;
+
+  for (int tick = 0; tick < seconds * 5; ++tick) {
+    const int64_t now = kStartNs + tick * (kSecondNs / 5);
+    if (tick % 5 == 0) {
+      utc = 43200 + static_cast<uint32_t>(tick / 5);
+      session.push_back(Datagram(now, encoder.createHeartbeat(true, true)));
+    }
+    ownship.longitude += 0.0001;
+    geo.altitude_feet = ownship.altitude + 150;
+    std::vector<uint8_t> data = encoder.createOwnshipReport(ownship);
+    const std::vector<uint8_t> altitude =
+        encoder.createOwnshipGeometricAltitude(geo);
+    data.insert(data.end(), altitude.begin(), altitude.end());
+    session.push_back(Datagram(now + 1000, data));
+
+    if (tick % 5 != 0) {
+      continue;
+    }
+    const int second = tick / 5;
+    std::vector<uint8_t> packed;
+    for (size_t i = 0; i < kTargets; ++i) {
+      gdl90::PositionData report;
+      report.latitude = 37.0 + 0.01 * static_cast<double>(i) +
+                        0.0005 * static_cast<double>(second);
+      report.longitude = -122.0 - 0.0003 * static_cast<double>(second);
+      report.altitude = 3000 + static_cast<int32_t>(i * 100) + second * 25;
+      report.h_velocity = static_cast<uint16_t>(100 + i);
+      report.v_velocity = 500;
+      report.track = static_cast<uint16_t>((i * 6 + second) % 360);
+      report.airborne = true;
+      report.nic = 8;
+      report.nacp = 8;
+      report.icao_address = 0xC00000 + static_cast<uint32_t>(i);
+      report.callsign = i % 2 == 0 ? "TRAFFIC" : "";
+      // A target that changes its callsign mid-session.
+      if (i == 3 && second >= seconds / 2) {
+        report.callsign = "RENAMED";
+      }
+      const std::vector<uint8_t> frame = encoder.createTrafficReport(report);
+      packed.insert(packed.end(), frame.begin(), frame.end());
+      if ((i + 1) % 30 == 0) {
+        session.push_back(Datagram(now + 2000, packed, 1));
+        packed.clear();
+      }
+    }
+  }
+  // Something that is not GDL90 at all.
+  session.push_back(
+      Datagram(kStartNs + seconds * kSecondNs, {'h', 'e', 'l', 'l', 'o'}));
+  return session;
+}
+
+size_t RawBytes(const std::vector<udp::CaptureDatagram> &session) {
+  size_t bytes = 0;
+  for (const udp::CaptureDatagram &datagram : session) {
+    bytes += datagram.data.size();
+  }
+  return bytes;
+}
+
+size_t PcapBytes(const std::vector<udp::CaptureDatagram> &session) {
+  size_t slots = 0;
+  for (const udp::CaptureDatagram &datagram : session) {
+    slots += (datagram.data.size() + udp::CAPTURE_FRAME_BYTES - 1) /
+             udp::CAPTURE_FRAME_BYTES;
+  }
+  return slots * kPcapSlotSize;
+}
+
+bool SameDatagram(const udp::CaptureDatagram &a,
+                  const udp::CaptureDatagram &b) {
+  return a.timestamp_ns == b.timestamp_ns && a.destination == b.destination &&
+         a.data == b.data;
+}
+
+bool WriteSession(const std::string &path,
+                  const std::vector<udp::CaptureDatagram> &session,
+                  udp::StreamCaptureStats *out_stats) {
+  udp::CompactCaptureWriter writer;
+  std::string error;
+  if (!writer.open(path, &error)) {
+    return false;
+  }
+  for (const udp::CaptureDatagram &datagram : session) {
+    writer.recordAt(datagram.timestamp_ns, datagram.data.data(),
+                    datagram.data.size(), datagram.destination);
+  }
+  writer.close();
+  *out_stats = writer.stats();
+  return !writer.isOpen();
+}
+
+} // namespace
+
+TEST_CASE("Compact capture encoding rebuilds every datagram") {
+  const std::vector<udp::CaptureDatagram> session = MakeSession(30);
+  udp::CompactCaptureEncoder encoder;
+  encoder.reset(kStartNs);
+  std::vector<uint8_t> body;
+  for (const udp::CaptureDatagram &datagram : session) {
+    encoder.encode(datagram.timestamp_ns, datagram.destination,
+                   datagram.data.data(), datagram.data.size(), &body);
+  }
+  // Ownship and traffic become residuals; heartbeats and geo altitude
+  // stay whole.
+  ASSERT_EQ(static_cast<uint64_t>(30 * (5 + kTargets)), encoder.predicted());
+  ASSERT_TRUE(encoder.literal() > 0u);
+
+  udp::CompactCaptureDecoder decoder;
+  decoder.reset(kStartNs);
+  size_t offset = 0;
+  udp::CaptureDatagram decoded;
+  for (const udp::CaptureDatagram &datagram : session) {
+    ASSERT_TRUE(decoder.decode(body.data(), body.size(), &offset, &decoded));
+    ASSERT_TRUE(SameDatagram(datagram, decoded));
+  }
+  ASSERT_EQ(body.size(), offset);
+  ASSERT_TRUE(!decoder.decode(body.data(), body.size(), &offset, &decoded));
+
+  // One block's worth costs under a sixth of its wire bytes.
+  ASSERT_TRUE(body.size() * 6 <= RawBytes(session));
+
+  // A body cut mid-datagram is refused, not misread.
+  decoder.reset(kStartNs);
+  offset = 0;
+  size_t decoded_count = 0;
+  while (decoder.decode(body.data(), body.size() / 2, &offset, &decoded)) {
+    ++decoded_count;
+  }
+  ASSERT_TRUE(decoded_count > 0u);
+  ASSERT_TRUE(decoded_count < session.size());
+}
+
+TEST_CASE("Compact capture files read back whole and seek by time") {
+  ScopedFileCleanup cleanup(MakeTempPath("compact.xcap"));
+  const std::vector<udp::CaptureDatagram> session = MakeSession(130);
+  udp::StreamCaptureStats stats;
+  ASSERT_TRUE(WriteSession(cleanup.path.string(), session, &stats));
+  ASSERT_EQ(static_cast<uint64_t>(session.size()), stats.records);
+  ASSERT_EQ(static_cast<uint64_t>(RawBytes(session)), stats.bytes);
+  ASSERT_EQ(static_cast<uint64_t>(0), stats.dropped);
+  ASSERT_EQ(static_cast<uint64_t>(std::filesystem::file_size(cleanup.path)),
+            stats.file_bytes);
+
+  // At least 5x smaller than its wire bytes, and 10x smaller than the
+  // fewest pcap slots that could hold them.
+  ASSERT_TRUE(stats.file_bytes * 5 <= stats.bytes);
+  ASSERT_TRUE(stats.file_bytes * 10 <= PcapBytes(session));
+
+  std::vector<udp::CaptureDatagram> read;
+  std::string error;
+  ASSERT_TRUE(udp::IsCompactCapture(cleanup.path.string()));
+  ASSERT_TRUE(udp::ReadCapture(cleanup.path.string(), &read, &error));
+  ASSERT_EQ(session.size(), read.size());
+  for (size_t i = 0; i < session.size(); ++i) {
+    ASSERT_TRUE(SameDatagram(session[i], read[i]));
+    ASSERT_EQ(static_cast<uint32_t>(i + 1), read[i].sequence);
+  }
+
+  udp::CompactCaptureReader reader;
+  ASSERT_TRUE(reader.open(cleanup.path.string(), &error));
+  ASSERT_EQ(static_cast<uint64_t>(reader.blocks().size()), stats.flushes);
+  ASSERT_TRUE(reader.blocks().size() >= 5u);
+  const int64_t target = kStartNs + 75 * kSecondNs + 500000000;
+  reader.seek(target);
+  udp::CaptureDatagram datagram;
+  ASSERT_TRUE(reader.next(&datagram));
+  size_t index = 0;
+  while (session[index].timestamp_ns < target) {
+    ++index;
+  }
+  ASSERT_TRUE(SameDatagram(session[index], datagram));
+  ASSERT_EQ(static_cast<uint32_t>(index + 1), datagram.sequence);
+  size_t rest = 1;
+  while (reader.next(&datagram)) {
+    ++rest;
+  }
+  ASSERT_EQ(session.size() - index, rest);
+
+  // Before the start reads everything; past the end reads nothing.
+  reader.seek(0);
+  ASSERT_TRUE(reader.next(&datagram));
+  ASSERT_TRUE(SameDatagram(session.front(), datagram));
+  reader.seek(session.back().timestamp_ns + 1);
+  ASSERT_TRUE(!reader.next(&datagram));
+}
+
+TEST_CASE("A compact capture cut short ends at its last whole block") {
+  ScopedFileCleanup cleanup(MakeTempPath("compact_cut.xcap"));
+  const std::vector<udp::CaptureDatagram> session = MakeSession(65);
+  udp::StreamCaptureStats stats;
+  ASSERT_TRUE(WriteSession(cleanup.path.string(), session, &stats));
+  udp::CompactCaptureReader reader;
+  std::string error;
+  ASSERT_TRUE(reader.open(cleanup.path.string(), &error));
+  const std::vector<udp::CompactCaptureBlock> blocks = reader.blocks();
+  ASSERT_TRUE(blocks.size() >= 3u);
+
+  std::filesystem::resize_file(cleanup.path,
+                               blocks.back().offset + blocks.back().size / 2);
+  std::vector<udp::CaptureDatagram> read;
+  ASSERT_TRUE(udp::ReadCompactCapture(cleanup.path.string(), &read, &error));
+  ASSERT_EQ(static_cast<size_t>(blocks.back().first_sequence - 1),
+            read.size());
+  ASSERT_TRUE(SameDatagram(session[read.size() - 1], read.back()));
+
+  // Neither a missing file nor a pcap ring passes for a compact capture.
+  const std::string missing = MakeTempPath("missing.xcap").string();
+  ASSERT_TRUE(!udp::IsCompactCapture(missing));
+  ASSERT_TRUE(!reader.open(missing, &error));
+  ASSERT_TRUE(!error.empty());
+  ScopedFileCleanup ring(MakeTempPath("ring.pcap"));
+  {
+    udp::StreamCapture capture;
+    ASSERT_TRUE(capture.open(ring.path.string(), 0, &error));
+  }
+  ASSERT_TRUE(!udp::IsCompactCapture(ring.path.string()));
+  error.clear();
+  ASSERT_TRUE(!reader.open(ring.path.string(), &error));
+  ASSERT_TRUE(!error.empty());
+}
@@ -0,0 +1,62 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "frame_test_utils.h"
+#include "xp2gdl90/crc16.h"
+
+namespace {
+
+std::vector<uint8_t> PatternBytes(size_t size, uint8_t seed) {
+  std::vector<uint8_t> bytes(size);
+  uint8_t value = seed;
+  for (size_t i = 0; i < size; ++i) {
+    value = static_cast<uint8_t>(value * 37 + 11);
+    bytes[i] = value;
+  }
+  return bytes;
+}
+
+} // namespace
+
+TEST_CASE("CRC16 spec table matches the GDL90 reference table") {
+  ASSERT_EQ(static_cast<uint16_t>(0x0000), gdl90::detail::kCrc16Tables[0][0]);
+  ASSERT_EQ(static_cast<uint16_t>(0x1021), gdl90::detail::kCrc16Tables[0][1]);
+  ASSERT_EQ(static_cast<uint16_t>(0x1ef0),
+            gdl90::detail::kCrc16Tables[0][255]);
+}
+
+TEST_CASE("CRC16 slicing kernel matches bytewise reference for all lengths") {
+  for (size_t size = 0; size <= 80; ++size) {
+    const auto bytes = PatternBytes(size, static_cast<uint8_t>(size));
+    ASSERT_EQ(xp2gdl90::test::ComputeCrc(bytes),
+              gdl90::Crc16(bytes.data(), bytes.size()));
+  }
+}
+
+TEST_CASE("CRC16 continues a running checksum across calls") {
+  const auto bytes = PatternBytes(45, 3);
+  const uint16_t head = gdl90::Crc16(bytes.data(), 13);
+  ASSERT_EQ(gdl90::Crc16(bytes.data(), bytes.size()),
+            gdl90::Crc16(bytes.data() + 13, bytes.size() - 13, head));
+}
+
+TEST_CASE("CRC16 batch mode matches per-buffer checksums") {
+  std::vector<std::vector<uint8_t>> frames;
+  for (size_t i = 0; i < 11; ++i) {
+    frames.push_back(PatternBytes(5 + i * 7, static_cast<uint8_t>(i)));
+  }
+
+  std::vector<const uint8_t *> buffers;
+  std::vector<size_t> sizes;
+  for (const auto &frame : frames) {
+    buffers.push_back(frame.data());
+    sizes.push_back(frame.size());
+  }
+
+  std::vector<uint16_t> crcs(frames.size(), 0);
+  gdl90::Crc16Batch(buffers.data(), sizes.data(), frames.size(), crcs.data());
+  for (size_t i = 0; i < frames.size(); ++i) {
+    ASSERT_EQ(xp2gdl90::test::ComputeCrc(frames[i]), crcs[i]);
+  }
+}
@@ -0,0 +1,139 @@
+#include "test_harness.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "fake_socket_ops.h"
+#include "xp2gdl90/datagram_packer.h"
+
+using xp2gdl90::test::FakeSocketOps;
+
+namespace {
+
+std::vector<uint8_t> MakeFrame(size_t size, uint8_t marker) {
+  std::vector<uint8_t> frame(size, marker);
+  frame.front() = 0x7E;
+  frame.back() = 0x7E;
+  return frame;
+}
+
+} // namespace
+
+TEST_CASE("Datagram packer fills datagrams up to the configured size") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 7;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  udp::DatagramPacker packer(200);
+  const auto frame = MakeFrame(60, 0x11);
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(packer.append(frame.data(), frame.size(), false, broadcaster));
+  }
+  ASSERT_EQ(1, ops.sendto_calls);
+  ASSERT_EQ(static_cast<size_t>(180), ops.sent_datagrams[0].size());
+  ASSERT_EQ(static_cast<size_t>(2), packer.pendingFrames());
+
+  ASSERT_TRUE(packer.flush(broadcaster) >= 0);
+  ASSERT_EQ(2, ops.sendto_calls);
+  ASSERT_EQ(static_cast<size_t>(120), ops.sent_datagrams[1].size());
+  ASSERT_EQ(static_cast<size_t>(0), packer.pendingBytes());
+  ASSERT_EQ(0, packer.flush(broadcaster));
+
+  const udp::DatagramPackerStats &stats = packer.stats();
+  ASSERT_EQ(static_cast<uint64_t>(2), stats.datagrams_sent);
+  ASSERT_EQ(static_cast<uint64_t>(5), stats.frames_sent);
+  ASSERT_EQ(static_cast<uint64_t>(300), stats.bytes_sent);
+  ASSERT_EQ(0.6, stats.last_fill_ratio);
+  ASSERT_EQ(0.6, stats.min_fill_ratio);
+  ASSERT_EQ(0.75, stats.averageFillRatio());
+}
+
+TEST_CASE("Datagram packer starts a new datagram for leading frames") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 7;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  udp::DatagramPacker packer;
+  const auto traffic = MakeFrame(40, 0x14);
+  const auto heartbeat = MakeFrame(11, 0x00);
+  ASSERT_TRUE(packer.append(heartbeat.data(), heartbeat.size(), true,
+                            broadcaster));
+  ASSERT_TRUE(packer.append(traffic.data(), traffic.size(), false,
+                            broadcaster));
+  ASSERT_EQ(0, ops.sendto_calls);
+
+  ASSERT_TRUE(packer.append(heartbeat.data(), heartbeat.size(), true,
+                            broadcaster));
+  ASSERT_EQ(1, ops.sendto_calls);
+  ASSERT_EQ(static_cast<size_t>(51), ops.sent_datagrams[0].size());
+  ASSERT_EQ(static_cast<uint8_t>(0x00), ops.sent_datagrams[0][1]);
+  ASSERT_EQ(static_cast<size_t>(11), packer.pendingBytes());
+}
+
+TEST_CASE("Datagram packer sends oversize frames alone and clamps limits") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 7;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  udp::DatagramPacker packer(1);
+  ASSERT_EQ(udp::DATAGRAM_MIN_MAX_BYTES, packer.maxDatagramBytes());
+  packer.setMaxDatagramBytes(1000000);
+  ASSERT_EQ(udp::DATAGRAM_MAX_MAX_BYTES, packer.maxDatagramBytes());
+  packer.setMaxDatagramBytes(128);
+
+  const auto large = MakeFrame(130, 0x33);
+  ASSERT_TRUE(packer.append(large.data(), large.size(), false, broadcaster));
+  ASSERT_EQ(1, ops.sendto_calls);
+  ASSERT_EQ(1.0, packer.stats().last_fill_ratio);
+  ASSERT_EQ(static_cast<size_t>(0), packer.pendingFrames());
+}
+
+TEST_CASE("Datagram packer reports send failures") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 7;
+  ops.sendto_result = -1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  udp::DatagramPacker packer(128);
+  const auto frame = MakeFrame(100, 0x44);
+  ASSERT_TRUE(packer.append(frame.data(), frame.size(), false, broadcaster));
+  ASSERT_TRUE(!packer.append(frame.data(), frame.size(), false, broadcaster));
+  ASSERT_EQ(-1, packer.flush(broadcaster));
+  ASSERT_EQ(static_cast<uint64_t>(2), packer.stats().send_errors);
+  ASSERT_EQ(static_cast<uint64_t>(0), packer.stats().datagrams_sent);
+
+  packer.resetStats();
+  ASSERT_EQ(static_cast<uint64_t>(0), packer.stats().send_errors);
+  ASSERT_EQ(0.0, packer.stats().averageFillRatio());
+}
+
+TEST_CASE("Datagram packer splits datagrams when the route changes") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 7;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  ASSERT_TRUE(broadcaster.addDestination("127.0.0.1", 4001));
+
+  udp::DatagramPacker packer;
+  const auto frame = MakeFrame(20, 0x33);
+  ASSERT_TRUE(packer.append(frame.data(), frame.size(), false, broadcaster,
+                            0x3u));
+  ASSERT_TRUE(packer.append(frame.data(), frame.size(), false, broadcaster,
+                            0x3u));
+  ASSERT_EQ(0, ops.sendto_calls);
+  ASSERT_TRUE(packer.append(frame.data(), frame.size(), false, broadcaster,
+                            0x1u));
+  ASSERT_EQ(2, ops.sendto_calls);
+  ASSERT_EQ(static_cast<size_t>(40), ops.sent_datagrams[0].size());
+  ASSERT_TRUE(packer.flush(broadcaster) >= 0);
+  ASSERT_EQ(3, ops.sendto_calls);
+  ASSERT_EQ(static_cast<size_t>(20), ops.sent_datagrams[2].size());
+}
@@ -0,0 +1,40 @@
+#include "test_harness.h"
+
+#include <cstring>
+
+#include "xp2gdl90/dataref_cache.h"
+
+namespace {
+
+int g_finder_calls = 0;
+int g_latitude = 0;
+
+void *FakeFindDataRef(const char *name) {
+  ++g_finder_calls;
+  return std::strcmp(name, "sim/flightmodel/position/latitude") == 0
+             ? &g_latitude
+             : nullptr;
+}
+
+} // namespace
+
+TEST_CASE("DataRef cache looks each found name up once") {
+  g_finder_calls = 0;
+  xp2gdl90::DataRefCache cache(FakeFindDataRef);
+
+  ASSERT_TRUE(cache.find("sim/flightmodel/position/latitude") == &g_latitude);
+  ASSERT_TRUE(cache.find("sim/flightmodel/position/latitude") == &g_latitude);
+  ASSERT_EQ(1, g_finder_calls);
+  ASSERT_EQ(static_cast<size_t>(1), cache.size());
+
+  // Misses are asked again: the name may be published later.
+  ASSERT_TRUE(cache.find("sim/multiplayer/position/plane1_x") == nullptr);
+  ASSERT_TRUE(cache.find("sim/multiplayer/position/plane1_x") == nullptr);
+  ASSERT_EQ(3, g_finder_calls);
+  ASSERT_EQ(static_cast<uint64_t>(3), cache.lookups());
+  ASSERT_TRUE(cache.find(nullptr) == nullptr);
+
+  cache.clear();
+  ASSERT_TRUE(cache.find("sim/flightmodel/position/latitude") == &g_latitude);
+  ASSERT_EQ(4, g_finder_calls);
+}
@@ -0,0 +1,169 @@
+#include "test_harness.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "xp2gdl90/foreflight_discovery.h"
+
+TEST_CASE("DiscoveryListener without a receiver reports errors") {
+  xp2gdl90::foreflight::DiscoveryListener listener(nullptr);
+  ASSERT_EQ(-1, listener.pollOnce(0));
+  ASSERT_EQ(static_cast<uint64_t>(0), listener.snapshot().sequence);
+  ASSERT_EQ(static_cast<uint16_t>(0), listener.getListenPort());
+}
+
+TEST_CASE("DiscoveryListener surfaces receiver errors") {
+  auto receiver = std::make_unique<udp::UDPReceiver>(47603);
+  xp2gdl90::foreflight::DiscoveryListener listener(std::move(receiver));
+  ASSERT_EQ(static_cast<uint16_t>(47603), listener.getListenPort());
+  ASSERT_EQ(-1, listener.pollOnce(0));
+  ASSERT_EQ(static_cast<uint64_t>(1), listener.errorCount());
+  ASSERT_EQ(std::string("Socket not initialized"), listener.lastError());
+}
+
+#if !defined(_WIN32)
+namespace {
+
+constexpr uint16_t kDiscoveryTestPort = 47604;
+
+void SendDiscovery(const std::string &payload) {
+  const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_TRUE(fd >= 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(kDiscoveryTestPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  const ssize_t sent =
+      ::sendto(fd, payload.data(), payload.size(), 0,
+               reinterpret_cast<const sockaddr *>(&addr), sizeof(addr));
+  ::close(fd);
+  ASSERT_EQ(static_cast<ssize_t>(payload.size()), sent);
+}
+
+std::unique_ptr<udp::UDPReceiver> OpenReceiver() {
+  auto receiver = std::make_unique<udp::UDPReceiver>(kDiscoveryTestPort);
+  ASSERT_TRUE(receiver->initialize());
+  return receiver;
+}
+
+} // namespace
+
+TEST_CASE("DiscoveryListener publishes valid broadcasts in a snapshot") {
+  xp2gdl90::foreflight::DiscoveryListener listener(OpenReceiver());
+  ASSERT_EQ(0, listener.pollOnce(0));
+
+  SendDiscovery("not json");
+  SendDiscovery("{\"App\":\"ForeFlight\",\"GDL90\":{\"port\":4002}}");
+  ASSERT_EQ(1, listener.pollOnce(100));
+
+  const xp2gdl90::foreflight::DiscoverySnapshot snapshot =
+      listener.snapshot();
+  ASSERT_EQ(static_cast<uint64_t>(1), snapshot.sequence);
+  ASSERT_EQ(htonl(INADDR_LOOPBACK), snapshot.target.ipv4);
+  ASSERT_EQ(static_cast<uint16_t>(4002), snapshot.target.port);
+  ASSERT_EQ(static_cast<uint64_t>(0), listener.errorCount());
+}
+
+TEST_CASE("DiscoveryListener queues every broadcast for takeSightings") {
+  xp2gdl90::foreflight::DiscoveryListener listener(OpenReceiver());
+  SendDiscovery("{\"App\":\"ForeFlight\",\"GDL90\":{\"port\":4002}}");
+  SendDiscovery("{\"App\":\"ForeFlight\",\"GDL90\":{\"port\":4004}}");
+  for (int i = 0; i < 20 && listener.snapshot().sequence < 2; ++i) {
+    listener.pollOnce(50);
+  }
+
+  // Both survive, although the snapshot only holds the second.
+  udp::SourceAddress sightings[4];
+  ASSERT_EQ(static_cast<size_t>(1), listener.takeSightings(sightings, 1));
+  ASSERT_EQ(static_cast<uint16_t>(4002), sightings[0].port);
+  ASSERT_EQ(static_cast<size_t>(1), listener.takeSightings(sightings, 4));
+  ASSERT_EQ(static_cast<uint16_t>(4004), sightings[0].port);
+  ASSERT_EQ(static_cast<size_t>(0), listener.takeSightings(sightings, 4));
+}
+
+TEST_CASE("DiscoveryListener thread wakes on readiness") {
+  xp2gdl90::foreflight::DiscoveryListener listener(OpenReceiver(), 10);
+  ASSERT_TRUE(listener.start());
+  ASSERT_TRUE(listener.start());
+  ASSERT_TRUE(listener.isRunning());
+
+  SendDiscovery("{\"App\":\"ForeFlight\",\"GDL90\":{\"port\":4003}}");
+  for (int i = 0; i < 200 && listener.snapshot().sequence == 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  listener.stop();
+  ASSERT_TRUE(!listener.isRunning());
+  ASSERT_EQ(static_cast<uint64_t>(1), listener.snapshot().sequence);
+  ASSERT_EQ(static_cast<uint16_t>(4003), listener.snapshot().target.port);
+}
+#endif
+
+namespace {
+
+udp::SourceAddress Device(uint32_t host, uint16_t port = 4000) {
+  udp::SourceAddress address;
+  address.ipv4 = 0x0A000000u | host;
+  address.port = port;
+  return address;
+}
+
+} // namespace
+
+TEST_CASE("Device table keeps live devices in arrival order") {
+  xp2gdl90::foreflight::DeviceTable table;
+  ASSERT_TRUE(table.empty());
+  const uint64_t empty_generation = table.generation();
+
+  ASSERT_TRUE(table.see(Device(1), 0.0));
+  ASSERT_TRUE(table.see(Device(2), 1.0));
+  // The same host on another port is another client.
+  ASSERT_TRUE(table.see(Device(2, 4002), 1.5));
+  const uint64_t joined = table.generation();
+  ASSERT_TRUE(joined != empty_generation);
+
+  // Repeat broadcasts refresh the timestamp without changing membership.
+  ASSERT_TRUE(!table.see(Device(1), 10.0));
+  ASSERT_EQ(joined, table.generation());
+  ASSERT_EQ(static_cast<size_t>(3), table.size());
+  ASSERT_TRUE(table[0].address == Device(1));
+  ASSERT_EQ(10.0, table[0].last_seen);
+
+  // Device 2 on port 4000 goes quiet; the others stay in order.
+  ASSERT_EQ(static_cast<size_t>(0), table.expire(15.0, 15.0));
+  ASSERT_TRUE(!table.see(Device(2, 4002), 12.0));
+  ASSERT_EQ(static_cast<size_t>(1), table.expire(16.5, 15.0));
+  ASSERT_EQ(static_cast<size_t>(2), table.size());
+  ASSERT_TRUE(table[0].address == Device(1));
+  ASSERT_TRUE(table[1].address == Device(2, 4002));
+  ASSERT_TRUE(table.generation() != joined);
+
+  table.clear();
+  ASSERT_TRUE(table.empty());
+  const uint64_t cleared = table.generation();
+  table.clear();
+  ASSERT_EQ(cleared, table.generation());
+}
+
+TEST_CASE("Full device table replaces the device heard from longest ago") {
+  xp2gdl90::foreflight::DeviceTable table;
+  for (uint32_t i = 0; i < xp2gdl90::foreflight::DISCOVERY_MAX_DEVICES; ++i) {
+    ASSERT_TRUE(table.see(Device(i), static_cast<double>(i)));
+  }
+  ASSERT_TRUE(!table.see(Device(0), 20.0));
+  ASSERT_TRUE(table.see(Device(100), 21.0));
+  ASSERT_EQ(xp2gdl90::foreflight::DISCOVERY_MAX_DEVICES, table.size());
+  // Device 1 was the stalest; device 0 keeps its place as the primary.
+  ASSERT_TRUE(table[0].address == Device(0));
+  ASSERT_TRUE(table[1].address == Device(2));
+  ASSERT_TRUE(table[table.size() - 1].address == Device(100));
+}
@@ -113,3 +113,24 @@ TEST_CASE("ForeFlight AHRS heading normalizes wraparound and invalid heading") {
   ASSERT_EQ(static_cast<uint16_t>(gdl90::foreflight::AHRS_HEADING_INVALID),
             xp2gdl90::test::Decode16BE(invalid_payload, 6));
 }
+
+TEST_CASE("ForeFlight encode-into API matches vector-returning wrappers") {
+  gdl90::foreflight::ForeFlightEncoder encoder;
+  gdl90::foreflight::DeviceInfo info{};
+  info.serial_number = 0x7E7D7E7D7E7D7E7Dull;
+  info.device_name = "XP2GDL90";
+  info.device_long_name = "XP2GDL90 AHRS LONG NAME";
+  gdl90::foreflight::AhrsData ahrs{};
+  ahrs.roll_deg = 1.5;
+  ahrs.pitch_deg = -2.0;
+  ahrs.heading_deg = 90.0;
+
+  gdl90::FrameBuffer frame;
+  ASSERT_EQ(encoder.createIdMessage(info).size(),
+            encoder.encodeIdMessageInto(info, frame));
+  ASSERT_TRUE(encoder.createIdMessage(info) == frame.toVector());
+
+  ASSERT_EQ(encoder.createAhrsMessage(ahrs).size(),
+            encoder.encodeAhrsMessageInto(ahrs, frame));
+  ASSERT_TRUE(encoder.createAhrsMessage(ahrs) == frame.toVector());
+}
@@ -1,6 +1,7 @@
 #include "test_harness.h"
 
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include "xp2gdl90/foreflight_protocol.h"
@@ -56,3 +57,14 @@ TEST_CASE(
       '"', ':', '{', '"', 'p', 'o', 'r', 't', '"', ':', '0', '}', '}'};
   ASSERT_TRUE(!xp2gdl90::foreflight::ParseDiscoveryBroadcast(bad_port, &port));
 }
+
+TEST_CASE("ForeFlight discovery parser accepts raw receive buffers") {
+  const std::string packet =
+      "{\"App\":\"ForeFlight\",\"GDL90\":{\"port\":4001}}";
+  uint16_t port = 0;
+  ASSERT_TRUE(xp2gdl90::foreflight::ParseDiscoveryBroadcast(
+      reinterpret_cast<const uint8_t *>(packet.data()), packet.size(), &port));
+  ASSERT_EQ(static_cast<uint16_t>(4001), port);
+  ASSERT_TRUE(
+      !xp2gdl90::foreflight::ParseDiscoveryBroadcast(nullptr, 4, &port));
+}
@@ -0,0 +1,148 @@
+#include "test_harness.h"
+
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "fake_socket_ops.h"
+#include "xp2gdl90/broadcast_engine.h"
+#include "xp2gdl90/frame_pool.h"
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/network_sender.h"
+#include "xp2gdl90/spsc_ring.h"
+
+using xp2gdl90::test::FakeSocketOps;
+
+TEST_CASE("Frame pool shares blocks and recycles the last reference") {
+  gdl90::FramePool pool(2);
+  ASSERT_EQ(static_cast<size_t>(2), pool.capacity());
+
+  gdl90::FrameRef first = pool.acquire();
+  ASSERT_TRUE(static_cast<bool>(first));
+  ASSERT_EQ(static_cast<uint32_t>(1), first.useCount());
+  const gdl90::GDL90Encoder encoder;
+  const size_t size = encoder.encodeHeartbeatInto(true, true, *first.buffer());
+  ASSERT_EQ(size, first.size());
+
+  // Copies see the same bytes and keep the block out of the pool.
+  gdl90::FrameRef shared = first;
+  ASSERT_EQ(static_cast<uint32_t>(2), first.useCount());
+  ASSERT_TRUE(shared.data() == first.data());
+  gdl90::FrameRef second = pool.acquire();
+  ASSERT_TRUE(!pool.acquire());
+  ASSERT_EQ(static_cast<size_t>(0), pool.available());
+  first.reset();
+  ASSERT_EQ(static_cast<size_t>(0), pool.available());
+  ASSERT_EQ(size, shared.size());
+
+  gdl90::FrameRef moved = std::move(shared);
+  ASSERT_TRUE(!shared);
+  moved = second;
+  ASSERT_EQ(static_cast<size_t>(1), pool.available());
+  ASSERT_EQ(static_cast<uint32_t>(2), second.useCount());
+
+  // A recycled block comes back cleared.
+  gdl90::FrameRef reused = pool.acquire();
+  ASSERT_TRUE(static_cast<bool>(reused));
+  ASSERT_EQ(static_cast<size_t>(0), reused.size());
+
+  const gdl90::FramePoolStats stats = pool.stats();
+  ASSERT_EQ(static_cast<uint64_t>(3), stats.acquired);
+  ASSERT_EQ(static_cast<uint64_t>(1), stats.exhausted);
+  ASSERT_EQ(static_cast<size_t>(0), stats.available);
+}
+
+TEST_CASE("Frame pool hands blocks across threads without losing any") {
+  gdl90::FramePool pool(16);
+  udp::SpscRing<gdl90::FrameRef> queue(8);
+  constexpr uint32_t kFrames = 20000;
+  bool in_order = true;
+
+  std::thread consumer([&] {
+    uint32_t expected = 0;
+    while (expected < kFrames) {
+      if (queue.readable() == 0) {
+        std::this_thread::yield();
+        continue;
+      }
+      gdl90::FrameRef &frame = queue.peek(0);
+      const uint8_t *bytes = frame.data();
+      const uint32_t value = static_cast<uint32_t>(bytes[0]) |
+                             (static_cast<uint32_t>(bytes[1]) << 8) |
+                             (static_cast<uint32_t>(bytes[2]) << 16);
+      in_order = in_order && value == expected && frame.size() == 3;
+      frame.reset();
+      queue.release(1);
+      ++expected;
+    }
+  });
+
+  // The producer keeps a copy of the last frame, so blocks are released
+  // from both threads.
+  gdl90::FrameRef last;
+  for (uint32_t i = 0; i < kFrames; ++i) {
+    gdl90::FrameRef frame = pool.acquire();
+    while (!frame) {
+      std::this_thread::yield();
+      frame = pool.acquire();
+    }
+    uint8_t *bytes = frame.buffer()->data();
+    bytes[0] = static_cast<uint8_t>(i);
+    bytes[1] = static_cast<uint8_t>(i >> 8);
+    bytes[2] = static_cast<uint8_t>(i >> 16);
+    frame.buffer()->resize(3);
+    last = frame;
+    gdl90::FrameRef *slot = queue.producerSlot();
+    while (!slot) {
+      std::this_thread::yield();
+      slot = queue.producerSlot();
+    }
+    *slot = std::move(frame);
+    queue.publish();
+  }
+  consumer.join();
+  ASSERT_TRUE(in_order);
+  last.reset();
+  ASSERT_EQ(pool.capacity(), pool.available());
+  ASSERT_EQ(static_cast<uint64_t>(kFrames), pool.stats().acquired);
+}
+
+TEST_CASE("Pooled frames reach the sender thread by reference") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  const gdl90::GDL90Encoder encoder;
+
+  // The sender's slot holds the block until the frame is on the wire.
+  gdl90::FramePool pool(4);
+  udp::NetworkSender sender(broadcaster);
+  gdl90::FrameRef frame = pool.acquire();
+  const size_t size = encoder.encodeHeartbeatInto(true, true, *frame.buffer());
+  ASSERT_TRUE(sender.enqueue(frame, udp::ALL_DESTINATIONS, true));
+  ASSERT_TRUE(!sender.enqueue(gdl90::FrameRef(), udp::ALL_DESTINATIONS));
+  ASSERT_EQ(static_cast<uint32_t>(2), frame.useCount());
+  frame.reset();
+  ASSERT_EQ(static_cast<size_t>(3), pool.available());
+  ASSERT_EQ(static_cast<size_t>(1), sender.drain());
+  ASSERT_EQ(static_cast<size_t>(4), pool.available());
+  ASSERT_EQ(size, ops.sent_datagrams.back().size());
+  ASSERT_EQ(static_cast<uint64_t>(1), sender.stats().priority_overflows);
+
+  xp2gdl90::BroadcastEngine engine;
+  engine.attach(&broadcaster);
+  gdl90::FrameRef heartbeat = engine.acquireFrame();
+  encoder.encodeHeartbeatInto(true, true, *heartbeat.buffer());
+  ASSERT_EQ(static_cast<int>(size),
+            engine.sendMessage(heartbeat, xp2gdl90::MESSAGE_HEARTBEAT));
+  ASSERT_TRUE(ops.sent_datagrams.back() ==
+              std::vector<uint8_t>(heartbeat.data(),
+                                   heartbeat.data() + heartbeat.size()));
+  ASSERT_EQ(-1, engine.sendMessage(gdl90::FrameRef(),
+                                   xp2gdl90::MESSAGE_HEARTBEAT));
+  ASSERT_EQ(std::string("Frame pool exhausted"), engine.lastError());
+  heartbeat.reset();
+  ASSERT_EQ(engine.framePool().capacity(), engine.framePool().available());
+}
@@ -0,0 +1,171 @@
+#include "test_harness.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "xp2gdl90/foreflight_encoder.h"
+#include "xp2gdl90/gdl90_decoder.h"
+#include "xp2gdl90/gdl90_encoder.h"
+
+namespace {
+
+void Append(std::vector<uint8_t> *stream, const std::vector<uint8_t> &frame) {
+  stream->insert(stream->end(), frame.begin(), frame.end());
+}
+
+bool InBuffer(const std::vector<uint8_t> &buffer, const uint8_t *data) {
+  return data >= buffer.data() && data < buffer.data() + buffer.size();
+}
+
+} // namespace
+
+TEST_CASE("Decoder round-trips every emitted message type") {
+  gdl90::GDL90Encoder encoder([]() { return 0x1ABCDu; });
+  gdl90::foreflight::ForeFlightEncoder foreflight;
+
+  gdl90::PositionData traffic;
+  traffic.latitude = 47.4502;
+  traffic.longitude = -122.3088;
+  traffic.altitude = 12500;
+  traffic.h_velocity = 250;
+  traffic.v_velocity = -640;
+  traffic.track = 271;
+  traffic.track_type = gdl90::TrackType::TRUE_TRACK;
+  traffic.airborne = true;
+  traffic.nic = 8;
+  traffic.nacp = 9;
+  traffic.icao_address = 0xA1B2C3;
+  traffic.callsign = "N123AB";
+  traffic.emitter_category = gdl90::EmitterCategory::LARGE;
+  traffic.alert_status = 1;
+  gdl90::PositionData ownship = traffic;
+  ownship.altitude = std::numeric_limits<int32_t>::min();
+  ownship.v_velocity = std::numeric_limits<int16_t>::min();
+
+  gdl90::GeoAltitudeData geo;
+  geo.altitude_feet = -125;
+  geo.vertical_warning = true;
+  geo.vfom_meters = 12;
+
+  gdl90::foreflight::AhrsData ahrs;
+  ahrs.roll_deg = -12.5;
+  ahrs.heading_deg = 359.9;
+  ahrs.magnetic_heading = true;
+  ahrs.indicated_airspeed = 140;
+
+  std::vector<uint8_t> stream;
+  Append(&stream, encoder.createHeartbeat(true, true));
+  Append(&stream, encoder.createOwnshipReport(ownship));
+  Append(&stream, encoder.createOwnshipGeometricAltitude(geo));
+  Append(&stream, encoder.createTrafficReport(traffic));
+  Append(&stream, foreflight.createAhrsMessage(ahrs));
+
+  gdl90::Decoder decoder(stream.data(), stream.size());
+  gdl90::FrameSpan frame;
+
+  ASSERT_TRUE(decoder.next(&frame));
+  gdl90::HeartbeatData heartbeat;
+  ASSERT_TRUE(gdl90::DecodeHeartbeat(frame, &heartbeat));
+  ASSERT_TRUE(heartbeat.gps_valid);
+  ASSERT_TRUE(heartbeat.utc_ok);
+  ASSERT_EQ(0x1ABCDu, heartbeat.timestamp);
+  ASSERT_TRUE(!gdl90::DecodeGeoAltitude(frame, &geo));
+
+  gdl90::PositionData decoded;
+  ASSERT_TRUE(decoder.next(&frame));
+  ASSERT_EQ(gdl90::MSG_ID_OWNSHIP_REPORT, frame.messageId());
+  ASSERT_TRUE(gdl90::DecodePositionReport(frame, &decoded));
+  ASSERT_EQ(std::numeric_limits<int32_t>::min(), decoded.altitude);
+  ASSERT_EQ(std::numeric_limits<int16_t>::min(), decoded.v_velocity);
+
+  gdl90::GeoAltitudeData decoded_geo;
+  ASSERT_TRUE(decoder.next(&frame));
+  ASSERT_TRUE(gdl90::DecodeGeoAltitude(frame, &decoded_geo));
+  ASSERT_EQ(-125, decoded_geo.altitude_feet);
+  ASSERT_TRUE(decoded_geo.vertical_warning);
+  ASSERT_EQ(static_cast<uint16_t>(12), decoded_geo.vfom_meters);
+
+  ASSERT_TRUE(decoder.next(&frame));
+  ASSERT_TRUE(gdl90::DecodePositionReport(frame, &decoded));
+  ASSERT_TRUE(std::fabs(decoded.latitude - traffic.latitude) < 1e-4);
+  ASSERT_TRUE(std::fabs(decoded.longitude - traffic.longitude) < 1e-4);
+  ASSERT_EQ(12500, decoded.altitude);
+  ASSERT_EQ(static_cast<int16_t>(-640), decoded.v_velocity);
+  ASSERT_EQ(std::string("N123AB"), decoded.callsign.str());
+  ASSERT_EQ(0xA1B2C3u, decoded.icao_address);
+  ASSERT_TRUE(decoded.airborne);
+  // Re-encoding the decoded report reproduces the frame.
+  ASSERT_TRUE(encoder.createTrafficReport(decoded) ==
+              encoder.createTrafficReport(traffic));
+
+  gdl90::foreflight::AhrsData decoded_ahrs;
+  ASSERT_TRUE(decoder.next(&frame));
+  ASSERT_TRUE(gdl90::DecodeAhrs(frame, &decoded_ahrs));
+  ASSERT_TRUE(std::fabs(decoded_ahrs.roll_deg + 12.5) < 1e-9);
+  ASSERT_TRUE(std::isnan(decoded_ahrs.pitch_deg));
+  ASSERT_TRUE(std::fabs(decoded_ahrs.heading_deg - 359.9) < 1e-9);
+  ASSERT_TRUE(decoded_ahrs.magnetic_heading);
+  ASSERT_EQ(static_cast<uint16_t>(140), decoded_ahrs.indicated_airspeed);
+
+  ASSERT_TRUE(!decoder.next(&frame));
+  ASSERT_EQ(static_cast<uint64_t>(5), decoder.frames());
+  ASSERT_EQ(static_cast<uint64_t>(0), decoder.crcErrors());
+}
+
+TEST_CASE("Decoder copies only stuffed frames") {
+  gdl90::GDL90Encoder encoder;
+  gdl90::PositionData clean;
+  clean.icao_address = 0x123456;
+  gdl90::PositionData stuffed = clean;
+  stuffed.icao_address = 0x7E7D7E;
+
+  std::vector<uint8_t> stream;
+  Append(&stream, encoder.createTrafficReport(clean));
+  Append(&stream, encoder.createTrafficReport(stuffed));
+
+  gdl90::Decoder decoder(stream.data(), stream.size());
+  gdl90::FrameSpan frame;
+  gdl90::PositionData decoded;
+  ASSERT_TRUE(decoder.next(&frame));
+  ASSERT_TRUE(InBuffer(stream, frame.data));
+  ASSERT_TRUE(decoder.next(&frame));
+  ASSERT_TRUE(!InBuffer(stream, frame.data));
+  ASSERT_TRUE(gdl90::DecodePositionReport(frame, &decoded));
+  ASSERT_EQ(0x7E7D7Eu, decoded.icao_address);
+}
+
+TEST_CASE("Decoder skips damaged frames and resynchronises") {
+  gdl90::GDL90Encoder encoder;
+  const std::vector<uint8_t> heartbeat = encoder.createHeartbeat(true, false);
+
+  std::vector<uint8_t> stream = {0x11, 0x22}; // Noise before the first flag.
+  std::vector<uint8_t> corrupt = heartbeat;
+  corrupt[2] ^= 0x01;
+  Append(&stream, corrupt);
+  Append(&stream, {0x7E, 0x00, 0x7D, 0x7E}); // Dangling escape.
+  // Two frames sharing one flag.
+  Append(&stream, heartbeat);
+  stream.pop_back();
+  Append(&stream, heartbeat);
+  // Truncated: no closing flag.
+  Append(&stream, heartbeat);
+  stream.pop_back();
+
+  gdl90::Decoder decoder(stream.data(), stream.size());
+  gdl90::FrameSpan frame;
+  size_t decoded = 0;
+  while (decoder.next(&frame)) {
+    gdl90::HeartbeatData data;
+    ASSERT_TRUE(gdl90::DecodeHeartbeat(frame, &data));
+    ++decoded;
+  }
+  ASSERT_EQ(static_cast<size_t>(2), decoded);
+  ASSERT_EQ(static_cast<uint64_t>(1), decoder.crcErrors());
+  ASSERT_TRUE(decoder.malformed() >= 1);
+
+  decoder.reset(heartbeat.data(), heartbeat.size());
+  ASSERT_TRUE(decoder.next(&frame));
+  ASSERT_EQ(static_cast<uint64_t>(3), decoder.frames());
+}
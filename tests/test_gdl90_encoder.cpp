@@ -5,7 +5,9 @@
 #include <vector>
 
 #include "frame_test_utils.h"
+#include "xp2gdl90/cached_frame.h"
 #include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/utc_clock.h"
 
 namespace {
 
@@ -59,6 +61,18 @@ uint8_t EncodeTrack(uint16_t track) {
   return static_cast<uint8_t>((track % 360) * 256 / 360);
 }
 
+struct FixedUtcTime {
+  uint32_t seconds = 0;
+  bool valid = true;
+  int calls = 0;
+
+  bool operator()(uint32_t *out_time) {
+    ++calls;
+    *out_time = seconds;
+    return valid;
+  }
+};
+
 } // namespace
 
 TEST_CASE("Heartbeat encoding sets flags and CRC") {
@@ -127,6 +141,50 @@ TEST_CASE(
   ASSERT_TRUE(!checked_provider(nullptr));
 }
 
+TEST_CASE("Timed encoder heartbeats match the std::function provider") {
+  gdl90::TimedGDL90Encoder<FixedUtcTime> timed(FixedUtcTime{0x1ABCDu});
+  gdl90::GDL90Encoder checked([](uint32_t *out_time) {
+    *out_time = 0x1ABCDu;
+    return true;
+  });
+  ASSERT_TRUE(timed.createHeartbeat(true, true) ==
+              checked.createHeartbeat(true, true));
+
+  gdl90::CachedFrame cache;
+  timed.encodeHeartbeatInto(false, true, cache);
+  ASSERT_TRUE(cache.frame().toVector() == checked.createHeartbeat(false, true));
+  ASSERT_EQ(2, timed.timeSource().calls);
+
+  timed.timeSource().valid = false;
+  const auto payload =
+      xp2gdl90::test::ExtractPayload(timed.createHeartbeat(true, true));
+  ASSERT_EQ(static_cast<uint8_t>(0x00), payload[2] & 0x01);
+
+  const uint32_t time = 100;
+  gdl90::FrameBuffer frame;
+  checked.encodeHeartbeatAt(true, true, &time, frame);
+  ASSERT_TRUE(frame.toVector() == gdl90::TimedGDL90Encoder<FixedUtcTime>(
+                                      FixedUtcTime{100})
+                                      .createHeartbeat(true, true));
+}
+
+TEST_CASE("Steady UTC clock counts from its last sync and wraps at midnight") {
+  constexpr int64_t kSecond = 1000000000;
+  gdl90::SteadyUtcClock clock;
+  ASSERT_TRUE(!clock.synced());
+  // 23:59:58.5 on some day, at steady time 5 s.
+  clock.sync(5 * kSecond, (20000 * 86400 + 86398) * kSecond + kSecond / 2);
+  ASSERT_TRUE(clock.synced());
+  ASSERT_EQ(static_cast<uint32_t>(86398), clock.at(5 * kSecond));
+  ASSERT_EQ(static_cast<uint32_t>(86399), clock.at(5 * kSecond + kSecond / 2));
+  ASSERT_EQ(static_cast<uint32_t>(0), clock.at(7 * kSecond));
+
+  uint32_t now = 0;
+  ASSERT_TRUE(clock(&now));
+  ASSERT_TRUE(now < 86400u);
+  ASSERT_TRUE(!clock(nullptr));
+}
+
 TEST_CASE("Ownship report encodes fields and clamps values") {
   gdl90::GDL90Encoder encoder;
   gdl90::PositionData data{};
@@ -362,3 +420,122 @@ TEST_CASE("Traffic report escapes special bytes") {
   ASSERT_EQ(static_cast<uint8_t>((altitude >> 4) & 0xFF), payload[11]);
   ASSERT_EQ(EncodeTrack(180), payload[17]);
 }
+
+TEST_CASE("Encode-into API matches vector-returning wrappers") {
+  gdl90::GDL90Encoder encoder([]() { return 0x1ABCDu; });
+  gdl90::PositionData data{};
+  data.latitude = 37.5;
+  data.longitude = -122.25;
+  data.altitude = 4500;
+  data.h_velocity = 140;
+  data.v_velocity = 640;
+  data.track = 275;
+  data.track_type = gdl90::TrackType::TRUE_TRACK;
+  data.airborne = true;
+  data.icao_address = 0x7E7D7E;
+  data.callsign = "N7E7D";
+  gdl90::GeoAltitudeData geo{};
+  geo.altitude_feet = 4600;
+  geo.vfom_meters = 10;
+
+  gdl90::FrameBuffer frame;
+  ASSERT_EQ(encoder.createHeartbeat(true, true).size(),
+            encoder.encodeHeartbeatInto(true, true, frame));
+  ASSERT_TRUE(encoder.createHeartbeat(true, true) == frame.toVector());
+
+  ASSERT_EQ(encoder.createOwnshipReport(data).size(),
+            encoder.encodeOwnshipReportInto(data, frame));
+  ASSERT_TRUE(encoder.createOwnshipReport(data) == frame.toVector());
+
+  ASSERT_EQ(encoder.createOwnshipGeometricAltitude(geo).size(),
+            encoder.encodeOwnshipGeometricAltitudeInto(geo, frame));
+  ASSERT_TRUE(encoder.createOwnshipGeometricAltitude(geo) ==
+              frame.toVector());
+
+  ASSERT_EQ(encoder.createTrafficReport(data).size(),
+            encoder.encodeTrafficReportInto(data, frame));
+  ASSERT_TRUE(encoder.createTrafficReport(data) == frame.toVector());
+  ASSERT_EQ(static_cast<uint8_t>(gdl90::MSG_ID_TRAFFIC_REPORT),
+            xp2gdl90::test::ExtractPayload(frame.toVector())[0]);
+}
+
+TEST_CASE("Encode-into API overwrites a reused frame buffer") {
+  gdl90::GDL90Encoder encoder([]() { return 0u; });
+  gdl90::PositionData data{};
+  data.icao_address = 0x7E7E7E;
+  data.callsign = std::string(8, '\x7D');
+
+  gdl90::FrameBuffer frame;
+  const size_t traffic_size = encoder.encodeTrafficReportInto(data, frame);
+  ASSERT_TRUE(traffic_size <= gdl90::FrameBuffer::capacity());
+
+  const size_t heartbeat_size = encoder.encodeHeartbeatInto(false, true, frame);
+  ASSERT_TRUE(heartbeat_size < traffic_size);
+  ASSERT_EQ(heartbeat_size, frame.size());
+  ASSERT_EQ(static_cast<size_t>(7),
+            xp2gdl90::test::ExtractPayload(frame.toVector()).size());
+}
+
+TEST_CASE("Fully escaped traffic report stays within worst-case frame size") {
+  gdl90::GDL90Encoder encoder([]() { return 0u; });
+  gdl90::PositionData data{};
+  data.icao_address = 0x7E7D7E;
+  data.callsign = std::string(8, '\x7E');
+
+  gdl90::FrameBuffer frame;
+  const size_t size = encoder.encodeTrafficReportInto(data, frame);
+  ASSERT_TRUE(size <= gdl90::MaxFrameSize(28));
+  ASSERT_TRUE(size >= static_cast<size_t>(28 + 4 + 11));
+  ASSERT_EQ(static_cast<uint8_t>(0x7E), frame.data()[0]);
+  ASSERT_EQ(static_cast<uint8_t>(0x7E), frame.data()[size - 1]);
+
+  const auto payload = xp2gdl90::test::ExtractPayload(frame.toVector());
+  ASSERT_EQ(static_cast<size_t>(28), payload.size());
+  ASSERT_EQ(static_cast<uint32_t>(0x7E7D7E),
+            xp2gdl90::test::Decode24(payload, 2));
+}
+
+TEST_CASE("Traffic batch writes frames back to back with an offset table") {
+  gdl90::GDL90Encoder encoder([]() { return 0u; });
+  std::vector<gdl90::PositionData> reports(3);
+  for (size_t i = 0; i < reports.size(); ++i) {
+    reports[i].icao_address = 0x7E0000u + static_cast<uint32_t>(i);
+    reports[i].latitude = 10.0 + static_cast<double>(i);
+    reports[i].callsign = "TFC" + std::to_string(i);
+  }
+
+  gdl90::FrameArena arena;
+  ASSERT_EQ(reports.size(),
+            encoder.encodeTrafficBatch(reports.data(), reports.size(), arena));
+  ASSERT_EQ(reports.size(), arena.frameCount());
+
+  size_t expected_offset = 0;
+  for (size_t i = 0; i < reports.size(); ++i) {
+    const gdl90::FrameSlice &slice = arena.frames()[i];
+    ASSERT_EQ(expected_offset, slice.offset);
+    const std::vector<uint8_t> frame(arena.frameData(i),
+                                     arena.frameData(i) + arena.frameSize(i));
+    ASSERT_TRUE(encoder.createTrafficReport(reports[i]) == frame);
+    expected_offset += slice.size;
+  }
+  ASSERT_EQ(expected_offset, arena.size());
+}
+
+TEST_CASE("Traffic batch clears the arena between calls") {
+  gdl90::GDL90Encoder encoder([]() { return 0u; });
+  std::vector<gdl90::PositionData> reports(4);
+
+  gdl90::FrameArena arena;
+  encoder.encodeTrafficBatch(reports.data(), reports.size(), arena);
+  const uint8_t *storage = arena.data();
+
+  ASSERT_EQ(static_cast<size_t>(2),
+            encoder.encodeTrafficBatch(reports.data(), 2, arena));
+  ASSERT_EQ(static_cast<size_t>(2), arena.frameCount());
+  ASSERT_TRUE(storage == arena.data());
+
+  ASSERT_EQ(static_cast<size_t>(0),
+            encoder.encodeTrafficBatch(nullptr, 5, arena));
+  ASSERT_TRUE(arena.empty());
+  ASSERT_EQ(static_cast<size_t>(0), arena.size());
+}
@@ -0,0 +1,146 @@
+#include "test_harness.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/gdl90_field_kernels.h"
+
+namespace {
+
+// Fixed LCG so failures reproduce.
+uint32_t NextRandom(uint32_t *state) {
+  *state = *state * 1664525u + 1013904223u;
+  return *state;
+}
+
+std::vector<double> DegreeSamples() {
+  std::vector<double> values = {0.0,
+                                -0.0,
+                                1e-9,
+                                -1e-9,
+                                90.0,
+                                -90.0,
+                                90.0000001,
+                                -90.0000001,
+                                180.0,
+                                -180.0,
+                                181.0,
+                                -181.0,
+                                1e300,
+                                -1e300,
+                                std::numeric_limits<double>::infinity(),
+                                -std::numeric_limits<double>::infinity(),
+                                std::numeric_limits<double>::quiet_NaN(),
+                                180.0 / 0x800000,
+                                -180.0 / 0x800000};
+  uint32_t state = 42;
+  for (size_t i = 0; i < 1000; ++i) {
+    values.push_back(
+        (static_cast<double>(NextRandom(&state)) / 0xFFFFFFFFu) * 400.0 -
+        200.0);
+  }
+  return values;
+}
+
+} // namespace
+
+TEST_CASE("Coordinate kernels match the scalar encoding") {
+  const std::vector<double> degrees = DegreeSamples();
+  // Every length up to a few vectors, so the scalar tails are covered.
+  for (size_t count = 0; count <= degrees.size();
+       count += (count < 17 ? 1 : 97)) {
+    std::vector<uint32_t> fast(count), scalar(count);
+    gdl90::EncodeLatitudes(degrees.data(), count, fast.data());
+    gdl90::EncodeLatitudesScalar(degrees.data(), count, scalar.data());
+    ASSERT_TRUE(fast == scalar);
+    gdl90::EncodeLongitudes(degrees.data(), count, fast.data());
+    gdl90::EncodeLongitudesScalar(degrees.data(), count, scalar.data());
+    ASSERT_TRUE(fast == scalar);
+  }
+
+  std::vector<uint32_t> out(degrees.size());
+  gdl90::EncodeLatitudes(degrees.data(), degrees.size(), out.data());
+  ASSERT_EQ(static_cast<uint32_t>(0x400000), out[4]);
+  ASSERT_EQ(static_cast<uint32_t>(0xC00000), out[5]);
+  ASSERT_EQ(static_cast<uint32_t>(0x400000), out[16]); // NaN
+  gdl90::EncodeLongitudes(degrees.data(), degrees.size(), out.data());
+  ASSERT_EQ(static_cast<uint32_t>(0x800000), out[8]);
+  ASSERT_EQ(static_cast<uint32_t>(1), out[17]);
+  ASSERT_EQ(static_cast<uint32_t>(0xFFFFFF), out[18]);
+}
+
+TEST_CASE("Altitude, vertical velocity and track kernels are exact") {
+  std::vector<int32_t> feet = {std::numeric_limits<int32_t>::min(),
+                               std::numeric_limits<int32_t>::min() + 1,
+                               std::numeric_limits<int32_t>::max(),
+                               -1025,
+                               -1024,
+                               -1001,
+                               -1000,
+                               -976,
+                               -975,
+                               101350,
+                               101351,
+                               101374,
+                               101375};
+  for (int32_t value = -1100; value <= 103000; value += 7) {
+    feet.push_back(value);
+  }
+  std::vector<uint16_t> fast(feet.size()), scalar(feet.size());
+  gdl90::EncodeAltitudes(feet.data(), feet.size(), fast.data());
+  gdl90::EncodeAltitudesScalar(feet.data(), feet.size(), scalar.data());
+  ASSERT_TRUE(fast == scalar);
+  ASSERT_EQ(gdl90::ALTITUDE_INVALID, fast[0]);
+
+  // Both 16-bit inputs are small enough to check exhaustively.
+  std::vector<int16_t> fpm;
+  std::vector<uint16_t> track;
+  for (int32_t value = 0; value <= 0xFFFF; ++value) {
+    fpm.push_back(static_cast<int16_t>(value));
+    track.push_back(static_cast<uint16_t>(value));
+  }
+  std::vector<uint16_t> vv_fast(fpm.size()), vv_scalar(fpm.size());
+  gdl90::EncodeVerticalVelocities(fpm.data(), fpm.size(), vv_fast.data());
+  gdl90::EncodeVerticalVelocitiesScalar(fpm.data(), fpm.size(),
+                                        vv_scalar.data());
+  ASSERT_TRUE(vv_fast == vv_scalar);
+
+  std::vector<uint8_t> track_fast(track.size()), track_scalar(track.size());
+  gdl90::EncodeTracks(track.data(), track.size(), track_fast.data());
+  gdl90::EncodeTracksScalar(track.data(), track.size(), track_scalar.data());
+  ASSERT_TRUE(track_fast == track_scalar);
+  ASSERT_EQ(255, static_cast<int>(track_fast[359]));
+  ASSERT_EQ(0, static_cast<int>(track_fast[360]));
+}
+
+TEST_CASE("Batched traffic reports match single-report encoding") {
+  gdl90::GDL90Encoder encoder;
+  std::vector<gdl90::PositionData> reports(70);
+  uint32_t state = 7;
+  for (size_t i = 0; i < reports.size(); ++i) {
+    gdl90::PositionData &report = reports[i];
+    report.icao_address = static_cast<uint32_t>(0xA00000 + i);
+    report.latitude = static_cast<double>(NextRandom(&state) % 180000) / 1000 -
+                      90.0;
+    report.longitude =
+        static_cast<double>(NextRandom(&state) % 360000) / 1000 - 180.0;
+    report.altitude = static_cast<int32_t>(NextRandom(&state) % 60000) - 2000;
+    report.v_velocity = static_cast<int16_t>(NextRandom(&state));
+    report.track = static_cast<uint16_t>(NextRandom(&state));
+    report.callsign = "TEST";
+  }
+  reports[3].altitude = std::numeric_limits<int32_t>::min();
+  reports[5].v_velocity = std::numeric_limits<int16_t>::min();
+
+  gdl90::FrameArena arena;
+  ASSERT_EQ(reports.size(),
+            encoder.encodeTrafficBatch(reports.data(), reports.size(), arena));
+  for (size_t i = 0; i < reports.size(); ++i) {
+    const std::vector<uint8_t> batched(
+        arena.frameData(i), arena.frameData(i) + arena.frameSize(i));
+    ASSERT_TRUE(batched == encoder.createTrafficReport(reports[i]));
+  }
+}
@@ -0,0 +1,70 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "frame_test_utils.h"
+#include "xp2gdl90/gdl90_framing.h"
+
+namespace {
+
+std::vector<uint8_t> PayloadWithSpecials(size_t size, size_t stride,
+                                         uint8_t seed) {
+  std::vector<uint8_t> payload(size);
+  uint8_t value = seed;
+  for (size_t i = 0; i < size; ++i) {
+    value = static_cast<uint8_t>(value * 13 + 7);
+    payload[i] = static_cast<uint8_t>(value & 0x3F);
+    if (stride != 0 && i % stride == stride - 1) {
+      payload[i] = (i / stride) % 2 == 0 ? 0x7E : 0x7D;
+    }
+  }
+  return payload;
+}
+
+} // namespace
+
+TEST_CASE("Escape scan matches scalar reference at every position") {
+  for (size_t size = 0; size <= 40; ++size) {
+    for (size_t hit = 0; hit <= size; ++hit) {
+      std::vector<uint8_t> data(size, 0x20);
+      if (hit < size) {
+        data[hit] = (hit % 2 == 0) ? 0x7E : 0x7D;
+      }
+      ASSERT_EQ(gdl90::FindEscapeByteScalar(data.data(), data.size()),
+                gdl90::FindEscapeByte(data.data(), data.size()));
+      ASSERT_EQ(hit, gdl90::FindEscapeByte(data.data(), data.size()));
+    }
+  }
+}
+
+TEST_CASE("Escape scan ignores neighbouring byte values") {
+  std::vector<uint8_t> data = {0x7C, 0x7F, 0x5D, 0x5E, 0xFD, 0xFE, 0x3E, 0x3D,
+                               0x7C, 0x7F, 0x5D, 0x5E, 0xFD, 0xFE, 0x3E, 0x3D,
+                               0x00, 0xFF, 0x7D};
+  ASSERT_EQ(static_cast<size_t>(18),
+            gdl90::FindEscapeByte(data.data(), data.size()));
+}
+
+TEST_CASE("Vectorized framing matches scalar reference") {
+  const size_t strides[] = {0, 1, 3, 16, 17};
+  for (const size_t stride : strides) {
+    for (size_t size = 0; size <= 64; ++size) {
+      const auto payload =
+          PayloadWithSpecials(size, stride, static_cast<uint8_t>(size));
+      std::vector<uint8_t> fast(gdl90::MaxFrameSize(size), 0);
+      std::vector<uint8_t> scalar(gdl90::MaxFrameSize(size), 0);
+
+      const size_t fast_size =
+          gdl90::FrameMessage(payload.data(), payload.size(), fast.data());
+      const size_t scalar_size = gdl90::FrameMessageScalar(
+          payload.data(), payload.size(), scalar.data());
+      ASSERT_EQ(scalar_size, fast_size);
+      ASSERT_TRUE(fast == scalar);
+
+      fast.resize(fast_size);
+      if (size > 0) {
+        ASSERT_TRUE(xp2gdl90::test::ExtractPayload(fast) == payload);
+      }
+    }
+  }
+}
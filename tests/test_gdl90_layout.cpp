@@ -0,0 +1,103 @@
+#include "test_harness.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "frame_test_utils.h"
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/gdl90_layout.h"
+
+namespace {
+
+using gdl90::layout::Field;
+
+// Layouts are checked at compile time too.
+static_assert(Field<12, 12>::FIRST_BYTE == 1 && Field<12, 12>::LAST_BYTE == 2,
+              "a field spanning a byte boundary covers both bytes");
+static_assert(!gdl90::layout::Tiles<Field<0, 8>, Field<9, 7>>(16),
+              "a gap is not a tiling");
+
+using Straddle = Field<4, 12>;
+using Flag = Field<16, 1>;
+using Tail = Field<17, 15>;
+using Word = Field<0, 32>;
+
+} // namespace
+
+TEST_CASE("Layout fields pack across byte boundaries and read back") {
+  std::array<uint8_t, 4> bytes{};
+  Straddle::put(bytes.data(), 0xABC);
+  Flag::put(bytes.data(), 1);
+  Tail::put(bytes.data(), 0x7FFE);
+  ASSERT_EQ(static_cast<uint8_t>(0x0A), bytes[0]);
+  ASSERT_EQ(static_cast<uint8_t>(0xBC), bytes[1]);
+  ASSERT_EQ(static_cast<uint8_t>(0xFF), bytes[2]);
+  ASSERT_EQ(static_cast<uint8_t>(0xFE), bytes[3]);
+
+  ASSERT_EQ(static_cast<uint32_t>(0xABC), Straddle::get(bytes.data()));
+  ASSERT_EQ(static_cast<uint32_t>(1), Flag::get(bytes.data()));
+  ASSERT_EQ(static_cast<uint32_t>(0x7FFE), Tail::get(bytes.data()));
+  ASSERT_EQ(static_cast<uint32_t>(0x0ABCFFFE), Word::get(bytes.data()));
+  // Values wider than the field are masked.
+  std::array<uint8_t, 2> narrow{};
+  Field<2, 4>::put(narrow.data(), 0xFF);
+  ASSERT_EQ(static_cast<uint8_t>(0x3C), narrow[0]);
+  // 0xE02 is -510 in 12 bits.
+  std::array<uint8_t, 2> signed_bytes{};
+  Straddle::put(signed_bytes.data(), 0xE02);
+  ASSERT_EQ(-510, Straddle::getSigned(signed_bytes.data()));
+}
+
+TEST_CASE("Position report payload unpacks to the encoded wire fields") {
+  gdl90::GDL90Encoder encoder;
+  gdl90::PositionData data;
+  data.latitude = 47.5;
+  data.longitude = -122.25;
+  data.altitude = 4500;
+  data.h_velocity = 250;
+  data.v_velocity = -640;
+  data.track = 90;
+  data.track_type = gdl90::TrackType::TRUE_TRACK;
+  data.airborne = true;
+  data.nic = 8;
+  data.nacp = 9;
+  data.icao_address = 0xA1B2C3;
+  data.callsign = "UAL12";
+  data.emitter_category = gdl90::EmitterCategory::LARGE;
+  data.address_type = gdl90::AddressType::TISB_ICAO;
+  data.alert_status = 1;
+  data.emergency_code = 5;
+
+  const std::vector<uint8_t> payload =
+      xp2gdl90::test::ExtractPayload(encoder.createTrafficReport(data));
+  gdl90::layout::PositionReportFields fields;
+  ASSERT_TRUE(!gdl90::layout::UnpackPositionReport(
+      payload.data(), payload.size() - 1, &fields));
+  ASSERT_TRUE(gdl90::layout::UnpackPositionReport(payload.data(),
+                                                  payload.size(), &fields));
+
+  ASSERT_EQ(gdl90::MSG_ID_TRAFFIC_REPORT, fields.message_id);
+  ASSERT_EQ(static_cast<uint8_t>(1), fields.alert_status);
+  ASSERT_EQ(static_cast<uint8_t>(2), fields.address_type);
+  ASSERT_EQ(static_cast<uint32_t>(0xA1B2C3), fields.address);
+  ASSERT_EQ(static_cast<uint16_t>((4500 + 1000) / 25), fields.altitude);
+  ASSERT_EQ(static_cast<uint8_t>(0x09), fields.misc);
+  ASSERT_EQ(static_cast<uint8_t>(8), fields.nic);
+  ASSERT_EQ(static_cast<uint8_t>(9), fields.nacp);
+  ASSERT_EQ(static_cast<uint16_t>(250), fields.h_velocity);
+  ASSERT_EQ(-10, gdl90::layout::PositionReport::VerticalVelocity::getSigned(
+                     payload.data()));
+  ASSERT_EQ(static_cast<uint8_t>(64), fields.track);
+  ASSERT_EQ(static_cast<uint8_t>(3), fields.emitter_category);
+  ASSERT_EQ(std::string("UAL12   "),
+            std::string(fields.callsign.begin(), fields.callsign.end()));
+  ASSERT_EQ(static_cast<uint8_t>(5), fields.emergency_code);
+
+  // Packing the unpacked fields reproduces the payload byte for byte.
+  std::array<uint8_t, gdl90::layout::PositionReport::SIZE> repacked{};
+  gdl90::layout::PackPositionReport(fields, repacked.data());
+  ASSERT_TRUE(std::vector<uint8_t>(repacked.begin(), repacked.end()) ==
+              payload);
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <exception>
 #include <functional>
 #include <iostream>
@@ -32,6 +33,20 @@ public:
       : std::runtime_error(message) {}
 };
 
+// Heap allocations made by the calling thread, counted by the global
+// operator new replacement in test_main.cpp.
+inline thread_local uint64_t g_thread_allocations = 0;
+
+// Counts the calling thread's allocations from construction on.
+class AllocationScope {
+public:
+  AllocationScope() : start_(g_thread_allocations) {}
+  uint64_t count() const { return g_thread_allocations - start_; }
+
+private:
+  uint64_t start_;
+};
+
 inline std::string FormatMessage(const char *file, int line,
                                  const std::string &message) {
   std::ostringstream oss;
@@ -69,6 +84,20 @@ inline std::string FormatMessage(const char *file, int line,
     }                                                                          \
   } while (0)
 
+// Fails (like the ASSERT_ macros) if the statement allocates on this thread.
+#define EXPECT_NO_ALLOCATIONS(...)                                             \
+  do {                                                                         \
+    test_harness::AllocationScope _allocation_scope;                           \
+    __VA_ARGS__;                                                               \
+    const uint64_t _allocations = _allocation_scope.count();                   \
+    if (_allocations != 0) {                                                   \
+      throw test_harness::AssertionFailure(test_harness::FormatMessage(        \
+          __FILE__, __LINE__,                                                  \
+          "EXPECT_NO_ALLOCATIONS failed: " + std::to_string(_allocations) +    \
+              " allocation(s) in " #__VA_ARGS__));                             \
+    }                                                                          \
+  } while (0)
+
 #define ASSERT_NE(expected, actual)                                            \
   do {                                                                         \
     if ((expected) == (actual)) {                                              \
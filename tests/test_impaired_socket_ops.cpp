@@ -0,0 +1,217 @@
+#include "test_harness.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "fake_socket_ops.h"
+#include "xp2gdl90/broadcast_engine.h"
+#include "xp2gdl90/impaired_socket_ops.h"
+#include "xp2gdl90/virtual_clock.h"
+
+using udp::ImpairedSocketOps;
+using udp::ImpairmentOptions;
+using xp2gdl90::VirtualClock;
+using xp2gdl90::test::FakeSocketOps;
+
+namespace {
+
+intptr_t SendByte(ImpairedSocketOps *ops, uint8_t value) {
+  const uint8_t address[4] = {127, 0, 0, 1};
+  return ops->SendTo(9, &value, 1, 0, address, sizeof(address));
+}
+
+void FillArena(gdl90::FrameArena *arena, size_t count, size_t size) {
+  arena->clear();
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t *frame = arena->beginFrame();
+    for (size_t b = 0; b < size; ++b) {
+      frame[b] = static_cast<uint8_t>(i);
+    }
+    arena->commitFrame(size);
+  }
+}
+
+} // namespace
+
+TEST_CASE("Impaired socket ops pass through when unimpaired") {
+  FakeSocketOps inner;
+  inner.sendto_result = 1;
+  inner.create_socket_result = 9;
+  inner.last_error_value = 11;
+  VirtualClock clock;
+  ImpairedSocketOps ops(&inner, &clock);
+  ASSERT_EQ(0, ops.Startup());
+  ASSERT_EQ(uintptr_t{9}, ops.CreateSocket(0, 0, 0));
+  const int value = 1;
+  ASSERT_EQ(0, ops.SetSockOpt(9, 0, 5, &value, sizeof(value)));
+  uint8_t address[4] = {};
+  ASSERT_EQ(1, ops.InetPton(0, "127.0.0.1", address));
+  ASSERT_EQ(0, ops.Bind(9, address, sizeof(address)));
+  ASSERT_EQ(intptr_t{1}, SendByte(&ops, 7));
+  ASSERT_EQ(static_cast<size_t>(1), inner.sent_datagrams.size());
+  ASSERT_EQ(static_cast<size_t>(4), inner.sent_addresses[0].size());
+  ASSERT_EQ(11, ops.LastError());
+  ASSERT_EQ(uint64_t{1}, ops.stats().delivered);
+  ASSERT_EQ(0, ops.CloseSocket(9));
+  ASSERT_EQ(1, inner.close_calls);
+  ops.Cleanup();
+  ASSERT_EQ(1, inner.cleanup_calls);
+  ASSERT_EQ(1, inner.bind_calls);
+}
+
+TEST_CASE("Impaired socket ops hold datagrams for their delay") {
+  FakeSocketOps inner;
+  inner.sendto_result = 1;
+  VirtualClock clock;
+  ImpairedSocketOps ops(&inner, &clock);
+  ImpairmentOptions options;
+  options.latency_s = 0.5;
+  options.jitter_s = 0.05;
+  options.seed = 3;
+  ops.setOptions(options);
+
+  for (uint8_t i = 0; i < 200; ++i) {
+    // Delayed sends report success at once, as UDP does.
+    ASSERT_EQ(intptr_t{1}, SendByte(&ops, i));
+    clock.advance(0.001);
+  }
+  ASSERT_EQ(static_cast<size_t>(0), inner.sent_datagrams.size());
+  ASSERT_EQ(static_cast<size_t>(200), ops.queuedBytes());
+  clock.advance(0.6);
+  ASSERT_EQ(static_cast<size_t>(200), ops.pump());
+  ASSERT_EQ(static_cast<size_t>(200), inner.sent_datagrams.size());
+  ASSERT_EQ(static_cast<size_t>(0), ops.queued());
+  // 50 ms of jitter on 1 ms spacing reorders plenty.
+  ASSERT_TRUE(ops.stats().reordered > 0u);
+  size_t out_of_place = 0;
+  for (size_t i = 0; i < inner.sent_datagrams.size(); ++i) {
+    out_of_place += inner.sent_datagrams[i][0] != i ? 1 : 0;
+  }
+  ASSERT_TRUE(out_of_place > 0u);
+
+  // Closing the socket drops what it still had queued.
+  SendByte(&ops, 0);
+  ASSERT_EQ(static_cast<size_t>(1), ops.queued());
+  ops.CloseSocket(9);
+  ASSERT_EQ(static_cast<size_t>(0), ops.queuedBytes());
+}
+
+TEST_CASE("Impaired socket ops lose and refuse datagrams by seed") {
+  FakeSocketOps inner;
+  inner.sendto_result = 1;
+  inner.record_sends = false;
+  VirtualClock clock;
+  ImpairedSocketOps ops(&inner, &clock);
+  ImpairmentOptions options;
+  options.loss = 0.2;
+  options.buffer_full = 0.1;
+  options.seed = 11;
+  ops.setOptions(options);
+  int refused = 0;
+  for (int i = 0; i < 10000; ++i) {
+    if (SendByte(&ops, 0) < 0) {
+      ++refused;
+      ASSERT_EQ(udp::BufferFullError(), ops.LastError());
+    }
+  }
+  const udp::ImpairmentStats &stats = ops.stats();
+  ASSERT_EQ(static_cast<uint64_t>(refused), stats.buffer_full);
+  ASSERT_TRUE(stats.buffer_full > 850u && stats.buffer_full < 1150u);
+  ASSERT_TRUE(stats.lost > 1600u && stats.lost < 2000u);
+  ASSERT_EQ(stats.offered, stats.delivered + stats.lost + stats.buffer_full);
+  ASSERT_EQ(static_cast<int>(stats.delivered), inner.sendto_calls);
+
+  ImpairedSocketOps again(&inner, &clock);
+  again.setOptions(options);
+  for (int i = 0; i < 10000; ++i) {
+    SendByte(&again, 0);
+  }
+  ASSERT_EQ(stats.lost, again.stats().lost);
+  ASSERT_EQ(stats.buffer_full, again.stats().buffer_full);
+}
+
+TEST_CASE("Impaired socket ops serialize a capped link") {
+  FakeSocketOps inner;
+  inner.sendto_result = 100;
+  VirtualClock clock;
+  ImpairedSocketOps ops(&inner, &clock);
+  ImpairmentOptions options;
+  options.bandwidth_bytes_per_s = 1000.0;
+  options.send_buffer_bytes = 500;
+  ops.setOptions(options);
+  const std::vector<uint8_t> datagram(100, 0x7E);
+  int accepted = 0;
+  for (int i = 0; i < 8; ++i) {
+    if (ops.SendTo(9, datagram.data(), datagram.size(), 0, nullptr, 0) > 0) {
+      ++accepted;
+    }
+  }
+  // Five datagrams fill the buffer; each takes 0.1 s of the link.
+  ASSERT_EQ(5, accepted);
+  ASSERT_EQ(uint64_t{3}, ops.stats().buffer_full);
+  clock.advance(0.25);
+  ASSERT_EQ(static_cast<size_t>(2), ops.pump());
+  ASSERT_TRUE(ops.SendTo(9, datagram.data(), datagram.size(), 0, nullptr,
+                         0) > 0);
+  clock.advance(1.0);
+  ops.pump();
+  ASSERT_EQ(static_cast<size_t>(6), inner.sent_datagrams.size());
+  ASSERT_EQ(static_cast<size_t>(500), ops.stats().max_queued_bytes);
+}
+
+TEST_CASE("Paced sweeps ride a thin link that a burst overflows") {
+  // 10 kB/s with a 2 kB buffer against 30 frames of 100 bytes.
+  ImpairmentOptions options;
+  options.bandwidth_bytes_per_s = 10000.0;
+  options.send_buffer_bytes = 2000;
+  gdl90::FrameArena frames;
+  FillArena(&frames, 30, 100);
+
+  uint64_t refused[2] = {0, 0};
+  for (int paced = 0; paced < 2; ++paced) {
+    FakeSocketOps inner;
+    inner.create_socket_result = 9;
+    inner.sendto_result = 100;
+    inner.record_sends = false;
+    VirtualClock clock;
+    ImpairedSocketOps ops(&inner, &clock);
+    ops.setOptions(options);
+    udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+    ASSERT_TRUE(broadcaster.initialize());
+    xp2gdl90::BroadcastEngine engine;
+    engine.attach(&broadcaster);
+    xp2gdl90::FrameTicker ticker(&clock, 1.0 / 30.0);
+    for (int sweep = 0; sweep < 10; ++sweep) {
+      engine.startTraffic(frames, clock.now(), paced ? 0.45 : 0.0);
+      for (int frame = 0; frame < 30; ++frame) {
+        engine.sendPacedTraffic(clock.now());
+        engine.flush();
+        ticker.next();
+      }
+    }
+    refused[paced] = ops.stats().buffer_full;
+  }
+  ASSERT_TRUE(refused[0] > 0u);
+  ASSERT_EQ(uint64_t{0}, refused[1]);
+}
+
+TEST_CASE("Refused sends back the bandwidth limiter off") {
+  FakeSocketOps inner;
+  inner.create_socket_result = 9;
+  inner.sendto_result = 1;
+  inner.record_sends = false;
+  VirtualClock clock;
+  ImpairedSocketOps ops(&inner, &clock);
+  ImpairmentOptions options;
+  options.buffer_full = 1.0;
+  ops.setOptions(options);
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  broadcaster.setBandwidthLimit(10000.0, 0, 0);
+  broadcaster.updateBandwidth(clock.now());
+  const uint8_t frame[] = {0x7E, 0x14, 0x7E};
+  ASSERT_EQ(-1, broadcaster.send(frame, sizeof(frame)));
+  clock.advance(0.1);
+  broadcaster.updateBandwidth(clock.now());
+  ASSERT_EQ(uint64_t{1}, broadcaster.bandwidthStats(0).backoffs);
+}
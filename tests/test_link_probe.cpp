@@ -0,0 +1,133 @@
+#include "test_harness.h"
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "xp2gdl90/foreflight_encoder.h"
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/link_probe.h"
+
+using xp2gdl90::LinkProbe;
+using xp2gdl90::LinkProbeMark;
+using xp2gdl90::ProbeClass;
+
+namespace {
+
+constexpr int64_t kSecondNs = 1000000000;
+
+std::vector<uint8_t> MarkFrame(uint32_t sequence, int64_t send_time_us) {
+  LinkProbeMark mark;
+  mark.sequence = sequence;
+  mark.send_time_us = send_time_us;
+  gdl90::FrameBuffer frame;
+  xp2gdl90::EncodeLinkProbe(mark, frame);
+  return frame.toVector();
+}
+
+std::vector<uint8_t> TrafficFrame(uint32_t address) {
+  gdl90::PositionData report;
+  report.icao_address = address;
+  report.latitude = 47.0;
+  report.longitude = 8.0;
+  return gdl90::GDL90Encoder().createTrafficReport(report);
+}
+
+void Receive(LinkProbe *probe, const std::vector<uint8_t> &datagram,
+             int64_t arrival_ns, int64_t arrival_wall_us = 0) {
+  probe->receiveDatagram(datagram.data(), datagram.size(), arrival_ns,
+                         arrival_wall_us);
+}
+
+} // namespace
+
+TEST_CASE("Link probe marks round trip through the decoder") {
+  const std::vector<uint8_t> bytes = MarkFrame(0x7E7D0102u, 1700000000123456);
+  gdl90::Decoder decoder;
+  decoder.reset(bytes.data(), bytes.size());
+  gdl90::FrameSpan frame;
+  ASSERT_TRUE(decoder.next(&frame));
+  ASSERT_TRUE(xp2gdl90::ClassifyFrame(frame) == ProbeClass::LINK_PROBE);
+  LinkProbeMark mark;
+  ASSERT_TRUE(xp2gdl90::DecodeLinkProbe(frame, &mark));
+  ASSERT_EQ(static_cast<uint32_t>(0x7E7D0102u), mark.sequence);
+  ASSERT_EQ(static_cast<int64_t>(1700000000123456), mark.send_time_us);
+
+  const std::vector<uint8_t> ahrs =
+      gdl90::foreflight::ForeFlightEncoder().createAhrsMessage({});
+  decoder.reset(ahrs.data(), ahrs.size());
+  ASSERT_TRUE(decoder.next(&frame));
+  ASSERT_TRUE(xp2gdl90::ClassifyFrame(frame) == ProbeClass::AHRS);
+  ASSERT_TRUE(!xp2gdl90::DecodeLinkProbe(frame, &mark));
+}
+
+TEST_CASE("Link probe measures rates, jitter and missed heartbeats") {
+  LinkProbe probe;
+  const std::vector<uint8_t> heartbeat =
+      gdl90::GDL90Encoder().createHeartbeat();
+  // One a second, then one held up by 100 ms, then two lost.
+  const int64_t arrivals[] = {0, kSecondNs, 2 * kSecondNs,
+                              3 * kSecondNs + kSecondNs / 10, 6 * kSecondNs};
+  for (const int64_t arrival : arrivals) {
+    Receive(&probe, heartbeat, arrival);
+  }
+  const xp2gdl90::LinkProbeStats &stats = probe.stats();
+  const xp2gdl90::ProbeClassStats &beats = stats.of(ProbeClass::HEARTBEAT);
+  ASSERT_EQ(static_cast<uint64_t>(5), beats.frames);
+  ASSERT_EQ(static_cast<uint64_t>(4), beats.interval.count());
+  ASSERT_EQ(static_cast<uint64_t>(2), stats.missed_heartbeats);
+  ASSERT_TRUE(std::fabs(beats.meanIntervalS() - 1.5) < 1e-9);
+  ASSERT_TRUE(beats.jitterS() > 0.5);
+  ASSERT_TRUE(std::fabs(stats.elapsed_s - 6.0) < 1e-9);
+
+  const std::string report = xp2gdl90::FormatLinkProbeReport(stats, true);
+  ASSERT_TRUE(report.find("Heartbeat") != std::string::npos);
+  ASSERT_TRUE(report.find("Heartbeats missed: 2") != std::string::npos);
+  ASSERT_TRUE(report.find("Marks: none") != std::string::npos);
+}
+
+TEST_CASE("Link probe tracks traffic age per address") {
+  LinkProbe probe;
+  std::vector<uint8_t> sweep = TrafficFrame(0xA1);
+  const std::vector<uint8_t> second = TrafficFrame(0xA2);
+  sweep.insert(sweep.end(), second.begin(), second.end());
+  Receive(&probe, sweep, 0);
+  Receive(&probe, TrafficFrame(0xA1), kSecondNs / 2);
+  Receive(&probe, sweep, kSecondNs);
+
+  const xp2gdl90::LinkProbeStats &stats = probe.stats();
+  ASSERT_EQ(static_cast<size_t>(2), stats.traffic_targets);
+  // 0xA1 after 0.5 s twice, 0xA2 after 1 s.
+  ASSERT_EQ(static_cast<uint64_t>(3), stats.traffic_age.count());
+  ASSERT_TRUE(stats.traffic_age.maxNs() == static_cast<uint64_t>(kSecondNs));
+  // Reports in one datagram share an arrival, so only datagrams count.
+  ASSERT_EQ(static_cast<uint64_t>(5), stats.of(ProbeClass::TRAFFIC).frames);
+  ASSERT_EQ(static_cast<uint64_t>(2),
+            stats.of(ProbeClass::TRAFFIC).interval.count());
+}
+
+TEST_CASE("Link probe counts lost and late marks and queueing delay") {
+  LinkProbe probe;
+  // Clocks 5 s apart: only the delay above the minimum means anything.
+  const int64_t offset_us = 5000000;
+  Receive(&probe, MarkFrame(10, 0), 0, offset_us + 2000);
+  Receive(&probe, MarkFrame(11, 100000), kSecondNs / 10,
+          offset_us + 100000 + 1000);
+  Receive(&probe, MarkFrame(14, 400000), 4 * kSecondNs / 10,
+          offset_us + 400000 + 9000);
+  Receive(&probe, MarkFrame(13, 300000), 4 * kSecondNs / 10,
+          offset_us + 300000 + 110000);
+
+  const xp2gdl90::LinkProbeStats &stats = probe.stats();
+  ASSERT_EQ(static_cast<uint64_t>(4), stats.marks);
+  ASSERT_EQ(static_cast<uint64_t>(1), stats.marks_lost);
+  ASSERT_EQ(static_cast<uint64_t>(1), stats.marks_late);
+  ASSERT_EQ(offset_us + 1000, stats.min_delay_us);
+  // The late mark queued 109 ms longer than the fastest one.
+  ASSERT_TRUE(stats.delay.maxNs() == static_cast<uint64_t>(109000000));
+
+  const std::string report = xp2gdl90::FormatLinkProbeReport(stats, false);
+  ASSERT_TRUE(report.find("4 received, 1 lost (20.00%), 1 late") !=
+              std::string::npos);
+}
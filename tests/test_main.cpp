@@ -1,5 +1,22 @@
 #include "test_harness.h"
 
+#include <cstdlib>
+#include <new>
+
+void *operator new(std::size_t size) {
+  ++test_harness::g_thread_allocations;
+  if (void *p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
 int main() {
   int failures = 0;
   const auto &tests = test_harness::Registry();
@@ -0,0 +1,153 @@
+#include "test_harness.h"
+
+#include <cmath>
+#include <string>
+
+#include "fake_socket_ops.h"
+#include "xp2gdl90/metrics_exporter.h"
+#include "xp2gdl90/simple_json.h"
+
+using xp2gdl90::test::FakeSocketOps;
+
+namespace {
+
+const xp2gdl90::json::Value &
+ParseReport(const std::string &text, xp2gdl90::json::Document *document) {
+  std::string error;
+  ASSERT_TRUE(xp2gdl90::json::Parse(text, document, &error));
+  ASSERT_TRUE(document->root().IsObject());
+  return document->root();
+}
+
+double Number(const xp2gdl90::json::Value &object, const char *key) {
+  const xp2gdl90::json::Value *value = object.Find(key);
+  ASSERT_TRUE(value && value->IsNumber());
+  return value->AsNumber();
+}
+
+} // namespace
+
+TEST_CASE("Metrics report carries counter rates, gauges and histograms") {
+  xp2gdl90::MetricsReport report;
+  report.begin("Rig \"A\"", 10.0);
+  report.counter("packets.heartbeat", 100);
+  report.gauge("queue.traffic", 3.0);
+  xp2gdl90::json::Document first_document;
+  const xp2gdl90::json::Value &first =
+      ParseReport(report.finish(), &first_document);
+  ASSERT_EQ(std::string("xp2gdl90.metrics"),
+            std::string(first.Find("type")->AsString()));
+  ASSERT_EQ(std::string("Rig \"A\""),
+            std::string(first.Find("source")->AsString()));
+  ASSERT_EQ(1.0, Number(first, "seq"));
+  ASSERT_EQ(0.0, Number(first, "interval_s"));
+  const xp2gdl90::json::Value *metrics = first.Find("metrics");
+  ASSERT_TRUE(metrics && metrics->IsObject());
+  ASSERT_EQ(100.0, Number(*metrics->Find("packets.heartbeat"), "total"));
+  ASSERT_EQ(0.0, Number(*metrics->Find("packets.heartbeat"), "rate"));
+  ASSERT_EQ(3.0, Number(*metrics, "queue.traffic"));
+
+  xp2gdl90::LatencyHistogram histogram;
+  histogram.record(1000);
+  histogram.record(1000);
+  histogram.record(50000);
+  report.begin("Rig \"A\"", 15.0);
+  report.counter("packets.heartbeat", 110);
+  report.gauge("queue.traffic", NAN);
+  report.histogram("tick.send", histogram);
+  xp2gdl90::json::Document second_document;
+  const xp2gdl90::json::Value &second =
+      ParseReport(report.finish(), &second_document);
+  ASSERT_EQ(2.0, Number(second, "seq"));
+  ASSERT_EQ(5.0, Number(second, "interval_s"));
+  metrics = second.Find("metrics");
+  ASSERT_EQ(2.0, Number(*metrics->Find("packets.heartbeat"), "rate"));
+  ASSERT_TRUE(metrics->Find("queue.traffic")->IsNull());
+
+  const xp2gdl90::json::Value *tick = metrics->Find("tick.send");
+  ASSERT_TRUE(tick && tick->IsObject());
+  ASSERT_EQ(3.0, Number(*tick, "count"));
+  ASSERT_EQ(50.0, Number(*tick, "max_us"));
+  const xp2gdl90::json::Value *buckets = tick->Find("buckets");
+  ASSERT_TRUE(buckets && buckets->IsArray());
+  ASSERT_EQ(static_cast<size_t>(2), buckets->Elements().size());
+  ASSERT_EQ(2.0, buckets->Elements()[0].Elements()[1].AsNumber());
+  ASSERT_TRUE(buckets->Elements()[0].Elements()[0].AsNumber() >= 1000.0);
+
+  // A counter that went backwards was reset and reports no rate.
+  report.begin("Rig \"A\"", 20.0);
+  report.counter("packets.heartbeat", 5);
+  xp2gdl90::json::Document third_document;
+  const xp2gdl90::json::Value &third =
+      ParseReport(report.finish(), &third_document);
+  ASSERT_EQ(0.0,
+            Number(*third.Find("metrics")->Find("packets.heartbeat"), "rate"));
+}
+
+TEST_CASE("Metrics report helpers name every class and stage") {
+  xp2gdl90::SendIntervalTable intervals;
+  xp2gdl90::SendIntervalHistogram &ahrs =
+      intervals[static_cast<size_t>(xp2gdl90::SendClass::AHRS)];
+  ahrs.recordSend(0.0, 0.2);
+  ahrs.recordSend(0.2, 0.2);
+  xp2gdl90::StageTimings timings;
+  timings.add(xp2gdl90::Stage::SIM_READ, 2000);
+  timings.endTick();
+
+  xp2gdl90::MetricsReport report;
+  report.begin("XP2GDL90", 1.0);
+  xp2gdl90::AddSendIntervalMetrics(intervals, &report);
+  xp2gdl90::AddStageTimingMetrics(timings, &report);
+  xp2gdl90::json::Document document;
+  const xp2gdl90::json::Value &root = ParseReport(report.finish(), &document);
+  const xp2gdl90::json::Value *metrics = root.Find("metrics");
+  ASSERT_EQ(xp2gdl90::SEND_CLASS_COUNT + xp2gdl90::STAGE_COUNT,
+            metrics->Members().size());
+  ASSERT_EQ(1.0, Number(*metrics->Find("sends.ahrs"), "total"));
+  ASSERT_EQ(0.0, Number(*metrics->Find("sends.traffic"), "total"));
+  ASSERT_EQ(1.0, Number(*metrics->Find("tick.sim_read"), "count"));
+  ASSERT_EQ(0.0, Number(*metrics->Find("tick.send"), "count"));
+}
+
+TEST_CASE("Metrics exporter sends one datagram per interval") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 7;
+  ops.sendto_result = 1;
+  xp2gdl90::MetricsExporter exporter(&ops);
+  ASSERT_TRUE(!exporter.due(0.0));
+
+  std::string error;
+  ASSERT_TRUE(exporter.open("10.0.0.9", 4100, 5.0, &error));
+  ASSERT_TRUE(exporter.isOpen());
+  ASSERT_TRUE(exporter.due(100.0));
+  exporter.begin("XP2GDL90", 100.0).counter("bytes", 42);
+  ASSERT_TRUE(exporter.send(&error));
+  ASSERT_EQ(static_cast<size_t>(1), ops.sent_datagrams.size());
+  const std::string sent(ops.sent_datagrams[0].begin(),
+                         ops.sent_datagrams[0].end());
+  xp2gdl90::json::Document document;
+  ASSERT_EQ(42.0,
+            Number(*ParseReport(sent, &document).Find("metrics")->Find("bytes"),
+                   "total"));
+
+  ASSERT_TRUE(!exporter.due(104.9));
+  ASSERT_TRUE(exporter.due(105.0));
+  ops.sendto_result = -1;
+  exporter.begin("XP2GDL90", 105.0);
+  ASSERT_TRUE(!exporter.send(&error));
+  ASSERT_EQ(static_cast<uint64_t>(1), exporter.reportsSent());
+  ASSERT_EQ(static_cast<uint64_t>(1), exporter.sendErrors());
+
+  exporter.close();
+  ASSERT_TRUE(!exporter.isOpen());
+  ASSERT_TRUE(!exporter.due(200.0));
+}
+
+TEST_CASE("Metrics exporter reports socket failures when opening") {
+  FakeSocketOps ops;
+  xp2gdl90::MetricsExporter exporter(&ops);
+  std::string error;
+  ASSERT_TRUE(!exporter.open("10.0.0.9", 4100, 5.0, &error));
+  ASSERT_TRUE(!exporter.isOpen());
+  ASSERT_TRUE(error.find("10.0.0.9:4100") != std::string::npos);
+}
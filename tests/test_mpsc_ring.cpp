@@ -0,0 +1,81 @@
+#include "test_harness.h"
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "xp2gdl90/mpsc_ring.h"
+
+TEST_CASE("MPSC ring rounds capacity up and drops when full") {
+  xp2gdl90::MpscRing<int> ring(5);
+  ASSERT_EQ(static_cast<size_t>(8), ring.capacity());
+
+  int value = 0;
+  ASSERT_TRUE(!ring.pop(&value));
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_TRUE(ring.push(i));
+  }
+  ASSERT_TRUE(!ring.push(8));
+  ASSERT_EQ(static_cast<uint64_t>(1), ring.dropped());
+
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(ring.pop(&value));
+    ASSERT_EQ(i, value);
+  }
+  // Released slots are reused on the next lap.
+  for (int i = 8; i < 11; ++i) {
+    ASSERT_TRUE(ring.push(i));
+  }
+  for (int i = 3; i < 11; ++i) {
+    ASSERT_TRUE(ring.pop(&value));
+    ASSERT_EQ(i, value);
+  }
+  ASSERT_TRUE(!ring.pop(&value));
+}
+
+TEST_CASE("MPSC ring keeps each producer's order across threads") {
+  struct Item {
+    uint32_t producer = 0;
+    uint32_t sequence = 0;
+  };
+  xp2gdl90::MpscRing<Item> ring(64);
+  constexpr uint32_t kProducers = 4;
+  constexpr uint32_t kCount = 20000;
+
+  std::vector<std::thread> producers;
+  for (uint32_t producer = 0; producer < kProducers; ++producer) {
+    producers.emplace_back([&ring, producer] {
+      for (uint32_t sequence = 0; sequence < kCount;) {
+        if (ring.push(Item{producer, sequence})) {
+          ++sequence;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<uint32_t> next(kProducers, 0);
+  bool in_order = true;
+  uint32_t received = 0;
+  while (received < kProducers * kCount) {
+    Item item;
+    if (!ring.pop(&item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    in_order = in_order && item.producer < kProducers &&
+               item.sequence == next[item.producer];
+    if (item.producer < kProducers) {
+      next[item.producer] = item.sequence + 1;
+    }
+    ++received;
+  }
+  for (std::thread &producer : producers) {
+    producer.join();
+  }
+
+  ASSERT_TRUE(in_order);
+  Item item;
+  ASSERT_TRUE(!ring.pop(&item));
+}
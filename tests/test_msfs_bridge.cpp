@@ -1,6 +1,7 @@
 #include "test_harness.h"
 
 #include <cmath>
+#include <cstring>
 #include <limits>
 
 #include "xp2gdl90/foreflight_encoder.h"
@@ -210,7 +211,7 @@ TEST_CASE("BuildOwnshipPosition basic fields") {
   ASSERT_EQ(static_cast<uint8_t>(gdl90::AddressType::ADSB_ICAO),
             static_cast<uint8_t>(data.address_type));
   ASSERT_TRUE(data.airborne);
-  ASSERT_EQ(std::string("MSTEST"), data.callsign);
+  ASSERT_EQ(std::string("MSTEST"), data.callsign.str());
   ASSERT_EQ(cfg.nic, data.nic);
   ASSERT_EQ(cfg.nacp, data.nacp);
 }
@@ -235,7 +236,7 @@ TEST_CASE("BuildOwnshipPosition falls back to cfg callsign when empty") {
   auto sim = MakeOwnship();
   sim.callsign = "";
   const auto data = BuildOwnshipPosition(sim, cfg);
-  ASSERT_EQ(cfg.callsign, data.callsign);
+  ASSERT_EQ(cfg.callsign, data.callsign.str());
 }
 
 TEST_CASE("BuildOwnshipPosition track is normalized") {
@@ -353,7 +354,7 @@ TEST_CASE("BuildTrafficPosition basic") {
   ASSERT_EQ(37.6, out.latitude);
   ASSERT_EQ(-122.1, out.longitude);
   ASSERT_EQ(static_cast<int32_t>(3000), out.altitude);
-  ASSERT_EQ(std::string("TFC001"), out.callsign);
+  ASSERT_EQ(std::string("TFC001"), out.callsign.str());
   ASSERT_TRUE(out.airborne);
 }
 
@@ -432,3 +433,56 @@ TEST_CASE("BuildTrafficPosition fallback callsign when empty") {
   ASSERT_TRUE(BuildTrafficPosition(td, cfg, &out));
   ASSERT_TRUE(!out.callsign.empty());
 }
+
+// ---------------------------------------------------------------------------
+// UpsertTrafficTargets
+// ---------------------------------------------------------------------------
+
+TEST_CASE("SimConnectCallsign stops at the buffer end without a NUL") {
+  const char unterminated[4] = {'N', '1', '2', '3'};
+  ASSERT_EQ(std::string("N123"),
+            SimConnectCallsign(unterminated, sizeof(unterminated)).str());
+  ASSERT_EQ(std::string("DLH4AB"),
+            SimConnectCallsign("  dlh4ab\0junk", 13).str());
+  ASSERT_TRUE(SimConnectCallsign(" \t", 2).empty());
+  ASSERT_TRUE(SimConnectCallsign(nullptr, 8).empty());
+}
+
+TEST_CASE("UpsertTrafficTargets matches the single-target path") {
+  TrafficSimData sims[2];
+  sims[0].latitude_deg = 37.6;
+  sims[0].longitude_deg = -122.1;
+  sims[0].altitude_ft = 3000.0;
+  sims[0].ground_velocity_kt = 100.0;
+  sims[0].velocity_world_z_fps = 100.0;
+  sims[0].sim_on_ground = 1;
+  std::memcpy(sims[0].atc_id, "TFC001", 7);
+  sims[1] = sims[0];
+  sims[1].latitude_deg = 95.0;
+  const TrafficSimView views[2] = {{1001, &sims[0]}, {1002, &sims[1]}};
+
+  xp2gdl90::traffic::TrackTable tracks;
+  xp2gdl90::traffic::TrafficSnapshot snapshot;
+  ASSERT_EQ(static_cast<size_t>(1),
+            UpsertTrafficTargets(&tracks, &snapshot, views, 2, 1.0));
+  ASSERT_EQ(static_cast<size_t>(2), snapshot.size());
+
+  TrafficData traffic = MakeTraffic(1001);
+  traffic.sim_on_ground = true;
+  xp2gdl90::traffic::TrackTable single_tracks;
+  xp2gdl90::traffic::TrafficSnapshot single;
+  UpsertTrafficTarget(&single_tracks, &single, traffic, 1.0);
+  ASSERT_EQ(single.source_id[0], snapshot.source_id[0]);
+  ASSERT_EQ(single.latitude[0], snapshot.latitude[0]);
+  ASSERT_EQ(single.vz[0], snapshot.vz[0]);
+  ASSERT_EQ(single.address[0], snapshot.address[0]);
+  ASSERT_EQ(single.flags[0], snapshot.flags[0]);
+  ASSERT_TRUE(single.callsign[0] == snapshot.callsign[0]);
+
+  // A later sample for the same object updates its row in place.
+  sims[0].altitude_ft = 3500.0;
+  ASSERT_EQ(static_cast<size_t>(1),
+            UpsertTrafficTargets(&tracks, &snapshot, views, 1, 2.0));
+  ASSERT_EQ(static_cast<size_t>(2), snapshot.size());
+  ASSERT_EQ(3500.0, snapshot.altitude_ft[0]);
+}
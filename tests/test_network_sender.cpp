@@ -0,0 +1,322 @@
+#include "test_harness.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "fake_socket_ops.h"
+#include "xp2gdl90/network_sender.h"
+
+using xp2gdl90::test::FakeSocketOps;
+
+namespace {
+
+void FillArena(gdl90::FrameArena *arena, size_t count, uint8_t marker) {
+  arena->clear();
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t *frame = arena->beginFrame();
+    frame[0] = 0x7E;
+    frame[1] = marker;
+    frame[2] = static_cast<uint8_t>(i);
+    frame[3] = 0x7E;
+    arena->commitFrame(4);
+  }
+}
+
+} // namespace
+
+TEST_CASE("Network sender drains priority frames before traffic") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  udp::NetworkSender sender(broadcaster);
+  gdl90::FrameArena traffic;
+  FillArena(&traffic, 3, 0x14);
+  ASSERT_EQ(static_cast<size_t>(3),
+            sender.enqueueTraffic(traffic, udp::ALL_DESTINATIONS));
+
+  const uint8_t heartbeat[] = {0x7E, 0x00, 0x7E};
+  ASSERT_TRUE(sender.enqueue(heartbeat, sizeof(heartbeat),
+                             udp::ALL_DESTINATIONS, true));
+  ASSERT_EQ(static_cast<size_t>(1), sender.stats().priority_queued);
+  ASSERT_EQ(static_cast<size_t>(3), sender.stats().traffic_queued);
+
+  ASSERT_EQ(static_cast<size_t>(4), sender.drain());
+  ASSERT_EQ(static_cast<size_t>(4), ops.sent_datagrams.size());
+  ASSERT_EQ(static_cast<uint8_t>(0x00), ops.sent_datagrams[0][1]);
+  ASSERT_EQ(static_cast<uint8_t>(0x14), ops.sent_datagrams[1][1]);
+  ASSERT_EQ(1, ops.send_batch_calls);
+  ASSERT_EQ(static_cast<size_t>(0), sender.drain());
+
+  const udp::NetworkSenderStats stats = sender.stats();
+  ASSERT_EQ(static_cast<uint64_t>(4), stats.frames_sent);
+  ASSERT_EQ(static_cast<size_t>(0), stats.traffic_queued);
+  ASSERT_EQ(static_cast<uint64_t>(4), stats.latency_samples);
+  ASSERT_TRUE(stats.latency_max_us >= stats.latency_last_us);
+  ASSERT_TRUE(stats.averageLatencyUs() >= 0.0);
+}
+
+TEST_CASE("Network sender queues a slice of a traffic tick") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  udp::NetworkSender sender(broadcaster);
+  gdl90::FrameArena traffic;
+  FillArena(&traffic, 5, 0x14);
+  ASSERT_EQ(static_cast<size_t>(2),
+            sender.enqueueTraffic(traffic, 1, 2, udp::ALL_DESTINATIONS));
+  // Ranges running past the arena are clipped.
+  ASSERT_EQ(static_cast<size_t>(1),
+            sender.enqueueTraffic(traffic, 4, 3, udp::ALL_DESTINATIONS));
+  ASSERT_EQ(static_cast<size_t>(0),
+            sender.enqueueTraffic(traffic, 5, 1, udp::ALL_DESTINATIONS));
+
+  ASSERT_EQ(static_cast<size_t>(3), sender.drain());
+  ASSERT_EQ(static_cast<size_t>(3), ops.sent_datagrams.size());
+  ASSERT_EQ(static_cast<uint8_t>(1), ops.sent_datagrams[0][2]);
+  ASSERT_EQ(static_cast<uint8_t>(2), ops.sent_datagrams[1][2]);
+  ASSERT_EQ(static_cast<uint8_t>(4), ops.sent_datagrams[2][2]);
+}
+
+TEST_CASE("Network sender drops oldest traffic when the ring overflows") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  udp::NetworkSender sender(broadcaster,
+                            udp::OverflowPolicy::DROP_OLDEST_TRAFFIC, 4, 8);
+  gdl90::FrameArena traffic;
+  FillArena(&traffic, 6, 0x01);
+  ASSERT_EQ(static_cast<size_t>(6),
+            sender.enqueueTraffic(traffic, udp::ALL_DESTINATIONS));
+  FillArena(&traffic, 6, 0x02);
+  // The six stale frames make way for the whole new tick: two slots now,
+  // the rest once drain() has released the stale ones.
+  ASSERT_EQ(static_cast<size_t>(6),
+            sender.enqueueTraffic(traffic, udp::ALL_DESTINATIONS));
+
+  ASSERT_EQ(static_cast<size_t>(2), sender.drain());
+  sender.notify();
+  ASSERT_EQ(static_cast<size_t>(4), sender.drain());
+  ASSERT_EQ(static_cast<size_t>(6), ops.sent_datagrams.size());
+  for (const std::vector<uint8_t> &datagram : ops.sent_datagrams) {
+    ASSERT_EQ(static_cast<uint8_t>(0x02), datagram[1]);
+  }
+  udp::NetworkSenderStats stats = sender.stats();
+  ASSERT_EQ(static_cast<uint64_t>(6), stats.traffic_dropped_oldest);
+  ASSERT_EQ(static_cast<uint64_t>(0), stats.traffic_dropped_newest);
+
+  // A tick larger than the whole ring still loses its newest frames.
+  FillArena(&traffic, 10, 0x03);
+  ASSERT_EQ(static_cast<size_t>(8),
+            sender.enqueueTraffic(traffic, udp::ALL_DESTINATIONS));
+  ASSERT_EQ(static_cast<size_t>(8), sender.drain());
+  ASSERT_EQ(static_cast<uint64_t>(2), sender.stats().traffic_dropped_newest);
+
+  // A newer tick supersedes frames still waiting to be queued.
+  FillArena(&traffic, 6, 0x04);
+  sender.enqueueTraffic(traffic, udp::ALL_DESTINATIONS);
+  FillArena(&traffic, 6, 0x05);
+  ASSERT_EQ(static_cast<size_t>(6),
+            sender.enqueueTraffic(traffic, udp::ALL_DESTINATIONS));
+  FillArena(&traffic, 1, 0x06);
+  ASSERT_EQ(static_cast<size_t>(1),
+            sender.enqueueTraffic(traffic, udp::ALL_DESTINATIONS));
+  ASSERT_EQ(static_cast<size_t>(0), sender.drain());
+  sender.notify();
+  ASSERT_EQ(static_cast<size_t>(1), sender.drain());
+  ASSERT_EQ(static_cast<uint8_t>(0x06), ops.sent_datagrams.back()[1]);
+  // All of 0x04 and 0x05 were superseded.
+  ASSERT_EQ(static_cast<uint64_t>(18), sender.stats().traffic_dropped_oldest);
+}
+
+TEST_CASE("Network sender overflow does not wait on a blocked send") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  std::atomic<bool> sending{false};
+  std::atomic<bool> unblock{false};
+  ops.on_sendto = [&] {
+    sending.store(true);
+    while (!unblock.load()) {
+      std::this_thread::yield();
+    }
+  };
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  udp::NetworkSender sender(broadcaster,
+                            udp::OverflowPolicy::DROP_OLDEST_TRAFFIC, 4, 8);
+  ASSERT_TRUE(sender.start());
+  gdl90::FrameArena traffic;
+  FillArena(&traffic, 6, 0x01);
+  sender.enqueueTraffic(traffic, udp::ALL_DESTINATIONS);
+  sender.notify();
+  while (!sending.load()) {
+    std::this_thread::yield();
+  }
+
+  // The drain is stuck in a send holding the ring full; the next tick must
+  // still be accepted without waiting for it.
+  std::atomic<bool> returned{false};
+  std::thread watchdog([&] {
+    for (int i = 0; i < 2000 && !returned.load(); ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    unblock.store(true);
+  });
+  FillArena(&traffic, 6, 0x02);
+  ASSERT_EQ(static_cast<size_t>(6),
+            sender.enqueueTraffic(traffic, udp::ALL_DESTINATIONS));
+  const bool returned_while_blocked = !unblock.load();
+  returned.store(true);
+  watchdog.join();
+  ASSERT_TRUE(returned_while_blocked);
+
+  while (sender.stats().traffic_queued > 0) {
+    std::this_thread::yield();
+  }
+  sender.notify();
+  sender.stop();
+  const udp::NetworkSenderStats stats = sender.stats();
+  ASSERT_EQ(static_cast<uint64_t>(12), stats.frames_sent);
+  ASSERT_EQ(static_cast<uint64_t>(0), stats.traffic_dropped_newest);
+}
+
+TEST_CASE("Network sender keeps queued traffic under drop-newest policy") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  udp::NetworkSender sender(broadcaster,
+                            udp::OverflowPolicy::DROP_OLDEST_TRAFFIC, 2, 4);
+  sender.setOverflowPolicy(udp::OverflowPolicy::DROP_NEWEST_TRAFFIC);
+  gdl90::FrameArena traffic;
+  FillArena(&traffic, 3, 0x01);
+  ASSERT_EQ(static_cast<size_t>(3),
+            sender.enqueueTraffic(traffic, udp::ALL_DESTINATIONS));
+  FillArena(&traffic, 3, 0x02);
+  ASSERT_EQ(static_cast<size_t>(1),
+            sender.enqueueTraffic(traffic, udp::ALL_DESTINATIONS));
+  gdl90::FrameArena empty;
+  ASSERT_EQ(static_cast<size_t>(0),
+            sender.enqueueTraffic(empty, udp::ALL_DESTINATIONS));
+
+  ASSERT_EQ(static_cast<size_t>(4), sender.drain());
+  ASSERT_EQ(static_cast<uint8_t>(0x01), ops.sent_datagrams[0][1]);
+  ASSERT_EQ(static_cast<uint64_t>(2), sender.stats().traffic_dropped_newest);
+
+  // Priority frames are never dropped by policy, only when the ring is full.
+  const uint8_t frame[] = {0x7E, 0x0A, 0x7E};
+  ASSERT_TRUE(sender.enqueue(frame, sizeof(frame), udp::ALL_DESTINATIONS));
+  ASSERT_TRUE(sender.enqueue(frame, sizeof(frame), udp::ALL_DESTINATIONS));
+  ASSERT_TRUE(!sender.enqueue(frame, sizeof(frame), udp::ALL_DESTINATIONS));
+  ASSERT_EQ(static_cast<uint64_t>(1), sender.stats().priority_overflows);
+}
+
+TEST_CASE("Network sender packs frames and reports send errors") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  udp::NetworkSender sender(broadcaster);
+  sender.setPacking(true, 1400);
+  const uint8_t frame[] = {0x7E, 0x0A, 0x7E};
+  ASSERT_TRUE(sender.enqueue(frame, sizeof(frame), udp::ALL_DESTINATIONS));
+  gdl90::FrameArena traffic;
+  FillArena(&traffic, 2, 0x14);
+  sender.enqueueTraffic(traffic, udp::ALL_DESTINATIONS);
+  ASSERT_EQ(static_cast<size_t>(3), sender.drain());
+  ASSERT_EQ(static_cast<size_t>(1), ops.sent_datagrams.size());
+  ASSERT_EQ(static_cast<size_t>(11), ops.sent_datagrams[0].size());
+
+  ops.sendto_result = -1;
+  ops.last_error_value = ENETUNREACH;
+  ASSERT_TRUE(sender.enqueue(frame, sizeof(frame), udp::ALL_DESTINATIONS));
+  sender.drain();
+  ASSERT_EQ(static_cast<uint64_t>(1), sender.stats().send_errors);
+  ASSERT_TRUE(sender.lastError().find("sendto failed") != std::string::npos);
+
+  sender.setPacking(false, 1400);
+  FillArena(&traffic, 2, 0x14);
+  sender.enqueueTraffic(traffic, udp::ALL_DESTINATIONS);
+  ASSERT_EQ(static_cast<size_t>(0), sender.drain());
+  ASSERT_EQ(static_cast<uint64_t>(3), sender.stats().send_errors);
+}
+
+TEST_CASE("Network sender thread sends queued frames and stops cleanly") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  udp::NetworkSender sender(broadcaster);
+  ASSERT_TRUE(sender.start());
+  ASSERT_TRUE(sender.start());
+  ASSERT_TRUE(sender.isRunning());
+
+  const uint8_t frame[] = {0x7E, 0x00, 0x7E};
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(sender.enqueue(frame, sizeof(frame), udp::ALL_DESTINATIONS));
+    sender.notify();
+  }
+  for (int i = 0; i < 200 && sender.stats().frames_sent < 10; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  sender.withBroadcaster([](udp::UDPBroadcaster &locked) {
+    locked.setTarget("127.0.0.2", 4001);
+  });
+  sender.stop();
+  ASSERT_TRUE(!sender.isRunning());
+  sender.stop();
+
+  ASSERT_EQ(static_cast<uint64_t>(10), sender.stats().frames_sent);
+  ASSERT_EQ(std::string("127.0.0.2"), broadcaster.getTargetIp());
+}
+
+TEST_CASE("Network sender thread measures its wake-up latency") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  udp::NetworkSender sender(broadcaster);
+  sender.setThreadTuning(xp2gdl90::ThreadTuning{});
+  ASSERT_TRUE(sender.start());
+  const uint8_t frame[] = {0x7E, 0x00, 0x7E};
+  // A handoff the thread drains before the notify is not counted, so a few
+  // rounds may be needed.
+  uint64_t sent = 0;
+  for (int round = 0;
+       round < 50 && sender.stats().wake_latency.samples == 0; ++round) {
+    ASSERT_TRUE(sender.enqueue(frame, sizeof(frame), udp::ALL_DESTINATIONS));
+    sender.notify();
+    ++sent;
+    for (int i = 0; i < 200 && sender.stats().frames_sent < sent; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  sender.stop();
+
+  const xp2gdl90::WakeLatencyStats wake = sender.stats().wake_latency;
+  ASSERT_TRUE(wake.samples > 0);
+  ASSERT_TRUE(wake.max_us >= wake.last_us);
+  ASSERT_TRUE(sender.threadTuningError().empty());
+}
@@ -0,0 +1,197 @@
+#include "test_harness.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "xp2gdl90/output_scheduler.h"
+
+namespace {
+
+using xp2gdl90::OutputScheduler;
+using xp2gdl90::SendClass;
+
+// Runs one tick, charging each send `bytes` and `cost_s` of monotonic time.
+std::vector<SendClass> RunTick(OutputScheduler *scheduler, double now,
+                               size_t bytes = 10, double cost_s = 0.0) {
+  std::vector<SendClass> sent;
+  double monotonic = now;
+  scheduler->beginTick(now, monotonic);
+  SendClass send_class = SendClass::HEARTBEAT;
+  while (scheduler->next(monotonic, &send_class)) {
+    monotonic += cost_s;
+    scheduler->complete(send_class, bytes, monotonic);
+    sent.push_back(send_class);
+  }
+  return sent;
+}
+
+} // namespace
+
+TEST_CASE("Output scheduler sends due classes earliest deadline first") {
+  OutputScheduler scheduler;
+  scheduler.configure(SendClass::HEARTBEAT, 1.0);
+  scheduler.configure(SendClass::AHRS, 0.2);
+  scheduler.configure(SendClass::DEVICE_INFO, 1.0);
+  scheduler.configure(SendClass::TRAFFIC, 0.0);
+  scheduler.restart(10.0);
+
+  const std::vector<SendClass> first = RunTick(&scheduler, 10.0);
+  ASSERT_EQ(static_cast<size_t>(3), first.size());
+  // AHRS has the nearest deadline; equal deadlines go by priority.
+  ASSERT_TRUE(first[0] == SendClass::AHRS);
+  ASSERT_TRUE(first[1] == SendClass::HEARTBEAT);
+  ASSERT_TRUE(first[2] == SendClass::DEVICE_INFO);
+  ASSERT_TRUE(!scheduler.due(SendClass::TRAFFIC));
+  ASSERT_TRUE(std::fabs(scheduler.nextRelease() - 10.2) < 1e-9);
+  // A class that is switched on is due right away.
+  scheduler.configure(SendClass::TRAFFIC, 1.0);
+  ASSERT_TRUE(scheduler.due(SendClass::TRAFFIC));
+  scheduler.configure(SendClass::TRAFFIC, 0.0);
+
+  // Releases stay on the period grid despite a late tick.
+  ASSERT_EQ(static_cast<size_t>(1), RunTick(&scheduler, 10.25).size());
+  ASSERT_TRUE(std::fabs(scheduler.release(SendClass::AHRS) - 10.4) < 1e-9);
+  ASSERT_EQ(static_cast<uint64_t>(2),
+            scheduler.stats(SendClass::AHRS).sent);
+  ASSERT_EQ(static_cast<uint64_t>(0),
+            scheduler.stats(SendClass::AHRS).deadline_misses);
+}
+
+TEST_CASE("Output scheduler counts late sends as deadline misses") {
+  OutputScheduler scheduler;
+  scheduler.configure(SendClass::OWNSHIP, 0.5);
+  scheduler.restart(0.0);
+  RunTick(&scheduler, 0.0);
+  // Released at 0.5 with its deadline at 1.0; a stalled tick sends it late
+  // and starts a new grid.
+  ASSERT_EQ(static_cast<size_t>(1), RunTick(&scheduler, 1.7).size());
+  const xp2gdl90::OutputClassStats &stats =
+      scheduler.stats(SendClass::OWNSHIP);
+  ASSERT_EQ(static_cast<uint64_t>(1), stats.deadline_misses);
+  ASSERT_EQ(static_cast<uint64_t>(0), stats.dropped);
+  ASSERT_TRUE(std::fabs(stats.max_lateness_s - 1.2) < 1e-9);
+  ASSERT_TRUE(std::fabs(scheduler.release(SendClass::OWNSHIP) - 2.2) < 1e-9);
+}
+
+TEST_CASE("Output scheduler defers low priority work over the byte budget") {
+  OutputScheduler scheduler;
+  scheduler.configure(SendClass::HEARTBEAT, 1.0);
+  scheduler.configure(SendClass::OWNSHIP, 1.0);
+  scheduler.configure(SendClass::TRAFFIC, 1.0);
+  scheduler.configure(SendClass::DEVICE_INFO, 1.0);
+  xp2gdl90::OutputBudget budget;
+  budget.max_tick_bytes = 25;
+  scheduler.setBudget(budget);
+  scheduler.restart(0.0);
+
+  // Without cost estimates the first tick admits everything and the byte
+  // check stops it once the budget is spent.
+  const std::vector<SendClass> first = RunTick(&scheduler, 0.0);
+  ASSERT_EQ(static_cast<size_t>(3), first.size());
+  ASSERT_TRUE(first[2] == SendClass::TRAFFIC);
+  ASSERT_EQ(static_cast<uint64_t>(1),
+            scheduler.stats(SendClass::DEVICE_INFO).deferred);
+  ASSERT_EQ(static_cast<uint64_t>(1), scheduler.overBudgetTicks());
+
+  // Deferred work goes out on the next tick while its deadline holds.
+  const std::vector<SendClass> retry = RunTick(&scheduler, 0.1);
+  ASSERT_EQ(static_cast<size_t>(1), retry.size());
+  ASSERT_TRUE(retry[0] == SendClass::DEVICE_INFO);
+
+  // Now every class has a cost estimate, so admission keeps the two
+  // highest priorities and defers the rest up front.
+  const std::vector<SendClass> loaded = RunTick(&scheduler, 1.0);
+  ASSERT_EQ(static_cast<size_t>(2), loaded.size());
+  ASSERT_TRUE(loaded[0] == SendClass::HEARTBEAT);
+  ASSERT_TRUE(loaded[1] == SendClass::OWNSHIP);
+  ASSERT_TRUE(scheduler.due(SendClass::TRAFFIC));
+  ASSERT_TRUE(scheduler.due(SendClass::DEVICE_INFO));
+}
+
+TEST_CASE("Output scheduler drops deferred work past its deadline") {
+  OutputScheduler scheduler;
+  scheduler.configure(SendClass::HEARTBEAT, 1.0);
+  scheduler.configure(SendClass::DEVICE_INFO, 1.0);
+  xp2gdl90::OutputBudget budget;
+  budget.max_tick_s = 0.005;
+  scheduler.setBudget(budget);
+  scheduler.restart(0.0);
+
+  // The heartbeat alone spends the time budget, but always goes out.
+  ASSERT_EQ(static_cast<size_t>(1), RunTick(&scheduler, 0.0, 10, 0.01).size());
+  ASSERT_EQ(static_cast<size_t>(1), RunTick(&scheduler, 1.0, 10, 0.01).size());
+  ASSERT_EQ(static_cast<uint64_t>(2),
+            scheduler.stats(SendClass::HEARTBEAT).sent);
+  ASSERT_EQ(static_cast<uint64_t>(0),
+            scheduler.stats(SendClass::HEARTBEAT).deadline_misses);
+
+  const xp2gdl90::OutputClassStats &info =
+      scheduler.stats(SendClass::DEVICE_INFO);
+  ASSERT_EQ(static_cast<uint64_t>(0), info.sent);
+  ASSERT_EQ(static_cast<uint64_t>(2), info.deferred);
+  // The release at 0 expired at 1.0; the one at 1.0 is still owed.
+  ASSERT_EQ(static_cast<uint64_t>(1), info.dropped);
+  ASSERT_EQ(static_cast<uint64_t>(1), info.deadline_misses);
+  ASSERT_TRUE(std::fabs(scheduler.release(SendClass::DEVICE_INFO) - 1.0) <
+              1e-9);
+
+  scheduler.setBudget(xp2gdl90::OutputBudget{});
+  ASSERT_EQ(static_cast<size_t>(1), RunTick(&scheduler, 1.5).size());
+  ASSERT_EQ(static_cast<uint64_t>(1), info.sent);
+
+  scheduler.resetStats();
+  ASSERT_EQ(static_cast<uint64_t>(0), info.sent);
+  ASSERT_EQ(static_cast<uint64_t>(0), scheduler.ticks());
+}
+
+TEST_CASE("Output scheduler priorities follow the message classes") {
+  using xp2gdl90::SendClassPriority;
+  ASSERT_TRUE(SendClassPriority(SendClass::HEARTBEAT) <
+              SendClassPriority(SendClass::OWNSHIP));
+  ASSERT_EQ(SendClassPriority(SendClass::OWNSHIP),
+            SendClassPriority(SendClass::GEO_ALTITUDE));
+  ASSERT_TRUE(SendClassPriority(SendClass::OWNSHIP) <
+              SendClassPriority(SendClass::AHRS));
+  ASSERT_TRUE(SendClassPriority(SendClass::AHRS) <
+              SendClassPriority(SendClass::TRAFFIC));
+  ASSERT_TRUE(SendClassPriority(SendClass::TRAFFIC) <
+              SendClassPriority(SendClass::DEVICE_INFO));
+  ASSERT_TRUE(std::isnan(OutputScheduler().nextRelease()));
+}
+
+TEST_CASE("Output scheduler centres high-rate sends on their releases") {
+  ASSERT_EQ(0.05, xp2gdl90::PeriodForRate(20.0));
+  ASSERT_EQ(0.0, xp2gdl90::PeriodForRate(0.0));
+  OutputScheduler scheduler;
+  scheduler.configure(SendClass::AHRS, xp2gdl90::PeriodForRate(20.0));
+  scheduler.configure(SendClass::HEARTBEAT, 1.0);
+  scheduler.restart(0.0);
+  ASSERT_EQ(static_cast<size_t>(2), RunTick(&scheduler, 0.0).size());
+
+  // Without a tick interval a class waits for its release.
+  ASSERT_TRUE(RunTick(&scheduler, 0.044).empty());
+  ASSERT_TRUE(std::fabs(scheduler.nextRelease() - 0.05) < 1e-9);
+
+  // With ticks 22 ms apart AHRS goes out on the tick nearest its release,
+  // 6 ms early here, while the heartbeat still waits for its own.
+  scheduler.setTickInterval(0.022);
+  ASSERT_TRUE(std::fabs(scheduler.nextRelease() - 0.039) < 1e-9);
+  std::vector<SendClass> sent = RunTick(&scheduler, 0.044);
+  ASSERT_EQ(static_cast<size_t>(1), sent.size());
+  ASSERT_TRUE(sent[0] == SendClass::AHRS);
+  // The release stays on the grid, and the next send is the tick 10 ms
+  // after it rather than the one 12 ms before.
+  ASSERT_TRUE(std::fabs(scheduler.release(SendClass::AHRS) - 0.1) < 1e-9);
+  ASSERT_TRUE(RunTick(&scheduler, 0.066).empty());
+  ASSERT_TRUE(RunTick(&scheduler, 0.088).empty());
+  ASSERT_EQ(static_cast<size_t>(1), RunTick(&scheduler, 0.110).size());
+  ASSERT_EQ(static_cast<uint64_t>(0),
+            scheduler.stats(SendClass::AHRS).deadline_misses);
+
+  // The lead is at most a quarter period, and slower classes get none.
+  scheduler.setTickInterval(1.0);
+  ASSERT_TRUE(std::fabs(scheduler.nextRelease() - 0.1375) < 1e-9);
+  scheduler.configure(SendClass::AHRS, 0.0);
+  ASSERT_TRUE(std::fabs(scheduler.nextRelease() - 1.0) < 1e-9);
+}
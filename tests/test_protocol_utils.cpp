@@ -18,6 +18,16 @@ TEST_CASE("SanitizeCallsign trims trailing spaces and allows empty fallback") {
   ASSERT_EQ(std::string(""), xp2gdl90::protocol::SanitizeCallsign("!!!"));
 }
 
+TEST_CASE("MakeCallsign sanitizes inline like SanitizeCallsign") {
+  const gdl90::Callsign callsign =
+      xp2gdl90::protocol::MakeCallsign("n1-2_3!ab cdef");
+  ASSERT_EQ(std::string("N1 2 3AB"), callsign.str());
+  ASSERT_EQ(static_cast<size_t>(8), callsign.size());
+  ASSERT_TRUE(xp2gdl90::protocol::MakeCallsign("AB  ") ==
+              gdl90::Callsign("AB"));
+  ASSERT_TRUE(xp2gdl90::protocol::MakeCallsign("??").empty());
+}
+
 TEST_CASE("IPv4 validator accepts dotted-quad addresses only") {
   ASSERT_TRUE(xp2gdl90::protocol::IsValidIpv4Address("127.0.0.1"));
   ASSERT_TRUE(xp2gdl90::protocol::IsValidIpv4Address("255.255.255.255"));
@@ -32,6 +42,16 @@ TEST_CASE("IPv4 validator accepts dotted-quad addresses only") {
   ASSERT_TRUE(!xp2gdl90::protocol::IsValidIpv4Address("1.2.3.4 "));
 }
 
+TEST_CASE("Multicast check accepts 224.0.0.0/4 addresses only") {
+  ASSERT_TRUE(xp2gdl90::protocol::IsMulticastIpv4Address("224.0.0.1"));
+  ASSERT_TRUE(xp2gdl90::protocol::IsMulticastIpv4Address("239.255.40.1"));
+
+  ASSERT_TRUE(!xp2gdl90::protocol::IsMulticastIpv4Address("223.255.255.255"));
+  ASSERT_TRUE(!xp2gdl90::protocol::IsMulticastIpv4Address("240.0.0.1"));
+  ASSERT_TRUE(!xp2gdl90::protocol::IsMulticastIpv4Address("255.255.255.255"));
+  ASSERT_TRUE(!xp2gdl90::protocol::IsMulticastIpv4Address("239.1.1"));
+}
+
 TEST_CASE("Protocol field validators enforce published ranges") {
   ASSERT_TRUE(xp2gdl90::protocol::IsValidNic(11));
   ASSERT_TRUE(!xp2gdl90::protocol::IsValidNic(12));
@@ -38,6 +38,18 @@ TEST_CASE("Settings save and load round-trip through JSON") {
   saved.target_port = 4567;
   saved.foreflight_auto_discovery = false;
   saved.foreflight_broadcast_port = 63094;
+  saved.multicast_ttl = 4;
+  saved.multicast_interface = "10.0.0.2";
+  saved.multicast_loopback = true;
+  saved.socket_dscp = 46;
+  saved.socket_send_buffer_bytes = 262144u;
+  saved.socket_bind_ip = "10.0.0.3";
+  saved.datagram_packing = true;
+  saved.datagram_max_bytes = 1200;
+  saved.sender_thread = true;
+  saved.sender_overflow_policy = 1;
+  saved.worker_thread_priority = 2;
+  saved.worker_cpu_mask = 0x8000000Cu;
   saved.icao_address = 0x102030;
   saved.callsign = "N123TEST";
   saved.emitter_category = 7;
@@ -48,12 +60,47 @@ TEST_CASE("Settings save and load round-trip through JSON") {
   saved.traffic_enabled = false;
   saved.heartbeat_rate = 3.5f;
   saved.position_rate = 1.25f;
+  saved.ownship_high_rate = true;
   saved.traffic_rate = 2.0f;
+  saved.ahrs_rate = 15.0f;
+  saved.geo_altitude_rate = 0.0f;
+  saved.device_info_rate = 0.5f;
   saved.traffic_max_targets = 17;
+  saved.traffic_position_mode = 1;
+  saved.traffic_projection_radius_nm = 15.5f;
+  saved.traffic_range_nm = 30.0f;
+  saved.traffic_altitude_band_ft = 4500.0f;
+  saved.traffic_closure_lookahead_s = 45.0f;
+  saved.traffic_spatial_index = true;
+  saved.traffic_scan_radius_nm = 30.0f;
+  saved.traffic_scan_interval_s = 12.0f;
+  saved.traffic_build_threads = 3;
+  saved.traffic_adaptive_rate = true;
+  saved.traffic_max_frames_per_second = 40.0f;
+  saved.traffic_pacing = true;
+  saved.traffic_thread = true;
+  saved.traffic_smoothing = true;
+  saved.traffic_relay = true;
+  saved.traffic_relay_port = 4100;
+  saved.traffic_relay_priority = 1;
+  saved.extrapolation_horizon_s = 1.5f;
+  saved.output_budget_ms = 2.5f;
+  saved.output_budget_bytes = 1500u;
+  saved.bandwidth_limit_bytes_per_s = 20000u;
   saved.nic = 10;
   saved.nacp = 9;
   saved.debug_logging = true;
   saved.log_messages = true;
+  saved.stream_capture = true;
+  saved.stream_capture_mb = 64u;
+  saved.stream_capture_compact = true;
+  saved.shared_output = true;
+  saved.link_probe = true;
+  saved.sim_recording = true;
+  saved.metrics_enabled = true;
+  saved.metrics_ip = "10.0.0.9";
+  saved.metrics_port = 9100;
+  saved.metrics_interval_s = 15.0f;
 
   std::string error;
   ASSERT_TRUE(xp2gdl90::SaveSettingsToJsonFile(path.string(), saved, &error));
@@ -68,6 +115,18 @@ TEST_CASE("Settings save and load round-trip through JSON") {
   ASSERT_EQ(saved.target_port, loaded.target_port);
   ASSERT_EQ(saved.foreflight_auto_discovery, loaded.foreflight_auto_discovery);
   ASSERT_EQ(saved.foreflight_broadcast_port, loaded.foreflight_broadcast_port);
+  ASSERT_EQ(saved.multicast_ttl, loaded.multicast_ttl);
+  ASSERT_EQ(saved.multicast_interface, loaded.multicast_interface);
+  ASSERT_EQ(saved.multicast_loopback, loaded.multicast_loopback);
+  ASSERT_EQ(saved.socket_dscp, loaded.socket_dscp);
+  ASSERT_EQ(saved.socket_send_buffer_bytes, loaded.socket_send_buffer_bytes);
+  ASSERT_EQ(saved.socket_bind_ip, loaded.socket_bind_ip);
+  ASSERT_EQ(saved.datagram_packing, loaded.datagram_packing);
+  ASSERT_EQ(saved.datagram_max_bytes, loaded.datagram_max_bytes);
+  ASSERT_EQ(saved.sender_thread, loaded.sender_thread);
+  ASSERT_EQ(saved.sender_overflow_policy, loaded.sender_overflow_policy);
+  ASSERT_EQ(saved.worker_thread_priority, loaded.worker_thread_priority);
+  ASSERT_EQ(saved.worker_cpu_mask, loaded.worker_cpu_mask);
   ASSERT_EQ(saved.icao_address, loaded.icao_address);
   ASSERT_EQ(saved.callsign, loaded.callsign);
   ASSERT_EQ(saved.emitter_category, loaded.emitter_category);
@@ -79,11 +138,50 @@ TEST_CASE("Settings save and load round-trip through JSON") {
   ASSERT_EQ(saved.heartbeat_rate, loaded.heartbeat_rate);
   ASSERT_EQ(saved.position_rate, loaded.position_rate);
   ASSERT_EQ(saved.traffic_rate, loaded.traffic_rate);
+  ASSERT_EQ(saved.ownship_high_rate, loaded.ownship_high_rate);
+  ASSERT_EQ(saved.ahrs_rate, loaded.ahrs_rate);
+  ASSERT_EQ(saved.geo_altitude_rate, loaded.geo_altitude_rate);
+  ASSERT_EQ(saved.device_info_rate, loaded.device_info_rate);
   ASSERT_EQ(saved.traffic_max_targets, loaded.traffic_max_targets);
+  ASSERT_EQ(saved.traffic_position_mode, loaded.traffic_position_mode);
+  ASSERT_EQ(saved.traffic_projection_radius_nm,
+            loaded.traffic_projection_radius_nm);
+  ASSERT_EQ(saved.traffic_range_nm, loaded.traffic_range_nm);
+  ASSERT_EQ(saved.traffic_altitude_band_ft, loaded.traffic_altitude_band_ft);
+  ASSERT_EQ(saved.traffic_closure_lookahead_s,
+            loaded.traffic_closure_lookahead_s);
+  ASSERT_EQ(saved.traffic_spatial_index, loaded.traffic_spatial_index);
+  ASSERT_EQ(saved.traffic_scan_radius_nm, loaded.traffic_scan_radius_nm);
+  ASSERT_EQ(saved.traffic_scan_interval_s, loaded.traffic_scan_interval_s);
+  ASSERT_EQ(saved.traffic_build_threads, loaded.traffic_build_threads);
+  ASSERT_EQ(saved.traffic_adaptive_rate, loaded.traffic_adaptive_rate);
+  ASSERT_EQ(saved.traffic_max_frames_per_second,
+            loaded.traffic_max_frames_per_second);
+  ASSERT_EQ(saved.traffic_pacing, loaded.traffic_pacing);
+  ASSERT_EQ(saved.traffic_thread, loaded.traffic_thread);
+  ASSERT_EQ(saved.traffic_smoothing, loaded.traffic_smoothing);
+  ASSERT_EQ(saved.traffic_relay, loaded.traffic_relay);
+  ASSERT_EQ(saved.traffic_relay_port, loaded.traffic_relay_port);
+  ASSERT_EQ(saved.traffic_relay_priority, loaded.traffic_relay_priority);
+  ASSERT_EQ(saved.extrapolation_horizon_s, loaded.extrapolation_horizon_s);
+  ASSERT_EQ(saved.output_budget_ms, loaded.output_budget_ms);
+  ASSERT_EQ(saved.output_budget_bytes, loaded.output_budget_bytes);
+  ASSERT_EQ(saved.bandwidth_limit_bytes_per_s,
+            loaded.bandwidth_limit_bytes_per_s);
   ASSERT_EQ(saved.nic, loaded.nic);
   ASSERT_EQ(saved.nacp, loaded.nacp);
   ASSERT_EQ(saved.debug_logging, loaded.debug_logging);
   ASSERT_EQ(saved.log_messages, loaded.log_messages);
+  ASSERT_EQ(saved.stream_capture, loaded.stream_capture);
+  ASSERT_EQ(saved.stream_capture_mb, loaded.stream_capture_mb);
+  ASSERT_EQ(saved.stream_capture_compact, loaded.stream_capture_compact);
+  ASSERT_EQ(saved.shared_output, loaded.shared_output);
+  ASSERT_EQ(saved.link_probe, loaded.link_probe);
+  ASSERT_EQ(saved.sim_recording, loaded.sim_recording);
+  ASSERT_EQ(saved.metrics_enabled, loaded.metrics_enabled);
+  ASSERT_EQ(saved.metrics_ip, loaded.metrics_ip);
+  ASSERT_EQ(saved.metrics_port, loaded.metrics_port);
+  ASSERT_EQ(saved.metrics_interval_s, loaded.metrics_interval_s);
 }
 
 TEST_CASE("Settings save and load validate output object and file presence") {
@@ -109,12 +207,50 @@ TEST_CASE("Settings loader ignores invalid values and unknown keys") {
        << "  \"target_ip\": \"999.168.0.10\",\n"
        << "  \"target_port\": 70000,\n"
        << "  \"emitter_category\": 99,\n"
+       << "  \"multicast_ttl\": 0,\n"
+       << "  \"multicast_interface\": \"eth0\",\n"
+       << "  \"multicast_loopback\": 1,\n"
+       << "  \"socket_dscp\": 64,\n"
+       << "  \"socket_send_buffer_bytes\": 20000000,\n"
+       << "  \"socket_bind_ip\": \"wlan0\",\n"
        << "  \"traffic_enabled\": \"yes\",\n"
        << "  \"traffic_rate\": 0,\n"
+       << "  \"ahrs_rate\": 21,\n"
+       << "  \"geo_altitude_rate\": -1,\n"
+       << "  \"device_info_rate\": \"1\",\n"
        << "  \"traffic_max_targets\": 64,\n"
+       << "  \"datagram_max_bytes\": 64,\n"
+       << "  \"sender_overflow_policy\": 2,\n"
+       << "  \"worker_thread_priority\": 3,\n"
+       << "  \"worker_cpu_mask\": -1,\n"
+       << "  \"traffic_position_mode\": 2,\n"
+       << "  \"traffic_projection_radius_nm\": 41,\n"
+       << "  \"traffic_range_nm\": -1,\n"
+       << "  \"traffic_altitude_band_ft\": 60001,\n"
+       << "  \"traffic_closure_lookahead_s\": 601,\n"
+       << "  \"traffic_spatial_index\": 1,\n"
+       << "  \"traffic_scan_radius_nm\": 109,\n"
+       << "  \"traffic_scan_interval_s\": 0.5,\n"
+       << "  \"traffic_build_threads\": 9,\n"
+       << "  \"traffic_adaptive_rate\": \"on\",\n"
+       << "  \"traffic_max_frames_per_second\": 1001,\n"
+       << "  \"traffic_pacing\": \"on\",\n"
+       << "  \"traffic_relay_port\": 0,\n"
+       << "  \"traffic_relay_priority\": 2,\n"
+       << "  \"extrapolation_horizon_s\": 11,\n"
+       << "  \"output_budget_ms\": 101,\n"
+       << "  \"output_budget_bytes\": 70000,\n"
+       << "  \"bandwidth_limit_bytes_per_s\": 13000000,\n"
        << "  \"nic\": 12,\n"
        << "  \"nacp\": 15,\n"
        << "  \"debug_logging\": true,\n"
+       << "  \"stream_capture\": 1,\n"
+       << "  \"stream_capture_mb\": 0,\n"
+       << "  \"stream_capture_compact\": \"yes\",\n"
+       << "  \"shared_output\": \"on\",\n"
+       << "  \"sim_recording\": \"yes\",\n"
+       << "  \"metrics_ip\": \"collector.local\",\n"
+       << "  \"metrics_interval_s\": 0.1,\n"
        << "  \"unknown_object\": {\"nested\": true},\n"
        << "  \"unknown_array\": [1, 2, 3]\n"
        << "}\n";
@@ -138,12 +274,50 @@ TEST_CASE("Settings loader ignores invalid values and unknown keys") {
   ASSERT_EQ(std::string("192.168.0.20"), loaded.target_ip);
   ASSERT_EQ(static_cast<uint16_t>(4000), loaded.target_port);
   ASSERT_EQ(static_cast<uint8_t>(1), loaded.emitter_category);
+  ASSERT_EQ(static_cast<uint8_t>(1), loaded.multicast_ttl);
+  ASSERT_EQ(std::string(""), loaded.multicast_interface);
+  ASSERT_TRUE(!loaded.multicast_loopback);
+  ASSERT_EQ(static_cast<uint8_t>(0), loaded.socket_dscp);
+  ASSERT_EQ(0u, loaded.socket_send_buffer_bytes);
+  ASSERT_EQ(std::string(""), loaded.socket_bind_ip);
   ASSERT_TRUE(loaded.traffic_enabled);
   ASSERT_EQ(1.0f, loaded.traffic_rate);
+  ASSERT_EQ(5.0f, loaded.ahrs_rate);
+  ASSERT_EQ(1.0f, loaded.geo_altitude_rate);
+  ASSERT_EQ(1.0f, loaded.device_info_rate);
   ASSERT_EQ(static_cast<uint8_t>(63), loaded.traffic_max_targets);
+  ASSERT_EQ(static_cast<uint16_t>(1400), loaded.datagram_max_bytes);
+  ASSERT_EQ(static_cast<uint8_t>(0), loaded.sender_overflow_policy);
+  ASSERT_EQ(static_cast<uint8_t>(0), loaded.worker_thread_priority);
+  ASSERT_EQ(0u, loaded.worker_cpu_mask);
+  ASSERT_EQ(static_cast<uint8_t>(0), loaded.traffic_position_mode);
+  ASSERT_EQ(10.0f, loaded.traffic_projection_radius_nm);
+  ASSERT_EQ(0.0f, loaded.traffic_range_nm);
+  ASSERT_EQ(0.0f, loaded.traffic_altitude_band_ft);
+  ASSERT_EQ(0.0f, loaded.traffic_closure_lookahead_s);
+  ASSERT_TRUE(!loaded.traffic_spatial_index);
+  ASSERT_EQ(10.8f, loaded.traffic_scan_radius_nm);
+  ASSERT_EQ(5.0f, loaded.traffic_scan_interval_s);
+  ASSERT_EQ(0u, loaded.traffic_build_threads);
+  ASSERT_TRUE(!loaded.traffic_adaptive_rate);
+  ASSERT_EQ(0.0f, loaded.traffic_max_frames_per_second);
+  ASSERT_TRUE(!loaded.traffic_pacing);
+  ASSERT_EQ(4001u, loaded.traffic_relay_port);
+  ASSERT_EQ(0u, loaded.traffic_relay_priority);
+  ASSERT_EQ(0.0f, loaded.extrapolation_horizon_s);
+  ASSERT_EQ(0.0f, loaded.output_budget_ms);
+  ASSERT_EQ(0u, loaded.output_budget_bytes);
+  ASSERT_EQ(0u, loaded.bandwidth_limit_bytes_per_s);
   ASSERT_EQ(static_cast<uint8_t>(11), loaded.nic);
   ASSERT_EQ(static_cast<uint8_t>(11), loaded.nacp);
   ASSERT_TRUE(loaded.debug_logging);
+  ASSERT_TRUE(!loaded.stream_capture);
+  ASSERT_EQ(16u, loaded.stream_capture_mb);
+  ASSERT_TRUE(!loaded.stream_capture_compact);
+  ASSERT_TRUE(!loaded.shared_output);
+  ASSERT_TRUE(!loaded.sim_recording);
+  ASSERT_EQ(std::string("127.0.0.1"), loaded.metrics_ip);
+  ASSERT_EQ(5.0f, loaded.metrics_interval_s);
 }
 
 TEST_CASE(
@@ -167,10 +341,34 @@ TEST_CASE(
        << "  \"traffic_enabled\": false,\n"
        << "  \"traffic_rate\": 2.5,\n"
        << "  \"traffic_max_targets\": 31,\n"
+       << "  \"traffic_position_mode\": 1,\n"
+       << "  \"traffic_projection_radius_nm\": 5.0,\n"
+       << "  \"traffic_range_nm\": 25.0,\n"
+       << "  \"traffic_altitude_band_ft\": 3000,\n"
+       << "  \"traffic_closure_lookahead_s\": 60,\n"
+       << "  \"traffic_spatial_index\": true,\n"
+       << "  \"traffic_scan_radius_nm\": 50,\n"
+       << "  \"traffic_scan_interval_s\": 2,\n"
+       << "  \"traffic_build_threads\": 4,\n"
+       << "  \"traffic_adaptive_rate\": true,\n"
+       << "  \"traffic_max_frames_per_second\": 25,\n"
+       << "  \"traffic_pacing\": true,\n"
+       << "  \"extrapolation_horizon_s\": 2,\n"
+       << "  \"output_budget_ms\": 4,\n"
+       << "  \"output_budget_bytes\": 3000,\n"
+       << "  \"bandwidth_limit_bytes_per_s\": 50000,\n"
        << "  \"nic\": 10,\n"
        << "  \"nacp\": 9,\n"
        << "  \"ahrs_use_magnetic_heading\": true,\n"
-       << "  \"log_messages\": true\n"
+       << "  \"log_messages\": true,\n"
+       << "  \"stream_capture\": true,\n"
+       << "  \"stream_capture_mb\": 128,\n"
+       << "  \"stream_capture_compact\": true,\n"
+       << "  \"shared_output\": true,\n"
+       << "  \"link_probe\": true,\n"
+       << "  \"sim_recording\": true,\n"
+       << "  \"metrics_enabled\": true,\n"
+       << "  \"metrics_port\": 9200\n"
        << "}\n";
   file.close();
 
@@ -193,10 +391,34 @@ TEST_CASE(
   ASSERT_TRUE(!loaded.traffic_enabled);
   ASSERT_EQ(2.5f, loaded.traffic_rate);
   ASSERT_EQ(static_cast<uint8_t>(31), loaded.traffic_max_targets);
+  ASSERT_EQ(static_cast<uint8_t>(1), loaded.traffic_position_mode);
+  ASSERT_EQ(5.0f, loaded.traffic_projection_radius_nm);
+  ASSERT_EQ(25.0f, loaded.traffic_range_nm);
+  ASSERT_EQ(3000.0f, loaded.traffic_altitude_band_ft);
+  ASSERT_EQ(60.0f, loaded.traffic_closure_lookahead_s);
+  ASSERT_TRUE(loaded.traffic_spatial_index);
+  ASSERT_EQ(50.0f, loaded.traffic_scan_radius_nm);
+  ASSERT_EQ(2.0f, loaded.traffic_scan_interval_s);
+  ASSERT_EQ(4u, loaded.traffic_build_threads);
+  ASSERT_TRUE(loaded.traffic_adaptive_rate);
+  ASSERT_EQ(25.0f, loaded.traffic_max_frames_per_second);
+  ASSERT_TRUE(loaded.traffic_pacing);
+  ASSERT_EQ(2.0f, loaded.extrapolation_horizon_s);
+  ASSERT_EQ(4.0f, loaded.output_budget_ms);
+  ASSERT_EQ(3000u, loaded.output_budget_bytes);
+  ASSERT_EQ(50000u, loaded.bandwidth_limit_bytes_per_s);
   ASSERT_EQ(static_cast<uint8_t>(10), loaded.nic);
   ASSERT_EQ(static_cast<uint8_t>(9), loaded.nacp);
   ASSERT_TRUE(loaded.ahrs_use_magnetic_heading);
   ASSERT_TRUE(loaded.log_messages);
+  ASSERT_TRUE(loaded.stream_capture);
+  ASSERT_EQ(128u, loaded.stream_capture_mb);
+  ASSERT_TRUE(loaded.stream_capture_compact);
+  ASSERT_TRUE(loaded.shared_output);
+  ASSERT_TRUE(loaded.link_probe);
+  ASSERT_TRUE(loaded.sim_recording);
+  ASSERT_TRUE(loaded.metrics_enabled);
+  ASSERT_EQ(static_cast<uint16_t>(9200), loaded.metrics_port);
 
   const std::filesystem::path scalar_path =
       MakeTempPath("settings_scalar.json");
@@ -236,6 +458,18 @@ TEST_CASE("Settings saver rejects invalid target IP and write failures") {
   ASSERT_TRUE(error.find("Target IP must be a valid IPv4 address") !=
               std::string::npos);
 
+  settings.target_ip = "239.255.0.1";
+  settings.multicast_interface = "eth0";
+  ASSERT_TRUE(
+      !xp2gdl90::SaveSettingsToJsonFile("/tmp/unused.json", settings, &error));
+  ASSERT_TRUE(error.find("Multicast interface") != std::string::npos);
+  settings.multicast_interface.clear();
+  settings.socket_bind_ip = "wlan0";
+  ASSERT_TRUE(
+      !xp2gdl90::SaveSettingsToJsonFile("/tmp/unused.json", settings, &error));
+  ASSERT_TRUE(error.find("Socket bind IP") != std::string::npos);
+  settings.socket_bind_ip.clear();
+
   const std::filesystem::path bad_path =
       MakeTempPath("missing_dir") / "settings.json";
   settings.target_ip = "127.0.0.1";
@@ -244,3 +478,88 @@ TEST_CASE("Settings saver rejects invalid target IP and write failures") {
   ASSERT_TRUE(error.find("Failed to open settings file for writing:") !=
               std::string::npos);
 }
+
+TEST_CASE("Settings round-trip extra destinations with message filters") {
+  const std::filesystem::path path = MakeTempPath("settings_dest.json");
+  ScopedFileCleanup cleanup(path);
+
+  xp2gdl90::Settings saved;
+  xp2gdl90::Destination ahrs_only;
+  ahrs_only.ip = "192.168.1.51";
+  ahrs_only.port = 4000;
+  ahrs_only.message_mask =
+      xp2gdl90::MESSAGE_HEARTBEAT | xp2gdl90::MESSAGE_AHRS;
+  ahrs_only.rate_divisor = 2;
+  xp2gdl90::Destination everything;
+  everything.ip = "192.168.1.52";
+  everything.port = 49002;
+  saved.extra_destinations = {ahrs_only, everything};
+
+  std::string error;
+  ASSERT_TRUE(xp2gdl90::SaveSettingsToJsonFile(path.string(), saved, &error));
+
+  xp2gdl90::Settings loaded;
+  ASSERT_TRUE(
+      xp2gdl90::LoadSettingsFromJsonFile(path.string(), &loaded, &error));
+  ASSERT_EQ(static_cast<size_t>(2), loaded.extra_destinations.size());
+  ASSERT_EQ(std::string("192.168.1.51"), loaded.extra_destinations[0].ip);
+  ASSERT_EQ(ahrs_only.message_mask, loaded.extra_destinations[0].message_mask);
+  ASSERT_EQ(static_cast<uint8_t>(2), loaded.extra_destinations[0].rate_divisor);
+  ASSERT_EQ(static_cast<uint16_t>(49002), loaded.extra_destinations[1].port);
+  ASSERT_EQ(xp2gdl90::MESSAGE_ALL, loaded.extra_destinations[1].message_mask);
+
+  saved.extra_destinations[1].ip = "bad";
+  ASSERT_TRUE(
+      !xp2gdl90::SaveSettingsToJsonFile(path.string(), saved, &error));
+  ASSERT_TRUE(error.find("Destination IP") != std::string::npos);
+}
+
+TEST_CASE("Settings loader skips malformed extra destinations") {
+  const std::filesystem::path path = MakeTempPath("settings_dest_bad.json");
+  ScopedFileCleanup cleanup(path);
+
+  std::ofstream file(path);
+  file << "{\"extra_destinations\": [\n"
+       << "  {\"ip\": \"10.0.0.1\", \"port\": 4000, \"messages\": [\"radar\"],"
+       << " \"rate_divisor\": 0},\n"
+       << "  {\"ip\": \"10.0.0.300\", \"port\": 4000},\n"
+       << "  {\"ip\": \"10.0.0.2\"},\n"
+       << "  {\"ip\": \"10.0.0.3\", \"port\": 4001, \"messages\": [1]},\n"
+       << "  \"10.0.0.4\",\n"
+       << "  {\"ip\": \"10.0.0.5\", \"port\": 4002, \"messages\": \"ahrs\"}\n"
+       << "]}\n";
+  file.close();
+
+  xp2gdl90::Settings loaded;
+  std::string error;
+  ASSERT_TRUE(
+      xp2gdl90::LoadSettingsFromJsonFile(path.string(), &loaded, &error));
+  ASSERT_EQ(static_cast<size_t>(3), loaded.extra_destinations.size());
+  ASSERT_EQ(xp2gdl90::MESSAGE_ALL, loaded.extra_destinations[0].message_mask);
+  ASSERT_EQ(static_cast<uint8_t>(1), loaded.extra_destinations[0].rate_divisor);
+  ASSERT_EQ(std::string("10.0.0.3"), loaded.extra_destinations[1].ip);
+  ASSERT_EQ(xp2gdl90::MESSAGE_ALL, loaded.extra_destinations[2].message_mask);
+}
+
+TEST_CASE("Settings loader skips unknown containers and keeps the last key") {
+  const std::filesystem::path path = MakeTempPath("settings_nested.json");
+  ScopedFileCleanup cleanup(path);
+
+  std::ofstream file(path);
+  file << "{\"plugin\": {\"target_port\": 1, \"extra_destinations\": []},\n"
+       << " \"extra_destinations\": [{\"ip\": \"10.0.0.1\", \"port\": 4000,"
+       << " \"notes\": {\"port\": 1, \"messages\": [[\"ahrs\"]]},"
+       << " \"messages\": [\"ahrs\", [\"traffic\"]]}],\n"
+       << " \"target_port\": 5000, \"target_port\": 5001}\n";
+  file.close();
+
+  xp2gdl90::Settings loaded;
+  std::string error;
+  ASSERT_TRUE(
+      xp2gdl90::LoadSettingsFromJsonFile(path.string(), &loaded, &error));
+  ASSERT_EQ(static_cast<uint16_t>(5001), loaded.target_port);
+  ASSERT_EQ(static_cast<size_t>(1), loaded.extra_destinations.size());
+  ASSERT_EQ(static_cast<uint16_t>(4000), loaded.extra_destinations[0].port);
+  // A nested array makes the message list invalid, as a non-string would.
+  ASSERT_EQ(xp2gdl90::MESSAGE_ALL, loaded.extra_destinations[0].message_mask);
+}
@@ -0,0 +1,56 @@
+#include "test_harness.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xp2gdl90/settings_snapshot.h"
+
+TEST_CASE("Settings snapshots outlive the publish that replaces them") {
+  xp2gdl90::SettingsPublisher publisher;
+  ASSERT_EQ(static_cast<uint64_t>(0), publisher.version());
+  const xp2gdl90::SettingsSnapshot initial = publisher.load();
+  ASSERT_EQ(std::string("N12345"), initial->callsign);
+
+  xp2gdl90::Settings changed;
+  changed.callsign = "CHANGED";
+  publisher.publish(changed);
+  ASSERT_EQ(static_cast<uint64_t>(1), publisher.version());
+  ASSERT_EQ(std::string("CHANGED"), publisher.load()->callsign);
+  // The reader's copy is untouched.
+  ASSERT_EQ(std::string("N12345"), initial->callsign);
+}
+
+TEST_CASE("Settings snapshots are never seen half published") {
+  xp2gdl90::SettingsPublisher publisher;
+  std::atomic<bool> done{false};
+  std::atomic<bool> consistent{true};
+
+  // Each snapshot's callsign names its port, so a torn read shows.
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 3; ++i) {
+    readers.emplace_back([&publisher, &done, &consistent] {
+      while (!done.load()) {
+        const xp2gdl90::SettingsSnapshot settings = publisher.load();
+        if (settings->target_port != 4000 &&
+            settings->callsign != std::to_string(settings->target_port)) {
+          consistent.store(false);
+        }
+      }
+    });
+  }
+  for (uint16_t port = 5000; port < 7000; ++port) {
+    xp2gdl90::Settings settings;
+    settings.target_port = port;
+    settings.callsign = std::to_string(port);
+    publisher.publish(settings);
+  }
+  done.store(true);
+  for (std::thread &reader : readers) {
+    reader.join();
+  }
+
+  ASSERT_TRUE(consistent.load());
+  ASSERT_EQ(static_cast<uint16_t>(6999), publisher.load()->target_port);
+}
@@ -1,5 +1,6 @@
 #include "test_harness.h"
 
+#include <cstdint>
 #include <cstdio>
 #include <string>
 
@@ -11,6 +12,12 @@ TEST_CASE("Settings UI sync reflects config values") {
   settings.target_port = 4242;
   settings.foreflight_auto_discovery = false;
   settings.foreflight_broadcast_port = 63094;
+  settings.datagram_packing = true;
+  settings.datagram_max_bytes = 900;
+  settings.sender_thread = true;
+  settings.sender_overflow_policy = 1;
+  settings.worker_thread_priority = 1;
+  settings.worker_cpu_mask = 0xC;
   settings.icao_address = 0xA0B1C2;
   settings.callsign = "N42";
   settings.emitter_category = 3;
@@ -21,12 +28,47 @@ TEST_CASE("Settings UI sync reflects config values") {
   settings.traffic_enabled = false;
   settings.heartbeat_rate = 5.0f;
   settings.position_rate = 2.5f;
+  settings.ownship_high_rate = true;
   settings.traffic_rate = 1.5f;
+  settings.ahrs_rate = 20.0f;
+  settings.geo_altitude_rate = 0.0f;
+  settings.device_info_rate = 0.5f;
   settings.traffic_max_targets = 23;
+  settings.traffic_position_mode = 1;
+  settings.traffic_projection_radius_nm = 12.5f;
+  settings.traffic_range_nm = 40.0f;
+  settings.traffic_altitude_band_ft = 5000.0f;
+  settings.traffic_closure_lookahead_s = 30.0f;
+  settings.traffic_spatial_index = true;
+  settings.traffic_scan_radius_nm = 25.0f;
+  settings.traffic_scan_interval_s = 10.0f;
+  settings.traffic_build_threads = 2;
+  settings.traffic_adaptive_rate = true;
+  settings.traffic_max_frames_per_second = 30.0f;
+  settings.traffic_pacing = true;
+  settings.traffic_thread = true;
+  settings.traffic_smoothing = true;
+  settings.traffic_relay = true;
+  settings.traffic_relay_port = 4100;
+  settings.traffic_relay_priority = 1;
+  settings.extrapolation_horizon_s = 0.75f;
+  settings.output_budget_ms = 1.5f;
+  settings.output_budget_bytes = 1200u;
+  settings.bandwidth_limit_bytes_per_s = 30000u;
   settings.nic = 10;
   settings.nacp = 9;
   settings.debug_logging = true;
   settings.log_messages = true;
+  settings.stream_capture = true;
+  settings.stream_capture_mb = 32u;
+  settings.stream_capture_compact = true;
+  settings.shared_output = true;
+  settings.link_probe = true;
+  settings.sim_recording = true;
+  settings.metrics_enabled = true;
+  settings.metrics_ip = "10.0.0.9";
+  settings.metrics_port = 9100;
+  settings.metrics_interval_s = 10.0f;
 
   xp2gdl90::SettingsUiState ui_state;
   xp2gdl90::SyncSettingsUiFromConfig(&ui_state, settings);
@@ -35,6 +77,12 @@ TEST_CASE("Settings UI sync reflects config values") {
   ASSERT_EQ(4242, ui_state.target_port);
   ASSERT_TRUE(!ui_state.foreflight_auto_discovery);
   ASSERT_EQ(63094, ui_state.foreflight_broadcast_port);
+  ASSERT_TRUE(ui_state.datagram_packing);
+  ASSERT_EQ(900, ui_state.datagram_max_bytes);
+  ASSERT_TRUE(ui_state.sender_thread);
+  ASSERT_EQ(1, ui_state.sender_overflow_policy);
+  ASSERT_EQ(1, ui_state.worker_thread_priority);
+  ASSERT_EQ(std::string("0xC"), std::string(ui_state.worker_cpu_mask));
   ASSERT_EQ(std::string("0xA0B1C2"), std::string(ui_state.icao_address));
   ASSERT_EQ(std::string("N42"), std::string(ui_state.callsign));
   ASSERT_EQ(3, ui_state.emitter_category);
@@ -46,12 +94,47 @@ TEST_CASE("Settings UI sync reflects config values") {
   ASSERT_TRUE(!ui_state.traffic_enabled);
   ASSERT_EQ(5.0f, ui_state.heartbeat_rate);
   ASSERT_EQ(2.5f, ui_state.position_rate);
+  ASSERT_TRUE(ui_state.ownship_high_rate);
   ASSERT_EQ(1.5f, ui_state.traffic_rate);
+  ASSERT_EQ(20.0f, ui_state.ahrs_rate);
+  ASSERT_EQ(0.0f, ui_state.geo_altitude_rate);
+  ASSERT_EQ(0.5f, ui_state.device_info_rate);
   ASSERT_EQ(23, ui_state.traffic_max_targets);
+  ASSERT_EQ(1, ui_state.traffic_position_mode);
+  ASSERT_EQ(12.5f, ui_state.traffic_projection_radius_nm);
+  ASSERT_EQ(40.0f, ui_state.traffic_range_nm);
+  ASSERT_EQ(5000.0f, ui_state.traffic_altitude_band_ft);
+  ASSERT_EQ(30.0f, ui_state.traffic_closure_lookahead_s);
+  ASSERT_TRUE(ui_state.traffic_spatial_index);
+  ASSERT_EQ(25.0f, ui_state.traffic_scan_radius_nm);
+  ASSERT_EQ(10.0f, ui_state.traffic_scan_interval_s);
+  ASSERT_EQ(2, ui_state.traffic_build_threads);
+  ASSERT_TRUE(ui_state.traffic_adaptive_rate);
+  ASSERT_EQ(30.0f, ui_state.traffic_max_frames_per_second);
+  ASSERT_TRUE(ui_state.traffic_pacing);
+  ASSERT_TRUE(ui_state.traffic_thread);
+  ASSERT_TRUE(ui_state.traffic_smoothing);
+  ASSERT_TRUE(ui_state.traffic_relay);
+  ASSERT_EQ(4100, ui_state.traffic_relay_port);
+  ASSERT_EQ(1, ui_state.traffic_relay_priority);
+  ASSERT_EQ(0.75f, ui_state.extrapolation_horizon_s);
+  ASSERT_EQ(1.5f, ui_state.output_budget_ms);
+  ASSERT_EQ(1200, ui_state.output_budget_bytes);
+  ASSERT_EQ(30000, ui_state.bandwidth_limit_bytes_per_s);
   ASSERT_EQ(10, ui_state.nic);
   ASSERT_EQ(9, ui_state.nacp);
   ASSERT_TRUE(ui_state.debug_logging);
   ASSERT_TRUE(ui_state.log_messages);
+  ASSERT_TRUE(ui_state.stream_capture);
+  ASSERT_EQ(32, ui_state.stream_capture_mb);
+  ASSERT_TRUE(ui_state.stream_capture_compact);
+  ASSERT_TRUE(ui_state.shared_output);
+  ASSERT_TRUE(ui_state.link_probe);
+  ASSERT_TRUE(ui_state.sim_recording);
+  ASSERT_TRUE(ui_state.metrics_enabled);
+  ASSERT_EQ(std::string("10.0.0.9"), std::string(ui_state.metrics_ip));
+  ASSERT_EQ(9100, ui_state.metrics_port);
+  ASSERT_EQ(10.0f, ui_state.metrics_interval_s);
 }
 
 TEST_CASE("Settings UI defaults mirror default config") {
@@ -76,6 +159,13 @@ TEST_CASE("Settings UI builder validates fields and trims text") {
   ui_state.target_port = 4000;
   ui_state.foreflight_auto_discovery = true;
   ui_state.foreflight_broadcast_port = 63093;
+  ui_state.datagram_packing = true;
+  ui_state.datagram_max_bytes = 1472;
+  ui_state.sender_thread = true;
+  ui_state.sender_overflow_policy = 1;
+  ui_state.worker_thread_priority = 2;
+  std::snprintf(ui_state.worker_cpu_mask, sizeof(ui_state.worker_cpu_mask),
+                " 0x30 ");
   std::snprintf(ui_state.icao_address, sizeof(ui_state.icao_address),
                 "0xABCDEF");
   std::snprintf(ui_state.callsign, sizeof(ui_state.callsign), " N123456789 ");
@@ -91,10 +181,42 @@ TEST_CASE("Settings UI builder validates fields and trims text") {
   ui_state.position_rate = 1.0f;
   ui_state.traffic_rate = 1.5f;
   ui_state.traffic_max_targets = 42;
+  ui_state.traffic_position_mode = 1;
+  ui_state.traffic_projection_radius_nm = 20.0f;
+  ui_state.traffic_range_nm = 15.0f;
+  ui_state.traffic_altitude_band_ft = 2500.0f;
+  ui_state.traffic_closure_lookahead_s = 90.0f;
+  ui_state.traffic_spatial_index = true;
+  ui_state.traffic_scan_radius_nm = 40.0f;
+  ui_state.traffic_scan_interval_s = 3.0f;
+  ui_state.traffic_build_threads = 4;
+  ui_state.traffic_adaptive_rate = true;
+  ui_state.traffic_max_frames_per_second = 20.0f;
+  ui_state.traffic_pacing = true;
+  ui_state.traffic_thread = true;
+  ui_state.traffic_smoothing = true;
+  ui_state.traffic_relay = true;
+  ui_state.traffic_relay_port = 4200;
+  ui_state.traffic_relay_priority = 1;
+  ui_state.extrapolation_horizon_s = 3.0f;
+  ui_state.output_budget_ms = 3.0f;
+  ui_state.output_budget_bytes = 2400;
+  ui_state.bandwidth_limit_bytes_per_s = 40000;
   ui_state.nic = 11;
   ui_state.nacp = 10;
   ui_state.debug_logging = true;
   ui_state.log_messages = false;
+  ui_state.stream_capture = true;
+  ui_state.stream_capture_mb = 8;
+  ui_state.stream_capture_compact = true;
+  ui_state.shared_output = true;
+  ui_state.link_probe = true;
+  ui_state.sim_recording = true;
+  ui_state.metrics_enabled = true;
+  std::snprintf(ui_state.metrics_ip, sizeof(ui_state.metrics_ip),
+                " 10.1.1.9 ");
+  ui_state.metrics_port = 9100;
+  ui_state.metrics_interval_s = 2.0f;
 
   xp2gdl90::Settings built;
   std::string error;
@@ -102,6 +224,12 @@ TEST_CASE("Settings UI builder validates fields and trims text") {
       ui_state, xp2gdl90::Settings{}, &built, &error));
   ASSERT_EQ(std::string(""), error);
   ASSERT_EQ(std::string("10.1.1.5"), built.target_ip);
+  ASSERT_TRUE(built.datagram_packing);
+  ASSERT_EQ(static_cast<uint16_t>(1472), built.datagram_max_bytes);
+  ASSERT_TRUE(built.sender_thread);
+  ASSERT_EQ(static_cast<uint8_t>(1), built.sender_overflow_policy);
+  ASSERT_EQ(static_cast<uint8_t>(2), built.worker_thread_priority);
+  ASSERT_EQ(0x30u, built.worker_cpu_mask);
   ASSERT_EQ(std::string("N1234567"), built.callsign);
   ASSERT_EQ(std::string("DEVICE01"), built.device_name);
   ASSERT_EQ(std::string("Long Device Name"), built.device_long_name);
@@ -111,6 +239,37 @@ TEST_CASE("Settings UI builder validates fields and trims text") {
   ASSERT_TRUE(built.traffic_enabled);
   ASSERT_EQ(1.5f, built.traffic_rate);
   ASSERT_EQ(static_cast<uint8_t>(42), built.traffic_max_targets);
+  ASSERT_EQ(static_cast<uint8_t>(1), built.traffic_position_mode);
+  ASSERT_EQ(20.0f, built.traffic_projection_radius_nm);
+  ASSERT_EQ(15.0f, built.traffic_range_nm);
+  ASSERT_EQ(2500.0f, built.traffic_altitude_band_ft);
+  ASSERT_EQ(90.0f, built.traffic_closure_lookahead_s);
+  ASSERT_TRUE(built.traffic_spatial_index);
+  ASSERT_EQ(40.0f, built.traffic_scan_radius_nm);
+  ASSERT_EQ(3.0f, built.traffic_scan_interval_s);
+  ASSERT_EQ(4u, built.traffic_build_threads);
+  ASSERT_TRUE(built.traffic_adaptive_rate);
+  ASSERT_EQ(20.0f, built.traffic_max_frames_per_second);
+  ASSERT_TRUE(built.traffic_pacing);
+  ASSERT_TRUE(built.traffic_thread);
+  ASSERT_TRUE(built.traffic_smoothing);
+  ASSERT_TRUE(built.traffic_relay);
+  ASSERT_EQ(static_cast<uint16_t>(4200), built.traffic_relay_port);
+  ASSERT_EQ(1u, built.traffic_relay_priority);
+  ASSERT_EQ(3.0f, built.extrapolation_horizon_s);
+  ASSERT_EQ(3.0f, built.output_budget_ms);
+  ASSERT_EQ(2400u, built.output_budget_bytes);
+  ASSERT_EQ(40000u, built.bandwidth_limit_bytes_per_s);
+  ASSERT_TRUE(built.stream_capture);
+  ASSERT_EQ(8u, built.stream_capture_mb);
+  ASSERT_TRUE(built.stream_capture_compact);
+  ASSERT_TRUE(built.shared_output);
+  ASSERT_TRUE(built.link_probe);
+  ASSERT_TRUE(built.sim_recording);
+  ASSERT_TRUE(built.metrics_enabled);
+  ASSERT_EQ(std::string("10.1.1.9"), built.metrics_ip);
+  ASSERT_EQ(static_cast<uint16_t>(9100), built.metrics_port);
+  ASSERT_EQ(2.0f, built.metrics_interval_s);
 }
 
 TEST_CASE("Settings UI builder requires output settings object") {
@@ -171,6 +330,34 @@ TEST_CASE(
   ASSERT_TRUE(error.find("ForeFlight broadcast port must be 1-65535") !=
               std::string::npos);
 
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.datagram_max_bytes = 100;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Datagram size must be 128-65507 bytes") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.sender_overflow_policy = 2;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Sender overflow policy must be 0-1") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.worker_thread_priority = 3;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Worker thread priority must be 0-2") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  std::snprintf(ui_state.worker_cpu_mask, sizeof(ui_state.worker_cpu_mask),
+                "0x1FFFFFFFF");
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Worker CPU mask must be") != std::string::npos);
+
   xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
   std::snprintf(ui_state.icao_address, sizeof(ui_state.icao_address), "   ");
   ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
@@ -209,18 +396,189 @@ TEST_CASE(
       ui_state, xp2gdl90::Settings{}, &built, &error));
   ASSERT_TRUE(error.find("Position rate must be > 0") != std::string::npos);
 
+  // High-rate ownship goes up to 10 Hz; other modes are not capped.
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.position_rate = 12.0f;
+  ASSERT_TRUE(xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ui_state.ownship_high_rate = true;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("High-rate ownship needs a position rate of 10 Hz") !=
+              std::string::npos);
+  ui_state.position_rate = 10.0f;
+  ASSERT_TRUE(xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(built.ownship_high_rate);
+
   xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
   ui_state.traffic_rate = 0.0f;
   ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
       ui_state, xp2gdl90::Settings{}, &built, &error));
   ASSERT_TRUE(error.find("Traffic rate must be > 0") != std::string::npos);
 
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.ahrs_rate = 25.0f;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("AHRS rate must be 0-20 Hz") != std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.geo_altitude_rate = -1.0f;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Geo altitude rate must be 0-5 Hz") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.device_info_rate = 6.0f;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("ForeFlight ID rate must be 0-5 Hz") !=
+              std::string::npos);
+
+  // Zero turns a message class off.
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.ahrs_rate = 0.0f;
+  ui_state.device_info_rate = 0.0f;
+  ASSERT_TRUE(xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_EQ(0.0f, built.ahrs_rate);
+  ASSERT_EQ(0.0f, built.device_info_rate);
+  ASSERT_EQ(1.0f, built.geo_altitude_rate);
+
   xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
   ui_state.traffic_max_targets = 64;
   ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
       ui_state, xp2gdl90::Settings{}, &built, &error));
   ASSERT_TRUE(error.find("Traffic maximum must be 0-63") != std::string::npos);
 
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.traffic_position_mode = 2;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Traffic position mode must be 0-1") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.traffic_projection_radius_nm = 41.0f;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Traffic projection radius must be 0-40 nm") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.traffic_range_nm = 501.0f;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Traffic range must be 0-500 nm") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.traffic_scan_radius_nm = 0.5f;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Traffic scan radius must be 1-108 nm") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.traffic_scan_interval_s = 61.0f;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Traffic scan interval must be 1-60 s") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.traffic_build_threads = 9;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Traffic build threads must be 0-8") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.traffic_relay_port = 0;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Traffic relay port must be 1-65535") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.traffic_relay_priority = 2;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Traffic relay priority must be 0-1") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.traffic_altitude_band_ft = -1.0f;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Traffic altitude band must be 0-60000 ft") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.traffic_closure_lookahead_s = 601.0f;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Traffic closure lookahead must be 0-600 s") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.traffic_max_frames_per_second = 1001.0f;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Traffic frame budget must be 0-1000 per second") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.extrapolation_horizon_s = 10.5f;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Extrapolation horizon must be 0-10 s") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.output_budget_ms = 200.0f;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Output budget must be 0-100 ms") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.output_budget_bytes = -1;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Output byte budget must be 0-65536") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.bandwidth_limit_bytes_per_s = -5;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Bandwidth limit must be 0-12500000 bytes/s") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.stream_capture_mb = 0;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Capture size must be 1-1024 MB") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  std::snprintf(ui_state.metrics_ip, sizeof(ui_state.metrics_ip), "collector");
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Metrics IP must be a valid IPv4 address") !=
+              std::string::npos);
+
+  xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
+  ui_state.metrics_interval_s = 0.5f;
+  ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
+      ui_state, xp2gdl90::Settings{}, &built, &error));
+  ASSERT_TRUE(error.find("Metrics interval must be 1-300 seconds") !=
+              std::string::npos);
+
   xp2gdl90::LoadDefaultSettingsUiState(&ui_state);
   ui_state.nic = 12;
   ASSERT_TRUE(!xp2gdl90::BuildConfigFromSettingsUi(
@@ -233,3 +591,27 @@ TEST_CASE(
       ui_state, xp2gdl90::Settings{}, &built, &error));
   ASSERT_TRUE(error.find("NACp must be 0-11") != std::string::npos);
 }
+
+TEST_CASE("Settings redraw policy rebuilds on input and at the idle rate") {
+  xp2gdl90::SettingsRedrawPolicy policy(0.25, 0.5);
+  ASSERT_TRUE(policy.shouldRebuild(10.0, false));
+  policy.noteRebuilt(10.0);
+  ASSERT_TRUE(!policy.shouldRebuild(10.1, false));
+  ASSERT_TRUE(policy.shouldRebuild(10.1, true));
+  ASSERT_TRUE(policy.shouldRebuild(10.25, false));
+  policy.noteRebuilt(10.25);
+
+  // Input rebuilds every draw until the hold runs out.
+  policy.noteInput(10.3);
+  ASSERT_TRUE(policy.shouldRebuild(10.3, false));
+  policy.noteRebuilt(10.3);
+  ASSERT_TRUE(policy.shouldRebuild(10.79, false));
+  policy.noteRebuilt(10.79);
+  ASSERT_TRUE(!policy.shouldRebuild(10.85, false));
+
+  policy.invalidate();
+  ASSERT_TRUE(policy.shouldRebuild(10.86, false));
+  policy.noteRebuilt(10.86);
+  ASSERT_TRUE(policy.shouldRebuild(1.0, false));
+  ASSERT_EQ(static_cast<uint64_t>(5), policy.rebuilds());
+}
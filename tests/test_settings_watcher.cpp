@@ -0,0 +1,138 @@
+#include "test_harness.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "xp2gdl90/settings_watcher.h"
+
+namespace {
+
+constexpr double kPollIntervalS = 0.01;
+
+std::filesystem::path MakeTempPath(const char *suffix) {
+  const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+  return std::filesystem::temp_directory_path() /
+         ("xp2gdl90_" + std::to_string(now) + "_" + suffix);
+}
+
+struct ScopedFileCleanup {
+  explicit ScopedFileCleanup(std::filesystem::path file_path)
+      : path(std::move(file_path)) {}
+
+  ~ScopedFileCleanup() {
+    std::error_code error;
+    std::filesystem::remove(path, error);
+  }
+
+  std::filesystem::path path;
+};
+
+void WriteFile(const std::filesystem::path &path, const std::string &text) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file << text;
+}
+
+// Null if nothing arrives within two seconds.
+std::shared_ptr<const xp2gdl90::SettingsLoad>
+WaitForLoad(xp2gdl90::SettingsWatcher *watcher) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < deadline) {
+    if (auto load = watcher->take()) {
+      return load;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return nullptr;
+}
+
+} // namespace
+
+TEST_CASE("Settings watcher loads at start and again after an edit") {
+  const std::filesystem::path path = MakeTempPath("watched.json");
+  ScopedFileCleanup cleanup(path);
+  WriteFile(path, "{\"target_port\": 4100}");
+
+  xp2gdl90::Settings base;
+  base.callsign = "BASE";
+  xp2gdl90::SettingsWatcher watcher;
+  std::string error;
+  ASSERT_TRUE(watcher.start(path.string(), base, kPollIntervalS, &error));
+  ASSERT_TRUE(watcher.isRunning());
+
+  auto load = WaitForLoad(&watcher);
+  ASSERT_TRUE(load != nullptr);
+  ASSERT_TRUE(load->found && load->ok);
+  ASSERT_EQ(static_cast<uint16_t>(4100), load->settings.target_port);
+  ASSERT_EQ(std::string("BASE"), load->settings.callsign);
+  const uint64_t first_generation = load->generation;
+
+  // Each load starts from the last good one, as the old reload did.
+  WriteFile(path, "{\"callsign\": \"EDITED\"}");
+  load = WaitForLoad(&watcher);
+  ASSERT_TRUE(load != nullptr);
+  ASSERT_TRUE(load->generation > first_generation);
+  ASSERT_EQ(std::string("EDITED"), load->settings.callsign);
+  ASSERT_EQ(static_cast<uint16_t>(4100), load->settings.target_port);
+
+  WriteFile(path, "{\"callsign\": ");
+  load = WaitForLoad(&watcher);
+  ASSERT_TRUE(load != nullptr);
+  ASSERT_TRUE(load->found && !load->ok);
+  ASSERT_TRUE(load->error.find("Invalid settings JSON") != std::string::npos);
+
+  watcher.stop();
+  ASSERT_TRUE(!watcher.isRunning());
+}
+
+TEST_CASE("Settings watcher reports a missing file and forced reloads") {
+  const std::filesystem::path path = MakeTempPath("missing.json");
+  ScopedFileCleanup cleanup(path);
+
+  xp2gdl90::SettingsWatcher watcher;
+  std::string error;
+  ASSERT_TRUE(watcher.start(path.string(), xp2gdl90::Settings(),
+                            kPollIntervalS, &error));
+  auto load = WaitForLoad(&watcher);
+  ASSERT_TRUE(load != nullptr);
+  ASSERT_TRUE(!load->found && !load->ok);
+  ASSERT_TRUE(load->error.empty());
+
+  // Nothing changed, so nothing more is published until asked.
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_TRUE(watcher.take() == nullptr);
+  watcher.requestReload();
+  load = WaitForLoad(&watcher);
+  ASSERT_TRUE(load != nullptr);
+  ASSERT_TRUE(!load->found);
+}
+
+TEST_CASE("Settings watcher does not report its own saves as edits") {
+  const std::filesystem::path path = MakeTempPath("saved.json");
+  ScopedFileCleanup cleanup(path);
+  WriteFile(path, "{}");
+
+  xp2gdl90::SettingsWatcher watcher;
+  std::string error;
+  ASSERT_TRUE(watcher.start(path.string(), xp2gdl90::Settings(),
+                            kPollIntervalS, &error));
+  ASSERT_TRUE(WaitForLoad(&watcher) != nullptr);
+
+  xp2gdl90::Settings saved;
+  saved.target_port = 4321;
+  ASSERT_TRUE(watcher.save(saved, &error));
+  ASSERT_TRUE(!std::filesystem::exists(path.string() + ".tmp"));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_TRUE(watcher.take() == nullptr);
+
+  // The saved settings are the base for the next edit.
+  WriteFile(path, "{\"callsign\": \"NEXT\"}");
+  auto load = WaitForLoad(&watcher);
+  ASSERT_TRUE(load != nullptr);
+  ASSERT_EQ(static_cast<uint16_t>(4321), load->settings.target_port);
+  ASSERT_EQ(std::string("NEXT"), load->settings.callsign);
+}
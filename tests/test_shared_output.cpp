@@ -0,0 +1,247 @@
+#include "test_harness.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "xp2gdl90/broadcast_engine.h"
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/shared_output.h"
+
+using xp2gdl90::SharedFrame;
+using xp2gdl90::SharedOutput;
+using xp2gdl90::SharedOutputReader;
+using xp2gdl90::SharedSnapshot;
+
+namespace {
+
+std::string MakeOutputName(const char *suffix) {
+  const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+  return "xp2gdl90_test_" + std::to_string(now) + "_" + suffix;
+}
+
+std::vector<uint8_t> NumberedFrame(uint32_t number, size_t size = 12) {
+  std::vector<uint8_t> frame(size, 0x55);
+  frame.front() = 0x7E;
+  frame.back() = 0x7E;
+  std::memcpy(frame.data() + 2, &number, sizeof(number));
+  return frame;
+}
+
+uint32_t FrameNumber(const SharedFrame &frame) {
+  uint32_t number = 0;
+  std::memcpy(&number, frame.data + 2, sizeof(number));
+  return number;
+}
+
+gdl90::PositionData Report(uint32_t address, const char *callsign) {
+  gdl90::PositionData report;
+  report.icao_address = address;
+  report.latitude = 47.25;
+  report.longitude = 8.5;
+  report.altitude = 4500;
+  report.h_velocity = 110;
+  report.track = 180;
+  report.track_type = gdl90::TrackType::TRUE_TRACK;
+  report.airborne = true;
+  report.callsign = callsign;
+  return report;
+}
+
+void AddFrame(gdl90::FrameArena *arena, const std::vector<uint8_t> &frame) {
+  std::memcpy(arena->beginFrame(), frame.data(), frame.size());
+  arena->commitFrame(frame.size());
+}
+
+} // namespace
+
+TEST_CASE("Shared output readers see frames published after they open") {
+  SharedOutput output;
+  std::string error;
+  ASSERT_TRUE(output.open(MakeOutputName("frames"), &error));
+  output.publishFrame(NumberedFrame(1).data(), 12);
+
+  SharedOutputReader reader;
+  ASSERT_TRUE(reader.open(output.name(), &error));
+  SharedFrame frames[8];
+  ASSERT_EQ(static_cast<size_t>(0), reader.readFrames(frames, 8));
+
+  output.publishFrame(NumberedFrame(2).data(), 12);
+  output.publishFrame(NumberedFrame(3, 37).data(), 37);
+  ASSERT_EQ(static_cast<size_t>(2), reader.readFrames(frames, 8));
+  ASSERT_TRUE(reader.framesIntact());
+  ASSERT_EQ(static_cast<uint32_t>(2), FrameNumber(frames[0]));
+  ASSERT_EQ(static_cast<size_t>(12), frames[0].size);
+  ASSERT_EQ(static_cast<uint32_t>(3), FrameNumber(frames[1]));
+  ASSERT_EQ(static_cast<size_t>(37), frames[1].size);
+  ASSERT_EQ(static_cast<size_t>(0), reader.readFrames(frames, 8));
+  ASSERT_EQ(static_cast<uint64_t>(3), output.stats().frames);
+
+  SharedOutputReader missing;
+  ASSERT_TRUE(!missing.open(MakeOutputName("missing"), &error));
+  ASSERT_TRUE(!error.empty());
+}
+
+TEST_CASE("Shared output ring wraps and detects lapped readers") {
+  SharedOutput output;
+  std::string error;
+  ASSERT_TRUE(output.open(MakeOutputName("wrap"), &error));
+  SharedOutputReader reader;
+  ASSERT_TRUE(reader.open(output.name(), &error));
+
+  // Odd-sized frames, so records run up to the end of the ring unevenly.
+  const size_t frame_size = 45;
+  const uint32_t total = static_cast<uint32_t>(
+      3 * xp2gdl90::SHARED_OUTPUT_RING_BYTES / (frame_size + 7));
+  uint32_t expected = 0;
+  SharedFrame frames[64];
+  for (uint32_t number = 0; number < total; ++number) {
+    output.publishFrame(NumberedFrame(number, frame_size).data(), frame_size);
+    if (number % 50 == 49) {
+      size_t read = 0;
+      while ((read = reader.readFrames(frames, 64)) > 0) {
+        ASSERT_TRUE(reader.framesIntact());
+        for (size_t i = 0; i < read; ++i) {
+          ASSERT_EQ(expected, FrameNumber(frames[i]));
+          ++expected;
+        }
+      }
+    }
+  }
+  ASSERT_TRUE(output.stats().wraps >= 2);
+  ASSERT_EQ(static_cast<uint64_t>(0), reader.overruns());
+
+  // Frames overwritten after the read no longer check out.
+  const size_t held = reader.readFrames(frames, 64);
+  ASSERT_TRUE(held > 0);
+  for (uint32_t number = 0; number < total; ++number) {
+    output.publishFrame(NumberedFrame(number, frame_size).data(), frame_size);
+  }
+  ASSERT_TRUE(!reader.framesIntact());
+
+  // A lapped reader skips to the newest frame.
+  ASSERT_EQ(static_cast<size_t>(0), reader.readFrames(frames, 64));
+  ASSERT_EQ(static_cast<uint64_t>(1), reader.overruns());
+  output.publishFrame(NumberedFrame(7, frame_size).data(), frame_size);
+  ASSERT_EQ(static_cast<size_t>(1), reader.readFrames(frames, 64));
+  ASSERT_EQ(static_cast<uint32_t>(7), FrameNumber(frames[0]));
+}
+
+TEST_CASE("Shared output snapshot carries decoded ownship and traffic") {
+  SharedOutput output;
+  std::string error;
+  ASSERT_TRUE(output.open(MakeOutputName("snapshot"), &error));
+  SharedOutputReader reader;
+  ASSERT_TRUE(reader.open(output.name(), &error));
+  SharedSnapshot snapshot;
+  ASSERT_TRUE(!reader.readSnapshot(&snapshot));
+
+  const gdl90::GDL90Encoder encoder;
+  const std::vector<uint8_t> ownship =
+      encoder.createOwnshipReport(Report(0xABCDEF, "N123"));
+  output.publishFrame(ownship.data(), ownship.size());
+  gdl90::FrameArena traffic;
+  AddFrame(&traffic, encoder.createTrafficReport(Report(0x111111, "TFC1")));
+  AddFrame(&traffic, encoder.createHeartbeat());
+  AddFrame(&traffic, encoder.createTrafficReport(Report(0x222222, "TFC2")));
+  output.setTraffic(traffic);
+  output.publishSnapshot();
+
+  ASSERT_TRUE(reader.readSnapshot(&snapshot));
+  ASSERT_EQ(static_cast<uint64_t>(1), snapshot.tick);
+  ASSERT_TRUE(snapshot.timestamp_ns > 0);
+  ASSERT_EQ(static_cast<uint32_t>(1), snapshot.ownship_valid);
+  ASSERT_EQ(static_cast<uint32_t>(0xABCDEF), snapshot.ownship.icao_address);
+  ASSERT_TRUE(std::string(snapshot.ownship.callsign, 8) == "N123    ");
+  ASSERT_EQ(static_cast<int32_t>(4500), snapshot.ownship.altitude);
+  ASSERT_EQ(static_cast<uint32_t>(2), snapshot.traffic_count);
+  ASSERT_EQ(static_cast<uint32_t>(0x111111), snapshot.traffic[0].icao_address);
+  ASSERT_EQ(static_cast<uint32_t>(0x222222), snapshot.traffic[1].icao_address);
+  ASSERT_EQ(static_cast<uint16_t>(110), snapshot.traffic[1].h_velocity);
+
+  // Nothing changed, so nothing is written.
+  output.publishSnapshot();
+  ASSERT_EQ(static_cast<uint64_t>(1), output.stats().snapshots);
+  output.clearTraffic();
+  output.publishSnapshot();
+  ASSERT_TRUE(reader.readSnapshot(&snapshot));
+  ASSERT_EQ(static_cast<uint64_t>(2), snapshot.tick);
+  ASSERT_EQ(static_cast<uint32_t>(0), snapshot.traffic_count);
+}
+
+TEST_CASE("Broadcast engine publishes frames and snapshots when detached") {
+  SharedOutput output;
+  std::string error;
+  ASSERT_TRUE(output.open(MakeOutputName("engine"), &error));
+  SharedOutputReader reader;
+  ASSERT_TRUE(reader.open(output.name(), &error));
+
+  xp2gdl90::BroadcastEngine engine;
+  engine.setSharedOutput(&output);
+  const gdl90::GDL90Encoder encoder;
+  const std::vector<uint8_t> heartbeat = encoder.createHeartbeat();
+  ASSERT_EQ(-1, engine.sendMessage(heartbeat.data(), heartbeat.size(),
+                                   xp2gdl90::MESSAGE_HEARTBEAT, true));
+  gdl90::FrameArena traffic;
+  AddFrame(&traffic, encoder.createTrafficReport(Report(0x333333, "TFC3")));
+  engine.startTraffic(traffic, 10.0, 0.0);
+  engine.sendPacedTraffic(10.0);
+  engine.flush();
+
+  SharedFrame frames[4];
+  ASSERT_EQ(static_cast<size_t>(2), reader.readFrames(frames, 4));
+  ASSERT_EQ(heartbeat.size(), frames[0].size);
+  ASSERT_EQ(static_cast<uint8_t>(gdl90::MSG_ID_TRAFFIC_REPORT),
+            frames[1].data[1]);
+  SharedSnapshot snapshot;
+  ASSERT_TRUE(reader.readSnapshot(&snapshot));
+  ASSERT_EQ(static_cast<uint32_t>(1), snapshot.traffic_count);
+  ASSERT_EQ(static_cast<uint32_t>(0), snapshot.ownship_valid);
+}
+
+#if !defined(_WIN32)
+TEST_CASE("Shared output snapshot reads retry while the writer is mid-update") {
+  SharedOutput output;
+  std::string error;
+  ASSERT_TRUE(output.open(MakeOutputName("seqlock"), &error));
+  output.clearTraffic();
+  gdl90::FrameArena traffic;
+  AddFrame(&traffic, gdl90::GDL90Encoder().createTrafficReport(
+                         Report(0x444444, "TFC4")));
+  output.setTraffic(traffic);
+  output.publishSnapshot();
+  SharedOutputReader reader;
+  ASSERT_TRUE(reader.open(output.name(), &error));
+
+  // A second writable mapping stands in for a writer caught mid-update.
+  const int fd = ::shm_open(("/" + output.name()).c_str(), O_RDWR, 0);
+  ASSERT_TRUE(fd >= 0);
+  void *view = ::mmap(nullptr, sizeof(xp2gdl90::SharedOutputHeader),
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  ASSERT_TRUE(view != MAP_FAILED);
+  auto *header = static_cast<xp2gdl90::SharedOutputHeader *>(view);
+
+  header->snapshot_sequence.fetch_add(1);
+  SharedSnapshot snapshot;
+  ASSERT_TRUE(!reader.readSnapshot(&snapshot, 4));
+  header->snapshot_sequence.fetch_add(1);
+  ASSERT_TRUE(reader.readSnapshot(&snapshot, 4));
+  ASSERT_EQ(static_cast<uint32_t>(0x444444), snapshot.traffic[0].icao_address);
+  ::munmap(view, sizeof(xp2gdl90::SharedOutputHeader));
+
+  // Closing the writer removes the name.
+  const std::string name = output.name();
+  output.close();
+  SharedOutputReader late;
+  ASSERT_TRUE(!late.open(name, &error));
+}
+#endif
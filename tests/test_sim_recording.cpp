@@ -0,0 +1,112 @@
+#include "test_harness.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "xp2gdl90/sim_recording.h"
+
+namespace {
+
+std::filesystem::path MakeTempPath(const char *suffix) {
+  const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+  return std::filesystem::temp_directory_path() /
+         ("xp2gdl90_" + std::to_string(now) + "_" + suffix);
+}
+
+struct ScopedFileCleanup {
+  explicit ScopedFileCleanup(std::filesystem::path file_path)
+      : path(std::move(file_path)) {}
+
+  ~ScopedFileCleanup() {
+    std::error_code error;
+    std::filesystem::remove(path, error);
+  }
+
+  std::filesystem::path path;
+};
+
+} // namespace
+
+TEST_CASE("Sim recordings play back the recorded sweeps") {
+  ScopedFileCleanup cleanup(MakeTempPath("inputs.xpsim"));
+  xp2gdl90::OwnshipSample ownship;
+  ownship.broadcast_time = 12.5;
+  ownship.latitude = 47.25;
+  ownship.pressure_altitude_ft = 5400.0;
+  ownship.gps_valid = true;
+  ownship.tail_number = gdl90::Callsign("N172SP");
+  xp2gdl90::traffic::ProjectionAnchor anchor;
+  anchor.latitude_deg = 47.25;
+  anchor.origin_longitude_deg = 8.5;
+  xp2gdl90::traffic::TrafficSnapshot traffic;
+  traffic.resize(3);
+  traffic.raw_address[2] = 0xABCDEF;
+  traffic.x[2] = -250.0f;
+  traffic.squawk[2] = 7600;
+  traffic.callsign[2] =
+      xp2gdl90::traffic::MakeTrafficCallsign(gdl90::Callsign("DLH4AB"));
+
+  xp2gdl90::SimRecorder recorder;
+  std::string error;
+  ASSERT_TRUE(recorder.open(cleanup.path.string(), &error));
+  ASSERT_TRUE(recorder.append(ownship, &anchor, false, traffic));
+  ownship.broadcast_time = 13.5;
+  traffic.resize(1);
+  ASSERT_TRUE(recorder.append(ownship, nullptr, true, traffic));
+  ASSERT_EQ(uint64_t{2}, recorder.ticks());
+  recorder.close();
+  ASSERT_EQ(static_cast<uintmax_t>(recorder.bytes()),
+            std::filesystem::file_size(cleanup.path));
+
+  xp2gdl90::SimPlayback playback;
+  ASSERT_TRUE(playback.open(cleanup.path.string(), &error));
+  xp2gdl90::SimTick tick;
+  ASSERT_TRUE(playback.next(&tick));
+  ASSERT_EQ(12.5, tick.ownship.broadcast_time);
+  ASSERT_EQ(5400.0, tick.ownship.pressure_altitude_ft);
+  ASSERT_TRUE(tick.ownship.gps_valid && !tick.ownship.on_ground);
+  ASSERT_EQ(std::string("N172SP"), tick.ownship.tail_number.str());
+  ASSERT_TRUE(tick.has_anchor && !tick.has_ssr_mode);
+  ASSERT_EQ(8.5, tick.anchor.origin_longitude_deg);
+  ASSERT_EQ(size_t{3}, tick.traffic.size());
+  ASSERT_EQ(0xABCDEF, tick.traffic.raw_address[2]);
+  ASSERT_EQ(-250.0f, tick.traffic.x[2]);
+  ASSERT_EQ(7600, tick.traffic.squawk[2]);
+  ASSERT_EQ(std::string("DLH4AB"), xp2gdl90::traffic::TrafficCallsignToString(
+                                     tick.traffic.callsign[2]));
+  ASSERT_EQ(uint32_t{2}, tick.traffic.source_id[2]);
+
+  ASSERT_TRUE(playback.next(&tick));
+  ASSERT_EQ(13.5, tick.ownship.broadcast_time);
+  ASSERT_TRUE(!tick.has_anchor && tick.has_ssr_mode);
+  ASSERT_EQ(size_t{1}, tick.traffic.size());
+  ASSERT_TRUE(!playback.next(&tick));
+  ASSERT_EQ(uint64_t{2}, playback.ticks());
+}
+
+TEST_CASE("Sim playback rejects foreign and truncated files") {
+  ScopedFileCleanup cleanup(MakeTempPath("inputs.xpsim"));
+  {
+    std::ofstream file(cleanup.path, std::ios::binary);
+    file << "not a recording";
+  }
+  xp2gdl90::SimPlayback playback;
+  std::string error;
+  ASSERT_TRUE(!playback.open(cleanup.path.string(), &error));
+  ASSERT_TRUE(!error.empty());
+
+  xp2gdl90::SimRecorder recorder;
+  ASSERT_TRUE(recorder.open(cleanup.path.string(), &error));
+  xp2gdl90::traffic::TrafficSnapshot traffic;
+  traffic.resize(2);
+  ASSERT_TRUE(recorder.append(xp2gdl90::OwnshipSample{}, nullptr, true,
+                              traffic));
+  recorder.close();
+  std::filesystem::resize_file(cleanup.path,
+                               std::filesystem::file_size(cleanup.path) - 4);
+  ASSERT_TRUE(playback.open(cleanup.path.string(), &error));
+  xp2gdl90::SimTick tick;
+  ASSERT_TRUE(!playback.next(&tick));
+}
@@ -1,12 +1,47 @@
 #include "test_harness.h"
 
+#include <cmath>
 #include <limits>
 #include <string>
+#include <string_view>
 
 #include "xp2gdl90/simple_json.h"
 
 namespace {
 
+// Records each event as one short token.
+class RecordingHandler : public xp2gdl90::json::Handler {
+public:
+  bool beginObject() override { return add("{"); }
+  bool key(std::string_view name) override {
+    return add("k:" + std::string(name));
+  }
+  bool endObject() override { return add("}"); }
+  bool beginArray() override { return add("["); }
+  bool endArray() override { return add("]"); }
+  bool scalar(const xp2gdl90::json::Value &value) override {
+    switch (value.type()) {
+    case xp2gdl90::json::Type::Null:
+      return add("null");
+    case xp2gdl90::json::Type::Bool:
+      return add(value.AsBool() ? "true" : "false");
+    case xp2gdl90::json::Type::Number:
+      return add(std::to_string(static_cast<int>(value.AsNumber())));
+    default:
+      return add("s:" + std::string(value.AsString()));
+    }
+  }
+
+  std::string events;
+  size_t stop_after = 0;
+
+private:
+  bool add(const std::string &event) {
+    events += events.empty() ? event : " " + event;
+    return stop_after == 0 || --stop_after != 0;
+  }
+};
+
 std::string MakeControlString(char ch) {
   std::string text;
   text.push_back('"');
@@ -18,46 +53,97 @@ std::string MakeControlString(char ch) {
 } // namespace
 
 TEST_CASE("Simple JSON parses composite values and supports object lookup") {
-  xp2gdl90::json::Value value;
+  xp2gdl90::json::Document document;
   std::string error;
   const std::string text =
       " { \"number\": -12.5e1, \"truth\": true, \"lie\": false,"
       " \"nothing\": null, \"array\": [1, \"two\", {\"nested\": 3}],"
       " \"object\": {\"child\": 4} } ";
 
-  ASSERT_TRUE(xp2gdl90::json::Parse(text, &value, &error));
+  ASSERT_TRUE(xp2gdl90::json::Parse(text, &document, &error));
   ASSERT_EQ(std::string(""), error);
+  const xp2gdl90::json::Value &value = document.root();
   ASSERT_TRUE(value.IsObject());
   ASSERT_TRUE(value.Find("missing") == nullptr);
-  ASSERT_EQ(-125.0, value.Find("number")->number_value);
-  ASSERT_TRUE(value.Find("truth")->bool_value);
-  ASSERT_TRUE(!value.Find("lie")->bool_value);
+  ASSERT_EQ(-125.0, value.Find("number")->AsNumber());
+  ASSERT_TRUE(value.Find("truth")->AsBool());
+  ASSERT_TRUE(!value.Find("lie")->AsBool());
   ASSERT_TRUE(value.Find("nothing")->IsNull());
   ASSERT_TRUE(value.Find("array")->IsArray());
   ASSERT_EQ(3.0,
-            value.Find("array")->array_values[2].Find("nested")->number_value);
-  ASSERT_EQ(4.0, value.Find("object")->Find("child")->number_value);
+            value.Find("array")->Elements()[2].Find("nested")->AsNumber());
+  ASSERT_EQ(4.0, value.Find("object")->Find("child")->AsNumber());
+  ASSERT_EQ(static_cast<size_t>(6), value.size());
+  ASSERT_EQ(std::string("number"), std::string(value.Members()[0].key));
 
   const xp2gdl90::json::Value scalar;
   ASSERT_TRUE(scalar.Find("anything") == nullptr);
+  ASSERT_TRUE(scalar.AsString().empty());
+  ASSERT_TRUE(scalar.Elements().empty());
 
-  ASSERT_TRUE(xp2gdl90::json::Parse("[]", &value, &error));
-  ASSERT_TRUE(value.IsArray());
-  ASSERT_EQ(static_cast<size_t>(0), value.array_values.size());
+  ASSERT_TRUE(xp2gdl90::json::Parse("[]", &document, &error));
+  ASSERT_TRUE(document.root().IsArray());
+  ASSERT_EQ(static_cast<size_t>(0), document.root().Elements().size());
 
-  ASSERT_TRUE(xp2gdl90::json::Parse("{}", &value, &error));
-  ASSERT_TRUE(value.IsObject());
-  ASSERT_EQ(static_cast<size_t>(0), value.object_values.size());
+  ASSERT_TRUE(xp2gdl90::json::Parse("{}", &document, &error));
+  ASSERT_TRUE(document.root().IsObject());
+  ASSERT_EQ(static_cast<size_t>(0), document.root().Members().size());
+  ASSERT_TRUE(document.root().Find("anything") == nullptr);
+}
+
+TEST_CASE("Simple JSON looks up members of large objects by hash") {
+  std::string text = "{";
+  for (int i = 0; i < 40; ++i) {
+    text += (i == 0 ? "\"key" : ",\"key") + std::to_string(i) +
+            "\":" + std::to_string(i);
+  }
+  // A duplicate key resolves to its first occurrence, as with a scan.
+  text += ",\"key7\":700}";
+
+  xp2gdl90::json::Document document;
+  std::string error;
+  ASSERT_TRUE(xp2gdl90::json::Parse(text, &document, &error));
+  const xp2gdl90::json::Value &root = document.root();
+  ASSERT_EQ(static_cast<size_t>(41), root.size());
+  for (int i = 0; i < 40; ++i) {
+    const xp2gdl90::json::Value *value =
+        root.Find("key" + std::to_string(i));
+    ASSERT_TRUE(value != nullptr);
+    ASSERT_EQ(static_cast<double>(i), value->AsNumber());
+  }
+  ASSERT_TRUE(root.Find("key40") == nullptr);
+  ASSERT_TRUE(root.Find("") == nullptr);
+}
+
+TEST_CASE("Simple JSON documents own their text") {
+  xp2gdl90::json::Document document;
+  std::string error;
+  {
+    std::string text = "{\"plain\": \"abc\", \"escaped\": \"a\\nb\"}";
+    ASSERT_TRUE(xp2gdl90::json::Parse(text, &document, &error));
+    text.assign(text.size(), 'x');
+  }
+  ASSERT_EQ(std::string("abc"),
+            std::string(document.root().Find("plain")->AsString()));
+  ASSERT_EQ(std::string("a\nb"),
+            std::string(document.root().Find("escaped")->AsString()));
+  ASSERT_TRUE(document.arena().bytesUsed() > 0);
+  ASSERT_TRUE(document.arena().bytesReserved() >=
+              document.arena().bytesUsed());
+
+  // A failed parse leaves the previous document in place.
+  ASSERT_TRUE(!xp2gdl90::json::Parse("{\"plain\":", &document, &error));
+  ASSERT_TRUE(document.root().Find("plain") != nullptr);
 }
 
 TEST_CASE("Simple JSON parses string escapes and unicode sequences") {
-  xp2gdl90::json::Value value;
+  xp2gdl90::json::Document document;
   std::string error;
   const std::string text =
       "\"\\\"\\\\\\/\\b\\f\\n\\r\\t\\u0041\\u03A9\\uD83D\\uDE80\"";
 
-  ASSERT_TRUE(xp2gdl90::json::Parse(text, &value, &error));
-  ASSERT_TRUE(value.IsString());
+  ASSERT_TRUE(xp2gdl90::json::Parse(text, &document, &error));
+  ASSERT_TRUE(document.root().IsString());
 
   std::string expected;
   expected.push_back('"');
@@ -71,23 +157,24 @@ TEST_CASE("Simple JSON parses string escapes and unicode sequences") {
   expected += "A";
   expected += "\xCE\xA9";
   expected += "\xF0\x9F\x9A\x80";
-  ASSERT_EQ(expected, value.string_value);
+  ASSERT_EQ(expected, std::string(document.root().AsString()));
 
   const std::string euro_text = R"("\u20ac")";
-  ASSERT_TRUE(xp2gdl90::json::Parse(euro_text, &value, &error));
-  ASSERT_EQ(std::string("\xE2\x82\xAC"), value.string_value);
+  ASSERT_TRUE(xp2gdl90::json::Parse(euro_text, &document, &error));
+  ASSERT_EQ(std::string("\xE2\x82\xAC"),
+            std::string(document.root().AsString()));
 }
 
 TEST_CASE("Simple JSON parses signed numeric formats") {
-  xp2gdl90::json::Value value;
+  xp2gdl90::json::Document document;
   std::string error;
 
-  ASSERT_TRUE(xp2gdl90::json::Parse("+42", &value, &error));
-  ASSERT_EQ(42.0, value.number_value);
-  ASSERT_TRUE(xp2gdl90::json::Parse("-0.25", &value, &error));
-  ASSERT_EQ(-0.25, value.number_value);
-  ASSERT_TRUE(xp2gdl90::json::Parse("6.02E2", &value, &error));
-  ASSERT_EQ(602.0, value.number_value);
+  ASSERT_TRUE(xp2gdl90::json::Parse("+42", &document, &error));
+  ASSERT_EQ(42.0, document.root().AsNumber());
+  ASSERT_TRUE(xp2gdl90::json::Parse("-0.25", &document, &error));
+  ASSERT_EQ(-0.25, document.root().AsNumber());
+  ASSERT_TRUE(xp2gdl90::json::Parse("6.02E2", &document, &error));
+  ASSERT_EQ(602.0, document.root().AsNumber());
 }
 
 TEST_CASE("Simple JSON escape helper covers control characters") {
@@ -102,110 +189,200 @@ TEST_CASE("Simple JSON reports required output and trailing text") {
   ASSERT_TRUE(!xp2gdl90::json::Parse("null", nullptr, &error));
   ASSERT_TRUE(error.find("Output JSON value is required") != std::string::npos);
 
-  xp2gdl90::json::Value value;
-  ASSERT_TRUE(!xp2gdl90::json::Parse("null x", &value, &error));
+  xp2gdl90::json::Document document;
+  ASSERT_TRUE(!xp2gdl90::json::Parse("null x", &document, &error));
   ASSERT_TRUE(error.find("Unexpected trailing characters after JSON value") !=
               std::string::npos);
 }
 
 TEST_CASE("Simple JSON reports string parsing failures") {
-  xp2gdl90::json::Value value;
+  xp2gdl90::json::Document document;
   std::string error;
 
   ASSERT_TRUE(
-      !xp2gdl90::json::Parse(MakeControlString('\x01'), &value, &error));
+      !xp2gdl90::json::Parse(MakeControlString('\x01'), &document, &error));
   ASSERT_TRUE(error.find("JSON strings cannot contain control characters") !=
               std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("\"unterminated", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("\"unterminated", &document, &error));
   ASSERT_TRUE(error.find("Unexpected end of input in JSON string") !=
               std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("\"\\", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("\"\\", &document, &error));
   ASSERT_TRUE(error.find("Unexpected end of input in JSON string escape") !=
               std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("\"\\x\"", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("\"\\x\"", &document, &error));
   ASSERT_TRUE(error.find("Invalid JSON string escape") != std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("\"\\u12G4\"", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("\"\\u12G4\"", &document, &error));
   ASSERT_TRUE(error.find("Invalid JSON unicode escape") != std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("\"\\uD800\"", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("\"\\uD800\"", &document, &error));
   ASSERT_TRUE(error.find("Invalid JSON unicode escape") != std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("\"\\uDC00\"", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("\"\\uDC00\"", &document, &error));
   ASSERT_TRUE(error.find("Invalid JSON unicode escape") != std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("\"\\uD800\\u0041\"", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("\"\\uD800\\u0041\"", &document, &error));
   ASSERT_TRUE(error.find("Invalid JSON unicode escape") != std::string::npos);
 }
 
 TEST_CASE("Simple JSON reports number parsing failures") {
-  xp2gdl90::json::Value value;
+  xp2gdl90::json::Document document;
   std::string error;
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("", &document, &error));
   ASSERT_TRUE(error.find("Unexpected end of input while parsing JSON value") !=
               std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("+", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("+", &document, &error));
   ASSERT_TRUE(error.find("Invalid JSON number") != std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("1e+", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("1e+", &document, &error));
   ASSERT_TRUE(error.find("Invalid JSON exponent") != std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("1e999", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("1e999", &document, &error));
   ASSERT_TRUE(error.find("Invalid JSON number") != std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("tru", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("tru", &document, &error));
   ASSERT_TRUE(error.find("Unexpected end of input while parsing JSON number") !=
               std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("tx", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("tx", &document, &error));
   ASSERT_TRUE(error.find("Invalid JSON number") != std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("fx", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("fx", &document, &error));
   ASSERT_TRUE(error.find("Invalid JSON number") != std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("nx", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("nx", &document, &error));
   ASSERT_TRUE(error.find("Invalid JSON number") != std::string::npos);
 }
 
 TEST_CASE("Simple JSON reports array parsing failures") {
-  xp2gdl90::json::Value value;
+  xp2gdl90::json::Document document;
   std::string error;
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("[ ", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("[ ", &document, &error));
   ASSERT_TRUE(error.find("Unexpected end of input while parsing JSON value") !=
               std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("[1", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("[1", &document, &error));
   ASSERT_TRUE(error.find("Unexpected end of input in JSON array") !=
               std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("[1 2]", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("[1 2]", &document, &error));
   ASSERT_TRUE(error.find("Expected ',' or ']' in JSON array") !=
               std::string::npos);
 }
 
 TEST_CASE("Simple JSON reports object parsing failures") {
-  xp2gdl90::json::Value value;
+  xp2gdl90::json::Document document;
   std::string error;
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("{", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("{", &document, &error));
   ASSERT_TRUE(error.find("Expected '\"' to start JSON string") !=
               std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("{\"a\" 1}", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("{\"a\" 1}", &document, &error));
   ASSERT_TRUE(error.find("Expected ':' after JSON object key") !=
               std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("{\"a\":1", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("{\"a\":1", &document, &error));
   ASSERT_TRUE(error.find("Unexpected end of input in JSON object") !=
               std::string::npos);
 
-  ASSERT_TRUE(!xp2gdl90::json::Parse("{\"a\":1 \"b\":2}", &value, &error));
+  ASSERT_TRUE(!xp2gdl90::json::Parse("{\"a\":1 \"b\":2}", &document, &error));
   ASSERT_TRUE(error.find("Expected ',' or '}' in JSON object") !=
               std::string::npos);
 }
+
+TEST_CASE("Simple JSON reader streams events in document order") {
+  xp2gdl90::json::Reader reader;
+  RecordingHandler handler;
+  std::string error;
+  ASSERT_TRUE(reader.read(
+      " {\"a\": [1, true, null], \"b\\u0041\": {\"c\": \"x\\ny\"}, \"d\": []} ",
+      &handler, &error));
+  ASSERT_EQ(std::string("{ k:a [ 1 true null ] k:bA { k:c s:x\ny } k:d [ ] }"),
+            handler.events);
+
+  // The reader can be reused, and reports the same errors Parse() does.
+  ASSERT_TRUE(!reader.read("{\"a\" 1}", &handler, &error));
+  ASSERT_TRUE(error.find("Expected ':' after JSON object key") !=
+              std::string::npos);
+  ASSERT_TRUE(!reader.read("[1] 2", &handler, &error));
+  ASSERT_TRUE(!reader.read("[1]", nullptr, &error));
+  ASSERT_EQ(std::string("JSON handler is required"), error);
+}
+
+TEST_CASE("Simple JSON reader stops when the handler says so") {
+  xp2gdl90::json::Reader reader;
+  RecordingHandler handler;
+  handler.stop_after = 3;
+  std::string error;
+  ASSERT_TRUE(!reader.read("[1, 2, 3, 4]", &handler, &error));
+  ASSERT_EQ(std::string("[ 1 2"), handler.events);
+  ASSERT_EQ(std::string("JSON reading stopped by handler"), error);
+}
+
+TEST_CASE("Simple JSON writer separates items compactly or prettily") {
+  xp2gdl90::json::Writer compact;
+  compact.beginObject();
+  compact.key("name");
+  compact.stringValue("a\"b");
+  compact.key("values");
+  compact.beginArray();
+  compact.unsignedValue(18446744073709551615ull);
+  compact.numberValue(0.1);
+  compact.numberValue(NAN);
+  compact.boolValue(false);
+  compact.nullValue();
+  compact.endArray();
+  compact.key("empty");
+  compact.beginObject();
+  compact.endObject();
+  compact.endObject();
+  ASSERT_EQ(std::string("{\"name\":\"a\\\"b\",\"values\":[18446744073709551615,"
+                        "0.1,null,false,null],\"empty\":{}}"),
+            compact.text());
+
+  // clear() starts a new document.
+  compact.clear();
+  compact.beginArray(true);
+  compact.endArray();
+  ASSERT_EQ(std::string("[]"), compact.text());
+
+  xp2gdl90::json::Writer pretty(true);
+  pretty.beginObject(true);
+  pretty.key("list");
+  pretty.beginArray(true);
+  pretty.beginObject();
+  pretty.key("x");
+  pretty.numberValue(1.5);
+  pretty.key("y");
+  pretty.beginArray();
+  pretty.stringValue("p");
+  pretty.stringValue("q");
+  pretty.endArray();
+  pretty.endObject();
+  pretty.numberValue(2);
+  pretty.endArray();
+  pretty.key("none");
+  pretty.beginArray(true);
+  pretty.endArray();
+  pretty.endObject();
+  ASSERT_EQ(std::string("{\n"
+                        "  \"list\": [\n"
+                        "    {\"x\": 1.5, \"y\": [\"p\", \"q\"]},\n"
+                        "    2\n"
+                        "  ],\n"
+                        "  \"none\": []\n"
+                        "}"),
+            pretty.text());
+
+  xp2gdl90::json::Document document;
+  std::string error;
+  ASSERT_TRUE(xp2gdl90::json::Parse(pretty.text(), &document, &error));
+  ASSERT_EQ(2.0, document.root().Find("list")->Elements()[1].AsNumber());
+}
@@ -0,0 +1,61 @@
+#include "test_harness.h"
+
+#include <cstdint>
+#include <thread>
+
+#include "xp2gdl90/spsc_ring.h"
+
+TEST_CASE("SPSC ring rounds capacity up and reports full") {
+  udp::SpscRing<int> ring(5);
+  ASSERT_EQ(static_cast<size_t>(8), ring.capacity());
+  ASSERT_EQ(static_cast<size_t>(8), ring.freeSlots());
+
+  for (int i = 0; i < 8; ++i) {
+    int *slot = ring.producerSlot();
+    ASSERT_TRUE(slot != nullptr);
+    *slot = i;
+    ring.publish();
+  }
+  ASSERT_TRUE(ring.producerSlot() == nullptr);
+  ASSERT_EQ(static_cast<size_t>(8), ring.readable());
+  ASSERT_EQ(0, ring.peek(0));
+  ASSERT_EQ(7, ring.peek(7));
+
+  ring.release(3);
+  ASSERT_EQ(static_cast<size_t>(3), ring.freeSlots());
+  ASSERT_EQ(3, ring.peek(0));
+}
+
+TEST_CASE("SPSC ring preserves order across threads and wraparound") {
+  udp::SpscRing<uint32_t> ring(16);
+  constexpr uint32_t kCount = 100000;
+
+  std::thread producer([&ring] {
+    for (uint32_t value = 0; value < kCount;) {
+      if (uint32_t *slot = ring.producerSlot()) {
+        *slot = value++;
+        ring.publish();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0;
+  bool in_order = true;
+  while (expected < kCount) {
+    const size_t readable = ring.readable();
+    for (size_t i = 0; i < readable; ++i) {
+      in_order = in_order && ring.peek(i) == expected;
+      ++expected;
+    }
+    ring.release(readable);
+    if (readable == 0) {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  ASSERT_TRUE(in_order);
+  ASSERT_EQ(static_cast<size_t>(0), ring.readable());
+}
@@ -0,0 +1,91 @@
+#include "test_harness.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "xp2gdl90/stage_timing.h"
+
+using xp2gdl90::LatencyHistogram;
+using xp2gdl90::Stage;
+using xp2gdl90::StageTimings;
+
+TEST_CASE("Latency histogram buckets are contiguous and tight") {
+  ASSERT_EQ(size_t{0}, LatencyHistogram::bucketIndex(0));
+  ASSERT_EQ(size_t{3}, LatencyHistogram::bucketIndex(3));
+  size_t previous = 0;
+  for (uint64_t ns = 1; ns < (uint64_t{1} << 20); ns = ns * 9 / 8 + 1) {
+    const size_t bucket = LatencyHistogram::bucketIndex(ns);
+    ASSERT_TRUE(bucket >= previous);
+    ASSERT_TRUE(ns <= LatencyHistogram::bucketUpperNs(bucket));
+    ASSERT_TRUE(LatencyHistogram::bucketUpperNs(bucket) <= ns + ns / 4);
+    ASSERT_EQ(bucket, LatencyHistogram::bucketIndex(
+                          LatencyHistogram::bucketUpperNs(bucket)));
+    previous = bucket;
+  }
+  ASSERT_EQ(xp2gdl90::LATENCY_HISTOGRAM_BUCKETS - 1,
+            LatencyHistogram::bucketIndex(~uint64_t{0}));
+}
+
+TEST_CASE("Stage keys are snake case stage names") {
+  ASSERT_EQ(std::string("sim_read"), std::string(xp2gdl90::StageKey(
+                                         Stage::SIM_READ)));
+  ASSERT_EQ(std::string("encode"),
+            std::string(xp2gdl90::StageKey(Stage::ENCODE)));
+}
+
+TEST_CASE("Latency histogram percentiles") {
+  LatencyHistogram histogram;
+  ASSERT_EQ(uint64_t{0}, histogram.percentileNs(0.5));
+  for (int i = 0; i < 98; ++i) {
+    histogram.record(1000);
+  }
+  histogram.record(50000);
+  histogram.record(2000000);
+  ASSERT_EQ(uint64_t{100}, histogram.count());
+  ASSERT_EQ(uint64_t{2000000}, histogram.maxNs());
+  const uint64_t p50 = histogram.percentileNs(0.5);
+  ASSERT_TRUE(p50 >= 1000 && p50 < 1250);
+  const uint64_t p99 = histogram.percentileNs(0.99);
+  ASSERT_TRUE(p99 >= 50000 && p99 < 62500);
+  ASSERT_EQ(uint64_t{2000000}, histogram.percentileNs(1.0));
+  histogram.reset();
+  ASSERT_EQ(uint64_t{0}, histogram.count());
+}
+
+TEST_CASE("Stage timings record stages that ran each tick") {
+  StageTimings timings;
+  timings.add(Stage::ENCODE, 400);
+  timings.add(Stage::ENCODE, 600);
+  timings.add(Stage::SEND, 2000);
+  timings.endTick();
+  ASSERT_EQ(uint64_t{3000}, timings.lastTickNs());
+  timings.add(Stage::ENCODE, 300);
+  timings.endTick();
+  ASSERT_EQ(uint64_t{300}, timings.lastTickNs());
+  ASSERT_EQ(uint64_t{2}, timings.ticks());
+  ASSERT_EQ(uint64_t{2}, timings.histogram(Stage::ENCODE).count());
+  ASSERT_EQ(uint64_t{1000}, timings.histogram(Stage::ENCODE).maxNs());
+  ASSERT_EQ(uint64_t{1}, timings.histogram(Stage::SEND).count());
+  ASSERT_EQ(uint64_t{0}, timings.histogram(Stage::TRAFFIC).count());
+  ASSERT_EQ(std::string("Sim read"),
+            std::string(xp2gdl90::StageName(Stage::SIM_READ)));
+  timings.reset();
+  ASSERT_EQ(uint64_t{0}, timings.histogram(Stage::ENCODE).count());
+  ASSERT_EQ(uint64_t{0}, timings.lastTickNs());
+}
+
+TEST_CASE("Scoped stage timers exclude nested stages") {
+  StageTimings timings;
+  {
+    xp2gdl90::ScopedStageTimer encode(&timings, Stage::ENCODE);
+    xp2gdl90::ScopedStageTimer send(&timings, Stage::SEND);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  { xp2gdl90::ScopedStageTimer untimed(nullptr, Stage::CLOCK); }
+  timings.endTick();
+  const uint64_t send_ns = timings.histogram(Stage::SEND).maxNs();
+  ASSERT_TRUE(send_ns >= 20000000u);
+  ASSERT_TRUE(timings.histogram(Stage::ENCODE).maxNs() < send_ns / 4);
+  ASSERT_EQ(uint64_t{0}, timings.histogram(Stage::CLOCK).count());
+}
@@ -0,0 +1,84 @@
+#include "test_harness.h"
+
+#include <string>
+
+#include "xp2gdl90/stats_history.h"
+
+using xp2gdl90::StatsCounters;
+using xp2gdl90::StatsHistory;
+using xp2gdl90::StatsSeries;
+
+namespace {
+
+StatsCounters Counters(uint64_t frames, uint64_t bytes, uint32_t targets,
+                       uint64_t send_errors) {
+  StatsCounters counters;
+  counters.frames = frames;
+  counters.bytes = bytes;
+  counters.targets = targets;
+  counters.send_errors = send_errors;
+  return counters;
+}
+
+} // namespace
+
+TEST_CASE("Stats history samples rates once a second") {
+  StatsHistory history;
+  ASSERT_TRUE(!history.update(10.0, Counters(100, 4000, 3, 0)));
+  history.recordTick(20000);
+  history.recordTick(90000);
+  ASSERT_TRUE(!history.update(10.5, Counters(115, 4600, 3, 0)));
+  ASSERT_TRUE(history.update(11.0, Counters(130, 5200, 4, 1)));
+  ASSERT_EQ(static_cast<size_t>(1), history.size());
+  ASSERT_EQ(30.0f, history.latest(StatsSeries::FRAMES_PER_S));
+  ASSERT_EQ(1200.0f, history.latest(StatsSeries::BYTES_PER_S));
+  ASSERT_EQ(4.0f, history.latest(StatsSeries::TARGETS));
+  ASSERT_EQ(1.0f, history.latest(StatsSeries::SEND_ERRORS));
+  // The p99 is the upper edge of the 90 us tick's bucket.
+  const float p99 = history.latest(StatsSeries::TICK_P99_US);
+  ASSERT_TRUE(p99 >= 90.0f && p99 <= 90.0f * 1.25f);
+
+  // The next sample's tick latency starts from its own ticks, and a pause
+  // averages over the gap.
+  ASSERT_TRUE(history.update(15.0, Counters(170, 5200, 4, 1)));
+  ASSERT_EQ(10.0f, history.latest(StatsSeries::FRAMES_PER_S));
+  ASSERT_EQ(0.0f, history.latest(StatsSeries::TICK_P99_US));
+  ASSERT_EQ(30.0f, history.peak(StatsSeries::FRAMES_PER_S));
+  ASSERT_EQ(std::string("Frames/s"),
+            std::string(xp2gdl90::StatsSeriesName(StatsSeries::FRAMES_PER_S)));
+}
+
+TEST_CASE("Stats history rebaselines when totals or the clock go back") {
+  StatsHistory history;
+  history.update(0.0, Counters(500, 0, 0, 0));
+  // The engine's counters were reset.
+  ASSERT_TRUE(!history.update(1.0, Counters(10, 0, 0, 0)));
+  ASSERT_TRUE(!history.update(0.5, Counters(20, 0, 0, 0)));
+  ASSERT_TRUE(history.update(1.5, Counters(40, 0, 0, 0)));
+  ASSERT_EQ(static_cast<size_t>(1), history.size());
+  ASSERT_EQ(20.0f, history.latest(StatsSeries::FRAMES_PER_S));
+  history.reset();
+  ASSERT_EQ(static_cast<size_t>(0), history.size());
+  ASSERT_EQ(0.0f, history.latest(StatsSeries::FRAMES_PER_S));
+  ASSERT_TRUE(!history.update(2.0, Counters(40, 0, 0, 0)));
+}
+
+TEST_CASE("Stats history keeps the newest samples in a fixed ring") {
+  StatsHistory history;
+  const size_t extra = 25;
+  for (size_t i = 0; i <= xp2gdl90::STATS_HISTORY_SAMPLES + extra; ++i) {
+    history.update(static_cast<double>(i),
+                   Counters(0, 0, static_cast<uint32_t>(i), 0));
+  }
+  ASSERT_EQ(xp2gdl90::STATS_HISTORY_SAMPLES, history.size());
+  ASSERT_EQ(extra, history.offset());
+  ASSERT_EQ(static_cast<float>(extra + 1),
+            history.value(StatsSeries::TARGETS, 0));
+  ASSERT_EQ(static_cast<float>(xp2gdl90::STATS_HISTORY_SAMPLES + extra),
+            history.latest(StatsSeries::TARGETS));
+  ASSERT_EQ(history.latest(StatsSeries::TARGETS),
+            history.peak(StatsSeries::TARGETS));
+  // The oldest sample sits at offset() in the raw ring.
+  ASSERT_EQ(history.value(StatsSeries::TARGETS, 0),
+            history.data(StatsSeries::TARGETS)[history.offset()]);
+}
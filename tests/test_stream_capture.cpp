@@ -0,0 +1,160 @@
+#include "test_harness.h"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "fake_socket_ops.h"
+#include "xp2gdl90/gdl90_decoder.h"
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/stream_capture.h"
+#include "xp2gdl90/udp_broadcaster.h"
+
+namespace {
+
+constexpr size_t kFileHeaderSize = 24;
+constexpr size_t kSlotSize = 16 + udp::CAPTURE_RECORD_DATA;
+
+std::filesystem::path MakeTempPath(const char *suffix) {
+  const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+  return std::filesystem::temp_directory_path() /
+         ("xp2gdl90_" + std::to_string(now) + "_" + suffix);
+}
+
+struct ScopedFileCleanup {
+  explicit ScopedFileCleanup(std::filesystem::path file_path)
+      : path(std::move(file_path)) {}
+
+  ~ScopedFileCleanup() {
+    std::error_code error;
+    std::filesystem::remove(path, error);
+  }
+
+  std::filesystem::path path;
+};
+
+std::vector<uint8_t> ReadFile(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file),
+                              std::istreambuf_iterator<char>());
+}
+
+uint32_t Read32(const std::vector<uint8_t> &bytes, size_t offset) {
+  uint32_t value = 0;
+  std::memcpy(&value, bytes.data() + offset, sizeof(value));
+  return value;
+}
+
+udp::CaptureRecordHeader RecordAt(const std::vector<uint8_t> &file,
+                                  size_t slot) {
+  udp::CaptureRecordHeader header;
+  std::memcpy(&header, file.data() + kFileHeaderSize + slot * kSlotSize + 16,
+              sizeof(header));
+  return header;
+}
+
+const uint8_t *RecordData(const std::vector<uint8_t> &file, size_t slot) {
+  return file.data() + kFileHeaderSize + slot * kSlotSize + 16 +
+         sizeof(udp::CaptureRecordHeader);
+}
+
+} // namespace
+
+TEST_CASE("Stream capture writes a pcap ring of fixed records") {
+  ScopedFileCleanup cleanup(MakeTempPath("capture.pcap"));
+  udp::StreamCapture capture;
+  std::string error;
+  ASSERT_TRUE(capture.open(cleanup.path.string(), 0, &error));
+  const size_t slots = capture.stats().slots;
+  ASSERT_EQ((udp::CAPTURE_MIN_BYTES - kFileHeaderSize) / kSlotSize, slots);
+
+  gdl90::GDL90Encoder encoder;
+  const std::vector<uint8_t> heartbeat = encoder.createHeartbeat(true, true);
+  capture.record(heartbeat.data(), heartbeat.size(), 2);
+  // A packed datagram longer than one record is cut between frames.
+  std::vector<uint8_t> packed;
+  gdl90::PositionData report;
+  for (uint32_t i = 0; i < 6; ++i) {
+    report.icao_address = 0xABC000 + i;
+    const std::vector<uint8_t> frame = encoder.createTrafficReport(report);
+    packed.insert(packed.end(), frame.begin(), frame.end());
+  }
+  capture.record(packed.data(), packed.size(), 0);
+  capture.close();
+
+  const std::vector<uint8_t> file = ReadFile(cleanup.path);
+  ASSERT_EQ(kFileHeaderSize + slots * kSlotSize, file.size());
+  ASSERT_EQ(0xA1B23C4Du, Read32(file, 0));
+  ASSERT_EQ(udp::CAPTURE_LINKTYPE, Read32(file, 20));
+
+  udp::CaptureRecordHeader first = RecordAt(file, 0);
+  ASSERT_EQ(1u, first.sequence);
+  ASSERT_EQ(2, static_cast<int>(first.destination));
+  ASSERT_EQ(heartbeat.size(), static_cast<size_t>(first.size));
+  ASSERT_TRUE(std::memcmp(RecordData(file, 0), heartbeat.data(),
+                          heartbeat.size()) == 0);
+
+  // The traffic records decode back to all six reports, in order.
+  size_t decoded = 0;
+  for (size_t slot = 1; RecordAt(file, slot).sequence != 0; ++slot) {
+    const udp::CaptureRecordHeader header = RecordAt(file, slot);
+    ASSERT_EQ(0, static_cast<int>(header.flags));
+    ASSERT_TRUE(header.size <= udp::CAPTURE_FRAME_BYTES);
+    gdl90::Decoder decoder(RecordData(file, slot), header.size);
+    gdl90::FrameSpan frame;
+    while (decoder.next(&frame)) {
+      gdl90::PositionData data;
+      ASSERT_TRUE(gdl90::DecodePositionReport(frame, &data));
+      ASSERT_EQ(0xABC000u + decoded, data.icao_address);
+      ++decoded;
+    }
+  }
+  ASSERT_EQ(static_cast<size_t>(6), decoded);
+  // Unused slots are still walkable, empty records.
+  ASSERT_EQ(static_cast<uint32_t>(udp::CAPTURE_RECORD_DATA),
+            Read32(file, kFileHeaderSize + (slots - 1) * kSlotSize + 8));
+}
+
+TEST_CASE("Stream capture wraps and records what the broadcaster sends") {
+  ScopedFileCleanup cleanup(MakeTempPath("capture_wrap.pcap"));
+  udp::StreamCapture capture;
+  std::string error;
+  ASSERT_TRUE(capture.open(cleanup.path.string(), 0, &error));
+  const size_t slots = capture.stats().slots;
+
+  xp2gdl90::test::FakeSocketOps ops;
+  ops.create_socket_result = 42;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  ASSERT_TRUE(broadcaster.addDestination("127.0.0.2", 4001));
+  broadcaster.setCapture(&capture);
+
+  std::vector<uint8_t> datagram = {0x7E, 0x00, 0x00, 0x7E};
+  for (size_t i = 0; i < slots + 3; ++i) {
+    datagram[1] = static_cast<uint8_t>(i);
+    // Only the second destination is selected.
+    ops.sendto_result = static_cast<intptr_t>(datagram.size());
+    broadcaster.send(datagram.data(), datagram.size(), 0x2u);
+  }
+  // A failed send is not recorded.
+  ops.sendto_result = -1;
+  broadcaster.send(datagram.data(), datagram.size(), 0x2u);
+  broadcaster.setCapture(nullptr);
+
+  const udp::StreamCaptureStats stats = capture.stats();
+  ASSERT_EQ(static_cast<uint64_t>(slots + 3), stats.records);
+  ASSERT_EQ(static_cast<uint64_t>(1), stats.wraps);
+  capture.close();
+
+  const std::vector<uint8_t> file = ReadFile(cleanup.path);
+  // The newest three records overwrote the oldest.
+  const udp::CaptureRecordHeader newest = RecordAt(file, 2);
+  ASSERT_EQ(static_cast<uint32_t>(slots + 3), newest.sequence);
+  ASSERT_EQ(1, static_cast<int>(newest.destination));
+  ASSERT_EQ(static_cast<uint8_t>(slots + 2), RecordData(file, 2)[1]);
+  ASSERT_EQ(static_cast<uint32_t>(4), RecordAt(file, 3).sequence);
+}
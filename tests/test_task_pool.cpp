@@ -0,0 +1,134 @@
+#include "test_harness.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xp2gdl90/task_pool.h"
+
+namespace {
+
+// Runs a parallelFor and checks that every index was covered exactly once
+// by chunks that start on a multiple of `grain`.
+bool CoversEveryIndexOnce(xp2gdl90::TaskPool *pool, size_t count,
+                          size_t grain) {
+  std::vector<std::atomic<int>> hits(count);
+  std::atomic<bool> aligned{true};
+  pool->parallelFor(count, grain, [&](size_t begin, size_t end) {
+    if (begin % grain != 0 || end - begin > grain || end > count) {
+      aligned.store(false);
+    }
+    for (size_t i = begin; i < end; ++i) {
+      hits[i].fetch_add(1);
+    }
+  });
+  for (const std::atomic<int> &hit : hits) {
+    if (hit.load() != 1) {
+      return false;
+    }
+  }
+  return aligned.load();
+}
+
+} // namespace
+
+TEST_CASE("Task pool without threads runs every chunk on the caller") {
+  xp2gdl90::TaskPool pool;
+  ASSERT_EQ(static_cast<size_t>(0), pool.threads());
+  const std::thread::id caller = std::this_thread::get_id();
+  bool on_caller = true;
+  size_t chunks = 0;
+  pool.parallelFor(10, 4, [&](size_t, size_t) {
+    on_caller = on_caller && std::this_thread::get_id() == caller;
+    ++chunks;
+  });
+  ASSERT_TRUE(on_caller);
+  ASSERT_EQ(static_cast<size_t>(3), chunks);
+  ASSERT_TRUE(CoversEveryIndexOnce(&pool, 10, 4));
+}
+
+TEST_CASE("Task pool covers every index once for any count and grain") {
+  xp2gdl90::TaskPool pool;
+  std::string error;
+  ASSERT_TRUE(pool.start(3, &error));
+  ASSERT_EQ(static_cast<size_t>(3), pool.threads());
+  const size_t counts[] = {0, 1, 7, 64, 100, 1000, 2001};
+  const size_t grains[] = {1, 3, 32, 128, 5000};
+  for (size_t count : counts) {
+    for (size_t grain : grains) {
+      ASSERT_TRUE(CoversEveryIndexOnce(&pool, count, grain));
+    }
+  }
+  // Back-to-back jobs reuse the same threads.
+  for (int round = 0; round < 200; ++round) {
+    ASSERT_TRUE(CoversEveryIndexOnce(&pool, 257, 16));
+  }
+  pool.stop();
+  ASSERT_EQ(static_cast<size_t>(0), pool.threads());
+  ASSERT_TRUE(CoversEveryIndexOnce(&pool, 50, 8));
+}
+
+TEST_CASE("Task pool steals from a participant stuck on a slow chunk") {
+  xp2gdl90::TaskPool pool;
+  std::string error;
+  ASSERT_TRUE(pool.start(1, &error));
+  // The helper's share starts with chunk 0, which stalls; the caller finishes
+  // its own share and then takes the rest of the helper's.
+  std::vector<std::atomic<int>> hits(64);
+  pool.parallelFor(hits.size(), 1, [&](size_t begin, size_t) {
+    if (begin == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    hits[begin].fetch_add(1);
+  });
+  for (const std::atomic<int> &hit : hits) {
+    ASSERT_EQ(1, hit.load());
+  }
+  ASSERT_TRUE(pool.steals() > 0);
+}
+
+TEST_CASE("Task pool callers on different threads take turns") {
+  xp2gdl90::TaskPool pool;
+  std::string error;
+  ASSERT_TRUE(pool.start(2, &error));
+  std::atomic<bool> ok{true};
+  auto caller = [&] {
+    for (int round = 0; round < 100; ++round) {
+      if (!CoversEveryIndexOnce(&pool, 300, 10)) {
+        ok.store(false);
+      }
+    }
+  };
+  std::thread other(caller);
+  caller();
+  other.join();
+  ASSERT_TRUE(ok.load());
+}
+
+TEST_CASE("Chunk buffers merge in chunk order up to a limit") {
+  xp2gdl90::ChunkBuffers<int> buffers;
+  buffers.reset(3);
+  buffers[2].push_back(5);
+  buffers[0].push_back(1);
+  buffers[0].push_back(2);
+  buffers[2].push_back(6);
+  buffers[1].push_back(3);
+
+  std::vector<int> merged = {0};
+  ASSERT_EQ(static_cast<size_t>(5), buffers.appendTo(&merged));
+  ASSERT_TRUE(merged == std::vector<int>({0, 1, 2, 3, 5, 6}));
+
+  merged.clear();
+  ASSERT_EQ(static_cast<size_t>(3), buffers.appendTo(&merged, 3));
+  ASSERT_TRUE(merged == std::vector<int>({1, 2, 3}));
+
+  // A smaller reset leaves the spare buffers out of the merge.
+  buffers.reset(1);
+  buffers[0].push_back(9);
+  merged.clear();
+  buffers.appendTo(&merged);
+  ASSERT_TRUE(merged == std::vector<int>({9}));
+}
@@ -0,0 +1,120 @@
+#include "test_harness.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "xp2gdl90/tcas_traffic.h"
+
+using xp2gdl90::traffic::TcasReportContext;
+using xp2gdl90::traffic::TrafficSnapshot;
+
+namespace {
+
+// Ownship in row 0 and one target 2 km east, 300 m above.
+TrafficSnapshot MakeSnapshot() {
+  TrafficSnapshot snapshot;
+  snapshot.resize(2);
+  for (size_t row = 0; row < snapshot.size(); ++row) {
+    snapshot.source_id[row] = static_cast<uint32_t>(row);
+  }
+  snapshot.raw_address[1] = static_cast<int>(0x80ABCDEFu);
+  snapshot.x[1] = 2000.0f;
+  snapshot.y[1] = 300.0f;
+  snapshot.vx[1] = 0.0f;
+  snapshot.vz[1] = -60.0f;
+  snapshot.ssr_mode[1] = 3;
+  snapshot.squawk[1] = 7700;
+  snapshot.wake_category[1] = 1;
+  return snapshot;
+}
+
+xp2gdl90::traffic::ProjectionAnchor MakeAnchor() {
+  xp2gdl90::traffic::ProjectionAnchor anchor;
+  anchor.latitude_deg = 47.0;
+  anchor.longitude_deg = 8.0;
+  anchor.altitude_m = 1000.0;
+  anchor.origin_latitude_deg = 47.0;
+  anchor.origin_longitude_deg = 8.0;
+  return anchor;
+}
+
+xp2gdl90::traffic::TrafficSelection MakeSelection() {
+  xp2gdl90::traffic::TrafficSelection selection;
+  selection.max_targets = 10;
+  return selection;
+}
+
+} // namespace
+
+TEST_CASE("TCAS helpers map squawks, addresses and tracks") {
+  using namespace xp2gdl90::traffic;
+  ASSERT_EQ(1, static_cast<int>(EmergencyCodeFromSquawk(7700)));
+  ASSERT_EQ(4, static_cast<int>(EmergencyCodeFromSquawk(7600)));
+  ASSERT_EQ(0, static_cast<int>(EmergencyCodeFromSquawk(1200)));
+  ASSERT_TRUE(ResolveTcasAddressType(static_cast<int>(0x80ABCDEFu)) ==
+              gdl90::AddressType::ADSB_ICAO);
+  ASSERT_TRUE(ResolveTcasAddressType(0x00ABCDEF) ==
+              gdl90::AddressType::ADSB_SELF_ASSIGNED);
+  ASSERT_EQ(std::string("VABCDEF"), FallbackTrafficCallsign(0xABCDEF).str());
+
+  uint16_t track = 0;
+  gdl90::TrackType type = gdl90::TrackType::INVALID;
+  ResolveTrafficTrack(10.0f, 0.0f, 200.0f, &track, &type);
+  ASSERT_EQ(90, static_cast<int>(track));
+  ASSERT_TRUE(type == gdl90::TrackType::TRUE_TRACK);
+  // Too slow for a track: the heading is used.
+  ResolveTrafficTrack(0.1f, 0.0f, -45.0f, &track, &type);
+  ASSERT_EQ(315, static_cast<int>(track));
+  ASSERT_TRUE(type == gdl90::TrackType::TRUE_HEADING);
+  ResolveTrafficTrack(0.0f, 0.0f, NAN, &track, &type);
+  ASSERT_TRUE(type == gdl90::TrackType::INVALID);
+}
+
+TEST_CASE("TCAS collection projects targets and builds reports") {
+  TrafficSnapshot snapshot = MakeSnapshot();
+  TcasReportContext context;
+  context.nic = 8;
+  context.nacp = 9;
+  context.ownship_address = 0x123456;
+  const xp2gdl90::traffic::LocalProjection projection(MakeAnchor());
+  std::vector<xp2gdl90::traffic::TrafficCandidate> candidates;
+  std::vector<gdl90::PositionData> reports;
+
+  ASSERT_EQ(size_t{1}, xp2gdl90::traffic::CollectTcasTraffic(
+                           MakeSelection(), context,
+                           &projection, 20000.0, &snapshot, &candidates,
+                           &reports));
+  const gdl90::PositionData &report = reports[0];
+  ASSERT_EQ(0xABCDEFu, report.icao_address);
+  ASSERT_TRUE(report.address_type == gdl90::AddressType::ADSB_ICAO);
+  ASSERT_EQ(std::string("VABCDEF"), report.callsign.str());
+  ASSERT_EQ(1, static_cast<int>(report.emergency_code));
+  ASSERT_TRUE(report.emitter_category == gdl90::EmitterCategory::LARGE);
+  ASSERT_EQ(0, static_cast<int>(report.track));
+  ASSERT_TRUE(report.airborne);
+  ASSERT_EQ(8, static_cast<int>(report.nic));
+  ASSERT_TRUE(report.longitude > 8.02 && report.longitude < 8.03);
+  ASSERT_TRUE(report.altitude > 4260 && report.altitude < 4270);
+}
+
+TEST_CASE("TCAS reports hide Mode A altitude and need a position") {
+  TrafficSnapshot snapshot = MakeSnapshot();
+  snapshot.ssr_mode[1] = 2;
+  TcasReportContext context;
+  const xp2gdl90::traffic::LocalProjection projection(MakeAnchor());
+  std::vector<xp2gdl90::traffic::TrafficCandidate> candidates;
+  std::vector<gdl90::PositionData> reports;
+  xp2gdl90::traffic::CollectTcasTraffic(MakeSelection(),
+                                        context, &projection, 20000.0,
+                                        &snapshot, &candidates, &reports);
+  ASSERT_EQ(size_t{1}, reports.size());
+  ASSERT_EQ(std::numeric_limits<int32_t>::min(), reports[0].altitude);
+
+  // Beyond the projection radius and without an exact conversion.
+  snapshot = MakeSnapshot();
+  xp2gdl90::traffic::CollectTcasTraffic(MakeSelection(),
+                                        context, &projection, 1000.0,
+                                        &snapshot, &candidates, &reports);
+  ASSERT_TRUE(reports.empty());
+}
@@ -0,0 +1,114 @@
+#include "test_harness.h"
+
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "xp2gdl90/thread_tuning.h"
+
+using xp2gdl90::ThreadPriority;
+using xp2gdl90::ThreadTuning;
+using xp2gdl90::WakeLatencyMeter;
+
+TEST_CASE("Wake latency meter counts marks the worker wakes for") {
+  WakeLatencyMeter meter;
+  meter.woke(1000000, true);
+  ASSERT_EQ(static_cast<uint64_t>(0), meter.stats().samples);
+
+  // A second notify before the wake keeps the first mark.
+  meter.notified(1000000);
+  meter.notified(1200000);
+  meter.woke(1250000, true);
+  ASSERT_EQ(static_cast<uint64_t>(1), meter.stats().samples);
+  ASSERT_EQ(static_cast<uint64_t>(250), meter.stats().last_us);
+
+  // A timed-out wait drops the mark.
+  meter.notified(2000000);
+  meter.woke(9000000, false);
+  meter.woke(9100000, true);
+  ASSERT_EQ(static_cast<uint64_t>(1), meter.stats().samples);
+
+  meter.notified(10000000);
+  meter.woke(10050000, true);
+  meter.record(-5000);
+  const xp2gdl90::WakeLatencyStats stats = meter.stats();
+  ASSERT_EQ(static_cast<uint64_t>(3), stats.samples);
+  ASSERT_EQ(static_cast<uint64_t>(300), stats.sum_us);
+  ASSERT_EQ(static_cast<uint64_t>(250), stats.max_us);
+  ASSERT_EQ(static_cast<uint64_t>(0), stats.last_us);
+  ASSERT_TRUE(stats.averageUs() == 100.0);
+}
+
+TEST_CASE("Worker thread tuning follows the settings") {
+  xp2gdl90::Settings cfg;
+  ASSERT_TRUE(xp2gdl90::MakeWorkerThreadTuning(cfg) == ThreadTuning{});
+  cfg.worker_thread_priority = 2;
+  cfg.worker_cpu_mask = 0x6;
+  const ThreadTuning tuning = xp2gdl90::MakeWorkerThreadTuning(cfg);
+  ASSERT_TRUE(tuning.priority == ThreadPriority::TIME_CRITICAL);
+  ASSERT_EQ(0x6u, tuning.cpu_mask);
+  ASSERT_EQ(std::string("Time-critical"),
+            std::string(xp2gdl90::ThreadPriorityName(tuning.priority)));
+}
+
+TEST_CASE("Thread tuning slot applies a posted tuning once") {
+  xp2gdl90::ThreadTuningSlot slot;
+  ASSERT_TRUE(slot.applyPending());
+  ASSERT_TRUE(slot.ok());
+
+  bool applied = false;
+  std::string error = "unset";
+  // On a thread of its own, so the test runner keeps its scheduling.
+  std::thread worker([&] {
+    slot.set(ThreadTuning{});
+    applied = slot.applyPending();
+    error = slot.lastError();
+  });
+  worker.join();
+  ASSERT_TRUE(applied);
+  ASSERT_TRUE(error.empty());
+}
+
+#if defined(__linux__)
+TEST_CASE("Thread tuning pins the calling thread to the mask") {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  int cpu = 0;
+  while (cpu < 32 && !CPU_ISSET(cpu, &allowed)) {
+    ++cpu;
+  }
+  if (cpu == 32) {
+    return;
+  }
+
+  bool pinned = false;
+  bool released = false;
+  std::string error;
+  std::thread worker([&] {
+    ThreadTuning tuning;
+    tuning.cpu_mask = 1u << cpu;
+    if (!xp2gdl90::ApplyThreadTuning(tuning, &error)) {
+      return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+    pinned = CPU_COUNT(&set) == 1 && CPU_ISSET(cpu, &set);
+
+    if (!xp2gdl90::ApplyThreadTuning(ThreadTuning{}, &error)) {
+      return;
+    }
+    pthread_getaffinity_np(pthread_self(), sizeof(set), &set);
+    released = CPU_COUNT(&set) == CPU_COUNT(&allowed);
+  });
+  worker.join();
+  ASSERT_EQ(std::string(""), error);
+  ASSERT_TRUE(pinned);
+  ASSERT_TRUE(released);
+}
+#endif
@@ -0,0 +1,138 @@
+#include "test_harness.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include "xp2gdl90/track_history.h"
+
+using xp2gdl90::traffic::FitTrackTrend;
+using xp2gdl90::traffic::FitTrackTrendScalar;
+using xp2gdl90::traffic::TrackHistory;
+using xp2gdl90::traffic::TrackTrend;
+
+namespace {
+
+constexpr double kMetersPerDegree = 6371008.8 * 3.14159265358979323846 / 180.0;
+
+// A target flying north-east at 100 m/s and climbing 1200 fpm, sampled
+// once a second.
+void FlyNorthEast(TrackHistory *history, int samples, double start = 0.0) {
+  const double component = 100.0 / std::sqrt(2.0);
+  const double east_scale =
+      kMetersPerDegree * std::cos(47.0 * 3.14159265358979323846 / 180.0);
+  for (int i = 0; i < samples; ++i) {
+    const double t = start + static_cast<double>(i);
+    history->push(t, 47.0 + component * t / kMetersPerDegree,
+                  8.0 + component * t / east_scale, 3000.0 + 20.0 * t);
+  }
+}
+
+} // namespace
+
+TEST_CASE("Track history keeps the newest samples in a fixed ring") {
+  TrackHistory history;
+  for (int i = 0; i < 11; ++i) {
+    history.push(static_cast<double>(i), 47.0, 8.0, 1000.0);
+  }
+  ASSERT_EQ(8, static_cast<int>(history.count));
+  ASSERT_EQ(3, static_cast<int>(history.next));
+  ASSERT_EQ(10.0, history.time[2]);
+  ASSERT_EQ(3.0, history.time[3]);
+
+  // A repeated time replaces the newest sample; an earlier one restarts.
+  history.push(10.0, 47.5, 8.0, 1000.0);
+  ASSERT_EQ(8, static_cast<int>(history.count));
+  ASSERT_EQ(47.5, history.latitude_deg[2]);
+  history.push(2.0, 47.0, 8.0, 1000.0);
+  ASSERT_EQ(1, static_cast<int>(history.count));
+}
+
+TEST_CASE("Track trend fits ground speed, track and vertical rate") {
+  TrackHistory history;
+  FlyNorthEast(&history, 12);
+  TrackTrend trend;
+  ASSERT_TRUE(FitTrackTrend(history, 1.0, &trend));
+  ASSERT_TRUE(trend.has_velocity);
+  ASSERT_TRUE(std::fabs(trend.ground_speed_mps - 100.0) < 0.5);
+  ASSERT_TRUE(std::fabs(trend.track_deg - 45.0) < 0.5);
+  ASSERT_TRUE(trend.has_vertical_rate);
+  ASSERT_TRUE(std::fabs(trend.vertical_rate_fpm - 1200.0) < 1.0);
+}
+
+TEST_CASE("Track trend needs enough history and skips missing altitudes") {
+  TrackHistory history;
+  FlyNorthEast(&history, 2);
+  TrackTrend trend;
+  ASSERT_TRUE(!FitTrackTrend(history, 1.0, &trend));
+
+  // Three samples, but closer together than the span asked for.
+  history.clear();
+  history.push(0.0, 47.0, 8.0, 1000.0);
+  history.push(0.2, 47.0, 8.0, 1000.0);
+  history.push(0.4, 47.0, 8.0, 1000.0);
+  ASSERT_TRUE(!FitTrackTrend(history, 1.0, &trend));
+
+  // Without altitudes the horizontal trend still comes through.
+  history.clear();
+  FlyNorthEast(&history, 4);
+  history.push(4.0, history.latitude_deg[3], history.longitude_deg[3], NAN);
+  for (double &altitude : history.altitude_ft) {
+    altitude = NAN;
+  }
+  ASSERT_TRUE(FitTrackTrend(history, 1.0, &trend));
+  ASSERT_TRUE(trend.has_velocity);
+  ASSERT_TRUE(!trend.has_vertical_rate);
+}
+
+TEST_CASE("Track trend handles the antimeridian and a stationary target") {
+  TrackHistory history;
+  // Westbound across 180 degrees on the equator, 0.001 degrees a second.
+  for (int i = 0; i < 5; ++i) {
+    double longitude = -179.998 - 0.001 * i;
+    if (longitude < -180.0) {
+      longitude += 360.0;
+    }
+    history.push(static_cast<double>(i), 0.0, longitude, 500.0);
+  }
+  TrackTrend trend;
+  ASSERT_TRUE(FitTrackTrend(history, 1.0, &trend));
+  ASSERT_TRUE(std::fabs(trend.track_deg - 270.0) < 0.5);
+  ASSERT_TRUE(std::fabs(trend.ground_speed_mps - 111.2) < 1.0);
+
+  history.clear();
+  for (int i = 0; i < 4; ++i) {
+    history.push(static_cast<double>(i), 47.0, 8.0, 500.0);
+  }
+  ASSERT_TRUE(FitTrackTrend(history, 1.0, &trend));
+  ASSERT_TRUE(trend.ground_speed_mps < 1e-6);
+  ASSERT_EQ(0.0, trend.vertical_rate_fpm);
+}
+
+TEST_CASE("Track trend kernel matches the scalar fit") {
+  uint32_t state = 12345;
+  auto next = [&state]() {
+    state = state * 1664525u + 1013904223u;
+    return static_cast<double>(state >> 8) / static_cast<double>(1u << 24);
+  };
+  for (int trial = 0; trial < 200; ++trial) {
+    TrackHistory history;
+    const int samples = 1 + trial % 11;
+    double t = 1000.0 * next();
+    for (int i = 0; i < samples; ++i) {
+      t += 0.2 + 2.0 * next();
+      history.push(t, 60.0 * next() - 30.0, 360.0 * next() - 180.0,
+                   next() < 0.2 ? NAN : 40000.0 * next());
+    }
+    TrackTrend fast;
+    TrackTrend scalar;
+    ASSERT_EQ(FitTrackTrendScalar(history, 1.0, &scalar),
+              FitTrackTrend(history, 1.0, &fast));
+    ASSERT_EQ(scalar.has_velocity, fast.has_velocity);
+    ASSERT_EQ(scalar.has_vertical_rate, fast.has_vertical_rate);
+    const double speed_tolerance = 1e-9 * (1.0 + scalar.ground_speed_mps);
+    ASSERT_TRUE(std::fabs(scalar.ground_speed_mps - fast.ground_speed_mps) <=
+                speed_tolerance);
+    ASSERT_TRUE(std::fabs(scalar.vertical_rate_fpm - fast.vertical_rate_fpm) <=
+                1e-9 * (1.0 + std::fabs(scalar.vertical_rate_fpm)));
+  }
+}
@@ -0,0 +1,126 @@
+#include "test_harness.h"
+
+#include <cstdint>
+
+#include "xp2gdl90/track_table.h"
+
+using xp2gdl90::traffic::TrackTable;
+
+TEST_CASE("TrackTable records first and last seen times") {
+  TrackTable tracks;
+  ASSERT_TRUE(tracks.empty());
+  ASSERT_EQ(TrackTable::npos, tracks.find(0xABCDEFu));
+
+  ASSERT_EQ(static_cast<size_t>(0), tracks.upsert(0xABCDEFu, 10.0));
+  ASSERT_EQ(static_cast<size_t>(1), tracks.upsert(0x123456u, 10.5));
+  const uint64_t generation = tracks.generation();
+  ASSERT_EQ(static_cast<size_t>(0), tracks.upsert(0xABCDEFu, 12.0));
+  ASSERT_EQ(generation, tracks.generation());
+
+  const xp2gdl90::traffic::TrackInfo &info = tracks.track(0);
+  ASSERT_EQ(static_cast<uint32_t>(0xABCDEFu), info.key);
+  ASSERT_EQ(10.0, info.first_seen);
+  ASSERT_EQ(12.0, info.last_seen);
+  ASSERT_EQ(static_cast<uint32_t>(2), info.generation);
+  ASSERT_EQ(static_cast<size_t>(1), tracks.find(0x123456u));
+}
+
+TEST_CASE("TrackTable grows and keeps every key reachable") {
+  TrackTable tracks;
+  // Sequential IDs, as SimConnect hands out for injected traffic.
+  for (uint32_t id = 1; id <= 600; ++id) {
+    ASSERT_EQ(static_cast<size_t>(id - 1), tracks.upsert(id, 0.0));
+  }
+  ASSERT_EQ(static_cast<size_t>(600), tracks.size());
+  for (uint32_t id = 1; id <= 600; ++id) {
+    const size_t index = tracks.find(id);
+    ASSERT_TRUE(index != TrackTable::npos);
+    ASSERT_EQ(id, tracks.track(index).key);
+  }
+  ASSERT_EQ(TrackTable::npos, tracks.find(601));
+}
+
+TEST_CASE("TrackTable evicts stale tracks and their snapshot rows") {
+  TrackTable tracks;
+  xp2gdl90::traffic::TrafficSnapshot rows;
+  for (uint32_t id = 0; id < 200; ++id) {
+    // Odd IDs were last seen long ago.
+    const size_t index = tracks.upsert(id, (id % 2) ? 0.0 : 9.0);
+    ASSERT_EQ(rows.size(), index);
+    rows.append();
+    rows.source_id[index] = id;
+  }
+
+  const uint64_t generation = tracks.generation();
+  ASSERT_EQ(static_cast<size_t>(100), tracks.evictStale(10.0, 3.0, &rows));
+  ASSERT_TRUE(tracks.generation() != generation);
+  ASSERT_EQ(static_cast<size_t>(100), tracks.size());
+  ASSERT_EQ(tracks.size(), rows.size());
+  for (size_t index = 0; index < tracks.size(); ++index) {
+    ASSERT_EQ(tracks.track(index).key, rows.source_id[index]);
+  }
+  for (uint32_t id = 0; id < 200; ++id) {
+    const size_t index = tracks.find(id);
+    ASSERT_EQ(id % 2 == 0, index != TrackTable::npos);
+    if (index != TrackTable::npos) {
+      ASSERT_EQ(id, tracks.track(index).key);
+    }
+  }
+
+  ASSERT_EQ(static_cast<size_t>(0), tracks.evictStale(10.0, 3.0, nullptr));
+  tracks.clear();
+  ASSERT_TRUE(tracks.empty());
+  ASSERT_EQ(TrackTable::npos, tracks.find(0));
+  tracks.clear();
+  ASSERT_EQ(static_cast<size_t>(0), tracks.upsert(0, 11.0));
+}
+
+TEST_CASE("TrackTable removes one track and its snapshot row") {
+  TrackTable tracks;
+  xp2gdl90::traffic::TrafficSnapshot rows;
+  for (uint32_t id = 1; id <= 5; ++id) {
+    const size_t index = tracks.upsert(id, 0.0);
+    rows.append();
+    rows.source_id[index] = id;
+  }
+
+  const uint64_t generation = tracks.generation();
+  ASSERT_TRUE(tracks.remove(2, &rows));
+  ASSERT_TRUE(tracks.generation() != generation);
+  ASSERT_TRUE(!tracks.remove(2, &rows));
+  ASSERT_EQ(TrackTable::npos, tracks.find(2));
+  ASSERT_EQ(static_cast<size_t>(4), tracks.size());
+  ASSERT_EQ(tracks.size(), rows.size());
+  // The last track moved into the freed index with its row.
+  for (size_t index = 0; index < tracks.size(); ++index) {
+    ASSERT_EQ(tracks.track(index).key, rows.source_id[index]);
+    ASSERT_EQ(index, tracks.find(tracks.track(index).key));
+  }
+}
+
+TEST_CASE("TrackTable histories follow their tracks through removal") {
+  TrackTable tracks;
+  tracks.upsert(0xA1, 0.0);
+  tracks.setHistoryEnabled(true);
+  ASSERT_TRUE(tracks.hasHistory());
+  ASSERT_EQ(0, static_cast<int>(tracks.history(0).count));
+  tracks.upsert(0xA2, 0.0);
+  tracks.upsert(0xA3, 0.0);
+  for (size_t index = 0; index < tracks.size(); ++index) {
+    tracks.pushSample(index, 1.0, 47.0 + static_cast<double>(index), 8.0,
+                      1000.0);
+  }
+
+  // 0xA3 moves into 0xA1's index and brings its samples along.
+  ASSERT_TRUE(tracks.remove(0xA1, nullptr));
+  ASSERT_EQ(static_cast<size_t>(0), tracks.find(0xA3));
+  ASSERT_EQ(49.0, tracks.history(0).latitude_deg[0]);
+  ASSERT_EQ(48.0, tracks.history(1).latitude_deg[0]);
+
+  // A new track starts with an empty history.
+  ASSERT_EQ(static_cast<size_t>(2), tracks.upsert(0xA1, 2.0));
+  ASSERT_EQ(0, static_cast<int>(tracks.history(2).count));
+  tracks.setHistoryEnabled(false);
+  tracks.pushSample(0, 3.0, 47.0, 8.0, 1000.0);
+  ASSERT_TRUE(!tracks.hasHistory());
+}
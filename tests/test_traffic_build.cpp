@@ -0,0 +1,165 @@
+#include "test_harness.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "xp2gdl90/msfs_bridge.h"
+#include "xp2gdl90/traffic_build.h"
+#include "xp2gdl90/traffic_frame_cache.h"
+
+using xp2gdl90::traffic::ParallelTrafficBuild;
+using xp2gdl90::traffic::TrafficSnapshot;
+
+namespace {
+
+constexpr size_t kTargets = 2000;
+
+// Targets scattered within about a degree of ownship, with every 17th off
+// the map so the validity pass has rows to drop.
+void FillTraffic(xp2gdl90::traffic::TrackTable *tracks,
+                 TrafficSnapshot *snapshot) {
+  uint64_t seed = 12345;
+  auto uniform = [&seed](double lo, double hi) {
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    return lo + (hi - lo) * static_cast<double>(seed >> 11) * 0x1.0p-53;
+  };
+  msfs_bridge::TrafficData traffic;
+  for (uint32_t id = 1; id <= kTargets; ++id) {
+    traffic.object_id = id;
+    traffic.latitude_deg = id % 17 == 0 ? 95.0 : uniform(46.0, 48.0);
+    traffic.longitude_deg = uniform(7.0, 9.0);
+    traffic.altitude_ft = uniform(1000.0, 30000.0);
+    traffic.ground_velocity_kt = uniform(80.0, 450.0);
+    traffic.velocity_world_x_fps = uniform(-400.0, 400.0);
+    traffic.velocity_world_z_fps = uniform(-400.0, 400.0);
+    traffic.true_heading_deg = uniform(0.0, 360.0);
+    char callsign[gdl90::CALLSIGN_SIZE + 1];
+    std::snprintf(callsign, sizeof(callsign), "T%04u", id);
+    traffic.callsign = id % 5 == 0 ? gdl90::Callsign() : callsign;
+    msfs_bridge::UpsertTrafficTarget(tracks, snapshot, traffic, 1.0);
+  }
+}
+
+std::vector<uint8_t>
+EncodeAll(const std::vector<gdl90::PositionData> &reports) {
+  const gdl90::GDL90Encoder encoder;
+  gdl90::FrameArena arena;
+  encoder.encodeTrafficBatch(reports.data(), reports.size(), arena);
+  return std::vector<uint8_t>(arena.data(), arena.data() + arena.size());
+}
+
+// Builds from copies of `snapshot` with and without the pool and checks
+// that both give the same reports in the same order.
+bool ParallelMatchesSerial(const TrafficSnapshot &snapshot,
+                           const xp2gdl90::Settings &cfg,
+                           const msfs_bridge::OwnshipData *ownship,
+                           const std::vector<uint32_t> *candidate_rows,
+                           ParallelTrafficBuild *parallel) {
+  TrafficSnapshot serial_snapshot = snapshot;
+  TrafficSnapshot parallel_snapshot = snapshot;
+  std::vector<gdl90::PositionData> serial;
+  std::vector<gdl90::PositionData> fanned;
+  const size_t serial_count = msfs_bridge::BuildTrafficPositions(
+      &serial_snapshot, cfg, ownship, candidate_rows, &serial);
+  const size_t parallel_count = msfs_bridge::BuildTrafficPositions(
+      &parallel_snapshot, cfg, ownship, candidate_rows, &fanned, parallel);
+  return serial_count > 0 && serial_count == parallel_count &&
+         serial.size() == fanned.size() &&
+         EncodeAll(serial) == EncodeAll(fanned);
+}
+
+} // namespace
+
+TEST_CASE("Parallel MSFS traffic build matches the serial one") {
+  xp2gdl90::traffic::TrackTable tracks;
+  tracks.setGridCellSize(20.0 * 1852.0);
+  TrafficSnapshot snapshot;
+  FillTraffic(&tracks, &snapshot);
+
+  xp2gdl90::TaskPool pool;
+  std::string error;
+  ASSERT_TRUE(pool.start(3, &error));
+  ParallelTrafficBuild parallel;
+  parallel.pool = &pool;
+  ASSERT_TRUE(parallel.fansOut(snapshot.size()));
+
+  msfs_bridge::OwnshipData ownship;
+  ownship.latitude_deg = 47.0;
+  ownship.longitude_deg = 8.0;
+  ownship.altitude_ft = 8000.0;
+  xp2gdl90::Settings cfg;
+  cfg.traffic_max_targets = 200;
+  cfg.traffic_range_nm = 40.0f;
+  ASSERT_TRUE(
+      ParallelMatchesSerial(snapshot, cfg, &ownship, nullptr, &parallel));
+
+  std::vector<uint32_t> near_rows;
+  tracks.queryNear(ownship.latitude_deg, ownship.longitude_deg,
+                   cfg.traffic_range_nm * 1852.0, &near_rows, nullptr);
+  ASSERT_TRUE(
+      ParallelMatchesSerial(snapshot, cfg, &ownship, &near_rows, &parallel));
+
+  // Without ownship the budget keeps the first valid rows, across chunks.
+  ASSERT_TRUE(
+      ParallelMatchesSerial(snapshot, cfg, nullptr, nullptr, &parallel));
+
+  // Scratch from the larger build is reused.
+  TrafficSnapshot invalid = snapshot;
+  for (size_t row = 0; row < invalid.size(); ++row) {
+    invalid.latitude[row] = 95.0;
+  }
+  std::vector<gdl90::PositionData> reports;
+  ASSERT_EQ(static_cast<size_t>(0),
+            msfs_bridge::BuildTrafficPositions(&invalid, cfg, &ownship,
+                                               nullptr, &reports, &parallel));
+  ASSERT_TRUE(reports.empty());
+}
+
+TEST_CASE("Parallel traffic encoding matches encodeTrafficBatch") {
+  std::vector<gdl90::PositionData> reports(255);
+  for (size_t i = 0; i < reports.size(); ++i) {
+    gdl90::PositionData &report = reports[i];
+    report.latitude = 47.0 + 0.001 * static_cast<double>(i);
+    report.longitude = 8.0 - 0.002 * static_cast<double>(i);
+    report.altitude = static_cast<int32_t>(1000 + 25 * i);
+    report.h_velocity = static_cast<uint16_t>(100 + i);
+    report.v_velocity = static_cast<int16_t>(-640 + 10 * static_cast<int>(i));
+    report.track = static_cast<uint16_t>(i % 360);
+    report.track_type = gdl90::TrackType::TRUE_TRACK;
+    report.airborne = true;
+    report.icao_address = 0xA00000u + static_cast<uint32_t>(i);
+    report.callsign = "TEST";
+  }
+
+  xp2gdl90::TaskPool pool;
+  std::string error;
+  ASSERT_TRUE(pool.start(2, &error));
+  ParallelTrafficBuild parallel;
+  parallel.pool = &pool;
+
+  const gdl90::GDL90Encoder encoder;
+  gdl90::TrafficFrameCache serial_cache;
+  gdl90::TrafficFrameCache parallel_cache;
+  gdl90::FrameArena serial;
+  gdl90::FrameArena fanned;
+  for (int round = 0; round < 2; ++round) {
+    reports[7].altitude += 500;
+    ASSERT_EQ(reports.size(),
+              encoder.encodeTrafficBatch(reports.data(), reports.size(),
+                                         serial, &serial_cache));
+    ASSERT_EQ(reports.size(), xp2gdl90::traffic::EncodeTrafficReports(
+                                  encoder, reports.data(), reports.size(),
+                                  fanned, &parallel_cache, &parallel));
+    ASSERT_EQ(serial.size(), fanned.size());
+    ASSERT_TRUE(std::vector<uint8_t>(serial.data(),
+                                     serial.data() + serial.size()) ==
+                std::vector<uint8_t>(fanned.data(),
+                                     fanned.data() + fanned.size()));
+  }
+  // Only the report that changed missed the cache the second time.
+  ASSERT_EQ(serial_cache.hits(), parallel_cache.hits());
+  ASSERT_EQ(static_cast<uint64_t>(254), parallel_cache.hits());
+  ASSERT_EQ(serial_cache.misses(), parallel_cache.misses());
+}
@@ -0,0 +1,83 @@
+#include "test_harness.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "xp2gdl90/traffic_extrapolation.h"
+
+namespace {
+
+constexpr double kMetersPerDegree =
+    6371008.8 * 3.14159265358979323846 / 180.0;
+
+gdl90::PositionData MovingReport(uint16_t track_deg) {
+  gdl90::PositionData report;
+  report.latitude = 60.0;
+  report.longitude = 10.0;
+  report.altitude = 5000;
+  report.h_velocity = 360; // 185.2 m/s.
+  report.v_velocity = 1200;
+  report.track = track_deg;
+  report.track_type = gdl90::TrackType::TRUE_TRACK;
+  return report;
+}
+
+bool Near(double expected, double actual, double tolerance) {
+  return std::fabs(expected - actual) <= tolerance;
+}
+
+} // namespace
+
+TEST_CASE("ExtrapolateReport moves along track and vertical rate") {
+  gdl90::PositionData north = MovingReport(0);
+  ASSERT_EQ(2.0, xp2gdl90::traffic::ExtrapolateReport(2.0, 5.0, &north));
+  ASSERT_TRUE(Near(60.0 + 370.4 / kMetersPerDegree, north.latitude, 1e-9));
+  ASSERT_TRUE(Near(10.0, north.longitude, 1e-12));
+  ASSERT_EQ(5040, north.altitude);
+
+  // East at 60N covers twice the longitude of the same distance at the
+  // equator.
+  gdl90::PositionData east = MovingReport(90);
+  xp2gdl90::traffic::ExtrapolateReport(1.0, 5.0, &east);
+  ASSERT_TRUE(Near(60.0, east.latitude, 1e-9));
+  ASSERT_TRUE(
+      Near(10.0 + 2.0 * 185.2 / kMetersPerDegree, east.longitude, 1e-7));
+}
+
+TEST_CASE("ExtrapolateReport honours the horizon and invalid fields") {
+  gdl90::PositionData capped = MovingReport(0);
+  ASSERT_EQ(0.5, xp2gdl90::traffic::ExtrapolateReport(3.0, 0.5, &capped));
+  ASSERT_EQ(5010, capped.altitude);
+
+  gdl90::PositionData unchanged = MovingReport(0);
+  ASSERT_EQ(0.0, xp2gdl90::traffic::ExtrapolateReport(-1.0, 5.0, &unchanged));
+  ASSERT_EQ(0.0, xp2gdl90::traffic::ExtrapolateReport(1.0, 0.0, &unchanged));
+  ASSERT_EQ(60.0, unchanged.latitude);
+  ASSERT_EQ(5000, unchanged.altitude);
+
+  gdl90::PositionData invalid = MovingReport(0);
+  invalid.h_velocity = gdl90::VELOCITY_INVALID;
+  invalid.v_velocity = std::numeric_limits<int16_t>::min();
+  xp2gdl90::traffic::ExtrapolateReport(1.0, 5.0, &invalid);
+  ASSERT_EQ(60.0, invalid.latitude);
+  ASSERT_EQ(5000, invalid.altitude);
+
+  gdl90::PositionData wrap = MovingReport(90);
+  wrap.longitude = 179.9999;
+  xp2gdl90::traffic::ExtrapolateReport(1.0, 5.0, &wrap);
+  ASSERT_TRUE(wrap.longitude < -179.99);
+}
+
+TEST_CASE("ExtrapolateTrafficReports leads each report to its send slot") {
+  std::vector<gdl90::PositionData> reports(3, MovingReport(0));
+  const double max_lead = xp2gdl90::traffic::ExtrapolateTrafficReports(
+      0.25, 0.25, 0.6, &reports);
+  ASSERT_EQ(0.6, max_lead);
+  ASSERT_EQ(5005, reports[0].altitude);
+  ASSERT_EQ(5010, reports[1].altitude);
+  ASSERT_EQ(5012, reports[2].altitude);
+  ASSERT_EQ(0.0, xp2gdl90::traffic::ExtrapolateTrafficReports(1.0, 0.0, 1.0,
+                                                               nullptr));
+}
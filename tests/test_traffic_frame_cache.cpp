@@ -0,0 +1,88 @@
+#include "test_harness.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "xp2gdl90/gdl90_encoder.h"
+#include "xp2gdl90/traffic_frame_cache.h"
+
+namespace {
+
+std::vector<gdl90::PositionData> MakeReports() {
+  std::vector<gdl90::PositionData> reports(3);
+  for (size_t i = 0; i < reports.size(); ++i) {
+    reports[i].icao_address = 0xA00000u + static_cast<uint32_t>(i);
+    reports[i].latitude = 47.0 + 0.01 * static_cast<double>(i);
+    reports[i].longitude = -122.0;
+    reports[i].altitude = 3000;
+    reports[i].h_velocity = 120;
+    reports[i].callsign = "TFC";
+  }
+  return reports;
+}
+
+std::vector<uint8_t> FrameAt(const gdl90::FrameArena &arena, size_t index) {
+  return std::vector<uint8_t>(arena.frameData(index),
+                              arena.frameData(index) + arena.frameSize(index));
+}
+
+} // namespace
+
+TEST_CASE("Traffic frame cache reuses frames unchanged at wire resolution") {
+  gdl90::GDL90Encoder encoder([]() { return 0u; });
+  gdl90::TrafficFrameCache cache;
+  gdl90::FrameArena arena;
+  std::vector<gdl90::PositionData> reports = MakeReports();
+
+  ASSERT_EQ(reports.size(), encoder.encodeTrafficBatch(
+                                reports.data(), reports.size(), arena, &cache));
+  ASSERT_EQ(static_cast<uint64_t>(0), cache.hits());
+  ASSERT_EQ(static_cast<uint64_t>(3), cache.misses());
+  ASSERT_EQ(static_cast<size_t>(3), cache.size());
+
+  // Ten feet is below the 25 ft altitude step; a new track is not.
+  reports[0].altitude += 10;
+  reports[1].track = 90;
+  encoder.encodeTrafficBatch(reports.data(), reports.size(), arena, &cache);
+  ASSERT_EQ(static_cast<uint64_t>(2), cache.hits());
+  ASSERT_EQ(static_cast<uint64_t>(4), cache.misses());
+  for (size_t i = 0; i < reports.size(); ++i) {
+    ASSERT_TRUE(encoder.createTrafficReport(reports[i]) == FrameAt(arena, i));
+  }
+}
+
+TEST_CASE("Traffic frame cache drops targets missing from a batch") {
+  gdl90::GDL90Encoder encoder([]() { return 0u; });
+  gdl90::TrafficFrameCache cache;
+  gdl90::FrameArena arena;
+  const std::vector<gdl90::PositionData> reports = MakeReports();
+
+  encoder.encodeTrafficBatch(reports.data(), reports.size(), arena, &cache);
+  encoder.encodeTrafficBatch(reports.data(), 1, arena, &cache);
+  ASSERT_EQ(static_cast<size_t>(1), cache.size());
+  ASSERT_EQ(static_cast<uint64_t>(1), cache.hits());
+
+  encoder.encodeTrafficBatch(reports.data(), reports.size(), arena, &cache);
+  ASSERT_EQ(static_cast<uint64_t>(2), cache.hits());
+  ASSERT_EQ(static_cast<uint64_t>(5), cache.misses());
+
+  cache.clear();
+  ASSERT_EQ(static_cast<size_t>(0), cache.size());
+  ASSERT_EQ(static_cast<uint64_t>(0), cache.hits());
+  ASSERT_EQ(static_cast<uint64_t>(0), cache.misses());
+}
+
+TEST_CASE("Traffic frame cache handles payloads it cannot store") {
+  gdl90::TrafficFrameCache cache;
+  std::vector<uint8_t> payload(gdl90::FRAME_PAYLOAD_CAPACITY + 1, 0x7E);
+  std::vector<uint8_t> out(gdl90::MaxFrameSize(payload.size()));
+  cache.beginBatch();
+  const size_t first =
+      cache.frame(1, payload.data(), payload.size(), out.data());
+  const size_t second =
+      cache.frame(1, payload.data(), payload.size(), out.data());
+  cache.endBatch();
+  ASSERT_EQ(first, second);
+  ASSERT_EQ(static_cast<uint64_t>(0), cache.hits());
+  ASSERT_EQ(static_cast<uint64_t>(2), cache.misses());
+}
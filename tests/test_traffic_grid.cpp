@@ -0,0 +1,165 @@
+#include "test_harness.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "xp2gdl90/msfs_bridge.h"
+#include "xp2gdl90/track_table.h"
+#include "xp2gdl90/traffic_grid.h"
+
+using xp2gdl90::traffic::GridQueryStats;
+using xp2gdl90::traffic::TrackTable;
+using xp2gdl90::traffic::TrafficGrid;
+
+namespace {
+
+constexpr double kTenNm = 10.0 * 1852.0;
+
+std::vector<uint32_t> Query(const TrafficGrid &grid, double latitude,
+                            double longitude, double radius_m) {
+  std::vector<uint32_t> indices;
+  grid.query(latitude, longitude, radius_m, &indices, nullptr);
+  std::sort(indices.begin(), indices.end());
+  return indices;
+}
+
+} // namespace
+
+TEST_CASE("TrafficGrid finds neighbours and skips distant cells") {
+  TrafficGrid grid;
+  ASSERT_TRUE(!grid.enabled());
+  grid.configure(kTenNm);
+  ASSERT_TRUE(grid.enabled());
+
+  grid.place(0, 47.50, -122.30);
+  grid.place(1, 47.60, -122.10); // About 10 nm away.
+  grid.place(2, 40.00, -100.00);
+  grid.place(3, 47.45, -122.35);
+  ASSERT_EQ(static_cast<size_t>(3), grid.occupiedCells());
+
+  GridQueryStats stats;
+  std::vector<uint32_t> indices;
+  ASSERT_EQ(static_cast<size_t>(3),
+            grid.query(47.5, -122.3, kTenNm, &indices, &stats));
+  std::sort(indices.begin(), indices.end());
+  ASSERT_TRUE((std::vector<uint32_t>{0, 1, 3}) == indices);
+  ASSERT_EQ(static_cast<size_t>(3), stats.entries);
+  // Three rows of a handful of columns at this latitude.
+  ASSERT_TRUE(stats.cells >= 9 && stats.cells <= 15);
+}
+
+TEST_CASE("TrafficGrid wraps columns at the antimeridian") {
+  TrafficGrid grid;
+  grid.configure(kTenNm);
+  grid.place(7, -17.0, -179.95);
+  ASSERT_TRUE((std::vector<uint32_t>{7}) == Query(grid, -17.0, 179.95, kTenNm));
+  // A query at the pole covers every column.
+  grid.place(8, 89.99, 10.0);
+  ASSERT_TRUE((std::vector<uint32_t>{8}) == Query(grid, 89.99, -170.0, kTenNm));
+}
+
+TEST_CASE("TrafficGrid moves, removes and renumbers entries") {
+  TrafficGrid grid;
+  grid.configure(kTenNm);
+  grid.place(0, 10.0, 10.0);
+  grid.place(1, 10.0, 10.0);
+  grid.place(2, 10.0, 10.0);
+
+  grid.place(1, 20.0, 20.0);
+  ASSERT_TRUE((std::vector<uint32_t>{0, 2}) == Query(grid, 10.0, 10.0, 1.0));
+  ASSERT_TRUE((std::vector<uint32_t>{1}) == Query(grid, 20.0, 20.0, 1.0));
+
+  grid.remove(0);
+  grid.renumber(2, 0);
+  ASSERT_TRUE((std::vector<uint32_t>{0}) == Query(grid, 10.0, 10.0, 1.0));
+  grid.remove(0);
+  grid.remove(0);
+  ASSERT_EQ(static_cast<size_t>(1), grid.occupiedCells());
+
+  // An invalid position takes the entry out of the grid.
+  grid.place(1, NAN, 20.0);
+  ASSERT_EQ(static_cast<size_t>(0), grid.occupiedCells());
+}
+
+TEST_CASE("TrackTable keeps its grid aligned with dense indices") {
+  TrackTable tracks;
+  tracks.upsert(100, 0.0);
+  tracks.setPosition(0, 47.5, -122.3);
+  tracks.upsert(200, 0.0);
+  tracks.setPosition(1, 10.0, 10.0);
+  // Enabling the grid later indexes the tracks already positioned.
+  tracks.setGridCellSize(kTenNm);
+  ASSERT_TRUE(tracks.hasGrid());
+  tracks.upsert(300, 5.0);
+  tracks.setPosition(2, 47.51, -122.3);
+
+  // Track 100 is evicted and track 300 takes its index.
+  ASSERT_EQ(static_cast<size_t>(2), tracks.evictStale(5.0, 3.0, nullptr));
+  std::vector<uint32_t> indices;
+  ASSERT_EQ(static_cast<size_t>(1),
+            tracks.queryNear(47.5, -122.3, kTenNm, &indices, nullptr));
+  ASSERT_EQ(static_cast<uint32_t>(300), tracks.track(indices[0]).key);
+
+  // Without the grid every track is a candidate.
+  tracks.setGridCellSize(0.0);
+  indices.clear();
+  GridQueryStats stats;
+  tracks.upsert(400, 5.0);
+  tracks.setPosition(1, 0.0, 0.0);
+  ASSERT_EQ(static_cast<size_t>(2),
+            tracks.queryNear(47.5, -122.3, kTenNm, &indices, &stats));
+  ASSERT_EQ(static_cast<size_t>(0), stats.cells);
+}
+
+TEST_CASE("Grid query cost stays flat as worldwide traffic grows") {
+  TrackTable tracks;
+  tracks.setGridCellSize(30.0 * 1852.0);
+  GridQueryStats small;
+  GridQueryStats large;
+  std::vector<uint32_t> indices;
+  for (uint32_t id = 0; id < 2000; ++id) {
+    const size_t index = tracks.upsert(id, 0.0);
+    // Spread over the globe, plus five close to ownship.
+    const double latitude = id < 5 ? 47.5 + 0.01 * id : -80.0 + (id % 160);
+    const double longitude = id < 5 ? -122.3 : -179.0 + (id * 37 % 358);
+    tracks.setPosition(index, latitude, longitude);
+    if (id == 99) {
+      indices.clear();
+      tracks.queryNear(47.5, -122.3, 30.0 * 1852.0, &indices, &small);
+    }
+  }
+  indices.clear();
+  tracks.queryNear(47.5, -122.3, 30.0 * 1852.0, &indices, &large);
+  ASSERT_EQ(small.cells, large.cells);
+  ASSERT_TRUE(large.entries < 20);
+  ASSERT_TRUE(large.entries >= 5);
+}
+
+TEST_CASE("MSFS traffic positions can be limited to grid candidates") {
+  TrackTable tracks;
+  tracks.setGridCellSize(kTenNm);
+  xp2gdl90::traffic::TrafficSnapshot snapshot;
+  msfs_bridge::TrafficData traffic;
+  const double latitudes[] = {47.51, 10.0, 47.52};
+  for (uint32_t id = 0; id < 3; ++id) {
+    traffic.object_id = id + 1;
+    traffic.latitude_deg = latitudes[id];
+    traffic.longitude_deg = -122.3;
+    msfs_bridge::UpsertTrafficTarget(&tracks, &snapshot, traffic, 1.0);
+  }
+
+  msfs_bridge::OwnshipData ownship;
+  ownship.latitude_deg = 47.5;
+  ownship.longitude_deg = -122.3;
+  std::vector<uint32_t> rows;
+  tracks.queryNear(ownship.latitude_deg, ownship.longitude_deg, kTenNm, &rows,
+                   nullptr);
+  std::vector<gdl90::PositionData> reports;
+  ASSERT_EQ(static_cast<size_t>(2),
+            msfs_bridge::BuildTrafficPositions(&snapshot, xp2gdl90::Settings{},
+                                               &ownship, &rows, &reports));
+  for (const gdl90::PositionData &report : reports) {
+    ASSERT_TRUE(report.latitude > 47.0);
+  }
+}
@@ -0,0 +1,63 @@
+#include "test_harness.h"
+
+#include <cmath>
+#include <cstddef>
+
+#include "xp2gdl90/traffic_pacer.h"
+
+TEST_CASE("TrafficPacer spreads a sweep evenly over its window") {
+  udp::TrafficPacer pacer;
+  pacer.start(10, 100.0, 1.0);
+  size_t first = 99;
+  // Frame i is due at 100 + i / 10.
+  ASSERT_EQ(static_cast<size_t>(1), pacer.release(100.0, &first));
+  ASSERT_EQ(static_cast<size_t>(0), first);
+  ASSERT_TRUE(std::fabs(pacer.nextDue() - 100.1) < 1e-9);
+  ASSERT_EQ(static_cast<size_t>(0), pacer.release(100.05, &first));
+  ASSERT_EQ(static_cast<size_t>(3), pacer.release(100.35, &first));
+  ASSERT_EQ(static_cast<size_t>(1), first);
+  ASSERT_EQ(static_cast<size_t>(6), pacer.pending());
+  // A late tick releases everything still owed, never more than the sweep.
+  ASSERT_EQ(static_cast<size_t>(6), pacer.release(105.0, &first));
+  ASSERT_EQ(static_cast<size_t>(4), first);
+  ASSERT_EQ(static_cast<size_t>(0), pacer.release(106.0, &first));
+  ASSERT_TRUE(std::isnan(pacer.nextDue()));
+
+  const udp::TrafficPacerStats &stats = pacer.stats();
+  ASSERT_EQ(static_cast<uint64_t>(3), stats.slices);
+  ASSERT_EQ(static_cast<uint64_t>(10), stats.frames);
+  ASSERT_EQ(static_cast<size_t>(6), stats.last_burst);
+  ASSERT_EQ(static_cast<size_t>(6), stats.max_burst);
+  ASSERT_EQ(static_cast<uint64_t>(2), stats.gap_samples);
+  ASSERT_TRUE(stats.max_gap_s > 4.6 && stats.max_gap_s < 4.7);
+  ASSERT_TRUE(stats.averageGapS() > 2.4 && stats.averageGapS() < 2.6);
+}
+
+TEST_CASE("TrafficPacer without a window releases the sweep at once") {
+  udp::TrafficPacer pacer;
+  pacer.start(60, 5.0, 0.0);
+  size_t first = 99;
+  ASSERT_EQ(static_cast<size_t>(60), pacer.release(5.0, &first));
+  ASSERT_EQ(static_cast<size_t>(0), first);
+  ASSERT_EQ(static_cast<size_t>(60), pacer.stats().max_burst);
+
+  pacer.start(0, 6.0, 0.9);
+  ASSERT_EQ(static_cast<size_t>(0), pacer.release(6.5, &first));
+  ASSERT_EQ(static_cast<uint64_t>(1), pacer.stats().slices);
+}
+
+TEST_CASE("TrafficPacer counts frames a new sweep supersedes") {
+  udp::TrafficPacer pacer;
+  size_t first = 0;
+  pacer.start(4, 0.0, 1.0);
+  ASSERT_EQ(static_cast<size_t>(2), pacer.release(0.3, &first));
+  pacer.start(4, 0.5, 1.0);
+  ASSERT_EQ(static_cast<uint64_t>(2), pacer.stats().superseded);
+  ASSERT_EQ(static_cast<size_t>(1), pacer.release(0.5, &first));
+  ASSERT_EQ(static_cast<size_t>(0), first);
+
+  pacer.reset();
+  ASSERT_EQ(static_cast<size_t>(0), pacer.pending());
+  ASSERT_EQ(static_cast<uint64_t>(0), pacer.stats().slices);
+  ASSERT_EQ(static_cast<size_t>(0), pacer.release(1.0, &first));
+}
@@ -0,0 +1,192 @@
+#include "test_harness.h"
+
+#include <cmath>
+#include <cstdint>
+
+#include "xp2gdl90/traffic_projection.h"
+
+using xp2gdl90::traffic::LocalProjection;
+using xp2gdl90::traffic::ProjectionAnchor;
+using xp2gdl90::traffic::TrafficSnapshot;
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kA = 6378137.0;
+constexpr double kE2 = 6.69437999014e-3;
+
+struct Geodetic {
+  double latitude_deg;
+  double longitude_deg;
+  double altitude_m;
+};
+
+void GeodeticToEcef(const Geodetic &g, double *out) {
+  const double lat = g.latitude_deg * kPi / 180.0;
+  const double lon = g.longitude_deg * kPi / 180.0;
+  const double n = kA / std::sqrt(1.0 - kE2 * std::sin(lat) * std::sin(lat));
+  out[0] = (n + g.altitude_m) * std::cos(lat) * std::cos(lon);
+  out[1] = (n + g.altitude_m) * std::cos(lat) * std::sin(lon);
+  out[2] = (n * (1.0 - kE2) + g.altitude_m) * std::sin(lat);
+}
+
+Geodetic EcefToGeodetic(const double *ecef) {
+  const double p = std::hypot(ecef[0], ecef[1]);
+  double lat = std::atan2(ecef[2], p * (1.0 - kE2));
+  double altitude = 0.0;
+  for (int i = 0; i < 10; ++i) {
+    const double n = kA / std::sqrt(1.0 - kE2 * std::sin(lat) * std::sin(lat));
+    altitude = p / std::cos(lat) - n;
+    lat = std::atan2(ecef[2], p * (1.0 - kE2 * n / (n + altitude)));
+  }
+  return Geodetic{lat * 180.0 / kPi,
+                  std::atan2(ecef[1], ecef[0]) * 180.0 / kPi, altitude};
+}
+
+// Exact conversion of an X-Plane style local point (tangent plane at
+// `origin`, +x east, +y up, +z south).
+Geodetic LocalToGeodetic(const Geodetic &origin, double x, double y,
+                         double z) {
+  const double lat = origin.latitude_deg * kPi / 180.0;
+  const double lon = origin.longitude_deg * kPi / 180.0;
+  const double east = x;
+  const double north = -z;
+  const double up = y;
+  double ecef[3];
+  GeodeticToEcef(origin, ecef);
+  ecef[0] += -std::sin(lon) * east - std::sin(lat) * std::cos(lon) * north +
+             std::cos(lat) * std::cos(lon) * up;
+  ecef[1] += std::cos(lon) * east - std::sin(lat) * std::sin(lon) * north +
+             std::cos(lat) * std::sin(lon) * up;
+  ecef[2] += std::cos(lat) * north + std::sin(lat) * up;
+  return EcefToGeodetic(ecef);
+}
+
+double HorizontalErrorMeters(const Geodetic &a, double latitude_deg,
+                             double longitude_deg) {
+  const double lat = a.latitude_deg * kPi / 180.0;
+  const double north = (latitude_deg - a.latitude_deg) * kPi / 180.0 * kA;
+  const double east = (longitude_deg - a.longitude_deg) * kPi / 180.0 * kA *
+                      std::cos(lat);
+  return std::hypot(north, east);
+}
+
+ProjectionAnchor MakeAnchor(const Geodetic &origin, double x, double y,
+                            double z) {
+  const Geodetic exact = LocalToGeodetic(origin, x, y, z);
+  ProjectionAnchor anchor;
+  anchor.x = x;
+  anchor.y = y;
+  anchor.z = z;
+  anchor.latitude_deg = exact.latitude_deg;
+  anchor.longitude_deg = exact.longitude_deg;
+  anchor.altitude_m = exact.altitude_m;
+  anchor.origin_latitude_deg = origin.latitude_deg;
+  anchor.origin_longitude_deg = origin.longitude_deg;
+  return anchor;
+}
+
+struct ErrorBound {
+  double horizontal_m = 0.0;
+  double vertical_m = 0.0;
+};
+
+// Worst error over a ring of targets `radius_m` from the anchor, spread
+// between the ground and 12 km above the frame origin.
+ErrorBound MeasureRing(const Geodetic &origin, const ProjectionAnchor &anchor,
+                       double radius_m) {
+  const LocalProjection projection(anchor);
+  ErrorBound worst;
+  for (int step = 0; step < 16; ++step) {
+    const double bearing = step * kPi / 8.0;
+    const double x = anchor.x + radius_m * std::sin(bearing);
+    const double z = anchor.z - radius_m * std::cos(bearing);
+    const double y = 800.0 * step;
+    const Geodetic exact = LocalToGeodetic(origin, x, y, z);
+    double latitude = 0.0;
+    double longitude = 0.0;
+    double altitude = 0.0;
+    projection.project(x, y, z, &latitude, &longitude, &altitude);
+    worst.horizontal_m =
+        std::fmax(worst.horizontal_m,
+                  HorizontalErrorMeters(exact, latitude, longitude));
+    worst.vertical_m =
+        std::fmax(worst.vertical_m, std::fabs(exact.altitude_m - altitude));
+  }
+  return worst;
+}
+
+} // namespace
+
+TEST_CASE("LocalProjection is exact at the anchor") {
+  const Geodetic origin{47.45, -122.31, 130.0};
+  const ProjectionAnchor anchor = MakeAnchor(origin, 12000.0, 900.0, -8000.0);
+  const LocalProjection projection(anchor);
+  double latitude = 0.0;
+  double longitude = 0.0;
+  double altitude = 0.0;
+  projection.project(anchor.x, anchor.y, anchor.z, &latitude, &longitude,
+                     &altitude);
+  ASSERT_EQ(anchor.latitude_deg, latitude);
+  ASSERT_EQ(anchor.longitude_deg, longitude);
+  ASSERT_EQ(anchor.altitude_m, altitude);
+}
+
+TEST_CASE("LocalProjection stays within its documented error bound") {
+  const Geodetic origins[] = {
+      {0.5, 10.0, 0.0}, {47.45, -122.31, 130.0}, {-33.9, 151.2, 5.0},
+      {64.1, -21.9, 20.0}};
+  for (const Geodetic &origin : origins) {
+    // Ownship well away from the frame origin, as after a long flight.
+    const ProjectionAnchor anchor =
+        MakeAnchor(origin, -40000.0, 3000.0, 35000.0);
+    const ErrorBound ten_nm = MeasureRing(origin, anchor, 10.0 * 1852.0);
+    ASSERT_TRUE(ten_nm.horizontal_m < 0.5);
+    ASSERT_TRUE(ten_nm.vertical_m < 0.5);
+    const ErrorBound twenty_nm = MeasureRing(origin, anchor, 20.0 * 1852.0);
+    ASSERT_TRUE(twenty_nm.horizontal_m < 3.0);
+    ASSERT_TRUE(twenty_nm.vertical_m < 0.5);
+  }
+}
+
+TEST_CASE("ProjectTrafficSnapshot only projects valid rows in range") {
+  const Geodetic origin{47.45, -122.31, 130.0};
+  const ProjectionAnchor anchor = MakeAnchor(origin, 0.0, 1000.0, 0.0);
+  const LocalProjection projection(anchor);
+
+  TrafficSnapshot snapshot;
+  snapshot.resize(4);
+  const float xs[] = {5000.0f, 30000.0f, 1000.0f, NAN};
+  for (size_t i = 0; i < snapshot.size(); ++i) {
+    snapshot.x[i] = xs[i];
+    snapshot.y[i] = 1500.0f;
+    snapshot.z[i] = -2000.0f;
+    snapshot.flags[i] = xp2gdl90::traffic::TRAFFIC_FLAG_VALID |
+                        xp2gdl90::traffic::TRAFFIC_FLAG_GEODETIC;
+  }
+  snapshot.flags[2] = 0;
+
+  ASSERT_EQ(static_cast<size_t>(1),
+            xp2gdl90::traffic::ProjectTrafficSnapshot(projection, 10000.0,
+                                                      &snapshot));
+  ASSERT_TRUE((snapshot.flags[0] & xp2gdl90::traffic::TRAFFIC_FLAG_GEODETIC) !=
+              0u);
+  for (size_t i = 1; i < snapshot.size(); ++i) {
+    ASSERT_EQ(static_cast<uint8_t>(0),
+              static_cast<uint8_t>(snapshot.flags[i] &
+                                   xp2gdl90::traffic::TRAFFIC_FLAG_GEODETIC));
+  }
+
+  const Geodetic exact = LocalToGeodetic(origin, 5000.0, 1500.0, -2000.0);
+  ASSERT_TRUE(HorizontalErrorMeters(exact, snapshot.latitude[0],
+                                    snapshot.longitude[0]) < 0.5);
+  ASSERT_TRUE(std::fabs(exact.altitude_m * 3.28084 -
+                        snapshot.altitude_ft[0]) < 1.0);
+
+  ASSERT_EQ(static_cast<size_t>(0),
+            xp2gdl90::traffic::ProjectTrafficSnapshot(projection, 0.0,
+                                                      &snapshot));
+  ASSERT_EQ(static_cast<size_t>(0),
+            xp2gdl90::traffic::ProjectTrafficSnapshot(projection, 1.0,
+                                                      nullptr));
+}
@@ -0,0 +1,221 @@
+#include "test_harness.h"
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "xp2gdl90/traffic_relay.h"
+
+using xp2gdl90::traffic::RelayedTraffic;
+using xp2gdl90::traffic::RelayMergeStats;
+using xp2gdl90::traffic::RelayMerger;
+using xp2gdl90::traffic::RelayPriority;
+using xp2gdl90::traffic::TrafficReference;
+using xp2gdl90::traffic::TrafficSelection;
+
+namespace {
+
+gdl90::PositionData Target(uint32_t address, double latitude,
+                           int32_t altitude = 5000) {
+  gdl90::PositionData report;
+  report.icao_address = address;
+  report.latitude = latitude;
+  report.longitude = 8.0;
+  report.altitude = altitude;
+  report.h_velocity = 120;
+  report.track = 90;
+  report.track_type = gdl90::TrackType::TRUE_TRACK;
+  report.airborne = true;
+  report.callsign = "RELAY";
+  return report;
+}
+
+std::vector<uint32_t> Addresses(const std::vector<gdl90::PositionData> &in) {
+  std::vector<uint32_t> addresses;
+  for (const gdl90::PositionData &report : in) {
+    addresses.push_back(report.icao_address);
+  }
+  return addresses;
+}
+
+} // namespace
+
+TEST_CASE("Relayed traffic keeps the latest report per address") {
+  RelayedTraffic relayed;
+  relayed.update(Target(0xA1, 47.0), 1.0);
+  relayed.update(Target(0xA2, 47.1), 1.0);
+  relayed.update(Target(0xA3, 47.2), 2.0);
+  relayed.update(Target(0xA1, 47.5), 3.0);
+  ASSERT_EQ(static_cast<size_t>(3), relayed.size());
+  ASSERT_EQ(static_cast<uint32_t>(0xA1), relayed.reports()[0].icao_address);
+  ASSERT_TRUE(relayed.reports()[0].latitude == 47.5);
+
+  // 0xA2 goes; the rest keep their reports after the swap.
+  ASSERT_EQ(static_cast<size_t>(1), relayed.evictStale(4.0, 2.5));
+  ASSERT_EQ(static_cast<size_t>(2), relayed.size());
+  ASSERT_TRUE(Addresses(relayed.reports()) ==
+              std::vector<uint32_t>({0xA1, 0xA3}));
+  ASSERT_TRUE(relayed.reports()[1].latitude == 47.2);
+  relayed.update(Target(0xA2, 47.3), 5.0);
+  ASSERT_EQ(static_cast<uint32_t>(0xA2), relayed.reports()[2].icao_address);
+
+  relayed.clear();
+  ASSERT_EQ(static_cast<size_t>(0), relayed.size());
+}
+
+TEST_CASE("Relay merge sends each address once by source priority") {
+  const std::vector<gdl90::PositionData> simulator = {Target(0xB1, 47.0),
+                                                      Target(0xB2, 47.01)};
+  std::vector<gdl90::PositionData> relayed = {
+      Target(0xB2, 47.02), Target(0xC1, 47.03), Target(0x0F0F0F, 47.0)};
+  relayed[0].callsign = "FEED";
+
+  RelayMerger merger;
+  TrafficSelection selection;
+  std::vector<gdl90::PositionData> reports = simulator;
+  RelayMergeStats stats =
+      merger.merge(selection, nullptr, RelayPriority::SIMULATOR, 0x0F0F0F,
+                   relayed.data(), relayed.size(), &reports);
+  // Ownship's own address is never relayed back.
+  ASSERT_TRUE(Addresses(reports) ==
+              std::vector<uint32_t>({0xB1, 0xB2, 0xC1}));
+  ASSERT_TRUE(reports[1].callsign == gdl90::Callsign("RELAY"));
+  ASSERT_EQ(static_cast<size_t>(1), stats.added);
+  ASSERT_EQ(static_cast<size_t>(0), stats.replaced);
+
+  reports = simulator;
+  stats = merger.merge(selection, nullptr, RelayPriority::RELAY, 0x0F0F0F,
+                       relayed.data(), relayed.size(), &reports);
+  ASSERT_TRUE(Addresses(reports) ==
+              std::vector<uint32_t>({0xB1, 0xB2, 0xC1}));
+  ASSERT_TRUE(reports[1].callsign == gdl90::Callsign("FEED"));
+  ASSERT_EQ(static_cast<size_t>(1), stats.replaced);
+}
+
+TEST_CASE("Relay merge fills the target budget with the nearest") {
+  TrafficReference ownship;
+  ownship.latitude_deg = 47.0;
+  ownship.longitude_deg = 8.0;
+  ownship.altitude_ft = 5000.0;
+  TrafficSelection selection;
+  selection.max_targets = 3;
+  selection.max_range_m = 30.0 * 1852.0;
+
+  // Roughly 6, 60 (out of range), 3 and 1.2 nm north of ownship, the last
+  // without an altitude.
+  const std::vector<gdl90::PositionData> relayed = {
+      Target(0xD1, 47.1), Target(0xD2, 48.0), Target(0xD3, 47.05),
+      Target(0xD4, 47.02, std::numeric_limits<int32_t>::min())};
+  RelayMerger merger;
+  std::vector<gdl90::PositionData> reports = {Target(0xE1, 47.0)};
+  const RelayMergeStats stats =
+      merger.merge(selection, &ownship, RelayPriority::SIMULATOR, 0,
+                   relayed.data(), relayed.size(), &reports);
+  ASSERT_EQ(static_cast<size_t>(2), stats.added);
+  ASSERT_TRUE(Addresses(reports) ==
+              std::vector<uint32_t>({0xE1, 0xD3, 0xD4}));
+
+  // A full sweep leaves no room, but a relayed copy may still replace.
+  reports = {Target(0xE1, 47.0), Target(0xE2, 47.0), Target(0xD1, 46.9)};
+  const RelayMergeStats full =
+      merger.merge(selection, &ownship, RelayPriority::RELAY, 0,
+                   relayed.data(), relayed.size(), &reports);
+  ASSERT_EQ(static_cast<size_t>(0), full.added);
+  ASSERT_EQ(static_cast<size_t>(1), full.replaced);
+  ASSERT_TRUE(reports[2].latitude == 47.1);
+}
+
+TEST_CASE("Traffic relay listener without a receiver reports errors") {
+  xp2gdl90::traffic::TrafficRelayListener listener(nullptr);
+  ASSERT_EQ(-1, listener.pollOnce(0));
+  ASSERT_EQ(static_cast<uint16_t>(0), listener.getListenPort());
+  gdl90::PositionData out;
+  ASSERT_EQ(static_cast<size_t>(0), listener.takeReports(&out, 1));
+}
+
+#if !defined(_WIN32)
+namespace {
+
+constexpr uint16_t kRelayTestPort = 47605;
+
+void SendDatagram(const std::vector<uint8_t> &payload) {
+  const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_TRUE(fd >= 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(kRelayTestPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  const ssize_t sent =
+      ::sendto(fd, payload.data(), payload.size(), 0,
+               reinterpret_cast<const sockaddr *>(&addr), sizeof(addr));
+  ::close(fd);
+  ASSERT_EQ(static_cast<ssize_t>(payload.size()), sent);
+}
+
+std::unique_ptr<udp::UDPReceiver> OpenReceiver() {
+  auto receiver = std::make_unique<udp::UDPReceiver>(kRelayTestPort);
+  ASSERT_TRUE(receiver->initialize());
+  return receiver;
+}
+
+} // namespace
+
+TEST_CASE("Traffic relay listener queues decoded traffic reports") {
+  xp2gdl90::traffic::TrafficRelayListener listener(OpenReceiver());
+  const gdl90::GDL90Encoder encoder;
+
+  // A packed datagram: heartbeat, ownship, two traffic reports, and one
+  // traffic report with a broken CRC.
+  std::vector<uint8_t> packed = encoder.createHeartbeat();
+  for (const std::vector<uint8_t> &frame :
+       {encoder.createOwnshipReport(Target(0x0F0F0F, 47.0)),
+        encoder.createTrafficReport(Target(0xF1, 47.1)),
+        encoder.createTrafficReport(Target(0xF2, 47.2))}) {
+    packed.insert(packed.end(), frame.begin(), frame.end());
+  }
+  std::vector<uint8_t> broken = encoder.createTrafficReport(Target(0xF3, 47));
+  broken[broken.size() - 3] ^= 0x01;
+  packed.insert(packed.end(), broken.begin(), broken.end());
+  SendDatagram(packed);
+  ASSERT_EQ(2, listener.pollOnce(100));
+
+  gdl90::PositionData out[4];
+  ASSERT_EQ(static_cast<size_t>(2), listener.takeReports(out, 4));
+  ASSERT_EQ(static_cast<uint32_t>(0xF1), out[0].icao_address);
+  ASSERT_EQ(static_cast<uint32_t>(0xF2), out[1].icao_address);
+  const xp2gdl90::traffic::TrafficRelayStats stats = listener.stats();
+  ASSERT_EQ(static_cast<uint64_t>(1), stats.datagrams);
+  ASSERT_EQ(static_cast<uint64_t>(2), stats.reports);
+  ASSERT_EQ(static_cast<uint64_t>(1), stats.bad_frames);
+}
+
+TEST_CASE("Traffic relay thread feeds the relayed traffic table") {
+  xp2gdl90::traffic::TrafficRelayListener listener(OpenReceiver(), 10);
+  ASSERT_TRUE(listener.start());
+  const gdl90::GDL90Encoder encoder;
+  for (uint32_t address = 1; address <= 200; ++address) {
+    SendDatagram(encoder.createTrafficReport(
+        Target(address, 47.0 + 0.001 * static_cast<double>(address))));
+  }
+
+  RelayedTraffic relayed;
+  for (int i = 0; i < 200 && relayed.size() < 200; ++i) {
+    relayed.ingest(&listener, 1.0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  listener.stop();
+  ASSERT_EQ(static_cast<size_t>(200), relayed.size());
+  ASSERT_EQ(static_cast<uint64_t>(200), listener.stats().reports);
+}
+#endif
@@ -0,0 +1,112 @@
+#include "test_harness.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "xp2gdl90/traffic_scheduler.h"
+
+using xp2gdl90::traffic::TrackTable;
+using xp2gdl90::traffic::TrafficRatePolicy;
+using xp2gdl90::traffic::TrafficReference;
+using xp2gdl90::traffic::TrafficScheduleStats;
+
+namespace {
+
+constexpr double kNm = 1852.0;
+
+// A stationary target `range_nm` due north of (47.5, -122.3).
+gdl90::PositionData NorthTarget(uint32_t address, double range_nm) {
+  gdl90::PositionData report;
+  report.latitude = 47.5 + range_nm / 60.0;
+  report.longitude = -122.3;
+  report.icao_address = address;
+  report.h_velocity = 0;
+  report.track_type = gdl90::TrackType::TRUE_TRACK;
+  return report;
+}
+
+TrafficReference Ownship() {
+  TrafficReference ownship;
+  ownship.latitude_deg = 47.5;
+  ownship.longitude_deg = -122.3;
+  return ownship;
+}
+
+} // namespace
+
+TEST_CASE("TrafficUpdateInterval follows range and closure") {
+  const TrafficRatePolicy policy;
+  ASSERT_EQ(0.5, xp2gdl90::traffic::TrafficUpdateInterval(policy, 0.0, 0.0));
+  ASSERT_EQ(0.5,
+            xp2gdl90::traffic::TrafficUpdateInterval(policy, 5.0 * kNm, 0.0));
+  ASSERT_EQ(2.75,
+            xp2gdl90::traffic::TrafficUpdateInterval(policy, 15.0 * kNm, 0.0));
+  ASSERT_EQ(5.0,
+            xp2gdl90::traffic::TrafficUpdateInterval(policy, 40.0 * kNm, 0.0));
+  // Diverging traffic keeps the interval for its range; closing at 250 kt
+  // from 25 nm ends up 20.8 nm away after 60 s.
+  ASSERT_EQ(5.0, xp2gdl90::traffic::TrafficUpdateInterval(policy, 25.0 * kNm,
+                                                          -200.0));
+  const double closing = xp2gdl90::traffic::TrafficUpdateInterval(
+      policy, 25.0 * kNm, 250.0 * kNm / 3600.0);
+  ASSERT_TRUE(closing > 4.0 && closing < 4.1);
+}
+
+TEST_CASE("ScheduleTrafficReports sends near traffic more often") {
+  const TrafficRatePolicy policy;
+  TrackTable tracks;
+  size_t near_sent = 0;
+  size_t far_sent = 0;
+  // Ten seconds of 2 Hz sweeps.
+  for (int sweep = 0; sweep < 20; ++sweep) {
+    std::vector<gdl90::PositionData> reports = {NorthTarget(0x100, 2.0),
+                                                NorthTarget(0x200, 30.0)};
+    xp2gdl90::traffic::ScheduleTrafficReports(policy, Ownship(), sweep * 0.5,
+                                              0.5, &tracks, &reports,
+                                              nullptr);
+    for (const gdl90::PositionData &report : reports) {
+      ++(report.icao_address == 0x100 ? near_sent : far_sent);
+    }
+  }
+  ASSERT_TRUE(near_sent >= 19);
+  ASSERT_TRUE(far_sent >= 2 && far_sent <= 3);
+  ASSERT_EQ(static_cast<size_t>(2), tracks.size());
+}
+
+TEST_CASE("ScheduleTrafficReports spreads new targets and keeps a budget") {
+  TrafficRatePolicy policy;
+  TrackTable tracks;
+  size_t first_sweep = 0;
+  size_t total = 0;
+  // Forty targets 15 nm out, each due every 2.75 s.
+  for (int sweep = 0; sweep < 22; ++sweep) {
+    std::vector<gdl90::PositionData> reports;
+    for (uint32_t address = 1; address <= 40; ++address) {
+      reports.push_back(NorthTarget(address, 15.0));
+    }
+    xp2gdl90::traffic::ScheduleTrafficReports(policy, Ownship(), sweep * 0.5,
+                                              0.5, &tracks, &reports,
+                                              nullptr);
+    if (sweep == 0) {
+      first_sweep = reports.size();
+    }
+    total += reports.size();
+  }
+  // Phases spread the first reports over the interval instead of a burst.
+  ASSERT_TRUE(first_sweep < 20);
+  // About four reports per target over eleven seconds.
+  ASSERT_TRUE(total >= 150 && total <= 170);
+
+  policy.max_frames_per_second = 4.0;
+  tracks.clear();
+  std::vector<gdl90::PositionData> reports;
+  for (uint32_t address = 1; address <= 40; ++address) {
+    reports.push_back(NorthTarget(address, 1.0));
+  }
+  TrafficScheduleStats stats;
+  xp2gdl90::traffic::ScheduleTrafficReports(policy, Ownship(), 100.0, 0.5,
+                                            &tracks, &reports, &stats);
+  ASSERT_EQ(static_cast<size_t>(2), reports.size());
+  ASSERT_EQ(static_cast<size_t>(2), stats.sent);
+  ASSERT_EQ(stats.due - stats.sent, stats.deferred);
+}
@@ -0,0 +1,131 @@
+#include "test_harness.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "xp2gdl90/msfs_bridge.h"
+#include "xp2gdl90/traffic_selection.h"
+
+using xp2gdl90::traffic::TrafficCandidate;
+using xp2gdl90::traffic::TrafficReference;
+using xp2gdl90::traffic::TrafficSelection;
+using xp2gdl90::traffic::TrafficSnapshot;
+
+namespace {
+
+std::vector<uint32_t> SortedRows(const std::vector<TrafficCandidate> &list) {
+  std::vector<uint32_t> rows;
+  for (const TrafficCandidate &candidate : list) {
+    rows.push_back(candidate.row);
+  }
+  std::sort(rows.begin(), rows.end());
+  return rows;
+}
+
+} // namespace
+
+TEST_CASE("MakeTrafficCandidate measures range, closure and altitude") {
+  TrafficCandidate candidate;
+  // 3 km east, 4 km north, 300 m above, flying west at 100 m/s.
+  ASSERT_TRUE(xp2gdl90::traffic::MakeTrafficCandidate(
+      1, 3000.0, 300.0, -4000.0, -100.0, 0.0, &candidate));
+  ASSERT_EQ(5000.0f, candidate.range_m);
+  ASSERT_TRUE(std::fabs(candidate.closure_mps - 60.0f) < 1e-3f);
+  ASSERT_TRUE(std::fabs(candidate.altitude_delta_ft - 984.252f) < 1e-2f);
+
+  ASSERT_TRUE(xp2gdl90::traffic::MakeTrafficCandidate(2, 10.0, 0.0, 0.0, NAN,
+                                                      NAN, &candidate));
+  ASSERT_EQ(0.0f, candidate.closure_mps);
+  ASSERT_TRUE(!xp2gdl90::traffic::MakeTrafficCandidate(3, NAN, 0.0, 0.0, 0.0,
+                                                       0.0, &candidate));
+}
+
+TEST_CASE("SelectNearestTraffic keeps the nearest targets inside the limits") {
+  TrafficSnapshot snapshot;
+  snapshot.resize(8);
+  // Row 0 is ownship at the origin and is never a candidate.
+  const float xs[] = {0.0f,    9000.0f, 1000.0f, 20000.0f,
+                      4000.0f, 2000.0f, 3000.0f, 500.0f};
+  for (size_t i = 0; i < snapshot.size(); ++i) {
+    snapshot.x[i] = xs[i];
+    snapshot.flags[i] = i == 0 ? 0 : xp2gdl90::traffic::TRAFFIC_FLAG_VALID;
+  }
+  snapshot.y[7] = 2000.0f; // 6562 ft above.
+
+  TrafficReference ownship;
+  std::vector<TrafficCandidate> candidates;
+  xp2gdl90::traffic::MeasureLocalTraffic(snapshot, ownship, &candidates);
+  ASSERT_EQ(static_cast<size_t>(7), candidates.size());
+
+  TrafficSelection selection;
+  selection.max_targets = 3;
+  selection.max_range_m = 10000.0;
+  selection.max_altitude_delta_ft = 5000.0;
+  ASSERT_EQ(static_cast<size_t>(3), xp2gdl90::traffic::SelectNearestTraffic(
+                                        selection, &candidates, &snapshot));
+  const std::vector<uint32_t> expected = {2, 5, 6};
+  ASSERT_TRUE(expected == SortedRows(candidates));
+  for (size_t i = 0; i < snapshot.size(); ++i) {
+    const bool selected =
+        std::find(expected.begin(), expected.end(), i) != expected.end();
+    ASSERT_EQ(selected, (snapshot.flags[i] &
+                         xp2gdl90::traffic::TRAFFIC_FLAG_VALID) != 0u);
+  }
+}
+
+TEST_CASE("SelectNearestTraffic ranks closing traffic with a lookahead") {
+  std::vector<TrafficCandidate> candidates(2);
+  // Row 0 is near and opening; row 1 is farther but closing fast.
+  xp2gdl90::traffic::MakeTrafficCandidate(0, 2000.0, 0.0, 0.0, 20.0, 0.0,
+                                          &candidates[0]);
+  xp2gdl90::traffic::MakeTrafficCandidate(1, 6000.0, 0.0, 0.0, -150.0, 0.0,
+                                          &candidates[1]);
+
+  TrafficSelection selection;
+  selection.max_targets = 1;
+  std::vector<TrafficCandidate> by_range = candidates;
+  xp2gdl90::traffic::SelectNearestTraffic(selection, &by_range);
+  ASSERT_EQ(static_cast<uint32_t>(0), by_range[0].row);
+
+  selection.closure_lookahead_s = 30.0;
+  xp2gdl90::traffic::SelectNearestTraffic(selection, &candidates);
+  ASSERT_EQ(static_cast<uint32_t>(1), candidates[0].row);
+  ASSERT_EQ(1500.0f, candidates[0].score);
+}
+
+TEST_CASE("MSFS traffic positions keep the nearest targets to ownship") {
+  xp2gdl90::traffic::TrackTable tracks;
+  TrafficSnapshot snapshot;
+  msfs_bridge::TrafficData traffic;
+  const double latitudes[] = {47.9, 47.51, 47.6, 47.52};
+  for (uint32_t id = 0; id < 4; ++id) {
+    traffic.object_id = id + 1;
+    traffic.latitude_deg = latitudes[id];
+    traffic.longitude_deg = -122.3;
+    msfs_bridge::UpsertTrafficTarget(&tracks, &snapshot, traffic, 1.0);
+  }
+
+  msfs_bridge::OwnshipData ownship;
+  ownship.latitude_deg = 47.5;
+  ownship.longitude_deg = -122.3;
+  xp2gdl90::Settings cfg;
+  cfg.traffic_max_targets = 2;
+  std::vector<gdl90::PositionData> reports;
+  ASSERT_EQ(static_cast<size_t>(2),
+            msfs_bridge::BuildTrafficPositions(&snapshot, cfg, &ownship,
+                                               nullptr, &reports));
+  std::vector<double> sent = {reports[0].latitude, reports[1].latitude};
+  std::sort(sent.begin(), sent.end());
+  ASSERT_EQ(47.51, sent[0]);
+  ASSERT_EQ(47.52, sent[1]);
+
+  // Beyond 10 nm is dropped even with slots to spare.
+  cfg.traffic_max_targets = 63;
+  cfg.traffic_range_nm = 10.0f;
+  reports.clear();
+  ASSERT_EQ(static_cast<size_t>(3),
+            msfs_bridge::BuildTrafficPositions(&snapshot, cfg, &ownship,
+                                               nullptr, &reports));
+}
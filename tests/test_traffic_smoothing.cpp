@@ -0,0 +1,74 @@
+#include "test_harness.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "xp2gdl90/traffic_smoothing.h"
+
+using xp2gdl90::traffic::SmoothTrafficReports;
+using xp2gdl90::traffic::TrackTable;
+
+namespace {
+
+constexpr double kMetersPerDegree = 6371008.8 * 3.14159265358979323846 / 180.0;
+
+// Due south at 60 m/s, descending 600 fpm, with a noisy heading only.
+gdl90::PositionData Southbound(double t) {
+  gdl90::PositionData report;
+  report.icao_address = 0xC0FFEE;
+  report.latitude = 47.0 - 60.0 * t / kMetersPerDegree;
+  report.longitude = 8.0;
+  report.altitude = static_cast<int32_t>(std::lround(5000.0 - 10.0 * t));
+  report.h_velocity = 0;
+  report.v_velocity = 0;
+  report.track = 170;
+  report.track_type = gdl90::TrackType::TRUE_HEADING;
+  return report;
+}
+
+} // namespace
+
+TEST_CASE("Traffic smoothing fills velocities from the track history") {
+  TrackTable tracks;
+  tracks.setHistoryEnabled(true);
+  std::vector<gdl90::PositionData> reports;
+  for (int sweep = 0; sweep < 2; ++sweep) {
+    reports = {Southbound(sweep)};
+    ASSERT_EQ(static_cast<size_t>(0),
+              SmoothTrafficReports(sweep, 1.0, &tracks, &reports));
+  }
+  ASSERT_TRUE(reports[0].track_type == gdl90::TrackType::TRUE_HEADING);
+
+  for (int sweep = 2; sweep < 6; ++sweep) {
+    reports = {Southbound(sweep)};
+    ASSERT_EQ(static_cast<size_t>(1),
+              SmoothTrafficReports(sweep, 1.0, &tracks, &reports));
+  }
+  const gdl90::PositionData &report = reports[0];
+  ASSERT_TRUE(report.track_type == gdl90::TrackType::TRUE_TRACK);
+  ASSERT_TRUE(report.track == 179 || report.track == 180);
+  ASSERT_TRUE(std::abs(static_cast<int>(report.h_velocity) - 117) <= 1);
+  ASSERT_TRUE(std::abs(report.v_velocity + 600) <= 15);
+  ASSERT_EQ(static_cast<size_t>(1), tracks.size());
+}
+
+TEST_CASE("Traffic smoothing keeps an invalid altitude's rate and needs "
+          "histories") {
+  TrackTable tracks;
+  std::vector<gdl90::PositionData> reports = {Southbound(0.0)};
+  ASSERT_EQ(static_cast<size_t>(0),
+            SmoothTrafficReports(0.0, 1.0, &tracks, &reports));
+  ASSERT_TRUE(tracks.empty());
+
+  tracks.setHistoryEnabled(true);
+  for (int sweep = 0; sweep < 4; ++sweep) {
+    reports = {Southbound(sweep)};
+    reports[0].altitude = std::numeric_limits<int32_t>::min();
+    reports[0].v_velocity = std::numeric_limits<int16_t>::min();
+    SmoothTrafficReports(sweep, 1.0, &tracks, &reports);
+  }
+  ASSERT_EQ(std::numeric_limits<int16_t>::min(), reports[0].v_velocity);
+  ASSERT_TRUE(reports[0].track_type == gdl90::TrackType::TRUE_TRACK);
+}
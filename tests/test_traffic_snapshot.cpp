@@ -0,0 +1,168 @@
+#include "test_harness.h"
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "xp2gdl90/msfs_bridge.h"
+#include "xp2gdl90/track_table.h"
+#include "xp2gdl90/traffic_snapshot.h"
+#include "xp2gdl90/traffic_support.h"
+
+using xp2gdl90::traffic::TrafficSnapshot;
+
+TEST_CASE("TrafficSnapshot keeps every column the same length") {
+  TrafficSnapshot snapshot;
+  ASSERT_TRUE(snapshot.empty());
+  ASSERT_EQ(static_cast<size_t>(0), snapshot.append());
+  ASSERT_EQ(static_cast<size_t>(1), snapshot.append());
+  ASSERT_EQ(static_cast<size_t>(2), snapshot.size());
+  ASSERT_EQ(static_cast<size_t>(2), snapshot.callsign.size());
+  ASSERT_EQ(static_cast<size_t>(2), snapshot.v_velocity_fpm.size());
+  ASSERT_TRUE(std::isnan(snapshot.ground_speed_kt[1]));
+  ASSERT_EQ(-1, snapshot.ssr_mode[1]);
+
+  snapshot.clear();
+  ASSERT_TRUE(snapshot.empty());
+  ASSERT_TRUE(snapshot.flags.empty());
+}
+
+TEST_CASE("TrafficCallsign round-trips and truncates to eight bytes") {
+  const auto callsign = xp2gdl90::traffic::MakeTrafficCallsign("N12345");
+  ASSERT_EQ(std::string("N12345"),
+            xp2gdl90::traffic::TrafficCallsignToString(callsign));
+  const auto full = xp2gdl90::traffic::MakeTrafficCallsign("ABCDEFGHIJ");
+  ASSERT_EQ(std::string("ABCDEFGH"),
+            xp2gdl90::traffic::TrafficCallsignToString(full));
+}
+
+TEST_CASE("MarkPopulatedTcasTargets matches the per-target rules") {
+  TrafficSnapshot snapshot;
+  snapshot.resize(4);
+  for (size_t i = 0; i < snapshot.size(); ++i) {
+    snapshot.source_id[i] = static_cast<uint32_t>(i);
+    snapshot.x[i] = 100.0f;
+  }
+  // Slot 0 is ownship, slot 2 holds X-Plane's -FLT_MAX sentinel and slot 3
+  // is an all-zero empty slot.
+  snapshot.x[2] = -std::numeric_limits<float>::max();
+  snapshot.x[3] = 0.0f;
+
+  ASSERT_EQ(static_cast<size_t>(1),
+            xp2gdl90::traffic::MarkPopulatedTcasTargets(&snapshot));
+  ASSERT_EQ(xp2gdl90::traffic::TRAFFIC_FLAG_VALID, snapshot.flags[1]);
+  ASSERT_EQ(static_cast<uint8_t>(0), snapshot.flags[0]);
+  ASSERT_EQ(static_cast<uint8_t>(0), snapshot.flags[2]);
+  ASSERT_EQ(static_cast<uint8_t>(0), snapshot.flags[3]);
+
+  snapshot.callsign[3] = xp2gdl90::traffic::MakeTrafficCallsign("TFC");
+  ASSERT_EQ(static_cast<size_t>(2),
+            xp2gdl90::traffic::MarkPopulatedTcasTargets(&snapshot));
+}
+
+TEST_CASE("AssignTcasAddresses synthesizes and drops ownship collisions") {
+  TrafficSnapshot snapshot;
+  snapshot.resize(3);
+  for (size_t i = 0; i < snapshot.size(); ++i) {
+    snapshot.source_id[i] = static_cast<uint32_t>(i + 1);
+    snapshot.flags[i] = xp2gdl90::traffic::TRAFFIC_FLAG_VALID;
+  }
+  snapshot.raw_address[0] = static_cast<int>(0x80ABCDEFu);
+  snapshot.raw_address[1] = 0;
+  snapshot.callsign[1] = xp2gdl90::traffic::MakeTrafficCallsign("N1");
+  snapshot.raw_address[2] = 0x00123456;
+
+  xp2gdl90::traffic::AssignTcasAddresses(&snapshot, 0x123456u);
+  ASSERT_EQ(static_cast<uint32_t>(0xABCDEFu), snapshot.address[0]);
+  ASSERT_EQ(xp2gdl90::traffic::SyntheticTrafficAddress(2, "N1", 0x123456u),
+            snapshot.address[1]);
+  ASSERT_TRUE((snapshot.flags[1] &
+               xp2gdl90::traffic::TRAFFIC_FLAG_SYNTHETIC_ADDRESS) != 0u);
+  ASSERT_EQ(static_cast<uint8_t>(0), snapshot.flags[2]);
+
+  // A precomputed synthetic address is used as is.
+  snapshot.flags[1] = xp2gdl90::traffic::TRAFFIC_FLAG_VALID;
+  snapshot.synthetic_address[1] = 0xF00001u;
+  xp2gdl90::traffic::AssignTcasAddresses(&snapshot, 0x123456u);
+  ASSERT_EQ(static_cast<uint32_t>(0xF00001u), snapshot.address[1]);
+}
+
+TEST_CASE("ConvertTrafficVelocities derives knots and feet per minute") {
+  TrafficSnapshot snapshot;
+  snapshot.resize(3);
+  snapshot.vx[0] = 3.0f;
+  snapshot.vz[0] = 4.0f;
+  snapshot.vy[0] = 1.0f;
+  snapshot.ground_speed_kt[1] = 120.0f;
+  snapshot.vertical_speed_fpm[1] = -500.0f;
+  snapshot.vx[2] = NAN;
+  snapshot.vy[2] = NAN;
+
+  xp2gdl90::traffic::ConvertTrafficVelocities(&snapshot);
+  ASSERT_EQ(static_cast<uint16_t>(9), snapshot.h_velocity_kt[0]);
+  ASSERT_EQ(static_cast<int16_t>(196), snapshot.v_velocity_fpm[0]);
+  ASSERT_EQ(static_cast<uint16_t>(120), snapshot.h_velocity_kt[1]);
+  ASSERT_EQ(static_cast<int16_t>(-500), snapshot.v_velocity_fpm[1]);
+  ASSERT_EQ(static_cast<uint16_t>(0xFFF), snapshot.h_velocity_kt[2]);
+  ASSERT_EQ(std::numeric_limits<int16_t>::min(), snapshot.v_velocity_fpm[2]);
+}
+
+TEST_CASE("TrafficSnapshot removeRow moves the last row into the gap") {
+  TrafficSnapshot snapshot;
+  snapshot.resize(3);
+  for (size_t i = 0; i < snapshot.size(); ++i) {
+    snapshot.source_id[i] = static_cast<uint32_t>(10 + i);
+    snapshot.callsign[i] =
+        xp2gdl90::traffic::MakeTrafficCallsign(std::string(1, 'A' + i));
+  }
+  snapshot.removeRow(0);
+  snapshot.removeRow(5);
+  ASSERT_EQ(static_cast<size_t>(2), snapshot.size());
+  ASSERT_EQ(static_cast<size_t>(2), snapshot.v_velocity_fpm.size());
+  ASSERT_EQ(static_cast<uint32_t>(12), snapshot.source_id[0]);
+  ASSERT_EQ(std::string("C"), xp2gdl90::traffic::TrafficCallsignToString(
+                                  snapshot.callsign[0]));
+  ASSERT_EQ(static_cast<uint32_t>(11), snapshot.source_id[1]);
+}
+
+TEST_CASE("MSFS traffic rows are upserted by object ID") {
+  xp2gdl90::traffic::TrackTable tracks;
+  TrafficSnapshot snapshot;
+  msfs_bridge::TrafficData traffic;
+  traffic.object_id = 7;
+  traffic.latitude_deg = 37.5;
+  traffic.longitude_deg = -122.0;
+  traffic.ground_velocity_kt = 90.0;
+  traffic.velocity_world_z_fps = 100.0;
+  traffic.callsign = "dal-12";
+  ASSERT_EQ(static_cast<size_t>(0), msfs_bridge::UpsertTrafficTarget(
+                                         &tracks, &snapshot, traffic, 1.0));
+
+  traffic.latitude_deg = 37.6;
+  ASSERT_EQ(static_cast<size_t>(0), msfs_bridge::UpsertTrafficTarget(
+                                         &tracks, &snapshot, traffic, 1.0));
+  traffic.object_id = 8;
+  traffic.latitude_deg = 200.0;
+  ASSERT_EQ(static_cast<size_t>(1), msfs_bridge::UpsertTrafficTarget(
+                                         &tracks, &snapshot, traffic, 1.0));
+
+  std::vector<gdl90::PositionData> reports;
+  ASSERT_EQ(static_cast<size_t>(1),
+            msfs_bridge::BuildTrafficPositions(
+                &snapshot, xp2gdl90::Settings{}, nullptr, nullptr, &reports));
+  ASSERT_EQ(37.6, reports[0].latitude);
+  ASSERT_EQ(static_cast<uint16_t>(90), reports[0].h_velocity);
+  ASSERT_EQ(static_cast<uint16_t>(0), reports[0].track);
+  ASSERT_EQ(std::string("DAL 12"), reports[0].callsign.str());
+  ASSERT_EQ(msfs_bridge::SyntheticTrafficAddress(7),
+            reports[0].icao_address);
+
+  // Object 8 stops reporting and is evicted with its row.
+  traffic.object_id = 7;
+  msfs_bridge::UpsertTrafficTarget(&tracks, &snapshot, traffic, 5.0);
+  ASSERT_EQ(static_cast<size_t>(1), tracks.evictStale(5.0, 3.0, &snapshot));
+  ASSERT_EQ(static_cast<size_t>(1), snapshot.size());
+  ASSERT_EQ(static_cast<uint32_t>(7), snapshot.source_id[0]);
+}
@@ -1,6 +1,7 @@
 #include "test_harness.h"
 
 #include <limits>
+#include <string>
 
 #include "xp2gdl90/traffic_support.h"
 
@@ -65,3 +66,32 @@ TEST_CASE("Pressure correction preserves traffic relative altitude") {
             xp2gdl90::traffic::CorrectGeometricToPressureAltitude(
                 std::numeric_limits<int32_t>::min(), 1000.0, 500.0));
 }
+
+TEST_CASE("Traffic identity cache refreshes on address change or interval") {
+  xp2gdl90::traffic::TrafficIdentityCache cache(2.0);
+  ASSERT_TRUE(cache.needsRefresh(3, 0xABC, 0x123456, 10.0));
+  const xp2gdl90::traffic::TrafficIdentity &stored =
+      cache.store(3, 0xABC, "AAL123", 0x123456, 10.0);
+  ASSERT_EQ(std::string("AAL123"),
+            xp2gdl90::traffic::TrafficCallsignToString(stored.callsign));
+  ASSERT_EQ(xp2gdl90::traffic::SyntheticTrafficAddress(3, "AAL123", 0x123456),
+            stored.synthetic_address);
+
+  ASSERT_TRUE(!cache.needsRefresh(3, 0xABC, 0x123456, 11.5));
+  ASSERT_TRUE(cache.needsRefresh(3, 0xDEF, 0x123456, 11.5));
+  ASSERT_TRUE(cache.needsRefresh(3, 0xABC, 0x654321, 11.5));
+  ASSERT_TRUE(cache.needsRefresh(3, 0xABC, 0x123456, 12.0));
+  // A clock reset is due rather than fresh for another interval.
+  ASSERT_TRUE(cache.needsRefresh(3, 0xABC, 0x123456, 1.0));
+  // Slots below a stored one are not stored yet.
+  ASSERT_TRUE(cache.needsRefresh(1, 0, 0x123456, 11.5));
+
+  cache.store(3, 0xABC, "", 0x123456, 12.0);
+  ASSERT_EQ('\0', cache.get(3).callsign[0]);
+  ASSERT_EQ(xp2gdl90::traffic::SyntheticTrafficAddress(3, "", 0x123456),
+            cache.get(3).synthetic_address);
+  ASSERT_EQ(static_cast<uint64_t>(2), cache.refreshes());
+
+  cache.clear();
+  ASSERT_TRUE(cache.needsRefresh(3, 0xABC, 0x123456, 12.5));
+}
@@ -0,0 +1,202 @@
+#include "test_harness.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xp2gdl90/gdl90_decoder.h"
+#include "xp2gdl90/traffic_worker.h"
+
+using xp2gdl90::traffic::TrafficSweepJob;
+using xp2gdl90::traffic::TrafficSweepResult;
+
+namespace {
+
+// Ownship in row 0 and two targets east of it, anchored in Switzerland.
+TrafficSweepJob MakeJob(double broadcast_time) {
+  TrafficSweepJob job;
+  xp2gdl90::traffic::TrafficSnapshot &snapshot = job.snapshot;
+  snapshot.resize(3);
+  for (size_t row = 0; row < snapshot.size(); ++row) {
+    snapshot.source_id[row] = static_cast<uint32_t>(row);
+    snapshot.x[row] = 2000.0f * static_cast<float>(row);
+    snapshot.y[row] = 0.0f;
+    snapshot.z[row] = 0.0f;
+    snapshot.vx[row] = 0.0f;
+    snapshot.vz[row] = -60.0f;
+    snapshot.ssr_mode[row] = 3;
+  }
+  snapshot.raw_address[1] = static_cast<int>(0x80ABCDEFu);
+  snapshot.raw_address[2] = static_cast<int>(0x80123456u);
+
+  xp2gdl90::traffic::TrafficSweepParams &params = job.params;
+  params.broadcast_time = broadcast_time;
+  params.selection.max_targets = 10;
+  params.context.ownship_address = 0x111111;
+  params.anchored = true;
+  params.anchor.latitude_deg = 47.0;
+  params.anchor.longitude_deg = 8.0;
+  params.anchor.altitude_m = 1000.0;
+  params.anchor.origin_latitude_deg = 47.0;
+  params.anchor.origin_longitude_deg = 8.0;
+  params.projection_radius_m = INFINITY;
+  params.sweep_interval_s = 1.0;
+  params.stale_after_s = 3.0;
+  return job;
+}
+
+int g_exact_conversions = 0;
+
+// Stands in for XPLMLocalToWorld with a position no projection gives.
+bool FixedLocalToWorld(double, double, double, double *out_latitude,
+                       double *out_longitude, int32_t *out_altitude_feet) {
+  ++g_exact_conversions;
+  *out_latitude = 46.5;
+  *out_longitude = 9.25;
+  *out_altitude_feet = 12000;
+  return true;
+}
+
+std::vector<uint8_t> FrameBytes(const TrafficSweepResult &result) {
+  return std::vector<uint8_t>(result.frames.data(),
+                              result.frames.data() + result.frames.size());
+}
+
+} // namespace
+
+TEST_CASE("Traffic sweeper encodes one frame per selected target") {
+  xp2gdl90::traffic::TrafficSweeper sweeper;
+  TrafficSweepJob job = MakeJob(10.0);
+  TrafficSweepResult result;
+  sweeper.sweep(job.params, &job.snapshot, &result);
+  ASSERT_EQ(size_t{2}, result.target_count);
+  ASSERT_EQ(size_t{2}, result.frames.frameCount());
+  ASSERT_EQ(size_t{2}, result.tracked);
+  ASSERT_EQ(10.0, result.broadcast_time);
+
+  // Tracks outlive a sweep that misses them until they go stale.
+  std::vector<gdl90::PositionData> none;
+  TrafficSweepJob later = MakeJob(12.0);
+  sweeper.finish(later.params, &none, &result);
+  ASSERT_EQ(size_t{0}, result.frames.frameCount());
+  ASSERT_EQ(size_t{2}, result.tracked);
+  later.params.broadcast_time = 14.0;
+  later.params.reset_tracks = true;
+  sweeper.finish(later.params, &none, &result);
+  ASSERT_EQ(size_t{0}, result.tracked);
+}
+
+TEST_CASE("Traffic sweeper merges relayed targets into the sweep") {
+  xp2gdl90::traffic::TrafficSweeper sweeper;
+  TrafficSweepJob job = MakeJob(10.0);
+  job.params.ownship.latitude_deg = 47.0;
+  job.params.ownship.longitude_deg = 8.0;
+  gdl90::PositionData relayed;
+  relayed.icao_address = 0x654321;
+  relayed.latitude = 47.01;
+  relayed.longitude = 8.0;
+  relayed.altitude = 3000;
+  job.relayed.assign(2, relayed);
+  job.relayed[1].icao_address = 0x111111; // Ownship as the feed sees it.
+  job.params.relayed = job.relayed.data();
+  job.params.relayed_count = job.relayed.size();
+
+  TrafficSweepResult result;
+  sweeper.sweep(job.params, &job.snapshot, &result);
+  ASSERT_EQ(size_t{3}, result.target_count);
+  ASSERT_EQ(size_t{1}, result.relayed_count);
+  ASSERT_EQ(size_t{3}, result.frames.frameCount());
+  ASSERT_EQ(size_t{3}, result.tracked);
+}
+
+TEST_CASE("Traffic worker keeps exact positions past the projection radius") {
+  xp2gdl90::traffic::TrafficWorker worker;
+  TrafficSweepJob *job = worker.jobSlot();
+  ASSERT_TRUE(job != nullptr);
+  *job = MakeJob(40.0);
+  // The first target is 2 km out and projected, the second 4 km out.
+  job->params.projection_radius_m = 3000.0;
+  g_exact_conversions = 0;
+  ASSERT_EQ(size_t{1}, xp2gdl90::traffic::ConvertDistantTcasTraffic(
+                           job->params.anchor, job->params.projection_radius_m,
+                           FixedLocalToWorld, &job->snapshot));
+  ASSERT_EQ(1, g_exact_conversions);
+  worker.submit();
+  ASSERT_EQ(size_t{1}, worker.drain());
+
+  TrafficSweepResult result;
+  ASSERT_TRUE(worker.takeResult(&result));
+  ASSERT_EQ(size_t{2}, result.frames.frameCount());
+  gdl90::Decoder decoder(result.frames.data(), result.frames.size());
+  gdl90::FrameSpan frame;
+  size_t decoded = 0;
+  while (decoder.next(&frame)) {
+    gdl90::PositionData report;
+    ASSERT_TRUE(gdl90::DecodePositionReport(frame, &report));
+    if (report.icao_address == 0x123456) {
+      ASSERT_TRUE(std::fabs(report.latitude - 46.5) < 1e-4);
+      ASSERT_TRUE(std::fabs(report.longitude - 9.25) < 1e-4);
+      ASSERT_EQ(12000, report.altitude);
+    } else {
+      ASSERT_TRUE(std::fabs(report.latitude - 47.0) < 1e-3);
+      ASSERT_TRUE(report.longitude > 8.0 && report.longitude < 8.1);
+    }
+    ++decoded;
+  }
+  ASSERT_EQ(size_t{2}, decoded);
+}
+
+TEST_CASE("Traffic worker hands back the newest sweep and skips when full") {
+  xp2gdl90::traffic::TrafficWorker worker(2);
+  TrafficSweepResult result;
+  ASSERT_TRUE(!worker.takeResult(&result));
+  ASSERT_TRUE(!worker.busy());
+
+  for (int i = 0; i < 2; ++i) {
+    TrafficSweepJob *job = worker.jobSlot();
+    ASSERT_TRUE(job != nullptr);
+    *job = MakeJob(20.0 + i);
+    worker.submit();
+  }
+  ASSERT_TRUE(worker.jobSlot() == nullptr);
+  ASSERT_EQ(uint64_t{1}, worker.sweepsSkipped());
+  ASSERT_TRUE(worker.busy());
+
+  ASSERT_EQ(size_t{2}, worker.drain());
+  ASSERT_TRUE(worker.takeResult(&result));
+  ASSERT_EQ(21.0, result.broadcast_time);
+  ASSERT_EQ(size_t{2}, result.frames.frameCount());
+  ASSERT_TRUE(!worker.busy());
+  ASSERT_TRUE(!worker.takeResult(&result));
+}
+
+TEST_CASE("Traffic worker thread matches an inline sweep") {
+  xp2gdl90::traffic::TrafficSweeper sweeper;
+  TrafficSweepJob inline_job = MakeJob(30.0);
+  TrafficSweepResult expected;
+  sweeper.sweep(inline_job.params, &inline_job.snapshot, &expected);
+
+  xp2gdl90::traffic::TrafficWorker worker;
+  std::string error;
+  ASSERT_TRUE(worker.start(&error));
+  ASSERT_TRUE(worker.isRunning());
+  TrafficSweepJob *job = worker.jobSlot();
+  ASSERT_TRUE(job != nullptr);
+  *job = MakeJob(30.0);
+  worker.submit();
+
+  TrafficSweepResult result;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (!worker.takeResult(&result) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  worker.stop();
+  ASSERT_TRUE(!worker.isRunning());
+  ASSERT_EQ(expected.target_count, result.target_count);
+  ASSERT_TRUE(FrameBytes(expected) == FrameBytes(result));
+}
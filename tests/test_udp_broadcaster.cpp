@@ -12,6 +12,8 @@
 #include <sys/socket.h>
 #endif
 
+#include "fake_socket_ops.h"
+#include "xp2gdl90/foreflight_discovery.h"
 #include "xp2gdl90/udp_broadcaster.h"
 
 #if defined(XP2GDL90_ENABLE_SOCKET_OPS_TESTS)
@@ -25,65 +27,7 @@ uintptr_t xp2gdl90_test_default_socket_ops_create_socket(int domain, int type,
 } // namespace udp
 #endif
 
-namespace {
-
-struct FakeSocketOps final : udp::detail::SocketOps {
-  int startup_result = 0;
-  uintptr_t create_socket_result = udp::UDPBroadcaster::kInvalidSocket;
-  int setsockopt_result = 0;
-  int inet_pton_result = 1;
-  intptr_t sendto_result = -1;
-  int close_result = 0;
-  int last_error_value = 0;
-
-  int startup_calls = 0;
-  int cleanup_calls = 0;
-  int create_socket_calls = 0;
-  int setsockopt_calls = 0;
-  int inet_pton_calls = 0;
-  int sendto_calls = 0;
-  int close_calls = 0;
-
-  uintptr_t last_closed_socket = udp::UDPBroadcaster::kInvalidSocket;
-
-  int Startup() override {
-    ++startup_calls;
-    return startup_result;
-  }
-
-  void Cleanup() override { ++cleanup_calls; }
-
-  uintptr_t CreateSocket(int, int, int) override {
-    ++create_socket_calls;
-    return create_socket_result;
-  }
-
-  int SetSockOpt(uintptr_t, int, int, const void *, size_t) override {
-    ++setsockopt_calls;
-    return setsockopt_result;
-  }
-
-  int InetPton(int, const char *, void *) override {
-    ++inet_pton_calls;
-    return inet_pton_result;
-  }
-
-  intptr_t SendTo(uintptr_t, const void *, size_t, int, const void *,
-                  size_t) override {
-    ++sendto_calls;
-    return sendto_result;
-  }
-
-  int CloseSocket(uintptr_t socket_handle) override {
-    ++close_calls;
-    last_closed_socket = socket_handle;
-    return close_result;
-  }
-
-  int LastError() override { return last_error_value; }
-};
-
-} // namespace
+using xp2gdl90::test::FakeSocketOps;
 
 TEST_CASE("UDPBroadcaster send fails when not initialized") {
   udp::UDPBroadcaster broadcaster("127.0.0.1", 4000);
@@ -216,11 +160,41 @@ TEST_CASE("UDPBroadcaster forwards payload when send succeeds") {
 
 TEST_CASE("UDPBroadcaster updates target with setter") {
   udp::UDPBroadcaster broadcaster("127.0.0.1", 4000);
-  broadcaster.setTarget("192.168.0.255", 4900);
+  ASSERT_TRUE(broadcaster.setTarget("192.168.0.255", 4900));
   ASSERT_EQ(std::string("192.168.0.255"), broadcaster.getTargetIp());
   ASSERT_EQ(static_cast<uint16_t>(4900), broadcaster.getTargetPort());
 }
 
+TEST_CASE("UDPBroadcaster resolves the target once per setTarget") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 42;
+  ops.sendto_result = 1;
+
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  ASSERT_EQ(1, ops.inet_pton_calls);
+
+  const std::array<uint8_t, 1> data{{0x7E}};
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_EQ(1, broadcaster.send(data.data(), data.size()));
+  }
+  ASSERT_EQ(1, ops.inet_pton_calls);
+
+  ASSERT_TRUE(broadcaster.setTarget("192.168.0.255", 4900));
+  ASSERT_EQ(2, ops.inet_pton_calls);
+  ASSERT_EQ(1, broadcaster.send(data.data(), data.size()));
+  ASSERT_EQ(2, ops.inet_pton_calls);
+
+  ops.inet_pton_result = 0;
+  ASSERT_TRUE(!broadcaster.setTarget("not_an_ip", 4000));
+  ASSERT_TRUE(broadcaster.getLastError().find("Invalid IP address") !=
+              std::string::npos);
+  ASSERT_EQ(std::string("192.168.0.255"), broadcaster.getTargetIp());
+  ASSERT_EQ(static_cast<uint16_t>(4900), broadcaster.getTargetPort());
+  ASSERT_EQ(1, broadcaster.send(data.data(), data.size()));
+  ASSERT_EQ(std::string(""), broadcaster.getLastError());
+}
+
 TEST_CASE("UDPBroadcaster sends data after initialize") {
   udp::UDPBroadcaster broadcaster("127.0.0.1", 4000);
   ASSERT_TRUE(broadcaster.initialize());
@@ -236,3 +210,403 @@ TEST_CASE("UDPBroadcaster sends data after initialize") {
   broadcaster.close();
   ASSERT_TRUE(!broadcaster.isInitialized());
 }
+
+TEST_CASE("UDPBroadcaster sends a batch through a single SocketOps call") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 42;
+  ops.sendto_result = 1;
+
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  const std::array<uint8_t, 3> first{{0x7E, 0x01, 0x7E}};
+  const std::array<uint8_t, 4> second{{0x7E, 0x02, 0x03, 0x7E}};
+  const udp::SendBuffer buffers[] = {{first.data(), first.size()},
+                                     {second.data(), second.size()},
+                                     {first.data(), first.size()}};
+  ASSERT_EQ(3, broadcaster.sendBatch(buffers, 3));
+  ASSERT_EQ(1, ops.send_batch_calls);
+  ASSERT_EQ(3, ops.sendto_calls);
+  ASSERT_EQ(static_cast<size_t>(4), ops.sent_datagrams[1].size());
+  ASSERT_EQ(std::string(""), broadcaster.getLastError());
+
+  ASSERT_EQ(0, broadcaster.sendBatch(buffers, 0));
+  ASSERT_EQ(1, ops.send_batch_calls);
+}
+
+TEST_CASE("UDPBroadcaster batch send reports partial and total failure") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 42;
+  ops.sendto_result = 1;
+  ops.fail_sendto_after = 2;
+  ops.last_error_value = ENOBUFS;
+
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  const std::array<uint8_t, 2> data{{0xAA, 0xBB}};
+  const udp::SendBuffer buffers[] = {
+      {data.data(), data.size()}, {data.data(), data.size()},
+      {data.data(), data.size()}, {data.data(), data.size()}};
+  ASSERT_EQ(-1, broadcaster.sendBatch(buffers, 4));
+  ASSERT_TRUE(broadcaster.getLastError().find("not initialized") !=
+              std::string::npos);
+
+  ASSERT_TRUE(broadcaster.initialize());
+  ASSERT_EQ(2, broadcaster.sendBatch(buffers, 4));
+  ASSERT_TRUE(broadcaster.getLastError().find("Batch send stopped early") !=
+              std::string::npos);
+
+  ASSERT_EQ(-1, broadcaster.sendBatch(buffers, 4));
+  ASSERT_TRUE(broadcaster.getLastError().find("Batch send failed") !=
+              std::string::npos);
+
+  ops.inet_pton_result = 0;
+  ASSERT_TRUE(!broadcaster.setTarget("bogus", 4000));
+  ASSERT_TRUE(broadcaster.getLastError().find("Invalid IP address") !=
+              std::string::npos);
+}
+
+TEST_CASE("UDPBroadcaster batch send works on a real socket") {
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000);
+  ASSERT_TRUE(broadcaster.initialize());
+
+  const std::array<uint8_t, 2> data{{0x7E, 0x7E}};
+  const udp::SendBuffer buffers[] = {{data.data(), data.size()},
+                                     {data.data(), data.size()}};
+  const int sent = broadcaster.sendBatch(buffers, 2);
+  if (sent < 0) {
+    ASSERT_NE(std::string(""), broadcaster.getLastError());
+  } else {
+    ASSERT_EQ(2, sent);
+  }
+
+#if !defined(_WIN32)
+  sockaddr_in target_addr{};
+  target_addr.sin_family = AF_INET;
+  ASSERT_EQ(-1, udp::detail::DefaultSocketOps().SendBatch(
+                    udp::UDPBroadcaster::kInvalidSocket, buffers, 2, 0,
+                    &target_addr, sizeof(target_addr)));
+#endif
+  broadcaster.close();
+}
+
+TEST_CASE("UDPBroadcaster fans out to destinations selected by route") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 42;
+  ops.sendto_result = 1;
+
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  ASSERT_TRUE(broadcaster.addDestination("127.0.0.2", 4001, 1u << 4));
+  ASSERT_TRUE(broadcaster.addDestination("127.0.0.3", 4002, 1u << 2, 2));
+  ASSERT_EQ(static_cast<size_t>(3), broadcaster.destinationCount());
+
+  // Class bit 4 reaches the primary and the filtered destination only.
+  ASSERT_EQ(0x3u, broadcaster.routeMessage(1u << 4));
+  // The third destination takes every other message of its class.
+  ASSERT_EQ(0x5u, broadcaster.routeMessage(1u << 2));
+  ASSERT_EQ(0x1u, broadcaster.routeMessage(1u << 2));
+  ASSERT_EQ(0x5u, broadcaster.routeMessage(1u << 2));
+
+  const std::array<uint8_t, 3> data{{0x7E, 0x00, 0x7E}};
+  ASSERT_EQ(3, broadcaster.send(data.data(), data.size(), 0x5u));
+  ASSERT_EQ(2, ops.sendto_calls);
+  ASSERT_TRUE(ops.sent_addresses[0] != ops.sent_addresses[1]);
+  ASSERT_EQ(0, broadcaster.send(data.data(), data.size(), 0u));
+  ASSERT_EQ(2, ops.sendto_calls);
+
+  const udp::SendBuffer buffers[] = {{data.data(), data.size()},
+                                     {data.data(), data.size()}};
+  ASSERT_EQ(2, broadcaster.sendBatch(buffers, 2));
+  ASSERT_EQ(3, ops.send_batch_calls);
+  ASSERT_EQ(8, ops.sendto_calls);
+
+  // Truncating keeps the remaining destinations' divisor counts.
+  ASSERT_TRUE(broadcaster.addDestination("127.0.0.4", 4003));
+  broadcaster.truncateDestinations(8);
+  ASSERT_EQ(static_cast<size_t>(4), broadcaster.destinationCount());
+  broadcaster.truncateDestinations(3);
+  ASSERT_EQ(static_cast<size_t>(3), broadcaster.destinationCount());
+  ASSERT_EQ(0x1u, broadcaster.routeMessage(1u << 2));
+
+  broadcaster.clearDestinations();
+  ASSERT_EQ(static_cast<size_t>(1), broadcaster.destinationCount());
+  ASSERT_EQ(0x1u, broadcaster.routeMessage(1u << 4));
+}
+
+TEST_CASE("UDPBroadcaster sheds routes over the bandwidth limit") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 42;
+  ops.sendto_result = 1;
+
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  ASSERT_TRUE(broadcaster.addDestination("127.0.0.2", 4001));
+  // Class bit 0 is essential and bit 2 is shed first.
+  broadcaster.setBandwidthLimit(8000.0, 1u << 0, 1u << 2);
+  broadcaster.updateBandwidth(0.0);
+
+  ASSERT_EQ(0x3u, broadcaster.routeMessage(1u << 2, 1400));
+  ASSERT_EQ(0x0u, broadcaster.routeMessage(1u << 2, 200));
+  ASSERT_EQ(0x3u, broadcaster.routeMessage(1u << 0, 1000));
+  // Without a size the bucket is not consulted.
+  ASSERT_EQ(0x3u, broadcaster.routeMessage(1u << 2));
+  ASSERT_EQ(static_cast<uint64_t>(1),
+            broadcaster.bandwidthStats(1).shed_messages);
+
+  // A sendto error to the second destination only backs that one off.
+  broadcaster.updateBandwidth(1.0);
+  ops.fail_sendto_after = 1;
+  const std::array<uint8_t, 1> data{{0x7E}};
+  ASSERT_EQ(-1, broadcaster.send(data.data(), data.size()));
+  broadcaster.updateBandwidth(1.1);
+  ASSERT_EQ(static_cast<uint64_t>(0), broadcaster.bandwidthStats(0).backoffs);
+  ASSERT_EQ(static_cast<uint64_t>(1), broadcaster.bandwidthStats(1).backoffs);
+  ASSERT_EQ(0x1u, broadcaster.routeMessage(1u << 2, 600));
+
+  broadcaster.setBandwidthLimit(0.0, 0, 0);
+  ASSERT_EQ(0x3u, broadcaster.routeMessage(1u << 2, 60000));
+}
+
+TEST_CASE("ForeFlight devices follow the configured destinations") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 42;
+  ops.sendto_result = 1;
+
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  ASSERT_TRUE(broadcaster.addDestination("127.0.0.2", 4001,
+                                         udp::ALL_MESSAGE_CLASSES, 2));
+  ASSERT_EQ(static_cast<size_t>(2), broadcaster.firstDiscoveredDestination());
+
+  const auto device = [](uint32_t host) {
+    udp::SourceAddress address;
+    address.ipv4 = 0x0A000000u | host;
+    address.port = 4000;
+    return address;
+  };
+  xp2gdl90::foreflight::DeviceTable devices;
+  for (uint32_t host = 1; host <= 4; ++host) {
+    devices.see(device(host), 0.0);
+  }
+  // The first device is the primary target; the others follow.
+  ASSERT_EQ(static_cast<size_t>(0),
+            xp2gdl90::foreflight::ApplyDeviceDestinations(devices,
+                                                          broadcaster));
+  ASSERT_EQ(static_cast<size_t>(5), broadcaster.destinationCount());
+  ASSERT_EQ(static_cast<size_t>(2), broadcaster.firstDiscoveredDestination());
+  ASSERT_EQ(udp::FormatSourceIp(device(2)), broadcaster.destinationIp(2));
+  ASSERT_EQ(0x1Fu, broadcaster.routeMessage(1u << 2));
+
+  // Device 3 leaves: device 2 stays, device 4 is re-added in its place and
+  // the configured destination keeps its divisor count.
+  devices.see(device(1), 10.0);
+  devices.see(device(2), 10.0);
+  devices.see(device(4), 10.0);
+  devices.expire(10.0, 5.0);
+  ASSERT_EQ(static_cast<size_t>(0),
+            xp2gdl90::foreflight::ApplyDeviceDestinations(devices,
+                                                          broadcaster));
+  ASSERT_EQ(static_cast<size_t>(4), broadcaster.destinationCount());
+  ASSERT_EQ(udp::FormatSourceIp(device(4)), broadcaster.destinationIp(3));
+  ASSERT_EQ(0xDu, broadcaster.routeMessage(1u << 2));
+
+  // With the table full the devices past it are refused.
+  for (uint32_t host = 5; host <= 10; ++host) {
+    devices.see(device(host), 10.0);
+  }
+  std::string error;
+  const size_t refused = xp2gdl90::foreflight::ApplyDeviceDestinations(
+      devices, broadcaster, &error);
+  ASSERT_EQ(devices.size() - udp::MAX_DESTINATIONS + 1, refused);
+  ASSERT_TRUE(error.find("Too many destinations") != std::string::npos);
+
+  broadcaster.clearDestinations();
+  ASSERT_EQ(static_cast<size_t>(1), broadcaster.firstDiscoveredDestination());
+}
+
+TEST_CASE("UDPBroadcaster rejects bad or excess destinations") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 42;
+  ops.sendto_result = 1;
+
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  for (size_t i = 1; i < udp::MAX_DESTINATIONS; ++i) {
+    ASSERT_TRUE(broadcaster.addDestination(
+        "127.0.0.1", static_cast<uint16_t>(5000 + i), udp::ALL_MESSAGE_CLASSES,
+        0));
+  }
+  ASSERT_TRUE(!broadcaster.addDestination("127.0.0.1", 6000));
+  ASSERT_TRUE(broadcaster.getLastError().find("Too many destinations") !=
+              std::string::npos);
+
+  broadcaster.clearDestinations();
+  ops.inet_pton_result = 0;
+  ASSERT_TRUE(!broadcaster.addDestination("bogus", 6000));
+  ASSERT_EQ(static_cast<size_t>(1), broadcaster.destinationCount());
+
+  // One failing destination fails the send but the others still go out.
+  ops.inet_pton_result = 1;
+  ASSERT_TRUE(broadcaster.addDestination("127.0.0.1", 6001));
+  ops.fail_sendto_after = 1;
+  const std::array<uint8_t, 1> data{{0x7E}};
+  ASSERT_EQ(-1, broadcaster.send(data.data(), data.size()));
+  ASSERT_TRUE(broadcaster.getLastError().find("sendto failed") !=
+              std::string::npos);
+  ASSERT_EQ(2, ops.sendto_calls);
+}
+
+TEST_CASE("UDPBroadcaster marks group addresses as multicast destinations") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 42;
+  ops.sendto_result = 1;
+
+  udp::UDPBroadcaster broadcaster("192.168.1.255", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  ASSERT_TRUE(!broadcaster.isMulticast(0));
+  ASSERT_TRUE(broadcaster.addDestination("239.255.40.1", 4000));
+  ASSERT_TRUE(broadcaster.addDestination("192.168.1.60", 4000));
+  ASSERT_TRUE(broadcaster.isMulticast(1));
+  ASSERT_TRUE(!broadcaster.isMulticast(2));
+
+  ASSERT_TRUE(broadcaster.setTarget("224.0.0.251", 4000));
+  ASSERT_TRUE(broadcaster.isMulticast(0));
+  ASSERT_TRUE(broadcaster.setTarget("192.168.1.50", 4000));
+  ASSERT_TRUE(!broadcaster.isMulticast(0));
+
+  // A group is one send however many receivers joined it.
+  const std::array<uint8_t, 1> data{{0x7E}};
+  ASSERT_EQ(1, broadcaster.send(data.data(), data.size(), 0x2u));
+  ASSERT_EQ(1, ops.sendto_calls);
+}
+
+TEST_CASE("UDPBroadcaster applies multicast options to the socket") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 42;
+
+  udp::UDPBroadcaster broadcaster("239.255.40.1", 4000, &ops);
+  udp::MulticastOptions options;
+  options.ttl = 3;
+  options.loopback = true;
+  // Kept until the socket opens.
+  ASSERT_TRUE(broadcaster.setMulticastOptions(options));
+  ASSERT_EQ(0, ops.setsockopt_calls);
+
+  ASSERT_TRUE(broadcaster.initialize());
+  // SO_BROADCAST, then TTL, loopback and interface.
+  ASSERT_EQ(4, ops.setsockopt_calls);
+  ASSERT_EQ(IP_MULTICAST_TTL, ops.setsockopt_names[1]);
+  ASSERT_EQ(3, ops.setsockopt_values[1]);
+  ASSERT_EQ(IP_MULTICAST_LOOP, ops.setsockopt_names[2]);
+  ASSERT_EQ(1, ops.setsockopt_values[2]);
+  ASSERT_EQ(IP_MULTICAST_IF, ops.setsockopt_names[3]);
+
+  options.ttl = 8;
+  options.loopback = false;
+  options.interface_ip = "192.168.1.10";
+  ASSERT_TRUE(broadcaster.setMulticastOptions(options));
+  ASSERT_EQ(7, ops.setsockopt_calls);
+  ASSERT_EQ(8, ops.setsockopt_values[4]);
+  ASSERT_EQ(0, ops.setsockopt_values[5]);
+  ASSERT_EQ(std::string("192.168.1.10"),
+            broadcaster.multicastOptions().interface_ip);
+
+  ops.inet_pton_result = 0;
+  options.interface_ip = "eth0";
+  ASSERT_TRUE(!broadcaster.setMulticastOptions(options));
+  ASSERT_TRUE(broadcaster.getLastError().find("multicast interface") !=
+              std::string::npos);
+  ASSERT_EQ(std::string("192.168.1.10"),
+            broadcaster.multicastOptions().interface_ip);
+
+  ops.inet_pton_result = 1;
+  ops.setsockopt_result = -1;
+  options.interface_ip.clear();
+  options.ttl = 1;
+  ASSERT_TRUE(!broadcaster.setMulticastOptions(options));
+  ASSERT_TRUE(broadcaster.getLastError().find(
+                  "Failed to set multicast options") != std::string::npos);
+  ASSERT_EQ(static_cast<uint8_t>(8), broadcaster.multicastOptions().ttl);
+  broadcaster.close();
+}
+
+#if !defined(_WIN32)
+TEST_CASE("UDPBroadcaster sets multicast options on a real socket") {
+  udp::UDPBroadcaster broadcaster("239.255.40.1", 4000);
+  ASSERT_TRUE(broadcaster.initialize());
+  udp::MulticastOptions options;
+  options.ttl = 2;
+  options.loopback = true;
+  ASSERT_TRUE(broadcaster.setMulticastOptions(options));
+  ASSERT_TRUE(broadcaster.isMulticast(0));
+  broadcaster.close();
+}
+#endif
+
+TEST_CASE("UDPBroadcaster applies socket options through SocketOps") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 42;
+
+  udp::UDPBroadcaster broadcaster("192.168.1.50", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  // Defaults leave TOS, the send buffer and the local address alone.
+  ASSERT_EQ(0, ops.bind_calls);
+  const int default_calls = ops.setsockopt_calls;
+
+  udp::SocketOptions options;
+  options.dscp = 46;
+  options.send_buffer_bytes = 1u << 20;
+  options.bind_ip = "192.168.1.10";
+  ASSERT_TRUE(broadcaster.setSocketOptions(options));
+  // The socket was reopened with the options.
+  ASSERT_EQ(2, ops.create_socket_calls);
+  ASSERT_EQ(1, ops.close_calls);
+  ASSERT_EQ(1, ops.bind_calls);
+  ASSERT_TRUE(broadcaster.isInitialized());
+  ASSERT_EQ(IP_TOS, ops.setsockopt_names[default_calls + 1]);
+  ASSERT_EQ(46 << 2, ops.setsockopt_values[default_calls + 1]);
+  ASSERT_EQ(SO_SNDBUF, ops.setsockopt_names[default_calls + 2]);
+  ASSERT_EQ(1 << 20, ops.setsockopt_values[default_calls + 2]);
+
+  // The same options again leave the socket open.
+  ASSERT_TRUE(broadcaster.setSocketOptions(options));
+  ASSERT_EQ(2, ops.create_socket_calls);
+
+  options.bind_ip = "wlan0";
+  ASSERT_TRUE(!broadcaster.setSocketOptions(options));
+  ASSERT_TRUE(broadcaster.getLastError().find("Invalid bind address") !=
+              std::string::npos);
+  ASSERT_EQ(2, ops.create_socket_calls);
+
+  // A failing bind puts the previous options back.
+  ops.bind_result = -1;
+  options.bind_ip = "192.168.1.11";
+  ASSERT_TRUE(!broadcaster.setSocketOptions(options));
+  ASSERT_TRUE(broadcaster.getLastError().find("bind failed") !=
+              std::string::npos);
+  ASSERT_EQ(std::string("192.168.1.10"), broadcaster.socketOptions().bind_ip);
+  ASSERT_TRUE(!broadcaster.isInitialized());
+  ops.bind_result = 0;
+  ASSERT_TRUE(broadcaster.initialize());
+  broadcaster.close();
+}
+
+#if !defined(_WIN32)
+TEST_CASE("UDPBroadcaster sets socket options on a real socket") {
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000);
+  udp::SocketOptions options;
+  options.dscp = 46;
+  options.send_buffer_bytes = 256 * 1024;
+  options.bind_ip = "127.0.0.1";
+  ASSERT_TRUE(broadcaster.setSocketOptions(options));
+  ASSERT_TRUE(broadcaster.initialize());
+  const std::array<uint8_t, 2> data{{0x7E, 0x7E}};
+  const int sent = broadcaster.send(data.data(), data.size());
+  if (sent < 0) {
+    ASSERT_NE(std::string(""), broadcaster.getLastError());
+  } else {
+    ASSERT_EQ(2, sent);
+  }
+  broadcaster.close();
+}
+#endif
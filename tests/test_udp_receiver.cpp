@@ -0,0 +1,121 @@
+#include "test_harness.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "xp2gdl90/udp_receiver.h"
+
+TEST_CASE("UDPReceiver receive paths fail when not initialized") {
+  udp::UDPReceiver receiver(47601);
+  std::array<uint8_t, 16> buffer{};
+  ASSERT_EQ(-1, receiver.receiveInto(buffer.data(), buffer.size()));
+  ASSERT_EQ(std::string("Socket not initialized"), receiver.getLastError());
+
+  udp::ReceiveBatch batch(4);
+  ASSERT_EQ(-1, receiver.drain(&batch));
+  ASSERT_EQ(static_cast<size_t>(0), batch.count());
+  ASSERT_EQ(-1, receiver.drain(nullptr));
+  ASSERT_EQ(-1, receiver.receive(nullptr));
+  ASSERT_EQ(-1, receiver.waitReadable(0));
+}
+
+TEST_CASE("FormatSourceIp renders network-order addresses") {
+  udp::SourceAddress address;
+  address.ipv4 = htonl(0xC0A8010Au);
+  address.port = 4000;
+  ASSERT_EQ(std::string("192.168.1.10"), udp::FormatSourceIp(address));
+
+  udp::SourceAddress same = address;
+  ASSERT_TRUE(same == address);
+  same.port = 4001;
+  ASSERT_TRUE(same != address);
+}
+
+#if !defined(_WIN32)
+namespace {
+
+constexpr uint16_t kTestPort = 47602;
+
+void SendLoopback(const std::string &payload) {
+  const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_TRUE(fd >= 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(kTestPort);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  const ssize_t sent =
+      ::sendto(fd, payload.data(), payload.size(), 0,
+               reinterpret_cast<const sockaddr *>(&addr), sizeof(addr));
+  ::close(fd);
+  ASSERT_EQ(static_cast<ssize_t>(payload.size()), sent);
+}
+
+} // namespace
+
+TEST_CASE("UDPReceiver receiveInto returns the binary source address") {
+  udp::UDPReceiver receiver(kTestPort);
+  ASSERT_TRUE(receiver.initialize());
+
+  std::array<uint8_t, 64> buffer{};
+  udp::SourceAddress source;
+  ASSERT_EQ(0, receiver.receiveInto(buffer.data(), buffer.size(), &source));
+
+  SendLoopback("hello");
+  ASSERT_EQ(5, receiver.receiveInto(buffer.data(), buffer.size(), &source));
+  ASSERT_EQ(std::string("hello"),
+            std::string(buffer.begin(), buffer.begin() + 5));
+  ASSERT_EQ(htonl(INADDR_LOOPBACK), source.ipv4);
+  ASSERT_NE(static_cast<uint16_t>(0), source.port);
+  ASSERT_EQ(std::string("127.0.0.1"), udp::FormatSourceIp(source));
+
+  SendLoopback("legacy");
+  std::vector<uint8_t> packet;
+  std::string ip;
+  uint16_t port = 0;
+  ASSERT_EQ(6, receiver.receive(&packet, &ip, &port));
+  ASSERT_EQ(static_cast<size_t>(6), packet.size());
+  ASSERT_EQ(std::string("127.0.0.1"), ip);
+  ASSERT_NE(static_cast<uint16_t>(0), port);
+  ASSERT_EQ(0, receiver.receive(&packet, &ip, &port));
+  ASSERT_TRUE(packet.empty());
+}
+
+TEST_CASE("UDPReceiver drain pulls several datagrams per call") {
+  udp::UDPReceiver receiver(kTestPort);
+  ASSERT_TRUE(receiver.initialize());
+
+  udp::ReceiveBatch batch(2);
+  ASSERT_EQ(0, receiver.drain(&batch));
+  ASSERT_EQ(0, receiver.waitReadable(0));
+
+  SendLoopback("one");
+  SendLoopback("two");
+  SendLoopback("three");
+  ASSERT_EQ(1, receiver.waitReadable(100));
+  ASSERT_EQ(2, receiver.drain(&batch));
+  ASSERT_EQ(static_cast<size_t>(2), batch.count());
+  ASSERT_EQ(std::string("one"),
+            std::string(reinterpret_cast<const char *>(batch.data(0)),
+                        batch.size(0)));
+  ASSERT_EQ(std::string("two"),
+            std::string(reinterpret_cast<const char *>(batch.data(1)),
+                        batch.size(1)));
+  ASSERT_EQ(htonl(INADDR_LOOPBACK), batch.source(1).ipv4);
+
+  ASSERT_EQ(1, receiver.drain(&batch));
+  ASSERT_EQ(std::string("three"),
+            std::string(reinterpret_cast<const char *>(batch.data(0)),
+                        batch.size(0)));
+  ASSERT_EQ(0, receiver.drain(&batch));
+  ASSERT_EQ(static_cast<size_t>(0), batch.count());
+}
+#endif
@@ -0,0 +1,248 @@
+#include "test_harness.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include "fake_socket_ops.h"
+#include "xp2gdl90/broadcast_clock.h"
+#include "xp2gdl90/broadcast_engine.h"
+#include "xp2gdl90/foreflight_discovery.h"
+#include "xp2gdl90/output_scheduler.h"
+#include "xp2gdl90/virtual_clock.h"
+
+using xp2gdl90::FrameTicker;
+using xp2gdl90::OutputScheduler;
+using xp2gdl90::SendClass;
+using xp2gdl90::VirtualClock;
+using xp2gdl90::test::FakeSocketOps;
+
+namespace {
+
+constexpr double kHour = 3600.0;
+// The front ends' ForeFlight discovery timeout.
+constexpr double kDiscoveryTimeout = 15.0;
+
+void FillArena(gdl90::FrameArena *arena, size_t count) {
+  arena->clear();
+  for (size_t i = 0; i < count; ++i) {
+    uint8_t *frame = arena->beginFrame();
+    frame[0] = 0x7E;
+    frame[1] = 0x14;
+    frame[2] = static_cast<uint8_t>(i);
+    frame[3] = 0x7E;
+    arena->commitFrame(4);
+  }
+}
+
+} // namespace
+
+TEST_CASE("Virtual clock only moves forward when stepped") {
+  VirtualClock clock(10.0, 1000000);
+  ASSERT_EQ(10.0, clock.monotonicSeconds());
+  ASSERT_EQ(static_cast<int64_t>(11000000), clock.wallMicroseconds());
+  clock.advance(0.5);
+  clock.advance(-3.0);
+  ASSERT_EQ(10.5, clock.now());
+
+  FrameTicker steady(&clock, 0.25);
+  ASSERT_EQ(10.75, steady.next());
+  ASSERT_EQ(static_cast<uint64_t>(1), steady.frames());
+
+  // Jittered frames stay within their bounds and repeat for a seed.
+  VirtualClock first;
+  VirtualClock second;
+  FrameTicker a(&first, 0.02, 0.005, 7);
+  FrameTicker b(&second, 0.02, 0.005, 7);
+  double previous = 0.0;
+  for (int i = 0; i < 1000; ++i) {
+    const double now = a.next();
+    ASSERT_TRUE(now - previous >= 0.015 - 1e-12);
+    ASSERT_TRUE(now - previous <= 0.025 + 1e-12);
+    previous = now;
+    ASSERT_EQ(now, b.next());
+  }
+}
+
+TEST_CASE("Broadcast clock and engine read an injected clock") {
+  VirtualClock clock(2.0, 1700000000000000);
+  xp2gdl90::BroadcastClockState state;
+  // Replay runs on the monotonic clock.
+  const xp2gdl90::BroadcastClockResult result =
+      xp2gdl90::UpdateBroadcastClock(100.0, clock, true, &state);
+  ASSERT_EQ(2.0, result.time);
+
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  xp2gdl90::BroadcastEngine engine;
+  engine.attach(&broadcaster);
+  engine.setClock(&clock);
+  xp2gdl90::BroadcastOptions options;
+  options.link_probe = true;
+  std::string error;
+  ASSERT_TRUE(engine.configure(options, &error));
+  const uint8_t heartbeat[] = {0x7E, 0x00, 0x7E};
+  engine.sendMessage(heartbeat, sizeof(heartbeat),
+                     xp2gdl90::MESSAGE_HEARTBEAT);
+  engine.flush();
+  ASSERT_EQ(static_cast<size_t>(2), ops.sent_datagrams.size());
+
+  gdl90::Decoder decoder;
+  const std::vector<uint8_t> &mark_bytes = ops.sent_datagrams.back();
+  decoder.reset(mark_bytes.data(), mark_bytes.size());
+  gdl90::FrameSpan frame;
+  ASSERT_TRUE(decoder.next(&frame));
+  xp2gdl90::LinkProbeMark mark;
+  ASSERT_TRUE(xp2gdl90::DecodeLinkProbe(frame, &mark));
+  ASSERT_EQ(clock.wallMicroseconds(), mark.send_time_us);
+}
+
+TEST_CASE("An hour of jittered frames keeps every class on its rate") {
+  // 30 Hz frames, each up to 8 ms off: the X-Plane flight loop under load.
+  VirtualClock clock;
+  FrameTicker ticker(&clock, 1.0 / 30.0, 0.008, 42);
+  OutputScheduler scheduler;
+  const std::array<double, xp2gdl90::SEND_CLASS_COUNT> rates = {
+      1.0, 5.0, 1.0, 10.0, 0.2, 2.0};
+  for (size_t i = 0; i < rates.size(); ++i) {
+    scheduler.configure(static_cast<SendClass>(i),
+                        xp2gdl90::PeriodForRate(rates[i]));
+  }
+  scheduler.setTickInterval(1.0 / 30.0);
+  scheduler.restart(0.0);
+  xp2gdl90::SendIntervalTable intervals;
+
+  while (clock.now() < kHour) {
+    const double now = ticker.next();
+    scheduler.beginTick(now, now);
+    SendClass send_class = SendClass::HEARTBEAT;
+    while (scheduler.next(now, &send_class)) {
+      scheduler.complete(send_class, 40, now);
+      const size_t index = static_cast<size_t>(send_class);
+      intervals[index].recordSend(now, 1.0 / rates[index]);
+    }
+  }
+
+  ASSERT_TRUE(ticker.frames() > 100000u);
+  for (size_t i = 0; i < rates.size(); ++i) {
+    const double expected = kHour * rates[i];
+    const double sent =
+        static_cast<double>(scheduler.stats(static_cast<SendClass>(i)).sent);
+    // Releases stay on the period grid, so only the last one may be
+    // missing.
+    ASSERT_TRUE(std::fabs(sent - expected) <= 2.0);
+    ASSERT_TRUE(std::fabs(intervals[i].meanIntervalS() - 1.0 / rates[i]) <
+                1e-4);
+    // No send lands more than one frame and its jitter off the grid.
+    ASSERT_TRUE(intervals[i].maxIntervalS() - 1.0 / rates[i] < 0.05);
+    ASSERT_EQ(static_cast<uint64_t>(0),
+              scheduler.stats(static_cast<SendClass>(i)).dropped);
+  }
+}
+
+TEST_CASE("An hour of paced sweeps sends nearly every traffic frame") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  ops.record_sends = false;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  xp2gdl90::BroadcastEngine engine;
+  engine.attach(&broadcaster);
+
+  VirtualClock clock;
+  FrameTicker ticker(&clock, 1.0 / 30.0, 0.008, 9);
+  gdl90::FrameArena frames;
+  FillArena(&frames, 30);
+  const double sweep_interval = 0.5;
+  double next_sweep = 0.0;
+  uint64_t sweeps = 0;
+  while (clock.now() < kHour) {
+    const double now = ticker.next();
+    if (now >= next_sweep && next_sweep < kHour) {
+      engine.startTraffic(frames, now,
+                          udp::TRAFFIC_PACING_WINDOW_FRACTION * sweep_interval);
+      next_sweep += sweep_interval;
+      ++sweeps;
+    }
+    engine.sendPacedTraffic(now);
+    engine.flush();
+  }
+
+  const udp::TrafficPacerStats &paced = engine.trafficPacer().stats();
+  ASSERT_EQ(static_cast<uint64_t>(7200), sweeps);
+  ASSERT_TRUE(paced.frames + paced.superseded +
+                  engine.trafficPacer().pending() ==
+              sweeps * 30);
+  // A sweep that starts a late frame can end after the next one begins;
+  // under jitter that costs a last frame now and then.
+  ASSERT_TRUE(paced.superseded > 0u);
+  ASSERT_TRUE(paced.superseded * 1000 < sweeps * 30);
+  // 30 frames over 0.45 s of 33 ms frames: two or three per slice.
+  ASSERT_TRUE(paced.max_burst <= 4u);
+  ASSERT_EQ(paced.frames, engine.stats().traffic_packets_sent);
+}
+
+TEST_CASE("Discovered devices expire on virtual time") {
+  VirtualClock clock;
+  FrameTicker ticker(&clock, 1.0);
+  xp2gdl90::foreflight::DeviceTable table;
+  udp::SourceAddress tablet;
+  tablet.ipv4 = 0x0A000001u;
+  tablet.port = 63093;
+  udp::SourceAddress phone = tablet;
+  phone.ipv4 = 0x0A000002u;
+
+  // The phone leaves after ten minutes; the tablet stays for the hour.
+  size_t expired = 0;
+  double phone_gone_at = 0.0;
+  while (clock.now() < kHour) {
+    const double now = ticker.next();
+    table.see(tablet, now);
+    if (now <= 600.0) {
+      table.see(phone, now);
+    }
+    const size_t dropped = table.expire(now, kDiscoveryTimeout);
+    if (dropped > 0 && phone_gone_at == 0.0) {
+      phone_gone_at = now;
+    }
+    expired += dropped;
+  }
+  ASSERT_EQ(static_cast<size_t>(1), expired);
+  ASSERT_EQ(static_cast<size_t>(1), table.size());
+  ASSERT_TRUE(phone_gone_at > 600.0 + kDiscoveryTimeout);
+  ASSERT_TRUE(phone_gone_at <= 600.0 + kDiscoveryTimeout + 1.0);
+}
+
+TEST_CASE("Bandwidth back-pressure holds the cap over an hour") {
+  FakeSocketOps ops;
+  ops.create_socket_result = 9;
+  ops.sendto_result = 1;
+  ops.record_sends = false;
+  udp::UDPBroadcaster broadcaster("127.0.0.1", 4000, &ops);
+  ASSERT_TRUE(broadcaster.initialize());
+  const double cap = 4000.0;
+  broadcaster.setBandwidthLimit(cap, xp2gdl90::MESSAGE_HEARTBEAT, 0);
+
+  VirtualClock clock;
+  FrameTicker ticker(&clock, 1.0 / 30.0, 0.008, 5);
+  broadcaster.updateBandwidth(clock.monotonicSeconds());
+  uint64_t offered = 0;
+  while (clock.now() < kHour) {
+    ticker.next();
+    broadcaster.updateBandwidth(clock.monotonicSeconds());
+    // 200 bytes a frame is 6000 B/s offered against a 4000 B/s cap.
+    broadcaster.routeMessage(xp2gdl90::MESSAGE_TRAFFIC, 200);
+    offered += 200;
+  }
+
+  const udp::BandwidthLimiterStats &stats = broadcaster.bandwidthStats(0);
+  const double admitted = static_cast<double>(stats.admitted_bytes);
+  ASSERT_TRUE(admitted <= cap * clock.now() + cap);
+  ASSERT_TRUE(admitted >= 0.95 * cap * clock.now());
+  ASSERT_EQ(offered, stats.admitted_bytes + stats.shed_bytes);
+}